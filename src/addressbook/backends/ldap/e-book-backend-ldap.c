@@ -29,6 +29,9 @@
 #include <string.h>
 
 #include <glib.h>
+#ifndef G_OS_WIN32
+#include <glib-unix.h>
+#endif
 
 #ifdef DEBUG
 #define LDAP_DEBUG
@@ -58,6 +61,11 @@
 #include "openldap-extract.h"
 #endif
 
+/* RFC 2696 simple paged results, as implemented by OpenLDAP 2.4 */
+#if defined (LDAP_CONTROL_PAGEDRESULTS) && LDAP_VENDOR_VERSION >= 20400 && !defined (SUNLDAP) && !defined (G_OS_WIN32)
+#define HAVE_LDAP_PAGED_RESULTS 1
+#endif
+
 #include <sys/time.h>
 
 #include <glib/gi18n-lib.h>
@@ -73,9 +81,15 @@
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), E_TYPE_BOOK_BACKEND_LDAP, EBookBackendLDAPPrivate))
 
-/* interval for our poll_ldap timeout */
+/* interval for our poll_ldap timeout, used when the LDAP socket cannot be watched */
 #define LDAP_POLL_INTERVAL 20
 
+/* how many results poll_ldap processes before it lets the main loop run */
+#define LDAP_MAX_RESULTS_PER_DISPATCH 50
+
+/* how many entries to ask for in one page of a paged search */
+#define LDAP_PAGE_SIZE 500
+
 /* timeout for ldap_result */
 #define LDAP_RESULT_TIMEOUT_MILLIS 10
 
@@ -158,7 +172,9 @@ struct _EBookBackendLDAPPrivate {
 	GRecMutex op_hash_mutex; /* lock also eds_ldap_handler_lock before this lock */
 	GHashTable *id_to_op;
 	gint active_ops;
-	guint poll_timeout;
+	guint poll_timeout; /* ID of the LDAP socket watch, or of the polling timeout */
+	GSource *poll_source; /* the LDAP socket watch, if used */
+	gint poll_fd; /* the watched LDAP socket */
 
 	/* summary file related */
 	gchar *summary_file_name;
@@ -191,6 +207,8 @@ static void     ldap_op_add (LDAPOp *op, EBookBackend *backend, EDataBook *book,
 static void     ldap_op_finished (LDAPOp *op);
 
 static gboolean poll_ldap (gpointer user_data);
+static void	ldap_poll_start (EBookBackendLDAP *bl);
+static void	ldap_poll_stop (EBookBackendLDAP *bl);
 
 static EContact *build_contact_from_entry (EBookBackendLDAP *bl, LDAPMessage *e, GList **existing_objectclasses, gchar **ldap_uid);
 
@@ -1072,10 +1090,18 @@ ldap_op_add (LDAPOp *op,
 
 	bl->priv->active_ops++;
 
-	if (bl->priv->poll_timeout == 0) {
-		bl->priv->poll_timeout = e_named_timeout_add (
-			LDAP_POLL_INTERVAL, poll_ldap, bl);
+#ifndef G_OS_WIN32
+	/* the connection could be replaced since the watch had been started */
+	if (bl->priv->poll_source && bl->priv->ldap) {
+		gint fd = -1;
+
+		if (ldap_get_option (bl->priv->ldap, LDAP_OPT_DESC, &fd) == LDAP_OPT_SUCCESS &&
+		    fd != bl->priv->poll_fd)
+			ldap_poll_stop (bl);
 	}
+#endif
+
+	ldap_poll_start (bl);
 
 	g_rec_mutex_unlock (&bl->priv->op_hash_mutex);
 	g_rec_mutex_unlock (&eds_ldap_handler_lock);
@@ -1103,12 +1129,8 @@ ldap_op_finished (LDAPOp *op)
 
 	bl->priv->active_ops--;
 
-	if (bl->priv->active_ops == 0) {
-		if (bl->priv->poll_timeout > 0) {
-			g_source_remove (bl->priv->poll_timeout);
-			bl->priv->poll_timeout = 0;
-		}
-	}
+	if (bl->priv->active_ops == 0)
+		ldap_poll_stop (bl);
 	g_rec_mutex_unlock (&bl->priv->op_hash_mutex);
 	g_rec_mutex_unlock (&eds_ldap_handler_lock);
 }
@@ -2202,8 +2224,86 @@ get_contact_dtor (LDAPOp *op)
 typedef struct {
 	LDAPOp op;
 	GSList *contacts;
+	gchar *ldap_query; /* to ask for the next page of the result */
 } LDAPGetContactListOp;
 
+/* Starts a search for all entries matching @ldap_query, asking the server
+ * to return the result in pages, with the next page requested by
+ * ldap_search_next_page(). The @cookie is %NULL for the first page.
+ * Call with eds_ldap_handler_lock held. */
+static gint
+ldap_search_paged (EBookBackendLDAP *bl,
+                   const gchar *ldap_query,
+                   struct berval *cookie,
+                   gint *out_msgid)
+{
+	LDAPControl *server_controls[2] = { NULL, NULL };
+	gint ldap_error;
+
+	if (!bl->priv->ldap)
+		return LDAP_SERVER_DOWN;
+
+#ifdef HAVE_LDAP_PAGED_RESULTS
+	/* not critical, servers without the support return everything at once */
+	if (bl->priv->ldap_v3 &&
+	    ldap_create_page_control (bl->priv->ldap, LDAP_PAGE_SIZE, cookie, 0, &server_controls[0]) != LDAP_SUCCESS)
+		server_controls[0] = NULL;
+#endif
+
+	ldap_error = ldap_search_ext (
+		bl->priv->ldap,
+		bl->priv->ldap_rootdn,
+		bl->priv->ldap_scope,
+		ldap_query,
+		NULL, 0,
+		server_controls[0] ? server_controls : NULL,
+		NULL,
+		NULL, /* XXX timeout */
+		LDAP_NO_LIMIT, out_msgid);
+
+	if (server_controls[0])
+		ldap_control_free (server_controls[0]);
+
+	return ldap_error;
+}
+
+/* Checks the @controls of a search result for a paged results response
+ * and when the server has more entries, requests the next page for @op.
+ * Returns whether the next page had been requested. Call with
+ * eds_ldap_handler_lock held. */
+static gboolean
+ldap_search_next_page (EBookBackendLDAP *bl,
+                       LDAPOp *op,
+                       const gchar *ldap_query,
+                       LDAPControl **controls)
+{
+	gboolean requested = FALSE;
+#ifdef HAVE_LDAP_PAGED_RESULTS
+	LDAPControl *page_control;
+	struct berval cookie = { 0, NULL };
+	ber_int_t estimate = 0;
+	gint msgid = -1;
+
+	if (!bl->priv->ldap || !controls || !ldap_query)
+		return FALSE;
+
+	page_control = ldap_control_find (LDAP_CONTROL_PAGEDRESULTS, controls, NULL);
+	if (!page_control ||
+	    ldap_parse_pageresponse_control (bl->priv->ldap, page_control, &estimate, &cookie) != LDAP_SUCCESS)
+		return FALSE;
+
+	if (cookie.bv_val && cookie.bv_len > 0 &&
+	    ldap_search_paged (bl, ldap_query, &cookie, &msgid) == LDAP_SUCCESS) {
+		ldap_op_change_id (op, msgid);
+		requested = TRUE;
+	}
+
+	ber_memfree (cookie.bv_val);
+#endif
+
+	return requested;
+}
+
 static void
 contact_list_handler (LDAPOp *op,
                       LDAPMessage *res)
@@ -2251,7 +2351,7 @@ contact_list_handler (LDAPOp *op,
 				if (enable_debug)
 					printf ("vcard = %s\n", vcard);
 
-				contact_list_op->contacts = g_slist_append (contact_list_op->contacts, vcard);
+				contact_list_op->contacts = g_slist_prepend (contact_list_op->contacts, vcard);
 
 				g_object_unref (contact);
 			}
@@ -2266,18 +2366,32 @@ contact_list_handler (LDAPOp *op,
 	} else if (msg_type == LDAP_RES_SEARCH_REFERENCE) {
 		/* ignore references */
 	} else if (msg_type == LDAP_RES_SEARCH_RESULT) {
-		gchar *ldap_error_msg;
+		gchar *ldap_error_msg = NULL;
+		LDAPControl **controls = NULL;
 		gint ldap_error;
 
 		g_rec_mutex_lock (&eds_ldap_handler_lock);
 		if (bl->priv->ldap) {
 			ldap_parse_result (
 				bl->priv->ldap, res, &ldap_error,
-				NULL, &ldap_error_msg, NULL, NULL, 0);
+				NULL, &ldap_error_msg, NULL, &controls, 0);
 		} else {
 			ldap_error = LDAP_SERVER_DOWN;
 		}
+
+		if (ldap_error == LDAP_SUCCESS &&
+		    ldap_search_next_page (bl, op, contact_list_op->ldap_query, controls)) {
+			g_rec_mutex_unlock (&eds_ldap_handler_lock);
+			if (controls)
+				ldap_controls_free (controls);
+			ldap_memfree (ldap_error_msg);
+			return;
+		}
 		g_rec_mutex_unlock (&eds_ldap_handler_lock);
+
+		if (controls)
+			ldap_controls_free (controls);
+
 		if (ldap_error != LDAP_SUCCESS) {
 			g_warning (
 				"contact_list_handler: %02X (%s), additional info: %s",
@@ -2288,6 +2402,8 @@ contact_list_handler (LDAPOp *op,
 
 		g_warning ("search returned %d\n", ldap_error);
 
+		contact_list_op->contacts = g_slist_reverse (contact_list_op->contacts);
+
 		if (ldap_error == LDAP_TIMELIMIT_EXCEEDED)
 			e_data_book_respond_get_contact_list (
 				op->book,
@@ -2341,6 +2457,7 @@ contact_list_dtor (LDAPOp *op)
 
 	g_slist_foreach (contact_list_op->contacts, (GFunc) g_free, NULL);
 	g_slist_free (contact_list_op->contacts);
+	g_free (contact_list_op->ldap_query);
 
 	g_free (contact_list_op);
 }
@@ -4165,7 +4282,7 @@ static gboolean
 poll_ldap (gpointer user_data)
 {
 	EBookBackendLDAP *bl;
-	gint rc;
+	gint rc, n_results;
 	LDAPMessage *res;
 	struct timeval timeout;
 	const gchar *ldap_timeout_string;
@@ -4175,28 +4292,39 @@ poll_ldap (gpointer user_data)
 
 	g_rec_mutex_lock (&eds_ldap_handler_lock);
 	if (!bl->priv->ldap || !bl->priv->poll_timeout) {
-		bl->priv->poll_timeout = 0;
+		ldap_poll_stop (bl);
 		g_rec_mutex_unlock (&eds_ldap_handler_lock);
 		return FALSE;
 	}
 
 	if (!bl->priv->active_ops) {
 		g_warning ("poll_ldap being called for backend with no active operations");
-		bl->priv->poll_timeout = 0;
+		ldap_poll_stop (bl);
 		g_rec_mutex_unlock (&eds_ldap_handler_lock);
 		return FALSE;
 	}
 
 	timeout.tv_sec = 0;
-	ldap_timeout_string = g_getenv ("LDAP_TIMEOUT");
-	if (ldap_timeout_string) {
-		timeout.tv_usec = g_ascii_strtod (ldap_timeout_string, NULL) * 1000;
+	if (bl->priv->poll_source) {
+		/* woken up by the socket, do not block the main loop */
+		timeout.tv_usec = 0;
+		g_source_set_ready_time (bl->priv->poll_source, -1);
+	} else {
+		ldap_timeout_string = g_getenv ("LDAP_TIMEOUT");
+		if (ldap_timeout_string) {
+			timeout.tv_usec = g_ascii_strtod (ldap_timeout_string, NULL) * 1000;
+		}
+		else
+			timeout.tv_usec = LDAP_RESULT_TIMEOUT_MILLIS * 1000;
 	}
-	else
-		timeout.tv_usec = LDAP_RESULT_TIMEOUT_MILLIS * 1000;
 
-	rc = ldap_result (bl->priv->ldap, LDAP_RES_ANY, 0, &timeout, &res);
-	if (rc != 0) {/* rc == 0 means timeout exceeded */
+	/* The library can read more messages from the socket at once, thus
+	 * read until there is nothing left, but in reasonable chunks */
+	for (n_results = 0; n_results < LDAP_MAX_RESULTS_PER_DISPATCH; n_results++) {
+		rc = ldap_result (bl->priv->ldap, LDAP_RES_ANY, 0, &timeout, &res);
+		if (rc == 0) /* rc == 0 means timeout exceeded */
+			break;
+
 		if (rc == -1) {
 			EDataBookView *book_view = find_book_view (bl);
 			g_warning ("%s: ldap_result returned -1, restarting ops", G_STRFUNC);
@@ -4207,6 +4335,14 @@ poll_ldap (gpointer user_data)
 				g_rec_mutex_unlock (&eds_ldap_handler_lock);
 				return FALSE;
 			}
+
+			/* watch the new connection */
+			if (bl->priv->poll_source) {
+				ldap_poll_stop (bl);
+				ldap_poll_start (bl);
+			}
+
+			break;
 		} else {
 			gint msgid = ldap_msgid (res);
 			LDAPOp *op;
@@ -4227,8 +4363,16 @@ poll_ldap (gpointer user_data)
 
 			ldap_msgfree (res);
 		}
+
+		/* the last operation finished, or polling with a timeout */
+		if (!bl->priv->poll_timeout || !bl->priv->poll_source || !bl->priv->ldap)
+			break;
 	}
 
+	/* there can be more results read already, which the socket watch would not notice */
+	if (n_results == LDAP_MAX_RESULTS_PER_DISPATCH && bl->priv->poll_source)
+		g_source_set_ready_time (bl->priv->poll_source, 0);
+
 	/* the poll_timeout is set to 0, when finalizing the backend */
 	again = bl->priv->poll_timeout > 0;
 	g_rec_mutex_unlock (&eds_ldap_handler_lock);
@@ -4236,6 +4380,63 @@ poll_ldap (gpointer user_data)
 	return again;
 }
 
+#ifndef G_OS_WIN32
+static gboolean
+poll_ldap_fd_cb (gint fd,
+                 GIOCondition condition,
+                 gpointer user_data)
+{
+	return poll_ldap (user_data);
+}
+#endif
+
+/* Starts dispatching results of the running operations, preferably
+ * when the LDAP socket has data to read; call with eds_ldap_handler_lock held */
+static void
+ldap_poll_start (EBookBackendLDAP *bl)
+{
+	if (bl->priv->poll_timeout > 0)
+		return;
+
+#ifndef G_OS_WIN32
+	if (bl->priv->ldap) {
+		gint fd = -1;
+
+		if (ldap_get_option (bl->priv->ldap, LDAP_OPT_DESC, &fd) == LDAP_OPT_SUCCESS && fd >= 0) {
+			GSource *source;
+
+			source = g_unix_fd_source_new (fd, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+			g_source_set_callback (source, (GSourceFunc) poll_ldap_fd_cb, bl, NULL);
+			g_source_set_name (source, "[evolution-data-server] poll_ldap");
+
+			bl->priv->poll_timeout = g_source_attach (source, NULL);
+			bl->priv->poll_source = source;
+			bl->priv->poll_fd = fd;
+
+			return;
+		}
+	}
+#endif
+
+	bl->priv->poll_timeout = e_named_timeout_add (LDAP_POLL_INTERVAL, poll_ldap, bl);
+}
+
+static void
+ldap_poll_stop (EBookBackendLDAP *bl)
+{
+	if (bl->priv->poll_timeout > 0) {
+		g_source_remove (bl->priv->poll_timeout);
+		bl->priv->poll_timeout = 0;
+	}
+
+	if (bl->priv->poll_source) {
+		g_source_unref (bl->priv->poll_source);
+		bl->priv->poll_source = NULL;
+	}
+
+	bl->priv->poll_fd = -1;
+}
+
 static void
 ldap_search_handler (LDAPOp *op,
                      LDAPMessage *res)
@@ -4591,6 +4792,8 @@ generate_cache_handler (LDAPOp *op,
 				e = NULL;
 			g_rec_mutex_unlock (&eds_ldap_handler_lock);
 		}
+	} else if (msg_type == LDAP_RES_SEARCH_REFERENCE) {
+		/* ignore references */
 	} else {
 		GSList *l;
 		gint contact_num = 0;
@@ -4598,6 +4801,34 @@ generate_cache_handler (LDAPOp *op,
 		GTimeVal now;
 		gchar *update_str;
 
+		if (msg_type == LDAP_RES_SEARCH_RESULT) {
+			LDAPControl **controls = NULL;
+			gint ldap_error = LDAP_SERVER_DOWN;
+			gboolean next_page = FALSE;
+
+			g_rec_mutex_lock (&eds_ldap_handler_lock);
+			if (bl->priv->ldap &&
+			    ldap_parse_result (bl->priv->ldap, res, &ldap_error, NULL, NULL, NULL, &controls, 0) == LDAP_SUCCESS &&
+			    ldap_error == LDAP_SUCCESS) {
+				next_page = ldap_search_next_page (bl, op, contact_list_op->ldap_query, controls);
+
+				if (next_page && book_view) {
+					status_msg = g_strdup_printf (
+						_("Downloading contacts (%d)..."),
+						g_slist_length (contact_list_op->contacts));
+					book_view_notify_status (bl, book_view, status_msg);
+					g_free (status_msg);
+				}
+			}
+			g_rec_mutex_unlock (&eds_ldap_handler_lock);
+
+			if (controls)
+				ldap_controls_free (controls);
+
+			if (next_page)
+				return;
+		}
+
 		e_file_cache_clean (E_FILE_CACHE (bl->priv->cache));
 
 		e_file_cache_freeze_changes (E_FILE_CACHE (bl->priv->cache));
@@ -4646,6 +4877,7 @@ generate_cache_dtor (LDAPOp *op)
 	}
 
 	g_slist_free (contact_list_op->contacts);
+	g_free (contact_list_op->ldap_query);
 	g_free (contact_list_op);
 
 	g_rec_mutex_lock (&eds_ldap_handler_lock);
@@ -4714,20 +4946,11 @@ generate_cache (EBookBackendLDAP *book_backend_ldap)
 
 	g_rec_mutex_unlock (&eds_ldap_handler_lock);
 
+	contact_list_op->ldap_query = g_strdup ("(cn=*)");
+
 	do {
 		g_rec_mutex_lock (&eds_ldap_handler_lock);
-		if (priv->ldap) {
-			ldap_error = ldap_search_ext (
-				priv->ldap,
-				priv->ldap_rootdn,
-				priv->ldap_scope,
-				"(cn=*)",
-				NULL, 0, NULL, NULL,
-				NULL, /* XXX timeout */
-				LDAP_NO_LIMIT, &contact_list_msgid);
-		} else {
-			ldap_error = LDAP_SERVER_DOWN;
-		}
+		ldap_error = ldap_search_paged (book_backend_ldap, contact_list_op->ldap_query, NULL, &contact_list_msgid);
 		g_rec_mutex_unlock (&eds_ldap_handler_lock);
 	} while (e_book_backend_ldap_reconnect (book_backend_ldap, NULL, ldap_error));
 
@@ -4868,10 +5091,7 @@ book_backend_ldap_finalize (GObject *object)
 	g_mutex_clear (&priv->view_mutex);
 
 	/* Remove the timeout before unbinding to avoid a race. */
-	if (priv->poll_timeout > 0) {
-		g_source_remove (priv->poll_timeout);
-		priv->poll_timeout = 0;
-	}
+	ldap_poll_stop (E_BOOK_BACKEND_LDAP (object));
 
 	g_rec_mutex_lock (&eds_ldap_handler_lock);
 	if (priv->ldap)
@@ -5530,22 +5750,11 @@ book_backend_ldap_get_contact_list (EBookBackend *backend,
 
 	do {
 		g_rec_mutex_lock (&eds_ldap_handler_lock);
-		if (bl->priv->ldap) {
-			ldap_error = ldap_search_ext (
-				bl->priv->ldap,
-				bl->priv->ldap_rootdn,
-				bl->priv->ldap_scope,
-				ldap_query,
-				NULL, 0, NULL, NULL,
-				NULL, /* XXX timeout */
-				LDAP_NO_LIMIT, &contact_list_msgid);
-		} else {
-			ldap_error = LDAP_SERVER_DOWN;
-		}
+		ldap_error = ldap_search_paged (bl, ldap_query, NULL, &contact_list_msgid);
 		g_rec_mutex_unlock (&eds_ldap_handler_lock);
 	} while (e_book_backend_ldap_reconnect (bl, book_view, ldap_error));
 
-	g_free (ldap_query);
+	contact_list_op->ldap_query = ldap_query;
 
 	if (ldap_error == LDAP_SUCCESS) {
 		ldap_op_add (
@@ -5969,6 +6178,7 @@ e_book_backend_ldap_init (EBookBackendLDAP *backend)
 
 	backend->priv->ldap_limit = 100;
 	backend->priv->id_to_op = g_hash_table_new (g_int_hash, g_int_equal);
+	backend->priv->poll_fd = -1;
 
 	g_mutex_init (&backend->priv->view_mutex);
 	g_rec_mutex_init (&backend->priv->op_hash_mutex);
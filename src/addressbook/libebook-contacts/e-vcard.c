@@ -106,6 +106,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "e-vcard.h"
@@ -132,6 +133,10 @@ typedef enum {
 struct _EVCardPrivate {
 	GList *attributes;
 	gchar *vcard;
+
+	/* gchar *name ~> EVCardAttribute *, the first attribute of that name;
+	 * built on demand by e_vcard_get_attribute() once the vCard is parsed */
+	GHashTable *attr_index;
 };
 
 struct _EVCardAttribute {
@@ -142,6 +147,7 @@ struct _EVCardAttribute {
 	GList *decoded_values;
 	EVCardEncoding encoding;
 	gboolean encoding_set;
+	gboolean name_interned; /* the name points to known_attr_names[] */
 };
 
 struct _EVCardAttributeParam {
@@ -149,6 +155,88 @@ struct _EVCardAttributeParam {
 	GList    *values;  /* GList of gchar *'s */
 };
 
+/* Names of the attributes most vCards consist of, sorted for bsearch();
+ * the parser shares these strings instead of allocating each name. */
+static const gchar *known_attr_names[] = {
+	"ADR", "BDAY", "BEGIN", "CALURI", "CATEGORIES", "EMAIL", "END",
+	"FBURL", "FN", "GEO", "KEY", "LABEL", "LOGO", "MAILER", "N",
+	"NICKNAME", "NOTE", "ORG", "PHOTO", "PRODID", "REV", "ROLE", "TEL",
+	"TITLE", "TZ", "UID", "URL", "VERSION", "X-AIM",
+	"X-EVOLUTION-ANNIVERSARY", "X-EVOLUTION-ASSISTANT",
+	"X-EVOLUTION-BLOG-URL", "X-EVOLUTION-BOOK-UID", "X-EVOLUTION-CALLBACK",
+	"X-EVOLUTION-COMPANY", "X-EVOLUTION-E164", "X-EVOLUTION-FILE-AS",
+	"X-EVOLUTION-LIST", "X-EVOLUTION-LIST-SHOW-ADDRESSES",
+	"X-EVOLUTION-MANAGER", "X-EVOLUTION-SPOUSE", "X-EVOLUTION-VIDEO-URL",
+	"X-GADUGADU", "X-GOOGLE-TALK", "X-GROUPWISE", "X-ICQ", "X-JABBER",
+	"X-MOZILLA-HTML", "X-MSN", "X-SIP", "X-SKYPE", "X-TWITTER", "X-YAHOO",
+};
+
+typedef struct _NameSlice {
+	const gchar *str;
+	gsize len;
+} NameSlice;
+
+static gint
+compare_name_slice (gconstpointer key,
+                    gconstpointer elem)
+{
+	const NameSlice *slice = key;
+	const gchar *name = *((const gchar * const *) elem);
+	gint res;
+
+	res = strncmp (slice->str, name, slice->len);
+	if (!res && name[slice->len])
+		res = -1;
+
+	return res;
+}
+
+static const gchar *
+lookup_known_attr_name (const gchar *str,
+                        gsize len)
+{
+	const gchar * const *found;
+	NameSlice slice;
+
+	slice.str = str;
+	slice.len = len;
+
+	found = bsearch (
+		&slice, known_attr_names, G_N_ELEMENTS (known_attr_names),
+		sizeof (known_attr_names[0]), compare_name_slice);
+
+	return found ? *found : NULL;
+}
+
+/* Case insensitive hash for the attr_index */
+static guint
+attr_name_hash (gconstpointer key)
+{
+	const gchar *p;
+	guint hash = 5381;
+
+	for (p = key; *p; p++)
+		hash = (hash << 5) + hash + g_ascii_toupper (*p);
+
+	return hash;
+}
+
+static gboolean
+attr_name_equal (gconstpointer a,
+                 gconstpointer b)
+{
+	return g_ascii_strcasecmp (a, b) == 0;
+}
+
+static void
+e_vcard_drop_attr_index (EVCard *evc)
+{
+	if (evc->priv->attr_index) {
+		g_hash_table_destroy (evc->priv->attr_index);
+		evc->priv->attr_index = NULL;
+	}
+}
+
 static void
 vcard_finalize (GObject *object)
 {
@@ -164,6 +252,9 @@ vcard_finalize (GObject *object)
 
 	g_free (priv->vcard);
 
+	if (priv->attr_index)
+		g_hash_table_destroy (priv->attr_index);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_vcard_parent_class)->finalize (object);
 }
@@ -326,6 +417,7 @@ read_attribute_value (EVCardAttribute *attr,
 {
 	gchar *lp = *p;
 	GString *str;
+	GList *values = NULL;
 
 	/* read in the value */
 	str = g_string_new ("");
@@ -408,8 +500,8 @@ read_attribute_value (EVCardAttribute *attr,
 				}
 			}
 
-			e_vcard_attribute_add_value (attr, str->str);
-			g_string_assign (str, "");
+			values = g_list_prepend (values, g_strdup (str->str));
+			g_string_truncate (str, 0);
 			lp = g_utf8_next_char (lp);
 		}
 		else {
@@ -428,10 +520,13 @@ read_attribute_value (EVCardAttribute *attr,
 			}
 		}
 
-		e_vcard_attribute_add_value (attr, str->str);
+		values = g_list_prepend (values, g_strdup (str->str));
 		g_string_free (str, TRUE);
 	}
 
+	/* Prepending and reversing once is cheaper than appending each value */
+	attr->values = g_list_concat (attr->values, g_list_reverse (values));
+
 	skip_to_next_line ( &lp );
 
 	*p = lp;
@@ -602,6 +697,42 @@ read_attribute_params (EVCardAttribute *attr,
 	*p = lp;
 }
 
+/* reads an unfolded ASCII "[group.]name" directly from the input buffer,
+ * which is what nearly all attributes start with, leaving p pointing at
+ * the following ':' or ';'. Returns NULL for anything else, which is
+ * then handled by the generic code in read_attribute(). */
+static EVCardAttribute *
+read_attribute_name_fast (gchar **p)
+{
+	EVCardAttribute *attr;
+	gchar *lp, *dot = NULL, *name;
+
+	for (lp = *p; g_ascii_isalnum (*lp) || *lp == '-' || *lp == '_' || (*lp == '.' && !dot); lp++) {
+		if (*lp == '.')
+			dot = lp;
+	}
+
+	if ((*lp != ':' && *lp != ';') || lp == *p || dot == *p || (dot && dot + 1 == lp))
+		return NULL;
+
+	name = dot ? dot + 1 : *p;
+
+	attr = g_slice_new0 (EVCardAttribute);
+
+	if (dot)
+		attr->group = g_strndup (*p, dot - *p);
+
+	attr->name = (gchar *) lookup_known_attr_name (name, lp - name);
+	if (attr->name)
+		attr->name_interned = TRUE;
+	else
+		attr->name = g_strndup (name, lp - name);
+
+	*p = lp;
+
+	return attr;
+}
+
 /* reads an entire attribute from the input buffer, leaving p pointing
  * at the start of the next line (past the \r\n) */
 static EVCardAttribute *
@@ -615,6 +746,11 @@ read_attribute (gchar **p)
 	gboolean is_qp = FALSE;
 	gchar *charset = NULL;
 
+	lp = *p;
+	attr = read_attribute_name_fast (&lp);
+	if (attr)
+		goto read_params;
+
 	/* first read in the group/name */
 	str = g_string_new ("");
 	for (lp = skip_newline ( *p, is_qp);
@@ -677,6 +813,7 @@ read_attribute (gchar **p)
 	g_free (attr_group);
 	g_free (attr_name);
 
+ read_params:
 	if (*lp == ';') {
 		/* skip past the ';' */
 		lp = g_utf8_next_char (lp);
@@ -704,7 +841,8 @@ read_attribute (gchar **p)
 	return NULL;
 }
 
-/* Stolen from glib/glib/gconvert.c */
+/* Stolen from glib/glib/gconvert.c; returns NULL when the @name
+ * is a valid UTF-8 already, to avoid copying it */
 static gchar *
 make_valid_utf8 (const gchar *name)
 {
@@ -733,7 +871,7 @@ make_valid_utf8 (const gchar *name)
 	}
 
 	if (string == NULL)
-		return g_strdup (name);
+		return NULL;
 
 	g_string_append (string, remainder);
 
@@ -760,9 +898,12 @@ parse (EVCard *evc,
 	d (printf ("BEFORE FOLDING:\n"));
 	d (printf (str));
 	d (printf ("\n\nAFTER FOLDING:\n"));
-	d (printf (buf));
+	d (printf (buf ? buf : str));
+
+	/* The parser only reads the buffer, thus a valid input can be used directly */
+	p = buf ? buf : (gchar *) str;
 
-	p = buf;
+	e_vcard_drop_attr_index (evc);
 
 	attr = read_attribute (&p);
 	if (!attr || attr->group || g_ascii_strcasecmp (attr->name, "begin")) {
@@ -1573,7 +1714,8 @@ e_vcard_attribute_free (EVCardAttribute *attr)
 	g_return_if_fail (attr != NULL);
 
 	g_free (attr->group);
-	g_free (attr->name);
+	if (!attr->name_interned)
+		g_free (attr->name);
 
 	e_vcard_attribute_remove_values (attr);
 
@@ -1663,6 +1805,8 @@ e_vcard_remove_attributes (EVCard *evc,
 			/* matches, remove/delete the attribute */
 			evc->priv->attributes = g_list_delete_link (evc->priv->attributes, attr);
 
+			e_vcard_drop_attr_index (evc);
+
 			e_vcard_attribute_free (a);
 		}
 
@@ -1688,6 +1832,11 @@ e_vcard_remove_attribute (EVCard *evc,
 	 * already been called if this is a valid call and attr is among
 	 * our attributes. */
 	evc->priv->attributes = g_list_remove (evc->priv->attributes, attr);
+
+	if (evc->priv->attr_index && attr->name &&
+	    g_hash_table_lookup (evc->priv->attr_index, attr->name) == attr)
+		e_vcard_drop_attr_index (evc);
+
 	e_vcard_attribute_free (attr);
 }
 
@@ -1716,6 +1865,10 @@ e_vcard_append_attribute (EVCard *evc,
 	} else {
 		evc->priv->attributes = g_list_append (e_vcard_ensure_attributes (evc), attr);
 	}
+
+	if (evc->priv->attr_index && attr->name &&
+	    !g_hash_table_contains (evc->priv->attr_index, attr->name))
+		g_hash_table_insert (evc->priv->attr_index, attr->name, attr);
 }
 
 /**
@@ -1803,6 +1956,10 @@ e_vcard_add_attribute (EVCard *evc,
 	} else {
 		evc->priv->attributes = g_list_prepend (e_vcard_ensure_attributes (evc), attr);
 	}
+
+	/* The key is replaced too, the previous attribute can be freed meanwhile */
+	if (evc->priv->attr_index && attr->name)
+		g_hash_table_replace (evc->priv->attr_index, attr->name, attr);
 }
 
 /**
@@ -2440,10 +2597,8 @@ e_vcard_get_attributes (EVCard *evcard)
  * other <code>TEL</code> attributes if a contact has multiple telephone
  * numbers), use e_vcard_get_attributes() and iterate over the list searching
  * for matching attributes.</para>
- * <para>This method iterates over all attributes in the #EVCard, so should not
- * be called often. If extracting a large number of attributes from a vCard, it
- * is more efficient to iterate once over the list returned by
- * e_vcard_get_attributes().</para></note>
+ * <para>The first call indexes the attributes of the parsed @evc by their name,
+ * thus the subsequent calls do not iterate over all of them.</para></note>
  *
  * Returns: (transfer none) (allow-none): An #EVCardAttribute if found, or %NULL.
  **/
@@ -2467,13 +2622,18 @@ e_vcard_get_attribute (EVCard *evc,
 	}
 
 	attrs = e_vcard_ensure_attributes (evc);
-	for (l = attrs; l; l = l->next) {
-		attr = (EVCardAttribute *) l->data;
-		if (g_ascii_strcasecmp (attr->name, name) == 0)
-			return attr;
+
+	if (!evc->priv->attr_index) {
+		evc->priv->attr_index = g_hash_table_new (attr_name_hash, attr_name_equal);
+
+		for (l = attrs; l; l = l->next) {
+			attr = (EVCardAttribute *) l->data;
+			if (attr->name && !g_hash_table_contains (evc->priv->attr_index, attr->name))
+				g_hash_table_insert (evc->priv->attr_index, attr->name, attr);
+		}
 	}
 
-	return NULL;
+	return g_hash_table_lookup (evc->priv->attr_index, name);
 }
 
 /**
@@ -2498,6 +2658,9 @@ e_vcard_get_attribute_if_parsed (EVCard *evc,
 	g_return_val_if_fail (E_IS_VCARD (evc), NULL);
 	g_return_val_if_fail (name != NULL, NULL);
 
+	if (evc->priv->attr_index)
+		return g_hash_table_lookup (evc->priv->attr_index, name);
+
 	for (l = evc->priv->attributes; l != NULL; l = l->next) {
 		attr = (EVCardAttribute *) l->data;
 		if (g_ascii_strcasecmp (attr->name, name) == 0)
@@ -82,6 +82,16 @@ struct _AsyncContext {
 	gchar *sexp;
 	gchar *uid;
 	GMainContext *context;
+	EBookClientContactIter *contact_iter;
+	EBookClientContactIter *read_iter; /* not owned */
+	guint max_contacts;
+};
+
+struct _EBookClientContactIter {
+	EBookClient *client;
+	GInputStream *stream;	/* NULL for the direct backend */
+	GSList *contacts;	/* pending contacts from the direct backend */
+	gboolean finished;
 };
 
 struct _SignalClosure {
@@ -156,6 +166,9 @@ async_context_free (AsyncContext *async_context)
 	g_free (async_context->sexp);
 	g_free (async_context->uid);
 
+	if (async_context->contact_iter != NULL)
+		e_book_client_contact_iter_free (async_context->contact_iter);
+
 	g_slice_free (AsyncContext, async_context);
 }
 
@@ -3616,6 +3629,448 @@ e_book_client_get_contacts_sync (EBookClient *client,
 	return TRUE;
 }
 
+/* Helper for e_book_client_get_contacts_iter() */
+static void
+book_client_get_contacts_iter_thread (GSimpleAsyncResult *simple,
+                                      GObject *source_object,
+                                      GCancellable *cancellable)
+{
+	AsyncContext *async_context;
+	GError *local_error = NULL;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (!e_book_client_get_contacts_iter_sync (
+		E_BOOK_CLIENT (source_object),
+		async_context->sexp,
+		&async_context->contact_iter,
+		cancellable, &local_error)) {
+
+		if (!local_error)
+			local_error = g_error_new_literal (
+				E_CLIENT_ERROR,
+				E_CLIENT_ERROR_OTHER_ERROR,
+				_("Unknown error"));
+	}
+
+	if (local_error != NULL)
+		g_simple_async_result_take_error (simple, local_error);
+}
+
+/**
+ * e_book_client_get_contacts_iter:
+ * @client: an #EBookClient
+ * @sexp: an S-expression representing the query
+ * @cancellable: a #GCancellable; can be %NULL
+ * @callback: callback to call when a result is ready
+ * @user_data: user data for the @callback
+ *
+ * Query @client with @sexp, receiving an iterator over the contacts which
+ * matched. Unlike e_book_client_get_contacts(), the contacts are not
+ * transferred in one piece, but they are streamed from the backend and
+ * read in chunks with e_book_client_contact_iter_next(), which is suitable
+ * for large results. The call is finished
+ * by e_book_client_get_contacts_iter_finish() from the @callback.
+ *
+ * Note: @sexp can be obtained through #EBookQuery, by converting it
+ * to a string with e_book_query_to_string().
+ *
+ * Since: 3.28
+ **/
+void
+e_book_client_get_contacts_iter (EBookClient *client,
+                                 const gchar *sexp,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_if_fail (E_IS_BOOK_CLIENT (client));
+	g_return_if_fail (sexp != NULL);
+
+	async_context = g_slice_new0 (AsyncContext);
+	async_context->sexp = g_strdup (sexp);
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (client), callback, user_data,
+		e_book_client_get_contacts_iter);
+
+	g_simple_async_result_set_check_cancellable (simple, cancellable);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, async_context, (GDestroyNotify) async_context_free);
+
+	g_simple_async_result_run_in_thread (
+		simple, book_client_get_contacts_iter_thread,
+		G_PRIORITY_DEFAULT, cancellable);
+
+	g_object_unref (simple);
+}
+
+/**
+ * e_book_client_get_contacts_iter_finish:
+ * @client: an #EBookClient
+ * @result: a #GAsyncResult
+ * @out_iter: (out) (transfer full): an #EBookClientContactIter
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Finishes previous call of e_book_client_get_contacts_iter().
+ * If successful, then the @out_iter is set to a new #EBookClientContactIter,
+ * which should be freed with e_book_client_contact_iter_free().
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_book_client_get_contacts_iter_finish (EBookClient *client,
+                                        GAsyncResult *result,
+                                        EBookClientContactIter **out_iter,
+                                        GError **error)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_val_if_fail (
+		g_simple_async_result_is_valid (
+		result, G_OBJECT (client),
+		e_book_client_get_contacts_iter), FALSE);
+	g_return_val_if_fail (out_iter != NULL, FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	*out_iter = async_context->contact_iter;
+	async_context->contact_iter = NULL;
+
+	return TRUE;
+}
+
+#ifndef G_OS_WIN32
+/* Helper for e_book_client_get_contacts_iter_sync() */
+static gboolean
+book_client_get_contacts_iter_stream_sync (EBookClient *client,
+                                           const gchar *sexp,
+                                           EBookClientContactIter **out_iter,
+                                           GCancellable *cancellable,
+                                           GError **error)
+{
+	EBookClientContactIter *iter;
+	GUnixFDList *fd_list = NULL;
+	GInputStream *stream;
+	gchar *utf8_sexp;
+	gint handle = -1;
+	GError *local_error = NULL;
+
+	utf8_sexp = e_util_utf8_make_valid (sexp);
+
+	e_dbus_address_book_call_get_contact_list_stream_sync (
+		client->priv->dbus_proxy, utf8_sexp, NULL,
+		&handle, &fd_list, cancellable, &local_error);
+
+	g_free (utf8_sexp);
+
+	if (local_error != NULL) {
+		g_dbus_error_strip_remote_error (local_error);
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	stream = e_client_stream_new_reader (fd_list, handle, error);
+
+	g_clear_object (&fd_list);
+
+	if (!stream)
+		return FALSE;
+
+	iter = g_slice_new0 (EBookClientContactIter);
+	iter->client = g_object_ref (client);
+	iter->stream = stream;
+
+	*out_iter = iter;
+
+	return TRUE;
+}
+#endif /* G_OS_WIN32 */
+
+/**
+ * e_book_client_get_contacts_iter_sync:
+ * @client: an #EBookClient
+ * @sexp: an S-expression representing the query
+ * @out_iter: (out) (transfer full): an #EBookClientContactIter
+ * @cancellable: a #GCancellable; can be %NULL
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Query @client with @sexp, receiving an iterator over the contacts which
+ * matched. Unlike e_book_client_get_contacts_sync(), the contacts are not
+ * transferred in one piece, but they are streamed from the backend and
+ * read in chunks with e_book_client_contact_iter_next_sync(), which is
+ * suitable for large results. The backend itself still gathers the whole
+ * result first, thus only the client side and the transfer are spared
+ * of it. If successful, then the @out_iter is set to a new
+ * #EBookClientContactIter, which should be freed
+ * with e_book_client_contact_iter_free().
+ *
+ * Note: @sexp can be obtained through #EBookQuery, by converting it
+ * to a string with e_book_query_to_string().
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_book_client_get_contacts_iter_sync (EBookClient *client,
+                                      const gchar *sexp,
+                                      EBookClientContactIter **out_iter,
+                                      GCancellable *cancellable,
+                                      GError **error)
+{
+	EBookClientContactIter *iter;
+	GSList *contacts = NULL;
+
+	g_return_val_if_fail (E_IS_BOOK_CLIENT (client), FALSE);
+	g_return_val_if_fail (sexp != NULL, FALSE);
+	g_return_val_if_fail (out_iter != NULL, FALSE);
+
+#ifndef G_OS_WIN32
+	if (client->priv->direct_backend == NULL)
+		return book_client_get_contacts_iter_stream_sync (client, sexp, out_iter, cancellable, error);
+#endif
+
+	/* Direct read access does not involve D-Bus, thus the whole result
+	 * can be read in one call; it is read in one call on Windows too,
+	 * where the stream cannot be passed over D-Bus. */
+	if (!e_book_client_get_contacts_sync (client, sexp, &contacts, cancellable, error))
+		return FALSE;
+
+	iter = g_slice_new0 (EBookClientContactIter);
+	iter->client = g_object_ref (client);
+	iter->contacts = contacts;
+
+	*out_iter = iter;
+
+	return TRUE;
+}
+
+/* Helper for e_book_client_contact_iter_next() */
+static void
+book_client_contact_iter_next_thread (GSimpleAsyncResult *simple,
+                                      GObject *source_object,
+                                      GCancellable *cancellable)
+{
+	AsyncContext *async_context;
+	GError *local_error = NULL;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (!e_book_client_contact_iter_next_sync (
+		async_context->read_iter,
+		async_context->max_contacts,
+		&async_context->object_list,
+		cancellable, &local_error)) {
+
+		if (!local_error)
+			local_error = g_error_new_literal (
+				E_CLIENT_ERROR,
+				E_CLIENT_ERROR_OTHER_ERROR,
+				_("Unknown error"));
+	}
+
+	if (local_error != NULL)
+		g_simple_async_result_take_error (simple, local_error);
+}
+
+/**
+ * e_book_client_contact_iter_next:
+ * @iter: an #EBookClientContactIter
+ * @max_contacts: the most contacts to read in one call, greater than zero
+ * @cancellable: a #GCancellable; can be %NULL
+ * @callback: callback to call when a result is ready
+ * @user_data: user data for the @callback
+ *
+ * Reads the next chunk of up to @max_contacts contacts from the @iter.
+ * The call is finished by e_book_client_contact_iter_next_finish()
+ * from the @callback. Only one read can be pending on the @iter
+ * at any time.
+ *
+ * Since: 3.28
+ **/
+void
+e_book_client_contact_iter_next (EBookClientContactIter *iter,
+                                 guint max_contacts,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (max_contacts > 0);
+
+	async_context = g_slice_new0 (AsyncContext);
+	async_context->read_iter = iter;
+	async_context->max_contacts = max_contacts;
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (iter->client), callback, user_data,
+		e_book_client_contact_iter_next);
+
+	g_simple_async_result_set_check_cancellable (simple, cancellable);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, async_context, (GDestroyNotify) async_context_free);
+
+	g_simple_async_result_run_in_thread (
+		simple, book_client_contact_iter_next_thread,
+		G_PRIORITY_DEFAULT, cancellable);
+
+	g_object_unref (simple);
+}
+
+/**
+ * e_book_client_contact_iter_next_finish:
+ * @iter: an #EBookClientContactIter
+ * @result: a #GAsyncResult
+ * @out_contacts: (element-type EContact) (out) (transfer full): a #GSList
+ *                of read #EContact(s)
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Finishes previous call of e_book_client_contact_iter_next().
+ * If successful, then the @out_contacts is set to newly allocated list of
+ * #EContact(s), which should be freed with e_client_util_free_object_slist().
+ * The @out_contacts is set to %NULL when all contacts had been read.
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_book_client_contact_iter_next_finish (EBookClientContactIter *iter,
+                                        GAsyncResult *result,
+                                        GSList **out_contacts,
+                                        GError **error)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (
+		g_simple_async_result_is_valid (
+		result, G_OBJECT (iter->client),
+		e_book_client_contact_iter_next), FALSE);
+	g_return_val_if_fail (out_contacts != NULL, FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	*out_contacts = async_context->object_list;
+	async_context->object_list = NULL;
+
+	return TRUE;
+}
+
+/**
+ * e_book_client_contact_iter_next_sync:
+ * @iter: an #EBookClientContactIter
+ * @max_contacts: the most contacts to read in one call, greater than zero
+ * @out_contacts: (element-type EContact) (out) (transfer full): a #GSList
+ *                of read #EContact(s)
+ * @cancellable: a #GCancellable; can be %NULL
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Reads the next chunk of up to @max_contacts contacts from the @iter.
+ * If successful, then the @out_contacts is set to newly allocated list of
+ * #EContact(s), which should be freed with e_client_util_free_object_slist().
+ * The @out_contacts is set to %NULL when all contacts had been read.
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_book_client_contact_iter_next_sync (EBookClientContactIter *iter,
+                                      guint max_contacts,
+                                      GSList **out_contacts,
+                                      GCancellable *cancellable,
+                                      GError **error)
+{
+	GSList *tmp = NULL;
+	guint n_read = 0;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (max_contacts > 0, FALSE);
+	g_return_val_if_fail (out_contacts != NULL, FALSE);
+
+	*out_contacts = NULL;
+
+	if (!iter->stream) {
+		while (iter->contacts && n_read < max_contacts) {
+			tmp = g_slist_prepend (tmp, iter->contacts->data);
+			iter->contacts = g_slist_delete_link (iter->contacts, iter->contacts);
+			n_read++;
+		}
+
+		*out_contacts = g_slist_reverse (tmp);
+
+		return TRUE;
+	}
+
+	while (!iter->finished && n_read < max_contacts) {
+		gchar *vcard = NULL;
+
+		if (!e_client_stream_read_record (iter->stream, &vcard, cancellable, error)) {
+			g_slist_free_full (tmp, g_object_unref);
+			return FALSE;
+		}
+
+		if (!vcard) {
+			iter->finished = TRUE;
+			break;
+		}
+
+		tmp = g_slist_prepend (tmp, e_contact_new_from_vcard (vcard));
+		n_read++;
+
+		g_free (vcard);
+	}
+
+	*out_contacts = g_slist_reverse (tmp);
+
+	return TRUE;
+}
+
+/**
+ * e_book_client_contact_iter_free:
+ * @iter: (nullable): an #EBookClientContactIter
+ *
+ * Frees the @iter. Any contacts not read yet are discarded.
+ *
+ * Since: 3.28
+ **/
+void
+e_book_client_contact_iter_free (EBookClientContactIter *iter)
+{
+	if (!iter)
+		return;
+
+	if (iter->stream)
+		g_input_stream_close (iter->stream, NULL, NULL);
+
+	g_clear_object (&iter->stream);
+	g_slist_free_full (iter->contacts, g_object_unref);
+	g_object_unref (iter->client);
+	g_slice_free (EBookClientContactIter, iter);
+}
+
 /* Helper for e_book_client_get_contacts_uids() */
 static void
 book_client_get_contacts_uids_thread (GSimpleAsyncResult *simple,
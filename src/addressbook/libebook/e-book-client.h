@@ -100,6 +100,16 @@ struct _EBookClientClass {
 	EClientClass parent_class;
 };
 
+/**
+ * EBookClientContactIter:
+ *
+ * An opaque iterator over contacts streamed from the backend, created by
+ * e_book_client_get_contacts_iter() and freed by e_book_client_contact_iter_free().
+ *
+ * Since: 3.28
+ **/
+typedef struct _EBookClientContactIter EBookClientContactIter;
+
 GType		e_book_client_get_type		(void) G_GNUC_CONST;
 EClient *	e_book_client_connect_sync	(ESource *source,
 						 guint32 wait_for_connected_seconds,
@@ -265,6 +275,39 @@ gboolean	e_book_client_get_contacts_sync	(EBookClient *client,
 						 GSList **out_contacts,
 						 GCancellable *cancellable,
 						 GError **error);
+void		e_book_client_get_contacts_iter	(EBookClient *client,
+						 const gchar *sexp,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_book_client_get_contacts_iter_finish
+						(EBookClient *client,
+						 GAsyncResult *result,
+						 EBookClientContactIter **out_iter,
+						 GError **error);
+gboolean	e_book_client_get_contacts_iter_sync
+						(EBookClient *client,
+						 const gchar *sexp,
+						 EBookClientContactIter **out_iter,
+						 GCancellable *cancellable,
+						 GError **error);
+void		e_book_client_contact_iter_next	(EBookClientContactIter *iter,
+						 guint max_contacts,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_book_client_contact_iter_next_finish
+						(EBookClientContactIter *iter,
+						 GAsyncResult *result,
+						 GSList **out_contacts,
+						 GError **error);
+gboolean	e_book_client_contact_iter_next_sync
+						(EBookClientContactIter *iter,
+						 guint max_contacts,
+						 GSList **out_contacts,
+						 GCancellable *cancellable,
+						 GError **error);
+void		e_book_client_contact_iter_free	(EBookClientContactIter *iter);
 void		e_book_client_get_contacts_uids	(EBookClient *client,
 						 const gchar *sexp,
 						 GCancellable *cancellable,
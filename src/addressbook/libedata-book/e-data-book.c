@@ -35,6 +35,7 @@
 /* Private D-Bus classes. */
 #include <e-dbus-address-book.h>
 
+#include <libedataserver/e-client-private.h>
 #include <libebook-contacts/libebook-contacts.h>
 
 #include "e-data-book-factory.h"
@@ -49,6 +50,7 @@
 	((obj), E_TYPE_DATA_BOOK, EDataBookPrivate))
 
 typedef struct _AsyncContext AsyncContext;
+typedef struct _StreamContext StreamContext;
 
 struct _EDataBookPrivate {
 	GDBusConnection *connection;
@@ -71,6 +73,12 @@ struct _AsyncContext {
 	guint watcher_id;
 };
 
+struct _StreamContext {
+	AsyncContext *async_context;
+	GOutputStream *stream;
+	GQueue contacts;
+};
+
 enum {
 	PROP_0,
 	PROP_BACKEND,
@@ -889,6 +897,152 @@ data_book_handle_get_contact_list_cb (EDBusAddressBook *dbus_interface,
 	return TRUE;
 }
 
+#ifndef G_OS_WIN32
+/* File descriptors cannot be passed over D-Bus on Windows */
+static gpointer
+data_book_write_contact_list_stream_thread (gpointer user_data)
+{
+	StreamContext *stream_context = user_data;
+	GCancellable *cancellable;
+	GError *local_error = NULL;
+	gboolean success = TRUE;
+
+	cancellable = stream_context->async_context->cancellable;
+
+	while (!g_queue_is_empty (&stream_context->contacts)) {
+		EContact *contact;
+
+		contact = g_queue_pop_head (&stream_context->contacts);
+
+		if (success) {
+			gchar *vcard;
+			gchar *utf8_vcard;
+
+			vcard = e_vcard_to_string (
+				E_VCARD (contact),
+				EVC_FORMAT_VCARD_30);
+			utf8_vcard = e_util_utf8_make_valid (vcard);
+
+			if (utf8_vcard && *utf8_vcard) {
+				success = e_client_stream_write_record (
+					stream_context->stream, utf8_vcard,
+					cancellable, &local_error);
+			}
+
+			g_free (utf8_vcard);
+			g_free (vcard);
+		}
+
+		g_object_unref (contact);
+	}
+
+	if (success) {
+		success = e_client_stream_write_record (
+			stream_context->stream, NULL,
+			cancellable, &local_error);
+	}
+
+	/* The client cannot be notified about the error anymore, it will
+	 * only see the stream ended without the end-of-stream marker. The
+	 * reader going away is fine, the client freed its iterator early. */
+	if (!success &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE))
+		g_warning ("%s: Failed to write contact list stream: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+
+	g_clear_error (&local_error);
+
+	g_output_stream_close (stream_context->stream, NULL, NULL);
+	g_object_unref (stream_context->stream);
+	async_context_free (stream_context->async_context);
+	g_slice_free (StreamContext, stream_context);
+
+	return NULL;
+}
+
+static void
+data_book_complete_get_contact_list_stream_cb (GObject *source_object,
+                                               GAsyncResult *result,
+                                               gpointer user_data)
+{
+	AsyncContext *async_context = user_data;
+	GQueue queue = G_QUEUE_INIT;
+	GError *error = NULL;
+
+	e_book_backend_get_contact_list_finish (
+		E_BOOK_BACKEND (source_object), result, &queue, &error);
+
+	if (error == NULL) {
+		GUnixFDList *fd_list = NULL;
+		GOutputStream *stream;
+
+		stream = e_client_stream_new_writer (&fd_list, &error);
+
+		if (stream) {
+			StreamContext *stream_context;
+			GThread *thread;
+
+			e_dbus_address_book_complete_get_contact_list_stream (
+				async_context->dbus_interface,
+				async_context->invocation,
+				fd_list,
+				0);
+
+			g_object_unref (fd_list);
+
+			/* Serialize the contacts in a dedicated thread, thus
+			 * the client can parse the beginning of the result
+			 * while the rest of it is still being written. The
+			 * backend has the whole list ready at this point,
+			 * only the transfer to the client is streamed. */
+			stream_context = g_slice_new0 (StreamContext);
+			stream_context->async_context = async_context;
+			stream_context->stream = stream;
+			stream_context->contacts = queue;
+
+			thread = g_thread_new (NULL, data_book_write_contact_list_stream_thread, stream_context);
+			g_thread_unref (thread);
+
+			return;
+		}
+
+		g_queue_free_full (&queue, (GDestroyNotify) g_object_unref);
+	}
+
+	data_book_convert_to_client_error (error);
+	g_dbus_method_invocation_take_error (
+		async_context->invocation, error);
+
+	async_context_free (async_context);
+}
+
+static gboolean
+data_book_handle_get_contact_list_stream_cb (EDBusAddressBook *dbus_interface,
+                                             GDBusMethodInvocation *invocation,
+                                             GUnixFDList *fd_list,
+                                             const gchar *in_query,
+                                             EDataBook *data_book)
+{
+	EBookBackend *backend;
+	AsyncContext *async_context;
+
+	backend = e_data_book_ref_backend (data_book);
+	g_return_val_if_fail (backend != NULL, FALSE);
+
+	async_context = async_context_new (data_book, invocation);
+
+	e_book_backend_get_contact_list (
+		backend, in_query,
+		async_context->cancellable,
+		data_book_complete_get_contact_list_stream_cb,
+		async_context);
+
+	g_object_unref (backend);
+
+	return TRUE;
+}
+#endif /* G_OS_WIN32 */
+
 static void
 data_book_complete_get_contact_list_uids_cb (GObject *source_object,
                                              GAsyncResult *result,
@@ -2213,6 +2367,12 @@ e_data_book_init (EDataBook *data_book)
 		dbus_interface, "handle-get-contact-list",
 		G_CALLBACK (data_book_handle_get_contact_list_cb),
 		data_book);
+#ifndef G_OS_WIN32
+	g_signal_connect (
+		dbus_interface, "handle-get-contact-list-stream",
+		G_CALLBACK (data_book_handle_get_contact_list_stream_cb),
+		data_book);
+#endif
 	g_signal_connect (
 		dbus_interface, "handle-get-contact-list-uids",
 		G_CALLBACK (data_book_handle_get_contact_list_uids_cb),
@@ -50,6 +50,14 @@ typedef enum
 	CAL_MINUTES
 } CalUnits;
 
+/* Tracked contacts are indexed by the month and day of their birthday
+ * and anniversary, so queries over a time window visit only those, whose
+ * yearly recurrence can fall into it. Dates without a valid month and
+ * day are kept in an extra slot, which is visited always. */
+#define DAY_SLOTS		(12 * 31)
+#define DAY_SLOT_UNKNOWN	DAY_SLOTS
+#define DAY_SLOT_FEB_29		(31 + 28)
+
 /* Private part of the ECalBackendContacts structure */
 struct _ECalBackendContactsPrivate {
 
@@ -59,6 +67,7 @@ struct _ECalBackendContactsPrivate {
 
 	EBookClientView *book_view;
 	GHashTable *tracked_contacts;	/* UID -> ContactRecord */
+	GHashTable *day_index[DAY_SLOTS + 1]; /* ContactRecord -> NULL, guarded by tracked_contacts_lock */
 	GRecMutex tracked_contacts_lock;
 
 	/* properties related to track alarm settings for this backend */
@@ -88,6 +97,7 @@ typedef struct _ContactRecord {
 	EBookClient *book_client; /* where it comes from */
 	EContact	    *contact;
 	ECalComponent       *comp_birthday, *comp_anniversary;
+	gint birthday_slot, anniversary_slot; /* -1 when not indexed */
 } ContactRecord;
 
 #define d(x)
@@ -407,6 +417,55 @@ book_client_connected_cb (GObject *source_object,
 	g_object_unref (client);
 }
 
+static gint
+contact_date_to_day_slot (EContactDate *cdate)
+{
+	if (!cdate || cdate->month < 1 || cdate->month > 12 ||
+	    cdate->day < 1 || cdate->day > 31)
+		return DAY_SLOT_UNKNOWN;
+
+	return (cdate->month - 1) * 31 + cdate->day - 1;
+}
+
+static gint
+contact_get_day_slot (EContact *contact,
+                      EContactField field_id)
+{
+	EContactDate *cdate;
+	gint slot;
+
+	cdate = e_contact_get (contact, field_id);
+	slot = contact_date_to_day_slot (cdate);
+	e_contact_date_free (cdate);
+
+	return slot;
+}
+
+static void
+day_index_add (ECalBackendContacts *cbc,
+               gint slot,
+               ContactRecord *cr)
+{
+	if (slot < 0)
+		return;
+
+	if (!cbc->priv->day_index[slot])
+		cbc->priv->day_index[slot] = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_hash_table_add (cbc->priv->day_index[slot], cr);
+}
+
+static void
+day_index_remove (ECalBackendContacts *cbc,
+                  gint slot,
+                  ContactRecord *cr)
+{
+	if (slot < 0 || !cbc->priv->day_index[slot])
+		return;
+
+	g_hash_table_remove (cbc->priv->day_index[slot], cr);
+}
+
 /* ContactRecord methods */
 static ContactRecord *
 contact_record_new (ECalBackendContacts *cbc,
@@ -420,6 +479,11 @@ contact_record_new (ECalBackendContacts *cbc,
 	cr->contact = contact;
 	cr->comp_birthday = create_birthday (cbc, contact);
 	cr->comp_anniversary = create_anniversary (cbc, contact);
+	cr->birthday_slot = cr->comp_birthday ? contact_get_day_slot (contact, E_CONTACT_BIRTH_DATE) : -1;
+	cr->anniversary_slot = cr->comp_anniversary ? contact_get_day_slot (contact, E_CONTACT_ANNIVERSARY) : -1;
+
+	day_index_add (cbc, cr->birthday_slot, cr);
+	day_index_add (cbc, cr->anniversary_slot, cr);
 
 	if (cr->comp_birthday)
 		e_cal_backend_notify_component_created (E_CAL_BACKEND (cbc), cr->comp_birthday);
@@ -437,6 +501,9 @@ contact_record_free (ContactRecord *cr)
 {
 	ECalComponentId *id;
 
+	day_index_remove (cr->cbc, cr->birthday_slot, cr);
+	day_index_remove (cr->cbc, cr->anniversary_slot, cr);
+
 	g_object_unref (G_OBJECT (cr->contact));
 
 	/* Remove the birthday event */
@@ -528,6 +595,109 @@ contact_record_cb (gpointer key,
 	}
 }
 
+/* Marks in @slots the month/day slots of all days between @start and @end,
+ * with one day of slack on both sides for the time zone differences of
+ * the floating all-day events. Returns FALSE, when the window is unbounded
+ * or covers a whole year, thus when all the contacts should be visited. */
+static gboolean
+contact_record_mark_day_slots (time_t start,
+                               time_t end,
+                               gboolean *slots)
+{
+	icaltimezone *utc_zone;
+	struct icaltimetype itt, itt_end;
+
+	if (start == (time_t) -1 || end == (time_t) -1 || end < start ||
+	    end - start >= 365 * 24 * 60 * 60)
+		return FALSE;
+
+	utc_zone = icaltimezone_get_utc_timezone ();
+
+	itt = icaltime_from_timet_with_zone (start, TRUE, utc_zone);
+	icaltime_adjust (&itt, -1, 0, 0, 0);
+
+	itt_end = icaltime_from_timet_with_zone (end, TRUE, utc_zone);
+	icaltime_adjust (&itt_end, 1, 0, 0, 0);
+
+	while (icaltime_compare_date_only (itt, itt_end) <= 0) {
+		slots[(itt.month - 1) * 31 + itt.day - 1] = TRUE;
+
+		/* Yearly recurrences of February 29th move in non-leap years */
+		if ((itt.month == 2 && itt.day == 28) ||
+		    (itt.month == 3 && itt.day == 1))
+			slots[DAY_SLOT_FEB_29] = TRUE;
+
+		icaltime_adjust (&itt, 1, 0, 0, 0);
+	}
+
+	slots[DAY_SLOT_UNKNOWN] = TRUE;
+
+	return TRUE;
+}
+
+/* Calls contact_record_cb() for the tracked contacts, which can match
+ * the @cb_data's sexp; with a bounded time window in the sexp only for
+ * those with a birthday or an anniversary in it. The caller holds
+ * the tracked_contacts_lock. */
+static void
+contact_record_foreach_in_sexp (ECalBackendContacts *cbc,
+                                ContactRecordCB *cb_data)
+{
+	gboolean slots[DAY_SLOTS + 1] = { FALSE };
+	GHashTable *visited;
+	time_t occur_start = -1, occur_end = -1;
+	gint ii;
+
+	if (!e_cal_backend_sexp_evaluate_occur_times (cb_data->sexp, &occur_start, &occur_end)) {
+		g_hash_table_foreach (cbc->priv->tracked_contacts, contact_record_cb, cb_data);
+		return;
+	}
+
+	/* The window of "has-alarms-in-range?" is the one of the alarms,
+	 * which go off the alarm interval before the occurrences */
+	if (cbc->priv->alarm_enabled && cbc->priv->alarm_interval > 0 && occur_end != (time_t) -1) {
+		switch (cbc->priv->alarm_units) {
+		case CAL_MINUTES:
+			occur_end += cbc->priv->alarm_interval * 60;
+			break;
+		case CAL_HOURS:
+			occur_end += cbc->priv->alarm_interval * 60 * 60;
+			break;
+		case CAL_DAYS:
+		default:
+			occur_end += cbc->priv->alarm_interval * 24 * 60 * 60;
+			break;
+		}
+	}
+
+	if (!contact_record_mark_day_slots (occur_start, occur_end, slots)) {
+		g_hash_table_foreach (cbc->priv->tracked_contacts, contact_record_cb, cb_data);
+		return;
+	}
+
+	/* A contact can have both its birthday and anniversary in the window */
+	visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (ii = 0; ii <= DAY_SLOTS; ii++) {
+		GHashTableIter iter;
+		gpointer key;
+
+		if (!slots[ii] || !cbc->priv->day_index[ii])
+			continue;
+
+		g_hash_table_iter_init (&iter, cbc->priv->day_index[ii]);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (g_hash_table_contains (visited, key))
+				continue;
+
+			g_hash_table_add (visited, key);
+			contact_record_cb (NULL, key, cb_data);
+		}
+	}
+
+	g_hash_table_destroy (visited);
+}
+
 static gboolean
 ecb_contacts_watcher_filter_cb (ESourceRegistryWatcher *watcher,
 				ESource *source,
@@ -1247,7 +1417,7 @@ e_cal_backend_contacts_get_object_list (ECalBackendSync *backend,
 	cb_data = contact_record_cb_new (cbc, sexp, TRUE);
 
 	g_rec_mutex_lock (&priv->tracked_contacts_lock);
-	g_hash_table_foreach (priv->tracked_contacts, contact_record_cb, cb_data);
+	contact_record_foreach_in_sexp (cbc, cb_data);
 	g_rec_mutex_unlock (&priv->tracked_contacts_lock);
 
 	*objects = cb_data->result;
@@ -1275,7 +1445,7 @@ e_cal_backend_contacts_start_view (ECalBackend *backend,
 	cb_data = contact_record_cb_new (cbc, sexp, FALSE);
 
 	g_rec_mutex_lock (&priv->tracked_contacts_lock);
-	g_hash_table_foreach (priv->tracked_contacts, contact_record_cb, cb_data);
+	contact_record_foreach_in_sexp (cbc, cb_data);
 	e_data_cal_view_notify_components_added (query, cb_data->result);
 	g_rec_mutex_unlock (&priv->tracked_contacts_lock);
 
@@ -1292,6 +1462,7 @@ static void
 e_cal_backend_contacts_finalize (GObject *object)
 {
 	ECalBackendContactsPrivate *priv;
+	gint ii;
 
 	priv = E_CAL_BACKEND_CONTACTS_GET_PRIVATE (object);
 
@@ -1302,6 +1473,13 @@ e_cal_backend_contacts_finalize (GObject *object)
 
 	g_hash_table_destroy (priv->addressbooks);
 	g_hash_table_destroy (priv->tracked_contacts);
+
+	/* After the tracked_contacts, which remove themselves from the index */
+	for (ii = 0; ii <= DAY_SLOTS; ii++) {
+		if (priv->day_index[ii])
+			g_hash_table_destroy (priv->day_index[ii]);
+	}
+
 	if (priv->notifyid)
 		g_signal_handler_disconnect (priv->settings, priv->notifyid);
 
@@ -22,6 +22,7 @@
 
 #include "evolution-data-server-config.h"
 
+#include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -47,6 +48,22 @@
 
 #define ECAL_REVISION_X_PROP  "X-EVOLUTION-DATA-REVISION"
 
+/* The change log is stored next to the calendar file. It begins with a header
+ * line, which binds it to the revision of the calendar file, followed by
+ * records, each being a "<length> <md5>" line and a VCALENDAR component with
+ * the complete new state of the changed UIDs and added time zones. */
+#define CHANGELOG_SUFFIX	".changes"
+#define CHANGELOG_HEADER	"X-EVOLUTION-CHANGELOG:1;"
+#define CHANGELOG_UID_X_PROP	"X-EVOLUTION-CHANGELOG-UID"
+
+/* The change log is compacted into the calendar file when it grows over
+ * this size or over a half of the calendar file size, whichever is larger */
+#define CHANGELOG_MIN_COMPACT_SIZE (512 * 1024)
+
+/* A failed save is retried after a delay, doubled on each next failure */
+#define SAVE_RETRY_MIN_DELAY (1) /* seconds */
+#define SAVE_RETRY_MAX_DELAY (300) /* seconds */
+
 /* Placeholder for each component and its recurrences */
 typedef struct {
 	ECalComponent *full_object;
@@ -63,6 +80,7 @@ struct _ECalBackendFilePrivate {
 	gchar *file_name;
 	gboolean is_dirty;
 	guint dirty_idle_id;
+	guint save_retry_delay; /* seconds, 0 when the last save succeeded */
 
 	/* locked in high-level functions to ensure data is consistent
 	 * in idle and CORBA thread(s?); because high-level functions
@@ -100,8 +118,36 @@ struct _ECalBackendFilePrivate {
 
 	/* Just an incremental number to ensure uniqueness across revisions */
 	guint revision_counter;
+
+	/* Changes are appended into a change log instead of saving the whole
+	 * file, unless the calendar is a custom file read by other programs.
+	 * Guarded by idle_save_rmutex. */
+	gboolean changelog_enabled;
+	gboolean changelog_full; /* the next save should write whole file */
+	GHashTable *changed_uids;
+	GHashTable *changed_tzids;
+	gchar *changelog_base_revision;
+	gsize changelog_size;
+	gsize file_size;
+
+	/* The files are written in a dedicated thread */
+	GThreadPool *save_pool;
+	GMutex save_lock;
+	GCond save_cond;
+	guint n_pending_saves;
 };
 
+typedef struct _SaveJob {
+	gchar *path;
+	gchar *changelog_path;
+
+	/* either the whole file, which also compacts the change log... */
+	gboolean whole_file;
+
+	/* ...or a change log record to append */
+	gchar *changelog_record;
+} SaveJob;
+
 
 
 #define d(x)
@@ -112,6 +158,8 @@ static void e_cal_backend_file_finalize (GObject *object);
 static void free_refresh_data (ECalBackendFile *cbfile);
 
 static void bump_revision (ECalBackendFile *cbfile);
+static icalproperty *ensure_revision (ECalBackendFile *cbfile);
+static gboolean save_file_when_idle (gpointer user_data);
 
 static void	e_cal_backend_file_timezone_cache_init
 					(ETimezoneCacheInterface *iface);
@@ -140,120 +188,632 @@ free_object_data (gpointer data)
 	g_free (obj_data);
 }
 
-/* Saves the calendar data */
-static gboolean
-save_file_when_idle (gpointer user_data)
+static void
+save_job_free (SaveJob *job)
 {
-	ECalBackendFilePrivate *priv;
-	GError *e = NULL;
-	GFile *file, *backup_file;
-	GFileOutputStream *stream;
-	gboolean succeeded;
-	gchar *tmp, *backup_uristr;
-	gchar *buf;
-	ECalBackendFile *cbfile = user_data;
-	gboolean writable;
+	if (!job)
+		return;
 
-	priv = cbfile->priv;
-	g_return_val_if_fail (priv->path != NULL, FALSE);
-	g_return_val_if_fail (priv->icalcomp != NULL, FALSE);
+	g_free (job->path);
+	g_free (job->changelog_path);
+	g_free (job->changelog_record);
+	g_slice_free (SaveJob, job);
+}
 
-	writable = e_cal_backend_get_writable (E_CAL_BACKEND (cbfile));
+static gchar *
+changelog_dup_path (ECalBackendFile *cbfile)
+{
+	return g_strconcat (cbfile->priv->path, CHANGELOG_SUFFIX, NULL);
+}
 
-	g_rec_mutex_lock (&priv->idle_save_rmutex);
-	if (!priv->is_dirty || !writable) {
-		priv->dirty_idle_id = 0;
-		priv->is_dirty = FALSE;
-		g_rec_mutex_unlock (&priv->idle_save_rmutex);
-		return FALSE;
+static void
+changelog_mark_uid (ECalBackendFile *cbfile,
+                    const gchar *uid)
+{
+	if (cbfile->priv->changelog_enabled && uid && *uid)
+		g_hash_table_add (cbfile->priv->changed_uids, g_strdup (uid));
+}
+
+static void
+changelog_mark_tzid (ECalBackendFile *cbfile,
+                     const gchar *tzid)
+{
+	if (cbfile->priv->changelog_enabled && tzid && *tzid)
+		g_hash_table_add (cbfile->priv->changed_tzids, g_strdup (tzid));
+}
+
+/* Used for changes, which are not tracked by UID or TZID */
+static void
+changelog_mark_full (ECalBackendFile *cbfile)
+{
+	cbfile->priv->changelog_full = TRUE;
+}
+
+static void
+changelog_clear_marks (ECalBackendFile *cbfile)
+{
+	g_hash_table_remove_all (cbfile->priv->changed_uids);
+	g_hash_table_remove_all (cbfile->priv->changed_tzids);
+	cbfile->priv->changelog_full = FALSE;
+}
+
+static void
+changelog_add_x_property (icalcomponent *vcalendar,
+                          const gchar *x_name,
+                          const gchar *value)
+{
+	icalproperty *prop;
+
+	prop = icalproperty_new_x (value);
+	icalproperty_set_x_name (prop, x_name);
+	icalcomponent_add_property (vcalendar, prop);
+}
+
+/* Serializes current state of all the changed UIDs and TZIDs into a change
+ * log record and clears the marks. Removed UIDs are listed without any
+ * component. The caller should hold the idle_save_rmutex. */
+static gchar *
+changelog_build_record (ECalBackendFile *cbfile)
+{
+	ECalBackendFilePrivate *priv = cbfile->priv;
+	icalcomponent *vcalendar;
+	icalproperty *prop;
+	GHashTableIter iter;
+	gpointer key;
+	gchar *record;
+
+	vcalendar = icalcomponent_new (ICAL_VCALENDAR_COMPONENT);
+
+	prop = ensure_revision (cbfile);
+	if (prop)
+		changelog_add_x_property (vcalendar, ECAL_REVISION_X_PROP, icalproperty_get_x (prop));
+
+	g_hash_table_iter_init (&iter, priv->changed_tzids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		icaltimezone *zone;
+
+		zone = icalcomponent_get_timezone (priv->icalcomp, key);
+		if (zone)
+			icalcomponent_add_component (vcalendar, icalcomponent_new_clone (icaltimezone_get_component (zone)));
 	}
 
-	file = g_file_new_for_path (priv->path);
-	if (!file)
-		goto error_malformed_uri;
+	g_hash_table_iter_init (&iter, priv->changed_uids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		ECalBackendFileObject *obj_data;
 
-	/* save calendar to backup file */
-	tmp = g_file_get_uri (file);
-	if (!tmp) {
-		g_object_unref (file);
-		goto error_malformed_uri;
+		changelog_add_x_property (vcalendar, CHANGELOG_UID_X_PROP, key);
+
+		obj_data = g_hash_table_lookup (priv->comp_uid_hash, key);
+		if (obj_data) {
+			GList *link;
+
+			if (obj_data->full_object)
+				icalcomponent_add_component (vcalendar,
+					icalcomponent_new_clone (e_cal_component_get_icalcomponent (obj_data->full_object)));
+
+			for (link = obj_data->recurrences_list; link; link = g_list_next (link)) {
+				icalcomponent_add_component (vcalendar,
+					icalcomponent_new_clone (e_cal_component_get_icalcomponent (link->data)));
+			}
+		}
 	}
 
-	backup_uristr = g_strconcat (tmp, "~", NULL);
-	backup_file = g_file_new_for_uri (backup_uristr);
+	record = icalcomponent_as_ical_string_r (vcalendar);
 
-	g_free (tmp);
-	g_free (backup_uristr);
+	icalcomponent_free (vcalendar);
 
-	if (!backup_file) {
-		g_object_unref (file);
-		goto error_malformed_uri;
+	g_hash_table_remove_all (priv->changed_uids);
+	g_hash_table_remove_all (priv->changed_tzids);
+
+	return record;
+}
+
+static void
+changelog_index_add (GHashTable *uid_index,
+                     icalcomponent *icalcomp)
+{
+	const gchar *uid;
+
+	uid = icalcomponent_get_uid (icalcomp);
+	if (uid) {
+		GSList *comps;
+
+		comps = g_hash_table_lookup (uid_index, uid);
+		if (comps) {
+			/* Appending keeps the list head stored in the hash table */
+			comps = g_slist_append (comps, icalcomp);
+		} else {
+			g_hash_table_insert (uid_index, g_strdup (uid), g_slist_prepend (NULL, icalcomp));
+		}
+	}
+}
+
+/* Applies one change log record onto the toplevel component */
+static void
+changelog_apply_record (ECalBackendFile *cbfile,
+                        icalcomponent *record,
+                        GHashTable *uid_index)
+{
+	ECalBackendFilePrivate *priv = cbfile->priv;
+	icalcomponent *subcomp;
+	icalproperty *prop;
+	GSList *subcomps = NULL, *link;
+
+	for (prop = icalcomponent_get_first_property (record, ICAL_X_PROPERTY);
+	     prop;
+	     prop = icalcomponent_get_next_property (record, ICAL_X_PROPERTY)) {
+		const gchar *x_name = icalproperty_get_x_name (prop);
+
+		if (g_strcmp0 (x_name, CHANGELOG_UID_X_PROP) == 0) {
+			GSList *comps;
+
+			comps = g_hash_table_lookup (uid_index, icalproperty_get_x (prop));
+
+			for (link = comps; link; link = g_slist_next (link)) {
+				icalcomponent_remove_component (priv->icalcomp, link->data);
+				icalcomponent_free (link->data);
+			}
+
+			g_hash_table_remove (uid_index, icalproperty_get_x (prop));
+		} else if (g_strcmp0 (x_name, ECAL_REVISION_X_PROP) == 0) {
+			icalproperty_set_x (ensure_revision (cbfile), icalproperty_get_x (prop));
+		}
 	}
 
-	priv->refresh_skip++;
-	stream = g_file_replace (backup_file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &e);
-	if (!stream || e) {
-		if (stream)
-			g_object_unref (stream);
+	for (subcomp = icalcomponent_get_first_component (record, ICAL_ANY_COMPONENT);
+	     subcomp;
+	     subcomp = icalcomponent_get_next_component (record, ICAL_ANY_COMPONENT)) {
+		subcomps = g_slist_prepend (subcomps, subcomp);
+	}
 
-		g_object_unref (file);
-		g_object_unref (backup_file);
-		priv->refresh_skip--;
-		goto error;
+	subcomps = g_slist_reverse (subcomps);
+
+	for (link = subcomps; link; link = g_slist_next (link)) {
+		icalcomponent_kind kind;
+
+		subcomp = link->data;
+		kind = icalcomponent_isa (subcomp);
+
+		if (kind == ICAL_VTIMEZONE_COMPONENT) {
+			icalproperty *tzid_prop;
+
+			tzid_prop = icalcomponent_get_first_property (subcomp, ICAL_TZID_PROPERTY);
+			if (tzid_prop && icalcomponent_get_timezone (priv->icalcomp, icalproperty_get_tzid (tzid_prop)))
+				continue;
+		} else if (kind != ICAL_VEVENT_COMPONENT &&
+			   kind != ICAL_VTODO_COMPONENT &&
+			   kind != ICAL_VJOURNAL_COMPONENT) {
+			continue;
+		}
+
+		icalcomponent_remove_component (record, subcomp);
+		icalcomponent_add_component (priv->icalcomp, subcomp);
+
+		if (kind != ICAL_VTIMEZONE_COMPONENT)
+			changelog_index_add (uid_index, subcomp);
 	}
 
-	buf = icalcomponent_as_ical_string_r (priv->icalcomp);
-	succeeded = g_output_stream_write_all (G_OUTPUT_STREAM (stream), buf, strlen (buf) * sizeof (gchar), NULL, NULL, &e);
-	g_free (buf);
+	g_slist_free (subcomps);
+}
 
-	if (!succeeded || e) {
-		g_object_unref (stream);
-		g_object_unref (file);
-		g_object_unref (backup_file);
-		goto error;
+/* Replays the change log onto the just loaded toplevel component. A change log
+ * belonging to a different revision of the calendar file is stale, it is left
+ * there when the whole file had been saved, thus it is deleted; a partially
+ * written record at the end of the change log, as left by a crash, is cut off.
+ * The caller should hold the idle_save_rmutex. */
+static void
+changelog_replay (ECalBackendFile *cbfile,
+                  gboolean file_has_revision)
+{
+	ECalBackendFilePrivate *priv = cbfile->priv;
+	GHashTable *uid_index = NULL;
+	icalcomponent *subcomp;
+	icalproperty *prop;
+	gchar *changelog_path, *contents = NULL, *header = NULL;
+	const gchar *base_revision, *eol;
+	gsize length = 0, pos;
+	guint n_records = 0;
+
+	g_clear_pointer (&priv->changelog_base_revision, g_free);
+	priv->changelog_size = 0;
+
+	if (!priv->changelog_enabled)
+		return;
+
+	/* The change log cannot be bound to a revision which
+	 * is not saved in the file yet, thus save whole file */
+	if (!file_has_revision)
+		changelog_mark_full (cbfile);
+
+	prop = ensure_revision (cbfile);
+	base_revision = prop ? icalproperty_get_x (prop) : NULL;
+	priv->changelog_base_revision = g_strdup (base_revision);
+
+	changelog_path = changelog_dup_path (cbfile);
+
+	if (!g_file_get_contents (changelog_path, &contents, &length, NULL)) {
+		g_free (changelog_path);
+		return;
 	}
 
-	succeeded = g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, &e);
-	g_object_unref (stream);
+	eol = memchr (contents, '\n', length);
+	if (eol)
+		header = g_strndup (contents, eol - contents);
+
+	if (!file_has_revision || !header || !base_revision ||
+	    !g_str_has_prefix (header, CHANGELOG_HEADER) ||
+	    g_strcmp0 (header + strlen (CHANGELOG_HEADER), base_revision) != 0) {
+		g_free (header);
+		g_unlink (changelog_path);
+		g_free (changelog_path);
+		g_free (contents);
+		return;
+	}
+
+	g_free (header);
+
+	uid_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_slist_free);
+
+	for (subcomp = icalcomponent_get_first_component (priv->icalcomp, ICAL_ANY_COMPONENT);
+	     subcomp;
+	     subcomp = icalcomponent_get_next_component (priv->icalcomp, ICAL_ANY_COMPONENT)) {
+		icalcomponent_kind kind = icalcomponent_isa (subcomp);
+
+		if (kind == ICAL_VEVENT_COMPONENT ||
+		    kind == ICAL_VTODO_COMPONENT ||
+		    kind == ICAL_VJOURNAL_COMPONENT)
+			changelog_index_add (uid_index, subcomp);
+	}
+
+	pos = eol - contents + 1;
+
+	while (pos < length) {
+		icalcomponent *record;
+		gchar *record_str, *checksum, *endptr = NULL;
+		guint64 record_length;
+
+		eol = memchr (contents + pos, '\n', length - pos);
+		if (!eol)
+			break;
+
+		record_length = g_ascii_strtoull (contents + pos, &endptr, 10);
+		if (!endptr || *endptr != ' ' || endptr + 1 + 32 != eol ||
+		    record_length > length - (eol - contents + 1))
+			break;
+
+		checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5, (const guchar *) eol + 1, record_length);
+		if (strncmp (checksum, endptr + 1, 32) != 0) {
+			g_free (checksum);
+			break;
+		}
+
+		g_free (checksum);
+
+		record_str = g_strndup (eol + 1, record_length);
+		record = icalparser_parse_string (record_str);
+		g_free (record_str);
+
+		if (!record)
+			break;
+
+		if (icalcomponent_isa (record) == ICAL_VCALENDAR_COMPONENT) {
+			changelog_apply_record (cbfile, record, uid_index);
+			n_records++;
+		}
+
+		icalcomponent_free (record);
+
+		pos = (eol - contents) + 1 + record_length;
+	}
+
+	if (pos < length) {
+		g_warning ("%s: Change log '%s' ends with an incomplete record, dropping it", G_STRFUNC, changelog_path);
+
+		if (!g_file_set_contents (changelog_path, contents, pos, NULL))
+			changelog_mark_full (cbfile);
+	}
+
+	priv->changelog_size = pos;
+
+	d (g_message ("%s: Replayed %u records from '%s'", G_STRFUNC, n_records, changelog_path));
+
+	g_hash_table_destroy (uid_index);
+	g_free (changelog_path);
+	g_free (contents);
+}
+
+static gboolean
+cal_backend_file_write_all (gint fd,
+                            const gchar *data,
+                            gsize length,
+                            GError **error)
+{
+	while (length > 0) {
+		gssize written;
+
+		written = write (fd, data, length);
+		if (written < 0) {
+			gint errn = errno;
+
+			if (errn == EINTR)
+				continue;
+
+			g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (errn), g_strerror (errn));
+			return FALSE;
+		}
+
+		data += written;
+		length -= written;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+changelog_append (const gchar *changelog_path,
+                  const gchar *base_revision,
+                  const gchar *record,
+                  GError **error)
+{
+	struct stat st;
+	gchar *header, *checksum;
+	gsize record_length;
+	gboolean success;
+	gint fd;
+
+	fd = g_open (changelog_path, O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0600);
+	if (fd == -1) {
+		gint errn = errno;
+
+		g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (errn), g_strerror (errn));
+		return FALSE;
+	}
+
+	success = fstat (fd, &st) == 0;
+
+	if (success && st.st_size == 0) {
+		header = g_strconcat (CHANGELOG_HEADER, base_revision ? base_revision : "", "\n", NULL);
+		success = cal_backend_file_write_all (fd, header, strlen (header), error);
+		g_free (header);
+	}
+
+	record_length = strlen (record);
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5, (const guchar *) record, record_length);
+	header = g_strdup_printf ("%" G_GSIZE_FORMAT " %s\n", record_length, checksum);
+	g_free (checksum);
+
+	success = success &&
+		cal_backend_file_write_all (fd, header, strlen (header), error) &&
+		cal_backend_file_write_all (fd, record, record_length, error);
+
+	g_free (header);
+
+	/* The record is committed only when it is on the disk */
+	if (success && fsync (fd) == -1) {
+		gint errn = errno;
+
+		g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (errn), g_strerror (errn));
+		success = FALSE;
+	}
+
+	close (fd);
+
+	return success;
+}
+
+static gboolean
+cal_backend_file_write_file (ECalBackendFile *cbfile,
+                             const gchar *path,
+                             const gchar *content,
+                             GError **error)
+{
+	GFile *file, *backup_file;
+	GFileOutputStream *stream;
+	gchar *backup_path;
+	gboolean success;
+
+	file = g_file_new_for_path (path);
+
+	/* save calendar to backup file */
+	backup_path = g_strconcat (path, "~", NULL);
+	backup_file = g_file_new_for_path (backup_path);
+	g_free (backup_path);
+
+	stream = g_file_replace (backup_file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (!stream) {
+		g_rec_mutex_lock (&cbfile->priv->idle_save_rmutex);
+		if (cbfile->priv->refresh_skip > 0)
+			cbfile->priv->refresh_skip--;
+		g_rec_mutex_unlock (&cbfile->priv->idle_save_rmutex);
 
-	if (!succeeded || e) {
 		g_object_unref (file);
 		g_object_unref (backup_file);
-		goto error;
+
+		return FALSE;
 	}
 
+	success = g_output_stream_write_all (G_OUTPUT_STREAM (stream), content, strlen (content), NULL, NULL, error) &&
+		g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+
+	g_object_unref (stream);
+
 	/* now copy the temporary file to the real file */
-	g_file_move (backup_file, file, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, &e);
+	success = success && g_file_move (backup_file, file, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, error);
 
 	g_object_unref (file);
 	g_object_unref (backup_file);
-	if (e)
-		goto error;
 
-	priv->is_dirty = FALSE;
-	priv->dirty_idle_id = 0;
+	return success;
+}
 
-	g_rec_mutex_unlock (&priv->idle_save_rmutex);
+/* Writes the calendar data, in the save_pool thread */
+static void
+cal_backend_file_save_thread (gpointer data,
+                              gpointer user_data)
+{
+	SaveJob *job = data;
+	ECalBackendFile *cbfile = user_data;
+	ECalBackendFilePrivate *priv = cbfile->priv;
+	GError *error = NULL;
+	gboolean success;
 
-	return FALSE;
+	if (job->whole_file) {
+		icalproperty *prop;
+		gchar *content = NULL;
 
- error_malformed_uri:
-	g_rec_mutex_unlock (&priv->idle_save_rmutex);
-	e_cal_backend_notify_error (E_CAL_BACKEND (cbfile),
-				  _("Cannot save calendar data: Malformed URI."));
-	return FALSE;
+		/* The calendar is serialized here, not in the main loop. Changes
+		 * done after the save was scheduled can be both in this file and
+		 * in the change log, which does not matter, the change log records
+		 * replace whole components. */
+		g_rec_mutex_lock (&priv->idle_save_rmutex);
 
- error:
-	g_rec_mutex_unlock (&priv->idle_save_rmutex);
+		if (priv->icalcomp) {
+			prop = ensure_revision (cbfile);
+			content = icalcomponent_as_ical_string_r (priv->icalcomp);
+
+			g_free (priv->changelog_base_revision);
+			priv->changelog_base_revision = g_strdup (prop ? icalproperty_get_x (prop) : NULL);
+			priv->file_size = strlen (content);
+		} else if (priv->refresh_skip > 0) {
+			/* nothing is written, thus no file change to skip */
+			priv->refresh_skip--;
+		}
+
+		g_rec_mutex_unlock (&priv->idle_save_rmutex);
+
+		success = !content || cal_backend_file_write_file (cbfile, job->path, content, &error);
+
+		/* The change log is part of the saved file now */
+		if (success && content && job->changelog_path && g_unlink (job->changelog_path) == -1 && errno != ENOENT) {
+			gint errn = errno;
+
+			g_set_error_literal (&error, G_IO_ERROR, g_io_error_from_errno (errn), g_strerror (errn));
+			success = FALSE;
+		}
+
+		g_free (content);
+	} else {
+		gchar *base_revision;
+
+		/* Taken only now, a whole file saved meanwhile changes it */
+		g_rec_mutex_lock (&priv->idle_save_rmutex);
+		base_revision = g_strdup (priv->changelog_base_revision);
+		g_rec_mutex_unlock (&priv->idle_save_rmutex);
+
+		success = changelog_append (job->changelog_path, base_revision, job->changelog_record, &error);
+
+		g_free (base_revision);
+	}
+
+	if (!success) {
+		gchar *msg;
+
+		/* The changes are still in memory, try to save them
+		 * with the whole file on the next occasion */
+		g_rec_mutex_lock (&priv->idle_save_rmutex);
+		priv->is_dirty = TRUE;
+		changelog_mark_full (cbfile);
 
-	if (e) {
-		gchar *msg = g_strdup_printf ("%s: %s", _("Cannot save calendar data"), e->message);
+		if (priv->save_retry_delay)
+			priv->save_retry_delay = MIN (priv->save_retry_delay * 2, SAVE_RETRY_MAX_DELAY);
+		else
+			priv->save_retry_delay = SAVE_RETRY_MIN_DELAY;
 
+		if (!priv->dirty_idle_id)
+			priv->dirty_idle_id = e_named_timeout_add_seconds (
+				priv->save_retry_delay, save_file_when_idle, cbfile);
+		g_rec_mutex_unlock (&priv->idle_save_rmutex);
+
+		msg = g_strdup_printf ("%s: %s", _("Cannot save calendar data"), error ? error->message : _("Unknown error"));
 		e_cal_backend_notify_error (E_CAL_BACKEND (cbfile), msg);
 		g_free (msg);
-		g_error_free (e);
-	} else
-		e_cal_backend_notify_error (E_CAL_BACKEND (cbfile), _("Cannot save calendar data"));
+	} else {
+		g_rec_mutex_lock (&priv->idle_save_rmutex);
+		priv->save_retry_delay = 0;
+		g_rec_mutex_unlock (&priv->idle_save_rmutex);
+	}
+
+	g_clear_error (&error);
+	save_job_free (job);
+
+	g_mutex_lock (&priv->save_lock);
+	priv->n_pending_saves--;
+	g_cond_broadcast (&priv->save_cond);
+	g_mutex_unlock (&priv->save_lock);
+}
+
+/* Waits until all the scheduled writes are finished */
+static void
+cal_backend_file_wait_for_saves (ECalBackendFile *cbfile)
+{
+	ECalBackendFilePrivate *priv = cbfile->priv;
+
+	g_mutex_lock (&priv->save_lock);
+	while (priv->n_pending_saves > 0)
+		g_cond_wait (&priv->save_cond, &priv->save_lock);
+	g_mutex_unlock (&priv->save_lock);
+}
+
+/* Saves the calendar data; the change log records are built here, while
+ * the whole file is serialized and everything is written by the save_pool
+ * thread */
+static gboolean
+save_file_when_idle (gpointer user_data)
+{
+	ECalBackendFilePrivate *priv;
+	ECalBackendFile *cbfile = user_data;
+	SaveJob *job;
+	gboolean writable;
+
+	priv = cbfile->priv;
+	g_return_val_if_fail (priv->path != NULL, FALSE);
+	g_return_val_if_fail (priv->icalcomp != NULL, FALSE);
+
+	writable = e_cal_backend_get_writable (E_CAL_BACKEND (cbfile));
+
+	g_rec_mutex_lock (&priv->idle_save_rmutex);
+	if (!priv->is_dirty || !writable) {
+		priv->dirty_idle_id = 0;
+		priv->is_dirty = FALSE;
+		g_rec_mutex_unlock (&priv->idle_save_rmutex);
+		return FALSE;
+	}
+
+	job = g_slice_new0 (SaveJob);
+	job->path = g_strdup (priv->path);
+
+	if (priv->changelog_enabled)
+		job->changelog_path = changelog_dup_path (cbfile);
+
+	if (priv->changelog_enabled && !priv->changelog_full &&
+	    priv->changelog_size < MAX (CHANGELOG_MIN_COMPACT_SIZE, priv->file_size / 2)) {
+		job->changelog_record = changelog_build_record (cbfile);
+
+		priv->changelog_size += strlen (job->changelog_record);
+	} else {
+		/* Save whole file, which also compacts the change log */
+		job->whole_file = TRUE;
+
+		priv->changelog_size = 0;
+
+		changelog_clear_marks (cbfile);
+
+		priv->refresh_skip++;
+	}
+
+	priv->is_dirty = FALSE;
+	priv->dirty_idle_id = 0;
+
+	g_mutex_lock (&priv->save_lock);
+	priv->n_pending_saves++;
+	g_mutex_unlock (&priv->save_lock);
+
+	if (priv->save_pool)
+		g_thread_pool_push (priv->save_pool, job, NULL);
+	else
+		cal_backend_file_save_thread (job, cbfile);
+
+	g_rec_mutex_unlock (&priv->idle_save_rmutex);
 
 	return FALSE;
 }
@@ -324,12 +884,29 @@ e_cal_backend_file_dispose (GObject *object)
 
 	free_refresh_data (E_CAL_BACKEND_FILE (object));
 
-	/* Save if necessary */
+	/* Save if necessary, not waiting for a scheduled save or retry */
+	if (priv->dirty_idle_id) {
+		g_source_remove (priv->dirty_idle_id);
+		priv->dirty_idle_id = 0;
+	}
+
 	if (priv->is_dirty)
 		save_file_when_idle (cbfile);
 
+	/* Wait for any pending writes */
+	if (priv->save_pool) {
+		g_thread_pool_free (priv->save_pool, FALSE, TRUE);
+		priv->save_pool = NULL;
+	}
+
 	free_calendar_data (cbfile);
 
+	/* a retry could be scheduled by a failed write */
+	if (priv->dirty_idle_id) {
+		g_source_remove (priv->dirty_idle_id);
+		priv->dirty_idle_id = 0;
+	}
+
 	source = e_backend_get_source (E_BACKEND (cbfile));
 	if (source)
 		g_signal_handlers_disconnect_matched (source, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, cbfile);
@@ -355,8 +932,15 @@ e_cal_backend_file_finalize (GObject *object)
 
 	g_rec_mutex_clear (&priv->idle_save_rmutex);
 
+	g_mutex_clear (&priv->save_lock);
+	g_cond_clear (&priv->save_cond);
+
+	g_hash_table_destroy (priv->changed_uids);
+	g_hash_table_destroy (priv->changed_tzids);
+
 	g_free (priv->path);
 	g_free (priv->file_name);
+	g_free (priv->changelog_base_revision);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_cal_backend_file_parent_class)->finalize (object);
@@ -607,6 +1191,7 @@ check_dup_uid (ECalBackendFile *cbfile,
 	 * CREATED/DTSTAMP/LAST-MODIFIED.
 	 */
 
+	changelog_mark_full (cbfile);
 	save (cbfile, FALSE);
 
  done:
@@ -760,6 +1345,8 @@ add_component (ECalBackendFile *cbfile,
 		g_return_if_fail (icalcomp != NULL);
 
 		icalcomponent_add_component (priv->icalcomp, icalcomp);
+
+		changelog_mark_uid (cbfile, uid);
 	}
 }
 
@@ -786,6 +1373,8 @@ remove_recurrence_cb (gpointer key,
 	}
 	icalcomponent_remove_component (priv->icalcomp, icalcomp);
 
+	changelog_mark_uid (cbfile, icalcomponent_get_uid (icalcomp));
+
 	/* remove it from our mapping */
 	l = g_list_find (priv->comp, comp);
 	priv->comp = g_list_delete_link (priv->comp, l);
@@ -808,6 +1397,8 @@ remove_component (ECalBackendFile *cbfile,
 
 	priv = cbfile->priv;
 
+	changelog_mark_uid (cbfile, uid);
+
 	/* Remove the icalcomp from the toplevel */
 	if (obj_data->full_object) {
 		icalcomp = e_cal_component_get_icalcomponent (obj_data->full_object);
@@ -967,6 +1558,9 @@ refresh_thread_func (gpointer data)
 
 		g_rec_mutex_unlock (&priv->idle_save_rmutex);
 
+		/* The file is written in the save thread */
+		cal_backend_file_wait_for_saves (cbfile);
+
 		info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE, NULL, NULL);
 		if (!info)
 			break;
@@ -1104,6 +1698,35 @@ cal_backend_file_take_icalcomp (ECalBackendFile *cbfile,
 		icalproperty_get_x (prop));
 }
 
+static gboolean
+cal_backend_file_uses_changelog (ECalBackendFile *cbfile)
+{
+	ESource *source;
+	ESourceLocal *extension;
+
+	source = e_backend_get_source (E_BACKEND (cbfile));
+	extension = e_source_get_extension (source, E_SOURCE_EXTENSION_LOCAL_BACKEND);
+
+	/* Custom files can be read by other applications,
+	 * which know nothing about the change log */
+	return e_source_local_get_custom_file (extension) == NULL;
+}
+
+static gboolean
+icalcomp_has_revision (icalcomponent *icalcomp)
+{
+	icalproperty *prop;
+
+	for (prop = icalcomponent_get_first_property (icalcomp, ICAL_X_PROPERTY);
+	     prop;
+	     prop = icalcomponent_get_next_property (icalcomp, ICAL_X_PROPERTY)) {
+		if (g_strcmp0 (icalproperty_get_x_name (prop), ECAL_REVISION_X_PROP) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /* Parses an open iCalendar file and loads it into the backend */
 static void
 open_cal (ECalBackendFile *cbfile,
@@ -1112,6 +1735,8 @@ open_cal (ECalBackendFile *cbfile,
 {
 	ECalBackendFilePrivate *priv;
 	icalcomponent *icalcomp;
+	gboolean had_revision;
+	GStatBuf st;
 
 	priv = cbfile->priv;
 
@@ -1136,9 +1761,17 @@ open_cal (ECalBackendFile *cbfile,
 
 	g_rec_mutex_lock (&priv->idle_save_rmutex);
 
+	had_revision = icalcomp_has_revision (icalcomp);
+
 	cal_backend_file_take_icalcomp (cbfile, icalcomp);
 	priv->path = uri_to_path (E_CAL_BACKEND (cbfile));
 
+	if (g_stat (uristr, &st) == 0)
+		priv->file_size = st.st_size;
+
+	priv->changelog_enabled = cal_backend_file_uses_changelog (cbfile);
+	changelog_replay (cbfile, had_revision);
+
 	priv->comp_uid_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, free_object_data);
 	priv->interval_tree = e_intervaltree_new ();
 	scan_vcalendar (cbfile);
@@ -1243,6 +1876,7 @@ reload_cal (ECalBackendFile *cbfile,
 	ECalBackendFilePrivate *priv;
 	icalcomponent *icalcomp, *icalcomp_old;
 	GHashTable *comp_uid_hash_old;
+	gboolean had_revision;
 
 	priv = cbfile->priv;
 
@@ -1277,14 +1911,21 @@ reload_cal (ECalBackendFile *cbfile,
 
 	free_calendar_data (cbfile);
 
+	had_revision = icalcomp_has_revision (icalcomp);
+
 	cal_backend_file_take_icalcomp (cbfile, icalcomp);
 
+	g_free (priv->path);
+	priv->path = uri_to_path (E_CAL_BACKEND (cbfile));
+
+	changelog_clear_marks (cbfile);
+	priv->changelog_enabled = cal_backend_file_uses_changelog (cbfile);
+	changelog_replay (cbfile, had_revision);
+
 	priv->comp_uid_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, free_object_data);
 	priv->interval_tree = e_intervaltree_new ();
 	scan_vcalendar (cbfile);
 
-	priv->path = uri_to_path (E_CAL_BACKEND (cbfile));
-
 	g_rec_mutex_unlock (&priv->idle_save_rmutex);
 
 	/* Compare old and new versions of calendar */
@@ -1331,6 +1972,9 @@ create_cal (ECalBackendFile *cbfile,
 
 	priv->path = uri_to_path (E_CAL_BACKEND (cbfile));
 
+	priv->changelog_enabled = cal_backend_file_uses_changelog (cbfile);
+	changelog_mark_full (cbfile);
+
 	g_rec_mutex_unlock (&priv->idle_save_rmutex);
 
 	save (cbfile, TRUE);
@@ -2456,6 +3100,9 @@ e_cal_backend_file_modify_objects (ECalBackendSync *backend,
 		comp_uid = icalcomponent_get_uid (icalcomp);
 		obj_data = g_hash_table_lookup (priv->comp_uid_hash, comp_uid);
 
+		/* The object can be modified in place */
+		changelog_mark_uid (cbfile, comp_uid);
+
 		/* Create the cal component */
 		comp = e_cal_component_new ();
 		e_cal_component_set_icalcomponent (comp, icalcomp);
@@ -2737,6 +3384,9 @@ remove_instance (ECalBackendFile *cbfile,
 	if (rid && !*rid)
 		rid = NULL;
 
+	/* The object can be modified in place */
+	changelog_mark_uid (cbfile, uid);
+
 	if (rid) {
 		struct icaltimetype rid_struct;
 
@@ -2990,6 +3640,8 @@ e_cal_backend_file_remove_objects (ECalBackendSync *backend,
 
 		obj_data = g_hash_table_lookup (priv->comp_uid_hash, id->uid);
 
+		changelog_mark_uid (cbfile, id->uid);
+
 		if (id->rid && *(id->rid))
 			recur_id = id->rid;
 
@@ -3367,7 +4019,9 @@ e_cal_backend_file_receive_objects (ECalBackendSync *backend,
 	}
 
 	/* Merge the iCalendar components with our existing VCALENDAR,
-	 * resolving any conflicting TZIDs. */
+	 * resolving any conflicting TZIDs. The merge is not tracked
+	 * in the change log, thus save whole file. */
+	changelog_mark_full (cbfile);
 	icalcomponent_merge_component (priv->icalcomp, toplevel_comp);
 
 	/* Now we manipulate the components we care about */
@@ -3614,6 +4268,7 @@ cal_backend_file_add_cached_timezone (ETimezoneCache *cache,
 		tz_comp = icaltimezone_get_component (zone);
 		tz_comp = icalcomponent_new_clone (tz_comp);
 		icalcomponent_add_component (priv->icalcomp, tz_comp);
+		changelog_mark_tzid (E_CAL_BACKEND_FILE (cache), tzid);
 
 		timezone_added = TRUE;
 		save (E_CAL_BACKEND_FILE (cache), TRUE);
@@ -3715,6 +4370,15 @@ e_cal_backend_file_init (ECalBackendFile *cbfile)
 	g_rec_mutex_init (&cbfile->priv->idle_save_rmutex);
 
 	g_mutex_init (&cbfile->priv->refresh_lock);
+
+	cbfile->priv->changed_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	cbfile->priv->changed_tzids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mutex_init (&cbfile->priv->save_lock);
+	g_cond_init (&cbfile->priv->save_cond);
+
+	/* One thread only, thus the writes are done in order */
+	cbfile->priv->save_pool = g_thread_pool_new (cal_backend_file_save_thread, cbfile, 1, FALSE, NULL);
 }
 
 void
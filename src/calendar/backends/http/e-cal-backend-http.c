@@ -29,6 +29,9 @@
 
 #include "e-cal-backend-http.h"
 
+/* Digest of the feed text of all components sharing a UID, used as the revision */
+#define E_WEBCAL_X_DIGEST "X-EVOLUTION-WEBCAL-DIGEST"
+
 #define EDC_ERROR(_code) e_data_cal_create_error (_code, NULL)
 #define EDC_ERROR_EX(_code, _msg) e_data_cal_create_error (_code, _msg)
 
@@ -39,7 +42,8 @@ struct _ECalBackendHttpPrivate {
 
 	SoupRequestHTTP *request;
 	GInputStream *input_stream;
-	GHashTable *components; /* gchar *uid ~> icalcomponent * */
+	GHashTable *components; /* gchar *uid ~> gchar *feed text of changed components */
+	GHashTable *digests; /* gchar *uid ~> gchar *digest */
 };
 
 static gchar *
@@ -97,6 +101,39 @@ ecb_http_dup_uri (ECalBackendHttp *cbhttp)
 	return uri;
 }
 
+static void
+ecb_http_set_conditional_headers (ECalBackendHttp *cbhttp,
+				  SoupMessage *message)
+{
+	ECalCache *cal_cache;
+	gchar *last_sync_tag;
+
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbhttp));
+	if (!cal_cache)
+		return;
+
+	/* Do not let the server skip the download when there is nothing to compare with */
+	if (!e_cache_get_count (E_CACHE (cal_cache), E_CACHE_EXCLUDE_DELETED, NULL, NULL)) {
+		g_object_unref (cal_cache);
+		return;
+	}
+
+	g_object_unref (cal_cache);
+
+	last_sync_tag = e_cal_meta_backend_dup_sync_tag (E_CAL_META_BACKEND (cbhttp));
+	if (!last_sync_tag)
+		return;
+
+	/* The sync tag is the ETag, which is always quoted, or the Last-Modified date
+	   when the server does not provide any ETag */
+	if (*last_sync_tag == '"' || g_str_has_prefix (last_sync_tag, "W/"))
+		soup_message_headers_replace (message->request_headers, "If-None-Match", last_sync_tag);
+	else
+		soup_message_headers_replace (message->request_headers, "If-Modified-Since", last_sync_tag);
+
+	g_free (last_sync_tag);
+}
+
 static gboolean
 ecb_http_connect_sync (ECalMetaBackend *meta_backend,
 		       const ENamedParameters *credentials,
@@ -148,11 +185,15 @@ ecb_http_connect_sync (ECalMetaBackend *meta_backend,
 
 		message = soup_request_http_get_message (request);
 
+		if (message)
+			ecb_http_set_conditional_headers (cbhttp, message);
+
 		input_stream = e_soup_session_send_request_sync (cbhttp->priv->session, request, cancellable, &local_error);
 
 		success = input_stream != NULL;
 
-		if (success && message && !SOUP_STATUS_IS_SUCCESSFUL (message->status_code)) {
+		if (success && message && !SOUP_STATUS_IS_SUCCESSFUL (message->status_code) &&
+		    message->status_code != SOUP_STATUS_NOT_MODIFIED) {
 			g_clear_object (&input_stream);
 			success = FALSE;
 		}
@@ -238,10 +279,8 @@ ecb_http_disconnect_sync (ECalMetaBackend *meta_backend,
 	if (cbhttp->priv->session)
 		soup_session_abort (SOUP_SESSION (cbhttp->priv->session));
 
-	if (cbhttp->priv->components) {
-		g_hash_table_destroy (cbhttp->priv->components);
-		cbhttp->priv->components = NULL;
-	}
+	g_clear_pointer (&cbhttp->priv->components, g_hash_table_destroy);
+	g_clear_pointer (&cbhttp->priv->digests, g_hash_table_destroy);
 
 	source = e_backend_get_source (E_BACKEND (meta_backend));
 	e_source_set_connection_status (source, E_SOURCE_CONNECTION_STATUS_DISCONNECTED);
@@ -249,31 +288,339 @@ ecb_http_disconnect_sync (ECalMetaBackend *meta_backend,
 	return TRUE;
 }
 
+typedef struct _FeedData {
+	ECalCache *cal_cache;
+	icalcomponent_kind kind;
+	GHashTable *cached_revisions; /* gchar *uid ~> gchar *revision */
+	GHashTable *components; /* gchar *uid ~> GString *feed text */
+	GHashTable *digests; /* gchar *uid ~> gchar *digest */
+	GString *timezones;
+
+	guint depth;
+	gboolean in_vcalendar;
+	gboolean seen_begin;
+	gboolean seen_vcalendar;
+
+	/* The component being read */
+	GString *comp_text;
+	gchar *comp_uid;
+	guint comp_depth;
+	gboolean comp_is_timezone;
+
+	/* Adjacent components sharing the UID, like a master object and its detached instances */
+	GString *group_text;
+	gchar *group_uid;
+} FeedData;
+
+static void
+ecb_http_string_free (gpointer ptr)
+{
+	GString *str = ptr;
+
+	if (str)
+		g_string_free (str, TRUE);
+}
+
+static void
+ecb_http_feed_data_clear (FeedData *fd)
+{
+	g_clear_object (&fd->cal_cache);
+	g_clear_pointer (&fd->cached_revisions, g_hash_table_destroy);
+	g_clear_pointer (&fd->components, g_hash_table_destroy);
+	g_clear_pointer (&fd->digests, g_hash_table_destroy);
+	g_clear_pointer (&fd->timezones, ecb_http_string_free);
+	g_clear_pointer (&fd->comp_text, ecb_http_string_free);
+	g_clear_pointer (&fd->comp_uid, g_free);
+	g_clear_pointer (&fd->group_text, ecb_http_string_free);
+	g_clear_pointer (&fd->group_uid, g_free);
+}
+
+/* Reads only the UID and the revision columns, not the components themselves */
+static gboolean
+ecb_http_gather_cached_revisions_cb (ECache *cache,
+				     gint ncols,
+				     const gchar *column_names[],
+				     const gchar *column_values[],
+				     gpointer user_data)
+{
+	GHashTable *cached_revisions = user_data;
+	const gchar *id, *revision, *rid_separator;
+
+	g_return_val_if_fail (ncols == 2, FALSE);
+	g_return_val_if_fail (cached_revisions != NULL, FALSE);
+
+	id = column_values[0];
+	revision = column_values[1];
+
+	if (!id || !*id || !revision || !*revision)
+		return TRUE;
+
+	/* The ECalCache stores detached instances as "uid\nrid". All components
+	   of the UID carry the same digest, the master object is preferred, but
+	   the UID can have only detached instances too. */
+	rid_separator = strchr (id, '\n');
+
+	if (!rid_separator) {
+		g_hash_table_replace (cached_revisions, g_strdup (id), g_strdup (revision));
+	} else {
+		gchar *uid = g_strndup (id, rid_separator - id);
+
+		if (!g_hash_table_contains (cached_revisions, uid))
+			g_hash_table_insert (cached_revisions, uid, g_strdup (revision));
+		else
+			g_free (uid);
+	}
+
+	return TRUE;
+}
+
+/* The UID is a TEXT value, with backslash-escaped characters (RFC 5545, section 3.3.11) */
 static gchar *
-ecb_http_read_stream_sync (GInputStream *input_stream,
-			   goffset expected_length,
+ecb_http_unescape_text (const gchar *value)
+{
+	GString *text;
+
+	text = g_string_sized_new (strlen (value));
+
+	for (; *value; value++) {
+		if (*value == '\\' && value[1]) {
+			value++;
+
+			if (*value == 'n' || *value == 'N')
+				g_string_append_c (text, '\n');
+			else
+				g_string_append_c (text, *value);
+		} else {
+			g_string_append_c (text, *value);
+		}
+	}
+
+	return g_string_free (text, FALSE);
+}
+
+static void
+ecb_http_feed_flush_group (FeedData *fd)
+{
+	GChecksum *checksum;
+	GString *pending;
+	const gchar *previous_digest;
+	gchar *digest;
+
+	if (!fd->group_uid)
+		return;
+
+	/* The UID can be split into more groups in the feed; chain their digests in that case */
+	previous_digest = g_hash_table_lookup (fd->digests, fd->group_uid);
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	if (previous_digest)
+		g_checksum_update (checksum, (const guchar *) previous_digest, -1);
+	g_checksum_update (checksum, (const guchar *) fd->group_text->str, fd->group_text->len);
+	digest = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	pending = g_hash_table_lookup (fd->components, fd->group_uid);
+	if (pending) {
+		g_string_append_len (pending, fd->group_text->str, fd->group_text->len);
+		g_string_free (fd->group_text, TRUE);
+	} else if (previous_digest) {
+		GSList *icalstrings = NULL, *link;
+
+		/* The earlier group matched the cache and had been dropped, thus read it from there */
+		pending = g_string_sized_new (fd->group_text->len * 2);
+
+		if (e_cal_cache_get_components_by_uid_as_string (fd->cal_cache, fd->group_uid, &icalstrings, NULL, NULL)) {
+			for (link = icalstrings; link; link = g_slist_next (link)) {
+				g_string_append (pending, link->data);
+				g_string_append (pending, "\r\n");
+			}
+		}
+
+		g_slist_free_full (icalstrings, g_free);
+
+		g_string_append_len (pending, fd->group_text->str, fd->group_text->len);
+		g_string_free (fd->group_text, TRUE);
+
+		g_hash_table_insert (fd->components, g_strdup (fd->group_uid), pending);
+	} else if (g_strcmp0 (g_hash_table_lookup (fd->cached_revisions, fd->group_uid), digest) != 0) {
+		g_hash_table_insert (fd->components, g_strdup (fd->group_uid), fd->group_text);
+	} else {
+		/* Unchanged, no need to keep the text around */
+		g_string_free (fd->group_text, TRUE);
+	}
+
+	g_hash_table_replace (fd->digests, fd->group_uid, digest);
+
+	fd->group_text = NULL;
+	fd->group_uid = NULL;
+}
+
+static void
+ecb_http_feed_finish_component (FeedData *fd)
+{
+	if (fd->comp_is_timezone) {
+		g_string_append_len (fd->timezones, fd->comp_text->str, fd->comp_text->len);
+		g_string_free (fd->comp_text, TRUE);
+		g_clear_pointer (&fd->comp_uid, g_free);
+		fd->comp_text = NULL;
+		return;
+	}
+
+	if (!fd->comp_uid) {
+		const gchar *eol;
+		gchar *line;
+
+		/* Derive the UID from the content, thus it does not change between refreshes */
+		fd->comp_uid = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) fd->comp_text->str, fd->comp_text->len);
+
+		eol = strchr (fd->comp_text->str, '\n');
+		line = g_strconcat ("UID:", fd->comp_uid, "\r\n", NULL);
+		g_string_insert (fd->comp_text, eol ? eol - fd->comp_text->str + 1 : fd->comp_text->len, line);
+		g_free (line);
+	}
+
+	if (fd->group_uid && g_strcmp0 (fd->group_uid, fd->comp_uid) == 0) {
+		g_string_append_len (fd->group_text, fd->comp_text->str, fd->comp_text->len);
+		g_string_free (fd->comp_text, TRUE);
+		g_free (fd->comp_uid);
+	} else {
+		ecb_http_feed_flush_group (fd);
+
+		fd->group_text = fd->comp_text;
+		fd->group_uid = fd->comp_uid;
+	}
+
+	fd->comp_text = NULL;
+	fd->comp_uid = NULL;
+}
+
+/* The @line is already unfolded */
+static void
+ecb_http_feed_line (FeedData *fd,
+		    const gchar *line)
+{
+	gboolean is_begin, is_end;
+
+	is_begin = g_ascii_strncasecmp (line, "BEGIN:", 6) == 0;
+	is_end = !is_begin && g_ascii_strncasecmp (line, "END:", 4) == 0;
+
+	if (fd->comp_text) {
+		g_string_append (fd->comp_text, line);
+		g_string_append (fd->comp_text, "\r\n");
+
+		if (is_begin) {
+			fd->comp_depth++;
+		} else if (is_end) {
+			fd->comp_depth--;
+
+			if (!fd->comp_depth)
+				ecb_http_feed_finish_component (fd);
+		} else if (fd->comp_depth == 1 && !fd->comp_uid &&
+			   g_ascii_strncasecmp (line, "UID", 3) == 0 &&
+			   (line[3] == ':' || line[3] == ';')) {
+			const gchar *value;
+			gboolean in_quotes = FALSE;
+
+			/* Parameter values can contain a colon when quoted */
+			for (value = line + 3; *value && (in_quotes || *value != ':'); value++) {
+				if (*value == '"')
+					in_quotes = !in_quotes;
+			}
+
+			/* The cache holds the UID as parsed by libical, thus unescaped */
+			if (*value == ':' && value[1])
+				fd->comp_uid = ecb_http_unescape_text (value + 1);
+		}
+
+		return;
+	}
+
+	if (is_begin) {
+		icalcomponent_kind kind = icalcomponent_string_to_kind (line + 6);
+
+		fd->seen_begin = TRUE;
+
+		if (fd->depth == 1 && fd->in_vcalendar &&
+		    (kind == fd->kind || kind == ICAL_VTIMEZONE_COMPONENT)) {
+			fd->comp_text = g_string_sized_new (1024);
+			g_string_append (fd->comp_text, line);
+			g_string_append (fd->comp_text, "\r\n");
+			fd->comp_depth = 1;
+			fd->comp_is_timezone = kind == ICAL_VTIMEZONE_COMPONENT;
+			return;
+		}
+
+		if (!fd->depth && kind == ICAL_VCALENDAR_COMPONENT) {
+			fd->in_vcalendar = TRUE;
+			fd->seen_vcalendar = TRUE;
+		}
+
+		fd->depth++;
+	} else if (is_end && fd->depth > 0) {
+		fd->depth--;
+
+		if (!fd->depth)
+			fd->in_vcalendar = FALSE;
+	}
+}
+
+/* Reads the feed line by line, keeping in memory only the component being read
+   and the components which differ from those in the cache. */
+static gboolean
+ecb_http_feed_stream_sync (FeedData *fd,
+			   GInputStream *input_stream,
 			   GCancellable *cancellable,
 			   GError **error)
 {
-	GString *icalstr;
-	void *buffer;
-	gsize nread = 0;
-	gboolean success = FALSE;
+	GDataInputStream *data_stream;
+	GString *logical_line;
+	gchar *line;
+	gboolean first_line = TRUE;
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (G_IS_INPUT_STREAM (input_stream), FALSE);
+
+	data_stream = g_data_input_stream_new (input_stream);
+	g_data_input_stream_set_newline_type (data_stream, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+	g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (data_stream), FALSE);
+
+	logical_line = g_string_sized_new (256);
 
-	g_return_val_if_fail (G_IS_INPUT_STREAM (input_stream), NULL);
+	while (line = g_data_input_stream_read_line (data_stream, NULL, cancellable, &local_error), line) {
+		const gchar *ptr = line;
 
-	icalstr = g_string_sized_new (expected_length > 0 ? expected_length + 1 : 1024);
+		/* Skip UTF-8 byte order mark */
+		if (first_line && g_str_has_prefix (ptr, "\xEF\xBB\xBF"))
+			ptr += 3;
 
-	buffer = g_malloc (16384);
+		first_line = FALSE;
 
-	while (success = g_input_stream_read_all (input_stream, buffer, 16384, &nread, cancellable, error),
-	       success && nread > 0) {
-		g_string_append_len (icalstr, (const gchar *) buffer, nread);
+		if (*ptr == ' ' || *ptr == '\t') {
+			g_string_append (logical_line, ptr + 1);
+		} else {
+			if (logical_line->len)
+				ecb_http_feed_line (fd, logical_line->str);
+
+			g_string_assign (logical_line, ptr);
+		}
+
+		g_free (line);
 	}
 
-	g_free (buffer);
+	if (!local_error && logical_line->len)
+		ecb_http_feed_line (fd, logical_line->str);
+
+	g_string_free (logical_line, TRUE);
+	g_object_unref (data_stream);
 
-	return g_string_free (icalstr, !success);
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	ecb_http_feed_flush_group (fd);
+
+	return TRUE;
 }
 
 static gboolean
@@ -290,12 +637,11 @@ ecb_http_get_changes_sync (ECalMetaBackend *meta_backend,
 {
 	ECalBackendHttp *cbhttp;
 	SoupMessage *message;
-	gchar *icalstring;
-	icalcompiter iter;
-	icalcomponent *maincomp, *subcomp;
-	icalcomponent_kind backend_kind = e_cal_backend_get_kind (E_CAL_BACKEND (meta_backend));
-	GHashTable *components = NULL;
-	gboolean success = TRUE;
+	FeedData fd;
+	GHashTableIter iter;
+	gpointer key, value;
+	gchar *stmt;
+	gboolean success;
 
 	g_return_val_if_fail (E_IS_CAL_BACKEND_HTTP (meta_backend), FALSE);
 	g_return_val_if_fail (out_new_sync_tag != NULL, FALSE);
@@ -312,12 +658,17 @@ ecb_http_get_changes_sync (ECalMetaBackend *meta_backend,
 
 	message = soup_request_http_get_message (cbhttp->priv->request);
 	if (message) {
-		const gchar *new_etag;
+		const gchar *new_sync_tag;
+
+		new_sync_tag = soup_message_headers_get_one (message->response_headers, "ETag");
+		if (!new_sync_tag || !*new_sync_tag)
+			new_sync_tag = soup_message_headers_get_one (message->response_headers, "Last-Modified");
+
+		if (new_sync_tag && !*new_sync_tag)
+			new_sync_tag = NULL;
 
-		new_etag = soup_message_headers_get_one (message->response_headers, "ETag");
-		if (new_etag && !*new_etag) {
-			new_etag = NULL;
-		} else if (new_etag && g_strcmp0 (last_sync_tag, new_etag) == 0) {
+		if (message->status_code == SOUP_STATUS_NOT_MODIFIED ||
+		    (new_sync_tag && g_strcmp0 (last_sync_tag, new_sync_tag) == 0)) {
 			/* Nothing changed */
 			g_object_unref (message);
 
@@ -326,128 +677,149 @@ ecb_http_get_changes_sync (ECalMetaBackend *meta_backend,
 			return TRUE;
 		}
 
-		*out_new_sync_tag = g_strdup (new_etag);
+		*out_new_sync_tag = g_strdup (new_sync_tag);
 	}
 
 	g_clear_object (&message);
 
-	icalstring = ecb_http_read_stream_sync (cbhttp->priv->input_stream,
-		soup_request_get_content_length (SOUP_REQUEST (cbhttp->priv->request)), cancellable, error);
+	memset (&fd, 0, sizeof (FeedData));
+	fd.cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
+	fd.kind = e_cal_backend_get_kind (E_CAL_BACKEND (meta_backend));
+	fd.cached_revisions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	fd.components = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ecb_http_string_free);
+	fd.digests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	fd.timezones = g_string_new ("");
 
-	if (!icalstring) {
-		/* The error is already set */
-		e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
-		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
-		return FALSE;
-	}
+	stmt = e_cache_sqlite_stmt_printf (
+		"SELECT " E_CACHE_COLUMN_UID "," E_CACHE_COLUMN_REVISION " FROM " E_CACHE_TABLE_OBJECTS
+		" WHERE " E_CACHE_COLUMN_STATE "!=%d",
+		E_OFFLINE_STATE_LOCALLY_DELETED);
 
-	maincomp = icalparser_parse_string (icalstring);
+	success = e_cache_sqlite_select (E_CACHE (fd.cal_cache), stmt,
+		ecb_http_gather_cached_revisions_cb, fd.cached_revisions, cancellable, error) &&
+		ecb_http_feed_stream_sync (&fd, cbhttp->priv->input_stream, cancellable, error);
 
-	g_free (icalstring);
+	e_cache_sqlite_stmt_free (stmt);
 
-	if (!maincomp) {
-		g_set_error (error, SOUP_HTTP_ERROR, SOUP_STATUS_MALFORMED, _("Bad file format."));
-		e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
-		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
-		return FALSE;
+	if (success && !fd.seen_vcalendar) {
+		if (fd.seen_begin)
+			g_set_error (error, SOUP_HTTP_ERROR, SOUP_STATUS_MALFORMED, _("Not a calendar."));
+		else
+			g_set_error (error, SOUP_HTTP_ERROR, SOUP_STATUS_MALFORMED, _("Bad file format."));
+
+		success = FALSE;
 	}
 
-	if (icalcomponent_isa (maincomp) != ICAL_VCALENDAR_COMPONENT &&
-	    icalcomponent_isa (maincomp) != ICAL_XROOT_COMPONENT) {
-		icalcomponent_free (maincomp);
-		g_set_error (error, SOUP_HTTP_ERROR, SOUP_STATUS_MALFORMED, _("Not a calendar."));
+	if (!success) {
+		/* The error is already set */
+		ecb_http_feed_data_clear (&fd);
 		e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
 		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
 		return FALSE;
 	}
 
-	if (icalcomponent_isa (maincomp) == ICAL_VCALENDAR_COMPONENT) {
-		subcomp = maincomp;
-	} else {
-		iter = icalcomponent_begin_component (maincomp, ICAL_VCALENDAR_COMPONENT);
-		subcomp = icalcompiter_deref (&iter);
-	}
+	if (fd.timezones->len) {
+		icalcomponent *vcalendar;
 
-	while (subcomp && success) {
-		if (subcomp != maincomp)
-			icalcompiter_next (&iter);
+		g_string_prepend (fd.timezones, "BEGIN:VCALENDAR\r\n");
+		g_string_append (fd.timezones, "END:VCALENDAR\r\n");
 
-		if (icalcomponent_isa (subcomp) == ICAL_VCALENDAR_COMPONENT) {
-			success = e_cal_meta_backend_gather_timezones_sync (meta_backend, subcomp, TRUE, cancellable, error);
-			if (success) {
-				icalcomponent *icalcomp;
+		vcalendar = icalparser_parse_string (fd.timezones->str);
+		if (vcalendar) {
+			success = e_cal_meta_backend_gather_timezones_sync (meta_backend, vcalendar, TRUE, cancellable, error);
+			icalcomponent_free (vcalendar);
+		}
+	}
 
-				while (icalcomp = icalcomponent_get_first_component (subcomp, backend_kind), icalcomp) {
-					icalcomponent *existing_icalcomp;
-					gpointer orig_key, orig_value;
-					const gchar *uid;
+	/* UIDs split into more groups could match the cache only after the whole feed was read */
+	g_hash_table_iter_init (&iter, fd.components);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (g_strcmp0 (g_hash_table_lookup (fd.digests, key), g_hash_table_lookup (fd.cached_revisions, key)) == 0)
+			g_hash_table_iter_remove (&iter);
+	}
 
-					icalcomponent_remove_component (subcomp, icalcomp);
+	if (success && g_hash_table_size (fd.digests)) {
+		g_warn_if_fail (cbhttp->priv->components == NULL);
+		g_warn_if_fail (cbhttp->priv->digests == NULL);
 
-					if (!components)
-						components = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) icalcomponent_free);
+		cbhttp->priv->components = fd.components;
+		cbhttp->priv->digests = fd.digests;
+		fd.components = NULL;
+		fd.digests = NULL;
 
-					if (!icalcomponent_get_first_property (icalcomp, ICAL_UID_PROPERTY)) {
-						gchar *new_uid = e_util_generate_uid ();
-						icalcomponent_set_uid (icalcomp, new_uid);
-						g_free (new_uid);
-					}
+		ecb_http_feed_data_clear (&fd);
 
-					uid = icalcomponent_get_uid (icalcomp);
+		success = E_CAL_META_BACKEND_CLASS (e_cal_backend_http_parent_class)->get_changes_sync (meta_backend,
+			last_sync_tag, is_repeat, out_new_sync_tag, out_repeat, out_created_objects,
+			out_modified_objects, out_removed_objects, cancellable, error);
+	} else {
+		ecb_http_feed_data_clear (&fd);
+		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
+	}
 
-					if (!g_hash_table_lookup_extended (components, uid, &orig_key, &orig_value)) {
-						orig_key = NULL;
-						orig_value = NULL;
-					}
+	if (!success)
+		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
 
-					existing_icalcomp = orig_value;
-					if (existing_icalcomp) {
-						if (icalcomponent_isa (existing_icalcomp) != ICAL_VCALENDAR_COMPONENT) {
-							icalcomponent *vcal;
+	return success;
+}
 
-							vcal = e_cal_util_new_top_level ();
+/* Parses the feed text of the changed components with the @uid, if any */
+static icalcomponent *
+ecb_http_take_component (ECalBackendHttp *cbhttp,
+			 const gchar *uid)
+{
+	icalcomponent_kind kind;
+	icalcomponent *vcalendar, *subcomp;
+	GString *text;
+	const gchar *digest;
+	guint n_components = 0;
 
-							g_warn_if_fail (g_hash_table_steal (components, uid));
+	if (!cbhttp->priv->components)
+		return NULL;
 
-							icalcomponent_add_component (vcal, existing_icalcomp);
-							g_hash_table_insert (components, g_strdup (uid), vcal);
+	text = g_hash_table_lookup (cbhttp->priv->components, uid);
+	if (!text)
+		return NULL;
 
-							g_free (orig_key);
+	g_string_prepend (text, "BEGIN:VCALENDAR\r\n");
+	g_string_append (text, "END:VCALENDAR\r\n");
 
-							existing_icalcomp = vcal;
-						}
+	vcalendar = icalparser_parse_string (text->str);
 
-						icalcomponent_add_component (existing_icalcomp, icalcomp);
-					} else {
-						g_hash_table_insert (components, g_strdup (uid), icalcomp);
-					}
-				}
-			}
-		}
+	g_hash_table_remove (cbhttp->priv->components, uid);
 
-		if (subcomp == maincomp)
-			subcomp = NULL;
-		else
-			subcomp = icalcompiter_deref (&iter);
+	if (!vcalendar)
+		return NULL;
+
+	if (icalcomponent_isa (vcalendar) != ICAL_VCALENDAR_COMPONENT) {
+		icalcomponent_free (vcalendar);
+		return NULL;
 	}
 
-	if (components) {
-		g_warn_if_fail (cbhttp->priv->components == NULL);
-		cbhttp->priv->components = components;
+	kind = e_cal_backend_get_kind (E_CAL_BACKEND (cbhttp));
+	digest = cbhttp->priv->digests ? g_hash_table_lookup (cbhttp->priv->digests, uid) : NULL;
 
-		icalcomponent_free (maincomp);
+	for (subcomp = icalcomponent_get_first_component (vcalendar, kind);
+	     subcomp;
+	     subcomp = icalcomponent_get_next_component (vcalendar, kind)) {
+		e_cal_util_set_x_property (subcomp, E_WEBCAL_X_DIGEST, digest);
+		n_components++;
+	}
 
-		success = E_CAL_META_BACKEND_CLASS (e_cal_backend_http_parent_class)->get_changes_sync (meta_backend,
-			last_sync_tag, is_repeat, out_new_sync_tag, out_repeat, out_created_objects,
-			out_modified_objects, out_removed_objects, cancellable, error);
-	} else {
-		icalcomponent_free (maincomp);
+	if (!n_components) {
+		icalcomponent_free (vcalendar);
+		return NULL;
 	}
 
-	if (!success)
-		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
+	if (n_components == 1) {
+		subcomp = icalcomponent_get_first_component (vcalendar, kind);
+		icalcomponent_remove_component (vcalendar, subcomp);
+		icalcomponent_free (vcalendar);
 
-	return success;
+		return subcomp;
+	}
+
+	return vcalendar;
 }
 
 static gboolean
@@ -458,8 +830,6 @@ ecb_http_list_existing_sync (ECalMetaBackend *meta_backend,
 			     GError **error)
 {
 	ECalBackendHttp *cbhttp;
-	ECalCache *cal_cache;
-	icalcomponent_kind kind;
 	GHashTableIter iter;
 	gpointer key, value;
 
@@ -470,40 +840,30 @@ ecb_http_list_existing_sync (ECalMetaBackend *meta_backend,
 
 	*out_existing_objects = NULL;
 
-	g_return_val_if_fail (cbhttp->priv->components != NULL, FALSE);
-
-	cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
-	g_return_val_if_fail (cal_cache != NULL, FALSE);
-
-	kind = e_cal_backend_get_kind (E_CAL_BACKEND (meta_backend));
+	g_return_val_if_fail (cbhttp->priv->digests != NULL, FALSE);
 
-	g_hash_table_iter_init (&iter, cbhttp->priv->components);
+	g_hash_table_iter_init (&iter, cbhttp->priv->digests);
 	while (g_hash_table_iter_next (&iter, &key, &value)) {
-		icalcomponent *icalcomp = value;
+		const gchar *uid = key, *digest = value;
 		ECalMetaBackendInfo *nfo;
-		const gchar *uid;
-		gchar *revision, *object;
-
-		if (icalcomp && icalcomponent_isa (icalcomp) == ICAL_VCALENDAR_COMPONENT)
-			icalcomp = icalcomponent_get_first_component (icalcomp, kind);
-
-		if (!icalcomp)
-			continue;
-
-		uid = icalcomponent_get_uid (icalcomp);
-		revision = e_cal_cache_dup_component_revision (cal_cache, icalcomp);
-		object = icalcomponent_as_ical_string_r (value);
+		icalcomponent *icalcomp;
+		gchar *object = NULL;
+
+		/* Only changed components are parsed; the unchanged have their digest
+		   equal to the revision in the cache, thus they are not loaded at all */
+		icalcomp = ecb_http_take_component (cbhttp, uid);
+		if (icalcomp) {
+			object = icalcomponent_as_ical_string_r (icalcomp);
+			icalcomponent_free (icalcomp);
+		}
 
-		nfo = e_cal_meta_backend_info_new (uid, revision, object, NULL);
+		nfo = e_cal_meta_backend_info_new (uid, digest, object, NULL);
 
 		*out_existing_objects = g_slist_prepend (*out_existing_objects, nfo);
 
-		g_free (revision);
 		g_free (object);
 	}
 
-	g_object_unref (cal_cache);
-
 	ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
 
 	return TRUE;
@@ -519,46 +879,51 @@ ecb_http_load_component_sync (ECalMetaBackend *meta_backend,
 			      GError **error)
 {
 	ECalBackendHttp *cbhttp;
-	gpointer key = NULL, value = NULL;
 
 	g_return_val_if_fail (E_IS_CAL_BACKEND_HTTP (meta_backend), FALSE);
 	g_return_val_if_fail (uid != NULL, FALSE);
 	g_return_val_if_fail (out_component != NULL, FALSE);
 
 	cbhttp = E_CAL_BACKEND_HTTP (meta_backend);
-	g_return_val_if_fail (cbhttp->priv->components != NULL, FALSE);
 
-	if (!cbhttp->priv->components ||
-	    !g_hash_table_contains (cbhttp->priv->components, uid)) {
+	*out_component = ecb_http_take_component (cbhttp, uid);
+
+	if (!*out_component) {
 		g_propagate_error (error, EDC_ERROR (ObjectNotFound));
 		return FALSE;
 	}
 
-	g_warn_if_fail (g_hash_table_lookup_extended (cbhttp->priv->components, uid, &key, &value));
-	g_warn_if_fail (g_hash_table_steal (cbhttp->priv->components, uid));
-
-	*out_component = value;
-
-	g_free (key);
+	if (!g_hash_table_size (cbhttp->priv->components))
+		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
 
-	if (!g_hash_table_size (cbhttp->priv->components)) {
-		g_hash_table_destroy (cbhttp->priv->components);
-		cbhttp->priv->components = NULL;
+	return TRUE;
+}
 
-		ecb_http_disconnect_sync (meta_backend, cancellable, NULL);
-	}
+static gchar *
+ecb_http_dup_component_revision_cb (ECalCache *cal_cache,
+				    icalcomponent *icalcomp)
+{
+	g_return_val_if_fail (icalcomp != NULL, NULL);
 
-	return value != NULL;
+	return e_cal_util_dup_x_property (icalcomp, E_WEBCAL_X_DIGEST);
 }
 
 static void
 e_cal_backend_http_constructed (GObject *object)
 {
 	ECalBackendHttp *cbhttp = E_CAL_BACKEND_HTTP (object);
+	ECalCache *cal_cache;
 
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_cal_backend_http_parent_class)->constructed (object);
 
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbhttp));
+
+	g_signal_connect (cal_cache, "dup-component-revision",
+		G_CALLBACK (ecb_http_dup_component_revision_cb), NULL);
+
+	g_clear_object (&cal_cache);
+
 	cbhttp->priv->session = e_soup_session_new (e_backend_get_source (E_BACKEND (cbhttp)));
 
 	e_soup_session_setup_logging (cbhttp->priv->session, g_getenv ("WEBCAL_DEBUG"));
@@ -584,10 +949,8 @@ e_cal_backend_http_dispose (GObject *object)
 		g_clear_object (&cbhttp->priv->session);
 	}
 
-	if (cbhttp->priv->components) {
-		g_hash_table_destroy (cbhttp->priv->components);
-		cbhttp->priv->components = NULL;
-	}
+	g_clear_pointer (&cbhttp->priv->components, g_hash_table_destroy);
+	g_clear_pointer (&cbhttp->priv->digests, g_hash_table_destroy);
 
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_cal_backend_http_parent_class)->dispose (object);
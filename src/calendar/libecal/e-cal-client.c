@@ -89,6 +89,16 @@ struct _AsyncContext {
 	ECalObjModType mod;
 	time_t start;
 	time_t end;
+	ECalClientObjectIter *object_iter;
+	ECalClientObjectIter *read_iter; /* not owned */
+	guint max_objects;
+};
+
+struct _ECalClientObjectIter {
+	ECalClient *client;
+	GInputStream *stream;	/* NULL on Windows */
+	GSList *icalcomps;	/* pending objects read in one piece */
+	gboolean finished;
 };
 
 struct _SignalClosure {
@@ -179,6 +189,9 @@ async_context_free (AsyncContext *async_context)
 	g_free (async_context->rid);
 	g_free (async_context->auid);
 
+	if (async_context->object_iter != NULL)
+		e_cal_client_object_iter_free (async_context->object_iter);
+
 	g_slice_free (AsyncContext, async_context);
 }
 
@@ -4388,6 +4401,431 @@ e_cal_client_get_object_list_sync (ECalClient *client,
 	return TRUE;
 }
 
+/* Helper for e_cal_client_get_object_list_iter() */
+static void
+cal_client_get_object_list_iter_thread (GSimpleAsyncResult *simple,
+                                        GObject *source_object,
+                                        GCancellable *cancellable)
+{
+	AsyncContext *async_context;
+	GError *local_error = NULL;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (!e_cal_client_get_object_list_iter_sync (
+		E_CAL_CLIENT (source_object),
+		async_context->sexp,
+		&async_context->object_iter,
+		cancellable, &local_error)) {
+
+		if (!local_error)
+			local_error = g_error_new_literal (
+				E_CLIENT_ERROR,
+				E_CLIENT_ERROR_OTHER_ERROR,
+				_("Unknown error"));
+	}
+
+	if (local_error != NULL)
+		g_simple_async_result_take_error (simple, local_error);
+}
+
+/**
+ * e_cal_client_get_object_list_iter:
+ * @client: an #ECalClient
+ * @sexp: an S-expression representing the query
+ * @cancellable: a #GCancellable; can be %NULL
+ * @callback: callback to call when a result is ready
+ * @user_data: user data for the @callback
+ *
+ * Gets an iterator over calendar objects which match the S-expression @sexp.
+ * Unlike e_cal_client_get_object_list(), the objects are not transferred
+ * in one piece, but they are streamed from the backend and read in chunks
+ * with e_cal_client_object_iter_next(), which is suitable for large results.
+ * The call is finished by e_cal_client_get_object_list_iter_finish()
+ * from the @callback.
+ *
+ * Since: 3.28
+ **/
+void
+e_cal_client_get_object_list_iter (ECalClient *client,
+                                   const gchar *sexp,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_if_fail (E_IS_CAL_CLIENT (client));
+	g_return_if_fail (sexp != NULL);
+
+	async_context = g_slice_new0 (AsyncContext);
+	async_context->sexp = g_strdup (sexp);
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (client), callback, user_data,
+		e_cal_client_get_object_list_iter);
+
+	g_simple_async_result_set_check_cancellable (simple, cancellable);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, async_context, (GDestroyNotify) async_context_free);
+
+	g_simple_async_result_run_in_thread (
+		simple, cal_client_get_object_list_iter_thread,
+		G_PRIORITY_DEFAULT, cancellable);
+
+	g_object_unref (simple);
+}
+
+/**
+ * e_cal_client_get_object_list_iter_finish:
+ * @client: an #ECalClient
+ * @result: a #GAsyncResult
+ * @out_iter: (out) (transfer full): an #ECalClientObjectIter
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Finishes previous call of e_cal_client_get_object_list_iter().
+ * If successful, then the @out_iter is set to a new #ECalClientObjectIter,
+ * which should be freed with e_cal_client_object_iter_free().
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_cal_client_get_object_list_iter_finish (ECalClient *client,
+                                          GAsyncResult *result,
+                                          ECalClientObjectIter **out_iter,
+                                          GError **error)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_val_if_fail (
+		g_simple_async_result_is_valid (
+		result, G_OBJECT (client),
+		e_cal_client_get_object_list_iter), FALSE);
+	g_return_val_if_fail (out_iter != NULL, FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	*out_iter = async_context->object_iter;
+	async_context->object_iter = NULL;
+
+	return TRUE;
+}
+
+/**
+ * e_cal_client_get_object_list_iter_sync:
+ * @client: an #ECalClient
+ * @sexp: an S-expression representing the query
+ * @out_iter: (out) (transfer full): an #ECalClientObjectIter
+ * @cancellable: a #GCancellable; can be %NULL
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Gets an iterator over calendar objects which match the S-expression @sexp.
+ * Unlike e_cal_client_get_object_list_sync(), the objects are not transferred
+ * in one piece, but they are streamed from the backend and read in chunks
+ * with e_cal_client_object_iter_next_sync(), which is suitable for large
+ * results. The backend itself still gathers the whole result first, thus
+ * only the client side and the transfer are spared of it. If successful,
+ * then the @out_iter is set to a new #ECalClientObjectIter, which should
+ * be freed with e_cal_client_object_iter_free().
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_cal_client_get_object_list_iter_sync (ECalClient *client,
+                                        const gchar *sexp,
+                                        ECalClientObjectIter **out_iter,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	ECalClientObjectIter *iter;
+#ifdef G_OS_WIN32
+	GSList *icalcomps = NULL;
+#else
+	GUnixFDList *fd_list = NULL;
+	GInputStream *stream;
+	gchar *utf8_sexp;
+	gint handle = -1;
+	GError *local_error = NULL;
+#endif
+
+	g_return_val_if_fail (E_IS_CAL_CLIENT (client), FALSE);
+	g_return_val_if_fail (sexp != NULL, FALSE);
+	g_return_val_if_fail (out_iter != NULL, FALSE);
+
+#ifdef G_OS_WIN32
+	/* The stream cannot be passed over D-Bus on Windows,
+	 * thus the whole result is read in one call. */
+	if (!e_cal_client_get_object_list_sync (client, sexp, &icalcomps, cancellable, error))
+		return FALSE;
+
+	iter = g_slice_new0 (ECalClientObjectIter);
+	iter->client = g_object_ref (client);
+	iter->icalcomps = icalcomps;
+#else
+	utf8_sexp = e_util_utf8_make_valid (sexp);
+
+	e_dbus_calendar_call_get_object_list_stream_sync (
+		client->priv->dbus_proxy, utf8_sexp, NULL,
+		&handle, &fd_list, cancellable, &local_error);
+
+	g_free (utf8_sexp);
+
+	if (local_error != NULL) {
+		g_dbus_error_strip_remote_error (local_error);
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	stream = e_client_stream_new_reader (fd_list, handle, error);
+
+	g_clear_object (&fd_list);
+
+	if (!stream)
+		return FALSE;
+
+	iter = g_slice_new0 (ECalClientObjectIter);
+	iter->client = g_object_ref (client);
+	iter->stream = stream;
+#endif
+
+	*out_iter = iter;
+
+	return TRUE;
+}
+
+/* Helper for e_cal_client_object_iter_next() */
+static void
+cal_client_object_iter_next_thread (GSimpleAsyncResult *simple,
+                                    GObject *source_object,
+                                    GCancellable *cancellable)
+{
+	AsyncContext *async_context;
+	GError *local_error = NULL;
+
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (!e_cal_client_object_iter_next_sync (
+		async_context->read_iter,
+		async_context->max_objects,
+		&async_context->comp_list,
+		cancellable, &local_error)) {
+
+		if (!local_error)
+			local_error = g_error_new_literal (
+				E_CLIENT_ERROR,
+				E_CLIENT_ERROR_OTHER_ERROR,
+				_("Unknown error"));
+	}
+
+	if (local_error != NULL)
+		g_simple_async_result_take_error (simple, local_error);
+}
+
+/**
+ * e_cal_client_object_iter_next:
+ * @iter: an #ECalClientObjectIter
+ * @max_objects: the most objects to read in one call, greater than zero
+ * @cancellable: a #GCancellable; can be %NULL
+ * @callback: callback to call when a result is ready
+ * @user_data: user data for the @callback
+ *
+ * Reads the next chunk of up to @max_objects calendar objects from the @iter.
+ * The call is finished by e_cal_client_object_iter_next_finish() from
+ * the @callback. Only one read can be pending on the @iter at any time.
+ *
+ * Since: 3.28
+ **/
+void
+e_cal_client_object_iter_next (ECalClientObjectIter *iter,
+                               guint max_objects,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (max_objects > 0);
+
+	async_context = g_slice_new0 (AsyncContext);
+	async_context->read_iter = iter;
+	async_context->max_objects = max_objects;
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (iter->client), callback, user_data,
+		e_cal_client_object_iter_next);
+
+	g_simple_async_result_set_check_cancellable (simple, cancellable);
+
+	g_simple_async_result_set_op_res_gpointer (
+		simple, async_context, (GDestroyNotify) async_context_free);
+
+	g_simple_async_result_run_in_thread (
+		simple, cal_client_object_iter_next_thread,
+		G_PRIORITY_DEFAULT, cancellable);
+
+	g_object_unref (simple);
+}
+
+/**
+ * e_cal_client_object_iter_next_finish:
+ * @iter: an #ECalClientObjectIter
+ * @result: a #GAsyncResult
+ * @out_icalcomps: (out) (element-type icalcomponent): list of
+ *                 read #icalcomponent<!-- -->s
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Finishes previous call of e_cal_client_object_iter_next().
+ * If successful, then the @out_icalcomps is set to a newly allocated list
+ * of #icalcomponent<!-- -->s, which should be freed with
+ * e_cal_client_free_icalcomp_slist(). The @out_icalcomps is set to %NULL
+ * when all objects had been read.
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_cal_client_object_iter_next_finish (ECalClientObjectIter *iter,
+                                      GAsyncResult *result,
+                                      GSList **out_icalcomps,
+                                      GError **error)
+{
+	GSimpleAsyncResult *simple;
+	AsyncContext *async_context;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (
+		g_simple_async_result_is_valid (
+		result, G_OBJECT (iter->client),
+		e_cal_client_object_iter_next), FALSE);
+	g_return_val_if_fail (out_icalcomps != NULL, FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	async_context = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	*out_icalcomps = async_context->comp_list;
+	async_context->comp_list = NULL;
+
+	return TRUE;
+}
+
+/**
+ * e_cal_client_object_iter_next_sync:
+ * @iter: an #ECalClientObjectIter
+ * @max_objects: the most objects to read in one call, greater than zero
+ * @out_icalcomps: (out) (element-type icalcomponent): list of
+ *                 read #icalcomponent<!-- -->s
+ * @cancellable: a #GCancellable; can be %NULL
+ * @error: (out): a #GError to set an error, if any
+ *
+ * Reads the next chunk of up to @max_objects calendar objects from the @iter.
+ * If successful, then the @out_icalcomps is set to a newly allocated list
+ * of #icalcomponent<!-- -->s, which should be freed with
+ * e_cal_client_free_icalcomp_slist(). The @out_icalcomps is set to %NULL
+ * when all objects had been read.
+ *
+ * Returns: %TRUE if successful, %FALSE otherwise.
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_cal_client_object_iter_next_sync (ECalClientObjectIter *iter,
+                                    guint max_objects,
+                                    GSList **out_icalcomps,
+                                    GCancellable *cancellable,
+                                    GError **error)
+{
+	GSList *tmp = NULL;
+	guint n_read = 0;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (max_objects > 0, FALSE);
+	g_return_val_if_fail (out_icalcomps != NULL, FALSE);
+
+	*out_icalcomps = NULL;
+
+	if (!iter->stream) {
+		while (iter->icalcomps && n_read < max_objects) {
+			tmp = g_slist_prepend (tmp, iter->icalcomps->data);
+			iter->icalcomps = g_slist_delete_link (iter->icalcomps, iter->icalcomps);
+			n_read++;
+		}
+
+		*out_icalcomps = g_slist_reverse (tmp);
+
+		return TRUE;
+	}
+
+	while (!iter->finished && n_read < max_objects) {
+		icalcomponent *icalcomp;
+		gchar *calobj = NULL;
+
+		if (!e_client_stream_read_record (iter->stream, &calobj, cancellable, error)) {
+			g_slist_free_full (tmp, (GDestroyNotify) icalcomponent_free);
+			return FALSE;
+		}
+
+		if (!calobj) {
+			iter->finished = TRUE;
+			break;
+		}
+
+		/* Count also the objects failing to parse, to not block
+		 * on the stream for more than max_objects records. */
+		n_read++;
+
+		icalcomp = icalcomponent_new_from_string (calobj);
+
+		g_free (calobj);
+
+		if (icalcomp)
+			tmp = g_slist_prepend (tmp, icalcomp);
+	}
+
+	*out_icalcomps = g_slist_reverse (tmp);
+
+	return TRUE;
+}
+
+/**
+ * e_cal_client_object_iter_free:
+ * @iter: (nullable): an #ECalClientObjectIter
+ *
+ * Frees the @iter. Any objects not read yet are discarded.
+ *
+ * Since: 3.28
+ **/
+void
+e_cal_client_object_iter_free (ECalClientObjectIter *iter)
+{
+	if (!iter)
+		return;
+
+	if (iter->stream)
+		g_input_stream_close (iter->stream, NULL, NULL);
+
+	g_clear_object (&iter->stream);
+	g_slist_free_full (iter->icalcomps, (GDestroyNotify) icalcomponent_free);
+	g_object_unref (iter->client);
+	g_slice_free (ECalClientObjectIter, iter);
+}
+
 /* Helper for e_cal_client_get_object_list_as_comps() */
 static void
 cal_client_get_object_list_as_comps_thread (GSimpleAsyncResult *simple,
@@ -143,6 +143,16 @@ struct _ECalClientClass {
 						 const GSList *free_busy_ecalcomps);
 };
 
+/**
+ * ECalClientObjectIter:
+ *
+ * An opaque iterator over calendar objects streamed from the backend, created
+ * by e_cal_client_get_object_list_iter() and freed by e_cal_client_object_iter_free().
+ *
+ * Since: 3.28
+ **/
+typedef struct _ECalClientObjectIter ECalClientObjectIter;
+
 GQuark		e_cal_client_error_quark	(void) G_GNUC_CONST;
 const gchar *	e_cal_client_error_to_string	(ECalClientError code);
 
@@ -285,6 +295,40 @@ gboolean	e_cal_client_get_object_list_sync
 						 GSList **out_icalcomps,
 						 GCancellable *cancellable,
 						 GError **error);
+void		e_cal_client_get_object_list_iter
+						(ECalClient *client,
+						 const gchar *sexp,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_cal_client_get_object_list_iter_finish
+						(ECalClient *client,
+						 GAsyncResult *result,
+						 ECalClientObjectIter **out_iter,
+						 GError **error);
+gboolean	e_cal_client_get_object_list_iter_sync
+						(ECalClient *client,
+						 const gchar *sexp,
+						 ECalClientObjectIter **out_iter,
+						 GCancellable *cancellable,
+						 GError **error);
+void		e_cal_client_object_iter_next	(ECalClientObjectIter *iter,
+						 guint max_objects,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_cal_client_object_iter_next_finish
+						(ECalClientObjectIter *iter,
+						 GAsyncResult *result,
+						 GSList **out_icalcomps,
+						 GError **error);
+gboolean	e_cal_client_object_iter_next_sync
+						(ECalClientObjectIter *iter,
+						 guint max_objects,
+						 GSList **out_icalcomps,
+						 GCancellable *cancellable,
+						 GError **error);
+void		e_cal_client_object_iter_free	(ECalClientObjectIter *iter);
 void		e_cal_client_get_object_list_as_comps
 						(ECalClient *client,
 						 const gchar *sexp,
@@ -30,6 +30,7 @@
 
 #include "e-cal-backend.h"
 #include "e-cal-backend-cache.h"
+#include "e-data-cal-view-private.h"
 
 #define E_CAL_BACKEND_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
@@ -4332,26 +4333,30 @@ e_cal_backend_notify_component_created (ECalBackend *backend,
                                         ECalComponent *component)
 {
 	GList *list, *link;
+	GHashTable *strings_cache;
 
 	g_return_if_fail (E_IS_CAL_BACKEND (backend));
 	g_return_if_fail (E_IS_CAL_COMPONENT (component));
 
 	list = e_cal_backend_list_views (backend);
+	strings_cache = _e_data_cal_view_strings_cache_new ();
 
 	for (link = list; link != NULL; link = g_list_next (link)) {
 		EDataCalView *view = E_DATA_CAL_VIEW (link->data);
 
 		if (e_data_cal_view_component_matches (view, component))
-			e_data_cal_view_notify_components_added_1 (view, component);
+			_e_data_cal_view_notify_component_added_shared (view, component, strings_cache);
 	}
 
+	g_hash_table_destroy (strings_cache);
 	g_list_free_full (list, (GDestroyNotify) g_object_unref);
 }
 
 static void
 match_view_and_notify_component (EDataCalView *view,
                                  ECalComponent *old_component,
-                                 ECalComponent *new_component)
+                                 ECalComponent *new_component,
+                                 GHashTable *strings_cache)
 {
 	gboolean old_match = FALSE, new_match = FALSE;
 
@@ -4361,9 +4366,9 @@ match_view_and_notify_component (EDataCalView *view,
 	new_match = e_data_cal_view_component_matches (view, new_component);
 
 	if (old_match && new_match)
-		e_data_cal_view_notify_components_modified_1 (view, new_component);
+		_e_data_cal_view_notify_component_modified_shared (view, new_component, strings_cache);
 	else if (new_match)
-		e_data_cal_view_notify_components_added_1 (view, new_component);
+		_e_data_cal_view_notify_component_added_shared (view, new_component, strings_cache);
 	else if (old_match) {
 
 		ECalComponentId *id = e_cal_component_get_id (old_component);
@@ -4395,18 +4400,22 @@ e_cal_backend_notify_component_modified (ECalBackend *backend,
                                          ECalComponent *new_component)
 {
 	GList *list, *link;
+	GHashTable *strings_cache;
 
 	g_return_if_fail (E_IS_CAL_BACKEND (backend));
 	g_return_if_fail (!old_component || E_IS_CAL_COMPONENT (old_component));
 	g_return_if_fail (E_IS_CAL_COMPONENT (new_component));
 
 	list = e_cal_backend_list_views (backend);
+	strings_cache = _e_data_cal_view_strings_cache_new ();
 
 	for (link = list; link != NULL; link = g_list_next (link))
 		match_view_and_notify_component (
 			E_DATA_CAL_VIEW (link->data),
-			old_component, new_component);
+			old_component, new_component,
+			strings_cache);
 
+	g_hash_table_destroy (strings_cache);
 	g_list_free_full (list, (GDestroyNotify) g_object_unref);
 }
 
@@ -4435,6 +4444,7 @@ e_cal_backend_notify_component_removed (ECalBackend *backend,
                                         ECalComponent *new_component)
 {
 	GList *list, *link;
+	GHashTable *strings_cache = NULL;
 
 	g_return_if_fail (E_IS_CAL_BACKEND (backend));
 	g_return_if_fail (id != NULL);
@@ -4447,12 +4457,16 @@ e_cal_backend_notify_component_removed (ECalBackend *backend,
 
 	list = e_cal_backend_list_views (backend);
 
+	if (new_component != NULL)
+		strings_cache = _e_data_cal_view_strings_cache_new ();
+
 	for (link = list; link != NULL; link = g_list_next (link)) {
 		EDataCalView *view = E_DATA_CAL_VIEW (link->data);
 
 		if (new_component != NULL)
 			match_view_and_notify_component (
-				view, old_component, new_component);
+				view, old_component, new_component,
+				strings_cache);
 
 		else if (old_component == NULL)
 			e_data_cal_view_notify_objects_removed_1 (view, id);
@@ -4461,6 +4475,8 @@ e_cal_backend_notify_component_removed (ECalBackend *backend,
 			e_data_cal_view_notify_objects_removed_1 (view, id);
 	}
 
+	if (strings_cache)
+		g_hash_table_destroy (strings_cache);
 	g_list_free_full (list, (GDestroyNotify) g_object_unref);
 }
 
@@ -67,6 +67,9 @@
 #define ECC_COLUMN_HAS_RECURRENCES	"has_recurrences"
 #define ECC_COLUMN_EXTRA		"bdata"
 
+/* How many parsed components to keep for check_sexp() */
+#define ECC_PARSED_CACHE_SIZE		256
+
 struct _ECalCachePrivate {
 	GHashTable *loaded_timezones; /* gchar *tzid ~> icaltimezone * */
 	GHashTable *modified_timezones; /* gchar *tzid ~> icaltimezone * */
@@ -74,8 +77,22 @@ struct _ECalCachePrivate {
 
 	GHashTable *sexps; /* gint ~> ECalBackendSExp * */
 	GMutex sexps_lock;
+
+	/* Components parsed by check_sexp(), the most recently used first */
+	GQueue parsed_lru; /* ParsedComponent * */
+	GHashTable *parsed_index; /* const gchar *uid ~> GList * in parsed_lru */
+	guint parsed_stamp; /* changed on each invalidation */
+	guint64 parsed_hits;
+	guint64 parsed_misses;
+	GMutex parsed_lock;
 };
 
+typedef struct _ParsedComponent {
+	gchar *uid; /* the E_CACHE_COLUMN_UID value */
+	gchar *revision;
+	ECalComponent *comp;
+} ParsedComponent;
+
 enum {
 	DUP_COMPONENT_REVISION,
 	LAST_SIGNAL
@@ -300,7 +317,130 @@ ecc_ref_sexp_object (ECalCache *cal_cache,
 	return sexp;
 }
 
-/* check_sexp(sexp_id, icalstring) */
+static void
+parsed_component_free (gpointer ptr)
+{
+	ParsedComponent *pc = ptr;
+
+	if (pc) {
+		g_free (pc->uid);
+		g_free (pc->revision);
+		g_clear_object (&pc->comp);
+		g_free (pc);
+	}
+}
+
+/* Removes the parsed component for @uid from the LRU and returns it,
+   thus it's not shared between threads while being matched. Returns
+   the current invalidation stamp, to be passed to ecc_parsed_cache_give(). */
+static ECalComponent *
+ecc_parsed_cache_take (ECalCache *cal_cache,
+		       const gchar *uid,
+		       const gchar *revision,
+		       guint *out_stamp)
+{
+	ECalComponent *comp = NULL;
+	GList *link;
+
+	g_mutex_lock (&cal_cache->priv->parsed_lock);
+
+	*out_stamp = cal_cache->priv->parsed_stamp;
+
+	link = g_hash_table_lookup (cal_cache->priv->parsed_index, uid);
+	if (link) {
+		ParsedComponent *pc = link->data;
+
+		g_hash_table_remove (cal_cache->priv->parsed_index, uid);
+		g_queue_delete_link (&cal_cache->priv->parsed_lru, link);
+
+		if (g_strcmp0 (pc->revision, revision) == 0) {
+			comp = pc->comp;
+			pc->comp = NULL;
+		}
+
+		parsed_component_free (pc);
+	}
+
+	if (comp)
+		cal_cache->priv->parsed_hits++;
+	else
+		cal_cache->priv->parsed_misses++;
+
+	g_mutex_unlock (&cal_cache->priv->parsed_lock);
+
+	return comp;
+}
+
+/* Takes ownership of @comp and stores it as the most recently used,
+   unless the cache had been invalidated since the ecc_parsed_cache_take() call. */
+static void
+ecc_parsed_cache_give (ECalCache *cal_cache,
+		       const gchar *uid,
+		       const gchar *revision,
+		       ECalComponent *comp,
+		       guint stamp)
+{
+	ParsedComponent *pc;
+	GList *link;
+
+	g_mutex_lock (&cal_cache->priv->parsed_lock);
+
+	if (stamp != cal_cache->priv->parsed_stamp ||
+	    g_hash_table_contains (cal_cache->priv->parsed_index, uid)) {
+		g_mutex_unlock (&cal_cache->priv->parsed_lock);
+		g_object_unref (comp);
+		return;
+	}
+
+	pc = g_new0 (ParsedComponent, 1);
+	pc->uid = g_strdup (uid);
+	pc->revision = g_strdup (revision);
+	pc->comp = comp;
+
+	g_queue_push_head (&cal_cache->priv->parsed_lru, pc);
+	g_hash_table_insert (cal_cache->priv->parsed_index, pc->uid, cal_cache->priv->parsed_lru.head);
+
+	while (g_queue_get_length (&cal_cache->priv->parsed_lru) > ECC_PARSED_CACHE_SIZE) {
+		link = g_queue_peek_tail_link (&cal_cache->priv->parsed_lru);
+		pc = link->data;
+
+		g_hash_table_remove (cal_cache->priv->parsed_index, pc->uid);
+		g_queue_delete_link (&cal_cache->priv->parsed_lru, link);
+		parsed_component_free (pc);
+	}
+
+	g_mutex_unlock (&cal_cache->priv->parsed_lock);
+}
+
+/* Drops the parsed component for @uid, or all of them when @uid is %NULL */
+static void
+ecc_parsed_cache_invalidate (ECalCache *cal_cache,
+			     const gchar *uid)
+{
+	GList *link;
+
+	g_mutex_lock (&cal_cache->priv->parsed_lock);
+
+	cal_cache->priv->parsed_stamp++;
+
+	if (uid) {
+		link = g_hash_table_lookup (cal_cache->priv->parsed_index, uid);
+		if (link) {
+			g_hash_table_remove (cal_cache->priv->parsed_index, uid);
+			parsed_component_free (link->data);
+			g_queue_delete_link (&cal_cache->priv->parsed_lru, link);
+		}
+	} else {
+		g_hash_table_remove_all (cal_cache->priv->parsed_index);
+		g_queue_foreach (&cal_cache->priv->parsed_lru, (GFunc) parsed_component_free, NULL);
+		g_queue_clear (&cal_cache->priv->parsed_lru);
+	}
+
+	g_mutex_unlock (&cal_cache->priv->parsed_lock);
+}
+
+/* check_sexp(sexp_id, icalstring)
+   check_sexp(sexp_id, uid, revision, icalstring) */
 static void
 ecc_check_sexp_func (sqlite3_context *context,
 		     gint argc,
@@ -308,15 +448,25 @@ ecc_check_sexp_func (sqlite3_context *context,
 {
 	ECalCache *cal_cache;
 	ECalBackendSExp *sexp_obj;
+	ECalComponent *comp = NULL;
 	gint sexp_id;
-	const gchar *icalstring;
+	const gchar *uid = NULL, *revision = NULL, *icalstring;
+	guint stamp = 0;
+	gboolean matches;
 
 	g_return_if_fail (context != NULL);
-	g_return_if_fail (argc == 2);
+	g_return_if_fail (argc == 2 || argc == 4);
 
 	cal_cache = sqlite3_user_data (context);
 	sexp_id = sqlite3_value_int (argv[0]);
-	icalstring = (const gchar *) sqlite3_value_text (argv[1]);
+
+	if (argc == 4) {
+		uid = (const gchar *) sqlite3_value_text (argv[1]);
+		revision = (const gchar *) sqlite3_value_text (argv[2]);
+		icalstring = (const gchar *) sqlite3_value_text (argv[3]);
+	} else {
+		icalstring = (const gchar *) sqlite3_value_text (argv[1]);
+	}
 
 	if (!E_IS_CAL_CACHE (cal_cache) || !icalstring || !*icalstring) {
 		sqlite3_result_int (context, 0);
@@ -329,10 +479,20 @@ ecc_check_sexp_func (sqlite3_context *context,
 		return;
 	}
 
-	if (e_cal_backend_sexp_match_object (sexp_obj, icalstring, E_TIMEZONE_CACHE (cal_cache)))
-		sqlite3_result_int (context, 1);
+	if (uid)
+		comp = ecc_parsed_cache_take (cal_cache, uid, revision, &stamp);
+
+	if (!comp)
+		comp = e_cal_component_new_from_string (icalstring);
+
+	matches = comp && e_cal_backend_sexp_match_comp (sexp_obj, comp, E_TIMEZONE_CACHE (cal_cache));
+
+	if (comp && uid)
+		ecc_parsed_cache_give (cal_cache, uid, revision, comp, stamp);
 	else
-		sqlite3_result_int (context, 0);
+		g_clear_object (&comp);
+
+	sqlite3_result_int (context, matches ? 1 : 0);
 
 	g_object_unref (sexp_obj);
 }
@@ -1582,11 +1742,12 @@ ecc_convert_sexp_to_sql (ECalCache *cal_cache,
 			if (result->type == ESEXP_RES_STRING) {
 				if (ctx.requires_check_sexp) {
 					if (result->value.string) {
-						*out_where_clause = g_strdup_printf ("((%s) AND check_sexp(%d,%s))",
-							result->value.string, sexp_id, E_CACHE_COLUMN_OBJECT);
+						*out_where_clause = g_strdup_printf ("((%s) AND check_sexp(%d,%s,%s,%s))",
+							result->value.string, sexp_id,
+							E_CACHE_COLUMN_UID, E_CACHE_COLUMN_REVISION, E_CACHE_COLUMN_OBJECT);
 					} else {
-						*out_where_clause = g_strdup_printf ("check_sexp(%d,%s)",
-							sexp_id, E_CACHE_COLUMN_OBJECT);
+						*out_where_clause = g_strdup_printf ("check_sexp(%d,%s,%s,%s)",
+							sexp_id, E_CACHE_COLUMN_UID, E_CACHE_COLUMN_REVISION, E_CACHE_COLUMN_OBJECT);
 					}
 				} else {
 					/* Just steal the string from the ESExpResult */
@@ -1726,6 +1887,14 @@ ecc_init_sqlite_functions (ECalCache *cal_cache,
 		cal_cache, ecc_check_sexp_func,
 		NULL, NULL);
 
+	if (ret == SQLITE_OK) {
+		/* check_sexp(sexp_id, uid, revision, icalstring) */
+		ret = sqlite3_create_function (sqlitedb,
+			"check_sexp", 4, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+			cal_cache, ecc_check_sexp_func,
+			NULL, NULL);
+	}
+
 	if (ret == SQLITE_OK) {
 		/* negate(x) */
 		ret = sqlite3_create_function (sqlitedb,
@@ -2931,6 +3100,41 @@ e_cal_cache_search_with_callback (ECalCache *cal_cache,
 	return success;
 }
 
+/**
+ * e_cal_cache_get_parsed_cache_stats:
+ * @cal_cache: an #ECalCache
+ * @out_n_components: (out) (optional): number of currently held parsed components
+ * @out_hits: (out) (optional): how many times a parsed component had been reused
+ * @out_misses: (out) (optional): how many times a component had to be parsed
+ *
+ * Returns statistics of the cache of parsed components, which is used
+ * to evaluate search expressions, which cannot be converted into SQL
+ * only, like occur-in-time-range? or has-alarms-in-range?. The cached
+ * components are bound to their revision and they are dropped whenever
+ * the component is put into or removed from the @cal_cache.
+ *
+ * Since: 3.28
+ **/
+void
+e_cal_cache_get_parsed_cache_stats (ECalCache *cal_cache,
+				    guint *out_n_components,
+				    guint64 *out_hits,
+				    guint64 *out_misses)
+{
+	g_return_if_fail (E_IS_CAL_CACHE (cal_cache));
+
+	g_mutex_lock (&cal_cache->priv->parsed_lock);
+
+	if (out_n_components)
+		*out_n_components = g_queue_get_length (&cal_cache->priv->parsed_lru);
+	if (out_hits)
+		*out_hits = cal_cache->priv->parsed_hits;
+	if (out_misses)
+		*out_misses = cal_cache->priv->parsed_misses;
+
+	g_mutex_unlock (&cal_cache->priv->parsed_lock);
+}
+
 /**
  * e_cal_cache_get_offline_changes:
  * @cal_cache: an #ECalCache
@@ -3586,6 +3790,8 @@ e_cal_cache_put_locked (ECache *cache,
 
 	cal_cache = E_CAL_CACHE (cache);
 
+	ecc_parsed_cache_invalidate (cal_cache, uid);
+
 	comp = e_cal_component_new_from_string (object);
 	if (!comp)
 		return FALSE;
@@ -3600,6 +3806,20 @@ e_cal_cache_put_locked (ECache *cache,
 	return success;
 }
 
+static gboolean
+e_cal_cache_remove_locked (ECache *cache,
+			   const gchar *uid,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	g_return_val_if_fail (E_IS_CAL_CACHE (cache), FALSE);
+	g_return_val_if_fail (E_CACHE_CLASS (e_cal_cache_parent_class)->remove_locked != NULL, FALSE);
+
+	ecc_parsed_cache_invalidate (E_CAL_CACHE (cache), uid);
+
+	return E_CACHE_CLASS (e_cal_cache_parent_class)->remove_locked (cache, uid, cancellable, error);
+}
+
 static gboolean
 e_cal_cache_remove_all_locked (ECache *cache,
 			       const GSList *uids,
@@ -3619,6 +3839,8 @@ e_cal_cache_remove_all_locked (ECache *cache,
 
 	success = success && E_CACHE_CLASS (e_cal_cache_parent_class)->remove_all_locked (cache, uids, cancellable, error);
 
+	ecc_parsed_cache_invalidate (E_CAL_CACHE (cache), NULL);
+
 	return success;
 }
 
@@ -3750,9 +3972,13 @@ e_cal_cache_finalize (GObject *object)
 	g_hash_table_destroy (cal_cache->priv->loaded_timezones);
 	g_hash_table_destroy (cal_cache->priv->modified_timezones);
 	g_hash_table_destroy (cal_cache->priv->sexps);
+	g_hash_table_destroy (cal_cache->priv->parsed_index);
+	g_queue_foreach (&cal_cache->priv->parsed_lru, (GFunc) parsed_component_free, NULL);
+	g_queue_clear (&cal_cache->priv->parsed_lru);
 
 	g_rec_mutex_clear (&cal_cache->priv->timezones_lock);
 	g_mutex_clear (&cal_cache->priv->sexps_lock);
+	g_mutex_clear (&cal_cache->priv->parsed_lock);
 
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_cal_cache_parent_class)->finalize (object);
@@ -3771,6 +3997,7 @@ e_cal_cache_class_init (ECalCacheClass *klass)
 
 	cache_class = E_CACHE_CLASS (klass);
 	cache_class->put_locked = e_cal_cache_put_locked;
+	cache_class->remove_locked = e_cal_cache_remove_locked;
 	cache_class->remove_all_locked = e_cal_cache_remove_all_locked;
 
 	klass->dup_component_revision = ecc_dup_component_revision;
@@ -3810,6 +4037,10 @@ e_cal_cache_init (ECalCache *cal_cache)
 
 	cal_cache->priv->sexps = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
 
+	g_queue_init (&cal_cache->priv->parsed_lru);
+	cal_cache->priv->parsed_index = g_hash_table_new (g_str_hash, g_str_equal);
+
 	g_rec_mutex_init (&cal_cache->priv->timezones_lock);
 	g_mutex_init (&cal_cache->priv->sexps_lock);
+	g_mutex_init (&cal_cache->priv->parsed_lock);
 }
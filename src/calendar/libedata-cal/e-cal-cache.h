@@ -297,6 +297,11 @@ gboolean	e_cal_cache_search_with_callback
 						 gpointer user_data,
 						 GCancellable *cancellable,
 						 GError **error);
+void		e_cal_cache_get_parsed_cache_stats
+						(ECalCache *cal_cache,
+						 guint *out_n_components,
+						 guint64 *out_hits,
+						 guint64 *out_misses);
 GSList *	e_cal_cache_get_offline_changes	(ECalCache *cal_cache,
 						 GCancellable *cancellable,
 						 GError **error);
@@ -0,0 +1,38 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef E_DATA_CAL_VIEW_PRIVATE_H
+#define E_DATA_CAL_VIEW_PRIVATE_H
+
+#include <libedata-cal/libedata-cal.h>
+
+G_BEGIN_DECLS
+
+GHashTable *	_e_data_cal_view_strings_cache_new
+						(void);
+void		_e_data_cal_view_set_fields_of_interest
+						(EDataCalView *view,
+						 const gchar * const *fields_of_interest);
+void		_e_data_cal_view_notify_component_added_shared
+						(EDataCalView *view,
+						 ECalComponent *component,
+						 GHashTable *strings_cache);
+void		_e_data_cal_view_notify_component_modified_shared
+						(EDataCalView *view,
+						 ECalComponent *component,
+						 GHashTable *strings_cache);
+
+G_END_DECLS
+
+#endif /* E_DATA_CAL_VIEW_PRIVATE_H */
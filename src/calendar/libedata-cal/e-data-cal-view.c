@@ -39,6 +39,7 @@
 #include "e-cal-backend.h"
 #include "e-cal-backend-sexp.h"
 #include "e-data-cal-view.h"
+#include "e-data-cal-view-private.h"
 #include "e-gdbus-cal-view.h"
 
 #define E_DATA_CAL_VIEW_GET_PRIVATE(obj) \
@@ -80,8 +81,16 @@ struct _EDataCalViewPrivate {
 
 	/* which fields is listener interested in */
 	GHashTable *fields_of_interest;
+	/* sorted, lower-cased fields_of_interest joined with '\n';
+	 * views with the same key get the same component strings */
+	gchar *fields_of_interest_key;
 };
 
+/* How many component strings were shared between views
+ * of one notification, and how many had to be built */
+static volatile gint component_strings_hits = 0;
+static volatile gint component_strings_misses = 0;
+
 enum {
 	PROP_0,
 	PROP_BACKEND,
@@ -267,23 +276,23 @@ impl_DataCalView_dispose (EGdbusCalView *object,
 	return TRUE;
 }
 
-static gboolean
-impl_DataCalView_set_fields_of_interest (EGdbusCalView *object,
-                                         GDBusMethodInvocation *invocation,
-                                         const gchar * const *in_fields_of_interest,
-                                         EDataCalView *view)
+/* Sets which fields the listener is interested in, as asked over D-Bus */
+void
+_e_data_cal_view_set_fields_of_interest (EDataCalView *view,
+                                         const gchar * const *fields_of_interest)
 {
 	gint ii;
 
-	g_return_val_if_fail (in_fields_of_interest != NULL, TRUE);
+	g_return_if_fail (E_IS_DATA_CAL_VIEW (view));
+	g_return_if_fail (fields_of_interest != NULL);
 
 	if (view->priv->fields_of_interest != NULL) {
 		g_hash_table_destroy (view->priv->fields_of_interest);
 		view->priv->fields_of_interest = NULL;
 	}
 
-	for (ii = 0; in_fields_of_interest[ii]; ii++) {
-		const gchar *field = in_fields_of_interest[ii];
+	for (ii = 0; fields_of_interest[ii]; ii++) {
+		const gchar *field = fields_of_interest[ii];
 
 		if (!*field)
 			continue;
@@ -301,6 +310,46 @@ impl_DataCalView_set_fields_of_interest (EGdbusCalView *object,
 			g_strdup (field), GINT_TO_POINTER (1));
 	}
 
+	g_mutex_lock (&view->priv->pending_mutex);
+	g_free (view->priv->fields_of_interest_key);
+	view->priv->fields_of_interest_key = NULL;
+
+	if (view->priv->fields_of_interest != NULL) {
+		GList *fields, *link;
+		GString *key;
+
+		fields = g_hash_table_get_keys (view->priv->fields_of_interest);
+		fields = g_list_sort (fields, (GCompareFunc) g_ascii_strcasecmp);
+
+		key = g_string_new ("");
+
+		for (link = fields; link; link = g_list_next (link)) {
+			gchar *field = g_ascii_strdown (link->data, -1);
+
+			if (key->len)
+				g_string_append_c (key, '\n');
+			g_string_append (key, field);
+
+			g_free (field);
+		}
+
+		g_list_free (fields);
+
+		view->priv->fields_of_interest_key = g_string_free (key, FALSE);
+	}
+	g_mutex_unlock (&view->priv->pending_mutex);
+}
+
+static gboolean
+impl_DataCalView_set_fields_of_interest (EGdbusCalView *object,
+                                         GDBusMethodInvocation *invocation,
+                                         const gchar * const *in_fields_of_interest,
+                                         EDataCalView *view)
+{
+	g_return_val_if_fail (in_fields_of_interest != NULL, TRUE);
+
+	_e_data_cal_view_set_fields_of_interest (view, in_fields_of_interest);
+
 	e_gdbus_cal_view_complete_set_fields_of_interest (
 		object, invocation, NULL);
 
@@ -468,6 +517,8 @@ data_cal_view_finalize (GObject *object)
 	if (priv->fields_of_interest != NULL)
 		g_hash_table_destroy (priv->fields_of_interest);
 
+	g_free (priv->fields_of_interest_key);
+
 	g_mutex_clear (&priv->pending_mutex);
 
 	/* Chain up to parent's finalize() method. */
@@ -715,14 +766,44 @@ ensure_pending_flush_timeout (EDataCalView *view)
 	}
 }
 
+/* Returns a newly allocated string of @comp for @view. With @strings_cache,
+ * the component is serialized only once per set of fields-of-interest. */
+static gchar *
+dup_component_string (EDataCalView *view,
+                      ECalComponent *comp,
+                      GHashTable *strings_cache)
+{
+	const gchar *key;
+	gchar *str;
+
+	if (!strings_cache)
+		return e_data_cal_view_get_component_string (view, comp);
+
+	/* The full component has no fields-of-interest key */
+	key = view->priv->fields_of_interest_key ? view->priv->fields_of_interest_key : "";
+
+	str = g_hash_table_lookup (strings_cache, key);
+	if (str) {
+		g_atomic_int_inc (&component_strings_hits);
+	} else {
+		g_atomic_int_inc (&component_strings_misses);
+
+		str = e_data_cal_view_get_component_string (view, comp);
+		g_hash_table_insert (strings_cache, g_strdup (key), str);
+	}
+
+	return g_strdup (str);
+}
+
 static void
 notify_add_component (EDataCalView *view,
-                      /* const */ ECalComponent *comp)
+                      /* const */ ECalComponent *comp,
+                      GHashTable *strings_cache)
 {
 	ECalClientViewFlags flags;
 	gchar *obj;
 
-	obj = e_data_cal_view_get_component_string (view, comp);
+	obj = dup_component_string (view, comp, strings_cache);
 
 	send_pending_changes (view);
 	send_pending_removes (view);
@@ -760,11 +841,12 @@ notify_change (EDataCalView *view,
 
 static void
 notify_change_component (EDataCalView *view,
-                         ECalComponent *comp)
+                         ECalComponent *comp,
+                         GHashTable *strings_cache)
 {
 	gchar *obj;
 
-	obj = e_data_cal_view_get_component_string (view, comp);
+	obj = dup_component_string (view, comp, strings_cache);
 
 	notify_change (view, obj);
 }
@@ -1199,7 +1281,7 @@ e_data_cal_view_notify_components_added (EDataCalView *view,
 
 		g_warn_if_fail (E_IS_CAL_COMPONENT (comp));
 
-		notify_add_component (view, comp);
+		notify_add_component (view, comp, NULL);
 	}
 
 	g_mutex_unlock (&view->priv->pending_mutex);
@@ -1264,7 +1346,7 @@ e_data_cal_view_notify_components_modified (EDataCalView *view,
 
 		g_warn_if_fail (E_IS_CAL_COMPONENT (comp));
 
-		notify_change_component (view, comp);
+		notify_change_component (view, comp, NULL);
 	}
 
 	g_mutex_unlock (&view->priv->pending_mutex);
@@ -1297,6 +1379,73 @@ e_data_cal_view_notify_components_modified_1 (EDataCalView *view,
 	e_data_cal_view_notify_components_modified (view, &l);
 }
 
+/* Component strings for one notification, keyed by the views'
+ * fields-of-interest; free it once all the views are notified */
+GHashTable *
+_e_data_cal_view_strings_cache_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+/* Like e_data_cal_view_notify_components_added_1(), only the string
+ * of @component is looked up in @strings_cache first and stored there
+ * when not found, thus @component is serialized once per set of
+ * fields-of-interest of the notified views */
+void
+_e_data_cal_view_notify_component_added_shared (EDataCalView *view,
+                                                ECalComponent *component,
+                                                GHashTable *strings_cache)
+{
+	g_return_if_fail (E_IS_DATA_CAL_VIEW (view));
+	g_return_if_fail (E_IS_CAL_COMPONENT (component));
+	g_return_if_fail (strings_cache != NULL);
+
+	g_mutex_lock (&view->priv->pending_mutex);
+	notify_add_component (view, component, strings_cache);
+	g_mutex_unlock (&view->priv->pending_mutex);
+}
+
+/* Like e_data_cal_view_notify_components_modified_1(), with the string
+ * of @component shared as in _e_data_cal_view_notify_component_added_shared() */
+void
+_e_data_cal_view_notify_component_modified_shared (EDataCalView *view,
+                                                   ECalComponent *component,
+                                                   GHashTable *strings_cache)
+{
+	g_return_if_fail (E_IS_DATA_CAL_VIEW (view));
+	g_return_if_fail (E_IS_CAL_COMPONENT (component));
+	g_return_if_fail (strings_cache != NULL);
+
+	g_mutex_lock (&view->priv->pending_mutex);
+	notify_change_component (view, component, strings_cache);
+	g_mutex_unlock (&view->priv->pending_mutex);
+}
+
+/**
+ * e_data_cal_view_get_shared_strings_stats:
+ * @out_hits: (out) (optional): how many component strings were shared
+ * @out_misses: (out) (optional): how many component strings were serialized
+ *
+ * Returns process-wide counters of the component strings notified
+ * to the views by e_cal_backend_notify_component_created() and
+ * e_cal_backend_notify_component_modified(). A component is serialized
+ * once per set of fields-of-interest of the views and the other views
+ * with the same set share the string. The hit rate is
+ * @out_hits / (@out_hits + @out_misses).
+ *
+ * Since: 3.28
+ **/
+void
+e_data_cal_view_get_shared_strings_stats (guint *out_hits,
+                                          guint *out_misses)
+{
+	if (out_hits)
+		*out_hits = (guint) g_atomic_int_get (&component_strings_hits);
+
+	if (out_misses)
+		*out_misses = (guint) g_atomic_int_get (&component_strings_misses);
+}
+
 /**
  * e_data_cal_view_notify_objects_removed:
  * @view: an #EDataCalView
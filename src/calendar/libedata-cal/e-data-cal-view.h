@@ -105,6 +105,9 @@ void		e_data_cal_view_notify_components_modified
 void		e_data_cal_view_notify_components_modified_1
 						(EDataCalView *view,
 						 ECalComponent *component);
+void		e_data_cal_view_get_shared_strings_stats
+						(guint *out_hits,
+						 guint *out_misses);
 
 void		e_data_cal_view_notify_objects_removed
 						(EDataCalView *view,
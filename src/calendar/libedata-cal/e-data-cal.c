@@ -34,6 +34,7 @@
 #include <e-dbus-calendar.h>
 
 #include <libedataserver/libedataserver.h>
+#include <libedataserver/e-client-private.h>
 
 #include "e-data-cal.h"
 #include "e-cal-backend.h"
@@ -47,6 +48,7 @@
 #define EDC_ERROR_EX(_code, _msg) e_data_cal_create_error (_code, _msg)
 
 typedef struct _AsyncContext AsyncContext;
+typedef struct _StreamContext StreamContext;
 
 struct _EDataCalPrivate {
 	GDBusConnection *connection;
@@ -66,6 +68,12 @@ struct _AsyncContext {
 	guint watcher_id;
 };
 
+struct _StreamContext {
+	AsyncContext *async_context;
+	GOutputStream *stream;
+	GQueue calobjs;
+};
+
 enum {
 	PROP_0,
 	PROP_BACKEND,
@@ -836,6 +844,148 @@ data_cal_handle_get_object_list_cb (EDBusCalendar *dbus_interface,
 	return TRUE;
 }
 
+#ifndef G_OS_WIN32
+/* File descriptors cannot be passed over D-Bus on Windows */
+static gpointer
+data_cal_write_object_list_stream_thread (gpointer user_data)
+{
+	StreamContext *stream_context = user_data;
+	GCancellable *cancellable;
+	GError *local_error = NULL;
+	gboolean success = TRUE;
+
+	cancellable = stream_context->async_context->cancellable;
+
+	while (!g_queue_is_empty (&stream_context->calobjs)) {
+		gchar *calobj;
+
+		calobj = g_queue_pop_head (&stream_context->calobjs);
+
+		if (success) {
+			gchar *utf8_calobj;
+
+			utf8_calobj = e_util_utf8_make_valid (calobj);
+
+			if (utf8_calobj && *utf8_calobj) {
+				success = e_client_stream_write_record (
+					stream_context->stream, utf8_calobj,
+					cancellable, &local_error);
+			}
+
+			g_free (utf8_calobj);
+		}
+
+		g_free (calobj);
+	}
+
+	if (success) {
+		success = e_client_stream_write_record (
+			stream_context->stream, NULL,
+			cancellable, &local_error);
+	}
+
+	/* The client cannot be notified about the error anymore, it will
+	 * only see the stream ended without the end-of-stream marker. The
+	 * reader going away is fine, the client freed its iterator early. */
+	if (!success &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+	    !g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_BROKEN_PIPE))
+		g_warning ("%s: Failed to write object list stream: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+
+	g_clear_error (&local_error);
+
+	g_output_stream_close (stream_context->stream, NULL, NULL);
+	g_object_unref (stream_context->stream);
+	async_context_free (stream_context->async_context);
+	g_slice_free (StreamContext, stream_context);
+
+	return NULL;
+}
+
+static void
+data_cal_complete_get_object_list_stream_cb (GObject *source_object,
+                                             GAsyncResult *result,
+                                             gpointer user_data)
+{
+	AsyncContext *async_context = user_data;
+	GQueue queue = G_QUEUE_INIT;
+	GError *error = NULL;
+
+	e_cal_backend_get_object_list_finish (
+		E_CAL_BACKEND (source_object), result, &queue, &error);
+
+	if (error == NULL) {
+		GUnixFDList *fd_list = NULL;
+		GOutputStream *stream;
+
+		stream = e_client_stream_new_writer (&fd_list, &error);
+
+		if (stream) {
+			StreamContext *stream_context;
+			GThread *thread;
+
+			e_dbus_calendar_complete_get_object_list_stream (
+				async_context->dbus_interface,
+				async_context->invocation,
+				fd_list,
+				0);
+
+			g_object_unref (fd_list);
+
+			/* Write the objects in a dedicated thread, thus
+			 * the client can parse the beginning of the result
+			 * while the rest of it is still being written. The
+			 * backend has the whole list ready at this point,
+			 * only the transfer to the client is streamed. */
+			stream_context = g_slice_new0 (StreamContext);
+			stream_context->async_context = async_context;
+			stream_context->stream = stream;
+			stream_context->calobjs = queue;
+
+			thread = g_thread_new (NULL, data_cal_write_object_list_stream_thread, stream_context);
+			g_thread_unref (thread);
+
+			return;
+		}
+
+		g_queue_free_full (&queue, g_free);
+	}
+
+	data_cal_convert_to_client_error (error);
+	g_dbus_method_invocation_take_error (
+		async_context->invocation, error);
+
+	async_context_free (async_context);
+}
+
+static gboolean
+data_cal_handle_get_object_list_stream_cb (EDBusCalendar *dbus_interface,
+                                           GDBusMethodInvocation *invocation,
+                                           GUnixFDList *fd_list,
+                                           const gchar *in_query,
+                                           EDataCal *data_cal)
+{
+	ECalBackend *backend;
+	AsyncContext *async_context;
+
+	backend = e_data_cal_ref_backend (data_cal);
+	g_return_val_if_fail (backend != NULL, FALSE);
+
+	async_context = async_context_new (data_cal, invocation);
+
+	e_cal_backend_get_object_list (
+		backend,
+		in_query,
+		async_context->cancellable,
+		data_cal_complete_get_object_list_stream_cb,
+		async_context);
+
+	g_object_unref (backend);
+
+	return TRUE;
+}
+#endif /* G_OS_WIN32 */
+
 static void
 data_cal_complete_get_free_busy_cb (GObject *source_object,
                                     GAsyncResult *result,
@@ -2775,6 +2925,11 @@ e_data_cal_init (EDataCal *data_cal)
 	g_signal_connect (
 		dbus_interface, "handle-get-object-list",
 		G_CALLBACK (data_cal_handle_get_object_list_cb), data_cal);
+#ifndef G_OS_WIN32
+	g_signal_connect (
+		dbus_interface, "handle-get-object-list-stream",
+		G_CALLBACK (data_cal_handle_get_object_list_stream_cb), data_cal);
+#endif
 	g_signal_connect (
 		dbus_interface, "handle-get-free-busy",
 		G_CALLBACK (data_cal_handle_get_free_busy_cb), data_cal);
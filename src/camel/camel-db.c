@@ -1590,7 +1590,8 @@ camel_db_get_folder_deleted_uids (CamelDB *cdb,
  * @cdb: a #CamelDB
  * @error: return location for a #GError, or %NULL
  *
- * Creates a 'folders' table, if it doesn't exist yet.
+ * Creates a 'folders' table and an 'index_queue' table, if they
+ * don't exist yet.
  *
  * Returns: 0 on success, -1 on error
  *
@@ -1620,9 +1621,204 @@ camel_db_create_folders_table (CamelDB *cdb,
 
 	cdb->priv->is_foldersdb = TRUE;
 
+	if (camel_db_command (cdb, query, error) == -1)
+		return -1;
+
+	/* messages waiting to have their content indexed, per folder */
+	query = "CREATE TABLE IF NOT EXISTS index_queue ( "
+		"folder_name TEXT, "
+		"uid TEXT, "
+		"offset INTEGER, "
+		"PRIMARY KEY (folder_name, uid) )";
+
 	return camel_db_command (cdb, query, error);
 }
 
+/**
+ * camel_db_add_to_index_queue:
+ * @cdb: a #CamelDB
+ * @folder_name: full name of the folder
+ * @uids: (element-type utf8): message UID-s to add
+ * @offsets: (element-type gint64): positions of the messages in the folder,
+ *    one for each of the @uids
+ * @error: return location for a #GError, or %NULL
+ *
+ * Adds messages, whose content is waiting to be indexed, to the index
+ * queue of the @folder_name as one transaction. The offset of a message
+ * which is in the queue already is updated.
+ *
+ * Returns: 0 on success, -1 on error
+ *
+ * Since: 3.28
+ **/
+gint
+camel_db_add_to_index_queue (CamelDB *cdb,
+                             const gchar *folder_name,
+                             const GPtrArray *uids,
+                             const GArray *offsets,
+                             GError **error)
+{
+	gint ret = 0;
+	guint ii;
+
+	g_return_val_if_fail (CAMEL_IS_DB (cdb), -1);
+	g_return_val_if_fail (folder_name != NULL, -1);
+	g_return_val_if_fail (uids != NULL, -1);
+	g_return_val_if_fail (offsets != NULL && offsets->len == uids->len, -1);
+
+	if (!uids->len)
+		return 0;
+
+	if (camel_db_begin_transaction (cdb, error) == -1)
+		return -1;
+
+	for (ii = 0; ii < uids->len && ret == 0; ii++) {
+		gchar *ins;
+
+		ins = sqlite3_mprintf (
+			"INSERT OR REPLACE INTO index_queue (folder_name, uid, offset) VALUES (%Q, %Q, %lld)",
+			folder_name, (const gchar *) uids->pdata[ii],
+			(sqlite3_int64) g_array_index (offsets, gint64, ii));
+		ret = camel_db_add_to_transaction (cdb, ins, error);
+		sqlite3_free (ins);
+	}
+
+	if (ret == -1)
+		camel_db_abort_transaction (cdb, NULL);
+	else
+		ret = camel_db_end_transaction (cdb, error);
+
+	return ret;
+}
+
+struct _read_index_queue_data {
+	GPtrArray *uids;
+	GArray *offsets;
+};
+
+static gint
+read_index_queue_callback (gpointer user_data,
+                           gint ncol,
+                           gchar **cols,
+                           gchar **name)
+{
+	struct _read_index_queue_data *data = user_data;
+	gint64 offset;
+
+	g_return_val_if_fail (ncol == 2, 0);
+
+	if (cols[0]) {
+		offset = cols[1] ? g_ascii_strtoll (cols[1], NULL, 10) : 0;
+
+		g_ptr_array_add (data->uids, (gchar *) camel_pstring_strdup (cols[0]));
+		g_array_append_val (data->offsets, offset);
+	}
+
+	return 0;
+}
+
+/**
+ * camel_db_read_index_queue:
+ * @cdb: a #CamelDB
+ * @folder_name: full name of the folder
+ * @limit: how many messages to read at most, or 0 to read all of them
+ * @uids: (element-type utf8): an array to add the message UID-s to
+ * @offsets: (element-type gint64): an array to add the message offsets to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads messages from the index queue of the @folder_name, ordered
+ * by their offsets, thus a mailbox file can be read sequentially.
+ * Use camel_pstring_free() to free the elements added to the @uids.
+ *
+ * Returns: 0 on success, -1 on error
+ *
+ * Since: 3.28
+ **/
+gint
+camel_db_read_index_queue (CamelDB *cdb,
+                           const gchar *folder_name,
+                           guint limit,
+                           GPtrArray *uids,
+                           GArray *offsets,
+                           GError **error)
+{
+	struct _read_index_queue_data data;
+	gchar *sel_query;
+	gint ret;
+
+	g_return_val_if_fail (CAMEL_IS_DB (cdb), -1);
+	g_return_val_if_fail (folder_name != NULL, -1);
+	g_return_val_if_fail (uids != NULL, -1);
+	g_return_val_if_fail (offsets != NULL, -1);
+
+	data.uids = uids;
+	data.offsets = offsets;
+
+	sel_query = sqlite3_mprintf (
+		"SELECT uid, offset FROM index_queue WHERE folder_name = %Q ORDER BY offset, uid LIMIT %d",
+		folder_name, limit > 0 ? (gint) MIN (limit, G_MAXINT) : -1);
+
+	ret = camel_db_select (cdb, sel_query, read_index_queue_callback, &data, error);
+	sqlite3_free (sel_query);
+
+	return ret;
+}
+
+/**
+ * camel_db_delete_from_index_queue:
+ * @cdb: a #CamelDB
+ * @folder_name: full name of the folder
+ * @uids: (element-type utf8) (nullable): message UID-s to remove, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Removes messages, whose content had been indexed, from the index
+ * queue of the @folder_name. When @uids is %NULL, the whole queue
+ * of the folder is emptied.
+ *
+ * Returns: 0 on success, -1 on error
+ *
+ * Since: 3.28
+ **/
+gint
+camel_db_delete_from_index_queue (CamelDB *cdb,
+                                  const gchar *folder_name,
+                                  const GPtrArray *uids,
+                                  GError **error)
+{
+	GString *stmt;
+	gchar *tmp;
+	guint ii;
+	gint ret;
+
+	g_return_val_if_fail (CAMEL_IS_DB (cdb), -1);
+	g_return_val_if_fail (folder_name != NULL, -1);
+
+	if (uids && !uids->len)
+		return 0;
+
+	tmp = sqlite3_mprintf ("DELETE FROM index_queue WHERE folder_name = %Q", folder_name);
+	stmt = g_string_new (tmp);
+	sqlite3_free (tmp);
+
+	if (uids) {
+		g_string_append (stmt, " AND uid IN (");
+
+		for (ii = 0; ii < uids->len; ii++) {
+			tmp = sqlite3_mprintf ("%s%Q", ii ? ", " : "", (const gchar *) uids->pdata[ii]);
+			g_string_append (stmt, tmp);
+			sqlite3_free (tmp);
+		}
+
+		g_string_append_c (stmt, ')');
+	}
+
+	ret = camel_db_command (cdb, stmt->str, error);
+
+	g_string_free (stmt, TRUE);
+
+	return ret;
+}
+
 static gint
 camel_db_create_message_info_table (CamelDB *cdb,
                                     const gchar *folder_name,
@@ -2433,19 +2629,23 @@ camel_db_clear_folder_summary (CamelDB *cdb,
 	gint ret;
 	gchar *folders_del;
 	gchar *msginfo_del;
+	gchar *queue_del;
 
 	folders_del = sqlite3_mprintf ("DELETE FROM folders WHERE folder_name = %Q", folder_name);
 	msginfo_del = sqlite3_mprintf ("DELETE FROM %Q ", folder_name);
+	queue_del = sqlite3_mprintf ("DELETE FROM index_queue WHERE folder_name = %Q", folder_name);
 
 	camel_db_begin_transaction (cdb, error);
 
 	camel_db_add_to_transaction (cdb, msginfo_del, error);
 	camel_db_add_to_transaction (cdb, folders_del, error);
+	camel_db_add_to_transaction (cdb, queue_del, error);
 
 	ret = camel_db_end_transaction (cdb, error);
 
 	sqlite3_free (folders_del);
 	sqlite3_free (msginfo_del);
+	sqlite3_free (queue_del);
 
 	return ret;
 }
@@ -2456,8 +2656,8 @@ camel_db_clear_folder_summary (CamelDB *cdb,
  * @folder_name: full name of the folder
  * @error: return location for a #GError, or %NULL
  *
- * Deletes the given folder from the 'folders' table and also drops
- * its message info table.
+ * Deletes the given folder from the 'folders' table, drops its
+ * message info table and empties its index queue.
  *
  * Returns: 0 on success, -1 on error
  *
@@ -2481,6 +2681,10 @@ camel_db_delete_folder (CamelDB *cdb,
 	ret = camel_db_add_to_transaction (cdb, del, error);
 	sqlite3_free (del);
 
+	del = sqlite3_mprintf ("DELETE FROM index_queue WHERE folder_name = %Q", folder_name);
+	ret = camel_db_add_to_transaction (cdb, del, error);
+	sqlite3_free (del);
+
 	ret = camel_db_end_transaction (cdb, error);
 
 	camel_db_release_cache_memory ();
@@ -2527,6 +2731,10 @@ camel_db_rename_folder (CamelDB *cdb,
 	ret = camel_db_add_to_transaction (cdb, cmd, error);
 	sqlite3_free (cmd);
 
+	cmd = sqlite3_mprintf ("UPDATE index_queue SET folder_name = %Q WHERE folder_name = %Q", new_folder_name, old_folder_name);
+	ret = camel_db_add_to_transaction (cdb, cmd, error);
+	sqlite3_free (cmd);
+
 	ret = camel_db_end_transaction (cdb, error);
 
 	camel_db_release_cache_memory ();
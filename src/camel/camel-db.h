@@ -368,6 +368,22 @@ gint		camel_db_delete_uids		(CamelDB *cdb,
 						 GError **error);
 gint		camel_db_create_folders_table	(CamelDB *cdb,
 						 GError **error);
+gint		camel_db_add_to_index_queue	(CamelDB *cdb,
+						 const gchar *folder_name,
+						 const GPtrArray *uids,
+						 const GArray *offsets,
+						 GError **error);
+gint		camel_db_read_index_queue	(CamelDB *cdb,
+						 const gchar *folder_name,
+						 guint limit,
+						 GPtrArray *uids,
+						 GArray *offsets,
+						 GError **error);
+gint		camel_db_delete_from_index_queue
+						(CamelDB *cdb,
+						 const gchar *folder_name,
+						 const GPtrArray *uids,
+						 GError **error);
 gint		camel_db_select			(CamelDB *cdb,
 						 const gchar *stmt,
 						 CamelDBSelectCB callback,
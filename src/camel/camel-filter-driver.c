@@ -38,7 +38,9 @@
 #include "camel-file-utils.h"
 #include "camel-filter-driver.h"
 #include "camel-filter-search.h"
+#include "camel-internet-address.h"
 #include "camel-mime-message.h"
+#include "camel-search-private.h"
 #include "camel-service.h"
 #include "camel-session.h"
 #include "camel-sexp.h"
@@ -64,13 +66,55 @@ enum filter_log_t {
 	FILTER_LOG_END          /* end of log */
 };
 
+enum filter_index_state_t {
+	FILTER_INDEX_UNDECIDED,
+	FILTER_INDEX_NOMATCH,
+	FILTER_INDEX_MATCHED
+};
+
 /* list of rule nodes */
 struct _filter_rule {
 	gchar *match;
 	gchar *action;
 	gchar *name;
+
+	/* parsed once, on the first use of the rule */
+	gboolean compiled;
+	CamelFilterSearchCompiled *search;
+	GError *search_error;
+	CamelSExp *action_sexp;
+	gchar *action_error;
+
+	/* the match is decided by a header index */
+	gboolean indexed;
+	enum filter_index_state_t index_state;
 };
 
+/* A multi-pattern matcher (Aho-Corasick) over lower-cased UTF-8 bytes */
+typedef struct _FilterMatcherNode {
+	gint fail;		/* longest proper suffix, which is also in the trie */
+	gint dict;		/* closest node in the fail chain with rules, or 0 */
+	gint first_child;
+	gint next_sibling;
+	GSList *rules;		/* struct _filter_rule *, whose pattern ends here */
+} FilterMatcherNode;
+
+typedef struct _FilterMatcher {
+	GArray *nodes;		/* FilterMatcherNode, the root is at index 0 */
+	GHashTable *edges;	/* (node << 8) | byte ~> child node */
+} FilterMatcher;
+
+/* Rules testing one header from the summary, grouped by their values */
+typedef struct _FilterHeaderIndex {
+	const gchar *header_name;
+	const gchar *info_name;
+	gboolean is_address;
+	GSList *rules;		/* all indexed rules of this header */
+	GSList *always;		/* rules with an empty value, they always match */
+	GHashTable *exact;	/* lower-cased value ~> GSList of rules */
+	FilterMatcher *contains;
+} FilterHeaderIndex;
+
 struct _CamelFilterDriverPrivate {
 	GHashTable *globals;       /* global variables */
 
@@ -113,6 +157,8 @@ struct _CamelFilterDriverPrivate {
 	FILE *logfile;             /* log file */
 
 	GQueue rules;		   /* queue of _filter_rule structs */
+	gboolean rules_compiled;   /* all rules are parsed and indexed */
+	GPtrArray *header_indexes; /* FilterHeaderIndex * */
 
 	GError *error;
 
@@ -185,6 +231,474 @@ filter_rule_compare_by_name (struct _filter_rule *rule,
 	return g_strcmp0 (rule->name, name);
 }
 
+static CamelSExp *
+filter_driver_new_sexp (CamelFilterDriver *driver)
+{
+	CamelSExp *sexp;
+	gint ii;
+
+	sexp = camel_sexp_new ();
+
+	/* Load in builtin symbols */
+	for (ii = 0; ii < G_N_ELEMENTS (symbols); ii++) {
+		if (symbols[ii].type == 1) {
+			camel_sexp_add_ifunction (
+				sexp, 0, symbols[ii].name,
+				(CamelSExpIFunc) symbols[ii].func, driver);
+		} else {
+			camel_sexp_add_function (
+				sexp, 0, symbols[ii].name,
+				symbols[ii].func, driver);
+		}
+	}
+
+	return sexp;
+}
+
+static FilterMatcher *
+filter_matcher_new (void)
+{
+	FilterMatcher *matcher;
+	FilterMatcherNode root = { 0, };
+
+	matcher = g_new0 (FilterMatcher, 1);
+	matcher->nodes = g_array_new (FALSE, FALSE, sizeof (FilterMatcherNode));
+	matcher->edges = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	root.first_child = -1;
+	root.next_sibling = -1;
+	g_array_append_val (matcher->nodes, root);
+
+	return matcher;
+}
+
+static void
+filter_matcher_free (FilterMatcher *matcher)
+{
+	guint ii;
+
+	if (!matcher)
+		return;
+
+	for (ii = 0; ii < matcher->nodes->len; ii++)
+		g_slist_free (g_array_index (matcher->nodes, FilterMatcherNode, ii).rules);
+
+	g_array_free (matcher->nodes, TRUE);
+	g_hash_table_destroy (matcher->edges);
+	g_free (matcher);
+}
+
+static gint
+filter_matcher_goto (FilterMatcher *matcher,
+                     gint node,
+                     guchar byte)
+{
+	gpointer child;
+
+	child = g_hash_table_lookup (matcher->edges, GINT_TO_POINTER ((node << 8) | byte));
+
+	return child ? GPOINTER_TO_INT (child) : -1;
+}
+
+static void
+filter_matcher_add (FilterMatcher *matcher,
+                    const gchar *pattern,
+                    struct _filter_rule *rule)
+{
+	const guchar *ptr;
+	gint node = 0;
+
+	for (ptr = (const guchar *) pattern; *ptr; ptr++) {
+		gint child = filter_matcher_goto (matcher, node, *ptr);
+
+		if (child == -1) {
+			FilterMatcherNode new_node = { 0, };
+
+			child = matcher->nodes->len;
+			new_node.first_child = -1;
+			new_node.next_sibling = g_array_index (matcher->nodes, FilterMatcherNode, node).first_child;
+			g_array_append_val (matcher->nodes, new_node);
+			g_array_index (matcher->nodes, FilterMatcherNode, node).first_child = child;
+
+			g_hash_table_insert (matcher->edges, GINT_TO_POINTER ((node << 8) | *ptr), GINT_TO_POINTER (child));
+		}
+
+		node = child;
+	}
+
+	g_array_index (matcher->nodes, FilterMatcherNode, node).rules =
+		g_slist_prepend (g_array_index (matcher->nodes, FilterMatcherNode, node).rules, rule);
+}
+
+/* Sets the fail and dict links, in a breadth-first order */
+static void
+filter_matcher_build (FilterMatcher *matcher)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GQueue queue = G_QUEUE_INIT;
+	guchar *node_bytes;
+
+	/* the byte of the edge leading to each node */
+	node_bytes = g_new0 (guchar, matcher->nodes->len);
+	g_hash_table_iter_init (&iter, matcher->edges);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		node_bytes[GPOINTER_TO_INT (value)] = GPOINTER_TO_INT (key) & 0xFF;
+
+	g_queue_push_tail (&queue, GINT_TO_POINTER (0));
+
+	while (!g_queue_is_empty (&queue)) {
+		gint node = GPOINTER_TO_INT (g_queue_pop_head (&queue));
+		gint child;
+
+		for (child = g_array_index (matcher->nodes, FilterMatcherNode, node).first_child;
+		     child != -1;
+		     child = g_array_index (matcher->nodes, FilterMatcherNode, child).next_sibling) {
+			FilterMatcherNode *child_node;
+			gint fail = 0;
+
+			if (node != 0) {
+				gint state = g_array_index (matcher->nodes, FilterMatcherNode, node).fail;
+
+				while ((fail = filter_matcher_goto (matcher, state, node_bytes[child])) == -1 && state != 0)
+					state = g_array_index (matcher->nodes, FilterMatcherNode, state).fail;
+
+				if (fail == -1)
+					fail = 0;
+			}
+
+			child_node = &g_array_index (matcher->nodes, FilterMatcherNode, child);
+			child_node->fail = fail;
+			child_node->dict = g_array_index (matcher->nodes, FilterMatcherNode, fail).rules ? fail :
+				g_array_index (matcher->nodes, FilterMatcherNode, fail).dict;
+
+			g_queue_push_tail (&queue, GINT_TO_POINTER (child));
+		}
+	}
+
+	g_free (node_bytes);
+}
+
+static void
+filter_matcher_run (FilterMatcher *matcher,
+                    const gchar *text)
+{
+	const guchar *ptr;
+	gint state = 0;
+
+	for (ptr = (const guchar *) text; *ptr; ptr++) {
+		gint next, node;
+
+		while ((next = filter_matcher_goto (matcher, state, *ptr)) == -1 && state != 0)
+			state = g_array_index (matcher->nodes, FilterMatcherNode, state).fail;
+
+		state = next == -1 ? 0 : next;
+
+		for (node = state; node != 0; node = g_array_index (matcher->nodes, FilterMatcherNode, node).dict) {
+			GSList *link;
+
+			for (link = g_array_index (matcher->nodes, FilterMatcherNode, node).rules; link; link = g_slist_next (link)) {
+				struct _filter_rule *rule = link->data;
+
+				rule->index_state = FILTER_INDEX_MATCHED;
+			}
+		}
+	}
+}
+
+/* The same case folding as camel_ustrstrcase() and camel_ustrcasecmp() do */
+static gchar *
+filter_index_lower (const gchar *text)
+{
+	GString *lower;
+	const guchar *ptr;
+	gunichar c;
+
+	lower = g_string_sized_new (strlen (text));
+	ptr = (const guchar *) text;
+
+	while (ptr && (c = camel_utf8_getc (&ptr)))
+		g_string_append_unichar (lower, g_unichar_tolower (c));
+
+	return g_string_free (lower, FALSE);
+}
+
+static void
+filter_header_index_free (FilterHeaderIndex *index)
+{
+	g_slist_free (index->rules);
+	g_slist_free (index->always);
+	g_hash_table_destroy (index->exact);
+	filter_matcher_free (index->contains);
+	g_free (index);
+}
+
+static void
+filter_rule_free_compiled (struct _filter_rule *rule)
+{
+	camel_filter_search_compiled_free (rule->search);
+	rule->search = NULL;
+	g_clear_error (&rule->search_error);
+	g_clear_object (&rule->action_sexp);
+	g_free (rule->action_error);
+	rule->action_error = NULL;
+	rule->compiled = FALSE;
+	rule->indexed = FALSE;
+}
+
+static void
+filter_rule_free (struct _filter_rule *rule)
+{
+	filter_rule_free_compiled (rule);
+	g_free (rule->match);
+	g_free (rule->action);
+	g_free (rule->name);
+	g_free (rule);
+}
+
+static void
+filter_driver_add_to_index (CamelFilterDriver *driver,
+                            struct _filter_rule *rule)
+{
+	struct _KnownHeaders {
+		const gchar *header_name;
+		const gchar *info_name;
+		gboolean is_address;
+	} known_headers[] = {
+		{ "Subject", "subject", FALSE },
+		{ "From", "from", TRUE },
+		{ "To", "to", TRUE },
+		{ "Cc", "cc", TRUE }
+	};
+	FilterHeaderIndex *index = NULL;
+	camel_search_match_t how;
+	const gchar *header_name;
+	GPtrArray *values;
+	guint ii;
+
+	if (!camel_filter_search_compiled_get_header_test (rule->search, &header_name, &how, &values))
+		return;
+
+	for (ii = 0; ii < G_N_ELEMENTS (known_headers); ii++) {
+		if (g_ascii_strcasecmp (header_name, known_headers[ii].header_name) == 0)
+			break;
+	}
+
+	if (ii == G_N_ELEMENTS (known_headers)) {
+		g_ptr_array_free (values, TRUE);
+		return;
+	}
+
+	if (!driver->priv->header_indexes)
+		driver->priv->header_indexes = g_ptr_array_new_with_free_func ((GDestroyNotify) filter_header_index_free);
+
+	for (ii = 0; ii < driver->priv->header_indexes->len; ii++) {
+		FilterHeaderIndex *known = driver->priv->header_indexes->pdata[ii];
+
+		if (g_ascii_strcasecmp (header_name, known->header_name) == 0) {
+			index = known;
+			break;
+		}
+	}
+
+	if (!index) {
+		for (ii = 0; ii < G_N_ELEMENTS (known_headers); ii++) {
+			if (g_ascii_strcasecmp (header_name, known_headers[ii].header_name) == 0)
+				break;
+		}
+
+		index = g_new0 (FilterHeaderIndex, 1);
+		index->header_name = known_headers[ii].header_name;
+		index->info_name = known_headers[ii].info_name;
+		index->is_address = known_headers[ii].is_address;
+		index->exact = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_slist_free);
+		index->contains = filter_matcher_new ();
+
+		g_ptr_array_add (driver->priv->header_indexes, index);
+	}
+
+	index->rules = g_slist_prepend (index->rules, rule);
+
+	for (ii = 0; ii < values->len; ii++) {
+		const gchar *value = values->pdata[ii];
+		gchar *lower;
+
+		/* a match for "" against any header always matches */
+		if (!*value) {
+			index->always = g_slist_prepend (index->always, rule);
+			continue;
+		}
+
+		lower = filter_index_lower (value);
+
+		if (how == CAMEL_SEARCH_MATCH_EXACT) {
+			GSList *rules;
+
+			rules = g_hash_table_lookup (index->exact, lower);
+			if (rules) {
+				/* the list head stays in the table */
+				rules->next = g_slist_prepend (rules->next, rule);
+				g_free (lower);
+			} else {
+				g_hash_table_insert (index->exact, lower, g_slist_prepend (NULL, rule));
+			}
+		} else {
+			filter_matcher_add (index->contains, lower, rule);
+			g_free (lower);
+		}
+	}
+
+	g_ptr_array_free (values, TRUE);
+
+	rule->indexed = TRUE;
+}
+
+/* Parses all the rules, which were not parsed yet,
+ * and groups the simple header tests by the header */
+static void
+filter_driver_compile_rules (CamelFilterDriver *driver)
+{
+	GList *link;
+	guint ii;
+
+	if (driver->priv->rules_compiled)
+		return;
+
+	if (driver->priv->header_indexes) {
+		g_ptr_array_free (driver->priv->header_indexes, TRUE);
+		driver->priv->header_indexes = NULL;
+	}
+
+	for (link = g_queue_peek_head_link (&driver->priv->rules); link; link = g_list_next (link)) {
+		struct _filter_rule *rule = link->data;
+
+		if (!rule->compiled) {
+			rule->compiled = TRUE;
+			rule->search = camel_filter_search_compile (rule->match, &rule->search_error);
+
+			rule->action_sexp = filter_driver_new_sexp (driver);
+			camel_sexp_input_text (rule->action_sexp, rule->action, strlen (rule->action));
+			if (camel_sexp_parse (rule->action_sexp) == -1) {
+				rule->action_error = g_strdup (camel_sexp_error (rule->action_sexp));
+				g_clear_object (&rule->action_sexp);
+			}
+		}
+
+		rule->indexed = FALSE;
+
+		if (rule->search)
+			filter_driver_add_to_index (driver, rule);
+	}
+
+	for (ii = 0; driver->priv->header_indexes && ii < driver->priv->header_indexes->len; ii++) {
+		FilterHeaderIndex *index = driver->priv->header_indexes->pdata[ii];
+
+		filter_matcher_build (index->contains);
+	}
+
+	driver->priv->rules_compiled = TRUE;
+}
+
+static void
+filter_header_index_match_text (FilterHeaderIndex *index,
+                                const gchar *text)
+{
+	GSList *link;
+	gchar *lower;
+
+	if (!text)
+		return;
+
+	lower = filter_index_lower (text);
+
+	for (link = g_hash_table_lookup (index->exact, lower); link; link = g_slist_next (link)) {
+		struct _filter_rule *rule = link->data;
+
+		rule->index_state = FILTER_INDEX_MATCHED;
+	}
+
+	filter_matcher_run (index->contains, lower);
+
+	g_free (lower);
+}
+
+/* Decides all the indexed rules for the @info, which has no headers,
+ * the same way as camel_search_header_match() would do for each of them */
+static void
+filter_driver_match_indexes (CamelFilterDriver *driver,
+                             CamelMessageInfo *info)
+{
+	guint ii;
+
+	for (ii = 0; ii < driver->priv->header_indexes->len; ii++) {
+		FilterHeaderIndex *index = driver->priv->header_indexes->pdata[ii];
+		const gchar *value;
+		gchar *info_value = NULL, *unfolded;
+		const guchar *ptr;
+		GSList *link;
+		gunichar c;
+
+		g_object_get (G_OBJECT (info), index->info_name, &info_value, NULL);
+
+		/* unknown in the summary, thus the rules are evaluated */
+		if (!info_value) {
+			for (link = index->rules; link; link = g_slist_next (link)) {
+				struct _filter_rule *rule = link->data;
+
+				rule->index_state = FILTER_INDEX_UNDECIDED;
+			}
+
+			continue;
+		}
+
+		for (link = index->rules; link; link = g_slist_next (link)) {
+			struct _filter_rule *rule = link->data;
+
+			rule->index_state = FILTER_INDEX_NOMATCH;
+		}
+
+		for (link = index->always; link; link = g_slist_next (link)) {
+			struct _filter_rule *rule = link->data;
+
+			rule->index_state = FILTER_INDEX_MATCHED;
+		}
+
+		unfolded = camel_header_unfold (info_value);
+		value = unfolded ? unfolded : info_value;
+
+		ptr = (const guchar *) value;
+		while ((c = camel_utf8_getc (&ptr)) && g_unichar_isspace (c))
+			value = (const gchar *) ptr;
+
+		if (index->is_address) {
+			CamelInternetAddress *cia;
+			const gchar *name, *addr;
+			gint jj;
+
+			filter_header_index_match_text (index, value);
+
+			cia = camel_internet_address_new ();
+			camel_address_decode (CAMEL_ADDRESS (cia), value);
+
+			for (jj = 0; camel_internet_address_get (cia, jj, &name, &addr); jj++) {
+				filter_header_index_match_text (index, name);
+				filter_header_index_match_text (index, addr);
+			}
+
+			g_object_unref (cia);
+		} else {
+			gchar *decoded;
+
+			decoded = camel_header_decode_string (value, NULL);
+			filter_header_index_match_text (index, decoded ? decoded : "");
+			g_free (decoded);
+		}
+
+		g_free (unfolded);
+		g_free (info_value);
+	}
+}
+
 static void
 filter_driver_dispose (GObject *object)
 {
@@ -227,12 +741,11 @@ filter_driver_finalize (GObject *object)
 
 	g_object_unref (priv->eval);
 
-	while ((node = g_queue_pop_head (&priv->rules)) != NULL) {
-		g_free (node->match);
-		g_free (node->action);
-		g_free (node->name);
-		g_free (node);
-	}
+	while ((node = g_queue_pop_head (&priv->rules)) != NULL)
+		filter_rule_free (node);
+
+	if (priv->header_indexes)
+		g_ptr_array_free (priv->header_indexes, TRUE);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_filter_driver_parent_class)->finalize (object);
@@ -253,28 +766,11 @@ camel_filter_driver_class_init (CamelFilterDriverClass *class)
 static void
 camel_filter_driver_init (CamelFilterDriver *filter_driver)
 {
-	gint ii;
-
 	filter_driver->priv = CAMEL_FILTER_DRIVER_GET_PRIVATE (filter_driver);
 
 	g_queue_init (&filter_driver->priv->rules);
 
-	filter_driver->priv->eval = camel_sexp_new ();
-
-	/* Load in builtin symbols */
-	for (ii = 0; ii < G_N_ELEMENTS (symbols); ii++) {
-		if (symbols[ii].type == 1) {
-			camel_sexp_add_ifunction (
-				filter_driver->priv->eval, 0,
-				symbols[ii].name, (CamelSExpIFunc)
-				symbols[ii].func, filter_driver);
-		} else {
-			camel_sexp_add_function (
-				filter_driver->priv->eval, 0,
-				symbols[ii].name, symbols[ii].func,
-				filter_driver);
-		}
-	}
+	filter_driver->priv->eval = filter_driver_new_sexp (filter_driver);
 
 	filter_driver->priv->globals =
 		g_hash_table_new (g_str_hash, g_str_equal);
@@ -448,12 +944,13 @@ camel_filter_driver_add_rule (CamelFilterDriver *d,
 {
 	struct _filter_rule *node;
 
-	node = g_malloc (sizeof (*node));
+	node = g_new0 (struct _filter_rule, 1);
 	node->match = g_strdup (match);
 	node->action = g_strdup (action);
 	node->name = g_strdup (name);
 
 	g_queue_push_tail (&d->priv->rules, node);
+	d->priv->rules_compiled = FALSE;
 }
 
 /**
@@ -479,11 +976,8 @@ camel_filter_driver_remove_rule_by_name (CamelFilterDriver *d,
 		struct _filter_rule *rule = link->data;
 
 		g_queue_delete_link (&d->priv->rules, link);
-
-		g_free (rule->match);
-		g_free (rule->action);
-		g_free (rule->name);
-		g_free (rule);
+		filter_rule_free (rule);
+		d->priv->rules_compiled = FALSE;
 
 		return TRUE;
 	}
@@ -1727,6 +2221,11 @@ get_message_cb (gpointer data,
 
 		message = camel_folder_get_message_sync (
 			msgdata->priv->source, uid, cancellable, error);
+
+		/* download it only once for all the rules; the actions
+		 * still transfer the message by its UID, when possible */
+		if (message)
+			msgdata->priv->message = g_object_ref (message);
 	}
 
 	if (message != NULL && camel_mime_message_get_source (message) == NULL)
@@ -1771,6 +2270,7 @@ camel_filter_driver_filter_message (CamelFilterDriver *driver,
 	CamelFilterDriverPrivate *p = driver->priv;
 	gboolean freeinfo = FALSE;
 	gboolean filtered = FALSE;
+	gboolean use_indexes;
 	CamelSExpResult *r;
 	GList *list, *link;
 	gint result;
@@ -1824,6 +2324,16 @@ camel_filter_driver_filter_message (CamelFilterDriver *driver,
 		original_store_uid = NULL;
 	}
 
+	filter_driver_compile_rules (driver);
+
+	/* The simple header rules are decided at once from the summary values;
+	 * when logging, each rule is evaluated, to have its search logged.
+	 * The index states are left from the previous message otherwise. */
+	use_indexes = driver->priv->header_indexes && info &&
+		!camel_message_info_get_headers (info) && !driver->priv->logfile;
+	if (use_indexes)
+		filter_driver_match_indexes (driver, info);
+
 	list = g_queue_peek_head_link (&driver->priv->rules);
 	result = CAMEL_SEARCH_NOMATCH;
 	filtered = list != NULL;
@@ -1852,9 +2362,16 @@ camel_filter_driver_filter_message (CamelFilterDriver *driver,
 
 		camel_filter_driver_log (driver, FILTER_LOG_START, "%s", rule->name);
 
-		result = camel_filter_search_match_with_log (
-			driver->priv->session, get_message_cb, &data, driver->priv->info,
-			original_store_uid, source, rule->match, driver->priv->logfile, cancellable, &driver->priv->error);
+		if (!rule->search) {
+			g_propagate_error (&driver->priv->error, g_error_copy (rule->search_error));
+			result = CAMEL_SEARCH_ERROR;
+		} else if (use_indexes && rule->indexed && rule->index_state != FILTER_INDEX_UNDECIDED) {
+			result = rule->index_state == FILTER_INDEX_MATCHED ? CAMEL_SEARCH_MATCHED : CAMEL_SEARCH_NOMATCH;
+		} else {
+			result = camel_filter_search_compiled_match (
+				rule->search, driver->priv->session, get_message_cb, &data, driver->priv->info,
+				original_store_uid, source, driver->priv->logfile, cancellable, &driver->priv->error);
+		}
 
 		switch (result) {
 		case CAMEL_SEARCH_ERROR:
@@ -1870,20 +2387,17 @@ camel_filter_driver_filter_message (CamelFilterDriver *driver,
 			camel_filter_driver_log (driver, FILTER_LOG_INFO, "   Filter '%s' matched\n", rule->name);
 
 			/* perform necessary filtering actions */
-			camel_sexp_input_text (
-				driver->priv->eval,
-				rule->action, strlen (rule->action));
-			if (camel_sexp_parse (driver->priv->eval) == -1) {
+			if (!rule->action_sexp) {
 				g_set_error (
 					error, CAMEL_ERROR,
 					CAMEL_ERROR_GENERIC,
 					_("Error parsing filter “%s”: %s: %s"),
 					rule->name,
-					camel_sexp_error (driver->priv->eval),
+					rule->action_error,
 					rule->action);
 				goto error;
 			}
-			r = camel_sexp_eval (driver->priv->eval);
+			r = camel_sexp_eval (rule->action_sexp);
 			if (driver->priv->error != NULL) {
 				g_prefix_error (
 					&driver->priv->error,
@@ -1898,11 +2412,11 @@ camel_filter_driver_filter_message (CamelFilterDriver *driver,
 					CAMEL_ERROR_GENERIC,
 					_("Error executing filter “%s”: %s: %s"),
 					rule->name,
-					camel_sexp_error (driver->priv->eval),
+					camel_sexp_error (rule->action_sexp),
 					rule->action);
 				goto error;
 			}
-			camel_sexp_result_free (driver->priv->eval, r);
+			camel_sexp_result_free (rule->action_sexp, r);
 		case CAMEL_SEARCH_NOMATCH:
 			camel_filter_driver_log (driver, FILTER_LOG_INFO, "   Filter '%s' did not match\n", rule->name);
 			break;
@@ -1264,88 +1264,263 @@ camel_search_result_to_string (gint value)
 	       value == CAMEL_SEARCH_MATCHED ? "MATCHED" : "???";
 }
 
+struct _CamelFilterSearchCompiled {
+	gchar *expression;
+	CamelSExp *sexp;
+	FilterMessageSearch fms;
+
+	/* the parsed expression, valid while the sexp lives */
+	CamelSExpTerm *root;
+	gboolean classifying;
+};
+
+/* The expression is parsed wrapped into this function, which gives
+ * the root of the parsed tree when classifying it, and evaluates it
+ * otherwise. */
+#define ROOT_FUNCTION_NAME "filter-search-root"
+
+static CamelSExpResult *
+filter_search_root (struct _CamelSExp *f,
+                    gint argc,
+                    struct _CamelSExpTerm **argv,
+                    CamelFilterSearchCompiled *compiled)
+{
+	CamelSExpResult *r = NULL;
+	gint ii;
+
+	if (compiled->classifying) {
+		compiled->root = argc == 1 ? argv[0] : NULL;
+		argc = 0;
+	}
+
+	for (ii = 0; ii < argc; ii++) {
+		if (r)
+			camel_sexp_result_free (f, r);
+		r = camel_sexp_term_eval (f, argv[ii]);
+	}
+
+	if (!r) {
+		r = camel_sexp_result_new (f, CAMEL_SEXP_RES_BOOL);
+		r->value.boolean = FALSE;
+	}
+
+	return r;
+}
+
 /**
- * camel_filter_search_match_with_log:
+ * camel_filter_search_compile: (skip)
+ * @expression: a filter search expression
+ * @error: return location for a #GError, or %NULL
+ *
+ * Parses @expression once, to be matched against many messages
+ * with camel_filter_search_compiled_match().
+ *
+ * Returns: a new #CamelFilterSearchCompiled, or %NULL on error; free it
+ *    with camel_filter_search_compiled_free()
+ *
+ * Since: 3.28
+ **/
+CamelFilterSearchCompiled *
+camel_filter_search_compile (const gchar *expression,
+                             GError **error)
+{
+	CamelFilterSearchCompiled *compiled;
+	CamelSExpResult *result;
+	gchar *text;
+	gint ii;
+
+	g_return_val_if_fail (expression != NULL, NULL);
+
+	compiled = g_new0 (CamelFilterSearchCompiled, 1);
+	compiled->expression = g_strdup (expression);
+	compiled->sexp = camel_sexp_new ();
+
+	for (ii = 0; ii < G_N_ELEMENTS (symbols); ii++) {
+		if (symbols[ii].type == 1)
+			camel_sexp_add_ifunction (compiled->sexp, 0, symbols[ii].name, (CamelSExpIFunc) symbols[ii].func, &compiled->fms);
+		else
+			camel_sexp_add_function (compiled->sexp, 0, symbols[ii].name, symbols[ii].func, &compiled->fms);
+	}
+
+	camel_sexp_add_ifunction (compiled->sexp, 0, ROOT_FUNCTION_NAME, (CamelSExpIFunc) filter_search_root, compiled);
+
+	text = g_strconcat ("(" ROOT_FUNCTION_NAME " ", expression, ")", NULL);
+	camel_sexp_input_text (compiled->sexp, text, strlen (text));
+	g_free (text);
+
+	if (camel_sexp_parse (compiled->sexp) == -1) {
+		/* A filter search is a search through your filters,
+		 * ie. your filters is the corpus being searched thru. */
+		g_set_error (
+			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+			_("Error executing filter search: %s: %s"),
+			camel_sexp_error (compiled->sexp), expression);
+		camel_filter_search_compiled_free (compiled);
+		return NULL;
+	}
+
+	compiled->classifying = TRUE;
+	result = camel_sexp_eval (compiled->sexp);
+	compiled->classifying = FALSE;
+
+	if (result)
+		camel_sexp_result_free (compiled->sexp, result);
+
+	return compiled;
+}
+
+/**
+ * camel_filter_search_compiled_free: (skip)
+ * @compiled: (nullable): a #CamelFilterSearchCompiled, or %NULL
+ *
+ * Frees @compiled.
+ *
+ * Since: 3.28
+ **/
+void
+camel_filter_search_compiled_free (CamelFilterSearchCompiled *compiled)
+{
+	if (!compiled)
+		return;
+
+	g_clear_object (&compiled->sexp);
+	g_free (compiled->expression);
+	g_free (compiled);
+}
+
+/**
+ * camel_filter_search_compiled_get_header_test: (skip)
+ * @compiled: a #CamelFilterSearchCompiled
+ * @out_header_name: (out): the tested header name
+ * @out_how: (out): how the header values are compared
+ * @out_values: (out) (transfer container): the values to compare with
+ *
+ * Checks whether the whole expression of @compiled is a single header test,
+ * like "(match-all (header-contains \"From\" \"a\" \"b\"))", which matches
+ * when the header matches any of the values. The returned strings are owned
+ * by @compiled. Only header-contains and header-matches are recognized.
+ *
+ * Returns: whether @compiled is a single header test
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_filter_search_compiled_get_header_test (CamelFilterSearchCompiled *compiled,
+                                              const gchar **out_header_name,
+                                              camel_search_match_t *out_how,
+                                              GPtrArray **out_values)
+{
+	CamelSExpTerm *term;
+	const gchar *name;
+	gint ii;
+
+	g_return_val_if_fail (compiled != NULL, FALSE);
+	g_return_val_if_fail (out_header_name != NULL, FALSE);
+	g_return_val_if_fail (out_how != NULL, FALSE);
+	g_return_val_if_fail (out_values != NULL, FALSE);
+
+	term = compiled->root;
+
+	/* single-argument wrappers do not change the result */
+	while (term && (term->type == CAMEL_SEXP_TERM_FUNC || term->type == CAMEL_SEXP_TERM_IFUNC) &&
+	       term->value.func.termcount == 1 && (
+	       g_str_equal (term->value.func.sym->name, "match-all") ||
+	       g_str_equal (term->value.func.sym->name, "and") ||
+	       g_str_equal (term->value.func.sym->name, "or"))) {
+		term = term->value.func.terms[0];
+	}
+
+	if (!term || (term->type != CAMEL_SEXP_TERM_FUNC && term->type != CAMEL_SEXP_TERM_IFUNC) ||
+	    term->value.func.termcount < 2)
+		return FALSE;
+
+	name = term->value.func.sym->name;
+
+	if (g_str_equal (name, "header-contains"))
+		*out_how = CAMEL_SEARCH_MATCH_CONTAINS;
+	else if (g_str_equal (name, "header-matches"))
+		*out_how = CAMEL_SEARCH_MATCH_EXACT;
+	else
+		return FALSE;
+
+	for (ii = 0; ii < term->value.func.termcount; ii++) {
+		if (term->value.func.terms[ii]->type != CAMEL_SEXP_TERM_STRING)
+			return FALSE;
+	}
+
+	*out_header_name = term->value.func.terms[0]->value.string;
+	*out_values = g_ptr_array_sized_new (term->value.func.termcount - 1);
+
+	for (ii = 1; ii < term->value.func.termcount; ii++)
+		g_ptr_array_add (*out_values, term->value.func.terms[ii]->value.string);
+
+	return TRUE;
+}
+
+/**
+ * camel_filter_search_compiled_match: (skip)
+ * @compiled: a #CamelFilterSearchCompiled
  * @session:
- * @get_message: (scope async): function to retrieve the message if necessary
+ * @get_message: (scope call): function to retrieve the message if necessary
  * @user_data: data for above
  * @info:
  * @source:
  * @folder: in which folder the message is stored
- * @expression:
  * @logfile: (nullable): an optional log file to write logging information to, or %NULL
  * @cancellable: (allow-none): a #GCancellable, or %NULL
  * @error: return location for a #GError, or %NULL
  *
+ * Like camel_filter_search_match_with_log(), only with an already parsed
+ * expression. The @compiled can be used by one caller at a time.
+ *
  * Returns: one of CAMEL_SEARCH_MATCHED, CAMEL_SEARCH_NOMATCH, or
  * CAMEL_SEARCH_ERROR.
  *
- * Since 3.24
+ * Since: 3.28
  **/
 gint
-camel_filter_search_match_with_log (CamelSession *session,
-				    CamelFilterSearchGetMessageFunc get_message,
-				    gpointer user_data,
-				    CamelMessageInfo *info,
-				    const gchar *source,
-				    CamelFolder *folder,
-				    const gchar *expression,
-				    FILE *logfile,
-				    GCancellable *cancellable,
-				    GError **error)
+camel_filter_search_compiled_match (CamelFilterSearchCompiled *compiled,
+                                    CamelSession *session,
+                                    CamelFilterSearchGetMessageFunc get_message,
+                                    gpointer user_data,
+                                    CamelMessageInfo *info,
+                                    const gchar *source,
+                                    CamelFolder *folder,
+                                    FILE *logfile,
+                                    GCancellable *cancellable,
+                                    GError **error)
 {
-	FilterMessageSearch fms;
-	CamelSExp *sexp;
+	FilterMessageSearch *fms;
 	CamelSExpResult *result;
 	gint retval;
 	GError *local_error = NULL;
-	gint i;
-
-	fms.session = session;
-	fms.get_message = get_message;
-	fms.get_message_data = user_data;
-	fms.message = NULL;
-	fms.info = info;
-	fms.source = source;
-	fms.folder = folder;
-	fms.logfile = logfile;
-	fms.cancellable = cancellable;
-	fms.error = &local_error;
-
-	sexp = camel_sexp_new ();
-
-	for (i = 0; i < G_N_ELEMENTS (symbols); i++) {
-		if (symbols[i].type == 1)
-			camel_sexp_add_ifunction (sexp, 0, symbols[i].name, (CamelSExpIFunc) symbols[i].func, &fms);
-		else
-			camel_sexp_add_function (sexp, 0, symbols[i].name, symbols[i].func, &fms);
-	}
-
-	camel_sexp_input_text (sexp, expression, strlen (expression));
-	if (camel_sexp_parse (sexp) == -1) {
-		if (!local_error) {
-			/* A filter search is a search through your filters,
-			 * ie. your filters is the corpus being searched thru. */
-			g_set_error (
-				&local_error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
-				_("Error executing filter search: %s: %s"),
-				camel_sexp_error (sexp), expression);
-		}
-		goto error;
-	}
 
-	result = camel_sexp_eval (sexp);
+	g_return_val_if_fail (compiled != NULL, CAMEL_SEARCH_ERROR);
+
+	fms = &compiled->fms;
+	fms->session = session;
+	fms->get_message = get_message;
+	fms->get_message_data = user_data;
+	fms->message = NULL;
+	fms->info = info;
+	fms->source = source;
+	fms->folder = folder;
+	fms->logfile = logfile;
+	fms->cancellable = cancellable;
+	fms->error = &local_error;
+
+	result = camel_sexp_eval (compiled->sexp);
 	if (result == NULL) {
 		if (!local_error)
 			g_set_error (
 				&local_error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 				_("Error executing filter search: %s: %s"),
-				camel_sexp_error (sexp), expression);
+				camel_sexp_error (compiled->sexp), compiled->expression);
 		goto error;
 	}
 
 	if (local_error) {
-		camel_sexp_result_free (sexp, result);
+		camel_sexp_result_free (compiled->sexp, result);
 		goto error;
 	}
 
@@ -1354,42 +1529,100 @@ camel_filter_search_match_with_log (CamelSession *session,
 	else
 		retval = CAMEL_SEARCH_NOMATCH;
 
-	camel_sexp_result_free (sexp, result);
-	g_object_unref (sexp);
-
-	if (fms.message)
-		g_object_unref (fms.message);
+	camel_sexp_result_free (compiled->sexp, result);
 
 	if (logfile) {
-		camel_filter_search_log (&fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as %s",
+		camel_filter_search_log (fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as %s",
 			camel_message_info_get_uid (info), camel_message_info_get_subject (info),
 			folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
 			folder ? camel_folder_get_full_name (folder) : "NULL",
 			camel_search_result_to_string (retval));
 	}
 
+	g_clear_object (&fms->message);
+	fms->error = NULL;
+
 	return retval;
 
  error:
-	if (fms.message)
-		g_object_unref (fms.message);
-
-	g_object_unref (sexp);
-
 	if (logfile) {
-		camel_filter_search_log (&fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
+		camel_filter_search_log (fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
 			camel_message_info_get_uid (info), camel_message_info_get_subject (info),
 			folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
 			folder ? camel_folder_get_full_name (folder) : "NULL",
 			local_error ? local_error->message : "Unknown error");
 	}
 
+	g_clear_object (&fms->message);
+	fms->error = NULL;
+
 	if (local_error)
 		g_propagate_error (error, local_error);
 
 	return CAMEL_SEARCH_ERROR;
 }
 
+/**
+ * camel_filter_search_match_with_log:
+ * @session:
+ * @get_message: (scope async): function to retrieve the message if necessary
+ * @user_data: data for above
+ * @info:
+ * @source:
+ * @folder: in which folder the message is stored
+ * @expression:
+ * @logfile: (nullable): an optional log file to write logging information to, or %NULL
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Returns: one of CAMEL_SEARCH_MATCHED, CAMEL_SEARCH_NOMATCH, or
+ * CAMEL_SEARCH_ERROR.
+ *
+ * Since 3.24
+ **/
+gint
+camel_filter_search_match_with_log (CamelSession *session,
+				    CamelFilterSearchGetMessageFunc get_message,
+				    gpointer user_data,
+				    CamelMessageInfo *info,
+				    const gchar *source,
+				    CamelFolder *folder,
+				    const gchar *expression,
+				    FILE *logfile,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	CamelFilterSearchCompiled *compiled;
+	GError *local_error = NULL;
+	gint retval;
+
+	compiled = camel_filter_search_compile (expression, &local_error);
+	if (!compiled) {
+		if (logfile) {
+			FilterMessageSearch fms = { 0, };
+
+			fms.logfile = logfile;
+
+			camel_filter_search_log (&fms, "Finished test of message uid:%s subject:'%s' from '%s : %s' as ERROR: '%s'",
+				camel_message_info_get_uid (info), camel_message_info_get_subject (info),
+				folder ? camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))) : "NULL",
+				folder ? camel_folder_get_full_name (folder) : "NULL",
+				local_error ? local_error->message : "Unknown error");
+		}
+
+		g_propagate_error (error, local_error);
+
+		return CAMEL_SEARCH_ERROR;
+	}
+
+	retval = camel_filter_search_compiled_match (compiled, session, get_message, user_data,
+		info, source, folder, logfile, cancellable, error);
+
+	camel_filter_search_compiled_free (compiled);
+
+	return retval;
+}
+
 /**
  * camel_filter_search_match:
  * @session:
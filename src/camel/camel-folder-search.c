@@ -67,6 +67,7 @@ struct _CamelFolderSearchPrivate {
 	CamelMessageInfo *current; /* current message info, when searching one by one */
 	CamelMimeMessage *current_message; /* cache of current message, if required */
 	CamelIndex *body_index;
+	GHashTable *body_index_pending; /* uids not in the body_index yet */
 
 	GCancellable *cancellable;
 	GError **error;
@@ -642,6 +643,50 @@ match_words_message (CamelFolderSearch *search,
 	return truth;
 }
 
+static gboolean
+search_uid_is_indexed (CamelFolderSearch *search,
+                       const gchar *uid)
+{
+	return !search->priv->body_index_pending ||
+		!g_hash_table_contains (search->priv->body_index_pending, uid);
+}
+
+/* the messages waiting to be indexed are matched by their content,
+ * instead of by what the body index (possibly still) says about them */
+static void
+match_words_pending (CamelFolderSearch *search,
+                     struct _camel_search_words *words,
+                     GPtrArray *matches,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	GPtrArray *v;
+	gint i;
+
+	if (!search->priv->body_index_pending ||
+	    !g_hash_table_size (search->priv->body_index_pending))
+		return;
+
+	for (i = 0; i < matches->len;) {
+		if (search_uid_is_indexed (search, g_ptr_array_index (matches, i)))
+			i++;
+		else
+			g_ptr_array_remove_index_fast (matches, i);
+	}
+
+	v = camel_folder_search_get_current_summary (search);
+
+	for (i = 0; i < v->len && !g_cancellable_is_cancelled (cancellable); i++) {
+		gchar *uid = g_ptr_array_index (v, i);
+
+		if (!search_uid_is_indexed (search, uid) &&
+		    match_words_message (search,
+				search->priv->folder, uid, words,
+				cancellable, error))
+			g_ptr_array_add (matches, uid);
+	}
+}
+
 static GPtrArray *
 match_words_messages (CamelFolderSearch *search,
                       struct _camel_search_words *words,
@@ -665,13 +710,16 @@ match_words_messages (CamelFolderSearch *search,
 		for (i = 0; i < indexed->len && !g_cancellable_is_cancelled (cancellable); i++) {
 			const gchar *uid = g_ptr_array_index (indexed, i);
 
-			if (match_words_message (search,
+			if (search_uid_is_indexed (search, uid) &&
+			    match_words_message (search,
 					search->priv->folder, uid, words,
 					cancellable, error))
 				g_ptr_array_add (matches, (gchar *) uid);
 		}
 
 		g_ptr_array_free (indexed, TRUE);
+
+		match_words_pending (search, words, matches, cancellable, error);
 	} else {
 		GPtrArray *v = camel_folder_search_get_current_summary (search);
 
@@ -737,6 +785,7 @@ folder_search_dispose (GObject *object)
 	CamelFolderSearch *search = CAMEL_FOLDER_SEARCH (object);
 
 	g_clear_object (&search->priv->sexp);
+	g_clear_pointer (&search->priv->body_index_pending, g_hash_table_unref);
 
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (camel_folder_search_parent_class)->dispose (object);
@@ -1114,7 +1163,8 @@ folder_search_body_contains (CamelSExp *sexp,
 				if (argv[i]->type == CAMEL_SEXP_RES_STRING) {
 					words = camel_search_words_split ((const guchar *) argv[i]->value.string);
 					truth = TRUE;
-					if ((words->type & CAMEL_SEARCH_WORD_COMPLEX) == 0 && search->priv->body_index) {
+					if ((words->type & CAMEL_SEARCH_WORD_COMPLEX) == 0 && search->priv->body_index &&
+					    search_uid_is_indexed (search, camel_message_info_get_uid (search->priv->current))) {
 						for (j = 0; j < words->len && truth; j++)
 							truth = match_message_index (
 								search->priv->body_index,
@@ -1157,6 +1207,7 @@ folder_search_body_contains (CamelSExp *sexp,
 					words = camel_search_words_split ((const guchar *) argv[i]->value.string);
 					if ((words->type & CAMEL_SEARCH_WORD_COMPLEX) == 0 && search->priv->body_index) {
 						matches = match_words_index (search, words, search->priv->cancellable, error);
+						match_words_pending (search, words, matches, search->priv->cancellable, error);
 					} else {
 						matches = match_words_messages (search, words, search->priv->cancellable, error);
 					}
@@ -2006,6 +2057,34 @@ camel_folder_search_set_body_index (CamelFolderSearch *search,
 	search->priv->body_index = body_index;
 }
 
+/**
+ * camel_folder_search_set_body_index_pending:
+ * @search: a #CamelFolderSearch
+ * @pending: (element-type utf8 utf8) (nullable): a set of message UID-s, or %NULL
+ *
+ * Sets which messages are not in the body index yet, because they
+ * are waiting to be indexed. Such messages are searched by their
+ * content, the same as without any body index. The @pending is
+ * not modified and it should not be modified by the caller while
+ * the search is running.
+ *
+ * Since: 3.28
+ **/
+void
+camel_folder_search_set_body_index_pending (CamelFolderSearch *search,
+                                            GHashTable *pending)
+{
+	g_return_if_fail (CAMEL_IS_FOLDER_SEARCH (search));
+
+	if (pending != NULL)
+		g_hash_table_ref (pending);
+
+	if (search->priv->body_index_pending != NULL)
+		g_hash_table_unref (search->priv->body_index_pending);
+
+	search->priv->body_index_pending = pending;
+}
+
 static gboolean
 do_search_in_memory (CamelFolder *search_in_folder,
                      const gchar *expr,
@@ -2214,6 +2293,7 @@ fail:
 	search->priv->summary = NULL;
 	search->priv->summary_set = NULL;
 	search->priv->body_index = NULL;
+	g_clear_pointer (&search->priv->body_index_pending, g_hash_table_unref);
 
 	return count;
 }
@@ -2394,6 +2474,7 @@ fail:
 	search->priv->summary = NULL;
 	search->priv->summary_set = NULL;
 	search->priv->body_index = NULL;
+	g_clear_pointer (&search->priv->body_index_pending, g_hash_table_unref);
 
 	if (error && *error) {
 		camel_folder_search_free_result (search, matches);
@@ -290,6 +290,9 @@ gboolean	camel_folder_search_get_summary_empty
 void		camel_folder_search_set_body_index
 						(CamelFolderSearch *search,
 						 CamelIndex *body_index);
+void		camel_folder_search_set_body_index_pending
+						(CamelFolderSearch *search,
+						 GHashTable *pending);
 
 GPtrArray *	camel_folder_search_search	(CamelFolderSearch *search,
 						 const gchar *expr,
@@ -40,6 +40,34 @@
 #include <sys/time.h>
 #endif
 
+/* Summaries of at least this many messages have their message-ids
+ * and references read in parallel, in chunks of this size */
+#define PARALLEL_IDS_CHUNK_SIZE 4096
+
+/* The thread tree is updated in place, when there are at most 1/8
+ * as many added and removed messages as messages in the tree */
+#define INCREMENTAL_MAX_CHANGES_DIVISOR 8
+
+typedef struct _CamelFolderThreadPrivate {
+	CamelFolderThread thread; /* must be the first member */
+
+	/* Nodes, which thread_summary() moved from a pseudo root node
+	 * under its first child; they follow the child's own children */
+	GHashTable *adopted;		/* CamelFolderThreadNode * */
+
+	/* Index of the tree for in-place updates, built on demand */
+	gboolean index_valid;
+	GHashTable *uid_table;		/* const gchar *uid ~> CamelFolderThreadNode * */
+	GHashTable *id_table;		/* CamelSummaryMessageID * ~> the first CamelFolderThreadNode * in the order */
+	GHashTable *id_count;		/* CamelSummaryMessageID * ~> how many messages have the message-id */
+	GHashTable *ref_count;		/* CamelSummaryMessageID * ~> how many times the message-id is referenced */
+	GHashTable *subject_count;	/* gchar *root subject ~> how many messages have it, when threading by subject */
+	CamelFolderThreadNode *root_tail;
+	guint32 last_order;
+} CamelFolderThreadPrivate;
+
+#define FOLDER_THREAD_PRIVATE(thread) ((CamelFolderThreadPrivate *) (thread))
+
 G_DEFINE_BOXED_TYPE (CamelFolderThread,
 		camel_folder_thread_messages,
 		camel_folder_thread_messages_ref,
@@ -189,14 +217,50 @@ skip_list_ids (gchar *s)
 	return s;
 }
 
+/* Skips the list ids and the "Re:" prefixes of @s, returns NULL when
+ * nothing is left; @out_re is set when there was any "Re:" prefix */
+static gchar *
+strip_root_subject (gchar *s,
+                    gboolean *out_re)
+{
+	gchar *p;
+
+	*out_re = FALSE;
+
+	if (s == NULL)
+		return NULL;
+
+	s = skip_list_ids (s);
+
+	while (*s) {
+		while (isspace (*s))
+			s++;
+		if (s[0] == 0)
+			break;
+		if ((s[0] == 'r' || s[0]=='R')
+		    && (s[1] == 'e' || s[1]=='E')) {
+			p = s + 2;
+			while (isdigit (*p) || (ispunct (*p) && (*p != ':')))
+				p++;
+			if (*p == ':') {
+				*out_re = TRUE;
+				s = skip_list_ids (p + 1);
+			} else
+				break;
+		} else
+			break;
+	}
+
+	return *s ? s : NULL;
+}
+
 static gchar *
 get_root_subject (CamelFolderThreadNode *c)
 {
-	gchar *s, *p;
+	gchar *s;
 	CamelFolderThreadNode *scan;
 
 	s = NULL;
-	c->re = FALSE;
 	if (c->message)
 		s = (gchar *) camel_message_info_get_subject (c->message);
 	else {
@@ -210,31 +274,8 @@ get_root_subject (CamelFolderThreadNode *c)
 			scan = scan->next;
 		}
 	}
-	if (s != NULL) {
-		s = skip_list_ids (s);
 
-		while (*s) {
-			while (isspace (*s))
-				s++;
-			if (s[0] == 0)
-				break;
-			if ((s[0] == 'r' || s[0]=='R')
-			    && (s[1] == 'e' || s[1]=='E')) {
-				p = s + 2;
-				while (isdigit (*p) || (ispunct (*p) && (*p != ':')))
-					p++;
-				if (*p == ':') {
-					c->re = TRUE;
-					s = skip_list_ids (p + 1);
-				} else
-					break;
-			} else
-				break;
-		}
-		if (*s)
-			return s;
-	}
-	return NULL;
+	return strip_root_subject (s, &c->re);
 }
 
 /* this can be pretty slow, but not used often */
@@ -484,12 +525,89 @@ id_equal (gconstpointer a,
 	return ((const CamelSummaryMessageID *) a)->id.id == ((const CamelSummaryMessageID *) b)->id.id;
 }
 
+typedef struct _ThreadIds {
+	guint64 message_id;
+	GArray *references;
+} ThreadIds;
+
+typedef struct _ThreadIdsChunk {
+	GPtrArray *summary;
+	ThreadIds *ids;
+	guint from, to;
+} ThreadIdsChunk;
+
+static void
+thread_ids_chunk_read (gpointer data,
+                       gpointer user_data)
+{
+	ThreadIdsChunk *chunk = data;
+	guint ii;
+
+	for (ii = chunk->from; ii < chunk->to; ii++) {
+		CamelMessageInfo *mi = chunk->summary->pdata[ii];
+		const GArray *references;
+
+		camel_message_info_property_lock (mi);
+
+		chunk->ids[ii].message_id = camel_message_info_get_message_id (mi);
+		references = camel_message_info_get_references (mi);
+		if (references && references->len > 0) {
+			chunk->ids[ii].references = g_array_sized_new (FALSE, FALSE, sizeof (guint64), references->len);
+			g_array_append_vals (chunk->ids[ii].references, references->data, references->len);
+		}
+
+		camel_message_info_property_unlock (mi);
+	}
+}
+
+/* Reads message-ids and references of all the @summary messages;
+ * big summaries are read in chunks on a thread pool. */
+static ThreadIds *
+thread_ids_read (GPtrArray *summary)
+{
+	ThreadIdsChunk *chunks;
+	ThreadIds *ids;
+	GThreadPool *pool = NULL;
+	guint n_chunks, ii;
+
+	ids = g_new0 (ThreadIds, summary->len);
+	n_chunks = (summary->len + PARALLEL_IDS_CHUNK_SIZE - 1) / PARALLEL_IDS_CHUNK_SIZE;
+
+	if (n_chunks > 1)
+		pool = g_thread_pool_new (thread_ids_chunk_read, NULL,
+			MIN (n_chunks, g_get_num_processors ()), FALSE, NULL);
+
+	chunks = g_new0 (ThreadIdsChunk, MAX (n_chunks, 1));
+
+	for (ii = 0; ii < n_chunks; ii++) {
+		chunks[ii].summary = summary;
+		chunks[ii].ids = ids;
+		chunks[ii].from = ii * PARALLEL_IDS_CHUNK_SIZE;
+		chunks[ii].to = MIN (summary->len, chunks[ii].from + PARALLEL_IDS_CHUNK_SIZE);
+
+		if (pool)
+			g_thread_pool_push (pool, &chunks[ii], NULL);
+		else
+			thread_ids_chunk_read (&chunks[ii], NULL);
+	}
+
+	/* Waits for all the chunks to be read */
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	g_free (chunks);
+
+	return ids;
+}
+
 /* perform actual threading */
 static void
 thread_summary (CamelFolderThread *thread,
                 GPtrArray *summary)
 {
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
 	GHashTable *id_table, *no_id_table;
+	ThreadIds *ids;
 	gint i;
 	CamelFolderThreadNode *c, *child, *head;
 #ifdef TIMEIT
@@ -499,6 +617,16 @@ thread_summary (CamelFolderThread *thread,
 	gettimeofday (&start, NULL);
 #endif
 
+	/* the index is built again when needed */
+	priv->index_valid = FALSE;
+
+	if (priv->adopted)
+		g_hash_table_remove_all (priv->adopted);
+	else
+		priv->adopted = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	ids = thread_ids_read (summary);
+
 	id_table = g_hash_table_new_full (id_hash, id_equal, g_free, NULL);
 	no_id_table = g_hash_table_new (NULL, NULL);
 	for (i = 0; i < summary->len; i++) {
@@ -506,10 +634,8 @@ thread_summary (CamelFolderThread *thread,
 		CamelSummaryMessageID *message_id_copy, message_id;
 		const GArray *references;
 
-		camel_message_info_property_lock (mi);
-
-		message_id.id.id = camel_message_info_get_message_id (mi);
-		references = camel_message_info_get_references (mi);
+		message_id.id.id = ids[i].message_id;
+		references = ids[i].references;
 
 		if (message_id.id.id) {
 			c = g_hash_table_lookup (id_table, &message_id);
@@ -571,9 +697,12 @@ thread_summary (CamelFolderThread *thread,
 			}
 		}
 
-		camel_message_info_property_unlock (mi);
+		if (ids[i].references)
+			g_array_unref (ids[i].references);
 	}
 
+	g_free (ids);
+
 	d (printf ("\n\n"));
 	/* build a list of root messages (no parent) */
 	head = NULL;
@@ -586,9 +715,13 @@ thread_summary (CamelFolderThread *thread,
 	/* remove empty parent nodes */
 	prune_empty (thread, &head);
 
-	/* find any siblings which missed out - but only if we are allowing threading by subject */
-	if (thread->subject)
+	/* find any siblings which missed out - but only if we are allowing threading by subject;
+	 * the roots are grouped in their order, not in the order of the hash tables, thus
+	 * the result depends only on the messages and the in-place updates can follow it */
+	if (thread->subject) {
+		sort_thread (&head);
 		group_root_set (thread, &head);
+	}
 
 #if 0
 	printf ("finished\n");
@@ -619,6 +752,7 @@ thread_summary (CamelFolderThread *thread,
 			while (scan->next) {
 				scan = scan->next;
 				scan->parent = newtop;
+				g_hash_table_add (priv->adopted, scan);
 			}
 
 			/* and link the now 'real' node into the list */
@@ -653,6 +787,477 @@ thread_summary (CamelFolderThread *thread,
 #endif
 }
 
+static guint
+thread_count_get (GHashTable *counts,
+                  guint64 message_id)
+{
+	CamelSummaryMessageID key;
+
+	key.id.id = message_id;
+
+	return GPOINTER_TO_UINT (g_hash_table_lookup (counts, &key));
+}
+
+static void
+thread_count_add (GHashTable *counts,
+                  guint64 message_id,
+                  gint delta)
+{
+	CamelSummaryMessageID key;
+	guint count;
+
+	key.id.id = message_id;
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (counts, &key)) + delta;
+
+	if (count)
+		g_hash_table_insert (counts, g_memdup (&key, sizeof (key)), GUINT_TO_POINTER (count));
+	else
+		g_hash_table_remove (counts, &key);
+}
+
+static const gchar *
+thread_message_root_subject (const CamelMessageInfo *info)
+{
+	gboolean re;
+
+	/* XXX Casting away const. */
+	return strip_root_subject ((gchar *) camel_message_info_get_subject (info), &re);
+}
+
+static guint
+thread_subject_count_get (CamelFolderThreadPrivate *priv,
+                          const CamelMessageInfo *info)
+{
+	const gchar *root_subject;
+
+	root_subject = thread_message_root_subject (info);
+	if (!root_subject)
+		return 0;
+
+	return GPOINTER_TO_UINT (g_hash_table_lookup (priv->subject_count, root_subject));
+}
+
+static void
+thread_subject_count_add (CamelFolderThreadPrivate *priv,
+                          const CamelMessageInfo *info,
+                          gint delta)
+{
+	const gchar *root_subject;
+	guint count;
+
+	root_subject = thread_message_root_subject (info);
+	if (!root_subject)
+		return;
+
+	count = GPOINTER_TO_UINT (g_hash_table_lookup (priv->subject_count, root_subject)) + delta;
+
+	if (count)
+		g_hash_table_insert (priv->subject_count, g_strdup (root_subject), GUINT_TO_POINTER (count));
+	else
+		g_hash_table_remove (priv->subject_count, root_subject);
+}
+
+/* Adds (@delta is 1) or subtracts (@delta is -1) the message-id, the
+ * references and the root subject of the message of @node to or from
+ * the index */
+static void
+thread_index_count_message (CamelFolderThreadPrivate *priv,
+                            CamelFolderThreadNode *node,
+                            gint delta)
+{
+	GArray *references;
+	guint64 message_id;
+	guint ii;
+
+	message_id = camel_message_info_get_message_id (node->message);
+	if (message_id)
+		thread_count_add (priv->id_count, message_id, delta);
+
+	if (priv->thread.subject)
+		thread_subject_count_add (priv, node->message, delta);
+
+	references = camel_message_info_dup_references (node->message);
+	if (!references)
+		return;
+
+	for (ii = 0; ii < references->len; ii++) {
+		message_id = g_array_index (references, guint64, ii);
+		if (message_id)
+			thread_count_add (priv->ref_count, message_id, delta);
+	}
+
+	g_array_unref (references);
+}
+
+static void
+thread_index_add_rec (CamelFolderThreadPrivate *priv,
+                      CamelFolderThreadNode *node)
+{
+	for (; node; node = node->next) {
+		if (node->message) {
+			CamelSummaryMessageID message_id;
+			CamelFolderThreadNode *first;
+
+			g_hash_table_insert (priv->uid_table,
+				(gpointer) camel_message_info_get_uid (node->message), node);
+
+			/* a duplicate message-id is threaded as a message without one */
+			message_id.id.id = camel_message_info_get_message_id (node->message);
+			if (message_id.id.id) {
+				first = g_hash_table_lookup (priv->id_table, &message_id);
+				if (!first || first->order > node->order)
+					g_hash_table_insert (priv->id_table, g_memdup (&message_id, sizeof (message_id)), node);
+			}
+
+			thread_index_count_message (priv, node, 1);
+
+			if (node->order > priv->last_order)
+				priv->last_order = node->order;
+		}
+
+		if (node->child)
+			thread_index_add_rec (priv, node->child);
+	}
+}
+
+/* Builds the index of the tree, before the first in-place update */
+static void
+thread_index_build (CamelFolderThread *thread)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	CamelFolderThreadNode *node;
+
+	if (!priv->uid_table) {
+		priv->uid_table = g_hash_table_new (g_str_hash, g_str_equal);
+		priv->id_table = g_hash_table_new_full (id_hash, id_equal, g_free, NULL);
+		priv->id_count = g_hash_table_new_full (id_hash, id_equal, g_free, NULL);
+		priv->ref_count = g_hash_table_new_full (id_hash, id_equal, g_free, NULL);
+		priv->subject_count = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	} else {
+		g_hash_table_remove_all (priv->uid_table);
+		g_hash_table_remove_all (priv->id_table);
+		g_hash_table_remove_all (priv->id_count);
+		g_hash_table_remove_all (priv->ref_count);
+		g_hash_table_remove_all (priv->subject_count);
+	}
+
+	priv->root_tail = NULL;
+	priv->last_order = 0;
+
+	thread_index_add_rec (priv, thread->tree);
+
+	for (node = thread->tree; node; node = node->next)
+		priv->root_tail = node;
+
+	priv->index_valid = TRUE;
+}
+
+static void
+thread_index_free (CamelFolderThreadPrivate *priv)
+{
+	if (priv->adopted)
+		g_hash_table_destroy (priv->adopted);
+
+	if (!priv->uid_table)
+		return;
+
+	g_hash_table_destroy (priv->uid_table);
+	g_hash_table_destroy (priv->id_table);
+	g_hash_table_destroy (priv->id_count);
+	g_hash_table_destroy (priv->ref_count);
+	g_hash_table_destroy (priv->subject_count);
+}
+
+/* Finds where thread_summary() would put a new message, which comes
+ * last in the order, and returns FALSE when the message would change
+ * where other messages are put. That is when its message-id is used
+ * or referenced already, thus it takes the place of a pseudo node or
+ * of a duplicate, or when it references a missing message, which is
+ * referenced by other messages too, thus it shares a pseudo node.
+ * When threading by subject, a new root also must not share its root
+ * subject with any other message, thus it is not grouped with them. */
+static gboolean
+thread_find_insert_parent (CamelFolderThreadPrivate *priv,
+                           CamelMessageInfo *info,
+                           CamelFolderThreadNode **out_parent)
+{
+	GArray *references;
+	guint64 message_id;
+	gboolean can_insert = TRUE;
+	guint ii;
+
+	*out_parent = NULL;
+
+	message_id = camel_message_info_get_message_id (info);
+	if (message_id && (thread_count_get (priv->id_count, message_id) ||
+	    thread_count_get (priv->ref_count, message_id)))
+		return FALSE;
+
+	references = camel_message_info_dup_references (info);
+
+	for (ii = 0; references && ii < references->len && can_insert; ii++) {
+		CamelSummaryMessageID key;
+
+		key.id.id = g_array_index (references, guint64, ii);
+		if (!key.id.id)
+			continue;
+
+		*out_parent = g_hash_table_lookup (priv->id_table, &key);
+		if (*out_parent)
+			break;
+
+		can_insert = !thread_count_get (priv->ref_count, key.id.id);
+	}
+
+	if (references)
+		g_array_unref (references);
+
+	if (can_insert && !*out_parent && priv->thread.subject)
+		can_insert = !thread_subject_count_get (priv, info);
+
+	return can_insert;
+}
+
+/* Whether thread_summary() would put all the other messages the same
+ * way without the message of @node. That is when it has no children,
+ * no other message uses or references its message-id, and the missing
+ * messages it references before its parent, which are pseudo nodes
+ * while threading, are not referenced by other messages. When threading
+ * by subject, a message without such parent is a root, which also must
+ * not share its root subject with any other message. */
+static gboolean
+thread_can_remove (CamelFolderThreadPrivate *priv,
+                   CamelFolderThreadNode *node)
+{
+	GArray *references;
+	guint64 message_id;
+	gboolean can_remove = TRUE, has_parent = FALSE;
+	guint ii;
+
+	if (node->child)
+		return FALSE;
+
+	message_id = camel_message_info_get_message_id (node->message);
+	if (message_id && (thread_count_get (priv->id_count, message_id) != 1 ||
+	    thread_count_get (priv->ref_count, message_id)))
+		return FALSE;
+
+	references = camel_message_info_dup_references (node->message);
+
+	for (ii = 0; references && ii < references->len && can_remove; ii++) {
+		CamelFolderThreadNode *parent;
+		CamelSummaryMessageID key;
+
+		key.id.id = g_array_index (references, guint64, ii);
+		if (!key.id.id)
+			continue;
+
+		/* threaded before the node, thus its parent */
+		parent = g_hash_table_lookup (priv->id_table, &key);
+		if (parent && parent->order < node->order) {
+			has_parent = TRUE;
+			break;
+		}
+
+		can_remove = !thread_count_get (priv->id_count, key.id.id) &&
+			thread_count_get (priv->ref_count, key.id.id) == 1;
+	}
+
+	if (references)
+		g_array_unref (references);
+
+	if (can_remove && !has_parent && priv->thread.subject)
+		can_remove = thread_subject_count_get (priv, node->message) <= 1;
+
+	return can_remove;
+}
+
+/* Adds @info as the last in the order, under the @parent found by
+ * thread_find_insert_parent(); takes the reference of the @info */
+static void
+thread_insert_message (CamelFolderThread *thread,
+                       CamelMessageInfo *info,
+                       CamelFolderThreadNode *parent)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	CamelFolderThreadNode *node, **link;
+	CamelSummaryMessageID message_id;
+
+	node = camel_memchunk_alloc0 (thread->node_chunks);
+	node->message = info;
+	node->order = ++priv->last_order;
+
+	g_ptr_array_add (thread->summary, info);
+	g_hash_table_insert (priv->uid_table, (gpointer) camel_message_info_get_uid (info), node);
+
+	message_id.id.id = camel_message_info_get_message_id (info);
+	if (message_id.id.id)
+		g_hash_table_insert (priv->id_table, g_memdup (&message_id, sizeof (message_id)), node);
+
+	thread_index_count_message (priv, node, 1);
+
+	if (parent) {
+		/* the children are sorted by the order, but those adopted
+		 * from a pseudo node follow the parent's own children */
+		link = &parent->child;
+		while (*link && !g_hash_table_contains (priv->adopted, *link))
+			link = &(*link)->next;
+
+		node->next = *link;
+		node->parent = parent;
+		*link = node;
+	} else {
+		if (priv->root_tail)
+			priv->root_tail->next = node;
+		else
+			thread->tree = node;
+
+		priv->root_tail = node;
+	}
+}
+
+/* Removes the message of @node, which thread_can_remove() allowed, and
+ * adds its info to @removed_infos; root nodes are only left without
+ * the message, to be unlinked by thread_unlink_roots() all at once */
+static void
+thread_remove_message (CamelFolderThread *thread,
+                       CamelFolderThreadNode *node,
+                       GPtrArray *removed_infos)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	CamelFolderThreadNode **link;
+	CamelSummaryMessageID message_id;
+
+	g_hash_table_remove (priv->uid_table, camel_message_info_get_uid (node->message));
+
+	message_id.id.id = camel_message_info_get_message_id (node->message);
+	if (message_id.id.id)
+		g_hash_table_remove (priv->id_table, &message_id);
+
+	thread_index_count_message (priv, node, -1);
+
+	/* the node memory can be reused by an added message */
+	g_hash_table_remove (priv->adopted, node);
+
+	/* XXX Casting away const. */
+	g_ptr_array_add (removed_infos, (CamelMessageInfo *) node->message);
+	node->message = NULL;
+
+	if (!node->parent)
+		return;
+
+	link = &node->parent->child;
+	while (*link != node)
+		link = &(*link)->next;
+
+	*link = node->next;
+
+	m (memset (node, 0xfd, sizeof (*node)));
+	camel_memchunk_free (thread->node_chunks, node);
+}
+
+static void
+thread_unlink_roots (CamelFolderThread *thread)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	CamelFolderThreadNode **link, *node;
+
+	priv->root_tail = NULL;
+
+	link = &thread->tree;
+	while (*link) {
+		node = *link;
+
+		if (node->message) {
+			priv->root_tail = node;
+			link = &node->next;
+		} else {
+			*link = node->next;
+
+			m (memset (node, 0xfd, sizeof (*node)));
+			camel_memchunk_free (thread->node_chunks, node);
+		}
+	}
+}
+
+static gint
+thread_node_cmp_order_desc (gconstpointer a,
+                            gconstpointer b)
+{
+	return -sort_node (a, b);
+}
+
+/* Updates the tree in place, keeping it the same as thread_summary()
+ * would create it. Returns FALSE, when some message could not be added
+ * or removed that way, leaving the rest of the changes undone. */
+static gboolean
+thread_update_in_place (CamelFolderThread *thread,
+                        GPtrArray *removed_nodes,
+                        GPtrArray *added_uids,
+                        GPtrArray *removed_infos)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	gboolean success = TRUE;
+	guint ii;
+
+	/* replies come after their parents, thus are removed first */
+	g_ptr_array_sort (removed_nodes, thread_node_cmp_order_desc);
+
+	for (ii = 0; ii < removed_nodes->len && success; ii++) {
+		success = thread_can_remove (priv, removed_nodes->pdata[ii]);
+		if (success)
+			thread_remove_message (thread, removed_nodes->pdata[ii], removed_infos);
+	}
+
+	for (ii = 0; ii < added_uids->len && success; ii++) {
+		CamelFolderThreadNode *parent = NULL;
+		CamelMessageInfo *info;
+
+		if (g_hash_table_contains (priv->uid_table, added_uids->pdata[ii]))
+			continue;
+
+		info = camel_folder_get_message_info (thread->folder, added_uids->pdata[ii]);
+		if (!info)
+			continue;
+
+		success = thread_find_insert_parent (priv, info, &parent);
+		if (success)
+			thread_insert_message (thread, info, parent);
+		else
+			g_clear_object (&info);
+	}
+
+	thread_unlink_roots (thread);
+
+	return success;
+}
+
+/* Drops the removed messages from the thread's summary, in one pass */
+static void
+thread_summary_compact (CamelFolderThread *thread,
+                        GPtrArray *removed_infos)
+{
+	GHashTable *removed;
+	guint ii, jj;
+
+	if (!removed_infos->len)
+		return;
+
+	removed = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (ii = 0; ii < removed_infos->len; ii++)
+		g_hash_table_add (removed, removed_infos->pdata[ii]);
+
+	for (ii = 0, jj = 0; ii < thread->summary->len; ii++) {
+		if (!g_hash_table_contains (removed, thread->summary->pdata[ii]))
+			thread->summary->pdata[jj++] = thread->summary->pdata[ii];
+	}
+
+	g_ptr_array_set_size (thread->summary, jj);
+
+	g_hash_table_destroy (removed);
+}
+
 /**
  * camel_folder_thread_messages_new:
  * @folder: a #CamelFolder
@@ -682,7 +1287,7 @@ camel_folder_thread_messages_new (CamelFolder *folder,
 	GPtrArray *fsummary = NULL;
 	gint i;
 
-	thread = g_malloc (sizeof (*thread));
+	thread = g_malloc0 (sizeof (CamelFolderThreadPrivate));
 	thread->refcount = 1;
 	thread->subject = thread_subject;
 	thread->tree = NULL;
@@ -716,11 +1321,11 @@ camel_folder_thread_messages_new (CamelFolder *folder,
 	return thread;
 }
 
-/* add any still there, in the existing order */
+/* add any still there */
 static void
 add_present_rec (CamelFolderThread *thread,
                  GHashTable *have,
-                 GPtrArray *summary,
+                 GPtrArray *nodes,
                  CamelFolderThreadNode *node)
 {
 	while (node) {
@@ -733,54 +1338,246 @@ add_present_rec (CamelFolderThread *thread,
 
 		if (g_hash_table_lookup (have, uid)) {
 			g_hash_table_remove (have, uid);
-			g_ptr_array_add (summary, info);
+			g_ptr_array_add (nodes, node);
 		} else {
 			g_clear_object (&info);
 		}
 
 		if (node->child)
-			add_present_rec (thread, have, summary, node->child);
+			add_present_rec (thread, have, nodes, node->child);
 		node = node->next;
 	}
 }
 
+/* Threads the messages from scratch, those still there in their existing
+ * order, then the new ones from @table in the order of @uids */
+static void
+thread_apply_full (CamelFolderThread *thread,
+                   GPtrArray *uids,
+                   GHashTable *table)
+{
+	GPtrArray *nodes, *all;
+	CamelMessageInfo *info;
+	guint ii;
+
+	nodes = g_ptr_array_new ();
+
+	add_present_rec (thread, table, nodes, thread->tree);
+
+	g_ptr_array_sort (nodes, sort_node);
+
+	all = g_ptr_array_sized_new (nodes->len + g_hash_table_size (table));
+
+	for (ii = 0; ii < nodes->len; ii++) {
+		CamelFolderThreadNode *node = nodes->pdata[ii];
+
+		g_ptr_array_add (all, (gpointer) node->message);
+	}
+
+	g_ptr_array_free (nodes, TRUE);
+
+	/* add any new ones, in supplied order */
+	for (ii = 0; ii < uids->len; ii++)
+		if (g_hash_table_remove (table, uids->pdata[ii]) && (info = camel_folder_get_message_info (thread->folder, uids->pdata[ii])))
+			g_ptr_array_add (all, info);
+
+	thread->tree = NULL;
+	camel_memchunk_destroy (thread->node_chunks);
+	thread->node_chunks = camel_memchunk_new (32, sizeof (CamelFolderThreadNode));
+	thread_summary (thread, all);
+
+	g_ptr_array_free (thread->summary, TRUE);
+	thread->summary = all;
+}
+
+/* Updates the tree in place, when the change is small enough
+ * compared to the tree; returns whether it did so */
+static gboolean
+thread_apply_incremental (CamelFolderThread *thread,
+                          GPtrArray *uids,
+                          GHashTable *table,
+                          GPtrArray *removed_infos)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	GPtrArray *removed_nodes, *added_uids;
+	GHashTableIter iter;
+	gpointer key, value;
+	gboolean success = FALSE;
+	guint ii, n_added = 0;
+
+	if (!priv->index_valid)
+		thread_index_build (thread);
+
+	removed_nodes = g_ptr_array_new ();
+	added_uids = g_ptr_array_new ();
+
+	g_hash_table_iter_init (&iter, priv->uid_table);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!g_hash_table_contains (table, key))
+			g_ptr_array_add (removed_nodes, value);
+	}
+
+	g_hash_table_iter_init (&iter, table);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!g_hash_table_contains (priv->uid_table, key))
+			n_added++;
+	}
+
+	/* keep the supplied order of the new messages */
+	if ((removed_nodes->len + n_added) * INCREMENTAL_MAX_CHANGES_DIVISOR <= g_hash_table_size (priv->uid_table)) {
+		for (ii = 0; ii < uids->len; ii++) {
+			if (!g_hash_table_contains (priv->uid_table, uids->pdata[ii]))
+				g_ptr_array_add (added_uids, uids->pdata[ii]);
+		}
+
+		success = thread_update_in_place (thread, removed_nodes, added_uids, removed_infos);
+	}
+
+	g_ptr_array_free (removed_nodes, TRUE);
+	g_ptr_array_free (added_uids, TRUE);
+
+	return success;
+}
+
 /**
  * camel_folder_thread_messages_apply:
  * @thread: a #CamelFolderThread
  * @uids: (element-type utf8) (transfer none): a #GPtrArray array of UID-s
  *
- * Adds new @uids into the threaded tree.
+ * Adds new @uids into the threaded tree and removes those not in @uids.
+ * When only a few messages change and they do not change how the other
+ * messages are threaded, the tree is updated in place, otherwise it is
+ * threaded again from scratch. The resulting tree is the same either way.
  **/
 void
 camel_folder_thread_messages_apply (CamelFolderThread *thread,
                                     GPtrArray *uids)
 {
 	gint i;
-	GPtrArray *all;
 	GHashTable *table;
-	CamelMessageInfo *info;
+	GPtrArray *removed_infos;
 
-	all = g_ptr_array_new ();
 	table = g_hash_table_new (g_str_hash, g_str_equal);
 	for (i = 0; i < uids->len; i++)
 		g_hash_table_insert (table, uids->pdata[i], uids->pdata[i]);
 
-	add_present_rec (thread, table, all, thread->tree);
+	removed_infos = g_ptr_array_new_with_free_func (g_object_unref);
 
-	/* add any new ones, in supplied order */
-	for (i = 0; i < uids->len; i++)
-		if (g_hash_table_lookup (table, uids->pdata[i]) && (info = camel_folder_get_message_info (thread->folder, uids->pdata[i])))
-			g_ptr_array_add (all, info);
+	if (thread_apply_incremental (thread, uids, table, removed_infos))
+		thread_summary_compact (thread, removed_infos);
+	else
+		thread_apply_full (thread, uids, table);
 
+	g_ptr_array_unref (removed_infos);
 	g_hash_table_destroy (table);
+}
 
-	thread->tree = NULL;
-	camel_memchunk_destroy (thread->node_chunks);
-	thread->node_chunks = camel_memchunk_new (32, sizeof (CamelFolderThreadNode));
-	thread_summary (thread, all);
+static void
+collect_nodes_rec (CamelFolderThreadNode *node,
+                   GPtrArray *nodes)
+{
+	for (; node; node = node->next) {
+		g_ptr_array_add (nodes, node);
 
-	g_ptr_array_free (thread->summary, TRUE);
-	thread->summary = all;
+		if (node->child)
+			collect_nodes_rec (node->child, nodes);
+	}
+}
+
+/**
+ * camel_folder_thread_messages_apply_changes:
+ * @thread: a #CamelFolderThread
+ * @changes: a #CamelFolderChangeInfo of the @thread's folder
+ *
+ * Updates the threaded tree with the added and removed messages from
+ * @changes. New messages are put at the end of the summary order. The
+ * messages are inserted or removed in place, without threading the rest
+ * of the messages again, unless that would change how the other messages
+ * are threaded, like when a new message has the subject of another thread
+ * while threading by subject. The resulting tree is the same as when
+ * threading all the messages from scratch.
+ *
+ * Since: 3.28
+ **/
+void
+camel_folder_thread_messages_apply_changes (CamelFolderThread *thread,
+                                            CamelFolderChangeInfo *changes)
+{
+	CamelFolderThreadPrivate *priv = FOLDER_THREAD_PRIVATE (thread);
+	GPtrArray *removed_nodes, *removed_infos, *added_uids, *nodes, *uids;
+	GHashTable *removed, *table;
+	gboolean success;
+	guint ii;
+
+	g_return_if_fail (thread != NULL);
+	g_return_if_fail (changes != NULL);
+
+	removed_infos = g_ptr_array_new_with_free_func (g_object_unref);
+	added_uids = changes->uid_added ? changes->uid_added : g_ptr_array_new ();
+
+	if (!priv->index_valid)
+		thread_index_build (thread);
+
+	removed_nodes = g_ptr_array_new ();
+	removed = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (ii = 0; changes->uid_removed && ii < changes->uid_removed->len; ii++) {
+		CamelFolderThreadNode *node;
+
+		node = g_hash_table_lookup (priv->uid_table, changes->uid_removed->pdata[ii]);
+		if (node && g_hash_table_add (removed, node))
+			g_ptr_array_add (removed_nodes, node);
+	}
+
+	g_hash_table_destroy (removed);
+
+	success = thread_update_in_place (thread, removed_nodes, added_uids, removed_infos);
+
+	g_ptr_array_free (removed_nodes, TRUE);
+
+	if (success) {
+		thread_summary_compact (thread, removed_infos);
+	} else {
+		/* the messages still there, in their order, then the new ones */
+		removed = g_hash_table_new (g_str_hash, g_str_equal);
+		for (ii = 0; changes->uid_removed && ii < changes->uid_removed->len; ii++)
+			g_hash_table_add (removed, changes->uid_removed->pdata[ii]);
+
+		nodes = g_ptr_array_new ();
+		collect_nodes_rec (thread->tree, nodes);
+		g_ptr_array_sort (nodes, sort_node);
+
+		uids = g_ptr_array_new ();
+		table = g_hash_table_new (g_str_hash, g_str_equal);
+
+		for (ii = 0; ii < nodes->len; ii++) {
+			CamelFolderThreadNode *node = nodes->pdata[ii];
+			const gchar *uid = camel_message_info_get_uid (node->message);
+
+			if (!g_hash_table_contains (removed, uid)) {
+				g_ptr_array_add (uids, (gpointer) uid);
+				g_hash_table_add (table, (gpointer) uid);
+			}
+		}
+
+		for (ii = 0; ii < added_uids->len; ii++) {
+			if (!g_hash_table_contains (table, added_uids->pdata[ii])) {
+				g_ptr_array_add (uids, added_uids->pdata[ii]);
+				g_hash_table_add (table, added_uids->pdata[ii]);
+			}
+		}
+
+		thread_apply_full (thread, uids, table);
+
+		g_hash_table_destroy (table);
+		g_ptr_array_free (uids, TRUE);
+		g_ptr_array_free (nodes, TRUE);
+		g_hash_table_destroy (removed);
+	}
+
+	if (added_uids != changes->uid_added)
+		g_ptr_array_free (added_uids, TRUE);
+	g_ptr_array_unref (removed_infos);
 }
 
 /**
@@ -820,6 +1617,7 @@ camel_folder_thread_messages_unref (CamelFolderThread *thread)
 		g_ptr_array_free (thread->summary, TRUE);
 		g_object_unref (thread->folder);
 	}
+	thread_index_free (FOLDER_THREAD_PRIVATE (thread));
 	camel_memchunk_destroy (thread->node_chunks);
 	g_free (thread);
 }
@@ -52,6 +52,7 @@ GType		camel_folder_thread_messages_get_type		(void);
 /* interface 1: using uid's */
 CamelFolderThread *camel_folder_thread_messages_new (CamelFolder *folder, GPtrArray *uids, gboolean thread_subject);
 void camel_folder_thread_messages_apply (CamelFolderThread *thread, GPtrArray *uids);
+void camel_folder_thread_messages_apply_changes (CamelFolderThread *thread, CamelFolderChangeInfo *changes);
 
 /* interface 2: using messageinfo's.  Currently disabled. */
 #if 0
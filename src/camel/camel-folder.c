@@ -107,6 +107,33 @@ struct _FolderFilterData {
 	CamelFilterDriver *driver;
 };
 
+/* How many messages are given to the junk filter at once */
+#define JUNK_LEARN_BATCH_SIZE (50)
+
+/* The messages to learn are downloaded in a dedicated thread into
+ * a queue, bounded by the count and the size of the queued messages */
+typedef struct _JunkPrefetchQueue {
+	CamelFolder *folder;
+	GPtrArray *uids;
+	GCancellable *cancellable;
+	guint depth;
+	guint64 memory;
+
+	GMutex lock;
+	GCond cond;
+	GQueue items;		/* JunkPrefetchItem *, in the order of the uids */
+	guint64 queued_size;
+	gboolean full;		/* the download waits for room */
+	gboolean done;		/* all downloaded, or failed */
+	gboolean stop;		/* the learning failed */
+	GError *error;
+} JunkPrefetchQueue;
+
+typedef struct _JunkPrefetchItem {
+	CamelMimeMessage *message;
+	guint64 size;
+} JunkPrefetchItem;
+
 enum {
 	PROP_0,
 	PROP_DESCRIPTION,
@@ -256,6 +283,249 @@ prepare_folder_filter_data_free (FolderFilterData *data)
 	g_thread_unref (thread);
 }
 
+static guint64
+junk_prefetch_message_size (CamelFolder *folder,
+                            const gchar *uid)
+{
+	CamelMessageInfo *info;
+	guint64 size;
+
+	info = camel_folder_get_message_info (folder, uid);
+
+	/* Count at least one byte, the size can be unknown */
+	size = MAX (1, info ? camel_message_info_get_size (info) : 0);
+
+	g_clear_object (&info);
+
+	return size;
+}
+
+/* Waits until there is room for @n_messages of @size bytes in the queue;
+ * returns FALSE when the learning stopped meanwhile */
+static gboolean
+junk_prefetch_wait_room (JunkPrefetchQueue *pq,
+                         guint n_messages,
+                         guint64 size)
+{
+	gboolean stop;
+
+	g_mutex_lock (&pq->lock);
+
+	/* something to learn is always let in, not to stall on large messages */
+	while (!pq->stop && !g_queue_is_empty (&pq->items) &&
+	       (g_queue_get_length (&pq->items) + n_messages > pq->depth ||
+		pq->queued_size + size > pq->memory)) {
+		pq->full = TRUE;
+		g_cond_broadcast (&pq->cond);
+		g_cond_wait (&pq->cond, &pq->lock);
+	}
+
+	pq->full = FALSE;
+	stop = pq->stop;
+
+	g_mutex_unlock (&pq->lock);
+
+	return !stop;
+}
+
+static void
+junk_prefetch_push (JunkPrefetchQueue *pq,
+                    CamelMimeMessage *message,
+                    guint64 size)
+{
+	JunkPrefetchItem *item;
+
+	item = g_slice_new (JunkPrefetchItem);
+	item->message = message;
+	item->size = size;
+
+	g_mutex_lock (&pq->lock);
+	g_queue_push_tail (&pq->items, item);
+	pq->queued_size += size;
+	g_cond_broadcast (&pq->cond);
+	g_mutex_unlock (&pq->lock);
+}
+
+static gpointer
+junk_prefetch_thread (gpointer user_data)
+{
+	JunkPrefetchQueue *pq = user_data;
+	CamelFolderClass *class;
+	GPtrArray *missing;
+	GError *local_error = NULL;
+	guint chunk_size, from, ii;
+
+	class = CAMEL_FOLDER_GET_CLASS (pq->folder);
+	chunk_size = MIN (JUNK_LEARN_BATCH_SIZE, pq->depth);
+	missing = g_ptr_array_new ();
+
+	for (from = 0; from < pq->uids->len && !local_error; from += chunk_size) {
+		guint to = MIN (from + chunk_size, pq->uids->len);
+		CamelMimeMessage *messages[JUNK_LEARN_BATCH_SIZE] = { NULL };
+		guint64 sizes[JUNK_LEARN_BATCH_SIZE], chunk_bytes = 0;
+
+		for (ii = from; ii < to; ii++) {
+			sizes[ii - from] = junk_prefetch_message_size (pq->folder, pq->uids->pdata[ii]);
+			chunk_bytes += sizes[ii - from];
+		}
+
+		if (!junk_prefetch_wait_room (pq, to - from, chunk_bytes))
+			break;
+
+		/* the messages already downloaded are taken from the local cache */
+		g_ptr_array_set_size (missing, 0);
+		for (ii = from; ii < to; ii++) {
+			messages[ii - from] = camel_folder_get_message_cached (
+				pq->folder, pq->uids->pdata[ii], pq->cancellable);
+
+			if (!messages[ii - from])
+				g_ptr_array_add (missing, pq->uids->pdata[ii]);
+		}
+
+		/* and the others are downloaded at once, when the folder can do it;
+		 * a failure is reported by the single-message download below */
+		if (missing->len > 1 && class->synchronize_messages_sync != NULL)
+			camel_folder_synchronize_messages_sync (pq->folder, missing, pq->cancellable, NULL);
+
+		for (ii = from; ii < to; ii++) {
+			CamelMimeMessage *message = messages[ii - from];
+
+			if (!message && !local_error)
+				message = camel_folder_get_message_sync (
+					pq->folder, pq->uids->pdata[ii],
+					pq->cancellable, &local_error);
+
+			/* messages fetched before an error are still learned */
+			if (message)
+				junk_prefetch_push (pq, message, sizes[ii - from]);
+		}
+	}
+
+	g_ptr_array_free (missing, TRUE);
+
+	g_mutex_lock (&pq->lock);
+	pq->done = TRUE;
+	pq->error = local_error;
+	g_cond_broadcast (&pq->cond);
+	g_mutex_unlock (&pq->lock);
+
+	return NULL;
+}
+
+/* Takes up to @max_messages downloaded messages into @batch; waits for
+ * all of them, unless everything was downloaded already or the download
+ * waits for room in the queue */
+static void
+junk_prefetch_pop (JunkPrefetchQueue *pq,
+                   GPtrArray *batch,
+                   guint max_messages)
+{
+	g_mutex_lock (&pq->lock);
+
+	while (!pq->done && !pq->full && g_queue_get_length (&pq->items) < max_messages)
+		g_cond_wait (&pq->cond, &pq->lock);
+
+	while (batch->len < max_messages && !g_queue_is_empty (&pq->items)) {
+		JunkPrefetchItem *item = g_queue_pop_head (&pq->items);
+
+		pq->queued_size -= item->size;
+		g_ptr_array_add (batch, item->message);
+		g_slice_free (JunkPrefetchItem, item);
+	}
+
+	g_cond_broadcast (&pq->cond);
+	g_mutex_unlock (&pq->lock);
+}
+
+static void
+junk_prefetch_item_free (gpointer data)
+{
+	JunkPrefetchItem *item = data;
+
+	g_object_unref (item->message);
+	g_slice_free (JunkPrefetchItem, item);
+}
+
+/* Learns the messages in batches, while the following messages are
+ * downloaded in a dedicated thread; sets @out_learned to TRUE when
+ * at least one batch was learned */
+static gboolean
+folder_filter_learn (CamelSession *session,
+                     CamelFolder *folder,
+                     CamelJunkFilter *junk_filter,
+                     GPtrArray *uids,
+                     gboolean junk,
+                     gboolean *out_learned,
+                     GCancellable *cancellable,
+                     GError **error)
+{
+	JunkPrefetchQueue pq;
+	GPtrArray *batch;
+	GThread *thread;
+	gboolean success = TRUE;
+	guint n_learned = 0;
+
+	memset (&pq, 0, sizeof (pq));
+	pq.folder = folder;
+	pq.uids = uids;
+	pq.cancellable = cancellable;
+	pq.depth = camel_session_get_junk_learn_prefetch_depth (session);
+	pq.memory = camel_session_get_junk_learn_prefetch_memory (session);
+	g_mutex_init (&pq.lock);
+	g_cond_init (&pq.cond);
+	g_queue_init (&pq.items);
+
+	thread = g_thread_new ("camel-junk-prefetch", junk_prefetch_thread, &pq);
+
+	batch = g_ptr_array_new_with_free_func (g_object_unref);
+
+	while (success) {
+		g_ptr_array_set_size (batch, 0);
+
+		junk_prefetch_pop (&pq, batch, JUNK_LEARN_BATCH_SIZE);
+		if (!batch->len)
+			break;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			success = FALSE;
+		} else if (junk) {
+			success = camel_junk_filter_learn_junk_batch (
+				junk_filter, batch, cancellable, error);
+		} else {
+			success = camel_junk_filter_learn_not_junk_batch (
+				junk_filter, batch, cancellable, error);
+		}
+
+		if (success)
+			*out_learned = TRUE;
+
+		n_learned += batch->len;
+		camel_operation_progress (cancellable, 100 * n_learned / uids->len);
+	}
+
+	g_mutex_lock (&pq.lock);
+	pq.stop = TRUE;
+	g_cond_broadcast (&pq.cond);
+	g_mutex_unlock (&pq.lock);
+
+	g_thread_join (thread);
+
+	if (success && pq.error) {
+		g_propagate_error (error, pq.error);
+		pq.error = NULL;
+		success = FALSE;
+	}
+
+	g_clear_error (&pq.error);
+	while (!g_queue_is_empty (&pq.items))
+		junk_prefetch_item_free (g_queue_pop_head (&pq.items));
+	g_ptr_array_unref (batch);
+	g_mutex_clear (&pq.lock);
+	g_cond_clear (&pq.cond);
+
+	return success;
+}
+
 static void
 folder_filter (CamelSession *session,
                GCancellable *cancellable,
@@ -301,8 +571,6 @@ folder_filter (CamelSession *session,
 	}
 
 	if (data->junk) {
-		gboolean success = TRUE;
-
 		camel_operation_push_message (
 			cancellable, dngettext (GETTEXT_PACKAGE,
 			/* Translators: The first “%s” is replaced with an account name and the second “%s”
@@ -314,28 +582,9 @@ folder_filter (CamelSession *session,
 			camel_service_get_display_name (CAMEL_SERVICE (parent_store)),
 			full_name);
 
-		for (i = 0; success && i < data->junk->len; i++) {
-			CamelMimeMessage *message;
-			gint pc = 100 * i / data->junk->len;
-
-			if (g_cancellable_set_error_if_cancelled (
-				cancellable, error))
-				break;
-
-			message = camel_folder_get_message_sync (
-				data->folder, data->junk->pdata[i],
-				cancellable, error);
-
-			if (message == NULL)
-				break;
-
-			camel_operation_progress (cancellable, pc);
-			success = camel_junk_filter_learn_junk (
-				junk_filter, message, cancellable, error);
-			g_object_unref (message);
-
-			synchronize |= success;
-		}
+		folder_filter_learn (
+			session, data->folder, junk_filter, data->junk, TRUE,
+			&synchronize, cancellable, error);
 
 		camel_operation_pop_message (cancellable);
 	}
@@ -344,8 +593,6 @@ folder_filter (CamelSession *session,
 		goto exit;
 
 	if (data->notjunk) {
-		gboolean success = TRUE;
-
 		camel_operation_push_message (
 			cancellable, dngettext (GETTEXT_PACKAGE,
 			/* Translators: The first “%s” is replaced with an account name and the second “%s”
@@ -357,28 +604,9 @@ folder_filter (CamelSession *session,
 			camel_service_get_display_name (CAMEL_SERVICE (parent_store)),
 			full_name);
 
-		for (i = 0; success && i < data->notjunk->len; i++) {
-			CamelMimeMessage *message;
-			gint pc = 100 * i / data->notjunk->len;
-
-			if (g_cancellable_set_error_if_cancelled (
-				cancellable, error))
-				break;
-
-			message = camel_folder_get_message_sync (
-				data->folder, data->notjunk->pdata[i],
-				cancellable, error);
-
-			if (message == NULL)
-				break;
-
-			camel_operation_progress (cancellable, pc);
-			success = camel_junk_filter_learn_not_junk (
-				junk_filter, message, cancellable, error);
-			g_object_unref (message);
-
-			synchronize |= success;
-		}
+		folder_filter_learn (
+			session, data->folder, junk_filter, data->notjunk, FALSE,
+			&synchronize, cancellable, error);
 
 		camel_operation_pop_message (cancellable);
 	}
@@ -4050,6 +4278,101 @@ camel_folder_synchronize_message_finish (CamelFolder *folder,
 	return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* Helper for camel_folder_synchronize_messages_sync() */
+static gboolean
+folder_synchronize_messages_one_by_one (CamelFolder *folder,
+                                        GPtrArray *message_uids,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	guint64 total_size = 0, done_size = 0;
+	guint32 *sizes;
+	guint ii;
+	gboolean success = TRUE;
+
+	sizes = g_new0 (guint32, message_uids->len);
+
+	for (ii = 0; ii < message_uids->len; ii++) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, message_uids->pdata[ii]);
+
+		/* Count at least one byte, the size can be unknown */
+		sizes[ii] = MAX (1, info ? camel_message_info_get_size (info) : 0);
+		total_size += sizes[ii];
+
+		g_clear_object (&info);
+	}
+
+	for (ii = 0; ii < message_uids->len && success; ii++) {
+		success = camel_folder_synchronize_message_sync (
+			folder, message_uids->pdata[ii], cancellable, error);
+
+		done_size += sizes[ii];
+
+		camel_operation_progress (cancellable, done_size * 100 / total_size);
+	}
+
+	g_free (sizes);
+
+	return success;
+}
+
+/**
+ * camel_folder_synchronize_messages_sync:
+ * @folder: a #CamelFolder
+ * @message_uids: (element-type utf8): message UIDs in @folder
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Ensure that all the messages identified by @message_uids have been
+ * synchronized in @folder, like camel_folder_synchronize_message_sync()
+ * does for a single message. Folders which can download several messages
+ * at once do so, the others synchronize the messages one by one. The progress
+ * is reported by the size of the messages, not by their count.
+ *
+ * Unlike camel_folder_synchronize_message_sync(), the @folder is not locked
+ * with camel_folder_lock() during the download, thus the messages can be
+ * opened while it runs.
+ *
+ * Returns: %TRUE on success, %FALSE on error
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_folder_synchronize_messages_sync (CamelFolder *folder,
+                                        GPtrArray *message_uids,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	CamelFolderClass *class;
+	gboolean success;
+
+	g_return_val_if_fail (CAMEL_IS_FOLDER (folder), FALSE);
+	g_return_val_if_fail (message_uids != NULL, FALSE);
+
+	if (!message_uids->len)
+		return TRUE;
+
+	class = CAMEL_FOLDER_GET_CLASS (folder);
+
+	if (class->synchronize_messages_sync == NULL)
+		return folder_synchronize_messages_one_by_one (folder, message_uids, cancellable, error);
+
+	/* The folder is not locked for the whole download, it would block
+	 * opening of the messages meanwhile; the implementation locks what
+	 * it needs to. */
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return FALSE;
+
+	success = class->synchronize_messages_sync (
+		folder, message_uids, cancellable, error);
+	CAMEL_CHECK_GERROR (
+		folder, synchronize_messages_sync, success, error);
+
+	return success;
+}
+
 /**
  * camel_folder_transfer_messages_to_sync:
  * @source: the source #CamelFolder
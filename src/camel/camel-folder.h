@@ -260,9 +260,14 @@ struct _CamelFolderClass {
 						 GError **error);
 	void		(*prepare_content_refresh)
 						(CamelFolder *folder);
+	gboolean	(*synchronize_messages_sync)
+						(CamelFolder *folder,
+						 GPtrArray *message_uids,
+						 GCancellable *cancellable,
+						 GError **error);
 
 	/* Padding for future expansion */
-	gpointer reserved_methods[20];
+	gpointer reserved_methods[19];
 
 	/* Signals */
 	void		(*changed)		(CamelFolder *folder,
@@ -529,6 +534,11 @@ gboolean	camel_folder_synchronize_message_finish
 						(CamelFolder *folder,
 						 GAsyncResult *result,
 						 GError **error);
+gboolean	camel_folder_synchronize_messages_sync
+						(CamelFolder *folder,
+						 GPtrArray *message_uids,
+						 GCancellable *cancellable,
+						 GError **error);
 gboolean	camel_folder_transfer_messages_to_sync
 						(CamelFolder *source,
 						 GPtrArray *message_uids,
@@ -56,6 +56,28 @@ struct _iconv_cache {
 static GQueue iconv_cache_list = G_QUEUE_INIT;
 static GHashTable *iconv_cache;
 static GHashTable *iconv_cache_open;
+static GHashTable *iconv_cache_owner;	/* GIConv ~> struct _iconv_thread_cache * */
+
+/* Converters closed by a thread are kept by that thread, still busy for
+ * the global cache, and reused by the next open in that same thread
+ * without taking the global lock. They are given back on thread exit.
+ * A converter belongs to the thread, which took it from the global cache,
+ * until it is given back; when another thread closes it, it is given back
+ * at once. The lock guards the busy table, the rest is used only by the
+ * thread itself; the global lock is taken before it, when both are. */
+struct _iconv_thread_cache {
+	GMutex lock;
+	GHashTable *idle;	/* "to%from" ~> GQueue of GIConv */
+	GHashTable *busy;	/* GIConv ~> "to%from" key of the idle table */
+	GHashTable *names;	/* charset ~> camel_iconv_charset_name () */
+	guint n_idle;
+};
+
+#define E_ICONV_THREAD_CACHE_SIZE (8)
+
+static void iconv_thread_cache_free (gpointer ptr);
+
+static GPrivate iconv_thread_cache = G_PRIVATE_INIT (iconv_thread_cache_free);
 
 static GHashTable *iconv_charsets = NULL;
 static gchar *locale_charset = NULL;
@@ -213,6 +235,7 @@ iconv_init (gint keep)
 
 	iconv_cache = g_hash_table_new (g_str_hash, g_str_equal);
 	iconv_cache_open = g_hash_table_new (NULL, NULL);
+	iconv_cache_owner = g_hash_table_new (NULL, NULL);
 
 #ifndef G_OS_WIN32
 	locale = setlocale (LC_ALL, NULL);
@@ -273,15 +296,13 @@ iconv_init (gint keep)
 		G_UNLOCK (iconv);
 }
 
-const gchar *
-camel_iconv_charset_name (const gchar *charset)
+/* Takes the global lock, when the name is not known yet */
+static const gchar *
+iconv_charset_name_shared (const gchar *charset)
 {
 	gchar *name, *ret, *tmp;
 	gsize name_len;
 
-	if (charset == NULL)
-		return NULL;
-
 	name_len = strlen (charset) + 1;
 	name = g_alloca (name_len);
 	g_strlcpy (name, charset, name_len);
@@ -352,6 +373,45 @@ camel_iconv_charset_name (const gchar *charset)
 	return ret;
 }
 
+static struct _iconv_thread_cache *
+iconv_thread_cache_get (void)
+{
+	struct _iconv_thread_cache *tc;
+
+	tc = g_private_get (&iconv_thread_cache);
+	if (!tc) {
+		tc = g_new0 (struct _iconv_thread_cache, 1);
+		g_mutex_init (&tc->lock);
+		tc->idle = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		tc->busy = g_hash_table_new (NULL, NULL);
+		tc->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+		g_private_set (&iconv_thread_cache, tc);
+	}
+
+	return tc;
+}
+
+const gchar *
+camel_iconv_charset_name (const gchar *charset)
+{
+	struct _iconv_thread_cache *tc;
+	const gchar *ret;
+
+	if (charset == NULL)
+		return NULL;
+
+	/* the returned names are never freed, thus can be remembered per thread */
+	tc = iconv_thread_cache_get ();
+	ret = g_hash_table_lookup (tc->names, charset);
+	if (!ret) {
+		ret = iconv_charset_name_shared (charset);
+		g_hash_table_insert (tc->names, g_strdup (charset), (gpointer) ret);
+	}
+
+	return ret;
+}
+
 static void
 flush_entry (struct _iconv_cache *ic)
 {
@@ -369,36 +429,17 @@ flush_entry (struct _iconv_cache *ic)
 	g_free (ic);
 }
 
-/**
- * camel_iconv_open: (skip)
- * @to: charset to convert to
- * @from: charset to covert from
- *
- * Returns: a #GIConv for the conversion from charset @from to charset @to, or (GIConv) -1 on error.
- **/
-GIConv
-camel_iconv_open (const gchar *to,
-                  const gchar *from)
+static GIConv
+iconv_open_shared (struct _iconv_thread_cache *tc,
+                   const gchar *nto,
+                   const gchar *nfrom,
+                   const gchar *tofrom)
 {
-	const gchar *nto, *nfrom;
-	gchar *tofrom;
-	gsize tofrom_len;
 	struct _iconv_cache *ic;
 	struct _iconv_cache_node *in;
 	gint errnosav;
 	GIConv ip;
 
-	if (to == NULL || from == NULL) {
-		errno = EINVAL;
-		return (GIConv) -1;
-	}
-
-	nto = camel_iconv_charset_name (to);
-	nfrom = camel_iconv_charset_name (from);
-	tofrom_len = strlen (nto) + strlen (nfrom) + 2;
-	tofrom = g_alloca (tofrom_len);
-	g_snprintf (tofrom, tofrom_len, "%s%%%s", nto, nfrom);
-
 	G_LOCK (iconv);
 
 	ic = g_hash_table_lookup (iconv_cache, tofrom);
@@ -471,11 +512,151 @@ camel_iconv_open (const gchar *to,
 		}
 	}
 
+	if (ip != (GIConv) -1)
+		g_hash_table_insert (iconv_cache_owner, ip, tc);
+
 	G_UNLOCK (iconv);
 
 	return ip;
 }
 
+static void
+iconv_close_shared (GIConv ip)
+{
+	struct _iconv_thread_cache *owner;
+	struct _iconv_cache_node *in;
+
+	G_LOCK (iconv);
+
+	/* when closed by another thread, the owner does not know it is closed */
+	owner = g_hash_table_lookup (iconv_cache_owner, ip);
+	if (owner) {
+		g_hash_table_remove (iconv_cache_owner, ip);
+
+		g_mutex_lock (&owner->lock);
+		g_hash_table_remove (owner->busy, ip);
+		g_mutex_unlock (&owner->lock);
+	}
+
+	in = g_hash_table_lookup (iconv_cache_open, ip);
+	if (in) {
+		cd (printf ("closing iconv converter '%s'\n", in->parent->conv));
+		g_queue_remove (&in->parent->open, in);
+		in->busy = FALSE;
+		g_queue_push_tail (&in->parent->open, in);
+	} else {
+		g_warning ("trying to close iconv i dont know about: %p", ip);
+		g_iconv_close (ip);
+	}
+	G_UNLOCK (iconv);
+}
+
+static void
+iconv_thread_cache_free (gpointer ptr)
+{
+	struct _iconv_thread_cache *tc = ptr;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, tc->idle);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GQueue *queue = value;
+		GIConv ip;
+
+		while ((ip = g_queue_pop_head (queue)) != NULL)
+			iconv_close_shared (ip);
+
+		g_queue_free (queue);
+	}
+
+	/* converters still open, to be closed by other threads */
+	G_LOCK (iconv);
+	g_mutex_lock (&tc->lock);
+
+	g_hash_table_iter_init (&iter, tc->busy);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_hash_table_remove (iconv_cache_owner, key);
+
+	g_mutex_unlock (&tc->lock);
+	G_UNLOCK (iconv);
+
+	g_mutex_clear (&tc->lock);
+	g_hash_table_destroy (tc->idle);
+	g_hash_table_destroy (tc->busy);
+	g_hash_table_destroy (tc->names);
+	g_free (tc);
+}
+
+/**
+ * camel_iconv_open: (skip)
+ * @to: charset to convert to
+ * @from: charset to convert from
+ *
+ * Returns: a #GIConv for the conversion from charset @from to charset @to, or (GIConv) -1 on error.
+ **/
+GIConv
+camel_iconv_open (const gchar *to,
+                  const gchar *from)
+{
+	struct _iconv_thread_cache *tc;
+	const gchar *nto, *nfrom;
+	gchar *tofrom, *key = NULL;
+	gsize tofrom_len;
+	GQueue *queue = NULL;
+	GIConv ip;
+
+	if (to == NULL || from == NULL) {
+		errno = EINVAL;
+		return (GIConv) -1;
+	}
+
+	nto = camel_iconv_charset_name (to);
+	nfrom = camel_iconv_charset_name (from);
+	tofrom_len = strlen (nto) + strlen (nfrom) + 2;
+	tofrom = g_alloca (tofrom_len);
+	g_snprintf (tofrom, tofrom_len, "%s%%%s", nto, nfrom);
+
+	tc = iconv_thread_cache_get ();
+
+	if (g_hash_table_lookup_extended (tc->idle, tofrom, (gpointer *) &key, (gpointer *) &queue) &&
+	    (ip = g_queue_pop_head (queue)) != NULL) {
+		/* work around some broken iconv implementations
+		 * that die if the length arguments are NULL
+		 */
+		gsize buggy_iconv_len = 0;
+		gchar *buggy_iconv_buf = NULL;
+
+		cd (printf ("using thread's iconv converter '%s'\n", key));
+
+		/* resets the converter */
+		g_iconv (ip, &buggy_iconv_buf, &buggy_iconv_len, &buggy_iconv_buf, &buggy_iconv_len);
+
+		tc->n_idle--;
+
+		g_mutex_lock (&tc->lock);
+		g_hash_table_insert (tc->busy, ip, key);
+		g_mutex_unlock (&tc->lock);
+
+		return ip;
+	}
+
+	ip = iconv_open_shared (tc, nto, nfrom, tofrom);
+
+	if (ip != (GIConv) -1) {
+		if (!key) {
+			key = g_strdup (tofrom);
+			queue = g_queue_new ();
+			g_hash_table_insert (tc->idle, key, queue);
+		}
+
+		g_mutex_lock (&tc->lock);
+		g_hash_table_insert (tc->busy, ip, key);
+		g_mutex_unlock (&tc->lock);
+	}
+
+	return ip;
+}
+
 gsize
 camel_iconv (GIConv cd,
              const gchar **inbuf,
@@ -489,23 +670,214 @@ camel_iconv (GIConv cd,
 void
 camel_iconv_close (GIConv ip)
 {
-	struct _iconv_cache_node *in;
+	struct _iconv_thread_cache *tc;
+	const gchar *key;
 
 	if (ip == (GIConv) -1)
 		return;
 
-	G_LOCK (iconv);
-	in = g_hash_table_lookup (iconv_cache_open, ip);
-	if (in) {
-		cd (printf ("closing iconv converter '%s'\n", in->parent->conv));
-		g_queue_remove (&in->parent->open, in);
-		in->busy = FALSE;
-		g_queue_push_tail (&in->parent->open, in);
-	} else {
-		g_warning ("trying to close iconv i dont know about: %p", ip);
-		g_iconv_close (ip);
+	/* converters opened in another thread go back to the shared cache */
+	tc = iconv_thread_cache_get ();
+
+	g_mutex_lock (&tc->lock);
+	key = g_hash_table_lookup (tc->busy, ip);
+	if (key && tc->n_idle < E_ICONV_THREAD_CACHE_SIZE) {
+		g_hash_table_remove (tc->busy, ip);
+		g_mutex_unlock (&tc->lock);
+
+		cd (printf ("keeping iconv converter '%s' in the thread\n", key));
+		g_queue_push_head (g_hash_table_lookup (tc->idle, key), ip);
+		tc->n_idle++;
+
+		return;
 	}
-	G_UNLOCK (iconv);
+	g_mutex_unlock (&tc->lock);
+
+	iconv_close_shared (ip);
+}
+
+/* Processes the input by words, which lets the compiler vectorize it */
+static gsize
+iconv_ascii_prefix (const gchar *str,
+                    gsize len)
+{
+	const guchar *inptr = (const guchar *) str;
+	gsize ii = 0;
+
+	while (ii + 4 * sizeof (guint64) <= len) {
+		guint64 words[4];
+
+		memcpy (words, inptr + ii, sizeof (words));
+		if (((words[0] | words[1] | words[2] | words[3]) & G_GUINT64_CONSTANT (0x8080808080808080)) != 0)
+			break;
+
+		ii += sizeof (words);
+	}
+
+	while (ii < len && inptr[ii] < 0x80)
+		ii++;
+
+	return ii;
+}
+
+/**
+ * camel_iconv_is_ascii:
+ * @str: a string
+ * @len: length of the @str, in bytes
+ *
+ * Checks whether all the @len bytes of the @str are 7-bit US-ASCII
+ * characters, thus whether it can be used as-is in any ASCII-compatible
+ * charset, UTF-8 included.
+ *
+ * Returns: whether the @str is a pure US-ASCII text
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_iconv_is_ascii (const gchar *str,
+                      gsize len)
+{
+	g_return_val_if_fail (str != NULL || len == 0, FALSE);
+
+	return iconv_ascii_prefix (str, len) == len;
+}
+
+/**
+ * camel_iconv_latin1_to_utf8:
+ * @in: an ISO-8859-1 text
+ * @inlen: length of the @in, in bytes
+ * @out: output buffer, at least 2 * @inlen bytes long
+ *
+ * Converts the @in from ISO-8859-1 to UTF-8, without using iconv.
+ * The output is not NUL-terminated.
+ *
+ * Returns: how many bytes had been written into the @out
+ *
+ * Since: 3.28
+ **/
+gsize
+camel_iconv_latin1_to_utf8 (const gchar *in,
+                            gsize inlen,
+                            gchar *out)
+{
+	const guchar *inptr = (const guchar *) in;
+	const guchar *inend = inptr + inlen;
+	guchar *outptr = (guchar *) out;
+
+	while (inptr < inend) {
+		gsize ascii;
+
+		ascii = iconv_ascii_prefix ((const gchar *) inptr, inend - inptr);
+		memcpy (outptr, inptr, ascii);
+		inptr += ascii;
+		outptr += ascii;
+
+		while (inptr < inend && *inptr >= 0x80) {
+			*outptr++ = 0xc0 | (*inptr >> 6);
+			*outptr++ = 0x80 | (*inptr & 0x3f);
+			inptr++;
+		}
+	}
+
+	return outptr - (guchar *) out;
+}
+
+static gboolean
+iconv_charset_is (const gchar *charset,
+                  const gchar * const *names)
+{
+	gint ii;
+
+	for (ii = 0; names[ii]; ii++) {
+		if (g_ascii_strcasecmp (charset, names[ii]) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * camel_iconv_get_fast_path:
+ * @to: charset to convert to
+ * @from: charset to convert from
+ *
+ * Checks whether the conversion from @from to @to can be done
+ * without iconv, by camel_iconv_fast_strndup() or by the helper
+ * functions camel_iconv_is_ascii() and camel_iconv_latin1_to_utf8().
+ *
+ * Returns: a #CamelIconvFastPath for the conversion,
+ *    %CAMEL_ICONV_FAST_PATH_NONE when iconv is needed
+ *
+ * Since: 3.28
+ **/
+CamelIconvFastPath
+camel_iconv_get_fast_path (const gchar *to,
+                           const gchar *from)
+{
+	const gchar *utf8_names[] = { "UTF-8", "UTF8", NULL };
+	const gchar *ascii_names[] = { "US-ASCII", "ASCII", "ANSI_X3.4-1968", "us", NULL };
+	const gchar *latin1_names[] = { "ISO-8859-1", "ISO8859-1", "ISO_8859-1", "latin1", "l1", NULL };
+
+	if (!to || !from || !iconv_charset_is (to, utf8_names))
+		return CAMEL_ICONV_FAST_PATH_NONE;
+
+	if (iconv_charset_is (from, utf8_names))
+		return CAMEL_ICONV_FAST_PATH_UTF8;
+
+	if (iconv_charset_is (from, ascii_names))
+		return CAMEL_ICONV_FAST_PATH_ASCII;
+
+	if (iconv_charset_is (from, latin1_names))
+		return CAMEL_ICONV_FAST_PATH_LATIN1;
+
+	return CAMEL_ICONV_FAST_PATH_NONE;
+}
+
+/**
+ * camel_iconv_fast_strndup:
+ * @to: charset to convert to
+ * @from: charset to convert from
+ * @str: text in the @from charset
+ * @len: length of the @str, in bytes
+ *
+ * Converts the @str without using iconv, when the conversion has
+ * a fast path (see camel_iconv_get_fast_path()) and the @str is valid
+ * in the @from charset. The caller should use iconv when this returns %NULL.
+ *
+ * Returns: (transfer full) (nullable): a newly allocated NUL-terminated
+ *    string in the @to charset, or %NULL. Free it with g_free(), when
+ *    no longer needed.
+ *
+ * Since: 3.28
+ **/
+gchar *
+camel_iconv_fast_strndup (const gchar *to,
+                          const gchar *from,
+                          const gchar *str,
+                          gsize len)
+{
+	gchar *out;
+
+	g_return_val_if_fail (str != NULL || len == 0, NULL);
+
+	switch (camel_iconv_get_fast_path (to, from)) {
+	case CAMEL_ICONV_FAST_PATH_ASCII:
+		if (!camel_iconv_is_ascii (str, len))
+			return NULL;
+		/* Falls through */
+	case CAMEL_ICONV_FAST_PATH_UTF8:
+		if (!g_utf8_validate (str, len, NULL))
+			return NULL;
+		return g_strndup (str, len);
+	case CAMEL_ICONV_FAST_PATH_LATIN1:
+		out = g_malloc (len * 2 + 1);
+		out[camel_iconv_latin1_to_utf8 (str, len, out)] = '\0';
+		return out;
+	case CAMEL_ICONV_FAST_PATH_NONE:
+		break;
+	}
+
+	return NULL;
 }
 
 const gchar *
@@ -29,6 +29,24 @@
 
 G_BEGIN_DECLS
 
+/**
+ * CamelIconvFastPath:
+ * @CAMEL_ICONV_FAST_PATH_NONE: the conversion needs iconv
+ * @CAMEL_ICONV_FAST_PATH_ASCII: from US-ASCII to UTF-8, a copy of valid input
+ * @CAMEL_ICONV_FAST_PATH_LATIN1: from ISO-8859-1 to UTF-8
+ * @CAMEL_ICONV_FAST_PATH_UTF8: from UTF-8 to UTF-8, a copy of valid input
+ *
+ * Conversions, which can be done without iconv.
+ *
+ * Since: 3.28
+ **/
+typedef enum {
+	CAMEL_ICONV_FAST_PATH_NONE = 0,
+	CAMEL_ICONV_FAST_PATH_ASCII,
+	CAMEL_ICONV_FAST_PATH_LATIN1,
+	CAMEL_ICONV_FAST_PATH_UTF8
+} CamelIconvFastPath;
+
 const gchar *	camel_iconv_locale_charset	(void);
 const gchar *	camel_iconv_locale_language	(void);
 
@@ -44,6 +62,19 @@ gsize		camel_iconv			(GIConv cd,
 						 gsize *outleft);
 void		camel_iconv_close		(GIConv cd);
 
+CamelIconvFastPath
+		camel_iconv_get_fast_path	(const gchar *to,
+						 const gchar *from);
+gboolean	camel_iconv_is_ascii		(const gchar *str,
+						 gsize len);
+gsize		camel_iconv_latin1_to_utf8	(const gchar *in,
+						 gsize inlen,
+						 gchar *out);
+gchar *		camel_iconv_fast_strndup	(const gchar *to,
+						 const gchar *from,
+						 const gchar *str,
+						 gsize len);
+
 G_END_DECLS
 
 #endif /* CAMEL_ICONV_H */
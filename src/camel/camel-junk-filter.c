@@ -24,9 +24,65 @@
 
 G_DEFINE_INTERFACE (CamelJunkFilter, camel_junk_filter, G_TYPE_OBJECT)
 
+static gboolean
+junk_filter_classify_batch (CamelJunkFilter *junk_filter,
+                            GPtrArray *messages,
+                            CamelJunkStatus *out_statuses,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	guint ii;
+
+	for (ii = 0; ii < messages->len; ii++) {
+		out_statuses[ii] = camel_junk_filter_classify (
+			junk_filter, messages->pdata[ii], cancellable, error);
+
+		if (out_statuses[ii] == CAMEL_JUNK_STATUS_ERROR)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+junk_filter_learn_junk_batch (CamelJunkFilter *junk_filter,
+                              GPtrArray *messages,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	guint ii;
+
+	for (ii = 0; ii < messages->len; ii++) {
+		if (!camel_junk_filter_learn_junk (junk_filter, messages->pdata[ii], cancellable, error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+junk_filter_learn_not_junk_batch (CamelJunkFilter *junk_filter,
+                                  GPtrArray *messages,
+                                  GCancellable *cancellable,
+                                  GError **error)
+{
+	guint ii;
+
+	for (ii = 0; ii < messages->len; ii++) {
+		if (!camel_junk_filter_learn_not_junk (junk_filter, messages->pdata[ii], cancellable, error))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 camel_junk_filter_default_init (CamelJunkFilterInterface *iface)
 {
+	/* These call the single-message methods, one message at a time */
+	iface->classify_batch = junk_filter_classify_batch;
+	iface->learn_junk_batch = junk_filter_learn_junk_batch;
+	iface->learn_not_junk_batch = junk_filter_learn_not_junk_batch;
 }
 
 /**
@@ -175,3 +231,123 @@ camel_junk_filter_synchronize (CamelJunkFilter *junk_filter,
 	return success;
 }
 
+
+/**
+ * camel_junk_filter_classify_batch:
+ * @junk_filter: a #CamelJunkFilter
+ * @messages: (element-type CamelMimeMessage): messages to classify
+ * @out_statuses: (array) (out caller-allocates): return location for
+ *    the junk statuses, one for each of the @messages
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Classifies all the @messages as junk, not junk or inconclusive, like
+ * camel_junk_filter_classify() does for a single message. Implementations
+ * which run an external program can classify all the @messages in one run.
+ * The default implementation classifies the messages one by one.
+ *
+ * If an error occurs, the function sets @error and returns %FALSE,
+ * the @out_statuses are then undefined.
+ *
+ * Returns: %TRUE if all the @messages were classified
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_junk_filter_classify_batch (CamelJunkFilter *junk_filter,
+                                  GPtrArray *messages,
+                                  CamelJunkStatus *out_statuses,
+                                  GCancellable *cancellable,
+                                  GError **error)
+{
+	CamelJunkFilterInterface *iface;
+
+	g_return_val_if_fail (CAMEL_IS_JUNK_FILTER (junk_filter), FALSE);
+	g_return_val_if_fail (messages != NULL, FALSE);
+	g_return_val_if_fail (out_statuses != NULL || messages->len == 0, FALSE);
+
+	if (!messages->len)
+		return TRUE;
+
+	iface = CAMEL_JUNK_FILTER_GET_INTERFACE (junk_filter);
+	g_return_val_if_fail (iface->classify_batch != NULL, FALSE);
+
+	return iface->classify_batch (
+		junk_filter, messages, out_statuses, cancellable, error);
+}
+
+/**
+ * camel_junk_filter_learn_junk_batch:
+ * @junk_filter: a #CamelJunkFilter
+ * @messages: (element-type CamelMimeMessage): messages to learn as junk
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Instructs @junk_filter to classify all the @messages as junk, like
+ * camel_junk_filter_learn_junk() does for a single message.
+ * The default implementation learns the messages one by one.
+ *
+ * If an error occurs, the function sets @error and returns %FALSE.
+ *
+ * Returns: %TRUE if all the @messages were successfully classified
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_junk_filter_learn_junk_batch (CamelJunkFilter *junk_filter,
+                                    GPtrArray *messages,
+                                    GCancellable *cancellable,
+                                    GError **error)
+{
+	CamelJunkFilterInterface *iface;
+
+	g_return_val_if_fail (CAMEL_IS_JUNK_FILTER (junk_filter), FALSE);
+	g_return_val_if_fail (messages != NULL, FALSE);
+
+	if (!messages->len)
+		return TRUE;
+
+	iface = CAMEL_JUNK_FILTER_GET_INTERFACE (junk_filter);
+	g_return_val_if_fail (iface->learn_junk_batch != NULL, FALSE);
+
+	return iface->learn_junk_batch (
+		junk_filter, messages, cancellable, error);
+}
+
+/**
+ * camel_junk_filter_learn_not_junk_batch:
+ * @junk_filter: a #CamelJunkFilter
+ * @messages: (element-type CamelMimeMessage): messages to learn as not junk
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Instructs @junk_filter to classify all the @messages as not junk, like
+ * camel_junk_filter_learn_not_junk() does for a single message.
+ * The default implementation learns the messages one by one.
+ *
+ * If an error occurs, the function sets @error and returns %FALSE.
+ *
+ * Returns: %TRUE if all the @messages were successfully classified
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_junk_filter_learn_not_junk_batch (CamelJunkFilter *junk_filter,
+                                        GPtrArray *messages,
+                                        GCancellable *cancellable,
+                                        GError **error)
+{
+	CamelJunkFilterInterface *iface;
+
+	g_return_val_if_fail (CAMEL_IS_JUNK_FILTER (junk_filter), FALSE);
+	g_return_val_if_fail (messages != NULL, FALSE);
+
+	if (!messages->len)
+		return TRUE;
+
+	iface = CAMEL_JUNK_FILTER_GET_INTERFACE (junk_filter);
+	g_return_val_if_fail (iface->learn_not_junk_batch != NULL, FALSE);
+
+	return iface->learn_not_junk_batch (
+		junk_filter, messages, cancellable, error);
+}
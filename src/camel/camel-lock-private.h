@@ -0,0 +1,35 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_LOCK_PRIVATE_H
+#define CAMEL_LOCK_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Exponentially growing delays between locking attempts,
+ * see CAMEL_LOCK_BACKOFF_MIN and CAMEL_LOCK_BACKOFF_MAX */
+typedef struct _CamelLockBackoff {
+	gint64 deadline;	/* monotonic time, in microseconds */
+	gulong delay;		/* the next delay, in microseconds */
+} CamelLockBackoff;
+
+void		camel_lock_backoff_init		(CamelLockBackoff *backoff,
+						 gint timeout_seconds);
+gboolean	camel_lock_backoff_wait		(CamelLockBackoff *backoff);
+
+G_END_DECLS
+
+#endif /* CAMEL_LOCK_PRIVATE_H */
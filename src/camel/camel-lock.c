@@ -42,6 +42,11 @@
 #include <sys/file.h>
 #endif
 
+#if defined (USE_DOT_LOCKING) && defined (HAVE_SYS_INOTIFY_H)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 #include <gio/gio.h>
 #include <glib/gi18n-lib.h>
 #include <glib/gstdio.h>
@@ -51,6 +56,7 @@
 #endif
 
 #include "camel-lock.h"
+#include "camel-lock-private.h"
 
 #define d(x) /*(printf("%s(%d): ", __FILE__, __LINE__),(x))*/
 
@@ -60,6 +66,188 @@
 	} \
 	} G_STMT_END
 
+/**
+ * camel_lock_backoff_init: (skip)
+ **/
+void
+camel_lock_backoff_init (CamelLockBackoff *backoff,
+                         gint timeout_seconds)
+{
+	backoff->deadline = g_get_monotonic_time () + (gint64) timeout_seconds * G_USEC_PER_SEC;
+	backoff->delay = CAMEL_LOCK_BACKOFF_MIN;
+}
+
+/* Returns how long to wait before the next locking attempt,
+ * in microseconds, or 0, when the time for locking ran out. */
+static gulong
+lock_backoff_next_delay (CamelLockBackoff *backoff)
+{
+	gint64 now = g_get_monotonic_time ();
+	gulong delay;
+
+	if (now >= backoff->deadline)
+		return 0;
+
+	delay = MIN (backoff->delay, backoff->deadline - now);
+	backoff->delay = CLAMP (backoff->delay * 2, CAMEL_LOCK_BACKOFF_MIN, CAMEL_LOCK_BACKOFF_MAX);
+
+	return delay;
+}
+
+/**
+ * camel_lock_backoff_wait: (skip)
+ *
+ * Waits before the next locking attempt. Returns FALSE,
+ * when the time for locking ran out.
+ **/
+gboolean
+camel_lock_backoff_wait (CamelLockBackoff *backoff)
+{
+	gulong delay;
+
+	delay = lock_backoff_next_delay (backoff);
+	if (!delay)
+		return FALSE;
+
+	g_usleep (delay);
+
+	return TRUE;
+}
+
+#if defined (USE_DOT_LOCKING) && defined (HAVE_SYS_INOTIFY_H)
+/* Reads pending events of a watch added by lock_dot_watch_new(),
+ * returns whether any of them was the removal of the @name file. */
+static gboolean
+lock_dot_watch_read (gint watch_fd,
+                     const gchar *name)
+{
+	gchar buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	gboolean removed = FALSE;
+	gssize len;
+
+	while ((len = read (watch_fd, buffer, sizeof (buffer))) > 0) {
+		const gchar *ptr;
+
+		for (ptr = buffer; ptr < buffer + len; ptr += sizeof (struct inotify_event) + ((const struct inotify_event *) ptr)->len) {
+			const struct inotify_event *event = (const struct inotify_event *) ptr;
+
+			/* an overflow can hide the removal */
+			if ((event->mask & IN_Q_OVERFLOW) != 0 ||
+			    (event->len && strcmp (event->name, name) == 0))
+				removed = TRUE;
+		}
+	}
+
+	return removed;
+}
+#endif
+
+#ifdef USE_DOT_LOCKING
+/* Like camel_lock_backoff_wait(), only when @watch_fd is not -1,
+ * the wait ends early, once the @watch_name file is removed. */
+static gboolean
+lock_backoff_wait_watch (CamelLockBackoff *backoff,
+                         gint watch_fd,
+                         const gchar *watch_name)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	if (watch_fd != -1) {
+		gint64 now = g_get_monotonic_time ();
+		gint64 end;
+		gulong delay;
+
+		delay = lock_backoff_next_delay (backoff);
+		if (!delay)
+			return FALSE;
+
+		end = now + delay;
+
+		/* other files in the directory come and go too, like our own temporary files */
+		while ((now = g_get_monotonic_time ()) < end) {
+			struct pollfd pfd;
+
+			pfd.fd = watch_fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+
+			/* round up, not to spin on sub-millisecond leftovers */
+			if (poll (&pfd, 1, (end - now + 999) / 1000) <= 0)
+				break;
+
+			if (lock_dot_watch_read (watch_fd, watch_name)) {
+				/* the holder is done, the next waits should be short again */
+				backoff->delay = CAMEL_LOCK_BACKOFF_MIN;
+				break;
+			}
+		}
+
+		return TRUE;
+	}
+#endif
+
+	return camel_lock_backoff_wait (backoff);
+}
+#endif
+
+#ifdef USE_FCNTL_LOCKING
+#ifdef F_OFD_SETLK
+/* set when the kernel refused open file description locks */
+static volatile gint lock_fcntl_no_ofd = 0;
+#endif
+
+/* Prefers open file description locks where available; unlike the classic
+ * record locks, they are not dropped when the process closes any other
+ * descriptor of the file, and they conflict with each other within one process */
+static gint
+lock_fcntl_setlk (gint fd,
+                  struct flock *lock)
+{
+#ifdef F_OFD_SETLK
+	if (!g_atomic_int_get (&lock_fcntl_no_ofd)) {
+		gint res;
+
+		res = fcntl (fd, F_OFD_SETLK, lock);
+		if (res == 0 || errno != EINVAL)
+			return res;
+
+		g_atomic_int_set (&lock_fcntl_no_ofd, 1);
+	}
+#endif
+
+	return fcntl (fd, F_SETLK, lock);
+}
+#endif
+
+#ifdef USE_DOT_LOCKING
+/* Returns an inotify descriptor, which becomes readable when
+ * the @lock file is removed or renamed, or -1 when not supported. */
+static gint
+lock_dot_watch_new (const gchar *lock)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	gchar *dirname;
+	gint fd;
+
+	fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1)
+		return -1;
+
+	/* watch the directory, the lock file can be gone before a watch on it is added */
+	dirname = g_path_get_dirname (lock);
+	if (inotify_add_watch (fd, dirname, IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR) == -1) {
+		d (printf ("cannot watch '%s': %s\n", dirname, g_strerror (errno)));
+		close (fd);
+		fd = -1;
+	}
+	g_free (dirname);
+
+	return fd;
+#else
+	return -1;
+#endif
+}
+#endif
+
 /**
  * camel_lock_dot:
  * @path: a path to lock
@@ -83,7 +271,10 @@ camel_lock_dot (const gchar *path,
 	gsize locktmp_len = 0;
 	gint retry = 0;
 	gint fdtmp;
+	gint watch_fd = -1;
+	gchar *watch_name;
 	struct stat st;
+	CamelLockBackoff backoff;
 
 	/* TODO: Is there a reliable way to refresh the lock, if we're still busy with it?
 	 * Does it matter?  We will normally also use fcntl too ... */
@@ -94,13 +285,14 @@ camel_lock_dot (const gchar *path,
 	g_snprintf (lock, lock_len, "%s.lock", path);
 	locktmp_len = strlen (path) + strlen ("XXXXXX") + 1;
 	locktmp = alloca (locktmp_len);
+	watch_name = strrchr (lock, G_DIR_SEPARATOR);
+	watch_name = watch_name ? watch_name + 1 : lock;
 
-	while (retry < CAMEL_LOCK_DOT_RETRY) {
+	camel_lock_backoff_init (&backoff, CAMEL_LOCK_DOT_RETRY * CAMEL_LOCK_DOT_DELAY);
 
-		d (printf ("trying to lock '%s', attempt %d\n", lock, retry));
+	while (retry == 0 || lock_backoff_wait_watch (&backoff, watch_fd, watch_name)) {
 
-		if (retry > 0)
-			sleep (CAMEL_LOCK_DOT_DELAY);
+		d (printf ("trying to lock '%s', attempt %d\n", lock, retry));
 
 		g_snprintf (locktmp, locktmp_len, "%sXXXXXX", path);
 		fdtmp = g_mkstemp (locktmp);
@@ -110,6 +302,8 @@ camel_lock_dot (const gchar *path,
 				g_io_error_from_errno (errno),
 				_("Could not create lock file for %s: %s"),
 				path, g_strerror (errno));
+			if (watch_fd != -1)
+				close (watch_fd);
 			return -1;
 		}
 		close (fdtmp);
@@ -130,23 +324,37 @@ camel_lock_dot (const gchar *path,
 			unlink (locktmp);
 
 			/* if we had 2 links, we have created the .lock, return ok, otherwise we need to keep trying */
-			if (st.st_nlink == 2)
+			if (st.st_nlink == 2) {
+				if (watch_fd != -1)
+					close (watch_fd);
 				return 0;
+			}
 		}
 
-		/* check for stale lock, kill it */
+		/* wait for the holder to remove the lock, rather than only for the time to pass */
+		if (watch_fd == -1 && retry == 0)
+			watch_fd = lock_dot_watch_new (lock);
+
+		/* check for stale lock, kill it; this also catches the lock
+		 * removed before the watch was added */
 		if (g_stat (lock, &st) == 0) {
 			time_t now = time (NULL);
-			printf ("There is an existing lock %" G_GINT64_FORMAT "seconds old\n", (gint64) now - (gint64) st.st_ctime);
+			d (printf ("There is an existing lock %" G_GINT64_FORMAT " seconds old\n", (gint64) now - (gint64) st.st_ctime));
 			if (st.st_ctime < now - CAMEL_LOCK_DOT_STALE) {
 				d (printf ("Removing it now\n"));
 				unlink (lock);
 			}
+		} else if (errno == ENOENT) {
+			/* gone already, retry right away */
+			backoff.delay = 0;
 		}
 
 		retry++;
 	}
 
+	if (watch_fd != -1)
+		close (watch_fd);
+
 	d (printf ("failed to get lock after %d retries\n", retry));
 
 	g_set_error (
@@ -210,7 +418,7 @@ camel_lock_fcntl (gint fd,
 
 	memset (&lock, 0, sizeof (lock));
 	lock.l_type = type == CAMEL_LOCK_READ ? F_RDLCK : F_WRLCK;
-	if (fcntl (fd, F_SETLK, &lock) == -1) {
+	if (lock_fcntl_setlk (fd, &lock) == -1) {
 		/* If we get a 'locking not vailable' type error,
 		 * we assume the filesystem doesn't support fcntl () locking */
 		/* this is somewhat system-dependent */
@@ -251,7 +459,7 @@ camel_unlock_fcntl (gint fd)
 
 	memset (&lock, 0, sizeof (lock));
 	lock.l_type = F_UNLCK;
-	CHECK_CALL (fcntl (fd, F_SETLK, &lock));
+	CHECK_CALL (lock_fcntl_setlk (fd, &lock));
 #endif
 }
 
@@ -324,7 +532,9 @@ camel_unlock_flock (gint fd)
  * @error: return location for a #GError, or %NULL
  *
  * Attempt to lock a folder, multiple attempts will be made using all
- * locking strategies available.
+ * locking strategies available. The attempts are retried after short,
+ * exponentially growing delays, for up to CAMEL_LOCK_RETRY times
+ * CAMEL_LOCK_DELAY seconds in total.
  *
  * Returns: -1 on error, @ex will describe the locking system that failed.
  **/
@@ -334,22 +544,25 @@ camel_lock_folder (const gchar *path,
                    CamelLockType type,
                    GError **error)
 {
-	gint retry = 0;
+	CamelLockBackoff backoff;
+	GError *local_error = NULL;
 
-	while (retry < CAMEL_LOCK_RETRY) {
-		if (retry > 0)
-			g_usleep (CAMEL_LOCK_DELAY * 1000000);
+	camel_lock_backoff_init (&backoff, CAMEL_LOCK_RETRY * CAMEL_LOCK_DELAY);
 
-		if (camel_lock_fcntl (fd, type, error) == 0) {
-			if (camel_lock_flock (fd, type, error) == 0) {
-				if (camel_lock_dot (path, error) == 0)
+	do {
+		g_clear_error (&local_error);
+
+		if (camel_lock_fcntl (fd, type, &local_error) == 0) {
+			if (camel_lock_flock (fd, type, &local_error) == 0) {
+				if (camel_lock_dot (path, &local_error) == 0)
 					return 0;
 				camel_unlock_flock (fd);
 			}
 			camel_unlock_fcntl (fd);
 		}
-		retry++;
-	}
+	} while (camel_lock_backoff_wait (&backoff));
+
+	g_propagate_error (error, local_error);
 
 	return -1;
 }
@@ -35,6 +35,12 @@
 #define CAMEL_LOCK_RETRY (5) /* number of times to retry lock */
 #define CAMEL_LOCK_DELAY (2) /* delay between locking retries */
 
+/* Retries are not evenly spaced: the delay between them starts at
+ * CAMEL_LOCK_BACKOFF_MIN and doubles up to CAMEL_LOCK_BACKOFF_MAX, while
+ * the retry counts times the delays above limit the total time waited */
+#define CAMEL_LOCK_BACKOFF_MIN (1000) /* first delay, in microseconds */
+#define CAMEL_LOCK_BACKOFF_MAX (250000) /* longest delay, in microseconds */
+
 G_BEGIN_DECLS
 
 typedef enum {
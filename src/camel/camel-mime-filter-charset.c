@@ -37,6 +37,7 @@ struct _CamelMimeFilterCharsetPrivate {
 	iconv_t ic;
 	gchar *from;
 	gchar *to;
+	CamelIconvFastPath fast_path;
 };
 
 G_DEFINE_TYPE (CamelMimeFilterCharset, camel_mime_filter_charset, CAMEL_TYPE_MIME_FILTER)
@@ -60,6 +61,61 @@ mime_filter_charset_finalize (GObject *object)
 	G_OBJECT_CLASS (camel_mime_filter_charset_parent_class)->finalize (object);
 }
 
+/* Converts without iconv, when possible; returns FALSE when
+ * the input needs to go through iconv */
+static gboolean
+mime_filter_charset_fast (CamelMimeFilter *mime_filter,
+                          const gchar *in,
+                          gsize len,
+                          gsize prespace,
+                          gboolean complete,
+                          gchar **out,
+                          gsize *outlen,
+                          gsize *outprespace)
+{
+	CamelMimeFilterCharsetPrivate *priv;
+	const gchar *end;
+
+	priv = CAMEL_MIME_FILTER_CHARSET_GET_PRIVATE (mime_filter);
+
+	switch (priv->fast_path) {
+	case CAMEL_ICONV_FAST_PATH_LATIN1:
+		camel_mime_filter_set_size (mime_filter, len * 2 + 16, FALSE);
+
+		*out = mime_filter->outbuf;
+		*outlen = camel_iconv_latin1_to_utf8 (in, len, mime_filter->outbuf);
+		*outprespace = mime_filter->outpre;
+
+		return TRUE;
+	case CAMEL_ICONV_FAST_PATH_ASCII:
+		if (!camel_iconv_is_ascii (in, len))
+			return FALSE;
+
+		end = in + len;
+		break;
+	case CAMEL_ICONV_FAST_PATH_UTF8:
+		if (!g_utf8_validate (in, len, &end)) {
+			gsize rest = in + len - end;
+
+			/* only an incomplete character at the end can wait for more data */
+			if (complete || rest >= 6 || g_utf8_get_char_validated (end, rest) != (gunichar) -2)
+				return FALSE;
+
+			camel_mime_filter_backup (mime_filter, end, rest);
+		}
+		break;
+	default:
+		return FALSE;
+	}
+
+	/* the input is valid in the target charset */
+	*out = (gchar *) in;
+	*outlen = end - in;
+	*outprespace = prespace;
+
+	return TRUE;
+}
+
 static void
 mime_filter_charset_complete (CamelMimeFilter *mime_filter,
                               const gchar *in,
@@ -79,6 +135,9 @@ mime_filter_charset_complete (CamelMimeFilter *mime_filter,
 	if (priv->ic == (iconv_t) -1)
 		goto noop;
 
+	if (mime_filter_charset_fast (mime_filter, in, len, prespace, TRUE, out, outlen, outprespace))
+		return;
+
 	camel_mime_filter_set_size (mime_filter, len * 5 + 16, FALSE);
 	outbuf = mime_filter->outbuf;
 	outleft = mime_filter->outsize;
@@ -170,6 +229,9 @@ mime_filter_charset_filter (CamelMimeFilter *mime_filter,
 	if (priv->ic == (iconv_t) -1)
 		goto noop;
 
+	if (mime_filter_charset_fast (mime_filter, in, len, prespace, FALSE, out, outlen, outprespace))
+		return;
+
 	camel_mime_filter_set_size (mime_filter, len * 5 + 16, FALSE);
 	outbuf = mime_filter->outbuf + converted;
 	outleft = mime_filter->outsize - converted;
@@ -293,6 +355,9 @@ camel_mime_filter_charset_new (const gchar *from_charset,
 	} else {
 		priv->from = g_strdup (from_charset);
 		priv->to = g_strdup (to_charset);
+		priv->fast_path = camel_iconv_get_fast_path (
+			camel_iconv_charset_name (to_charset),
+			camel_iconv_charset_name (from_charset));
 	}
 
 	return new;
@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "camel-mime-filter-tohtml.h"
+#include "camel-trie.h"
 #include "camel-url-scanner.h"
 #include "camel-utf8.h"
 
@@ -33,6 +34,8 @@
 struct _CamelMimeFilterToHTMLPrivate {
 
 	CamelUrlScanner *scanner;
+	/* the same patterns, to find lines without any quickly */
+	CamelTrie *trie;
 
 	CamelMimeFilterToHTMLFlags flags;
 	guint32 color;
@@ -55,6 +58,13 @@ struct _CamelMimeFilterToHTMLPrivate {
 
 #define FOOLISHLY_UNMUNGE_FROM 0
 
+/* checks of 8 bytes at once; the result is only exact as to
+ * whether any byte of the word matches */
+#define WORD_ONES G_GUINT64_CONSTANT (0x0101010101010101)
+#define WORD_HIGHS G_GUINT64_CONSTANT (0x8080808080808080)
+#define word_has_less(x, n) (((x) - WORD_ONES * (n)) & ~(x) & WORD_HIGHS)
+#define word_has_byte(x, c) word_has_less ((x) ^ (WORD_ONES * (c)), 1)
+
 #define CONVERT_WEB_URLS  CAMEL_MIME_FILTER_TOHTML_CONVERT_URLS
 #define CONVERT_ADDRSPEC  CAMEL_MIME_FILTER_TOHTML_CONVERT_ADDRESSES
 
@@ -95,8 +105,10 @@ check_size (CamelMimeFilter *mime_filter,
 
 	offset = outptr - mime_filter->outbuf;
 
+	/* grow by a half at least, not to reallocate for every few
+	 * escaped characters of a large buffer */
 	camel_mime_filter_set_size (
-		mime_filter, mime_filter->outsize + len, TRUE);
+		mime_filter, mime_filter->outsize + MAX (len, mime_filter->outsize / 2), TRUE);
 
 	*outend = mime_filter->outbuf + mime_filter->outsize;
 
@@ -162,6 +174,40 @@ exit:
 	return depth;
 }
 
+static inline gboolean
+is_plain_char (guchar c,
+               gboolean convert_spaces)
+{
+	return c >= 20 && c < 0x80 && c != '<' && c != '>' && c != '&' && c != '"' && (c != ' ' || !convert_spaces);
+}
+
+/* length of the run of characters at @in which writeln() copies as they are */
+static gsize
+plain_run_length (const guchar *in,
+                  const guchar *inend,
+                  gboolean convert_spaces)
+{
+	const guchar *inptr = in;
+
+	while (inend - inptr >= sizeof (guint64)) {
+		guint64 word;
+
+		memcpy (&word, inptr, sizeof (word));
+		if ((word & WORD_HIGHS) != 0 || word_has_less (word, 20) ||
+		    word_has_byte (word, '<') || word_has_byte (word, '>') ||
+		    word_has_byte (word, '&') || word_has_byte (word, '"') ||
+		    (convert_spaces && word_has_byte (word, ' ')))
+			break;
+
+		inptr += sizeof (word);
+	}
+
+	while (inptr < inend && is_plain_char (*inptr, convert_spaces))
+		inptr++;
+
+	return inptr - in;
+}
+
 static gchar *
 writeln (CamelMimeFilter *mime_filter,
          const guchar *in,
@@ -171,12 +217,27 @@ writeln (CamelMimeFilter *mime_filter,
 {
 	CamelMimeFilterToHTMLPrivate *priv;
 	const guchar *inptr = in;
+	gboolean convert_spaces;
 
 	priv = CAMEL_MIME_FILTER_TOHTML_GET_PRIVATE (mime_filter);
+	convert_spaces = (priv->flags & CAMEL_MIME_FILTER_TOHTML_CONVERT_SPACES) != 0;
 
 	while (inptr < inend) {
+		gsize run;
 		guint32 u;
 
+		run = plain_run_length (inptr, inend, convert_spaces);
+		if (run > 0) {
+			outptr = check_size (mime_filter, outptr, outend, run);
+			memcpy (outptr, inptr, run);
+			outptr += run;
+			inptr += run;
+			priv->column += run;
+
+			if (inptr >= inend)
+				break;
+		}
+
 		outptr = check_size (mime_filter, outptr, outend, 16);
 
 		u = camel_utf8_getc_limit (&inptr, inend);
@@ -244,6 +305,23 @@ writeln (CamelMimeFilter *mime_filter,
 	return outptr;
 }
 
+/* returns where the first URL pattern in @start can be, or @inend */
+static const gchar *
+find_url_trigger (CamelMimeFilterToHTMLPrivate *priv,
+                  const gchar *start,
+                  const gchar *inend)
+{
+	const gchar *trigger;
+
+	trigger = camel_trie_search (priv->trie, start, inend - start, NULL);
+	if (!trigger) {
+		/* the search stops at a NUL byte, while the lines after it can still match */
+		trigger = memchr (start, '\0', inend - start);
+	}
+
+	return trigger ? trigger : inend;
+}
+
 static void
 html_convert (CamelMimeFilter *mime_filter,
               const gchar *in,
@@ -259,6 +337,7 @@ html_convert (CamelMimeFilter *mime_filter,
 	gchar *outptr, *outend;
 	const gchar *start;
 	const gchar *inend;
+	const gchar *url_trigger = NULL;
 	gint depth;
 
 	priv = CAMEL_MIME_FILTER_TOHTML_GET_PRIVATE (mime_filter);
@@ -309,8 +388,9 @@ html_convert (CamelMimeFilter *mime_filter,
 
 	start = inptr;
 	do {
-		while (inptr < inend && *inptr != '\n')
-			inptr++;
+		inptr = memchr (inptr, '\n', inend - inptr);
+		if (!inptr)
+			inptr = inend;
 
 		if (inptr >= inend && !flush)
 			break;
@@ -363,7 +443,13 @@ html_convert (CamelMimeFilter *mime_filter,
 		}
 
 #define CONVERT_URLS (CAMEL_MIME_FILTER_TOHTML_CONVERT_URLS | CAMEL_MIME_FILTER_TOHTML_CONVERT_ADDRESSES)
-		if (priv->flags & CONVERT_URLS) {
+		/* one search over the rest of the buffer skips all the lines before
+		 * the first pattern; the search starts over at each new line, thus
+		 * it finds a pattern in a line exactly when the scanner would */
+		if ((priv->flags & CONVERT_URLS) != 0 && (!url_trigger || url_trigger < start))
+			url_trigger = find_url_trigger (priv, start, inend);
+
+		if ((priv->flags & CONVERT_URLS) != 0 && url_trigger < inptr) {
 			gsize matchlen, len;
 			CamelUrlMatch match;
 
@@ -493,6 +579,7 @@ mime_filter_tohtml_finalize (GObject *object)
 	priv = CAMEL_MIME_FILTER_TOHTML_GET_PRIVATE (object);
 
 	camel_url_scanner_free (priv->scanner);
+	camel_trie_free (priv->trie);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_mime_filter_tohtml_parent_class)->finalize (object);
@@ -559,6 +646,7 @@ camel_mime_filter_tohtml_init (CamelMimeFilterToHTML *filter)
 {
 	filter->priv = CAMEL_MIME_FILTER_TOHTML_GET_PRIVATE (filter);
 	filter->priv->scanner = camel_url_scanner_new ();
+	filter->priv->trie = camel_trie_new (TRUE);
 }
 
 /**
@@ -586,9 +674,11 @@ camel_mime_filter_tohtml_new (CamelMimeFilterToHTMLFlags flags,
 	priv->color = color;
 
 	for (i = 0; i < G_N_ELEMENTS (patterns); i++) {
-		if (patterns[i].mask & flags)
+		if (patterns[i].mask & flags) {
 			camel_url_scanner_add (
 				priv->scanner, &patterns[i].pattern);
+			camel_trie_add (priv->trie, patterns[i].pattern.pattern, i);
+		}
 	}
 
 	return filter;
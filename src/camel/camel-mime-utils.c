@@ -976,6 +976,10 @@ decode_8bit (const gchar *text,
 	if (locale_charset && g_ascii_strcasecmp (locale_charset, "UTF-8") != 0)
 		charsets[i++] = locale_charset;
 
+	/* the first try, which does not need iconv for a valid UTF-8 */
+	if ((out = camel_iconv_fast_strndup ("UTF-8", charsets[0], text, len)) != NULL)
+		return out;
+
 	min = len;
 	best = charsets[0];
 
@@ -1235,6 +1239,9 @@ rfc2047_decode_word (const gchar *in,
 	if (charset[0])
 		charset = camel_iconv_charset_name (charset);
 
+	if (charset[0] && (buf = camel_iconv_fast_strndup ("UTF-8", charset, (gchar *) decoded, declen)) != NULL)
+		return buf;
+
 	if (!charset[0] || (cd = camel_iconv_open ("UTF-8", charset)) == (GIConv) -1) {
 		w (g_warning (
 			"Cannot convert from %s to UTF-8, "
@@ -1292,6 +1299,14 @@ append_8bit (GString *out,
 	gsize outlen;
 	GIConv ic;
 
+	outbase = camel_iconv_fast_strndup ("UTF-8", charset, inbuf, inlen);
+	if (outbase) {
+		g_string_append (out, outbase);
+		g_free (outbase);
+
+		return TRUE;
+	}
+
 	ic = camel_iconv_open ("UTF-8", charset);
 	if (ic == (GIConv) -1)
 		return FALSE;
@@ -2277,6 +2292,10 @@ header_convert (const gchar *to,
 	gsize outlen, ret;
 	gchar *outbuf, *outbase, *result = NULL;
 
+	result = camel_iconv_fast_strndup (to, from, in, inlen);
+	if (result)
+		return result;
+
 	ic = camel_iconv_open (to, from);
 	if (ic == (GIConv) -1)
 		return NULL;
@@ -418,8 +418,9 @@ offline_folder_downsync_sync (CamelOfflineFolder *offline,
                               GError **error)
 {
 	CamelFolder *folder = (CamelFolder *) offline;
-	GPtrArray *uids, *uncached_uids = NULL;
+	GPtrArray *uids, *uncached_uids = NULL, *download_uids;
 	gint64 limit_time;
+	gboolean success = TRUE;
 	gint i;
 
 	/* Translators: The first “%s” is replaced with an account name and the second “%s”
@@ -451,6 +452,8 @@ offline_folder_downsync_sync (CamelOfflineFolder *offline,
 	if (limit_time > 0 && camel_folder_get_folder_summary (folder))
 		camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
 
+	download_uids = g_ptr_array_sized_new (uncached_uids->len);
+
 	for (i = 0; i < uncached_uids->len && !g_cancellable_is_cancelled (cancellable); i++) {
 		const gchar *uid = uncached_uids->pdata[i];
 		gboolean download = limit_time <= 0;
@@ -467,36 +470,36 @@ offline_folder_downsync_sync (CamelOfflineFolder *offline,
 			g_clear_object (&mi);
 		}
 
-		if (download) {
-			/* Translators: The first “%d” is the sequence number of the message, the second “%d”
-			   is the total number of messages to synchronize.
-			   The first “%s” is replaced with an account name and the second “%s”
-			   is replaced with a full path name. The spaces around “:” are intentional, as
-			   the whole “%s : %s” is meant as an absolute identification of the folder. */
-			camel_operation_push_message (cancellable, _("Syncing message %d of %d in folder “%s : %s” to disk"),
-				i + 1, uncached_uids->len,
-				camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))),
-				camel_folder_get_full_name (folder));
-
-			/* Stop on failure */
-			if (!camel_folder_synchronize_message_sync (folder, uid, cancellable, NULL)) {
-				camel_operation_pop_message (cancellable);
-				break;
-			}
+		if (download)
+			g_ptr_array_add (download_uids, (gpointer) uid);
+	}
 
-			camel_operation_pop_message (cancellable);
-		}
+	/* Let the folder download them in one go, if it can */
+	if (download_uids->len && !g_cancellable_is_cancelled (cancellable)) {
+		/* Translators: The “%d” is the total number of messages to synchronize.
+		   The first “%s” is replaced with an account name and the second “%s”
+		   is replaced with a full path name. The spaces around “:” are intentional, as
+		   the whole “%s : %s” is meant as an absolute identification of the folder. */
+		camel_operation_push_message (cancellable, dngettext (GETTEXT_PACKAGE, "Syncing %d message in folder “%s : %s” to disk",
+			"Syncing %d messages in folder “%s : %s” to disk", download_uids->len),
+			download_uids->len,
+			camel_service_get_display_name (CAMEL_SERVICE (camel_folder_get_parent_store (folder))),
+			camel_folder_get_full_name (folder));
 
-		camel_operation_progress (cancellable, i * 100 / uncached_uids->len);
+		success = camel_folder_synchronize_messages_sync (folder, download_uids, cancellable, error);
+
+		camel_operation_pop_message (cancellable);
 	}
 
+	g_ptr_array_free (download_uids, TRUE);
+
  done:
 	if (uncached_uids)
 		camel_folder_free_uids (folder, uncached_uids);
 
 	camel_operation_pop_message (cancellable);
 
-	return TRUE;
+	return success;
 }
 
 static void
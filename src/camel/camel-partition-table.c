@@ -55,8 +55,17 @@ struct _CamelPartitionTablePrivate {
 
 	/* we keep a list of partition blocks active at all times */
 	GQueue partition;
+
+	/* PartitionMapEntry, sorted by hashid, one per non-empty
+	 * map block; looks up the map block by binary search */
+	GArray *map_index;
 };
 
+typedef struct _PartitionMapEntry {
+	camel_hash_t hashid; /* the highest hashid of the map block */
+	GList *link; /* in the 'partition' queue */
+} PartitionMapEntry;
+
 G_DEFINE_TYPE (CamelPartitionTable, camel_partition_table, G_TYPE_OBJECT)
 
 static void
@@ -75,6 +84,7 @@ partition_table_finalize (GObject *object)
 		g_object_unref (table->priv->blocks);
 	}
 
+	g_array_free (table->priv->map_index, TRUE);
 	g_mutex_clear (&table->priv->lock);
 
 	/* Chain up to parent's finalize() method. */
@@ -98,6 +108,7 @@ camel_partition_table_init (CamelPartitionTable *cpi)
 	cpi->priv = CAMEL_PARTITION_TABLE_GET_PRIVATE (cpi);
 
 	g_queue_init (&cpi->priv->partition);
+	cpi->priv->map_index = g_array_new (FALSE, FALSE, sizeof (PartitionMapEntry));
 	g_mutex_init (&cpi->priv->lock);
 }
 
@@ -132,6 +143,79 @@ static camel_hash_t hash_key (const gchar *key)
 	return hash;
 }
 
+/* Call with lock held */
+static void
+partition_table_rebuild_map_index (CamelPartitionTable *cpi)
+{
+	GList *link;
+
+	g_array_set_size (cpi->priv->map_index, 0);
+
+	for (link = g_queue_peek_head_link (&cpi->priv->partition); link != NULL; link = g_list_next (link)) {
+		CamelBlock *bl = link->data;
+		CamelPartitionMapBlock *ptb = (CamelPartitionMapBlock *) &bl->data;
+		PartitionMapEntry entry;
+
+		/* empty blocks cannot contain anything */
+		if (ptb->used == 0)
+			continue;
+
+		entry.hashid = ptb->partition[ptb->used - 1].hashid;
+		entry.link = link;
+
+		g_array_append_val (cpi->priv->map_index, entry);
+	}
+}
+
+/* Call with lock held; returns position of the map block in the map_index */
+static guint
+partition_table_find_map_entry (CamelPartitionTable *cpi,
+                                camel_hash_t id)
+{
+	PartitionMapEntry *entries = (PartitionMapEntry *) cpi->priv->map_index->data;
+	guint low = 0, high = cpi->priv->map_index->len;
+
+	/* the first block whose highest hashid is not below id */
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (entries[mid].hashid < id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/* Call with lock held; the map block at @link was split, its upper half moved to @new_link */
+static void
+partition_table_map_index_split (CamelPartitionTable *cpi,
+                                 GList *link,
+                                 GList *new_link)
+{
+	CamelPartitionMapBlock *ptb = (CamelPartitionMapBlock *) &((CamelBlock *) link->data)->data;
+	CamelPartitionMapBlock *ptn = (CamelPartitionMapBlock *) &((CamelBlock *) new_link->data)->data;
+	PartitionMapEntry entry;
+	guint pos;
+
+	/* the upper half keeps the highest hashid of the original block */
+	pos = partition_table_find_map_entry (cpi, ptn->partition[ptn->used - 1].hashid);
+	while (pos < cpi->priv->map_index->len && g_array_index (cpi->priv->map_index, PartitionMapEntry, pos).link != link)
+		pos++;
+
+	if (pos >= cpi->priv->map_index->len) {
+		partition_table_rebuild_map_index (cpi);
+		return;
+	}
+
+	g_array_index (cpi->priv->map_index, PartitionMapEntry, pos).hashid = ptb->partition[ptb->used - 1].hashid;
+
+	entry.hashid = ptn->partition[ptn->used - 1].hashid;
+	entry.link = new_link;
+	g_array_insert_val (cpi->priv->map_index, pos + 1, entry);
+}
+
 /* Call with lock held */
 static GList *
 find_partition (CamelPartitionTable *cpi,
@@ -141,41 +225,42 @@ find_partition (CamelPartitionTable *cpi,
 	gint index, jump;
 	CamelPartitionMapBlock *ptb;
 	CamelPartitionMap *part;
-	GList *head, *link;
+	CamelBlock *bl;
+	GList *link;
+	guint pos;
 
 	/* first, find the block this key might be in, then binary search the block */
-	head = g_queue_peek_head_link (&cpi->priv->partition);
+	pos = partition_table_find_map_entry (cpi, id);
 
-	for (link = head; link != NULL; link = g_list_next (link)) {
-		CamelBlock *bl = link->data;
+	if (pos < cpi->priv->map_index->len) {
+		link = g_array_index (cpi->priv->map_index, PartitionMapEntry, pos).link;
+		bl = link->data;
 
 		ptb = (CamelPartitionMapBlock *) &bl->data;
 		part = ptb->partition;
-		if (ptb->used > 0 && id <= part[ptb->used - 1].hashid) {
-			index = ptb->used / 2;
-			jump = ptb->used / 4;
+		index = ptb->used / 2;
+		jump = ptb->used / 4;
 
-			if (jump == 0)
-				jump = 1;
+		if (jump == 0)
+			jump = 1;
 
-			while (1) {
-				if (id <= part[index].hashid) {
-					if (index == 0 || id > part[index - 1].hashid)
-						break;
-					index -= jump;
-				} else {
-					if (index >= ptb->used - 1)
-						break;
-					index += jump;
-				}
-				jump = jump / 2;
-				if (jump == 0)
-					jump = 1;
+		while (1) {
+			if (id <= part[index].hashid) {
+				if (index == 0 || id > part[index - 1].hashid)
+					break;
+				index -= jump;
+			} else {
+				if (index >= ptb->used - 1)
+					break;
+				index += jump;
 			}
-			*indexp = index;
-
-			return link;
+			jump = jump / 2;
+			if (jump == 0)
+				jump = 1;
 		}
+		*indexp = index;
+
+		return link;
 	}
 
 	g_warning ("could not find a partition that could fit!  partition table corrupt!");
@@ -235,6 +320,8 @@ camel_partition_table_new (CamelBlockFile *bs,
 		g_queue_push_tail (&cpi->priv->partition, block);
 	} while (root);
 
+	partition_table_rebuild_map_index (cpi);
+
 	return cpi;
 
 fail:
@@ -398,12 +485,13 @@ keys_cmp (gconstpointer ap,
 	return 0;
 }
 
-gint
-camel_partition_table_add (CamelPartitionTable *cpi,
-                           const gchar *key,
-                           camel_key_t keyid)
+/* Call with lock held */
+static gint
+partition_table_add_locked (CamelPartitionTable *cpi,
+                            camel_hash_t hashid,
+                            camel_key_t keyid)
 {
-	camel_hash_t hashid, partid;
+	camel_hash_t partid;
 	gint index, newindex = 0; /* initialisation of this and pkb/nkb is just to silence compiler */
 	CamelPartitionMapBlock *ptb, *ptn;
 	CamelPartitionKeyBlock *kb, *newkb, *nkb = NULL, *pkb = NULL;
@@ -413,26 +501,16 @@ camel_partition_table_add (CamelPartitionTable *cpi,
 	GList *ptblock_link;
 	gint ret = -1;
 
-	g_return_val_if_fail (CAMEL_IS_PARTITION_TABLE (cpi), -1);
-	g_return_val_if_fail (key != NULL, -1);
-
-	hashid = hash_key (key);
-
-	CAMEL_PARTITION_TABLE_LOCK (cpi, lock);
 	ptblock_link = find_partition (cpi, hashid, &index);
-	if (ptblock_link == NULL) {
-		CAMEL_PARTITION_TABLE_UNLOCK (cpi, lock);
+	if (ptblock_link == NULL)
 		return -1;
-	}
 
 	ptblock = (CamelBlock *) ptblock_link->data;
 	ptb = (CamelPartitionMapBlock *) &ptblock->data;
 	block = camel_block_file_get_block (
 		cpi->priv->blocks, ptb->partition[index].blockid);
-	if (block == NULL) {
-		CAMEL_PARTITION_TABLE_UNLOCK (cpi, lock);
+	if (block == NULL)
 		return -1;
-	}
 	kb = (CamelPartitionKeyBlock *) &block->data;
 
 	/* TODO: Keep the key array in sorted order, cheaper lookups and split operation */
@@ -515,6 +593,8 @@ camel_partition_table_add (CamelPartitionTable *cpi,
 				g_queue_insert_after (
 					&cpi->priv->partition,
 					ptblock_link, ptnblock);
+				partition_table_map_index_split (
+					cpi, ptblock_link, g_list_next (ptblock_link));
 
 				/* write in right order to ensure structure */
 				camel_block_file_touch_block (cpi->priv->blocks, ptnblock);
@@ -612,8 +692,120 @@ camel_partition_table_add (CamelPartitionTable *cpi,
 
 	ret = 0;
 fail:
+	return ret;
+}
+
+gint
+camel_partition_table_add (CamelPartitionTable *cpi,
+                           const gchar *key,
+                           camel_key_t keyid)
+{
+	camel_hash_t hashid;
+	gint ret;
+
+	g_return_val_if_fail (CAMEL_IS_PARTITION_TABLE (cpi), -1);
+	g_return_val_if_fail (key != NULL, -1);
+
+	hashid = hash_key (key);
+
+	CAMEL_PARTITION_TABLE_LOCK (cpi, lock);
+	ret = partition_table_add_locked (cpi, hashid, keyid);
+	CAMEL_PARTITION_TABLE_UNLOCK (cpi, lock);
+
+	return ret;
+}
+
+/**
+ * camel_partition_table_add_many:
+ * @cpi: a #CamelPartitionTable
+ * @keys: (array length=n_keys): keys to add
+ * @keyids: (array length=n_keys): key ids, one for each of the @keys
+ * @n_keys: how many keys to add
+ *
+ * Adds several keys at once, like calling camel_partition_table_add()
+ * for each of them. The keys are sorted by their hash first, thus
+ * all keys falling into the same partition block are stored with
+ * a single block lookup.
+ *
+ * Returns: 0 on success, -1 on error, when only some of the keys
+ *    could be added
+ *
+ * Since: 3.28
+ **/
+gint
+camel_partition_table_add_many (CamelPartitionTable *cpi,
+                                const gchar * const *keys,
+                                const camel_key_t *keyids,
+                                guint n_keys)
+{
+	CamelPartitionKey *sorted;
+	CamelPartitionMapBlock *ptb;
+	CamelPartitionKeyBlock *kb;
+	CamelBlock *block;
+	GList *ptblock_link;
+	camel_hash_t limit;
+	guint ii, used;
+	gint index, ret = 0;
+
+	g_return_val_if_fail (CAMEL_IS_PARTITION_TABLE (cpi), -1);
+	g_return_val_if_fail (keys != NULL || n_keys == 0, -1);
+	g_return_val_if_fail (keyids != NULL || n_keys == 0, -1);
+
+	if (n_keys == 0)
+		return 0;
+
+	sorted = g_new (CamelPartitionKey, n_keys);
+	for (ii = 0; ii < n_keys; ii++) {
+		sorted[ii].hashid = hash_key (keys[ii]);
+		sorted[ii].keyid = keyids[ii];
+	}
+
+	qsort (sorted, n_keys, sizeof (sorted[0]), keys_cmp);
+
+	CAMEL_PARTITION_TABLE_LOCK (cpi, lock);
+
+	ii = 0;
+	while (ii < n_keys && ret == 0) {
+		ptblock_link = find_partition (cpi, sorted[ii].hashid, &index);
+		if (ptblock_link == NULL) {
+			ret = -1;
+			break;
+		}
+
+		ptb = (CamelPartitionMapBlock *) &((CamelBlock *) ptblock_link->data)->data;
+		limit = ptb->partition[index].hashid;
+
+		block = camel_block_file_get_block (
+			cpi->priv->blocks, ptb->partition[index].blockid);
+		if (block == NULL) {
+			ret = -1;
+			break;
+		}
+		kb = (CamelPartitionKeyBlock *) &block->data;
+
+		/* the following keys belong to the same block, while it has room */
+		used = kb->used;
+		while (ii < n_keys && sorted[ii].hashid <= limit && kb->used < G_N_ELEMENTS (kb->keys)) {
+			kb->keys[kb->used] = sorted[ii];
+			kb->used++;
+			ii++;
+		}
+
+		if (kb->used != used)
+			camel_block_file_touch_block (cpi->priv->blocks, block);
+		camel_block_file_unref_block (cpi->priv->blocks, block);
+
+		/* the block is full, split it */
+		if (ii < n_keys && sorted[ii].hashid <= limit) {
+			ret = partition_table_add_locked (cpi, sorted[ii].hashid, sorted[ii].keyid);
+			ii++;
+		}
+	}
+
 	CAMEL_PARTITION_TABLE_UNLOCK (cpi, lock);
 
+	g_free (sorted);
+
 	return ret;
 }
 
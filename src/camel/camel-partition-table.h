@@ -120,6 +120,10 @@ gint		camel_partition_table_sync	(CamelPartitionTable *cpi);
 gint		camel_partition_table_add	(CamelPartitionTable *cpi,
 						 const gchar *key,
 						 camel_key_t keyid);
+gint		camel_partition_table_add_many	(CamelPartitionTable *cpi,
+						 const gchar * const *keys,
+						 const camel_key_t *keyids,
+						 guint n_keys);
 camel_key_t	camel_partition_table_lookup	(CamelPartitionTable *cpi,
 						 const gchar *key);
 gboolean	camel_partition_table_remove	(CamelPartitionTable *cpi,
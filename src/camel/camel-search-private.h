@@ -101,6 +101,32 @@ struct _camel_search_words *
 void		camel_search_words_free		(struct _camel_search_words *words);
 
 gboolean	camel_search_header_is_address	(const gchar *header_name);
+
+/* Filter search expressions parsed once, for CamelFilterDriver */
+typedef struct _CamelFilterSearchCompiled CamelFilterSearchCompiled;
+
+CamelFilterSearchCompiled *
+		camel_filter_search_compile	(const gchar *expression,
+						 GError **error);
+void		camel_filter_search_compiled_free
+						(CamelFilterSearchCompiled *compiled);
+gboolean	camel_filter_search_compiled_get_header_test
+						(CamelFilterSearchCompiled *compiled,
+						 const gchar **out_header_name,
+						 camel_search_match_t *out_how,
+						 GPtrArray **out_values);
+gint		camel_filter_search_compiled_match
+						(CamelFilterSearchCompiled *compiled,
+						 CamelSession *session,
+						 CamelFilterSearchGetMessageFunc get_message,
+						 gpointer user_data,
+						 CamelMessageInfo *info,
+						 const gchar *source,
+						 CamelFolder *folder,
+						 FILE *logfile,
+						 GCancellable *cancellable,
+						 GError **error);
+
 const gchar *	camel_search_get_default_charset_from_message
 						(CamelMimeMessage *message);
 const gchar *	camel_search_get_default_charset_from_headers
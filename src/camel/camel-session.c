@@ -65,6 +65,8 @@ struct _CamelSessionPrivate {
 
 	GHashTable *junk_headers;
 	CamelJunkFilter *junk_filter;
+	guint junk_learn_prefetch_depth;
+	guint64 junk_learn_prefetch_memory;
 
 	GMainContext *main_context;
 
@@ -102,6 +104,8 @@ struct _JobData {
 enum {
 	PROP_0,
 	PROP_JUNK_FILTER,
+	PROP_JUNK_LEARN_PREFETCH_DEPTH,
+	PROP_JUNK_LEARN_PREFETCH_MEMORY,
 	PROP_MAIN_CONTEXT,
 	PROP_NETWORK_MONITOR,
 	PROP_ONLINE,
@@ -286,6 +290,18 @@ session_set_property (GObject *object,
 				g_value_get_object (value));
 			return;
 
+		case PROP_JUNK_LEARN_PREFETCH_DEPTH:
+			camel_session_set_junk_learn_prefetch_depth (
+				CAMEL_SESSION (object),
+				g_value_get_uint (value));
+			return;
+
+		case PROP_JUNK_LEARN_PREFETCH_MEMORY:
+			camel_session_set_junk_learn_prefetch_memory (
+				CAMEL_SESSION (object),
+				g_value_get_uint64 (value));
+			return;
+
 		case PROP_NETWORK_MONITOR:
 			camel_session_set_network_monitor (
 				CAMEL_SESSION (object),
@@ -327,6 +343,18 @@ session_get_property (GObject *object,
 				CAMEL_SESSION (object)));
 			return;
 
+		case PROP_JUNK_LEARN_PREFETCH_DEPTH:
+			g_value_set_uint (
+				value, camel_session_get_junk_learn_prefetch_depth (
+				CAMEL_SESSION (object)));
+			return;
+
+		case PROP_JUNK_LEARN_PREFETCH_MEMORY:
+			g_value_set_uint64 (
+				value, camel_session_get_junk_learn_prefetch_memory (
+				CAMEL_SESSION (object)));
+			return;
+
 		case PROP_MAIN_CONTEXT:
 			g_value_take_boxed (
 				value, camel_session_ref_main_context (
@@ -628,6 +656,30 @@ camel_session_class_init (CamelSessionClass *class)
 			G_PARAM_READWRITE |
 			G_PARAM_STATIC_STRINGS));
 
+	g_object_class_install_property (
+		object_class,
+		PROP_JUNK_LEARN_PREFETCH_DEPTH,
+		g_param_spec_uint (
+			"junk-learn-prefetch-depth",
+			"Junk Learn Prefetch Depth",
+			"How many messages to download ahead of the junk filter when learning",
+			1, G_MAXUINT, 200,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_JUNK_LEARN_PREFETCH_MEMORY,
+		g_param_spec_uint64 (
+			"junk-learn-prefetch-memory",
+			"Junk Learn Prefetch Memory",
+			"How many bytes of messages to download ahead of the junk filter when learning",
+			1, G_MAXUINT64, 32 * 1024 * 1024,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
+
 	g_object_class_install_property (
 		object_class,
 		PROP_MAIN_CONTEXT,
@@ -1452,6 +1504,99 @@ camel_session_set_junk_filter (CamelSession *session,
 	g_object_notify (G_OBJECT (session), "junk-filter");
 }
 
+/**
+ * camel_session_get_junk_learn_prefetch_depth:
+ * @session: a #CamelSession
+ *
+ * Returns how many messages are downloaded ahead of the #CamelJunkFilter,
+ * when it learns messages marked as junk or not junk.
+ *
+ * Returns: the maximum count of messages downloaded ahead
+ *
+ * Since: 3.28
+ **/
+guint
+camel_session_get_junk_learn_prefetch_depth (CamelSession *session)
+{
+	g_return_val_if_fail (CAMEL_IS_SESSION (session), 0);
+
+	return session->priv->junk_learn_prefetch_depth;
+}
+
+/**
+ * camel_session_set_junk_learn_prefetch_depth:
+ * @session: a #CamelSession
+ * @depth: the maximum count of messages to download ahead, at least 1
+ *
+ * Sets how many messages are downloaded ahead of the #CamelJunkFilter,
+ * when it learns messages marked as junk or not junk. Larger values hide
+ * more of the network latency, at the cost of memory. See also
+ * camel_session_set_junk_learn_prefetch_memory().
+ *
+ * Since: 3.28
+ **/
+void
+camel_session_set_junk_learn_prefetch_depth (CamelSession *session,
+                                             guint depth)
+{
+	g_return_if_fail (CAMEL_IS_SESSION (session));
+	g_return_if_fail (depth > 0);
+
+	if (session->priv->junk_learn_prefetch_depth == depth)
+		return;
+
+	session->priv->junk_learn_prefetch_depth = depth;
+
+	g_object_notify (G_OBJECT (session), "junk-learn-prefetch-depth");
+}
+
+/**
+ * camel_session_get_junk_learn_prefetch_memory:
+ * @session: a #CamelSession
+ *
+ * Returns how many bytes of messages can be downloaded ahead of
+ * the #CamelJunkFilter, when it learns messages marked as junk or
+ * not junk.
+ *
+ * Returns: the maximum size of messages downloaded ahead, in bytes
+ *
+ * Since: 3.28
+ **/
+guint64
+camel_session_get_junk_learn_prefetch_memory (CamelSession *session)
+{
+	g_return_val_if_fail (CAMEL_IS_SESSION (session), 0);
+
+	return session->priv->junk_learn_prefetch_memory;
+}
+
+/**
+ * camel_session_set_junk_learn_prefetch_memory:
+ * @session: a #CamelSession
+ * @memory: the maximum size of messages to download ahead, in bytes, at least 1
+ *
+ * Sets how many bytes of messages can be downloaded ahead of
+ * the #CamelJunkFilter, when it learns messages marked as junk or
+ * not junk. The size of the messages is taken from their message info.
+ * At least one message is always downloaded, whatever its size.
+ *
+ * Since: 3.28
+ **/
+void
+camel_session_set_junk_learn_prefetch_memory (CamelSession *session,
+                                              guint64 memory)
+{
+	g_return_if_fail (CAMEL_IS_SESSION (session));
+	g_return_if_fail (memory > 0);
+
+	if (session->priv->junk_learn_prefetch_memory == memory)
+		return;
+
+	session->priv->junk_learn_prefetch_memory = memory;
+
+	g_object_notify (G_OBJECT (session), "junk-learn-prefetch-memory");
+}
+
 /**
  * camel_session_idle_add:
  * @session: a #CamelSession
@@ -214,6 +214,16 @@ CamelJunkFilter *
 		camel_session_get_junk_filter	(CamelSession *session);
 void		camel_session_set_junk_filter	(CamelSession *session,
 						 CamelJunkFilter *junk_filter);
+guint		camel_session_get_junk_learn_prefetch_depth
+						(CamelSession *session);
+void		camel_session_set_junk_learn_prefetch_depth
+						(CamelSession *session,
+						 guint depth);
+guint64		camel_session_get_junk_learn_prefetch_memory
+						(CamelSession *session);
+void		camel_session_set_junk_learn_prefetch_memory
+						(CamelSession *session,
+						 guint64 memory);
 guint		camel_session_idle_add		(CamelSession *session,
 						 gint priority,
 						 GSourceFunc function,
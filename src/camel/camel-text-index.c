@@ -46,6 +46,9 @@
 
 #define CAMEL_TEXT_INDEX_MAX_WORDLEN  (36)
 
+/* New words are added into the word hash in batches of this size */
+#define CAMEL_TEXT_INDEX_PENDING_WORDS (1024)
+
 #define CAMEL_TEXT_INDEX_LOCK(kf, lock) \
 	(g_rec_mutex_lock (&((CamelTextIndex *) kf)->priv->lock))
 #define CAMEL_TEXT_INDEX_UNLOCK(kf, lock) \
@@ -127,6 +130,10 @@ struct _CamelTextIndexPrivate {
 	guint word_cache_limit;
 	GQueue word_cache;
 	GHashTable *words;
+
+	/* New words not added into the word_hash yet */
+	GHashTable *pending_words; /* gchar *word ~> camel_key_t wordid */
+
 	GRecMutex lock;
 };
 
@@ -215,8 +222,10 @@ text_index_finalize (GObject *object)
 
 	g_warn_if_fail (g_queue_is_empty (&priv->word_cache));
 	g_warn_if_fail (g_hash_table_size (priv->words) == 0);
+	g_warn_if_fail (g_hash_table_size (priv->pending_words) == 0);
 
 	g_hash_table_destroy (priv->words);
+	g_hash_table_destroy (priv->pending_words);
 
 	g_rec_mutex_clear (&priv->lock);
 
@@ -224,6 +233,54 @@ text_index_finalize (GObject *object)
 	G_OBJECT_CLASS (camel_text_index_parent_class)->finalize (object);
 }
 
+/* call locked */
+static gint
+text_index_add_pending_words (CamelTextIndexPrivate *p)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	const gchar **keys;
+	camel_key_t *keyids;
+	guint n_keys = 0;
+	gint ret;
+
+	if (!g_hash_table_size (p->pending_words))
+		return 0;
+
+	keys = g_new (const gchar *, g_hash_table_size (p->pending_words));
+	keyids = g_new (camel_key_t, g_hash_table_size (p->pending_words));
+
+	g_hash_table_iter_init (&iter, p->pending_words);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		keys[n_keys] = key;
+		keyids[n_keys] = GPOINTER_TO_UINT (value);
+		n_keys++;
+	}
+
+	ret = camel_partition_table_add_many (p->word_hash, keys, keyids, n_keys);
+	if (ret == -1)
+		g_warning ("Could not create hash entries for %u words: %s\n", n_keys, g_strerror (errno));
+
+	g_hash_table_remove_all (p->pending_words);
+	g_free (keyids);
+	g_free (keys);
+
+	return ret;
+}
+
+/* call locked */
+static camel_key_t
+text_index_lookup_word (CamelTextIndexPrivate *p,
+                        const gchar *word)
+{
+	gpointer wordid;
+
+	if (g_hash_table_lookup_extended (p->pending_words, word, NULL, &wordid))
+		return GPOINTER_TO_UINT (wordid);
+
+	return camel_partition_table_lookup (p->word_hash, word);
+}
+
 /* call locked */
 static void
 text_index_add_name_to_word (CamelIndex *idx,
@@ -242,7 +299,7 @@ text_index_add_name_to_word (CamelIndex *idx,
 		GList *link;
 		guint length;
 
-		wordid = camel_partition_table_lookup (p->word_hash, word);
+		wordid = text_index_lookup_word (p, word);
 		if (wordid == 0) {
 			data = 0;
 			wordid = camel_key_table_add (p->word_index, word, 0, 0);
@@ -252,12 +309,12 @@ text_index_add_name_to_word (CamelIndex *idx,
 					word, g_strerror (errno));
 				return;
 			}
-			if (camel_partition_table_add (p->word_hash, word, wordid) == -1) {
-				g_warning (
-					"Could not create hash entry for word '%s': %s\n",
-					word, g_strerror (errno));
-				return;
-			}
+
+			/* added into the word_hash with the other new words at once */
+			g_hash_table_insert (p->pending_words, g_strdup (word), GUINT_TO_POINTER (wordid));
+			if (g_hash_table_size (p->pending_words) >= CAMEL_TEXT_INDEX_PENDING_WORDS)
+				text_index_add_pending_words (p);
+
 			rb->words++;
 			camel_block_file_touch_block (p->blocks, camel_block_file_get_root_block (p->blocks));
 		} else {
@@ -374,6 +431,9 @@ text_index_sync (CamelIndex *idx)
 		g_free (ww);
 	}
 
+	if (text_index_add_pending_words (p) == -1)
+		ret = -1;
+
 	if (camel_key_table_sync (p->word_index) == -1
 	    || camel_key_table_sync (p->name_index) == -1
 	    || camel_partition_table_sync (p->word_hash) == -1
@@ -447,6 +507,8 @@ text_index_compress_nosync (CamelIndex *idx)
 	gsize count, newcount;
 	camel_key_t *records, newrecords[256];
 	struct _CamelTextIndexRoot *rb;
+	GPtrArray *hash_keys;
+	GArray *hash_keyids;
 
 	i = strlen (idx->path) + 16;
 	oldpath = alloca (i);
@@ -491,6 +553,9 @@ text_index_compress_nosync (CamelIndex *idx)
 	/* Copy undeleted names to new index file, creating new indices */
 	io (printf ("Copying undeleted names to new file\n"));
 	remap = g_hash_table_new (NULL, NULL);
+	/* the hash tables are filled in batches, after the keys are known */
+	hash_keys = g_ptr_array_new_with_free_func (g_free);
+	hash_keyids = g_array_new (FALSE, FALSE, sizeof (camel_key_t));
 	oldkeyid = 0;
 	deleted = 0;
 	while ((oldkeyid = camel_key_table_next (oldp->name_index, oldkeyid, &name, &flags, &data))) {
@@ -501,8 +566,9 @@ text_index_compress_nosync (CamelIndex *idx)
 			if (newkeyid == 0)
 				goto fail;
 			rb->names++;
-			camel_partition_table_add (
-				newp->name_hash, name, newkeyid);
+			g_ptr_array_add (hash_keys, name);
+			g_array_append_val (hash_keyids, newkeyid);
+			name = NULL;
 			g_hash_table_insert (remap, GINT_TO_POINTER (oldkeyid), GINT_TO_POINTER (newkeyid));
 		} else {
 			io (printf ("deleted name '%s'\n", name));
@@ -512,6 +578,13 @@ text_index_compress_nosync (CamelIndex *idx)
 		deleted |= flags;
 	}
 
+	if (camel_partition_table_add_many (newp->name_hash, (const gchar * const *) hash_keys->pdata,
+					    (const camel_key_t *) hash_keyids->data, hash_keys->len) == -1)
+		goto fail;
+
+	g_ptr_array_set_size (hash_keys, 0);
+	g_array_set_size (hash_keyids, 0);
+
 	/* Copy word data across, remapping/deleting and create new index for it */
 	/* We re-block the data into 256 entry lots while we're at it, since we only
 	 * have to do 1 at a time and its cheap */
@@ -555,13 +628,18 @@ text_index_compress_nosync (CamelIndex *idx)
 				newp->word_index, name, newdata, flags);
 			if (newkeyid == 0)
 				goto fail;
-			camel_partition_table_add (
-				newp->word_hash, name, newkeyid);
+			g_ptr_array_add (hash_keys, name);
+			g_array_append_val (hash_keyids, newkeyid);
+			name = NULL;
 		}
 		g_free (name);
 		name = NULL;
 	}
 
+	if (camel_partition_table_add_many (newp->word_hash, (const gchar * const *) hash_keys->pdata,
+					    (const camel_key_t *) hash_keyids->data, hash_keys->len) == -1)
+		goto fail;
+
 	camel_block_file_touch_block (newp->blocks, camel_block_file_get_root_block (newp->blocks));
 
 	if (camel_index_sync (CAMEL_INDEX (newidx)) == -1)
@@ -597,6 +675,8 @@ fail:
 	g_object_unref (newidx);
 	g_free (name);
 	g_hash_table_destroy (remap);
+	g_ptr_array_unref (hash_keys);
+	g_array_unref (hash_keyids);
 
 	/* clean up temp files always */
 	g_snprintf (savepath, i, "%s~.index", oldpath);
@@ -790,7 +870,7 @@ text_index_find (CamelIndex *idx,
 
 	CAMEL_TEXT_INDEX_LOCK (idx, lock);
 
-	keyid = camel_partition_table_lookup (p->word_hash, word);
+	keyid = text_index_lookup_word (p, word);
 	if (keyid != 0) {
 		data = camel_key_table_lookup (
 			p->word_index, keyid, NULL, &flags);
@@ -846,6 +926,7 @@ camel_text_index_init (CamelTextIndex *text_index)
 
 	g_queue_init (&text_index->priv->word_cache);
 	text_index->priv->words = g_hash_table_new (g_str_hash, g_str_equal);
+	text_index->priv->pending_words = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
 	/* This cache size and the block cache size have been tuned for
 	 * about the best with moderate memory usage.  Doubling the memory
@@ -32,11 +32,285 @@
 #include "camel-uid-cache.h"
 #include "camel-win32.h"
 
+/* The cache file starts with a header, an open-addressing table of
+ * (hash, string offset + 1) slots and the NUL-terminated UIDs the slots
+ * point to; all numbers are little-endian 32-bit. The file is read
+ * through a read-only mapping, so opening a cache does not copy every
+ * UID into the heap. Saving appends '+uid\0' and '-uid\0' records for
+ * the UIDs which changed since the last save, and the whole file is
+ * only rewritten once those records grow larger than half of the UIDs
+ * themselves. Files without the magic use the old format, one UID per
+ * line, and are converted on the first save. */
+#define UID_CACHE_MAGIC "CAMELUID"
+#define UID_CACHE_VERSION (1)
+#define UID_CACHE_HEADER_SIZE (32)
+#define UID_CACHE_MIN_SLOTS (16)
+#define UID_CACHE_JOURNAL_MIN (64 * 1024)
+
+/* flags of the UIDs in the loaded table */
+#define UID_CACHE_SAVE (1 << 0)
+#define UID_CACHE_ON_DISK (1 << 1)
+
 struct _uid_state {
 	gint level;
 	gboolean save;
+	gboolean on_disk;
+};
+
+struct _CamelUIDCachePrivate {
+	GBytes *table;
+	const guint32 *slots;
+	const gchar *strings;
+	guint32 n_slots;
+	guint32 strings_size;
+
+	/* state of the UIDs in the loaded table, per slot; the UIDs
+	 * which are not in the table are in CamelUIDCache::uids */
+	guint *levels;
+	guint8 *flags;
+	gboolean table_changed;
+
+	goffset journal_start;
+	goffset journal_end;
+	gboolean needs_rewrite;
 };
 
+static guint32
+uid_cache_hash (const gchar *uid)
+{
+	guint32 hash = 2166136261u;
+
+	/* FNV-1a, it is written to disk, thus cannot change */
+	for (; *uid; uid++) {
+		hash ^= (guchar) *uid;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static const gchar *
+uid_cache_slot_uid (CamelUIDCachePrivate *priv,
+                    guint32 slot)
+{
+	guint32 offset = GUINT32_FROM_LE (priv->slots[2 * slot + 1]);
+
+	if (offset == 0 || offset > priv->strings_size)
+		return NULL;
+
+	return priv->strings + offset - 1;
+}
+
+/* returns the slot of @uid in the loaded table, or -1 */
+static gint
+uid_cache_lookup_slot (CamelUIDCache *cache,
+                       const gchar *uid)
+{
+	CamelUIDCachePrivate *priv = cache->priv;
+	guint32 hash, mask, slot, probes;
+
+	if (!priv->n_slots)
+		return -1;
+
+	hash = uid_cache_hash (uid);
+	mask = priv->n_slots - 1;
+
+	for (slot = hash & mask, probes = 0; probes < priv->n_slots; slot = (slot + 1) & mask, probes++) {
+		const gchar *slot_uid;
+
+		if (priv->slots[2 * slot + 1] == 0)
+			break;
+
+		slot_uid = uid_cache_slot_uid (priv, slot);
+		if (slot_uid && GUINT32_FROM_LE (priv->slots[2 * slot]) == hash && strcmp (slot_uid, uid) == 0)
+			return slot;
+	}
+
+	return -1;
+}
+
+static void
+uid_cache_clear_table (CamelUIDCachePrivate *priv)
+{
+	if (priv->table)
+		g_bytes_unref (priv->table);
+	g_free (priv->levels);
+	g_free (priv->flags);
+
+	priv->table = NULL;
+	priv->slots = NULL;
+	priv->strings = NULL;
+	priv->n_slots = 0;
+	priv->strings_size = 0;
+	priv->levels = NULL;
+	priv->flags = NULL;
+	priv->table_changed = FALSE;
+	priv->journal_start = 0;
+	priv->journal_end = 0;
+}
+
+static void
+uid_cache_replay (CamelUIDCache *cache,
+                  gboolean added,
+                  const gchar *uid)
+{
+	CamelUIDCachePrivate *priv = cache->priv;
+	struct _uid_state *state;
+	gint slot;
+
+	slot = uid_cache_lookup_slot (cache, uid);
+	if (slot != -1) {
+		priv->levels[slot] = added ? cache->level : 0;
+		priv->flags[slot] = added ? UID_CACHE_SAVE | UID_CACHE_ON_DISK : 0;
+	} else if (added) {
+		state = g_hash_table_lookup (cache->uids, uid);
+		if (!state) {
+			state = g_new (struct _uid_state, 1);
+			g_hash_table_insert (cache->uids, g_strdup (uid), state);
+		}
+
+		state->level = cache->level;
+		state->save = TRUE;
+		state->on_disk = TRUE;
+	} else {
+		g_hash_table_remove (cache->uids, uid);
+	}
+}
+
+/* The file is mapped, except on Windows, where a mapped file can be
+ * neither replaced by a rename nor truncated, thus it is read there. */
+static GBytes *
+uid_cache_read_file (const gchar *filename)
+{
+#ifdef G_OS_WIN32
+	gchar *contents = NULL;
+	gsize length = 0;
+
+	if (!g_file_get_contents (filename, &contents, &length, NULL))
+		return NULL;
+
+	return g_bytes_new_take (contents, length);
+#else
+	GMappedFile *mapped;
+	GBytes *bytes;
+
+	mapped = g_mapped_file_new (filename, FALSE, NULL);
+	if (!mapped)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	return bytes;
+#endif
+}
+
+static gboolean
+uid_cache_check_table (GBytes *table)
+{
+	const guint32 *header;
+	const gchar *contents;
+	guint32 version, n_slots, strings_size;
+	gsize length;
+
+	contents = g_bytes_get_data (table, &length);
+
+	if (length < UID_CACHE_HEADER_SIZE || memcmp (contents, UID_CACHE_MAGIC, strlen (UID_CACHE_MAGIC)) != 0)
+		return FALSE;
+
+	header = (const guint32 *) contents;
+	version = GUINT32_FROM_LE (header[2]);
+	n_slots = GUINT32_FROM_LE (header[3]);
+	strings_size = GUINT32_FROM_LE (header[5]);
+
+	if (version != UID_CACHE_VERSION || n_slots == 0 || (n_slots & (n_slots - 1)) != 0 ||
+	    (guint64) n_slots * 8 + strings_size > length - UID_CACHE_HEADER_SIZE)
+		return FALSE;
+
+	/* the last UID is NUL-terminated, thus all of them are */
+	return strings_size == 0 || contents[UID_CACHE_HEADER_SIZE + (gsize) n_slots * 8 + strings_size - 1] == '\0';
+}
+
+/* @table is verified by uid_cache_check_table() */
+static void
+uid_cache_load_table (CamelUIDCache *cache,
+                      GBytes *table)
+{
+	CamelUIDCachePrivate *priv = cache->priv;
+	const guint32 *header;
+	const gchar *contents;
+	guint32 n_slots, strings_size, ii;
+	gsize length;
+	goffset pos;
+
+	contents = g_bytes_get_data (table, &length);
+
+	header = (const guint32 *) contents;
+	n_slots = GUINT32_FROM_LE (header[3]);
+	strings_size = GUINT32_FROM_LE (header[5]);
+
+	priv->table = table;
+	priv->slots = (const guint32 *) (contents + UID_CACHE_HEADER_SIZE);
+	priv->strings = contents + UID_CACHE_HEADER_SIZE + (gsize) n_slots * 8;
+	priv->n_slots = n_slots;
+	priv->strings_size = strings_size;
+	priv->levels = g_new0 (guint, n_slots);
+	priv->flags = g_new0 (guint8, n_slots);
+
+	for (ii = 0; ii < n_slots; ii++) {
+		if (uid_cache_slot_uid (priv, ii)) {
+			priv->levels[ii] = cache->level;
+			priv->flags[ii] = UID_CACHE_SAVE | UID_CACHE_ON_DISK;
+		}
+	}
+
+	priv->journal_start = UID_CACHE_HEADER_SIZE + (gsize) n_slots * 8 + strings_size;
+
+	/* a record cut short by a crash ends the journal; the next
+	 * save overwrites it */
+	for (pos = priv->journal_start; pos < length;) {
+		const gchar *record = contents + pos, *end;
+
+		if (*record != '+' && *record != '-')
+			break;
+
+		end = memchr (record + 1, '\0', length - pos - 1);
+		if (!end || end == record + 1)
+			break;
+
+		uid_cache_replay (cache, *record == '+', record + 1);
+		pos = end - contents + 1;
+	}
+
+	priv->journal_end = pos;
+}
+
+static void
+uid_cache_load_text (CamelUIDCache *cache,
+                     const gchar *contents,
+                     gsize length)
+{
+	const gchar *end = contents + length, *eol;
+
+	for (; contents < end; contents = eol + 1) {
+		struct _uid_state *state;
+
+		eol = memchr (contents, '\n', end - contents);
+		if (!eol)
+			eol = end;
+
+		if (eol == contents)
+			continue;
+
+		state = g_new (struct _uid_state, 1);
+		state->level = cache->level;
+		state->save = TRUE;
+		state->on_disk = FALSE;
+
+		g_hash_table_replace (cache->uids, g_strndup (contents, eol - contents), state);
+	}
+}
+
 /**
  * camel_uid_cache_new: (skip)
  * @filename: path to load the cache from
@@ -51,9 +325,11 @@ CamelUIDCache *
 camel_uid_cache_new (const gchar *filename)
 {
 	CamelUIDCache *cache;
-	struct stat st;
-	gchar *dirname, *buf, **uids;
-	gint fd, i;
+	GBytes *table;
+	const gchar *contents;
+	gchar *dirname;
+	gsize length;
+	gint fd;
 
 	dirname = g_path_get_dirname (filename);
 	if (g_mkdir_with_parents (dirname, 0700) == -1) {
@@ -66,170 +342,306 @@ camel_uid_cache_new (const gchar *filename)
 	if ((fd = g_open (filename, O_RDONLY | O_CREAT | O_BINARY, 0666)) == -1)
 		return NULL;
 
-	if (fstat (fd, &st) == -1) {
-		close (fd);
-		return NULL;
-	}
-
-	buf = g_malloc (st.st_size + 1);
+	close (fd);
 
-	if (st.st_size > 0 && camel_read (fd, buf, st.st_size, NULL, NULL) == -1) {
-		close (fd);
-		g_free (buf);
+	table = uid_cache_read_file (filename);
+	if (!table)
 		return NULL;
-	}
-
-	buf[st.st_size] = '\0';
-
-	close (fd);
 
-	cache = g_new (CamelUIDCache, 1);
-	cache->uids = g_hash_table_new (g_str_hash, g_str_equal);
+	cache = g_new0 (CamelUIDCache, 1);
+	cache->uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	cache->filename = g_strdup (filename);
 	cache->level = 1;
 	cache->expired = 0;
 	cache->size = 0;
 	cache->fd = -1;
+	cache->priv = g_new0 (CamelUIDCachePrivate, 1);
 
-	uids = g_strsplit (buf, "\n", 0);
-	g_free (buf);
-	for (i = 0; uids[i]; i++) {
-		struct _uid_state *state;
+	contents = g_bytes_get_data (table, &length);
 
-		state = g_new (struct _uid_state, 1);
-		state->level = cache->level;
-		state->save = TRUE;
+	if (length >= strlen (UID_CACHE_MAGIC) && memcmp (contents, UID_CACHE_MAGIC, strlen (UID_CACHE_MAGIC)) == 0) {
+		if (!uid_cache_check_table (table)) {
+			g_bytes_unref (table);
+			camel_uid_cache_destroy (cache);
+			return NULL;
+		}
 
-		g_hash_table_insert (cache->uids, uids[i], state);
-	}
+		uid_cache_load_table (cache, table);
+		cache->size = cache->priv->journal_end;
+	} else {
+		uid_cache_load_text (cache, contents, length);
+		g_bytes_unref (table);
 
-	g_free (uids);
+		cache->priv->needs_rewrite = TRUE;
+	}
 
 	return cache;
 }
 
-static void
-maybe_write_uid (gpointer key,
-                 gpointer value,
-                 gpointer data)
+static gboolean
+uid_cache_slot_wanted (CamelUIDCache *cache,
+                       guint32 slot)
+{
+	CamelUIDCachePrivate *priv = cache->priv;
+
+	return priv->levels[slot] == cache->level && (priv->flags[slot] & UID_CACHE_SAVE) != 0;
+}
+
+static gboolean
+uid_cache_state_wanted (CamelUIDCache *cache,
+                        struct _uid_state *state)
+{
+	return state->level == cache->level && state->save;
+}
+
+static gboolean
+uid_cache_write_all (gint fd,
+                     gconstpointer data,
+                     gsize len)
+{
+	return len == 0 || camel_write (fd, data, len, NULL, NULL) != -1;
+}
+
+/* writes the UIDs to be saved as a new table, without any journal */
+static gboolean
+uid_cache_rewrite (CamelUIDCache *cache)
 {
-	CamelUIDCache *cache = data;
-	struct _uid_state *state = value;
-
-	if (cache->fd == -1)
-		return;
-
-	if (state && state->level == cache->level && state->save) {
-		if (camel_write (cache->fd, key, strlen (key), NULL, NULL) == -1 ||
-		    camel_write (cache->fd, "\n", 1, NULL, NULL) == -1) {
-			cache->fd = -1;
-		} else {
-			cache->size += strlen (key) + 1;
+	CamelUIDCachePrivate *priv = cache->priv;
+	struct _uid_state *state;
+	GHashTable *unsaved;
+	GHashTableIter iter;
+	GBytes *table;
+	GPtrArray *wanted;
+	GString *strings;
+	guint32 header[UID_CACHE_HEADER_SIZE / 4] = { 0 };
+	guint32 *slots, n_slots, mask, ii;
+	gpointer key, value;
+	gchar *filename;
+	gboolean success;
+	gint errnosav, fd;
+
+	wanted = g_ptr_array_new ();
+
+	for (ii = 0; ii < priv->n_slots; ii++) {
+		if (uid_cache_slot_uid (priv, ii) && uid_cache_slot_wanted (cache, ii))
+			g_ptr_array_add (wanted, (gpointer) uid_cache_slot_uid (priv, ii));
+	}
+
+	g_hash_table_iter_init (&iter, cache->uids);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (uid_cache_state_wanted (cache, value))
+			g_ptr_array_add (wanted, key);
+	}
+
+	for (n_slots = UID_CACHE_MIN_SLOTS; n_slots < wanted->len * 2; n_slots <<= 1)
+		;
+
+	mask = n_slots - 1;
+	slots = g_new0 (guint32, 2 * n_slots);
+	strings = g_string_new (NULL);
+
+	for (ii = 0; ii < wanted->len; ii++) {
+		const gchar *uid = wanted->pdata[ii];
+		guint32 hash = uid_cache_hash (uid), slot;
+
+		for (slot = hash & mask; slots[2 * slot + 1] != 0; slot = (slot + 1) & mask)
+			;
+
+		slots[2 * slot] = GUINT32_TO_LE (hash);
+		slots[2 * slot + 1] = GUINT32_TO_LE (strings->len + 1);
+		g_string_append_len (strings, uid, strlen (uid) + 1);
+	}
+
+	memcpy (header, UID_CACHE_MAGIC, strlen (UID_CACHE_MAGIC));
+	header[2] = GUINT32_TO_LE (UID_CACHE_VERSION);
+	header[3] = GUINT32_TO_LE (n_slots);
+	header[4] = GUINT32_TO_LE (wanted->len);
+	header[5] = GUINT32_TO_LE (strings->len);
+
+	filename = g_strdup_printf ("%s~", cache->filename);
+	fd = g_open (filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+
+	success = fd != -1 &&
+		uid_cache_write_all (fd, header, sizeof (header)) &&
+		uid_cache_write_all (fd, slots, 2 * sizeof (guint32) * n_slots) &&
+		uid_cache_write_all (fd, strings->str, strings->len) &&
+		fsync (fd) != -1;
+	errnosav = errno;
+
+	if (fd != -1 && close (fd) == -1 && success) {
+		success = FALSE;
+		errnosav = errno;
+	}
+
+	if (success && g_rename (filename, cache->filename) == -1) {
+		success = FALSE;
+		errnosav = errno;
+	}
+
+	if (!success) {
+		g_unlink (filename);
+		g_free (filename);
+		g_ptr_array_free (wanted, TRUE);
+		g_string_free (strings, TRUE);
+		g_free (slots);
+
+		errno = errnosav;
+
+		return FALSE;
+	}
+
+	g_free (filename);
+	g_ptr_array_free (wanted, TRUE);
+	g_string_free (strings, TRUE);
+	g_free (slots);
+
+	table = uid_cache_read_file (cache->filename);
+	if (!table || !uid_cache_check_table (table)) {
+		/* keep the in-memory state, the next save rewrites the file again */
+		if (table)
+			g_bytes_unref (table);
+		priv->needs_rewrite = TRUE;
+		return FALSE;
+	}
+
+	/* the UIDs which are known, but not saved, stay in memory */
+	unsaved = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	for (ii = 0; ii < priv->n_slots; ii++) {
+		if (uid_cache_slot_uid (priv, ii) && priv->levels[ii] != 0 && !uid_cache_slot_wanted (cache, ii)) {
+			state = g_new (struct _uid_state, 1);
+			state->level = priv->levels[ii];
+			state->save = (priv->flags[ii] & UID_CACHE_SAVE) != 0;
+			state->on_disk = FALSE;
+
+			g_hash_table_insert (unsaved, g_strdup (uid_cache_slot_uid (priv, ii)), state);
 		}
-	} else {
-		/* keep track of how much space the expired uids would
-		 * have taken up in the cache */
-		cache->expired += strlen (key) + 1;
 	}
+
+	g_hash_table_iter_init (&iter, cache->uids);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!uid_cache_state_wanted (cache, value)) {
+			g_hash_table_iter_steal (&iter);
+			((struct _uid_state *) value)->on_disk = FALSE;
+			g_hash_table_insert (unsaved, key, value);
+		}
+	}
+
+	g_hash_table_destroy (cache->uids);
+	cache->uids = unsaved;
+
+	uid_cache_clear_table (priv);
+	uid_cache_load_table (cache, table);
+
+	priv->needs_rewrite = FALSE;
+	cache->size = priv->journal_end;
+	cache->expired = 0;
+
+	return TRUE;
+}
+
+static void
+uid_cache_add_record (GString *journal,
+                      gboolean added,
+                      const gchar *uid)
+{
+	g_string_append_c (journal, added ? '+' : '-');
+	g_string_append_len (journal, uid, strlen (uid) + 1);
 }
 
 /**
  * camel_uid_cache_save:
  * @cache: a CamelUIDCache
  *
- * Attempts to save @cache back to disk.
+ * Attempts to save @cache back to disk. Only the UIDs which changed
+ * since the last save are appended to the file, which is rewritten
+ * as a whole once those records take more than half the space of
+ * the UIDs.
  *
  * Returns: success or failure
  **/
 gboolean
 camel_uid_cache_save (CamelUIDCache *cache)
 {
-	gchar *filename;
-	gint errnosav;
-	gint fd;
-
-	filename = g_strdup_printf ("%s~", cache->filename);
-	if ((fd = g_open (filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666)) == -1) {
-		g_free (filename);
-		return FALSE;
+	CamelUIDCachePrivate *priv = cache->priv;
+	GHashTableIter iter;
+	GPtrArray *changed_states;
+	GArray *changed_slots;
+	GString *journal;
+	gpointer key, value;
+	gboolean success = TRUE;
+	guint32 ii;
+	gint errnosav = 0, fd;
+
+	if (priv->needs_rewrite ||
+	    (priv->journal_end - priv->journal_start > UID_CACHE_JOURNAL_MIN &&
+	     priv->journal_end - priv->journal_start > priv->strings_size / 2))
+		return uid_cache_rewrite (cache);
+
+	journal = g_string_new (NULL);
+	changed_slots = g_array_new (FALSE, FALSE, sizeof (guint32));
+	changed_states = g_ptr_array_new ();
+
+	for (ii = 0; priv->table_changed && ii < priv->n_slots; ii++) {
+		gboolean wanted = uid_cache_slot_wanted (cache, ii);
+
+		if (uid_cache_slot_uid (priv, ii) && wanted != ((priv->flags[ii] & UID_CACHE_ON_DISK) != 0)) {
+			uid_cache_add_record (journal, wanted, uid_cache_slot_uid (priv, ii));
+			g_array_append_val (changed_slots, ii);
+		}
 	}
 
-	cache->fd = fd;
-	cache->size = 0;
-	cache->expired = 0;
-	g_hash_table_foreach (cache->uids, maybe_write_uid, cache);
-
-	if (cache->fd == -1 || fsync (fd) == -1)
-		goto exception;
+	g_hash_table_iter_init (&iter, cache->uids);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		struct _uid_state *state = value;
+		gboolean wanted = uid_cache_state_wanted (cache, state);
 
-	close (fd);
-	fd = -1;
-	cache->fd = -1;
+		if (wanted != state->on_disk) {
+			uid_cache_add_record (journal, wanted, key);
+			g_ptr_array_add (changed_states, state);
+		}
+	}
 
-	if (g_rename (filename, cache->filename) == -1)
-		goto exception;
+	if (journal->len > 0) {
+		fd = g_open (cache->filename, O_WRONLY | O_BINARY, 0);
+
+		/* truncating drops any record cut short by a crash */
+		if (fd == -1 ||
+		    lseek (fd, priv->journal_end, SEEK_SET) == (off_t) -1 ||
+		    !uid_cache_write_all (fd, journal->str, journal->len) ||
+		    ftruncate (fd, priv->journal_end + journal->len) == -1 ||
+		    fsync (fd) == -1) {
+			errnosav = errno;
+			success = FALSE;
+		}
 
-	g_free (filename);
+		if (fd != -1)
+			close (fd);
+	}
 
-	return TRUE;
+	if (success) {
+		for (ii = 0; ii < changed_slots->len; ii++)
+			priv->flags[g_array_index (changed_slots, guint32, ii)] ^= UID_CACHE_ON_DISK;
 
- exception:
+		for (ii = 0; ii < changed_states->len; ii++) {
+			struct _uid_state *state = changed_states->pdata[ii];
 
-	errnosav = errno;
-
-#ifdef ENABLE_SPASMOLYTIC
-	if (fd != -1) {
-		/*
-		 * If our new cache size is larger than the old cache,
-		 * even if we haven't finished writing it out
-		 * successfully, we should still attempt to replace
-		 * the old cache with the new cache because it will at
-		 * least avoid re-downloading a few extra messages
-		 * than if we just kept the old cache.
-		 *
-		 * Similarly, even if the new cache size is smaller
-		 * than the old cache size, but we've expired enough
-		 * uids to make up for the difference in size (or
-		 * more), then we should replace the old cache with
-		 * the new cache as well.
-		 */
-
-		if (g_stat (cache->filename, &st) == 0 &&
-		    (cache->size > st.st_size || cache->size + cache->expired > st.st_size)) {
-			if (ftruncate (fd, (off_t) cache->size) != -1) {
-				close (fd);
-				g_rename (filename, cache->filename);
-				g_free (filename);
-				cache->expired = 0;
-				cache->size = 0;
-				cache->fd = -1;
-
-				return TRUE;
-			}
+			state->on_disk = !state->on_disk;
 		}
-	}
-#endif
 
-	if (fd != -1) {
-		close (fd);
-		cache->fd = -1;
+		priv->journal_end += journal->len;
+		priv->table_changed = FALSE;
+		cache->size = priv->journal_end;
 	}
 
-	g_unlink (filename);
-	g_free (filename);
+	g_string_free (journal, TRUE);
+	g_array_free (changed_slots, TRUE);
+	g_ptr_array_free (changed_states, TRUE);
 
-	errno = errnosav;
+	if (!success)
+		errno = errnosav;
 
-	return FALSE;
-}
-
-static void
-free_uid (gpointer key,
-          gpointer value,
-          gpointer data)
-{
-	g_free (key);
-	g_free (value);
+	return success;
 }
 
 /**
@@ -241,8 +653,9 @@ free_uid (gpointer key,
 void
 camel_uid_cache_destroy (CamelUIDCache *cache)
 {
-	g_hash_table_foreach (cache->uids, free_uid, NULL);
+	uid_cache_clear_table (cache->priv);
 	g_hash_table_destroy (cache->uids);
+	g_free (cache->priv);
 	g_free (cache->filename);
 	g_free (cache);
 }
@@ -262,29 +675,44 @@ GPtrArray *
 camel_uid_cache_get_new_uids (CamelUIDCache *cache,
                               GPtrArray *uids)
 {
+	CamelUIDCachePrivate *priv = cache->priv;
 	GPtrArray *new_uids;
-	gpointer old_uid;
 	gchar *uid;
-	gint i;
+	gint i, slot;
 
 	new_uids = g_ptr_array_new ();
 	cache->level++;
 
+	/* the UIDs in the table not listed below expire with the level */
+	priv->table_changed = priv->n_slots > 0;
+
 	for (i = 0; i < uids->len; i++) {
 		struct _uid_state *state;
 
 		uid = uids->pdata[i];
-		if (g_hash_table_lookup_extended (cache->uids, uid, (gpointer *) &old_uid, (gpointer *) &state)) {
-			g_hash_table_remove (cache->uids, uid);
-			g_free (old_uid);
-		} else {
+
+		slot = uid_cache_lookup_slot (cache, uid);
+		if (slot != -1) {
+			if (priv->levels[slot] == 0) {
+				g_ptr_array_add (new_uids, g_strdup (uid));
+				priv->flags[slot] &= ~UID_CACHE_SAVE;
+			}
+
+			priv->levels[slot] = cache->level;
+			continue;
+		}
+
+		state = g_hash_table_lookup (cache->uids, uid);
+		if (!state) {
 			g_ptr_array_add (new_uids, g_strdup (uid));
 			state = g_new (struct _uid_state, 1);
 			state->save = FALSE;
+			state->on_disk = FALSE;
+
+			g_hash_table_insert (cache->uids, g_strdup (uid), state);
 		}
 
 		state->level = cache->level;
-		g_hash_table_insert (cache->uids, g_strdup (uid), state);
 	}
 
 	return new_uids;
@@ -301,18 +729,25 @@ void
 camel_uid_cache_save_uid (CamelUIDCache *cache,
                           const gchar *uid)
 {
+	CamelUIDCachePrivate *priv = cache->priv;
 	struct _uid_state *state;
-	gpointer old_uid;
+	gint slot;
 
 	g_return_if_fail (uid != NULL);
 
-	if (g_hash_table_lookup_extended (cache->uids, uid, (gpointer *) &old_uid, (gpointer *) &state)) {
+	slot = uid_cache_lookup_slot (cache, uid);
+	if (slot != -1) {
+		priv->levels[slot] = cache->level;
+		priv->flags[slot] |= UID_CACHE_SAVE;
+		priv->table_changed = TRUE;
+	} else if ((state = g_hash_table_lookup (cache->uids, uid)) != NULL) {
 		state->save = TRUE;
 		state->level = cache->level;
 	} else {
 		state = g_new (struct _uid_state, 1);
 		state->save = TRUE;
 		state->level = cache->level;
+		state->on_disk = FALSE;
 
 		g_hash_table_insert (cache->uids, g_strdup (uid), state);
 	}
@@ -32,13 +32,17 @@
 
 G_BEGIN_DECLS
 
+typedef struct _CamelUIDCachePrivate CamelUIDCachePrivate;
+
 typedef struct {
 	gchar *filename;
 	GHashTable *uids;
 	guint level;
 	gsize expired;
 	gsize size;
-	gint fd;
+	gint fd; /* unused, always -1 */
+
+	CamelUIDCachePrivate *priv;
 } CamelUIDCache;
 
 CamelUIDCache *camel_uid_cache_new (const gchar *filename);
@@ -20,6 +20,8 @@
 
 #include "evolution-data-server-config.h"
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
@@ -2425,6 +2427,266 @@ camel_imapx_conn_manager_sync_message_sync (CamelIMAPXConnManager *conn_man,
 	return success;
 }
 
+typedef struct _SyncMessagesShared {
+	GMutex lock;
+	GCancellable *cancellable;
+	gsize done_bytes;
+	gsize total_bytes;
+	GError *error;
+} SyncMessagesShared;
+
+struct SyncMessagesJobData {
+	CamelIMAPXConnManager *conn_man;
+	CamelIMAPXMailbox *mailbox;
+	CamelFolderSummary *summary;
+	CamelDataCache *message_cache;
+	GPtrArray *message_uids;
+	SyncMessagesShared *shared;
+};
+
+static void
+sync_messages_job_data_free (gpointer ptr)
+{
+	struct SyncMessagesJobData *job_data = ptr;
+
+	if (job_data) {
+		g_clear_object (&job_data->conn_man);
+		g_clear_object (&job_data->mailbox);
+		g_clear_object (&job_data->summary);
+		g_clear_object (&job_data->message_cache);
+		g_ptr_array_unref (job_data->message_uids);
+		g_free (job_data);
+	}
+}
+
+static void
+imapx_conn_manager_sync_messages_progress_cb (CamelIMAPXServer *server,
+					      gsize n_bytes,
+					      gpointer user_data)
+{
+	SyncMessagesShared *shared = user_data;
+	gint percent;
+
+	g_mutex_lock (&shared->lock);
+
+	shared->done_bytes += n_bytes;
+	percent = shared->total_bytes ? (gint) (shared->done_bytes * 100 / shared->total_bytes) : 100;
+
+	g_mutex_unlock (&shared->lock);
+
+	camel_operation_progress (shared->cancellable, CLAMP (percent, 0, 100));
+}
+
+static gboolean
+imapx_conn_manager_sync_messages_run_sync (CamelIMAPXJob *job,
+					   CamelIMAPXServer *server,
+					   GCancellable *cancellable,
+					   GError **error)
+{
+	struct SyncMessagesJobData *job_data;
+	CamelIMAPXMailbox *mailbox;
+	GError *local_error = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (job != NULL, FALSE);
+	g_return_val_if_fail (CAMEL_IS_IMAPX_SERVER (server), FALSE);
+
+	mailbox = camel_imapx_job_get_mailbox (job);
+	g_return_val_if_fail (CAMEL_IS_IMAPX_MAILBOX (mailbox), FALSE);
+
+	job_data = camel_imapx_job_get_user_data (job);
+	g_return_val_if_fail (job_data != NULL, FALSE);
+
+	success = camel_imapx_server_sync_messages_sync (
+		server, mailbox, job_data->summary, job_data->message_cache, job_data->message_uids,
+		imapx_conn_manager_sync_messages_progress_cb, job_data->shared,
+		cancellable, &local_error);
+
+	camel_imapx_job_set_result (job, success, NULL, local_error, NULL);
+
+	if (local_error)
+		g_propagate_error (error, local_error);
+
+	return success;
+}
+
+static void
+imapx_conn_manager_sync_messages_run_job (struct SyncMessagesJobData *job_data)
+{
+	CamelIMAPXJob *job;
+	GError *local_error = NULL;
+
+	job = camel_imapx_job_new (CAMEL_IMAPX_JOB_SYNC_MESSAGE, job_data->mailbox,
+		imapx_conn_manager_sync_messages_run_sync,
+		imapx_conn_manager_nothing_matches,
+		NULL);
+
+	camel_imapx_job_set_user_data (job, job_data, sync_messages_job_data_free);
+
+	if (!camel_imapx_conn_manager_run_job_sync (job_data->conn_man, job, NULL, job_data->shared->cancellable, &local_error)) {
+		g_mutex_lock (&job_data->shared->lock);
+
+		if (!job_data->shared->error)
+			job_data->shared->error = local_error;
+		else
+			g_clear_error (&local_error);
+
+		g_mutex_unlock (&job_data->shared->lock);
+	}
+
+	camel_imapx_job_unref (job);
+}
+
+static gpointer
+imapx_conn_manager_sync_messages_thread (gpointer user_data)
+{
+	imapx_conn_manager_sync_messages_run_job (user_data);
+
+	return NULL;
+}
+
+static gint
+imapx_conn_manager_uids_cmp (gconstpointer ptr1,
+			     gconstpointer ptr2)
+{
+	guint64 uid1, uid2;
+
+	uid1 = g_ascii_strtoull (*((const gchar * const *) ptr1), NULL, 10);
+	uid2 = g_ascii_strtoull (*((const gchar * const *) ptr2), NULL, 10);
+
+	return uid1 == uid2 ? 0 : uid1 < uid2 ? -1 : 1;
+}
+
+/* Downloads all not-yet-cached messages from @message_uids. The messages are
+   split into contiguous UID ranges of similar total size, one per available
+   connection, and each range is fetched in batches on its own connection. */
+gboolean
+camel_imapx_conn_manager_sync_messages_sync (CamelIMAPXConnManager *conn_man,
+					     CamelIMAPXMailbox *mailbox,
+					     CamelFolderSummary *summary,
+					     CamelDataCache *message_cache,
+					     GPtrArray *message_uids,
+					     GCancellable *cancellable,
+					     GError **error)
+{
+	SyncMessagesShared shared;
+	GPtrArray *uids, *threads;
+	GArray *sizes;
+	gsize range_bytes, bytes;
+	gint n_ranges;
+	guint ii, start;
+
+	g_return_val_if_fail (CAMEL_IS_IMAPX_CONN_MANAGER (conn_man), FALSE);
+	g_return_val_if_fail (CAMEL_IS_IMAPX_MAILBOX (mailbox), FALSE);
+	g_return_val_if_fail (CAMEL_IS_FOLDER_SUMMARY (summary), FALSE);
+	g_return_val_if_fail (CAMEL_IS_DATA_CACHE (message_cache), FALSE);
+	g_return_val_if_fail (message_uids != NULL, FALSE);
+
+	memset (&shared, 0, sizeof (SyncMessagesShared));
+
+	uids = g_ptr_array_new_full (message_uids->len, (GDestroyNotify) camel_pstring_free);
+	sizes = g_array_sized_new (FALSE, FALSE, sizeof (gsize), message_uids->len);
+
+	for (ii = 0; ii < message_uids->len; ii++) {
+		const gchar *uid = message_uids->pdata[ii];
+		CamelMessageInfo *mi;
+		GIOStream *cache_stream;
+
+		cache_stream = camel_data_cache_get (message_cache, "cur", uid, NULL);
+		if (cache_stream) {
+			g_object_unref (cache_stream);
+			continue;
+		}
+
+		mi = camel_folder_summary_get (summary, uid);
+		if (!mi)
+			continue;
+
+		g_ptr_array_add (uids, (gpointer) camel_pstring_strdup (uid));
+		g_clear_object (&mi);
+	}
+
+	if (!uids->len) {
+		g_ptr_array_unref (uids);
+		g_array_unref (sizes);
+		return TRUE;
+	}
+
+	g_ptr_array_sort (uids, imapx_conn_manager_uids_cmp);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		CamelMessageInfo *mi;
+		gsize size = 0;
+
+		mi = camel_folder_summary_get (summary, uids->pdata[ii]);
+		if (mi) {
+			size = camel_message_info_get_size (mi);
+			g_clear_object (&mi);
+		}
+
+		g_array_append_val (sizes, size);
+		shared.total_bytes += size;
+	}
+
+	n_ranges = imapx_conn_manager_get_max_connections (conn_man);
+	if (n_ranges < 1)
+		n_ranges = 1;
+	if (n_ranges > (gint) uids->len)
+		n_ranges = uids->len;
+
+	g_mutex_init (&shared.lock);
+	shared.cancellable = cancellable;
+
+	range_bytes = shared.total_bytes / n_ranges + 1;
+	threads = g_ptr_array_new ();
+
+	for (ii = 0, start = 0, bytes = 0; ii < uids->len; ii++) {
+		bytes += g_array_index (sizes, gsize, ii);
+
+		if (ii + 1 == uids->len || (bytes >= range_bytes && threads->len + 1 < n_ranges)) {
+			struct SyncMessagesJobData *job_data;
+			guint jj;
+
+			job_data = g_new0 (struct SyncMessagesJobData, 1);
+			job_data->conn_man = g_object_ref (conn_man);
+			job_data->mailbox = g_object_ref (mailbox);
+			job_data->summary = g_object_ref (summary);
+			job_data->message_cache = g_object_ref (message_cache);
+			job_data->message_uids = g_ptr_array_new_full (ii - start + 1, (GDestroyNotify) camel_pstring_free);
+			job_data->shared = &shared;
+
+			for (jj = start; jj <= ii; jj++) {
+				g_ptr_array_add (job_data->message_uids, (gpointer) camel_pstring_strdup (uids->pdata[jj]));
+			}
+
+			start = ii + 1;
+			bytes = 0;
+
+			/* The last range is done in this thread */
+			if (ii + 1 == uids->len)
+				imapx_conn_manager_sync_messages_run_job (job_data);
+			else
+				g_ptr_array_add (threads, g_thread_new (NULL, imapx_conn_manager_sync_messages_thread, job_data));
+		}
+	}
+
+	for (ii = 0; ii < threads->len; ii++) {
+		g_thread_join (threads->pdata[ii]);
+	}
+
+	g_ptr_array_unref (threads);
+	g_ptr_array_unref (uids);
+	g_array_unref (sizes);
+	g_mutex_clear (&shared.lock);
+
+	if (shared.error) {
+		g_propagate_error (error, shared.error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 imapx_conn_manager_create_mailbox_run_sync (CamelIMAPXJob *job,
 					    CamelIMAPXServer *server,
@@ -150,6 +150,14 @@ gboolean	camel_imapx_conn_manager_sync_message_sync
 						 const gchar *message_uid,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	camel_imapx_conn_manager_sync_messages_sync
+						(CamelIMAPXConnManager *conn_man,
+						 CamelIMAPXMailbox *mailbox,
+						 CamelFolderSummary *summary,
+						 CamelDataCache *message_cache,
+						 GPtrArray *message_uids,
+						 GCancellable *cancellable,
+						 GError **error);
 gboolean	camel_imapx_conn_manager_create_mailbox_sync
 						(CamelIMAPXConnManager *conn_man,
 						 const gchar *mailbox_name,
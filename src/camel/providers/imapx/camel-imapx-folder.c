@@ -880,6 +880,40 @@ exit:
 	return success;
 }
 
+static gboolean
+imapx_synchronize_messages_sync (CamelFolder *folder,
+				 GPtrArray *message_uids,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	CamelStore *store;
+	CamelIMAPXStore *imapx_store;
+	CamelIMAPXConnManager *conn_man;
+	CamelIMAPXMailbox *mailbox = NULL;
+	gboolean success = FALSE;
+
+	store = camel_folder_get_parent_store (folder);
+
+	imapx_store = CAMEL_IMAPX_STORE (store);
+	conn_man = camel_imapx_store_get_conn_manager (imapx_store);
+
+	mailbox = camel_imapx_folder_list_mailbox (
+		CAMEL_IMAPX_FOLDER (folder), cancellable, error);
+
+	if (mailbox == NULL)
+		goto exit;
+
+	success = camel_imapx_conn_manager_sync_messages_sync (
+		conn_man, mailbox, camel_folder_get_folder_summary (folder),
+		CAMEL_IMAPX_FOLDER (folder)->cache, message_uids,
+		cancellable, error);
+
+exit:
+	g_clear_object (&mailbox);
+
+	return success;
+}
+
 static gboolean
 imapx_transfer_messages_to_sync (CamelFolder *source,
                                  GPtrArray *uids,
@@ -1026,6 +1060,7 @@ camel_imapx_folder_class_init (CamelIMAPXFolderClass *class)
 	folder_class->refresh_info_sync = imapx_refresh_info_sync;
 	folder_class->synchronize_sync = imapx_synchronize_sync;
 	folder_class->synchronize_message_sync = imapx_synchronize_message_sync;
+	folder_class->synchronize_messages_sync = imapx_synchronize_messages_sync;
 	folder_class->transfer_messages_to_sync = imapx_transfer_messages_to_sync;
 	folder_class->changed = imapx_folder_changed;
 
@@ -60,6 +60,10 @@
 /* Try pipelining fetch requests, 'in bits' */
 #define MULTI_SIZE (32768 * 8)
 
+/* How many bytes of messages to request with one UID FETCH when
+   downloading more messages at once */
+#define SYNC_MESSAGES_BATCH_SIZE (MULTI_SIZE * 4)
+
 #define MAX_COMMAND_LEN 1000
 
 /* Ping the server after a period of inactivity to avoid being logged off.
@@ -70,6 +74,12 @@
    to be queued, before actually sending IDLE */
 #define IMAPX_IDLE_WAIT_SECONDS 2
 
+/* Flag changes received during IDLE are saved into the summary once there
+   was no other change for this long, but not later than the second value
+   after the first unsaved change */
+#define IMAPX_IDLE_SAVE_DELAY_MSECS 500
+#define IMAPX_IDLE_SAVE_MAX_DELAY_MSECS 5000
+
 #ifdef G_OS_WIN32
 #ifdef gmtime_r
 #undef gmtime_r
@@ -291,6 +301,14 @@ struct _CamelIMAPXServerPrivate {
 	GCancellable *idle_cancellable;
 	guint idle_stamp;
 
+	/* Coalesced summary save of flag changes received during IDLE */
+	GMutex idle_save_lock;
+	GSource *idle_save_source;
+	GWeakRef idle_save_folder;
+	CamelFolderChangeInfo *idle_save_changes;
+	gint64 idle_save_first_change;
+	gint64 idle_save_last_change;
+
 	gboolean is_cyrus;
 
 	/* Info about the current connection; guarded by priv->stream_lock */
@@ -308,6 +326,7 @@ struct _CamelIMAPXServerPrivate {
 
 	/* operation data */
 	GIOStream *get_message_stream;
+	GHashTable *sync_messages_streams; /* gchar *uid ~> GIOStream *, for batched downloads */
 
 	CamelIMAPXMailbox *fetch_changes_mailbox; /* not referenced */
 	CamelFolder *fetch_changes_folder; /* not referenced */
@@ -1033,6 +1052,117 @@ imapx_untagged_flags (CamelIMAPXServer *is,
 	return success;
 }
 
+static void
+imapx_server_idle_save_flush (CamelIMAPXServer *is)
+{
+	CamelFolder *folder;
+	CamelFolderChangeInfo *changes;
+
+	g_mutex_lock (&is->priv->idle_save_lock);
+
+	if (is->priv->idle_save_source) {
+		g_source_destroy (is->priv->idle_save_source);
+		g_source_unref (is->priv->idle_save_source);
+		is->priv->idle_save_source = NULL;
+	}
+
+	folder = g_weak_ref_get (&is->priv->idle_save_folder);
+	g_weak_ref_set (&is->priv->idle_save_folder, NULL);
+
+	changes = is->priv->idle_save_changes;
+	is->priv->idle_save_changes = NULL;
+
+	g_mutex_unlock (&is->priv->idle_save_lock);
+
+	if (folder) {
+		/* All the changed infos are dirty, thus they are saved in one go */
+		camel_folder_summary_save (camel_folder_get_folder_summary (folder), NULL);
+		imapx_update_store_summary (folder);
+
+		if (changes && camel_folder_change_info_changed (changes))
+			camel_folder_changed (folder, changes);
+
+		g_object_unref (folder);
+	}
+
+	if (changes)
+		camel_folder_change_info_free (changes);
+}
+
+static gboolean
+imapx_server_idle_save_timeout_cb (gpointer user_data)
+{
+	CamelIMAPXServer *is;
+	gboolean flush;
+	gint64 now;
+
+	is = g_weak_ref_get (user_data);
+	if (!is)
+		return G_SOURCE_REMOVE;
+
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&is->priv->idle_save_lock);
+
+	flush = now - is->priv->idle_save_last_change >= IMAPX_IDLE_SAVE_DELAY_MSECS * 1000 ||
+		now - is->priv->idle_save_first_change >= IMAPX_IDLE_SAVE_MAX_DELAY_MSECS * 1000;
+
+	g_mutex_unlock (&is->priv->idle_save_lock);
+
+	if (flush)
+		imapx_server_idle_save_flush (is);
+
+	g_object_unref (is);
+
+	return flush ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+}
+
+/* The first change arms the timer, the later only add to the pending changes;
+   the message infos are already marked dirty by the flag change itself. */
+static void
+imapx_server_idle_save_add_change (CamelIMAPXServer *is,
+				   CamelFolder *folder,
+				   const gchar *uid)
+{
+	CamelFolder *pending_folder;
+
+	g_mutex_lock (&is->priv->idle_save_lock);
+
+	pending_folder = g_weak_ref_get (&is->priv->idle_save_folder);
+	if (pending_folder && pending_folder != folder) {
+		g_mutex_unlock (&is->priv->idle_save_lock);
+
+		imapx_server_idle_save_flush (is);
+
+		g_mutex_lock (&is->priv->idle_save_lock);
+	}
+
+	g_clear_object (&pending_folder);
+
+	g_weak_ref_set (&is->priv->idle_save_folder, folder);
+
+	if (!is->priv->idle_save_changes)
+		is->priv->idle_save_changes = camel_folder_change_info_new ();
+
+	camel_folder_change_info_change_uid (is->priv->idle_save_changes, uid);
+
+	is->priv->idle_save_last_change = g_get_monotonic_time ();
+
+	if (!is->priv->idle_save_source) {
+		is->priv->idle_save_first_change = is->priv->idle_save_last_change;
+
+		is->priv->idle_save_source = g_timeout_source_new (IMAPX_IDLE_SAVE_DELAY_MSECS);
+		g_source_set_callback (
+			is->priv->idle_save_source,
+			imapx_server_idle_save_timeout_cb,
+			imapx_weak_ref_new (is),
+			(GDestroyNotify) imapx_weak_ref_free);
+		g_source_attach (is->priv->idle_save_source, NULL);
+	}
+
+	g_mutex_unlock (&is->priv->idle_save_lock);
+}
+
 static gboolean
 imapx_untagged_fetch (CamelIMAPXServer *is,
                       GInputStream *input_stream,
@@ -1066,21 +1196,28 @@ imapx_untagged_fetch (CamelIMAPXServer *is,
 		finfo->body = NULL;
 	}
 
-	if ((finfo->got & (FETCH_BODY | FETCH_UID)) == (FETCH_BODY | FETCH_UID)) {
+	if ((finfo->got & (FETCH_BODY | FETCH_UID)) == (FETCH_BODY | FETCH_UID) &&
+	    (!is->priv->sync_messages_streams || g_hash_table_contains (is->priv->sync_messages_streams, finfo->uid))) {
+		GIOStream *body_stream;
 		GOutputStream *output_stream;
 		gconstpointer body_data;
 		gsize body_size;
 
-		g_return_val_if_fail (is->priv->get_message_stream != NULL, FALSE);
+		if (is->priv->sync_messages_streams)
+			body_stream = g_hash_table_lookup (is->priv->sync_messages_streams, finfo->uid);
+		else
+			body_stream = is->priv->get_message_stream;
+
+		g_return_val_if_fail (body_stream != NULL, FALSE);
 
 		/* Fill out the body stream, in the right spot. */
 
 		g_seekable_seek (
-			G_SEEKABLE (is->priv->get_message_stream),
+			G_SEEKABLE (body_stream),
 			finfo->offset, G_SEEK_SET,
 			NULL, NULL);
 
-		output_stream = g_io_stream_get_output_stream (is->priv->get_message_stream);
+		output_stream = g_io_stream_get_output_stream (body_stream);
 
 		body_data = g_bytes_get_data (finfo->body, &body_size);
 
@@ -1193,7 +1330,12 @@ imapx_untagged_fetch (CamelIMAPXServer *is,
 				}
 			}
 
-			if (changed) {
+			if (changed && camel_imapx_server_is_in_idle (is)) {
+				/* Servers can send thousands of these in a row, like when
+				   marking the whole folder as read elsewhere; do not save
+				   the summary for each of them. */
+				imapx_server_idle_save_add_change (is, select_folder, uid);
+			} else if (changed) {
 				g_return_val_if_fail (is->priv->changes != NULL, FALSE);
 
 				g_mutex_lock (&is->priv->changes_lock);
@@ -1202,18 +1344,6 @@ imapx_untagged_fetch (CamelIMAPXServer *is,
 			}
 			g_free (uid);
 
-			if (changed && camel_imapx_server_is_in_idle (is)) {
-				camel_folder_summary_save (camel_folder_get_folder_summary (select_folder), NULL);
-				imapx_update_store_summary (select_folder);
-
-				g_mutex_lock (&is->priv->changes_lock);
-
-				camel_folder_changed (select_folder, is->priv->changes);
-				camel_folder_change_info_clear (is->priv->changes);
-
-				g_mutex_unlock (&is->priv->changes_lock);
-			}
-
 			g_clear_object (&mi);
 
 			g_object_unref (select_folder);
@@ -3290,6 +3420,8 @@ imapx_server_dispose (GObject *object)
 	}
 	g_mutex_unlock (&server->priv->idle_lock);
 
+	imapx_server_idle_save_flush (server);
+
 	g_clear_object (&server->priv->subprocess);
 
 	/* Chain up to parent's dispose() method. */
@@ -3328,6 +3460,9 @@ imapx_server_finalize (GObject *object)
 	g_mutex_clear (&is->priv->idle_lock);
 	g_cond_clear (&is->priv->idle_cond);
 
+	g_mutex_clear (&is->priv->idle_save_lock);
+	g_weak_ref_clear (&is->priv->idle_save_folder);
+
 	g_rec_mutex_clear (&is->priv->command_lock);
 
 	g_weak_ref_clear (&is->priv->store);
@@ -3425,6 +3560,9 @@ camel_imapx_server_init (CamelIMAPXServer *is)
 	is->priv->idle_state = IMAPX_IDLE_STATE_OFF;
 	is->priv->idle_stamp = 0;
 
+	g_mutex_init (&is->priv->idle_save_lock);
+	g_weak_ref_init (&is->priv->idle_save_folder, NULL);
+
 	g_rec_mutex_init (&is->priv->command_lock);
 }
 
@@ -3988,6 +4126,39 @@ camel_imapx_server_query_auth_types_sync (CamelIMAPXServer *is,
 	return imapx_connect_to_server (is, cancellable, error);
 }
 
+static gboolean
+imapx_server_move_tmp_to_cur (CamelDataCache *message_cache,
+			      const gchar *message_uid,
+			      GError **error)
+{
+	gchar *cur_filename;
+	gchar *tmp_filename;
+	gchar *dirname;
+	gboolean success = TRUE;
+
+	cur_filename = camel_data_cache_get_filename (message_cache, "cur", message_uid);
+	tmp_filename = camel_data_cache_get_filename (message_cache, "tmp", message_uid);
+
+	dirname = g_path_get_dirname (cur_filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	if (g_rename (tmp_filename, cur_filename) != 0) {
+		g_set_error (
+			error, G_FILE_ERROR,
+			g_file_error_from_errno (errno),
+			"%s: %s",
+			_("Failed to copy the tmp file"),
+			g_strerror (errno));
+		success = FALSE;
+	}
+
+	g_free (cur_filename);
+	g_free (tmp_filename);
+
+	return success;
+}
+
 CamelStream *
 camel_imapx_server_get_message_sync (CamelIMAPXServer *is,
 				     CamelIMAPXMailbox *mailbox,
@@ -4125,33 +4296,11 @@ camel_imapx_server_get_message_sync (CamelIMAPXServer *is,
 				_("Error fetching message"));
 		}
 
-		if (local_error == NULL) {
-			gchar *cur_filename;
-			gchar *tmp_filename;
-			gchar *dirname;
-
-			cur_filename = camel_data_cache_get_filename (message_cache, "cur", message_uid);
-			tmp_filename = camel_data_cache_get_filename (message_cache, "tmp", message_uid);
-
-			dirname = g_path_get_dirname (cur_filename);
-			g_mkdir_with_parents (dirname, 0700);
-			g_free (dirname);
-
-			if (g_rename (tmp_filename, cur_filename) == 0) {
-				/* Exchange the "tmp" stream for the "cur" stream. */
-				g_clear_object (&cache_stream);
-				cache_stream = camel_data_cache_get (message_cache, "cur", message_uid, &local_error);
-			} else {
-				g_set_error (
-					&local_error, G_FILE_ERROR,
-					g_file_error_from_errno (errno),
-					"%s: %s",
-					_("Failed to copy the tmp file"),
-					g_strerror (errno));
-			}
-
-			g_free (cur_filename);
-			g_free (tmp_filename);
+		if (local_error == NULL &&
+		    imapx_server_move_tmp_to_cur (message_cache, message_uid, &local_error)) {
+			/* Exchange the "tmp" stream for the "cur" stream. */
+			g_clear_object (&cache_stream);
+			cache_stream = camel_data_cache_get (message_cache, "cur", message_uid, &local_error);
 		}
 
 		/* Delete the 'tmp' file only if the operation succeeded. It's because
@@ -4175,6 +4324,21 @@ camel_imapx_server_get_message_sync (CamelIMAPXServer *is,
 	return result_stream;
 }
 
+static gboolean
+imapx_server_message_is_cached (CamelDataCache *message_cache,
+				const gchar *message_uid)
+{
+	gchar *cache_file;
+	struct stat st;
+	gboolean is_cached;
+
+	cache_file = camel_data_cache_get_filename (message_cache, "cur", message_uid);
+	is_cached = (g_stat (cache_file, &st) == 0 && st.st_size > 0);
+	g_free (cache_file);
+
+	return is_cached;
+}
+
 gboolean
 camel_imapx_server_sync_message_sync (CamelIMAPXServer *is,
 				      CamelIMAPXMailbox *mailbox,
@@ -4184,9 +4348,6 @@ camel_imapx_server_sync_message_sync (CamelIMAPXServer *is,
 				      GCancellable *cancellable,
 				      GError **error)
 {
-	gchar *cache_file = NULL;
-	gboolean is_cached;
-	struct stat st;
 	gboolean success = TRUE;
 
 	g_return_val_if_fail (CAMEL_IS_IMAPX_SERVER (is), FALSE);
@@ -4196,11 +4357,7 @@ camel_imapx_server_sync_message_sync (CamelIMAPXServer *is,
 	g_return_val_if_fail (message_uid != NULL, FALSE);
 
 	/* Check if the cache file already exists and is non-empty. */
-	cache_file = camel_data_cache_get_filename (message_cache, "cur", message_uid);
-	is_cached = (g_stat (cache_file, &st) == 0 && st.st_size > 0);
-	g_free (cache_file);
-
-	if (!is_cached) {
+	if (!imapx_server_message_is_cached (message_cache, message_uid)) {
 		CamelStream *stream;
 
 		stream = camel_imapx_server_get_message_sync (
@@ -4216,6 +4373,151 @@ camel_imapx_server_sync_message_sync (CamelIMAPXServer *is,
 	return success;
 }
 
+/* Downloads the messages with one UID FETCH per SYNC_MESSAGES_BATCH_SIZE bytes,
+   writing each body into its own "tmp" file in the @message_cache, as it comes.
+   The @message_uids should be sorted, thus they can be written as UID ranges. */
+gboolean
+camel_imapx_server_sync_messages_sync (CamelIMAPXServer *is,
+				       CamelIMAPXMailbox *mailbox,
+				       CamelFolderSummary *summary,
+				       CamelDataCache *message_cache,
+				       GPtrArray *message_uids,
+				       CamelIMAPXSyncMessagesProgressFunc progress_func,
+				       gpointer progress_user_data,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	guint ii = 0;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (CAMEL_IS_IMAPX_SERVER (is), FALSE);
+	g_return_val_if_fail (CAMEL_IS_IMAPX_MAILBOX (mailbox), FALSE);
+	g_return_val_if_fail (CAMEL_IS_FOLDER_SUMMARY (summary), FALSE);
+	g_return_val_if_fail (CAMEL_IS_DATA_CACHE (message_cache), FALSE);
+	g_return_val_if_fail (message_uids != NULL, FALSE);
+
+	if (!camel_imapx_server_ensure_selected_sync (is, mailbox, cancellable, error))
+		return FALSE;
+
+	while (ii < message_uids->len && success) {
+		struct _uidset_state uidset;
+		CamelIMAPXCommand *ic = NULL;
+		GHashTable *streams;
+		GHashTableIter iter;
+		gpointer key, value;
+		gsize batch_size = 0;
+
+		streams = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, g_object_unref);
+
+		imapx_uidset_init (&uidset, 0, MAX_COMMAND_LEN);
+
+		while (ii < message_uids->len && batch_size < SYNC_MESSAGES_BATCH_SIZE) {
+			const gchar *uid = message_uids->pdata[ii];
+			CamelMessageInfo *mi;
+			GIOStream *cache_stream;
+			gsize size;
+
+			mi = camel_folder_summary_get (summary, uid);
+			if (!mi) {
+				ii++;
+				continue;
+			}
+
+			size = camel_message_info_get_size (mi);
+			g_clear_object (&mi);
+
+			if (imapx_server_message_is_cached (message_cache, uid)) {
+				ii++;
+
+				if (progress_func)
+					progress_func (is, size, progress_user_data);
+				continue;
+			}
+
+			/* Large messages are downloaded alone, possibly in parts */
+			if (size > MULTI_SIZE) {
+				if (g_hash_table_size (streams))
+					break;
+
+				ii++;
+
+				success = camel_imapx_server_sync_message_sync (is, mailbox, summary, message_cache, uid, cancellable, error);
+
+				if (success && progress_func)
+					progress_func (is, size, progress_user_data);
+
+				if (!success)
+					break;
+
+				continue;
+			}
+
+			camel_data_cache_remove (message_cache, "tmp", uid, NULL);
+
+			cache_stream = camel_data_cache_add (message_cache, "tmp", uid, error);
+			if (!cache_stream) {
+				success = FALSE;
+				break;
+			}
+
+			ii++;
+
+			if (!ic)
+				ic = camel_imapx_command_new (is, CAMEL_IMAPX_JOB_SYNC_MESSAGE, "UID FETCH ");
+
+			g_hash_table_insert (streams, (gpointer) camel_pstring_strdup (uid), cache_stream);
+			batch_size += size;
+
+			if (imapx_uidset_add (&uidset, ic, uid) == 1)
+				break;
+		}
+
+		if (ic) {
+			imapx_uidset_done (&uidset, ic);
+			camel_imapx_command_add (ic, " (BODY.PEEK[])");
+
+			if (success) {
+				is->priv->sync_messages_streams = streams;
+
+				success = camel_imapx_server_process_command_sync (is, ic, _("Error fetching message"), cancellable, error);
+
+				is->priv->sync_messages_streams = NULL;
+			}
+
+			camel_imapx_command_unref (ic);
+		}
+
+		g_hash_table_iter_init (&iter, streams);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			const gchar *uid = key;
+			GIOStream *cache_stream = value;
+			gboolean got_data;
+
+			got_data = g_seekable_tell (G_SEEKABLE (cache_stream)) > 0;
+
+			/* Messages without any data were deleted on the server meanwhile */
+			if (success && got_data &&
+			    g_io_stream_close (cache_stream, cancellable, error) &&
+			    imapx_server_move_tmp_to_cur (message_cache, uid, error)) {
+				camel_data_cache_remove (message_cache, "tmp", uid, NULL);
+			} else {
+				if (success && got_data)
+					success = FALSE;
+
+				g_io_stream_close (cache_stream, NULL, NULL);
+				camel_data_cache_remove (message_cache, "tmp", uid, NULL);
+			}
+		}
+
+		g_hash_table_destroy (streams);
+
+		if (success && batch_size && progress_func)
+			progress_func (is, batch_size, progress_user_data);
+	}
+
+	return success;
+}
+
 static void
 imapx_copy_move_message_cache (CamelFolder *source_folder,
 			       CamelFolder *destination_folder,
@@ -6750,6 +7052,9 @@ camel_imapx_server_stop_idle_sync (CamelIMAPXServer *is,
 		imapx_disconnect (is);
 	}
 
+	/* Save flag changes received during the IDLE before other commands run */
+	imapx_server_idle_save_flush (is);
+
 	g_clear_object (&idle_cancellable);
 
 	return success;
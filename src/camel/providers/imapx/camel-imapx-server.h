@@ -71,6 +71,11 @@ typedef gboolean (* CamelIMAPXUntaggedRespHandler) (CamelIMAPXServer *server,
 						    GCancellable *cancellable,
 						    GError **error);
 
+/* progress of camel_imapx_server_sync_messages_sync(), in bytes downloaded */
+typedef void (* CamelIMAPXSyncMessagesProgressFunc) (CamelIMAPXServer *server,
+						     gsize n_bytes,
+						     gpointer user_data);
+
 /**
  * CamelIMAPXUntaggedRespHandlerDesc:
  * @untagged_response: a string representation of the IMAP
@@ -241,6 +246,16 @@ gboolean	camel_imapx_server_sync_message_sync
 						 const gchar *message_uid,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	camel_imapx_server_sync_messages_sync
+						(CamelIMAPXServer *is,
+						 CamelIMAPXMailbox *mailbox,
+						 CamelFolderSummary *summary,
+						 CamelDataCache *message_cache,
+						 GPtrArray *message_uids,
+						 CamelIMAPXSyncMessagesProgressFunc progress_func,
+						 gpointer progress_user_data,
+						 GCancellable *cancellable,
+						 GError **error);
 gboolean	camel_imapx_server_create_mailbox_sync
 						(CamelIMAPXServer *is,
 						 const gchar *mailbox_name,
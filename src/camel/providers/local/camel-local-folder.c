@@ -46,6 +46,9 @@
 #define PATH_MAX _POSIX_PATH_MAX
 #endif
 
+/* how many messages are indexed between commits of the index */
+#define INDEX_COMMIT_EVERY (100)
+
 #define CAMEL_LOCAL_FOLDER_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), CAMEL_TYPE_LOCAL_FOLDER, CamelLocalFolderPrivate))
@@ -136,6 +139,7 @@ local_folder_finalize (GObject *object)
 	camel_folder_change_info_free (local_folder->changes);
 
 	g_mutex_clear (&local_folder->priv->search_lock);
+	g_mutex_clear (&local_folder->priv->index_lock);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_local_folder_parent_class)->finalize (object);
@@ -234,6 +238,30 @@ local_folder_get_permanent_flags (CamelFolder *folder)
 		CAMEL_MESSAGE_USER;
 }
 
+/* messages still waiting in the index queue are searched by their content */
+static void
+local_folder_set_search_body_index (CamelLocalFolder *local_folder)
+{
+	CamelFolderSummary *summary;
+	GHashTable *pending = NULL;
+
+	if (!camel_local_folder_get_index_body (local_folder)) {
+		camel_folder_search_set_body_index (local_folder->search, NULL);
+		camel_folder_search_set_body_index_pending (local_folder->search, NULL);
+		return;
+	}
+
+	summary = camel_folder_get_folder_summary (CAMEL_FOLDER (local_folder));
+	if (summary && local_folder->index)
+		pending = camel_local_summary_dup_index_pending (CAMEL_LOCAL_SUMMARY (summary));
+
+	camel_folder_search_set_body_index (local_folder->search, local_folder->index);
+	camel_folder_search_set_body_index_pending (local_folder->search, pending);
+
+	if (pending)
+		g_hash_table_unref (pending);
+}
+
 static GPtrArray *
 local_folder_search_by_expression (CamelFolder *folder,
                                    const gchar *expression,
@@ -249,10 +277,7 @@ local_folder_search_by_expression (CamelFolder *folder,
 		local_folder->search = camel_folder_search_new ();
 
 	camel_folder_search_set_folder (local_folder->search, folder);
-	if (camel_local_folder_get_index_body (local_folder))
-		camel_folder_search_set_body_index (local_folder->search, local_folder->index);
-	else
-		camel_folder_search_set_body_index (local_folder->search, NULL);
+	local_folder_set_search_body_index (local_folder);
 	matches = camel_folder_search_search (local_folder->search, expression, NULL, cancellable, error);
 
 	CAMEL_LOCAL_FOLDER_UNLOCK (folder, search_lock);
@@ -279,10 +304,7 @@ local_folder_search_by_uids (CamelFolder *folder,
 		local_folder->search = camel_folder_search_new ();
 
 	camel_folder_search_set_folder (local_folder->search, folder);
-	if (camel_local_folder_get_index_body (local_folder))
-		camel_folder_search_set_body_index (local_folder->search, local_folder->index);
-	else
-		camel_folder_search_set_body_index (local_folder->search, NULL);
+	local_folder_set_search_body_index (local_folder);
 	matches = camel_folder_search_search (local_folder->search, expression, uids, cancellable, error);
 
 	CAMEL_LOCAL_FOLDER_UNLOCK (folder, search_lock);
@@ -363,10 +385,7 @@ local_folder_count_by_expression (CamelFolder *folder,
 		local_folder->search = camel_folder_search_new ();
 
 	camel_folder_search_set_folder (local_folder->search, folder);
-	if (camel_local_folder_get_index_body (local_folder))
-		camel_folder_search_set_body_index (local_folder->search, local_folder->index);
-	else
-		camel_folder_search_set_body_index (local_folder->search, NULL);
+	local_folder_set_search_body_index (local_folder);
 	matches = camel_folder_search_count (local_folder->search, expression, cancellable, error);
 
 	CAMEL_LOCAL_FOLDER_UNLOCK (folder, search_lock);
@@ -418,6 +437,8 @@ local_folder_refresh_info_sync (CamelFolder *folder,
 		camel_folder_change_info_clear (lf->changes);
 	}
 
+	camel_local_folder_schedule_index (lf);
+
 	return TRUE;
 }
 
@@ -448,6 +469,8 @@ local_folder_synchronize_sync (CamelFolder *folder,
 		camel_folder_change_info_clear (lf->changes);
 	}
 
+	camel_local_folder_schedule_index (lf);
+
 	return success;
 }
 
@@ -515,6 +538,7 @@ camel_local_folder_init (CamelLocalFolder *local_folder)
 
 	local_folder->priv = CAMEL_LOCAL_FOLDER_GET_PRIVATE (local_folder);
 	g_mutex_init (&local_folder->priv->search_lock);
+	g_mutex_init (&local_folder->priv->index_lock);
 
 	camel_folder_set_flags (folder, camel_folder_get_flags (folder) | CAMEL_FOLDER_HAS_SUMMARY_CAPABILITY);
 
@@ -639,6 +663,14 @@ camel_local_folder_construct (CamelLocalFolder *lf,
 	}
 
 	camel_folder_take_folder_summary (folder, CAMEL_FOLDER_SUMMARY (CAMEL_LOCAL_FOLDER_GET_CLASS (lf)->create_summary (lf, lf->folder_path, lf->index)));
+	if (lf->index) {
+		CamelLocalSummary *cls = (CamelLocalSummary *) camel_folder_get_folder_summary (folder);
+
+		/* the content is indexed by a background job, not while summarising */
+		camel_local_summary_set_index_deferred (cls, TRUE);
+		camel_local_summary_load_index_queue (cls, NULL);
+	}
+
 	if (!(flags & CAMEL_STORE_IS_MIGRATING) && !camel_local_summary_load ((CamelLocalSummary *) camel_folder_get_folder_summary (folder), forceindex, NULL)) {
 		/* ? */
 		if (need_summary_check &&
@@ -651,6 +683,8 @@ camel_local_folder_construct (CamelLocalFolder *lf,
 		}
 	}
 
+	camel_local_folder_schedule_index (lf);
+
 	/* TODO: This probably shouldn't be here? */
 	if ((flags & CAMEL_STORE_FOLDER_CREATE) != 0) {
 		CamelFolderInfo *fi;
@@ -689,6 +723,189 @@ camel_local_folder_set_index_body (CamelLocalFolder *local_folder,
 	g_object_notify (G_OBJECT (local_folder), "index-body");
 }
 
+static void
+local_folder_index_thread (CamelSession *session,
+                           GCancellable *cancellable,
+                           gpointer user_data,
+                           GError **error)
+{
+	CamelLocalFolder *local_folder = user_data;
+	CamelFolder *folder = CAMEL_FOLDER (local_folder);
+	CamelFolderSummary *summary;
+	CamelStore *parent_store;
+	GHashTable *failed;
+	GError *failed_error = NULL;
+	guint n_total, n_indexed = 0;
+	gboolean done = FALSE, stopped = FALSE;
+
+	summary = camel_folder_get_folder_summary (folder);
+	parent_store = camel_folder_get_parent_store (folder);
+	n_total = camel_local_summary_count_index_pending (CAMEL_LOCAL_SUMMARY (summary));
+
+	/* messages, which could not be read; they stay in the queue,
+	 * to be indexed by the next job, but are skipped by this one */
+	failed = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+	while (!done && !g_cancellable_is_cancelled (cancellable)) {
+		GPtrArray *uids;
+		GArray *offsets;
+		guint ii;
+
+		uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+		offsets = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+		if (camel_db_read_index_queue (camel_store_get_db (parent_store), camel_folder_get_full_name (folder),
+		    INDEX_COMMIT_EVERY + g_hash_table_size (failed), uids, offsets, error) == -1) {
+			done = TRUE;
+		} else {
+			for (ii = uids->len; ii-- > 0;) {
+				if (g_hash_table_contains (failed, uids->pdata[ii]))
+					g_ptr_array_remove_index (uids, ii);
+			}
+		}
+
+		if (done) {
+			/* failed to read the queue */
+		} else if (!uids->len) {
+			/* stop only when nothing was queued while reading the queue */
+			g_mutex_lock (&local_folder->priv->index_lock);
+			done = !local_folder->priv->index_again;
+			local_folder->priv->index_again = FALSE;
+			if (done) {
+				local_folder->priv->index_running = FALSE;
+				stopped = TRUE;
+			}
+			g_mutex_unlock (&local_folder->priv->index_lock);
+		} else {
+			for (ii = 0; ii < uids->len; ii++) {
+				const gchar *uid = uids->pdata[ii];
+				CamelMimeMessage *message = NULL;
+				GError *local_error = NULL;
+
+				/* the message could be removed in the meantime */
+				if (camel_folder_summary_check_uid (summary, uid))
+					message = camel_folder_get_message_sync (folder, uid, cancellable, &local_error);
+
+				if (message) {
+					camel_local_summary_index_message (CAMEL_LOCAL_SUMMARY (summary), uid, message, cancellable);
+					g_object_unref (message);
+				} else if (camel_folder_summary_check_uid (summary, uid) &&
+					   !g_cancellable_is_cancelled (cancellable)) {
+					if (!failed_error && local_error) {
+						g_prefix_error (&local_error, _("Could not index message “%s”: "), uid);
+						failed_error = local_error;
+						local_error = NULL;
+					}
+
+					g_hash_table_add (failed, (gpointer) camel_pstring_strdup (uid));
+					g_clear_error (&local_error);
+
+					/* not done, thus left in the queue */
+					g_ptr_array_remove_index (uids, ii);
+					ii--;
+					continue;
+				}
+
+				g_clear_error (&local_error);
+
+				if (g_cancellable_is_cancelled (cancellable))
+					break;
+
+				n_indexed++;
+				camel_operation_progress (cancellable, n_total ? MIN (n_indexed, n_total) * 100 / n_total : 0);
+
+				/* give way to the foreground work */
+				g_thread_yield ();
+			}
+
+			/* commit what got indexed, even when cancelled */
+			g_ptr_array_set_size (uids, ii);
+			if (camel_local_summary_index_done (CAMEL_LOCAL_SUMMARY (summary), uids, error) == -1)
+				done = TRUE;
+		}
+
+		g_ptr_array_free (uids, TRUE);
+		g_array_free (offsets, TRUE);
+	}
+
+	if (!stopped) {
+		g_mutex_lock (&local_folder->priv->index_lock);
+		local_folder->priv->index_running = FALSE;
+		local_folder->priv->index_again = FALSE;
+		g_mutex_unlock (&local_folder->priv->index_lock);
+	}
+
+	if (g_hash_table_size (failed) > 0) {
+		if (!failed_error)
+			g_set_error (
+				&failed_error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+				_("Could not index %u messages of folder “%s”"),
+				g_hash_table_size (failed), camel_folder_get_display_name (folder));
+
+		if (error && *error)
+			g_clear_error (&failed_error);
+		else
+			g_propagate_error (error, failed_error);
+	}
+
+	g_hash_table_destroy (failed);
+}
+
+/* stores the messages summarised without indexing their content to the
+ * folder's index queue and starts a job to index them, unless running */
+void
+camel_local_folder_schedule_index (CamelLocalFolder *local_folder)
+{
+	CamelFolder *folder;
+	CamelFolderSummary *summary;
+	CamelSession *session;
+	CamelStore *parent_store;
+	GError *local_error = NULL;
+	gchar *description;
+
+	g_return_if_fail (CAMEL_IS_LOCAL_FOLDER (local_folder));
+
+	folder = CAMEL_FOLDER (local_folder);
+	summary = camel_folder_get_folder_summary (folder);
+
+	if (!local_folder->index || !summary)
+		return;
+
+	if (camel_local_summary_save_index_queue (CAMEL_LOCAL_SUMMARY (summary), &local_error) == -1) {
+		g_warning ("%s: Could not queue messages for indexing: %s", G_STRFUNC,
+			local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+	}
+
+	if (!camel_local_summary_count_index_pending (CAMEL_LOCAL_SUMMARY (summary)))
+		return;
+
+	parent_store = camel_folder_get_parent_store (folder);
+	session = parent_store ? camel_service_ref_session (CAMEL_SERVICE (parent_store)) : NULL;
+	if (!session)
+		return;
+
+	g_mutex_lock (&local_folder->priv->index_lock);
+	if (local_folder->priv->index_running) {
+		local_folder->priv->index_again = TRUE;
+		g_mutex_unlock (&local_folder->priv->index_lock);
+		g_object_unref (session);
+		return;
+	}
+	local_folder->priv->index_running = TRUE;
+	g_mutex_unlock (&local_folder->priv->index_lock);
+
+	/* Translators: The “%s” is replaced with a folder name */
+	description = g_strdup_printf (_("Indexing folder “%s”"), camel_folder_get_display_name (folder));
+
+	camel_session_submit_job (
+		session, description, local_folder_index_thread,
+		g_object_ref (local_folder), g_object_unref);
+
+	g_free (description);
+	g_object_unref (session);
+}
+
 /* lock the folder, may be called repeatedly (with matching unlock calls),
  * with type the same or less than the first call */
 gint
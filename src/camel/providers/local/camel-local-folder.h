@@ -107,6 +107,8 @@ gboolean	camel_local_folder_get_index_body
 void		camel_local_folder_set_index_body
 						(CamelLocalFolder *local_folder,
 						 gboolean index_body);
+void		camel_local_folder_schedule_index
+						(CamelLocalFolder *local_folder);
 
 /* Lock the folder for internal use.  May be called repeatedly */
 /* UNIMPLEMENTED */
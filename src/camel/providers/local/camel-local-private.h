@@ -31,6 +31,10 @@ G_BEGIN_DECLS
 
 struct _CamelLocalFolderPrivate {
 	GMutex search_lock;	/* for locking the search object */
+
+	GMutex index_lock;	/* for the index job state below */
+	gboolean index_running;	/* an index job is scheduled or running */
+	gboolean index_again;	/* messages were queued while it ran */
 };
 
 #define CAMEL_LOCAL_FOLDER_LOCK(f, l) \
@@ -37,6 +37,17 @@
 
 #define CAMEL_LOCAL_SUMMARY_VERSION (1)
 
+#define CAMEL_LOCAL_SUMMARY_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE \
+	((obj), CAMEL_TYPE_LOCAL_SUMMARY, CamelLocalSummaryPrivate))
+
+struct _CamelLocalSummaryPrivate {
+	GMutex index_lock;	/* for the members below */
+	gboolean index_deferred;
+	GHashTable *index_pending; /* uids not in the index yet */
+	GPtrArray *index_new;	/* pending uids not in the index queue yet */
+};
+
 static CamelFIRecord *
 		summary_header_save		(CamelFolderSummary *,
 						 GError **error);
@@ -102,6 +113,10 @@ local_summary_finalize (GObject *object)
 
 	g_free (local_summary->folder_path);
 
+	g_hash_table_destroy (local_summary->priv->index_pending);
+	g_ptr_array_free (local_summary->priv->index_new, TRUE);
+	g_mutex_clear (&local_summary->priv->index_lock);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_local_summary_parent_class)->finalize (object);
 }
@@ -112,6 +127,8 @@ camel_local_summary_class_init (CamelLocalSummaryClass *class)
 	GObjectClass *object_class;
 	CamelFolderSummaryClass *folder_summary_class;
 
+	g_type_class_add_private (class, sizeof (CamelLocalSummaryPrivate));
+
 	object_class = G_OBJECT_CLASS (class);
 	object_class->dispose = local_summary_dispose;
 	object_class->finalize = local_summary_finalize;
@@ -137,6 +154,12 @@ camel_local_summary_init (CamelLocalSummary *local_summary)
 
 	folder_summary = CAMEL_FOLDER_SUMMARY (local_summary);
 
+	local_summary->priv = CAMEL_LOCAL_SUMMARY_GET_PRIVATE (local_summary);
+	g_mutex_init (&local_summary->priv->index_lock);
+	local_summary->priv->index_pending = g_hash_table_new_full (
+		g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+	local_summary->priv->index_new = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+
 	/* and a unique file version */
 	camel_folder_summary_set_version (folder_summary, camel_folder_summary_get_version (folder_summary) + CAMEL_LOCAL_SUMMARY_VERSION);
 }
@@ -188,6 +211,329 @@ void camel_local_summary_check_force (CamelLocalSummary *cls)
 	cls->check_force = 1;
 }
 
+void
+camel_local_summary_set_index_deferred (CamelLocalSummary *cls,
+                                        gboolean index_deferred)
+{
+	g_return_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls));
+
+	g_mutex_lock (&cls->priv->index_lock);
+	cls->priv->index_deferred = index_deferred;
+	g_mutex_unlock (&cls->priv->index_lock);
+}
+
+gboolean
+camel_local_summary_get_index_deferred (CamelLocalSummary *cls)
+{
+	gboolean index_deferred;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), FALSE);
+
+	g_mutex_lock (&cls->priv->index_lock);
+	index_deferred = cls->priv->index_deferred;
+	g_mutex_unlock (&cls->priv->index_lock);
+
+	return index_deferred;
+}
+
+/* the uid is only known once the info is added to the summary, thus
+ * the message is marked when its content is skipped, then queued here */
+void
+camel_local_summary_queue_index (CamelLocalSummary *cls,
+                                 CamelMessageInfo *info)
+{
+	const gchar *uid;
+	gboolean abort_notifications;
+
+	g_return_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls));
+
+	if (!info || (camel_message_info_get_flags (info) & CAMEL_MESSAGE_FOLDER_NOINDEX) == 0)
+		return;
+
+	/* the flag is internal, its change does not make the message dirty */
+	abort_notifications = camel_message_info_get_abort_notifications (info);
+	camel_message_info_set_abort_notifications (info, TRUE);
+	camel_message_info_set_flags (info, CAMEL_MESSAGE_FOLDER_NOINDEX, 0);
+	camel_message_info_set_abort_notifications (info, abort_notifications);
+
+	uid = camel_message_info_get_uid (info);
+	if (!uid || !*uid)
+		return;
+
+	g_mutex_lock (&cls->priv->index_lock);
+	g_hash_table_add (cls->priv->index_pending, (gpointer) camel_pstring_strdup (uid));
+	g_ptr_array_add (cls->priv->index_new, (gpointer) camel_pstring_strdup (uid));
+	g_mutex_unlock (&cls->priv->index_lock);
+}
+
+gint
+camel_local_summary_save_index_queue (CamelLocalSummary *cls,
+                                      GError **error)
+{
+	CamelLocalSummaryClass *class;
+	CamelFolderSummary *summary;
+	CamelFolder *folder;
+	GPtrArray *uids;
+	GArray *offsets;
+	gint ret = 0;
+	guint ii;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), -1);
+
+	summary = CAMEL_FOLDER_SUMMARY (cls);
+	folder = camel_folder_summary_get_folder (summary);
+	class = CAMEL_LOCAL_SUMMARY_GET_CLASS (cls);
+
+	g_mutex_lock (&cls->priv->index_lock);
+	uids = cls->priv->index_new;
+	cls->priv->index_new = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+	g_mutex_unlock (&cls->priv->index_lock);
+
+	if (uids->len && folder) {
+		offsets = g_array_sized_new (FALSE, FALSE, sizeof (gint64), uids->len);
+
+		/* the offsets are set only after the message is added to the summary */
+		for (ii = 0; ii < uids->len; ii++) {
+			CamelMessageInfo *info;
+			gint64 offset = 0;
+
+			info = class->index_offset ? camel_folder_summary_get (summary, uids->pdata[ii]) : NULL;
+			if (info) {
+				offset = class->index_offset (cls, info);
+				g_object_unref (info);
+			}
+
+			g_array_append_val (offsets, offset);
+		}
+
+		ret = camel_db_add_to_index_queue (
+			camel_store_get_db (camel_folder_get_parent_store (folder)),
+			camel_folder_get_full_name (folder), uids, offsets, error);
+
+		g_array_free (offsets, TRUE);
+
+		g_mutex_lock (&cls->priv->index_lock);
+		for (ii = 0; ii < uids->len; ii++) {
+			/* try again the next time */
+			if (ret == -1)
+				g_ptr_array_add (cls->priv->index_new, (gpointer) camel_pstring_strdup (uids->pdata[ii]));
+			g_hash_table_add (cls->priv->index_pending, (gpointer) camel_pstring_strdup (uids->pdata[ii]));
+		}
+		g_mutex_unlock (&cls->priv->index_lock);
+	}
+
+	g_ptr_array_free (uids, TRUE);
+
+	return ret;
+}
+
+gint
+camel_local_summary_load_index_queue (CamelLocalSummary *cls,
+                                      GError **error)
+{
+	CamelFolder *folder;
+	GPtrArray *uids;
+	GArray *offsets;
+	gint ret;
+	guint ii;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), -1);
+
+	folder = camel_folder_summary_get_folder (CAMEL_FOLDER_SUMMARY (cls));
+	if (!folder)
+		return 0;
+
+	uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+	offsets = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	ret = camel_db_read_index_queue (
+		camel_store_get_db (camel_folder_get_parent_store (folder)),
+		camel_folder_get_full_name (folder), 0, uids, offsets, error);
+
+	g_mutex_lock (&cls->priv->index_lock);
+	for (ii = 0; ii < uids->len; ii++)
+		g_hash_table_add (cls->priv->index_pending, (gpointer) camel_pstring_strdup (uids->pdata[ii]));
+	g_mutex_unlock (&cls->priv->index_lock);
+
+	g_ptr_array_free (uids, TRUE);
+	g_array_free (offsets, TRUE);
+
+	return ret;
+}
+
+guint
+camel_local_summary_count_index_pending (CamelLocalSummary *cls)
+{
+	guint count;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), 0);
+
+	g_mutex_lock (&cls->priv->index_lock);
+	count = g_hash_table_size (cls->priv->index_pending);
+	g_mutex_unlock (&cls->priv->index_lock);
+
+	return count;
+}
+
+GHashTable *
+camel_local_summary_dup_index_pending (CamelLocalSummary *cls)
+{
+	GHashTable *pending = NULL;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), NULL);
+
+	g_mutex_lock (&cls->priv->index_lock);
+
+	if (g_hash_table_size (cls->priv->index_pending)) {
+		pending = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+		g_hash_table_iter_init (&iter, cls->priv->index_pending);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_hash_table_add (pending, (gpointer) camel_pstring_strdup (key));
+	}
+
+	g_mutex_unlock (&cls->priv->index_lock);
+
+	return pending;
+}
+
+/* as the summary does while building the content info from a message */
+static void
+local_summary_index_part (CamelMimePart *part,
+                          CamelStream *null,
+                          CamelMimeFilter *filter_index,
+                          GCancellable *cancellable)
+{
+	CamelDataWrapper *containee;
+	CamelContentType *ct;
+
+	containee = camel_medium_get_content (CAMEL_MEDIUM (part));
+	if (containee == NULL)
+		return;
+
+	ct = camel_data_wrapper_get_mime_type_field (containee);
+
+	if (CAMEL_IS_MULTIPART (containee)) {
+		gint ii, parts;
+
+		parts = camel_multipart_get_number (CAMEL_MULTIPART (containee));
+		for (ii = 0; ii < parts && !g_cancellable_is_cancelled (cancellable); ii++) {
+			CamelMimePart *subpart = camel_multipart_get_part (CAMEL_MULTIPART (containee), ii);
+
+			if (subpart)
+				local_summary_index_part (subpart, null, filter_index, cancellable);
+		}
+	} else if (CAMEL_IS_MIME_MESSAGE (containee)) {
+		local_summary_index_part (CAMEL_MIME_PART (containee), null, filter_index, cancellable);
+	} else if (camel_content_type_is (ct, "text", "*")) {
+		CamelStream *filter_stream;
+		CamelMimeFilter *filter;
+		const gchar *charset;
+
+		filter_stream = camel_stream_filter_new (null);
+
+		charset = camel_content_type_param (ct, "charset");
+		if (charset && *charset && g_ascii_strcasecmp (charset, "UTF-8") != 0 &&
+		    (filter = camel_mime_filter_charset_new (charset, "UTF-8")) != NULL) {
+			camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter);
+			g_object_unref (filter);
+		}
+
+		if (camel_content_type_is (ct, "text", "html")) {
+			filter = camel_mime_filter_html_new ();
+			camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter);
+			g_object_unref (filter);
+		}
+
+		camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter_index);
+
+		camel_data_wrapper_decode_to_stream_sync (containee, filter_stream, cancellable, NULL);
+		camel_stream_flush (filter_stream, cancellable, NULL);
+
+		g_object_unref (filter_stream);
+	}
+}
+
+void
+camel_local_summary_index_message (CamelLocalSummary *cls,
+                                   const gchar *uid,
+                                   CamelMimeMessage *message,
+                                   GCancellable *cancellable)
+{
+	CamelIndexName *name;
+	CamelMimeFilter *filter_index;
+	CamelStream *null;
+
+	g_return_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls));
+	g_return_if_fail (uid != NULL);
+	g_return_if_fail (CAMEL_IS_MIME_MESSAGE (message));
+
+	if (!cls->index)
+		return;
+
+	camel_index_delete_name (cls->index, uid);
+	name = camel_index_add_name (cls->index, uid);
+	if (!name)
+		return;
+
+	filter_index = camel_mime_filter_index_new (cls->index);
+	camel_mime_filter_index_set_name (CAMEL_MIME_FILTER_INDEX (filter_index), name);
+	null = camel_stream_null_new ();
+
+	local_summary_index_part (CAMEL_MIME_PART (message), null, filter_index, cancellable);
+
+	camel_index_write_name (cls->index, name);
+	camel_mime_filter_index_set_name (CAMEL_MIME_FILTER_INDEX (filter_index), NULL);
+
+	g_object_unref (null);
+	g_object_unref (filter_index);
+	g_object_unref (name);
+}
+
+/* the messages leave the queue only once their content is committed
+ * to the index, thus a cancelled or interrupted indexing continues
+ * where it stopped, instead of starting over */
+gint
+camel_local_summary_index_done (CamelLocalSummary *cls,
+                                GPtrArray *uids,
+                                GError **error)
+{
+	CamelFolder *folder;
+	gint ret;
+	guint ii;
+
+	g_return_val_if_fail (CAMEL_IS_LOCAL_SUMMARY (cls), -1);
+	g_return_val_if_fail (uids != NULL, -1);
+
+	folder = camel_folder_summary_get_folder (CAMEL_FOLDER_SUMMARY (cls));
+	if (!folder || !uids->len)
+		return 0;
+
+	if (cls->index && camel_index_sync (cls->index) == -1) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			_("Could not save index for %s: %s"),
+			cls->folder_path, g_strerror (errno));
+		return -1;
+	}
+
+	ret = camel_db_delete_from_index_queue (
+		camel_store_get_db (camel_folder_get_parent_store (folder)),
+		camel_folder_get_full_name (folder), uids, error);
+
+	if (ret == 0) {
+		g_mutex_lock (&cls->priv->index_lock);
+		for (ii = 0; ii < uids->len; ii++)
+			g_hash_table_remove (cls->priv->index_pending, uids->pdata[ii]);
+		g_mutex_unlock (&cls->priv->index_lock);
+	}
+
+	return ret;
+}
+
 gchar *
 camel_local_summary_encode_x_evolution (CamelLocalSummary *cls,
                                         const CamelMessageInfo *info)
@@ -524,7 +870,7 @@ local_summary_add (CamelLocalSummary *cls,
 	if (info) {
 		camel_message_info_take_user_flags (mi, camel_message_info_dup_user_flags (info));
 		camel_message_info_take_user_tags (mi, camel_message_info_dup_user_tags (info));
-		camel_message_info_set_flags (mi, ~0, camel_message_info_get_flags (info));
+		camel_message_info_set_flags (mi, ~0, camel_message_info_get_flags (info) | (camel_message_info_get_flags (mi) & CAMEL_MESSAGE_FOLDER_NOINDEX));
 		camel_message_info_set_size (mi, camel_message_info_get_size (info));
 	}
 
@@ -540,6 +886,7 @@ local_summary_add (CamelLocalSummary *cls,
 
 	camel_message_info_set_abort_notifications (mi, FALSE);
 	camel_folder_summary_add (summary, mi, FALSE);
+	camel_local_summary_queue_index (cls, mi);
 	camel_folder_change_info_add_uid (ci, camel_message_info_get_uid (mi));
 
 	return mi;
@@ -761,8 +1108,14 @@ message_info_new_from_headers (CamelFolderSummary *summary,
 		    && (doindex
 			|| cls->index_force
 			|| !camel_index_has_name (cls->index, camel_message_info_get_uid (mi)))) {
-			d (printf ("Am indexing message %s\n", camel_message_info_get_uid (mi)));
-			camel_folder_summary_set_index (summary, cls->index);
+			if (camel_local_summary_get_index_deferred (cls)) {
+				d (printf ("Queueing message %s for indexing\n", camel_message_info_get_uid (mi)));
+				camel_message_info_set_flags (mi, CAMEL_MESSAGE_FOLDER_NOINDEX, CAMEL_MESSAGE_FOLDER_NOINDEX);
+				camel_folder_summary_set_index (summary, NULL);
+			} else {
+				d (printf ("Am indexing message %s\n", camel_message_info_get_uid (mi)));
+				camel_folder_summary_set_index (summary, cls->index);
+			}
 		} else {
 			d (printf ("Not indexing message %s\n", camel_message_info_get_uid (mi)));
 			camel_folder_summary_set_index (summary, NULL);
@@ -44,16 +44,19 @@ G_BEGIN_DECLS
 
 typedef struct _CamelLocalSummary      CamelLocalSummary;
 typedef struct _CamelLocalSummaryClass CamelLocalSummaryClass;
+typedef struct _CamelLocalSummaryPrivate CamelLocalSummaryPrivate;
 
 /* extra summary flags */
 enum {
 	CAMEL_MESSAGE_FOLDER_NOXEV = 1 << 17,
 	CAMEL_MESSAGE_FOLDER_XEVCHANGE = 1 << 18,
-	CAMEL_MESSAGE_FOLDER_NOTSEEN = 1 << 19 /* have we seen this in processing this loop? */
+	CAMEL_MESSAGE_FOLDER_NOTSEEN = 1 << 19, /* have we seen this in processing this loop? */
+	CAMEL_MESSAGE_FOLDER_NOINDEX = 1 << 20 /* content to be indexed later, from the index queue */
 };
 
 struct _CamelLocalSummary {
 	CamelFolderSummary parent;
+	CamelLocalSummaryPrivate *priv;
 
 	guint32 version;	/* file version being loaded */
 
@@ -75,9 +78,10 @@ struct _CamelLocalSummaryClass {
 	gchar *(*encode_x_evolution)(CamelLocalSummary *cls, const CamelMessageInfo *info);
 	gint (*decode_x_evolution)(CamelLocalSummary *cls, const gchar *xev, CamelMessageInfo *info);
 	gint (*need_index)(void);
+	goffset (*index_offset)(CamelLocalSummary *cls, CamelMessageInfo *info);
 
 	/* Padding for future expansion */
-	gpointer reserved[20];
+	gpointer reserved[19];
 };
 
 GType	camel_local_summary_get_type	(void);
@@ -95,6 +99,21 @@ CamelMessageInfo *camel_local_summary_add (CamelLocalSummary *cls, CamelMimeMess
 /* force the next check to be a full check/rebuild */
 void camel_local_summary_check_force (CamelLocalSummary *cls);
 
+/* index content later, from the folder's index queue, instead of while summarising */
+void camel_local_summary_set_index_deferred (CamelLocalSummary *cls, gboolean index_deferred);
+gboolean camel_local_summary_get_index_deferred (CamelLocalSummary *cls);
+/* queue an added message for indexing, if its content was not indexed */
+void camel_local_summary_queue_index (CamelLocalSummary *cls, CamelMessageInfo *info);
+/* store the newly queued messages to the index queue, or read the queue back */
+gint camel_local_summary_save_index_queue (CamelLocalSummary *cls, GError **error);
+gint camel_local_summary_load_index_queue (CamelLocalSummary *cls, GError **error);
+/* messages not indexed yet, NULL when there are none */
+guint camel_local_summary_count_index_pending (CamelLocalSummary *cls);
+GHashTable *camel_local_summary_dup_index_pending (CamelLocalSummary *cls);
+/* index the content of a queued message, then commit the index and dequeue the messages */
+void camel_local_summary_index_message (CamelLocalSummary *cls, const gchar *uid, CamelMimeMessage *message, GCancellable *cancellable);
+gint camel_local_summary_index_done (CamelLocalSummary *cls, GPtrArray *uids, GError **error);
+
 /* generate an X-Evolution header line */
 gchar *camel_local_summary_encode_x_evolution (CamelLocalSummary *cls, const CamelMessageInfo *info);
 gint camel_local_summary_decode_x_evolution (CamelLocalSummary *cls, const gchar *xev, CamelMessageInfo *info);
@@ -250,6 +250,8 @@ maildir_folder_append_message_sync (CamelFolder *folder,
 		camel_folder_change_info_clear (lf->changes);
 	}
 
+	camel_local_folder_schedule_index (lf);
+
 	g_clear_object (&mi);
 
 	return success;
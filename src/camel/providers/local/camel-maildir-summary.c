@@ -33,6 +33,10 @@
 #include <winsock2.h>
 #endif
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 
@@ -47,9 +51,17 @@
 
 #define CAMEL_MAILDIR_SUMMARY_VERSION (0x2000)
 
+/* version of the directories state, stored in the summary header */
+#define CAMEL_MAILDIR_SUMMARY_DIRS_VERSION (1)
+
 static CamelMessageInfo *
 		message_info_new_from_headers	(CamelFolderSummary *,
 						 const CamelNameValueArray *);
+static gboolean	summary_header_load		(CamelFolderSummary *,
+						 CamelFIRecord *);
+static CamelFIRecord *
+		summary_header_save		(CamelFolderSummary *,
+						 GError **error);
 static gint	maildir_summary_load		(CamelLocalSummary *cls,
 						 gint forceindex,
 						 GError **error);
@@ -86,12 +98,33 @@ struct _CamelMaildirSummaryPrivate {
 
 	GHashTable *load_map;
 	GMutex summary_lock;
+
+	/* state of cur/ and new/ after the last consistency check, stored
+	 * in the summary; a zero mtime means the state is not known */
+	gint64 cur_mtime;
+	gint64 new_mtime;
+	guint32 checked_count;
+	guint32 check_generation;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	/* guarded by the maildir_watch_lock */
+	gboolean watching;	/* whether cur/ and new/ are watched */
+	gint cur_wd;
+	gint new_wd;
+	GPtrArray *watch_events;	/* MaildirWatchEvent *, not read by the check yet */
+	gboolean watch_overflow;	/* some events were lost */
+#endif
 };
 
 struct _CamelMaildirMessageContentInfo {
 	CamelMessageContentInfo info;
 };
 
+#ifdef HAVE_SYS_INOTIFY_H
+static void	maildir_watch_event_free	(gpointer ptr);
+static void	maildir_summary_unwatch		(CamelMaildirSummary *mds);
+#endif
+
 G_DEFINE_TYPE (
 	CamelMaildirSummary,
 	camel_maildir_summary,
@@ -107,6 +140,11 @@ maildir_summary_finalize (GObject *object)
 	g_free (priv->hostname);
 	g_mutex_clear (&priv->summary_lock);
 
+#ifdef HAVE_SYS_INOTIFY_H
+	maildir_summary_unwatch (CAMEL_MAILDIR_SUMMARY (object));
+	g_ptr_array_free (priv->watch_events, TRUE);
+#endif
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_maildir_summary_parent_class)->finalize (object);
 }
@@ -129,6 +167,8 @@ camel_maildir_summary_class_init (CamelMaildirSummaryClass *class)
 	folder_summary_class->collate = NULL;
 	folder_summary_class->message_info_new_from_headers = message_info_new_from_headers;
 	folder_summary_class->next_uid_string = maildir_summary_next_uid_string;
+	folder_summary_class->summary_header_load = summary_header_load;
+	folder_summary_class->summary_header_save = summary_header_save;
 
 	local_summary_class = CAMEL_LOCAL_SUMMARY_CLASS (class);
 	local_summary_class->load = maildir_summary_load;
@@ -159,6 +199,12 @@ camel_maildir_summary_init (CamelMaildirSummary *maildir_summary)
 		maildir_summary->priv->hostname = g_strdup ("localhost");
 	}
 	g_mutex_init (&maildir_summary->priv->summary_lock);
+
+#ifdef HAVE_SYS_INOTIFY_H
+	maildir_summary->priv->cur_wd = -1;
+	maildir_summary->priv->new_wd = -1;
+	maildir_summary->priv->watch_events = g_ptr_array_new_with_free_func (maildir_watch_event_free);
+#endif
 }
 
 /**
@@ -189,6 +235,51 @@ camel_maildir_summary_new (struct _CamelFolder *folder,
 	return o;
 }
 
+static gboolean
+summary_header_load (CamelFolderSummary *s,
+                     CamelFIRecord *fir)
+{
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (s);
+	gchar *part;
+
+	if (!CAMEL_FOLDER_SUMMARY_CLASS (camel_maildir_summary_parent_class)->summary_header_load (s, fir))
+		return FALSE;
+
+	part = fir->bdata;
+	if (part && camel_util_bdata_get_number (&part, 0) == CAMEL_MAILDIR_SUMMARY_DIRS_VERSION) {
+		mds->priv->cur_mtime = camel_util_bdata_get_number (&part, 0);
+		mds->priv->new_mtime = camel_util_bdata_get_number (&part, 0);
+		mds->priv->checked_count = camel_util_bdata_get_number (&part, 0);
+		mds->priv->check_generation = camel_util_bdata_get_number (&part, 0);
+	}
+
+	return TRUE;
+}
+
+static CamelFIRecord *
+summary_header_save (CamelFolderSummary *s,
+                     GError **error)
+{
+	CamelFolderSummaryClass *folder_summary_class;
+	CamelMaildirSummary *mds = CAMEL_MAILDIR_SUMMARY (s);
+	CamelFIRecord *fir;
+	gchar *tmp;
+
+	/* Chain up to parent's summary_header_save() method. */
+	folder_summary_class = CAMEL_FOLDER_SUMMARY_CLASS (camel_maildir_summary_parent_class);
+	fir = folder_summary_class->summary_header_save (s, error);
+	if (fir) {
+		tmp = fir->bdata;
+		fir->bdata = g_strdup_printf ("%s %d %" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %u %u",
+			tmp ? tmp : "", CAMEL_MAILDIR_SUMMARY_DIRS_VERSION,
+			mds->priv->cur_mtime, mds->priv->new_mtime,
+			mds->priv->checked_count, mds->priv->check_generation);
+		g_free (tmp);
+	}
+
+	return fir;
+}
+
 /* the 'standard' maildir flags.  should be defined in sorted order. */
 static struct {
 	gchar flag;
@@ -530,6 +621,7 @@ camel_maildir_summary_add (CamelLocalSummary *cls,
 
 	info = camel_folder_summary_info_new_from_parser (summary, mp);
 	camel_folder_summary_add (summary, info, FALSE);
+	camel_local_summary_queue_index (cls, info);
 	g_clear_object (&info);
 
 	g_object_unref (mp);
@@ -559,10 +651,11 @@ remove_summary (const gchar *uid,
 }
 
 static gint
-maildir_summary_check (CamelLocalSummary *cls,
-                       CamelFolderChangeInfo *changes,
-                       GCancellable *cancellable,
-                       GError **error)
+maildir_summary_check_cur (CamelLocalSummary *cls,
+                           CamelFolderChangeInfo *changes,
+                           gint forceindex,
+                           GCancellable *cancellable,
+                           GError **error)
 {
 	DIR *dir;
 	struct dirent *d;
@@ -570,22 +663,13 @@ maildir_summary_check (CamelLocalSummary *cls,
 	CamelFolderSummary *s = (CamelFolderSummary *) cls;
 	GHashTable *left;
 	gint i, count, total;
-	gint forceindex;
-	gchar *new, *cur;
+	gchar *cur;
 	gchar *uid;
 	struct _remove_data rd = { cls, changes, NULL };
 	GPtrArray *known_uids;
 
-	g_mutex_lock (&((CamelMaildirSummary *) cls)->priv->summary_lock);
-
-	new = g_strdup_printf ("%s/new", cls->folder_path);
 	cur = g_strdup_printf ("%s/cur", cls->folder_path);
 
-	d (printf ("checking summary ...\n"));
-
-	camel_operation_push_message (
-		cancellable, _("Checking folder consistency"));
-
 	/* scan the directory, check for mail files not in the index, or index entries that
 	 * no longer exist */
 	dir = opendir (cur);
@@ -596,16 +680,12 @@ maildir_summary_check (CamelLocalSummary *cls,
 			_("Cannot open maildir directory path: %s: %s"),
 			cls->folder_path, g_strerror (errno));
 		g_free (cur);
-		g_free (new);
-		camel_operation_pop_message (cancellable);
-		g_mutex_unlock (&((CamelMaildirSummary *) cls)->priv->summary_lock);
 		return -1;
 	}
 
 	/* keeps track of all uid's that have not been processed */
 	left = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
 	known_uids = camel_folder_summary_get_array (s);
-	forceindex = !known_uids || known_uids->len == 0;
 	for (i = 0; known_uids && i < known_uids->len; i++) {
 		const gchar *uid = g_ptr_array_index (known_uids, i);
 		guint32 flags;
@@ -616,23 +696,16 @@ maildir_summary_check (CamelLocalSummary *cls,
 		}
 	}
 
-	/* joy, use this to pre-count the total, so we can report progress meaningfully */
-	total = 0;
+	/* the known messages are the estimate of the total, for the progress */
+	total = known_uids ? known_uids->len : 0;
 	count = 0;
-	while (readdir (dir))
-		total++;
-	rewinddir (dir);
 
 	while ((d = readdir (dir))) {
 		guint32 stored_flags = 0;
 		gint pc;
 
-		/* Avoid a potential division by zero if the first loop
-		 * (to calculate total) is executed on an empty
-		 * directory, then the directory is populated before
-		 * this loop is executed. */
 		total = MAX (total, count + 1);
-		pc = (total > 0) ? count * 100 / total : 0;
+		pc = count * 100 / total;
 
 		camel_operation_progress (cancellable, pc);
 		count++;
@@ -703,12 +776,29 @@ maildir_summary_check (CamelLocalSummary *cls,
 	/* Destroy the hash table only after the removed_uids GList is freed, because it has borrowed the UIDs */
 	g_hash_table_destroy (left);
 
-	camel_operation_pop_message (cancellable);
+	camel_folder_summary_free_array (known_uids);
+	g_free (cur);
+
+	return 0;
+}
+
+/* scans new for new messages, and copies them to cur, and so forth;
+ * the new is usually small, thus it's fine to pre-count it */
+static void
+maildir_summary_check_new (CamelLocalSummary *cls,
+                           CamelFolderChangeInfo *changes,
+                           gint forceindex,
+                           GCancellable *cancellable)
+{
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	DIR *dir;
+	struct dirent *d;
+	gchar *new, *cur;
+	gint count, total;
 
-	camel_operation_push_message (
-		cancellable, _("Checking for new messages"));
+	new = g_strdup_printf ("%s/new", cls->folder_path);
+	cur = g_strdup_printf ("%s/cur", cls->folder_path);
 
-	/* now, scan new for new messages, and copy them to cur, and so forth */
 	dir = opendir (new);
 	if (dir != NULL) {
 		total = 0;
@@ -773,17 +863,463 @@ maildir_summary_check (CamelLocalSummary *cls,
 			g_free (dest);
 		}
 
-		camel_operation_pop_message (cancellable);
 		closedir (dir);
 	}
 
 	g_free (new);
 	g_free (cur);
+}
 
-	camel_folder_summary_free_array (known_uids);
-	g_mutex_unlock (&((CamelMaildirSummary *) cls)->priv->summary_lock);
+#ifdef HAVE_SYS_INOTIFY_H
+#define MAILDIR_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
 
-	return 0;
+/* events queued for a summary, which did not check its folder yet;
+ * more of them are dropped and the folder is scanned instead */
+#define MAILDIR_WATCH_MAX_EVENTS (16384)
+
+/* All the maildir summaries of the process share one inotify instance,
+ * because the instances per user are limited to very few by default,
+ * and add their watches to it. The events are read by whichever summary
+ * checks its folder first, which queues them for their summaries. */
+static GMutex maildir_watch_lock;
+static gint maildir_watch_fd = -1;
+static GHashTable *maildir_watch_summaries;	/* gint wd ~> GSList * of CamelMaildirSummary * */
+
+typedef struct _MaildirWatchEvent {
+	gint wd;
+	guint32 mask;
+	gchar *name;
+} MaildirWatchEvent;
+
+static void
+maildir_watch_event_free (gpointer ptr)
+{
+	MaildirWatchEvent *event = ptr;
+
+	if (event) {
+		g_free (event->name);
+		g_free (event);
+	}
+}
+
+static gint
+maildir_watch_add_locked (CamelMaildirSummary *mds,
+                          const gchar *subdir)
+{
+	CamelLocalSummary *cls = (CamelLocalSummary *) mds;
+	GSList *summaries;
+	gchar *path;
+	gint wd;
+
+	path = g_strdup_printf ("%s/%s", cls->folder_path, subdir);
+	wd = inotify_add_watch (maildir_watch_fd, path, MAILDIR_WATCH_MASK);
+	g_free (path);
+
+	if (wd == -1)
+		return -1;
+
+	/* the same directory has the same watch, even for another summary */
+	summaries = g_hash_table_lookup (maildir_watch_summaries, GINT_TO_POINTER (wd));
+	if (!g_slist_find (summaries, mds))
+		g_hash_table_insert (maildir_watch_summaries, GINT_TO_POINTER (wd), g_slist_prepend (summaries, mds));
+
+	return wd;
+}
+
+static void
+maildir_watch_remove_locked (CamelMaildirSummary *mds,
+                             gint wd)
+{
+	GSList *summaries;
+
+	if (wd == -1)
+		return;
+
+	summaries = g_hash_table_lookup (maildir_watch_summaries, GINT_TO_POINTER (wd));
+	summaries = g_slist_remove (summaries, mds);
+
+	if (summaries) {
+		g_hash_table_insert (maildir_watch_summaries, GINT_TO_POINTER (wd), summaries);
+	} else {
+		g_hash_table_remove (maildir_watch_summaries, GINT_TO_POINTER (wd));
+		inotify_rm_watch (maildir_watch_fd, wd);
+	}
+}
+
+static void
+maildir_summary_unwatch_locked (CamelMaildirSummary *mds)
+{
+	maildir_watch_remove_locked (mds, mds->priv->cur_wd);
+	maildir_watch_remove_locked (mds, mds->priv->new_wd);
+
+	mds->priv->cur_wd = -1;
+	mds->priv->new_wd = -1;
+	mds->priv->watching = FALSE;
+	mds->priv->watch_overflow = FALSE;
+	g_ptr_array_set_size (mds->priv->watch_events, 0);
+
+	/* no instance is kept, when no folder is watched */
+	if (maildir_watch_fd != -1 && !g_hash_table_size (maildir_watch_summaries)) {
+		close (maildir_watch_fd);
+		maildir_watch_fd = -1;
+	}
+}
+
+static void
+maildir_summary_unwatch (CamelMaildirSummary *mds)
+{
+	g_mutex_lock (&maildir_watch_lock);
+	if (mds->priv->watching)
+		maildir_summary_unwatch_locked (mds);
+	g_mutex_unlock (&maildir_watch_lock);
+}
+
+/* Starts to watch cur/ and new/, thus the next checks can apply only the changes */
+static void
+maildir_summary_watch (CamelMaildirSummary *mds)
+{
+	g_mutex_lock (&maildir_watch_lock);
+
+	if (mds->priv->watching) {
+		g_mutex_unlock (&maildir_watch_lock);
+		return;
+	}
+
+	if (!maildir_watch_summaries)
+		maildir_watch_summaries = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	if (maildir_watch_fd == -1)
+		maildir_watch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+	if (maildir_watch_fd != -1) {
+		mds->priv->watching = TRUE;
+		mds->priv->cur_wd = maildir_watch_add_locked (mds, "cur");
+		mds->priv->new_wd = maildir_watch_add_locked (mds, "new");
+
+		/* out of watches, most likely; the directories will be scanned */
+		if (mds->priv->cur_wd == -1 || mds->priv->new_wd == -1)
+			maildir_summary_unwatch_locked (mds);
+	}
+
+	g_mutex_unlock (&maildir_watch_lock);
+}
+
+static void
+maildir_watch_overflow_cb (gpointer key,
+                           gpointer value,
+                           gpointer user_data)
+{
+	GSList *link;
+
+	for (link = value; link; link = g_slist_next (link)) {
+		CamelMaildirSummary *mds = link->data;
+
+		mds->priv->watch_overflow = TRUE;
+		g_ptr_array_set_size (mds->priv->watch_events, 0);
+	}
+}
+
+/* Reads the pending events of all the watched folders and queues
+ * them for the summaries, which watch the directories */
+static void
+maildir_watch_dispatch_locked (void)
+{
+	gchar buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	gssize len;
+
+	while ((len = read (maildir_watch_fd, buffer, sizeof (buffer))) > 0) {
+		const gchar *ptr;
+
+		for (ptr = buffer; ptr < buffer + len; ptr += sizeof (struct inotify_event) + ((const struct inotify_event *) ptr)->len) {
+			const struct inotify_event *event = (const struct inotify_event *) ptr;
+			GSList *link;
+
+			/* lost events of any of the folders */
+			if ((event->mask & IN_Q_OVERFLOW) != 0) {
+				g_hash_table_foreach (maildir_watch_summaries, maildir_watch_overflow_cb, NULL);
+				continue;
+			}
+
+			link = g_hash_table_lookup (maildir_watch_summaries, GINT_TO_POINTER (event->wd));
+			for (; link; link = g_slist_next (link)) {
+				CamelMaildirSummary *mds = link->data;
+				MaildirWatchEvent *copy;
+
+				if (mds->priv->watch_overflow)
+					continue;
+
+				if (mds->priv->watch_events->len >= MAILDIR_WATCH_MAX_EVENTS) {
+					mds->priv->watch_overflow = TRUE;
+					g_ptr_array_set_size (mds->priv->watch_events, 0);
+					continue;
+				}
+
+				copy = g_new0 (MaildirWatchEvent, 1);
+				copy->wd = event->wd;
+				copy->mask = event->mask;
+				copy->name = event->len ? g_strdup (event->name) : NULL;
+
+				g_ptr_array_add (mds->priv->watch_events, copy);
+			}
+		}
+	}
+
+	if (len == -1 && errno != EAGAIN && errno != EINTR)
+		g_hash_table_foreach (maildir_watch_summaries, maildir_watch_overflow_cb, NULL);
+}
+
+/* Reads the pending events; the @cur_changes maps uid ~> the last created
+ * file name of it in cur/, or NULL when its files were only removed.
+ * Returns FALSE when the events cannot be used, thus a full scan is needed. */
+static gboolean
+maildir_summary_read_events (CamelMaildirSummary *mds,
+                             GHashTable *cur_changes,
+                             gboolean *out_new_changed)
+{
+	GPtrArray *events;
+	gboolean usable;
+	guint ii;
+
+	g_mutex_lock (&maildir_watch_lock);
+
+	maildir_watch_dispatch_locked ();
+
+	events = mds->priv->watch_events;
+	mds->priv->watch_events = g_ptr_array_new_with_free_func (maildir_watch_event_free);
+	usable = !mds->priv->watch_overflow;
+	mds->priv->watch_overflow = FALSE;
+
+	g_mutex_unlock (&maildir_watch_lock);
+
+	for (ii = 0; ii < events->len && usable; ii++) {
+		const MaildirWatchEvent *event = events->pdata[ii];
+		const gchar *sep;
+		gchar *uid;
+
+		if ((event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) != 0) {
+			usable = FALSE;
+			continue;
+		}
+
+		if (!event->name || event->name[0] == '.')
+			continue;
+
+		if (event->wd == mds->priv->new_wd) {
+			if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+				*out_new_changed = TRUE;
+			continue;
+		}
+
+		if (event->wd != mds->priv->cur_wd)
+			continue;
+
+		sep = strchr (event->name, CAMEL_MAILDIR_FLAG_SEP);
+		uid = sep ? g_strndup (event->name, sep - event->name) : g_strdup (event->name);
+
+		if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+			g_hash_table_insert (cur_changes, uid, g_strdup (event->name));
+		} else {
+			const gchar *last_name = g_hash_table_lookup (cur_changes, uid);
+
+			/* a removed file, which is not the last created one, is not interesting */
+			if (!last_name || g_strcmp0 (last_name, event->name) == 0)
+				g_hash_table_insert (cur_changes, uid, NULL);
+			else
+				g_free (uid);
+		}
+	}
+
+	g_ptr_array_free (events, TRUE);
+
+	return usable;
+}
+
+/* Applies the changes of cur/ files, as read from the inotify events */
+static void
+maildir_summary_apply_cur_changes (CamelLocalSummary *cls,
+                                   GHashTable *cur_changes,
+                                   CamelFolderChangeInfo *changes,
+                                   GCancellable *cancellable)
+{
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	GHashTableIter iter;
+	gpointer key, value;
+	GList *removed_uids = NULL;
+
+	g_hash_table_iter_init (&iter, cur_changes);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *uid = key, *name = value;
+		CamelMessageInfo *info;
+		gchar *filename;
+		struct stat st;
+
+		/* could be removed again, by an event not read yet */
+		if (name) {
+			filename = g_strdup_printf ("%s/cur/%s", cls->folder_path, name);
+			if (g_stat (filename, &st) == -1)
+				name = NULL;
+			g_free (filename);
+		}
+
+		if (!camel_folder_summary_check_uid (s, uid)) {
+			if (name && camel_maildir_summary_add (cls, name, FALSE, cancellable) == 0 && changes)
+				camel_folder_change_info_add_uid (changes, uid);
+			continue;
+		}
+
+		info = camel_folder_summary_get (s, uid);
+		if (!info)
+			continue;
+
+		if (name) {
+			/* renamed, like when its flags were changed by another client */
+			if (g_strcmp0 (camel_maildir_message_info_get_filename (CAMEL_MAILDIR_MESSAGE_INFO (info)), name) != 0)
+				camel_maildir_message_info_set_filename (CAMEL_MAILDIR_MESSAGE_INFO (info), name);
+		} else {
+			filename = g_strdup_printf ("%s/cur/%s", cls->folder_path,
+				camel_maildir_message_info_get_filename (CAMEL_MAILDIR_MESSAGE_INFO (info)));
+
+			if (g_stat (filename, &st) == -1 && errno == ENOENT) {
+				d (printf ("removing message %s from summary\n", uid));
+				if (cls->index)
+					camel_index_delete_name (cls->index, uid);
+				if (changes)
+					camel_folder_change_info_remove_uid (changes, uid);
+				removed_uids = g_list_prepend (removed_uids, (gpointer) camel_pstring_strdup (uid));
+			}
+
+			g_free (filename);
+		}
+
+		g_clear_object (&info);
+	}
+
+	if (removed_uids) {
+		camel_folder_summary_remove_uids (s, removed_uids);
+		g_list_free_full (removed_uids, (GDestroyNotify) camel_pstring_free);
+	}
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+static gint64
+maildir_summary_dir_mtime (CamelLocalSummary *cls,
+                           const gchar *subdir,
+                           time_t now)
+{
+	gchar *path;
+	struct stat st;
+	gint64 mtime = 0;
+
+	path = g_strdup_printf ("%s/%s", cls->folder_path, subdir);
+
+	/* a change later in the same second would not change the mtime,
+	 * thus such recent mtime cannot tell that nothing changed */
+	if (g_stat (path, &st) == 0 && st.st_mtime < now)
+		mtime = st.st_mtime;
+
+	g_free (path);
+
+	return mtime;
+}
+
+static gint
+maildir_summary_check (CamelLocalSummary *cls,
+                       CamelFolderChangeInfo *changes,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+	CamelMaildirSummary *mds = (CamelMaildirSummary *) cls;
+	CamelFolderSummary *s = (CamelFolderSummary *) cls;
+	gint64 cur_mtime, new_mtime;
+	gboolean full_scan = TRUE, check_new = TRUE;
+	gint forceindex;
+	time_t now;
+	gint ret = 0;
+#ifdef HAVE_SYS_INOTIFY_H
+	gboolean watching;
+#endif
+
+	g_mutex_lock (&mds->priv->summary_lock);
+
+	d (printf ("checking summary ...\n"));
+
+#ifdef HAVE_SYS_INOTIFY_H
+	/* watch before the stat, thus no change can be missed by both */
+	watching = mds->priv->watching;
+	if (!watching)
+		maildir_summary_watch (mds);
+#endif
+
+	/* stat before reading, thus changes done while reading make
+	 * the directories look changed in the next check */
+	now = time (NULL);
+	cur_mtime = maildir_summary_dir_mtime (cls, "cur", now);
+	new_mtime = maildir_summary_dir_mtime (cls, "new", now);
+
+	forceindex = camel_folder_summary_count (s) == 0;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if (watching) {
+		GHashTable *cur_changes;
+		gboolean new_changed = FALSE;
+
+		cur_changes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+		if (maildir_summary_read_events (mds, cur_changes, &new_changed)) {
+			d (printf ("applying %d changes of cur/ from the watch\n", g_hash_table_size (cur_changes)));
+
+			camel_operation_push_message (
+				cancellable, _("Checking folder consistency"));
+			maildir_summary_apply_cur_changes (cls, cur_changes, changes, cancellable);
+			camel_operation_pop_message (cancellable);
+
+			full_scan = FALSE;
+			check_new = new_changed;
+		} else {
+			/* overflow or the directories were replaced, start over */
+			maildir_summary_unwatch (mds);
+			maildir_summary_watch (mds);
+		}
+
+		g_hash_table_destroy (cur_changes);
+	}
+#endif
+
+	if (full_scan && cur_mtime && cur_mtime == mds->priv->cur_mtime &&
+	    new_mtime && new_mtime == mds->priv->new_mtime &&
+	    camel_folder_summary_count (s) == mds->priv->checked_count) {
+		d (printf ("directories unchanged since the check %u\n", mds->priv->check_generation));
+		full_scan = FALSE;
+		check_new = FALSE;
+	}
+
+	if (full_scan) {
+		camel_operation_push_message (
+			cancellable, _("Checking folder consistency"));
+		ret = maildir_summary_check_cur (cls, changes, forceindex, cancellable, error);
+		camel_operation_pop_message (cancellable);
+
+		/* to have the new state of the directories stored */
+		camel_folder_summary_touch (s);
+	}
+
+	if (ret == 0 && check_new) {
+		camel_operation_push_message (
+			cancellable, _("Checking for new messages"));
+		maildir_summary_check_new (cls, changes, forceindex, cancellable);
+		camel_operation_pop_message (cancellable);
+	}
+
+	if (ret == 0) {
+		mds->priv->cur_mtime = cur_mtime;
+		mds->priv->new_mtime = new_mtime;
+		mds->priv->checked_count = camel_folder_summary_count (s);
+		mds->priv->check_generation++;
+	}
+
+	g_mutex_unlock (&mds->priv->summary_lock);
+
+	return ret;
 }
 
 /* sync the summary with the ondisk files. */
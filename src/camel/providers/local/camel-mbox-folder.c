@@ -245,6 +245,8 @@ mbox_folder_append_message_sync (CamelFolder *folder,
 		camel_folder_change_info_clear (lf->changes);
 	}
 
+	camel_local_folder_schedule_index (lf);
+
 	if (appended_uid)
 		*appended_uid = g_strdup(camel_message_info_get_uid(mi));
 
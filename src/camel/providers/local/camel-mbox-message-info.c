@@ -26,11 +26,15 @@
 
 struct _CamelMboxMessageInfoPrivate {
 	goffset offset;
+	goffset xev_offset;
+	guint xev_length;
 };
 
 enum {
 	PROP_0,
-	PROP_OFFSET
+	PROP_OFFSET,
+	PROP_XEV_OFFSET,
+	PROP_XEV_LENGTH
 };
 
 G_DEFINE_TYPE (CamelMboxMessageInfo, camel_mbox_message_info, CAMEL_TYPE_MESSAGE_INFO_BASE)
@@ -54,6 +58,8 @@ mbox_message_info_clone (const CamelMessageInfo *mi,
 		mmi_result = CAMEL_MBOX_MESSAGE_INFO (result);
 
 		camel_mbox_message_info_set_offset (mmi_result, camel_mbox_message_info_get_offset (mmi));
+		camel_mbox_message_info_set_xev_offset (mmi_result, camel_mbox_message_info_get_xev_offset (mmi));
+		camel_mbox_message_info_set_xev_length (mmi_result, camel_mbox_message_info_get_xev_length (mmi));
 	}
 
 	return result;
@@ -65,7 +71,7 @@ mbox_message_info_load (CamelMessageInfo *mi,
 			/* const */ gchar **bdata_ptr)
 {
 	CamelMboxMessageInfo *mmi;
-	gint64 offset;
+	gint64 offset, xev_offset, xev_length;
 
 	g_return_val_if_fail (CAMEL_IS_MBOX_MESSAGE_INFO (mi), FALSE);
 	g_return_val_if_fail (record != NULL, FALSE);
@@ -83,6 +89,18 @@ mbox_message_info_load (CamelMessageInfo *mi,
 
 	camel_mbox_message_info_set_offset (mmi, offset);
 
+	/* Records saved by older versions do not have the X-Evolution
+	   header position; the quick sync locates it with a parser then. */
+	xev_offset = camel_util_bdata_get_number (bdata_ptr, -1);
+	xev_length = camel_util_bdata_get_number (bdata_ptr, 0);
+	if (xev_offset < 0 || xev_length <= 0 || xev_length > G_MAXUINT) {
+		xev_offset = -1;
+		xev_length = 0;
+	}
+
+	camel_mbox_message_info_set_xev_offset (mmi, xev_offset);
+	camel_mbox_message_info_set_xev_length (mmi, (guint) xev_length);
+
 	return TRUE;
 }
 
@@ -104,6 +122,8 @@ mbox_message_info_save (const CamelMessageInfo *mi,
 	mmi = CAMEL_MBOX_MESSAGE_INFO (mi);
 
 	camel_util_bdata_put_number (bdata_str, camel_mbox_message_info_get_offset (mmi));
+	camel_util_bdata_put_number (bdata_str, camel_mbox_message_info_get_xev_offset (mmi));
+	camel_util_bdata_put_number (bdata_str, camel_mbox_message_info_get_xev_length (mmi));
 
 	return TRUE;
 }
@@ -143,6 +163,14 @@ mbox_message_info_set_property (GObject *object,
 	case PROP_OFFSET:
 		camel_mbox_message_info_set_offset (mmi, g_value_get_int64 (value));
 		return;
+
+	case PROP_XEV_OFFSET:
+		camel_mbox_message_info_set_xev_offset (mmi, g_value_get_int64 (value));
+		return;
+
+	case PROP_XEV_LENGTH:
+		camel_mbox_message_info_set_xev_length (mmi, g_value_get_uint (value));
+		return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -160,6 +188,14 @@ mbox_message_info_get_property (GObject *object,
 	case PROP_OFFSET:
 		g_value_set_int64 (value, camel_mbox_message_info_get_offset (mmi));
 		return;
+
+	case PROP_XEV_OFFSET:
+		g_value_set_int64 (value, camel_mbox_message_info_get_xev_offset (mmi));
+		return;
+
+	case PROP_XEV_LENGTH:
+		g_value_set_uint (value, camel_mbox_message_info_get_xev_length (mmi));
+		return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -199,12 +235,49 @@ camel_mbox_message_info_class_init (CamelMboxMessageInfoClass *class)
 			NULL,
 			0, G_MAXINT64, 0,
 			G_PARAM_READWRITE));
+
+	/**
+	 * CamelMboxMessageInfo:xev-offset
+	 *
+	 * Offset in the file to the value of the message's X-Evolution header,
+	 * or -1, when not known.
+	 *
+	 * Since: 3.28
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_XEV_OFFSET,
+		g_param_spec_int64 (
+			"xev-offset",
+			"X-Evolution Offset",
+			NULL,
+			-1, G_MAXINT64, -1,
+			G_PARAM_READWRITE));
+
+	/**
+	 * CamelMboxMessageInfo:xev-length
+	 *
+	 * Length of the value of the message's X-Evolution header in the file,
+	 * or 0, when not known.
+	 *
+	 * Since: 3.28
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_XEV_LENGTH,
+		g_param_spec_uint (
+			"xev-length",
+			"X-Evolution Length",
+			NULL,
+			0, G_MAXUINT, 0,
+			G_PARAM_READWRITE));
 }
 
 static void
 camel_mbox_message_info_init (CamelMboxMessageInfo *mmi)
 {
 	mmi->priv = G_TYPE_INSTANCE_GET_PRIVATE (mmi, CAMEL_TYPE_MBOX_MESSAGE_INFO, CamelMboxMessageInfoPrivate);
+	mmi->priv->xev_offset = -1;
 }
 
 goffset
@@ -251,3 +324,135 @@ camel_mbox_message_info_set_offset (CamelMboxMessageInfo *mmi,
 
 	return changed;
 }
+
+/**
+ * camel_mbox_message_info_get_xev_offset:
+ * @mmi: a #CamelMboxMessageInfo
+ *
+ * Returns: Offset in the file to the value of the X-Evolution header
+ *    of the message, or -1, when not known
+ *
+ * Since: 3.28
+ **/
+goffset
+camel_mbox_message_info_get_xev_offset (const CamelMboxMessageInfo *mmi)
+{
+	CamelMessageInfo *mi;
+	goffset result;
+
+	g_return_val_if_fail (CAMEL_IS_MBOX_MESSAGE_INFO (mmi), -1);
+
+	mi = CAMEL_MESSAGE_INFO (mmi);
+
+	camel_message_info_property_lock (mi);
+	result = mmi->priv->xev_offset;
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+/**
+ * camel_mbox_message_info_set_xev_offset:
+ * @mmi: a #CamelMboxMessageInfo
+ * @xev_offset: offset of the X-Evolution header value, or -1
+ *
+ * Sets the offset in the file to the value of the X-Evolution header
+ * of the message, as used by the quick sync to rewrite it in place.
+ *
+ * Returns: Whether the value changed
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_mbox_message_info_set_xev_offset (CamelMboxMessageInfo *mmi,
+					goffset xev_offset)
+{
+	CamelMessageInfo *mi;
+	gboolean changed;
+
+	g_return_val_if_fail (CAMEL_IS_MBOX_MESSAGE_INFO (mmi), FALSE);
+
+	mi = CAMEL_MESSAGE_INFO (mmi);
+
+	camel_message_info_property_lock (mi);
+
+	changed = mmi->priv->xev_offset != xev_offset;
+
+	if (changed)
+		mmi->priv->xev_offset = xev_offset;
+
+	camel_message_info_property_unlock (mi);
+
+	if (changed && !camel_message_info_get_abort_notifications (mi)) {
+		g_object_notify (G_OBJECT (mmi), "xev-offset");
+		camel_message_info_set_dirty (mi, TRUE);
+	}
+
+	return changed;
+}
+
+/**
+ * camel_mbox_message_info_get_xev_length:
+ * @mmi: a #CamelMboxMessageInfo
+ *
+ * Returns: Length of the value of the X-Evolution header of the message
+ *    in the file, or 0, when not known
+ *
+ * Since: 3.28
+ **/
+guint
+camel_mbox_message_info_get_xev_length (const CamelMboxMessageInfo *mmi)
+{
+	CamelMessageInfo *mi;
+	guint result;
+
+	g_return_val_if_fail (CAMEL_IS_MBOX_MESSAGE_INFO (mmi), 0);
+
+	mi = CAMEL_MESSAGE_INFO (mmi);
+
+	camel_message_info_property_lock (mi);
+	result = mmi->priv->xev_length;
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+/**
+ * camel_mbox_message_info_set_xev_length:
+ * @mmi: a #CamelMboxMessageInfo
+ * @xev_length: length of the X-Evolution header value, or 0
+ *
+ * Sets the length of the value of the X-Evolution header of the message
+ * in the file. See camel_mbox_message_info_set_xev_offset().
+ *
+ * Returns: Whether the value changed
+ *
+ * Since: 3.28
+ **/
+gboolean
+camel_mbox_message_info_set_xev_length (CamelMboxMessageInfo *mmi,
+					guint xev_length)
+{
+	CamelMessageInfo *mi;
+	gboolean changed;
+
+	g_return_val_if_fail (CAMEL_IS_MBOX_MESSAGE_INFO (mmi), FALSE);
+
+	mi = CAMEL_MESSAGE_INFO (mmi);
+
+	camel_message_info_property_lock (mi);
+
+	changed = mmi->priv->xev_length != xev_length;
+
+	if (changed)
+		mmi->priv->xev_length = xev_length;
+
+	camel_message_info_property_unlock (mi);
+
+	if (changed && !camel_message_info_get_abort_notifications (mi)) {
+		g_object_notify (G_OBJECT (mmi), "xev-length");
+		camel_message_info_set_dirty (mi, TRUE);
+	}
+
+	return changed;
+}
@@ -64,6 +64,16 @@ GType		camel_mbox_message_info_get_type	(void);
 goffset		camel_mbox_message_info_get_offset	(const CamelMboxMessageInfo *mmi);
 gboolean	camel_mbox_message_info_set_offset	(CamelMboxMessageInfo *mmi,
 							 goffset offset);
+goffset		camel_mbox_message_info_get_xev_offset
+							(const CamelMboxMessageInfo *mmi);
+gboolean	camel_mbox_message_info_set_xev_offset
+							(CamelMboxMessageInfo *mmi,
+							 goffset xev_offset);
+guint		camel_mbox_message_info_get_xev_length
+							(const CamelMboxMessageInfo *mmi);
+gboolean	camel_mbox_message_info_set_xev_length
+							(CamelMboxMessageInfo *mmi,
+							 guint xev_length);
 
 G_END_DECLS
 
@@ -42,6 +42,11 @@
 
 #define CAMEL_MBOX_SUMMARY_VERSION (1)
 
+/* Quick sync rewrites X-Evolution headers closer than this to each other
+ * with a single read and write of the whole range between them */
+#define XEV_PATCH_MAX_GAP (4096)
+#define XEV_PATCH_MAX_RANGE (1024 * 1024)
+
 #define CHECK_CALL(x) G_STMT_START { \
 	if ((x) == -1) { \
 		g_debug ("%s: Call of '" #x "' failed: %s", G_STRFUNC, g_strerror (errno)); \
@@ -84,6 +89,8 @@ static CamelMessageInfo *
 						 const CamelMessageInfo *info,
 						 CamelFolderChangeInfo *ci,
 						 GError **error);
+static goffset	mbox_summary_index_offset	(CamelLocalSummary *cls,
+						 CamelMessageInfo *info);
 static gint	mbox_summary_sync_quick		(CamelMboxSummary *cls,
 						 gboolean expunge,
 						 CamelFolderChangeInfo *changeinfo,
@@ -128,6 +135,7 @@ camel_mbox_summary_class_init (CamelMboxSummaryClass *class)
 	local_summary_class->check = mbox_summary_check;
 	local_summary_class->sync = mbox_summary_sync;
 	local_summary_class->add = mbox_summary_add;
+	local_summary_class->index_offset = mbox_summary_index_offset;
 
 	class->sync_quick = mbox_summary_sync_quick;
 	class->sync_full = mbox_summary_sync_full;
@@ -324,6 +332,38 @@ message_info_new_from_headers (CamelFolderSummary *summary,
 	return (CamelMessageInfo *) mi;
 }
 
+/* Remembers where the value of the X-Evolution header of the message
+ * the parser is at lies in the file, so it can be rewritten in place */
+static void
+mbox_summary_update_xev_range (CamelLocalSummary *cls,
+                               CamelMessageInfo *mi,
+                               CamelMimeParser *mp)
+{
+	CamelMboxMessageInfo *mmi = CAMEL_MBOX_MESSAGE_INFO (mi);
+	const gchar *xev;
+	goffset xevoffset = -1;
+	guint xevlength = 0;
+	gint offset = 0;
+
+	xev = camel_mime_parser_header (mp, "X-Evolution", &offset);
+
+	/* the raw header contains a leading ' ', which is not part of the value;
+	 * folded headers are left for the parser-based sync to deal with */
+	if (xev && *xev == ' ' && !strchr (xev, '\n')
+	    && camel_local_summary_decode_x_evolution (cls, xev, NULL) == 0) {
+		goffset start = camel_mime_parser_tell_start_headers (mp);
+
+		/* the parser reports header offsets as a gint only, which
+		 * wraps in large mboxes; headers follow their start closely */
+		xevoffset = start + (guint32) ((guint32) offset - (guint32) start);
+		xevoffset += strlen ("X-Evolution: ");
+		xevlength = strlen (xev) - 1;
+	}
+
+	camel_mbox_message_info_set_xev_offset (mmi, xevoffset);
+	camel_mbox_message_info_set_xev_length (mmi, xevlength);
+}
+
 static CamelMessageInfo *
 message_info_new_from_parser (CamelFolderSummary *s,
                               CamelMimeParser *mp)
@@ -333,6 +373,7 @@ message_info_new_from_parser (CamelFolderSummary *s,
 	mi = CAMEL_FOLDER_SUMMARY_CLASS (camel_mbox_summary_parent_class)->message_info_new_from_parser (s, mp);
 	if (mi) {
 		camel_mbox_message_info_set_offset (CAMEL_MBOX_MESSAGE_INFO (mi), camel_mime_parser_tell_start_from (mp));
+		mbox_summary_update_xev_range ((CamelLocalSummary *) s, mi, mp);
 	}
 
 	return mi;
@@ -427,6 +468,7 @@ summary_update (CamelLocalSummary *cls,
 
 		info = camel_folder_summary_info_new_from_parser (s, mp);
 		camel_folder_summary_add (s, info, FALSE);
+		camel_local_summary_queue_index (cls, info);
 		g_clear_object (&info);
 
 		g_warn_if_fail (camel_mime_parser_step (mp, NULL, NULL) == CAMEL_MIME_PARSER_STATE_FROM_END);
@@ -714,54 +756,99 @@ cms_sort_frompos (gconstpointer a,
 
 }
 
-/* perform a quick sync - only system flags have changed */
+typedef struct _XevPatch {
+	goffset offset;
+	gchar *value;
+	CamelMessageInfo *info;
+} XevPatch;
+
 static gint
-mbox_summary_sync_quick (CamelMboxSummary *mbs,
-                         gboolean expunge,
-                         CamelFolderChangeInfo *changeinfo,
-                         GCancellable *cancellable,
-                         GError **error)
+xev_patch_compare (gconstpointer a,
+                   gconstpointer b)
 {
-	CamelLocalSummary *cls = (CamelLocalSummary *) mbs;
-	CamelFolderSummary *s = (CamelFolderSummary *) mbs;
-	CamelMimeParser *mp = NULL;
-	gint i;
-	CamelMessageInfo *info = NULL;
-	gint fd = -1, pfd;
-	gchar *xevnew, *xevtmp;
-	const gchar *xev;
-	gint len;
-	goffset lastpos;
-	GPtrArray *summary = NULL;
+	const XevPatch *patch1 = a, *patch2 = b;
 
-	d (printf ("Performing quick summary sync\n"));
+	if (patch1->offset < patch2->offset)
+		return -1;
 
-	camel_operation_push_message (cancellable, _("Storing folder"));
-	camel_folder_summary_lock (s);
+	return patch1->offset > patch2->offset ? 1 : 0;
+}
 
-	fd = g_open (cls->folder_path, O_LARGEFILE | O_RDWR | O_BINARY, 0);
-	if (fd == -1) {
-		camel_folder_summary_unlock (s);
-		g_set_error (
-			error, G_IO_ERROR,
-			g_io_error_from_errno (errno),
-			_("Could not open file: %s: %s"),
-			cls->folder_path, g_strerror (errno));
+static gboolean
+mbox_summary_pread (gint fd,
+                    gchar *buffer,
+                    gsize len,
+                    goffset offset)
+{
+	while (len > 0) {
+		gssize n;
 
-		camel_operation_pop_message (cancellable);
-		return -1;
+#ifdef HAVE_PWRITE
+		n = pread (fd, buffer, len, offset);
+#else
+		n = lseek (fd, offset, SEEK_SET) == (off_t) -1 ? -1 : read (fd, buffer, len);
+#endif
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+
+		buffer += n;
+		offset += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+mbox_summary_pwrite (gint fd,
+                     const gchar *buffer,
+                     gsize len,
+                     goffset offset)
+{
+	while (len > 0) {
+		gssize n;
+
+#ifdef HAVE_PWRITE
+		n = pwrite (fd, buffer, len, offset);
+#else
+		n = lseek (fd, offset, SEEK_SET) == (off_t) -1 ? -1 : write (fd, buffer, len);
+#endif
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+
+		buffer += n;
+		offset += n;
+		len -= n;
 	}
 
+	return TRUE;
+}
+
+/* finds the X-Evolution headers with a parser, for messages
+ * whose summary record doesn't know where they are yet */
+static gint
+mbox_summary_locate_xev (CamelMboxSummary *mbs,
+                         gint fd,
+                         GPtrArray *infos,
+                         GError **error)
+{
+	CamelLocalSummary *cls = (CamelLocalSummary *) mbs;
+	CamelMimeParser *mp;
+	gint pfd;
+	guint i;
+
 	/* need to dup since mime parser closes its fd once it is finalized */
 	pfd = dup (fd);
 	if (pfd == -1) {
-		camel_folder_summary_unlock (s);
 		g_set_error (
 			error, G_IO_ERROR,
 			g_io_error_from_errno (errno),
 			_("Could not store folder: %s"),
 			g_strerror (errno));
-		close (fd);
 		return -1;
 	}
 
@@ -770,30 +857,13 @@ mbox_summary_sync_quick (CamelMboxSummary *mbs,
 	camel_mime_parser_scan_pre_from (mp, TRUE);
 	camel_mime_parser_init_with_fd (mp, pfd);
 
-	/* Sync only the changes */
-	summary = camel_folder_summary_get_changed ((CamelFolderSummary *) mbs);
-	if (summary->len)
-		g_ptr_array_sort_with_data (summary, cms_sort_frompos, mbs);
-
-	for (i = 0; i < summary->len; i++) {
+	for (i = 0; i < infos->len; i++) {
+		CamelMessageInfo *info = infos->pdata[i];
 		goffset frompos;
-		gint xevoffset;
-		gint pc = (i + 1) * 100 / summary->len;
-
-		camel_operation_progress (cancellable, pc);
-
-		info = camel_folder_summary_get (s, summary->pdata[i]);
-
-		d (printf ("Checking message %s %08x\n", camel_message_info_get_uid (info), camel_message_info_get_flags (info)));
-
-		if (!camel_message_info_get_folder_flagged (info)) {
-			g_clear_object (&info);
-			continue;
-		}
 
 		frompos = camel_mbox_message_info_get_offset (CAMEL_MBOX_MESSAGE_INFO (info));
 
-		d (printf ("Updating message %s: %d\n", camel_message_info_get_uid (info), (gint) frompos));
+		d (printf ("Locating X-Evolution of %s: %d\n", camel_message_info_get_uid (info), (gint) frompos));
 
 		camel_mime_parser_seek (mp, frompos, SEEK_SET);
 
@@ -819,45 +889,215 @@ mbox_summary_sync_quick (CamelMboxSummary *mbs,
 			goto error;
 		}
 
-		xev = camel_mime_parser_header (mp, "X-Evolution", &xevoffset);
-		if (xev == NULL || camel_local_summary_decode_x_evolution (cls, xev, NULL) == -1) {
+		mbox_summary_update_xev_range (cls, info, mp);
+		if (camel_mbox_message_info_get_xev_offset (CAMEL_MBOX_MESSAGE_INFO (info)) < 0) {
 			g_warning ("We're supposed to have a valid x-ev header, but we dont");
 			goto error;
 		}
-		xevnew = camel_local_summary_encode_x_evolution (cls, info);
-		/* SIGH: encode_param_list is about the only function which folds headers by itself.
-		 * This should be fixed somehow differently (either parser doesn't fold headers,
-		 * or param_list doesn't, or something */
-		xevtmp = camel_header_unfold (xevnew);
-		/* the raw header contains a leading ' ', so (dis)count that too */
-		if (strlen (xev) - 1 != strlen (xevtmp)) {
-			g_free (xevnew);
-			g_free (xevtmp);
-			g_warning ("Hmm, the xev headers shouldn't have changed size, but they did");
+
+		camel_mime_parser_drop_step (mp);
+		camel_mime_parser_drop_step (mp);
+	}
+
+	g_object_unref (mp);
+
+	return 0;
+
+ error:
+	g_object_unref (mp);
+
+	return -1;
+}
+
+/* writes the new X-Evolution values over the old ones; patches close
+ * to each other are read and written back as one range, after checking
+ * the old values still belong to the same messages */
+static gint
+mbox_summary_write_xev_patches (CamelMboxSummary *mbs,
+                                gint fd,
+                                GArray *patches,
+                                GCancellable *cancellable,
+                                GError **error)
+{
+	GByteArray *buffer;
+	guint first, last, i;
+
+	buffer = g_byte_array_new ();
+
+	for (first = 0; first < patches->len; first = last) {
+		XevPatch *patch = &g_array_index (patches, XevPatch, first);
+		goffset start = patch->offset, end = patch->offset + strlen (patch->value);
+
+		for (last = first + 1; last < patches->len; last++) {
+			XevPatch *next = &g_array_index (patches, XevPatch, last);
+			goffset next_end = next->offset + strlen (next->value);
+
+			if (next->offset < end || next->offset - end > XEV_PATCH_MAX_GAP ||
+			    next_end - start > XEV_PATCH_MAX_RANGE)
+				break;
+
+			end = next_end;
+		}
+
+		camel_operation_progress (cancellable, last * 100 / patches->len);
+
+		g_byte_array_set_size (buffer, end - start);
+		if (!mbox_summary_pread (fd, (gchar *) buffer->data, buffer->len, start)) {
+			g_set_error (
+				error, G_IO_ERROR,
+				g_io_error_from_errno (errno),
+				_("Could not store folder: %s"),
+				g_strerror (errno));
 			goto error;
 		}
-		g_free (xevtmp);
 
-		/* we write out the xevnew string, assuming its been folded identically to the original too! */
+		for (i = first; i < last; i++) {
+			const gchar *dash;
+			gchar *old;
 
-		lastpos = lseek (fd, 0, SEEK_CUR);
-		CHECK_CALL (lseek (fd, xevoffset + strlen ("X-Evolution: "), SEEK_SET));
-		do {
-			len = write (fd, xevnew, strlen (xevnew));
-		} while (len == -1 && errno == EINTR);
+			patch = &g_array_index (patches, XevPatch, i);
+			old = (gchar *) buffer->data + (patch->offset - start);
 
-		if (lastpos != -1 && lseek (fd, lastpos, SEEK_SET) == (off_t) -1) {
-			g_warning (
-				"%s: Failed to rewind file to last position: %s",
-				G_STRFUNC, g_strerror (errno));
+			/* the value is "uid-flags", optionally followed by "; flags=...; tags=..."
+			 * parameters, which can contain dashes too, thus look only before them */
+			dash = patch->value + strcspn (patch->value, ";");
+			while (dash > patch->value && *dash != '-')
+				dash--;
+
+			/* the uid part is not supposed to change; if it did,
+			 * the file changed behind the summary's back */
+			if (*dash != '-' || strncmp (old, patch->value, dash - patch->value + 1) != 0) {
+				g_warning ("Expected X-Evolution header of %s at %" G_GINT64_FORMAT ", but didn't find it",
+					camel_message_info_get_uid (patch->info), (gint64) patch->offset);
+				g_set_error (
+					error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+					_("Summary and folder mismatch, even after a sync"));
+				goto error;
+			}
+
+			memcpy (old, patch->value, strlen (patch->value));
 		}
-		g_free (xevnew);
 
-		camel_mime_parser_drop_step (mp);
-		camel_mime_parser_drop_step (mp);
+		d (printf ("Writing %d X-Evolution headers at %d\n", last - first, (gint) start));
 
-		camel_message_info_set_flags (info, 0xffff, camel_message_info_get_flags (info));
-		g_clear_object (&info);
+		if (!mbox_summary_pwrite (fd, (const gchar *) buffer->data, buffer->len, start)) {
+			g_set_error (
+				error, G_IO_ERROR,
+				g_io_error_from_errno (errno),
+				_("Could not store folder: %s"),
+				g_strerror (errno));
+			goto error;
+		}
+
+		for (i = first; i < last; i++) {
+			patch = &g_array_index (patches, XevPatch, i);
+			camel_message_info_set_flags (patch->info, 0xffff, camel_message_info_get_flags (patch->info));
+		}
+	}
+
+	g_byte_array_unref (buffer);
+
+	return 0;
+
+ error:
+	g_byte_array_unref (buffer);
+
+	return -1;
+}
+
+/* perform a quick sync - only system flags have changed */
+static gint
+mbox_summary_sync_quick (CamelMboxSummary *mbs,
+                         gboolean expunge,
+                         CamelFolderChangeInfo *changeinfo,
+                         GCancellable *cancellable,
+                         GError **error)
+{
+	CamelLocalSummary *cls = (CamelLocalSummary *) mbs;
+	CamelFolderSummary *s = (CamelFolderSummary *) mbs;
+	gint i;
+	CamelMessageInfo *info = NULL;
+	gint fd = -1;
+	GPtrArray *summary = NULL, *infos, *unknown;
+	GArray *patches;
+
+	d (printf ("Performing quick summary sync\n"));
+
+	camel_operation_push_message (cancellable, _("Storing folder"));
+	camel_folder_summary_lock (s);
+
+	fd = g_open (cls->folder_path, O_LARGEFILE | O_RDWR | O_BINARY, 0);
+	if (fd == -1) {
+		camel_folder_summary_unlock (s);
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			_("Could not open file: %s: %s"),
+			cls->folder_path, g_strerror (errno));
+
+		camel_operation_pop_message (cancellable);
+		return -1;
+	}
+
+	infos = g_ptr_array_new_with_free_func (g_object_unref);
+	unknown = g_ptr_array_new ();
+	patches = g_array_new (FALSE, FALSE, sizeof (XevPatch));
+
+	/* Sync only the changes */
+	summary = camel_folder_summary_get_changed ((CamelFolderSummary *) mbs);
+	if (summary->len)
+		g_ptr_array_sort_with_data (summary, cms_sort_frompos, mbs);
+
+	for (i = 0; i < summary->len; i++) {
+		info = camel_folder_summary_get (s, summary->pdata[i]);
+
+		d (printf ("Checking message %s %08x\n", camel_message_info_get_uid (info), camel_message_info_get_flags (info)));
+
+		if (!info || !camel_message_info_get_folder_flagged (info)) {
+			g_clear_object (&info);
+			continue;
+		}
+
+		g_ptr_array_add (infos, info);
+		if (camel_mbox_message_info_get_xev_offset (CAMEL_MBOX_MESSAGE_INFO (info)) < 0)
+			g_ptr_array_add (unknown, info);
+	}
+
+	info = NULL;
+
+	/* messages added since the last full scan do not know where their header is */
+	if (unknown->len > 0 && mbox_summary_locate_xev (mbs, fd, unknown, error) == -1)
+		goto error;
+
+	for (i = 0; i < infos->len; i++) {
+		CamelMboxMessageInfo *mmi = infos->pdata[i];
+		XevPatch patch;
+
+		patch.info = infos->pdata[i];
+		patch.offset = camel_mbox_message_info_get_xev_offset (mmi);
+		patch.value = camel_local_summary_encode_x_evolution (cls, patch.info);
+
+		/* we write out the new value over the old one, which must be of the same size */
+		if (strchr (patch.value, '\n') || strlen (patch.value) != camel_mbox_message_info_get_xev_length (mmi)) {
+			g_free (patch.value);
+			g_warning ("Hmm, the xev headers shouldn't have changed size, but they did");
+			goto error;
+		}
+
+		g_array_append_val (patches, patch);
+	}
+
+	g_array_sort (patches, xev_patch_compare);
+
+	if (patches->len > 0) {
+		if (mbox_summary_write_xev_patches (mbs, fd, patches, cancellable, error) == -1)
+			goto error;
+
+#if defined (HAVE_FDATASYNC)
+		CHECK_CALL (fdatasync (fd));
+#elif defined (HAVE_FSYNC)
+		CHECK_CALL (fsync (fd));
+#endif
 	}
 
 	d (printf ("Closing folders\n"));
@@ -873,22 +1113,28 @@ mbox_summary_sync_quick (CamelMboxSummary *mbs,
 		goto error;
 	}
 
+	for (i = 0; i < patches->len; i++)
+		g_free (g_array_index (patches, XevPatch, i).value);
+	g_array_free (patches, TRUE);
+	g_ptr_array_free (unknown, TRUE);
+	g_ptr_array_unref (infos);
 	g_ptr_array_foreach (summary, (GFunc) camel_pstring_free, NULL);
 	g_ptr_array_free (summary, TRUE);
-	g_object_unref (mp);
 
 	camel_operation_pop_message (cancellable);
 	camel_folder_summary_unlock (s);
 
 	return 0;
  error:
+	for (i = 0; i < patches->len; i++)
+		g_free (g_array_index (patches, XevPatch, i).value);
+	g_array_free (patches, TRUE);
+	g_ptr_array_free (unknown, TRUE);
+	g_ptr_array_unref (infos);
 	g_ptr_array_foreach (summary, (GFunc) camel_pstring_free, NULL);
 	g_ptr_array_free (summary, TRUE);
-	g_object_unref (mp);
 	if (fd != -1)
 		close (fd);
-	if (info)
-		g_clear_object (&info);
 
 	camel_operation_pop_message (cancellable);
 	camel_folder_summary_unlock (s);
@@ -1105,13 +1351,24 @@ camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
 			lastdel = TRUE;
 			touched = TRUE;
 		} else {
+			CamelMboxMessageInfo *mmi = CAMEL_MBOX_MESSAGE_INFO (info);
+			goffset xevoffset;
+
 			/* otherwise, the message is staying, copy its From_ line across */
 #if 0
 			if (i > 0)
 				write (fdout, "\n", 1);
 #endif
+			xevoffset = camel_mbox_message_info_get_xev_offset (mmi);
+			if (xevoffset >= 0)
+				xevoffset -= frompos;
+
 			frompos = lseek (fdout, 0, SEEK_CUR);
-			camel_mbox_message_info_set_offset (CAMEL_MBOX_MESSAGE_INFO (info), frompos);
+			camel_mbox_message_info_set_offset (mmi, frompos);
+
+			/* unchanged headers move along with the message */
+			if (xevoffset >= 0)
+				camel_mbox_message_info_set_xev_offset (mmi, frompos + xevoffset);
 			camel_message_info_set_dirty (info, TRUE);
 			fromline = camel_mime_parser_from_line (mp);
 			d (printf ("Saving %s:%d\n", camel_message_info_get_uid (info), frompos));
@@ -1150,6 +1407,18 @@ camel_mbox_summary_sync_mbox (CamelMboxSummary *cls,
 					g_strerror (errno));
 				goto error;
 			}
+
+			/* the X-Evolution header is the last one written, followed by the blank line */
+			if (!strchr (xevnew, '\n')) {
+				CamelMboxMessageInfo *mmi = CAMEL_MBOX_MESSAGE_INFO (info);
+
+				camel_mbox_message_info_set_xev_offset (mmi,
+					camel_mbox_message_info_get_offset (mmi) + strlen (fromline) + len - 2 - strlen (xevnew));
+				camel_mbox_message_info_set_xev_length (mmi, strlen (xevnew));
+			} else {
+				camel_mbox_message_info_set_xev_offset (CAMEL_MBOX_MESSAGE_INFO (info), -1);
+				camel_mbox_message_info_set_xev_length (CAMEL_MBOX_MESSAGE_INFO (info), 0);
+			}
 			camel_message_info_set_flags (info, 0xffff, camel_message_info_get_flags (info));
 			g_free (xevnew);
 			xevnew = NULL;
@@ -1259,6 +1528,14 @@ mbox_summary_add (CamelLocalSummary *cls,
 	return mi;
 }
 
+/* index the queued messages in the order they are in the mbox file */
+static goffset
+mbox_summary_index_offset (CamelLocalSummary *cls,
+                           CamelMessageInfo *info)
+{
+	return camel_mbox_message_info_get_offset (CAMEL_MBOX_MESSAGE_INFO (info));
+}
+
 static struct {
 	gchar tag;
 	guint32 flag;
@@ -187,6 +187,7 @@ camel_mh_summary_add (CamelLocalSummary *cls,
 
 	info = camel_folder_summary_info_new_from_parser (summary, mp);
 	camel_folder_summary_add (summary, info, FALSE);
+	camel_local_summary_queue_index (cls, info);
 	g_clear_object (&info);
 
 	g_object_unref (mp);
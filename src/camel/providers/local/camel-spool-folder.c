@@ -29,6 +29,8 @@
 
 #include <glib/gi18n-lib.h>
 
+#include <camel/camel-lock-private.h>
+
 #include "camel-spool-folder.h"
 #include "camel-spool-settings.h"
 #include "camel-spool-store.h"
@@ -52,7 +54,7 @@ spool_folder_lock (CamelLocalFolder *lf,
                    CamelLockType type,
                    GError **error)
 {
-	gint retry = 0;
+	CamelLockBackoff backoff;
 	CamelMboxFolder *mf = (CamelMboxFolder *) lf;
 	CamelSpoolFolder *sf = (CamelSpoolFolder *) lf;
 	GError *local_error = NULL;
@@ -67,10 +69,10 @@ spool_folder_lock (CamelLocalFolder *lf,
 		return -1;
 	}
 
-	while (retry < CAMEL_LOCK_RETRY) {
-		if (retry > 0)
-			sleep (CAMEL_LOCK_DELAY);
+	/* a briefly held spool lock should not stall for whole seconds */
+	camel_lock_backoff_init (&backoff, CAMEL_LOCK_RETRY * CAMEL_LOCK_DELAY);
 
+	do {
 		g_clear_error (&local_error);
 
 		if (camel_lock_fcntl (mf->lockfd, type, &local_error) == 0) {
@@ -81,8 +83,7 @@ spool_folder_lock (CamelLocalFolder *lf,
 			}
 			camel_unlock_fcntl (mf->lockfd);
 		}
-		retry++;
-	}
+	} while (camel_lock_backoff_wait (&backoff));
 
 	close (mf->lockfd);
 	mf->lockfd = -1;
@@ -227,6 +227,9 @@ check_capabilities (CamelNNTPStore *nntp_store,
 		if (len == 8 && g_ascii_strncasecmp (line, "STARTTLS", len) == 0)
 			camel_nntp_store_add_capabilities (
 				nntp_store, CAMEL_NNTP_CAPABILITY_STARTTLS);
+		if (len == 3 && g_ascii_strncasecmp (line, "HDR", len) == 0)
+			camel_nntp_store_add_capabilities (
+				nntp_store, CAMEL_NNTP_CAPABILITY_HDR);
 
 		if (len == 1 && g_ascii_strncasecmp (line, ".", len) == 0) {
 			ret = 0;
@@ -2011,29 +2014,20 @@ camel_nntp_store_remove_capabilities (CamelNNTPStore *nntp_store,
 	g_mutex_unlock (&nntp_store->priv->property_lock);
 }
 
-/* Enter owning lock */
-gint
-camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
-                         GCancellable *cancellable,
-                         GError **error,
-                         gchar **line,
-                         const gchar *fmt,
-                         va_list ap)
+static gint
+nntp_store_write_commandv (CamelNNTPStream *nntp_stream,
+                           GCancellable *cancellable,
+                           GError **error,
+                           const gchar *fmt,
+                           va_list ap)
 {
-	CamelNNTPStream *nntp_stream;
 	GString *buffer;
 	const guchar *p, *ps;
 	guchar c;
 	gchar *s;
-	gint d;
+	gint d, ret = 0;
 	guint u, u2;
 
-	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
-	g_return_val_if_fail (nntp_stream != NULL, -1);
-	g_return_val_if_fail (nntp_stream->mode != CAMEL_NNTP_STREAM_DATA, -1);
-
-	camel_nntp_stream_set_mode (nntp_stream, CAMEL_NNTP_STREAM_LINE);
-
 	p = (const guchar *) fmt;
 	ps = (const guchar *) p;
 
@@ -2092,28 +2086,150 @@ camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
 		CAMEL_STREAM (nntp_stream),
 		buffer->str, buffer->len,
 		cancellable, error) == -1)
-		goto ioerror;
+		ret = -1;
+
+	g_string_free (buffer, TRUE);
+
+	return ret;
+}
+
+static gint
+nntp_store_read_response (CamelNNTPStream *nntp_stream,
+                          GCancellable *cancellable,
+                          GError **error,
+                          gchar **line)
+{
+	guint u;
 
 	if (camel_nntp_stream_line (nntp_stream, (guchar **) line, &u, cancellable, error) == -1)
-		goto ioerror;
+		return -1;
 
 	u = strtoul (*line, NULL, 10);
 
 	/* Handle all switching to data mode here, to make callers job easier */
-	if (u == 215 || (u >= 220 && u <=224) || (u >= 230 && u <= 231))
+	if (u == 215 || (u >= 220 && u <=225) || (u >= 230 && u <= 231))
 		camel_nntp_stream_set_mode (nntp_stream, CAMEL_NNTP_STREAM_DATA);
 
-	goto exit;
+	return u;
+}
 
-ioerror:
-	g_prefix_error (error, _("NNTP Command failed: "));
-	u = -1;
+/* Enter owning lock */
+gint
+camel_nntp_raw_commandv (CamelNNTPStore *nntp_store,
+                         GCancellable *cancellable,
+                         GError **error,
+                         gchar **line,
+                         const gchar *fmt,
+                         va_list ap)
+{
+	CamelNNTPStream *nntp_stream;
+	gint ret;
+
+	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	g_return_val_if_fail (nntp_stream != NULL, -1);
+	g_return_val_if_fail (nntp_stream->mode != CAMEL_NNTP_STREAM_DATA, -1);
+
+	camel_nntp_stream_set_mode (nntp_stream, CAMEL_NNTP_STREAM_LINE);
+
+	ret = nntp_store_write_commandv (nntp_stream, cancellable, error, fmt, ap);
+	if (ret != -1)
+		ret = nntp_store_read_response (nntp_stream, cancellable, error, line);
+
+	if (ret == -1)
+		g_prefix_error (error, _("NNTP Command failed: "));
 
-exit:
 	g_clear_object (&nntp_stream);
-	g_string_free (buffer, TRUE);
 
-	return u;
+	return ret;
+}
+
+/**
+ * camel_nntp_raw_command_send:
+ * @nntp_store: a #CamelNNTPStore
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ * @fmt: the command format, as for camel_nntp_raw_command()
+ * @...: arguments for @fmt
+ *
+ * Writes a command to the server without waiting for its response,
+ * which lets the caller pipeline several commands. Each sent command
+ * should be paired with one camel_nntp_raw_command_response() call,
+ * in the order the commands were sent. The stream can be in the data
+ * mode of an earlier response meanwhile.
+ *
+ * Enter owning lock.
+ *
+ * Returns: 0 on success, -1 on error
+ *
+ * Since: 3.28
+ **/
+gint
+camel_nntp_raw_command_send (CamelNNTPStore *nntp_store,
+                             GCancellable *cancellable,
+                             GError **error,
+                             const gchar *fmt,
+                             ...)
+{
+	CamelNNTPStream *nntp_stream;
+	va_list ap;
+	gint ret;
+
+	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	g_return_val_if_fail (nntp_stream != NULL, -1);
+
+	va_start (ap, fmt);
+	ret = nntp_store_write_commandv (nntp_stream, cancellable, error, fmt, ap);
+	va_end (ap);
+
+	if (ret == -1)
+		g_prefix_error (error, _("NNTP Command failed: "));
+
+	g_clear_object (&nntp_stream);
+
+	return ret;
+}
+
+/**
+ * camel_nntp_raw_command_response:
+ * @nntp_store: a #CamelNNTPStore
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ * @line: (out): return location for the status line
+ *
+ * Reads the status line of the oldest command sent with
+ * camel_nntp_raw_command_send(), whose response was not read yet.
+ * Any data of the previous response should be read completely.
+ * Like camel_nntp_raw_command(), the stream is switched to the data
+ * mode for multi-line responses.
+ *
+ * Enter owning lock.
+ *
+ * Returns: the response code, or -1 on error
+ *
+ * Since: 3.28
+ **/
+gint
+camel_nntp_raw_command_response (CamelNNTPStore *nntp_store,
+                                 GCancellable *cancellable,
+                                 GError **error,
+                                 gchar **line)
+{
+	CamelNNTPStream *nntp_stream;
+	gint ret;
+
+	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	g_return_val_if_fail (nntp_stream != NULL, -1);
+	g_return_val_if_fail (nntp_stream->mode != CAMEL_NNTP_STREAM_DATA, -1);
+
+	camel_nntp_stream_set_mode (nntp_stream, CAMEL_NNTP_STREAM_LINE);
+
+	ret = nntp_store_read_response (nntp_stream, cancellable, error, line);
+	if (ret == -1)
+		g_prefix_error (error, _("NNTP Command failed: "));
+
+	g_clear_object (&nntp_stream);
+
+	return ret;
 }
 
 gint
@@ -69,7 +69,8 @@ struct _xover_header {
 /* names of supported capabilities on the server */
 typedef enum {
 	CAMEL_NNTP_CAPABILITY_OVER = 1 << 0,  /* supports OVER command */
-	CAMEL_NNTP_CAPABILITY_STARTTLS = 1 << 1  /* supports STARTTLS */
+	CAMEL_NNTP_CAPABILITY_STARTTLS = 1 << 1, /* supports STARTTLS */
+	CAMEL_NNTP_CAPABILITY_HDR = 1 << 2  /* supports HDR command */
 } CamelNNTPCapabilities;
 
 struct _CamelNNTPStore {
@@ -127,6 +128,15 @@ gint		camel_nntp_raw_command_auth	(CamelNNTPStore *nntp_store,
 						 gchar **line,
 						 const gchar *fmt,
 						 ...);
+gint		camel_nntp_raw_command_send	(CamelNNTPStore *nntp_store,
+						 GCancellable *cancellable,
+						 GError **error,
+						 const gchar *fmt,
+						 ...);
+gint		camel_nntp_raw_command_response	(CamelNNTPStore *nntp_store,
+						 GCancellable *cancellable,
+						 GError **error,
+						 gchar **line);
 gint		camel_nntp_command		(CamelNNTPStore *nntp_store,
 						 GCancellable *cancellable,
 						 GError **error,
@@ -153,6 +153,195 @@ summary_header_save (CamelFolderSummary *s,
 
 /* ********************************************************************** */
 
+/* Ranges are fetched in chunks of this many articles; the summary is
+ * saved and the changes are announced after each chunk, thus the new
+ * articles show up progressively on large groups. */
+#define NNTP_CHUNK_SIZE (500)
+
+/* How many OVER commands are sent ahead of the one being read */
+#define NNTP_OVER_WINDOW (4)
+
+/* How many HEAD commands are sent ahead of the one being read */
+#define NNTP_HEAD_WINDOW (16)
+
+/* Headers fetched with HDR, when the server cannot provide an overview */
+static const gchar *hdr_headers[] = {
+	"Subject",
+	"From",
+	"Date",
+	"Message-ID",
+	"References"
+};
+
+static void
+nntp_summary_push_scanning_message (CamelNNTPStore *nntp_store,
+                                    GCancellable *cancellable)
+{
+	CamelNetworkSettings *network_settings;
+	CamelSettings *settings;
+	gchar *host;
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (nntp_store));
+
+	network_settings = CAMEL_NETWORK_SETTINGS (settings);
+	host = camel_network_settings_dup_host (network_settings);
+
+	g_object_unref (settings);
+
+	camel_operation_push_message (
+		cancellable, _("%s: Scanning new messages"), host);
+
+	g_free (host);
+}
+
+/* Reads the rest of the data of a multi-line response */
+static void
+nntp_summary_skip_data (CamelNNTPStream *nntp_stream,
+                        GCancellable *cancellable)
+{
+	gchar *line;
+	guint len;
+
+	if (nntp_stream->mode != CAMEL_NNTP_STREAM_DATA)
+		return;
+
+	while (camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, cancellable, NULL) > 0)
+		;
+}
+
+/* Reads and drops responses of pipelined commands, to keep
+ * the stream in sync with the server after a failure */
+static void
+nntp_summary_drain_pending (CamelNNTPStore *nntp_store,
+                            CamelNNTPStream *nntp_stream,
+                            guint n_pending,
+                            GCancellable *cancellable)
+{
+	gchar *line;
+
+	nntp_summary_skip_data (nntp_stream, cancellable);
+
+	while (n_pending > 0) {
+		n_pending--;
+
+		if (camel_nntp_raw_command_response (nntp_store, cancellable, NULL, &line) == -1)
+			break;
+
+		nntp_summary_skip_data (nntp_stream, cancellable);
+	}
+}
+
+/* Saves the summary and announces articles added since the last call */
+static void
+nntp_summary_commit_chunk (CamelNNTPSummary *cns,
+                           CamelFolderChangeInfo *chunk_changes,
+                           CamelFolderChangeInfo *changes)
+{
+	CamelFolderSummary *s = CAMEL_FOLDER_SUMMARY (cns);
+	CamelFolder *folder;
+
+	if (!camel_folder_change_info_changed (chunk_changes))
+		return;
+
+	camel_folder_summary_touch (s);
+	camel_folder_summary_save (s, NULL);
+
+	folder = camel_folder_summary_get_folder (s);
+	if (folder)
+		camel_folder_changed (folder, chunk_changes);
+	else
+		camel_folder_change_info_cat (changes, chunk_changes);
+
+	camel_folder_change_info_clear (chunk_changes);
+}
+
+static void
+nntp_summary_add_info (CamelNNTPSummary *cns,
+                       CamelMessageInfo *mi,
+                       guint n,
+                       gboolean folder_filter_recent,
+                       CamelFolderChangeInfo *changes)
+{
+	camel_folder_summary_add (CAMEL_FOLDER_SUMMARY (cns), mi, FALSE);
+
+	cns->high = n;
+	camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (mi));
+	if (folder_filter_recent)
+		camel_folder_change_info_recent_uid (changes, camel_message_info_get_uid (mi));
+}
+
+static void
+nntp_summary_add_xover_line (CamelNNTPSummary *cns,
+                             CamelNNTPStore *nntp_store,
+                             gchar *line,
+                             CamelNameValueArray *headers,
+                             gboolean folder_filter_recent,
+                             CamelFolderChangeInfo *changes)
+{
+	CamelFolderSummary *s = CAMEL_FOLDER_SUMMARY (cns);
+	struct _xover_header *xover;
+	gchar *tab;
+	guint n, size;
+
+	n = strtoul (line, &tab, 10);
+	if (*tab != '\t')
+		return;
+	tab++;
+	xover = nntp_store->xover;
+	size = 0;
+	for (; tab[0] && xover; xover = xover->next) {
+		line = tab;
+		tab = strchr (line, '\t');
+		if (tab)
+			*tab++ = 0;
+		else
+			tab = line + strlen (line);
+
+		/* do we care about this column? */
+		if (xover->name) {
+			line += xover->skip;
+			if (line < tab) {
+				camel_name_value_array_append (headers, xover->name, line);
+				switch (xover->type) {
+				case XOVER_STRING:
+					break;
+				case XOVER_MSGID:
+					cns->priv->uid = g_strdup_printf ("%u,%s", n, line);
+					break;
+				case XOVER_SIZE:
+					size = strtoul (line, NULL, 10);
+					break;
+				}
+			}
+		}
+	}
+
+	/* skip headers we don't care about, incase the server doesn't actually send some it said it would. */
+	while (xover && xover->name == NULL)
+		xover = xover->next;
+
+	/* truncated line? ignore? */
+	if (xover == NULL) {
+		if (!camel_folder_summary_check_uid (s, cns->priv->uid)) {
+			CamelMessageInfo *mi;
+
+			mi = camel_folder_summary_info_new_from_headers (s, headers);
+			camel_message_info_set_size (mi, size);
+			nntp_summary_add_info (cns, mi, n, folder_filter_recent, changes);
+			g_clear_object (&mi);
+		} else if (cns->high < n) {
+			cns->high = n;
+		}
+	}
+
+	if (cns->priv->uid) {
+		g_free (cns->priv->uid);
+		cns->priv->uid = NULL;
+	}
+
+	camel_name_value_array_clear (headers);
+}
+
 /* Note: This will be called from camel_nntp_command, so only use camel_nntp_raw_command */
 static gint
 add_range_xover (CamelNNTPSummary *cns,
@@ -165,51 +354,40 @@ add_range_xover (CamelNNTPSummary *cns,
 {
 	CamelNNTPCapabilities capability = CAMEL_NNTP_CAPABILITY_OVER;
 	CamelNNTPStream *nntp_stream;
-	CamelNetworkSettings *network_settings;
-	CamelSettings *settings;
-	CamelService *service;
+	CamelFolderChangeInfo *chunk_changes;
 	CamelFolderSummary *s;
 	CamelNameValueArray *headers = NULL;
-	gchar *line, *tab;
-	gchar *host;
+	const gchar *command;
+	gchar *line;
 	guint len;
 	gint ret;
-	guint n, count, total, size;
+	guint count, total, next, chunk_high, n_pending;
 	gboolean folder_filter_recent;
-	struct _xover_header *xover;
 
 	s = (CamelFolderSummary *) cns;
 	folder_filter_recent = camel_folder_summary_get_folder (s) &&
 		(camel_folder_get_flags (camel_folder_summary_get_folder (s)) & CAMEL_FOLDER_FILTER_RECENT) != 0;
 
-	service = CAMEL_SERVICE (nntp_store);
+	nntp_summary_push_scanning_message (nntp_store, cancellable);
 
-	settings = camel_service_ref_settings (service);
-
-	network_settings = CAMEL_NETWORK_SETTINGS (settings);
-	host = camel_network_settings_dup_host (network_settings);
-
-	g_object_unref (settings);
-
-	camel_operation_push_message (
-		cancellable, _("%s: Scanning new messages"), host);
-
-	g_free (host);
+	/* The first chunk finds out which of the commands works */
+	chunk_high = low + MIN (high - low, NNTP_CHUNK_SIZE - 1);
 
 	if (camel_nntp_store_has_capabilities (nntp_store, capability))
 		ret = camel_nntp_raw_command_auth (
 			nntp_store, cancellable, error,
-			&line, "over %r", low, high);
+			&line, "over %r", low, chunk_high);
 	else
 		ret = -1;
-	if (ret != 224) {
+	/* 423 is an empty range, of expired articles */
+	if (ret != 224 && ret != 423) {
 		camel_nntp_store_remove_capabilities (nntp_store, capability);
 		ret = camel_nntp_raw_command_auth (
 			nntp_store, cancellable, error,
-			&line, "xover %r", low, high);
+			&line, "xover %r", low, chunk_high);
 	}
 
-	if (ret != 224) {
+	if (ret != 224 && ret != 423) {
 		camel_operation_pop_message (cancellable);
 		if (ret != -1)
 			g_set_error (
@@ -218,84 +396,233 @@ add_range_xover (CamelNNTPSummary *cns,
 		return -1;
 	}
 
+	command = camel_nntp_store_has_capabilities (nntp_store, capability) ? "over %r" : "xover %r";
+
 	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	chunk_changes = camel_folder_change_info_new ();
 
 	count = 0;
 	total = high - low + 1;
+	n_pending = 0;
+	next = chunk_high < high ? chunk_high + 1 : 0;
 	headers = camel_name_value_array_new ();
+
+	while (TRUE) {
+		/* Keep the server busy while the current chunk is being read */
+		while (next != 0 && n_pending < NNTP_OVER_WINDOW) {
+			chunk_high = next + MIN (high - next, NNTP_CHUNK_SIZE - 1);
+
+			if (camel_nntp_raw_command_send (nntp_store, cancellable, error, command, next, chunk_high) == -1) {
+				ret = -1;
+				break;
+			}
+
+			n_pending++;
+			next = chunk_high < high ? chunk_high + 1 : 0;
+		}
+
+		if (ret == -1)
+			break;
+
+		if (ret == 224) {
+			while ((ret = camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, cancellable, error)) > 0) {
+				camel_operation_progress (cancellable, (count * 100) / total);
+				count++;
+
+				nntp_summary_add_xover_line (cns, nntp_store, line, headers, folder_filter_recent, chunk_changes);
+			}
+
+			if (ret == -1)
+				break;
+		}
+
+		nntp_summary_commit_chunk (cns, chunk_changes, changes);
+
+		if (n_pending == 0)
+			break;
+
+		ret = camel_nntp_raw_command_response (nntp_store, cancellable, error, &line);
+		n_pending--;
+
+		if (ret != 224 && ret != 423) {
+			if (ret != -1) {
+				g_set_error (
+					error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+					_("Unexpected server response from xover: %s"), line);
+				nntp_summary_drain_pending (nntp_store, nntp_stream, n_pending, cancellable);
+			}
+			ret = -1;
+			break;
+		}
+	}
+
+	/* Keep what had been read before a failure */
+	nntp_summary_commit_chunk (cns, chunk_changes, changes);
+
+	camel_folder_change_info_free (chunk_changes);
+	camel_name_value_array_free (headers);
+	g_clear_object (&nntp_stream);
+
+	camel_operation_pop_message (cancellable);
+
+	return ret == -1 ? -1 : 0;
+}
+
+/* Reads one HDR response, storing the values into @chunk_headers,
+ * which is indexed by the article number relative to @chunk_low */
+static gint
+nntp_summary_read_hdr (CamelNNTPStream *nntp_stream,
+                       const gchar *header_name,
+                       guint chunk_low,
+                       GPtrArray *chunk_headers,
+                       GCancellable *cancellable,
+                       GError **error)
+{
+	gchar *line, *value;
+	guint len, n;
+	gint ret;
+
 	while ((ret = camel_nntp_stream_line (nntp_stream, (guchar **) &line, &len, cancellable, error)) > 0) {
-		camel_operation_progress (cancellable, (count * 100) / total);
-		count++;
-		n = strtoul (line, &tab, 10);
-		if (*tab != '\t')
+		n = strtoul (line, &value, 10);
+		if (n < chunk_low || n - chunk_low >= chunk_headers->len || *value != ' ')
 			continue;
-		tab++;
-		xover = nntp_store->xover;
-		size = 0;
-		for (; tab[0] && xover; xover = xover->next) {
-			line = tab;
-			tab = strchr (line, '\t');
-			if (tab)
-				*tab++ = 0;
-			else
-				tab = line + strlen (line);
-
-			/* do we care about this column? */
-			if (xover->name) {
-				line += xover->skip;
-				if (line < tab) {
-					camel_name_value_array_append (headers, xover->name, line);
-					switch (xover->type) {
-					case XOVER_STRING:
-						break;
-					case XOVER_MSGID:
-						cns->priv->uid = g_strdup_printf ("%u,%s", n, line);
-						break;
-					case XOVER_SIZE:
-						size = strtoul (line, NULL, 10);
-						break;
-					}
-				}
+
+		value++;
+
+		/* an empty value means the article has no such header */
+		if (*value) {
+			CamelNameValueArray *headers;
+
+			headers = g_ptr_array_index (chunk_headers, n - chunk_low);
+			if (!headers) {
+				headers = camel_name_value_array_new ();
+				chunk_headers->pdata[n - chunk_low] = headers;
+			}
+
+			camel_name_value_array_append (headers, header_name, value);
+		}
+	}
+
+	return ret;
+}
+
+/* Note: This will be called from camel_nntp_command, so only use camel_nntp_raw_command */
+static gint
+add_range_hdr (CamelNNTPSummary *cns,
+               CamelNNTPStore *nntp_store,
+               guint high,
+               guint low,
+               CamelFolderChangeInfo *changes,
+               GCancellable *cancellable,
+               GError **error)
+{
+	CamelNNTPStream *nntp_stream;
+	CamelFolderChangeInfo *chunk_changes;
+	CamelFolderSummary *s;
+	GPtrArray *chunk_headers;
+	gchar *line = NULL;
+	guint ii, jj, chunk_low, chunk_high, count, total;
+	gint ret = 0;
+	gboolean folder_filter_recent;
+
+	s = (CamelFolderSummary *) cns;
+	folder_filter_recent = camel_folder_summary_get_folder (s) &&
+		(camel_folder_get_flags (camel_folder_summary_get_folder (s)) & CAMEL_FOLDER_FILTER_RECENT) != 0;
+
+	nntp_summary_push_scanning_message (nntp_store, cancellable);
+
+	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	chunk_changes = camel_folder_change_info_new ();
+	chunk_headers = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_name_value_array_free);
+
+	count = 0;
+	total = high - low + 1;
+	chunk_low = low;
+
+	while (ret != -1) {
+		chunk_high = chunk_low + MIN (high - chunk_low, NNTP_CHUNK_SIZE - 1);
+
+		g_ptr_array_set_size (chunk_headers, 0);
+		g_ptr_array_set_size (chunk_headers, chunk_high - chunk_low + 1);
+
+		/* All the headers of the chunk are asked for at once */
+		for (ii = 0; ii < G_N_ELEMENTS (hdr_headers); ii++) {
+			if (camel_nntp_raw_command_send (nntp_store, cancellable, error, "hdr %s %r", hdr_headers[ii], chunk_low, chunk_high) == -1) {
+				ret = -1;
+				break;
+			}
+		}
+
+		for (jj = 0; jj < ii && ret != -1; jj++) {
+			ret = camel_nntp_raw_command_response (nntp_store, cancellable, error, &line);
+
+			if (ret == 225) {
+				ret = nntp_summary_read_hdr (nntp_stream, hdr_headers[jj], chunk_low, chunk_headers, cancellable, error);
+			} else if (ret >= 500 && chunk_low == low && jj == 0) {
+				/* advertised, but not working; the caller falls back to HEAD */
+				camel_nntp_store_remove_capabilities (nntp_store, CAMEL_NNTP_CAPABILITY_HDR);
+				nntp_summary_drain_pending (nntp_store, nntp_stream, ii - jj - 1, cancellable);
+				ret = -1;
+			} else if (ret != 423 && ret != -1) {
+				/* 423 means no article in the range */
+				g_set_error (
+					error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+					_("Unexpected server response from hdr: %s"), line);
+				nntp_summary_drain_pending (nntp_store, nntp_stream, ii - jj - 1, cancellable);
+				ret = -1;
 			}
 		}
 
-		/* skip headers we don't care about, incase the server doesn't actually send some it said it would. */
-		while (xover && xover->name == NULL)
-			xover = xover->next;
+		if (ret == -1)
+			break;
+
+		for (ii = 0; ii < chunk_headers->len; ii++) {
+			CamelNameValueArray *headers = chunk_headers->pdata[ii];
+			const gchar *msgid;
+			guint n = chunk_low + ii;
+
+			camel_operation_progress (cancellable, (count * 100) / total);
+			count++;
+
+			msgid = headers ? camel_name_value_array_get_named (headers, CAMEL_COMPARE_CASE_INSENSITIVE, "Message-ID") : NULL;
+			if (!msgid)
+				continue;
 
-		/* truncated line? ignore? */
-		if (xover == NULL) {
+			cns->priv->uid = g_strdup_printf ("%u,%s", n, msgid);
 			if (!camel_folder_summary_check_uid (s, cns->priv->uid)) {
 				CamelMessageInfo *mi;
 
 				mi = camel_folder_summary_info_new_from_headers (s, headers);
-				camel_message_info_set_size (mi, size);
-				camel_folder_summary_add (s, mi, FALSE);
-
-				cns->high = n;
-				camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (mi));
-				if (folder_filter_recent)
-					camel_folder_change_info_recent_uid (changes, camel_message_info_get_uid (mi));
+				if (mi)
+					nntp_summary_add_info (cns, mi, n, folder_filter_recent, chunk_changes);
 				g_clear_object (&mi);
 			} else if (cns->high < n) {
 				cns->high = n;
 			}
-		}
 
-		if (cns->priv->uid) {
-			g_free (cns->priv->uid);
-			cns->priv->uid = NULL;
+			if (cns->priv->uid) {
+				g_free (cns->priv->uid);
+				cns->priv->uid = NULL;
+			}
 		}
 
-		camel_name_value_array_clear (headers);
+		nntp_summary_commit_chunk (cns, chunk_changes, changes);
+
+		if (chunk_high >= high)
+			break;
+
+		chunk_low = chunk_high + 1;
 	}
 
-	camel_name_value_array_free (headers);
+	nntp_summary_commit_chunk (cns, chunk_changes, changes);
+
+	g_ptr_array_unref (chunk_headers);
+	camel_folder_change_info_free (chunk_changes);
 	g_clear_object (&nntp_stream);
 
 	camel_operation_pop_message (cancellable);
 
-	return ret;
+	return ret == -1 ? -1 : 0;
 }
 
 /* Note: This will be called from camel_nntp_command, so only use camel_nntp_raw_command */
@@ -309,16 +636,13 @@ add_range_head (CamelNNTPSummary *cns,
                 GError **error)
 {
 	CamelNNTPStream *nntp_stream;
-	CamelNetworkSettings *network_settings;
-	CamelSettings *settings;
-	CamelService *service;
+	CamelFolderChangeInfo *chunk_changes;
 	CamelFolderSummary *s;
 	gint ret = -1;
 	gchar *line, *msgid;
-	guint i, n, count, total;
+	guint i, n, count, total, sent;
 	CamelMessageInfo *mi;
 	CamelMimeParser *mp;
-	gchar *host;
 	gboolean folder_filter_recent;
 
 	s = (CamelFolderSummary *) cns;
@@ -327,29 +651,44 @@ add_range_head (CamelNNTPSummary *cns,
 
 	mp = camel_mime_parser_new ();
 
-	service = CAMEL_SERVICE (nntp_store);
-
-	settings = camel_service_ref_settings (service);
-
-	network_settings = CAMEL_NETWORK_SETTINGS (settings);
-	host = camel_network_settings_dup_host (network_settings);
-
-	g_object_unref (settings);
-
-	camel_operation_push_message (
-		cancellable, _("%s: Scanning new messages"), host);
-
-	g_free (host);
+	nntp_summary_push_scanning_message (nntp_store, cancellable);
 
 	nntp_stream = camel_nntp_store_ref_stream (nntp_store);
+	chunk_changes = camel_folder_change_info_new ();
 
 	count = 0;
 	total = high - low + 1;
+	sent = low;
 	for (i = low; i < high + 1; i++) {
+		if (count > 0 && count % NNTP_CHUNK_SIZE == 0)
+			nntp_summary_commit_chunk (cns, chunk_changes, changes);
+
 		camel_operation_progress (cancellable, (count * 100) / total);
 		count++;
-		ret = camel_nntp_raw_command_auth (
-			nntp_store, cancellable, error, &line, "head %u", i);
+
+		/* The first command handles authentication, the following
+		 * ones are sent ahead of time, up to the window size */
+		if (i == low)
+			ret = camel_nntp_raw_command_auth (
+				nntp_store, cancellable, error, &line, "head %u", i);
+
+		while (ret != -1 && sent < high && sent - i < NNTP_HEAD_WINDOW) {
+			if (camel_nntp_raw_command_send (nntp_store, cancellable, error, "head %u", sent + 1) == -1) {
+				/* the response of the current article is unread, unless it is the first one */
+				nntp_summary_drain_pending (nntp_store, nntp_stream, sent - i + (i != low ? 1 : 0), cancellable);
+				ret = -1;
+			} else {
+				sent++;
+			}
+		}
+
+		if (ret == -1)
+			goto error;
+
+		if (i != low)
+			ret = camel_nntp_raw_command_response (
+				nntp_store, cancellable, error, &line);
+
 		/* unknown article, ignore */
 		if (ret == 423)
 			continue;
@@ -360,6 +699,8 @@ add_range_head (CamelNNTPSummary *cns,
 				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 				_("Unexpected server response from head: %s"),
 				line);
+			nntp_summary_drain_pending (nntp_store, nntp_stream, sent - i, cancellable);
+			ret = -1;
 			goto ioerror;
 		}
 		line += 3;
@@ -372,19 +713,18 @@ add_range_head (CamelNNTPSummary *cns,
 			line[1] = 0;
 			cns->priv->uid = g_strdup_printf ("%u,%s\n", n, msgid);
 			if (!camel_folder_summary_check_uid (s, cns->priv->uid)) {
-				if (camel_mime_parser_init_with_stream (mp, CAMEL_STREAM (nntp_stream), error) == -1)
+				if (camel_mime_parser_init_with_stream (mp, CAMEL_STREAM (nntp_stream), error) == -1) {
+					nntp_summary_drain_pending (nntp_store, nntp_stream, sent - i, cancellable);
 					goto error;
+				}
 				mi = camel_folder_summary_info_new_from_parser (s, mp);
-				camel_folder_summary_add (s, mi, FALSE);
 				while (camel_mime_parser_step (mp, NULL, NULL) != CAMEL_MIME_PARSER_STATE_EOF)
 					;
 				if (mi == NULL) {
+					nntp_summary_drain_pending (nntp_store, nntp_stream, sent - i, cancellable);
 					goto error;
 				}
-				cns->high = i;
-				camel_folder_change_info_add_uid (changes, camel_message_info_get_uid (mi));
-				if (folder_filter_recent)
-					camel_folder_change_info_recent_uid (changes, camel_message_info_get_uid (mi));
+				nntp_summary_add_info (cns, mi, i, folder_filter_recent, chunk_changes);
 				g_clear_object (&mi);
 			}
 			if (cns->priv->uid) {
@@ -392,6 +732,10 @@ add_range_head (CamelNNTPSummary *cns,
 				cns->priv->uid = NULL;
 			}
 		}
+
+		/* the headers of known articles are not parsed, but the next
+		 * response can be read only after they had been consumed */
+		nntp_summary_skip_data (nntp_stream, cancellable);
 	}
 
 	ret = 0;
@@ -418,6 +762,9 @@ ioerror:
 	}
 	g_object_unref (mp);
 
+	nntp_summary_commit_chunk (cns, chunk_changes, changes);
+	camel_folder_change_info_free (chunk_changes);
+
 	g_clear_object (&nntp_stream);
 
 	camel_operation_pop_message (cancellable);
@@ -652,7 +999,13 @@ camel_nntp_summary_check (CamelNNTPSummary *cns,
 			ret = add_range_xover (
 				cns, store, l, cns->high + 1,
 				changes, cancellable, error);
-		else
+		else if (camel_nntp_store_has_capabilities (store, CAMEL_NNTP_CAPABILITY_HDR))
+			ret = add_range_hdr (
+				cns, store, l, cns->high + 1,
+				changes, cancellable, error);
+
+		/* also when the server rejected the advertised HDR */
+		if (!store->xover && !camel_nntp_store_has_capabilities (store, CAMEL_NNTP_CAPABILITY_HDR))
 			ret = add_range_head (
 				cns, store, l, cns->high + 1,
 				changes, cancellable, error);
@@ -56,6 +56,9 @@
 /* set if we are using authtypes from a broken AUTH= */
 #define CAMEL_SMTP_TRANSPORT_AUTH_EQUAL             (1 << 4)
 
+#define CAMEL_SMTP_TRANSPORT_PIPELINING             (1 << 5)
+#define CAMEL_SMTP_TRANSPORT_CHUNKING               (1 << 6)
+
 enum {
 	PROP_0,
 	PROP_CONNECTABLE,
@@ -92,10 +95,36 @@ static gboolean		smtp_rcpt		(CamelSmtpTransport *transport,
 						 const gchar *recipient,
 						 GCancellable *cancellable,
 						 GError **error);
+static gboolean		smtp_envelope_write	(CamelSmtpTransport *transport,
+						 CamelStream *ostream,
+						 const gchar *sender,
+						 gboolean has_8bit_parts,
+						 GPtrArray *recipients,
+						 gboolean with_rset,
+						 gboolean with_data,
+						 GCancellable *cancellable,
+						 GError **error);
+static gboolean		smtp_envelope_read	(CamelSmtpTransport *transport,
+						 CamelStreamBuffer *istream,
+						 GPtrArray *recipients,
+						 gboolean with_rset,
+						 gboolean with_data,
+						 gboolean *out_lost,
+						 GCancellable *cancellable,
+						 GError **error);
 static gboolean		smtp_data		(CamelSmtpTransport *transport,
 						 CamelStreamBuffer *istream,
 						 CamelStream *ostream,
 						 CamelMimeMessage *message,
+						 gboolean data_accepted,
+						 GCancellable *cancellable,
+						 GError **error);
+static gboolean		smtp_bdat		(CamelSmtpTransport *transport,
+						 CamelStreamBuffer *istream,
+						 CamelStream *ostream,
+						 CamelMimeMessage *message,
+						 GPtrArray *pipelined_recipients,
+						 gboolean pipelined_rset,
 						 GCancellable *cancellable,
 						 GError **error);
 static gboolean		smtp_rset		(CamelSmtpTransport *transport,
@@ -867,7 +896,8 @@ smtp_transport_send_to_sync (CamelTransport *transport,
 	CamelInternetAddress *cia;
 	CamelStreamBuffer *istream;
 	CamelStream *ostream;
-	gboolean has_8bit_parts;
+	GPtrArray *encoded_recipients;
+	gboolean has_8bit_parts, pipelined_rset = FALSE, success;
 	const gchar *addr;
 	gint i, len;
 
@@ -895,84 +925,97 @@ smtp_transport_send_to_sync (CamelTransport *transport,
 		return FALSE;
 	}
 
-	camel_operation_push_message (cancellable, _("Sending message"));
-
-	/* find out if the message has 8bit mime parts */
-	has_8bit_parts = camel_mime_message_has_8bit_parts (message);
-
-	/* If the connection needs a ReSET, then do so */
-	if (smtp_transport->need_rset &&
-	    !smtp_rset (smtp_transport, istream, ostream, cancellable, error)) {
-		camel_operation_pop_message (cancellable);
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
-		return FALSE;
-	}
-	smtp_transport->need_rset = FALSE;
-
-	/* rfc1652 (8BITMIME) requires that you notify the ESMTP daemon that
-	 * you'll be sending an 8bit mime message at "MAIL FROM:" time. */
-	if (!smtp_mail (
-		smtp_transport, istream, ostream, addr, has_8bit_parts, cancellable, error)) {
-		camel_operation_pop_message (cancellable);
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
-		return FALSE;
-	}
-
 	len = camel_address_length (recipients);
 	if (len == 0) {
+		g_clear_object (&istream);
+		g_clear_object (&ostream);
 		g_set_error (
 			error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 			_("Cannot send message: no recipients defined."));
-		camel_operation_pop_message (cancellable);
-		smtp_transport->need_rset = TRUE;
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
 		return FALSE;
 	}
 
 	cia = CAMEL_INTERNET_ADDRESS (recipients);
+	encoded_recipients = g_ptr_array_new_with_free_func (g_free);
+
 	for (i = 0; i < len; i++) {
-		gchar *enc;
+		const gchar *rcpt_addr;
 
-		if (!camel_internet_address_get (cia, i, NULL, &addr)) {
+		if (!camel_internet_address_get (cia, i, NULL, &rcpt_addr)) {
+			g_ptr_array_unref (encoded_recipients);
+			g_clear_object (&istream);
+			g_clear_object (&ostream);
 			g_set_error (
 				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
 				_("Cannot send message: "
 				"one or more invalid recipients"));
-			camel_operation_pop_message (cancellable);
-			smtp_transport->need_rset = TRUE;
-			g_clear_object (&istream);
-			g_clear_object (&ostream);
 			return FALSE;
 		}
 
-		enc = camel_internet_address_encode_address (NULL, NULL, addr);
-		if (!smtp_rcpt (smtp_transport, istream, ostream, enc, cancellable, error)) {
-			g_free (enc);
-			camel_operation_pop_message (cancellable);
-			smtp_transport->need_rset = TRUE;
-			g_clear_object (&istream);
-			g_clear_object (&ostream);
-			return FALSE;
+		g_ptr_array_add (encoded_recipients, camel_internet_address_encode_address (NULL, NULL, rcpt_addr));
+	}
+
+	camel_operation_push_message (cancellable, _("Sending message"));
+
+	/* find out if the message has 8bit mime parts */
+	has_8bit_parts = camel_mime_message_has_8bit_parts (message);
+
+	if (smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) {
+		gboolean with_data = !(smtp_transport->flags & CAMEL_SMTP_TRANSPORT_CHUNKING);
+		gboolean lost = FALSE;
+
+		/* RSET, MAIL FROM, all RCPT TO and, without CHUNKING, also DATA,
+		 * go to the server at once; see rfc2920. With CHUNKING, the first
+		 * chunks of the message follow, and smtp_bdat() reads the replies. */
+		pipelined_rset = smtp_transport->need_rset;
+
+		success = smtp_envelope_write (
+			smtp_transport, ostream, addr, has_8bit_parts, encoded_recipients,
+			pipelined_rset, with_data, cancellable, error);
+
+		if (success && with_data)
+			success = smtp_envelope_read (
+				smtp_transport, istream, encoded_recipients,
+				pipelined_rset, TRUE, &lost, cancellable, error);
+	} else {
+		/* If the connection needs a ReSET, then do so */
+		success = !smtp_transport->need_rset ||
+			smtp_rset (smtp_transport, istream, ostream, cancellable, error);
+
+		/* rfc1652 (8BITMIME) requires that you notify the ESMTP daemon that
+		 * you'll be sending an 8bit mime message at "MAIL FROM:" time. */
+		success = success && smtp_mail (
+			smtp_transport, istream, ostream, addr, has_8bit_parts, cancellable, error);
+
+		for (i = 0; success && i < (gint) encoded_recipients->len; i++) {
+			success = smtp_rcpt (smtp_transport, istream, ostream, encoded_recipients->pdata[i], cancellable, error);
 		}
-		g_free (enc);
 	}
 
-	if (!smtp_data (smtp_transport, istream, ostream, message, cancellable, error)) {
-		camel_operation_pop_message (cancellable);
-		smtp_transport->need_rset = TRUE;
-		g_clear_object (&istream);
-		g_clear_object (&ostream);
-		return FALSE;
+	if (success) {
+		/* rfc3030 (CHUNKING) sends the message as is, without dot-stuffing */
+		if (smtp_transport->flags & CAMEL_SMTP_TRANSPORT_CHUNKING)
+			success = smtp_bdat (
+				smtp_transport, istream, ostream, message,
+				(smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) != 0 ? encoded_recipients : NULL,
+				pipelined_rset, cancellable, error);
+		else
+			success = smtp_data (
+				smtp_transport, istream, ostream, message,
+				(smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) != 0,
+				cancellable, error);
 	}
 
+	/* The connection is kept for the next message; pipelined, the RSET
+	 * between the messages costs no extra round trip */
+	smtp_transport->need_rset = !success || (smtp_transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING) != 0;
+
 	camel_operation_pop_message (cancellable);
+	g_ptr_array_unref (encoded_recipients);
 	g_clear_object (&istream);
 	g_clear_object (&ostream);
 
-	return TRUE;
+	return success;
 }
 
 static const gchar *
@@ -1371,7 +1414,9 @@ smtp_helo (CamelSmtpTransport *transport,
 	 * are being called a second time (ie, after a STARTTLS) */
 	transport->flags &= ~(CAMEL_SMTP_TRANSPORT_8BITMIME |
 			      CAMEL_SMTP_TRANSPORT_ENHANCEDSTATUSCODES |
-			      CAMEL_SMTP_TRANSPORT_STARTTLS);
+			      CAMEL_SMTP_TRANSPORT_STARTTLS |
+			      CAMEL_SMTP_TRANSPORT_PIPELINING |
+			      CAMEL_SMTP_TRANSPORT_CHUNKING);
 
 	if (transport->authtypes) {
 		g_hash_table_foreach (transport->authtypes, authtypes_free, NULL);
@@ -1453,6 +1498,10 @@ smtp_helo (CamelSmtpTransport *transport,
 				transport->flags |= CAMEL_SMTP_TRANSPORT_ENHANCEDSTATUSCODES;
 			} else if (!g_ascii_strncasecmp (token, "STARTTLS", 8)) {
 				transport->flags |= CAMEL_SMTP_TRANSPORT_STARTTLS;
+			} else if (!g_ascii_strncasecmp (token, "PIPELINING", 10)) {
+				transport->flags |= CAMEL_SMTP_TRANSPORT_PIPELINING;
+			} else if (!g_ascii_strncasecmp (token, "CHUNKING", 8)) {
+				transport->flags |= CAMEL_SMTP_TRANSPORT_CHUNKING;
 			} else if (!g_ascii_strncasecmp (token, "AUTH", 4)) {
 				if (!transport->authtypes || transport->flags & CAMEL_SMTP_TRANSPORT_AUTH_EQUAL) {
 					/* Don't bother parsing any authtypes if we already have a list.
@@ -1493,6 +1542,17 @@ smtp_helo (CamelSmtpTransport *transport,
 	return TRUE;
 }
 
+static gchar *
+smtp_mail_command (CamelSmtpTransport *transport,
+		   const gchar *sender,
+		   gboolean has_8bit_parts)
+{
+	if (transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME && has_8bit_parts)
+		return g_strdup_printf ("MAIL FROM:<%s> BODY=8BITMIME\r\n", sender);
+
+	return g_strdup_printf ("MAIL FROM:<%s>\r\n", sender);
+}
+
 static gboolean
 smtp_mail (CamelSmtpTransport *transport,
 	   CamelStreamBuffer *istream,
@@ -1505,10 +1565,7 @@ smtp_mail (CamelSmtpTransport *transport,
 	/* we gotta tell the smtp server who we are. (our email addy) */
 	gchar *cmdbuf, *respbuf = NULL;
 
-	if (transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME && has_8bit_parts)
-		cmdbuf = g_strdup_printf ("MAIL FROM:<%s> BODY=8BITMIME\r\n", sender);
-	else
-		cmdbuf = g_strdup_printf ("MAIL FROM:<%s>\r\n", sender);
+	cmdbuf = smtp_mail_command (transport, sender, has_8bit_parts);
 
 	d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
 
@@ -1629,85 +1686,244 @@ smtp_maybe_update_socket_timeout (CamelStream *strm,
 	g_clear_object (&base_strm);
 }
 
+/* Reads one whole, possibly multi-line, reply, which is expected to have
+ * the @expect_code. Sets @out_lost when no reply could be read at all. */
 static gboolean
-smtp_data (CamelSmtpTransport *transport,
-	   CamelStreamBuffer *istream,
-	   CamelStream *ostream,
-           CamelMimeMessage *message,
-           GCancellable *cancellable,
-           GError **error)
+smtp_read_reply (CamelSmtpTransport *transport,
+		 CamelStreamBuffer *istream,
+		 const gchar *expect_code,
+		 gboolean *out_lost,
+		 GCancellable *cancellable,
+		 GError **error)
 {
-	CamelNameValueArray *previous_headers;
-	const gchar *header_name = NULL, *header_value = NULL;
-	CamelBestencEncoding enctype = CAMEL_BESTENC_8BIT;
-	CamelStream *filtered_stream;
-	gchar *cmdbuf, *respbuf = NULL;
-	CamelMimeFilter *filter;
-	gsize bytes_written;
-	gint ret;
+	gchar *respbuf = NULL;
+	GError *local_error = NULL;
+
+	*out_lost = FALSE;
+
+	do {
+		g_free (respbuf);
+		respbuf = camel_stream_buffer_read_line (istream, cancellable, &local_error);
+		d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
+		if (respbuf == NULL) {
+			if (!local_error)
+				local_error = g_error_new_literal (
+					CAMEL_SMTP_TRANSPORT_ERROR,
+					CAMEL_SMTP_TRANSPORT_ERROR_CONNECTION_LOST,
+					_("Server closed the connection"));
+
+			g_propagate_error (error, local_error);
+			*out_lost = TRUE;
+			return FALSE;
+		}
+		if (strncmp (respbuf, expect_code, 3) != 0) {
+			/* this reads also the rest of a multi-line reply */
+			smtp_set_error (transport, istream, respbuf, cancellable, error);
+			g_free (respbuf);
+			return FALSE;
+		}
+	} while (*(respbuf+3) == '-'); /* if we got "250-" then loop again */
+	g_free (respbuf);
+
+	return TRUE;
+}
+
+static gboolean
+smtp_envelope_write (CamelSmtpTransport *transport,
+		     CamelStream *ostream,
+		     const gchar *sender,
+		     gboolean has_8bit_parts,
+		     GPtrArray *recipients,
+		     gboolean with_rset,
+		     gboolean with_data,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	GString *batch;
+	gchar *cmdbuf;
 	guint ii;
 
-	/* If the server doesn't support 8BITMIME, set our required encoding to be 7bit */
-	if (!(transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME))
-		enctype = CAMEL_BESTENC_7BIT;
+	batch = g_string_new ("");
 
-	/* FIXME: should we get the best charset too?? */
-	/* Changes the encoding of all mime parts to fit within our required
-	 * encoding type and also force any text parts with long lines (longer
-	 * than 998 octets) to wrap by QP or base64 encoding them. */
-	camel_mime_message_set_best_encoding (
-		message, CAMEL_BESTENC_GET_ENCODING, enctype);
+	if (with_rset)
+		g_string_append (batch, "RSET\r\n");
 
-	cmdbuf = g_strdup ("DATA\r\n");
+	cmdbuf = smtp_mail_command (transport, sender, has_8bit_parts);
+	g_string_append (batch, cmdbuf);
+	g_free (cmdbuf);
 
-	d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+	for (ii = 0; ii < recipients->len; ii++) {
+		g_string_append_printf (batch, "RCPT TO:<%s>\r\n", (const gchar *) recipients->pdata[ii]);
+	}
 
-	if (camel_stream_write_string (ostream, cmdbuf, cancellable, error) == -1) {
-		g_free (cmdbuf);
-		g_prefix_error (error, _("DATA command failed: "));
+	if (with_data)
+		g_string_append (batch, "DATA\r\n");
+
+	d (fprintf (stderr, "[SMTP] sending: %s", batch->str));
+
+	if (camel_stream_write (ostream, batch->str, batch->len, cancellable, error) == -1) {
+		g_string_free (batch, TRUE);
+		g_prefix_error (error, _("MAIL FROM command failed: "));
 		camel_service_disconnect_sync (
 			CAMEL_SERVICE (transport),
 			FALSE, cancellable, NULL);
 		return FALSE;
 	}
-	g_free (cmdbuf);
 
-	respbuf = camel_stream_buffer_read_line (istream, cancellable, error);
-	d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
-	if (respbuf == NULL) {
-		g_prefix_error (error, _("DATA command failed: "));
+	g_string_free (batch, TRUE);
+
+	return TRUE;
+}
+
+/* Reads the replies to the envelope sent by smtp_envelope_write() */
+static gboolean
+smtp_envelope_read (CamelSmtpTransport *transport,
+		    CamelStreamBuffer *istream,
+		    GPtrArray *recipients,
+		    gboolean with_rset,
+		    gboolean with_data,
+		    gboolean *out_lost,
+		    GCancellable *cancellable,
+		    GError **error)
+{
+	gboolean lost = FALSE, data_accepted = FALSE;
+	GError *local_error = NULL;
+	guint ii;
+
+	/* Read all the replies, in the order of the commands, even after
+	 * a failure, to stay in sync with the server; the first error wins */
+	if (with_rset &&
+	    !smtp_read_reply (transport, istream, "250", &lost, cancellable, &local_error)) {
+		g_prefix_error (&local_error, _("RSET command failed: "));
+	}
+
+	if (!lost) {
+		GError *mail_error = NULL;
+
+		if (!smtp_read_reply (transport, istream, "250", &lost, cancellable, &mail_error)) {
+			g_prefix_error (&mail_error, _("MAIL FROM command failed: "));
+
+			if (local_error)
+				g_clear_error (&mail_error);
+			else
+				local_error = mail_error;
+		}
+	}
+
+	for (ii = 0; !lost && ii < recipients->len; ii++) {
+		GError *rcpt_error = NULL;
+
+		if (!smtp_read_reply (transport, istream, "250", &lost, cancellable, &rcpt_error)) {
+			g_prefix_error (
+				&rcpt_error, _("RCPT TO <%s> failed: "),
+				(const gchar *) recipients->pdata[ii]);
+
+			if (local_error)
+				g_clear_error (&rcpt_error);
+			else
+				local_error = rcpt_error;
+		}
+	}
+
+	if (with_data && !lost) {
+		GError *data_error = NULL;
+
+		/* We should get instructions on how to use the DATA
+		 * command: 354 Enter mail, end with "." on a line by itself
+		 */
+		data_accepted = smtp_read_reply (transport, istream, "354", &lost, cancellable, &data_error);
+		if (!data_accepted) {
+			g_prefix_error (&data_error, _("DATA command failed: "));
+
+			if (local_error)
+				g_clear_error (&data_error);
+			else
+				local_error = data_error;
+		}
+	}
+
+	/* The server waits for the message, but part of the envelope failed;
+	 * only dropping the connection can abort the transaction without
+	 * delivering the message to the accepted recipients */
+	if (lost || (data_accepted && local_error)) {
 		camel_service_disconnect_sync (
 			CAMEL_SERVICE (transport),
 			FALSE, cancellable, NULL);
-		return FALSE;
 	}
-	if (strncmp (respbuf, "354", 3) != 0) {
-		/* We should have gotten instructions on how to use the DATA
-		 * command: 354 Enter mail, end with "." on a line by itself
-		 */
-		smtp_set_error (transport, istream, respbuf, cancellable, error);
-		g_prefix_error (error, _("DATA command failed: "));
-		g_free (respbuf);
+
+	*out_lost = lost;
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
 		return FALSE;
 	}
 
-	g_free (respbuf);
-	respbuf = NULL;
+	return TRUE;
+}
+
+/* Returns the Bcc headers, which had been removed from the @message */
+static CamelNameValueArray *
+smtp_remove_bcc (CamelMimeMessage *message)
+{
+	CamelNameValueArray *previous_headers;
 
-	/* unlink the bcc headers and keep a copy of them */
 	previous_headers = camel_medium_dup_headers (CAMEL_MEDIUM (message));
 	camel_medium_remove_header (CAMEL_MEDIUM (message), "Bcc");
 
-	/* find out how large the message is... */
-	bytes_written = camel_data_wrapper_calculate_size_sync (CAMEL_DATA_WRAPPER (message), NULL, NULL);
+	return previous_headers;
+}
 
-	/* Set the upload timeout to an equal of 512 bytes per second */
-	smtp_maybe_update_socket_timeout (ostream, bytes_written / 512);
+static void
+smtp_restore_bcc (CamelMimeMessage *message,
+		  CamelNameValueArray *previous_headers)
+{
+	const gchar *header_name = NULL, *header_value = NULL;
+	guint ii;
+
+	for (ii = 0; camel_name_value_array_get (previous_headers, ii, &header_name, &header_value); ii++) {
+		if (!g_ascii_strcasecmp (header_name, "Bcc")) {
+			camel_medium_add_header (CAMEL_MEDIUM (message), header_name, header_value);
+		}
+	}
+
+	camel_name_value_array_free (previous_headers);
+}
+
+static void
+smtp_set_best_encoding (CamelSmtpTransport *transport,
+			CamelMimeMessage *message)
+{
+	CamelBestencEncoding enctype = CAMEL_BESTENC_8BIT;
+
+	/* If the server doesn't support 8BITMIME, set our required encoding to be 7bit */
+	if (!(transport->flags & CAMEL_SMTP_TRANSPORT_8BITMIME))
+		enctype = CAMEL_BESTENC_7BIT;
+
+	/* FIXME: should we get the best charset too?? */
+	/* Changes the encoding of all mime parts to fit within our required
+	 * encoding type and also force any text parts with long lines (longer
+	 * than 998 octets) to wrap by QP or base64 encoding them. */
+	camel_mime_message_set_best_encoding (
+		message, CAMEL_BESTENC_GET_ENCODING, enctype);
+}
+
+/* Writes the @message to the @ostream with LF->CRLF conversion */
+static gssize
+smtp_write_message (CamelStream *ostream,
+		    CamelMimeMessage *message,
+		    CamelMimeFilterCRLFMode crlf_mode,
+		    gsize progress_size,
+		    GCancellable *cancellable,
+		    GError **error)
+{
+	CamelStream *filtered_stream;
+	CamelMimeFilter *filter;
+	gssize ret;
 
 	filtered_stream = camel_stream_filter_new (ostream);
 
 	/* setup progress reporting for message sending... */
-	filter = camel_mime_filter_progress_new (cancellable, bytes_written);
+	filter = camel_mime_filter_progress_new (cancellable, progress_size);
 	camel_stream_filter_add (
 		CAMEL_STREAM_FILTER (filtered_stream), filter);
 	g_object_unref (filter);
@@ -1715,7 +1931,7 @@ smtp_data (CamelSmtpTransport *transport,
 	/* setup LF->CRLF conversion */
 	filter = camel_mime_filter_crlf_new (
 		CAMEL_MIME_FILTER_CRLF_ENCODE,
-		CAMEL_MIME_FILTER_CRLF_MODE_CRLF_DOTS);
+		crlf_mode);
 	camel_stream_filter_add (
 		CAMEL_STREAM_FILTER (filtered_stream), filter);
 	g_object_unref (filter);
@@ -1725,29 +1941,94 @@ smtp_data (CamelSmtpTransport *transport,
 		CAMEL_DATA_WRAPPER (message),
 		filtered_stream, cancellable, error);
 
-	/* restore the bcc headers */
-	for (ii = 0; camel_name_value_array_get (previous_headers, ii, &header_name, &header_value); ii++) {
-		if (!g_ascii_strcasecmp (header_name, "Bcc")) {
-			camel_medium_add_header (CAMEL_MEDIUM (message), header_name, header_value);
+	if (ret != -1 && camel_stream_flush (filtered_stream, cancellable, error) == -1)
+		ret = -1;
+
+	g_object_unref (filtered_stream);
+
+	return ret;
+}
+
+static gboolean
+smtp_data (CamelSmtpTransport *transport,
+	   CamelStreamBuffer *istream,
+	   CamelStream *ostream,
+           CamelMimeMessage *message,
+	   gboolean data_accepted,
+           GCancellable *cancellable,
+           GError **error)
+{
+	CamelNameValueArray *previous_headers;
+	gchar *cmdbuf, *respbuf = NULL;
+	gsize bytes_written;
+	gint ret;
+
+	smtp_set_best_encoding (transport, message);
+
+	/* the pipelined envelope has the DATA command already done */
+	if (!data_accepted) {
+		cmdbuf = g_strdup ("DATA\r\n");
+
+		d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+
+		if (camel_stream_write_string (ostream, cmdbuf, cancellable, error) == -1) {
+			g_free (cmdbuf);
+			g_prefix_error (error, _("DATA command failed: "));
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
+		g_free (cmdbuf);
+
+		respbuf = camel_stream_buffer_read_line (istream, cancellable, error);
+		d (fprintf (stderr, "[SMTP] received: %s\n", respbuf ? respbuf : "(null)"));
+		if (respbuf == NULL) {
+			g_prefix_error (error, _("DATA command failed: "));
+			camel_service_disconnect_sync (
+				CAMEL_SERVICE (transport),
+				FALSE, cancellable, NULL);
+			return FALSE;
+		}
+		if (strncmp (respbuf, "354", 3) != 0) {
+			/* We should have gotten instructions on how to use the DATA
+			 * command: 354 Enter mail, end with "." on a line by itself
+			 */
+			smtp_set_error (transport, istream, respbuf, cancellable, error);
+			g_prefix_error (error, _("DATA command failed: "));
+			g_free (respbuf);
+			return FALSE;
 		}
+
+		g_free (respbuf);
+		respbuf = NULL;
 	}
 
-	camel_name_value_array_free (previous_headers);
+	/* unlink the bcc headers and keep a copy of them */
+	previous_headers = smtp_remove_bcc (message);
+
+	/* find out how large the message is... */
+	bytes_written = camel_data_wrapper_calculate_size_sync (CAMEL_DATA_WRAPPER (message), NULL, NULL);
+
+	/* Set the upload timeout to an equal of 512 bytes per second */
+	smtp_maybe_update_socket_timeout (ostream, bytes_written / 512);
+
+	ret = smtp_write_message (
+		ostream, message, CAMEL_MIME_FILTER_CRLF_MODE_CRLF_DOTS,
+		bytes_written, cancellable, error);
+
+	/* restore the bcc headers */
+	smtp_restore_bcc (message, previous_headers);
 
 	if (ret == -1) {
 		g_prefix_error (error, _("DATA command failed: "));
 
-		g_object_unref (filtered_stream);
-
 		camel_service_disconnect_sync (
 			CAMEL_SERVICE (transport),
 			FALSE, cancellable, NULL);
 		return FALSE;
 	}
 
-	camel_stream_flush (filtered_stream, cancellable, NULL);
-	g_object_unref (filtered_stream);
-
 	/* terminate the message body */
 
 	d (fprintf (stderr, "[SMTP] sending: \\r\\n.\\r\\n\n"));
@@ -1784,6 +2065,258 @@ smtp_data (CamelSmtpTransport *transport,
 	return TRUE;
 }
 
+/* The message goes to the server in chunks of this size, see rfc3030 */
+#define SMTP_CHUNK_SIZE (64 * 1024)
+
+/* A stream sending what is written to it as BDAT chunks. Without PIPELINING,
+ * each chunk waits for its reply. With PIPELINING, the chunks go right behind
+ * the envelope and the replies to all of them are read only before the LAST
+ * chunk, which is sent from smtp_chunk_stream_finish(). Nothing is delivered
+ * before the LAST chunk, thus a rejected recipient still aborts the whole
+ * transaction, even when part of the message had been sent already. */
+typedef struct _SmtpChunkStream {
+	CamelStream parent;
+
+	CamelSmtpTransport *transport;
+	CamelStreamBuffer *istream;
+	CamelStream *ostream;
+
+	/* the pipelined envelope still waiting for its replies, if any */
+	GPtrArray *envelope_recipients;
+	gboolean envelope_rset;
+
+	guint n_pending_replies;
+	GByteArray *buffer;
+} SmtpChunkStream;
+
+typedef struct _SmtpChunkStreamClass {
+	CamelStreamClass parent_class;
+} SmtpChunkStreamClass;
+
+static GType smtp_chunk_stream_get_type (void);
+
+G_DEFINE_TYPE (SmtpChunkStream, smtp_chunk_stream, CAMEL_TYPE_STREAM)
+
+static gboolean
+smtp_chunk_stream_read_replies (SmtpChunkStream *chunk_stream,
+				GCancellable *cancellable,
+				GError **error)
+{
+	gboolean lost = FALSE;
+	GError *local_error = NULL;
+
+	/* Read all the replies, in the order of the commands, even after
+	 * a failure, to stay in sync with the server; the first error wins */
+	if (chunk_stream->envelope_recipients) {
+		smtp_envelope_read (
+			chunk_stream->transport, chunk_stream->istream,
+			chunk_stream->envelope_recipients, chunk_stream->envelope_rset,
+			FALSE, &lost, cancellable, &local_error);
+
+		chunk_stream->envelope_recipients = NULL;
+
+		/* the connection had been dropped already */
+		if (lost) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+	}
+
+	while (!lost && chunk_stream->n_pending_replies > 0) {
+		GError *bdat_error = NULL;
+
+		chunk_stream->n_pending_replies--;
+
+		if (!smtp_read_reply (chunk_stream->transport, chunk_stream->istream, "250", &lost, cancellable, &bdat_error)) {
+			g_prefix_error (&bdat_error, _("BDAT command failed: "));
+
+			if (local_error)
+				g_clear_error (&bdat_error);
+			else
+				local_error = bdat_error;
+		}
+	}
+
+	if (lost) {
+		camel_service_disconnect_sync (
+			CAMEL_SERVICE (chunk_stream->transport),
+			FALSE, cancellable, NULL);
+	}
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+smtp_chunk_stream_send (SmtpChunkStream *chunk_stream,
+			gsize size,
+			gboolean last,
+			GCancellable *cancellable,
+			GError **error)
+{
+	gchar *cmdbuf;
+
+	/* the command is immediately followed by the chunk itself */
+	cmdbuf = g_strdup_printf ("BDAT %" G_GSIZE_FORMAT "%s\r\n", size, last ? " LAST" : "");
+
+	d (fprintf (stderr, "[SMTP] sending: %s", cmdbuf));
+
+	if (camel_stream_write_string (chunk_stream->ostream, cmdbuf, cancellable, error) == -1 ||
+	    (size > 0 && camel_stream_write (chunk_stream->ostream, (const gchar *) chunk_stream->buffer->data,
+		size, cancellable, error) == -1)) {
+		g_free (cmdbuf);
+		g_prefix_error (error, _("BDAT command failed: "));
+		camel_service_disconnect_sync (
+			CAMEL_SERVICE (chunk_stream->transport),
+			FALSE, cancellable, NULL);
+		return FALSE;
+	}
+
+	g_free (cmdbuf);
+	g_byte_array_remove_range (chunk_stream->buffer, 0, size);
+
+	chunk_stream->n_pending_replies++;
+
+	if (last || !(chunk_stream->transport->flags & CAMEL_SMTP_TRANSPORT_PIPELINING))
+		return smtp_chunk_stream_read_replies (chunk_stream, cancellable, error);
+
+	return TRUE;
+}
+
+static gssize
+smtp_chunk_stream_write (CamelStream *stream,
+			 const gchar *buffer,
+			 gsize n,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	SmtpChunkStream *chunk_stream = (SmtpChunkStream *) stream;
+
+	g_byte_array_append (chunk_stream->buffer, (const guint8 *) buffer, n);
+
+	/* A chunk is sent only when more data follows it; the rest
+	 * is sent as the LAST chunk by smtp_chunk_stream_finish() */
+	while (chunk_stream->buffer->len > SMTP_CHUNK_SIZE) {
+		if (!smtp_chunk_stream_send (chunk_stream, SMTP_CHUNK_SIZE, FALSE, cancellable, error))
+			return -1;
+	}
+
+	return n;
+}
+
+static void
+smtp_chunk_stream_finalize (GObject *object)
+{
+	SmtpChunkStream *chunk_stream = (SmtpChunkStream *) object;
+
+	g_clear_object (&chunk_stream->transport);
+	g_clear_object (&chunk_stream->istream);
+	g_clear_object (&chunk_stream->ostream);
+	g_byte_array_unref (chunk_stream->buffer);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (smtp_chunk_stream_parent_class)->finalize (object);
+}
+
+static void
+smtp_chunk_stream_class_init (SmtpChunkStreamClass *class)
+{
+	GObjectClass *object_class;
+	CamelStreamClass *stream_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = smtp_chunk_stream_finalize;
+
+	stream_class = CAMEL_STREAM_CLASS (class);
+	stream_class->write = smtp_chunk_stream_write;
+}
+
+static void
+smtp_chunk_stream_init (SmtpChunkStream *chunk_stream)
+{
+	chunk_stream->buffer = g_byte_array_sized_new (SMTP_CHUNK_SIZE);
+}
+
+static CamelStream *
+smtp_chunk_stream_new (CamelSmtpTransport *transport,
+		       CamelStreamBuffer *istream,
+		       CamelStream *ostream,
+		       GPtrArray *envelope_recipients,
+		       gboolean envelope_rset)
+{
+	SmtpChunkStream *chunk_stream;
+
+	chunk_stream = g_object_new (smtp_chunk_stream_get_type (), NULL);
+	chunk_stream->transport = g_object_ref (transport);
+	chunk_stream->istream = g_object_ref (istream);
+	chunk_stream->ostream = g_object_ref (ostream);
+	chunk_stream->envelope_recipients = envelope_recipients;
+	chunk_stream->envelope_rset = envelope_rset;
+
+	return CAMEL_STREAM (chunk_stream);
+}
+
+/* Sends the LAST chunk, once everything before it had been accepted */
+static gboolean
+smtp_chunk_stream_finish (CamelStream *stream,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	SmtpChunkStream *chunk_stream = (SmtpChunkStream *) stream;
+
+	if (!smtp_chunk_stream_read_replies (chunk_stream, cancellable, error))
+		return FALSE;
+
+	return smtp_chunk_stream_send (chunk_stream, chunk_stream->buffer->len, TRUE, cancellable, error);
+}
+
+static gboolean
+smtp_bdat (CamelSmtpTransport *transport,
+	   CamelStreamBuffer *istream,
+	   CamelStream *ostream,
+	   CamelMimeMessage *message,
+	   GPtrArray *pipelined_recipients,
+	   gboolean pipelined_rset,
+	   GCancellable *cancellable,
+	   GError **error)
+{
+	CamelNameValueArray *previous_headers;
+	CamelStream *chunk_stream;
+	gsize size;
+	gboolean success;
+
+	smtp_set_best_encoding (transport, message);
+
+	/* unlink the bcc headers and keep a copy of them */
+	previous_headers = smtp_remove_bcc (message);
+
+	/* find out how large the message is... */
+	size = camel_data_wrapper_calculate_size_sync (CAMEL_DATA_WRAPPER (message), NULL, NULL);
+
+	/* Set the upload timeout to an equal of 512 bytes per second */
+	smtp_maybe_update_socket_timeout (ostream, size / 512);
+
+	chunk_stream = smtp_chunk_stream_new (transport, istream, ostream, pipelined_recipients, pipelined_rset);
+
+	/* rfc3030 (CHUNKING) sends the message as is, without dot-stuffing */
+	success = smtp_write_message (
+		chunk_stream, message, CAMEL_MIME_FILTER_CRLF_MODE_CRLF_ONLY,
+		size, cancellable, error) != -1;
+
+	/* restore the bcc headers */
+	smtp_restore_bcc (message, previous_headers);
+
+	success = success && smtp_chunk_stream_finish (chunk_stream, cancellable, error);
+
+	g_object_unref (chunk_stream);
+
+	return success;
+}
+
 static gboolean
 smtp_rset (CamelSmtpTransport *transport,
 	   CamelStreamBuffer *istream,
@@ -0,0 +1,191 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* IMAP IDLE flag change storm, against a local fake IMAP server */
+
+#include <stdlib.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "imap-server.h"
+#include "session.h"
+
+#define N_MESSAGES (2000)
+
+/* The IDLE flag changes are saved into the summary in batches, each batch
+ * followed by one "changed" signal on the folder; without the batching
+ * there is one for every untagged FETCH. */
+#define MAX_SAVES (20)
+
+static const gchar *imapx_drivers[] = { "imapx" };
+
+static volatile gint storm_sent = 0;
+
+/* Someone marked the whole folder as read elsewhere */
+static void
+storm_idle_cb (TestIMAPServer *server,
+               GOutputStream *output,
+               gpointer user_data)
+{
+	guint32 ii;
+
+	if (!g_atomic_int_compare_and_exchange (&storm_sent, 0, 1))
+		return;
+
+	for (ii = 1; ii <= N_MESSAGES; ii++) {
+		test_imap_server_set_seen (server, ii, TRUE);
+		test_imap_server_write (output, "* %u FETCH (UID %u FLAGS (\\Seen))\r\n", ii, ii);
+	}
+}
+
+static gboolean
+folder_changed_hook_cb (GSignalInvocationHint *ihint,
+                        guint n_param_values,
+                        const GValue *param_values,
+                        gpointer user_data)
+{
+	gpointer *data = user_data;
+
+	if (n_param_values > 0 && g_value_get_object (&param_values[0]) == data[0])
+		(*((guint *) data[1]))++;
+
+	return TRUE;
+}
+
+static void
+iterate_main_context (gint64 msecs)
+{
+	gint64 end_time = g_get_monotonic_time () + msecs * 1000;
+
+	while (g_get_monotonic_time () < end_time) {
+		if (!g_main_context_iteration (NULL, FALSE))
+			g_usleep (10000);
+	}
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolder *folder;
+	CamelFolderSummary *summary;
+	TestIMAPServer *server;
+	gpointer hook_data[2];
+	guint n_changed = 0;
+	gulong hook_id;
+	gint64 end_time;
+	GError *error = NULL;
+
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, imapx_drivers);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("IMAP IDLE flag changes are saved in batches");
+
+	server = test_imap_server_new (N_MESSAGES, 0);
+	test_imap_server_set_idle_func (server, storm_idle_cb, NULL);
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	camel_session_set_online (session, TRUE);
+
+	push ("connecting to the fake server");
+	service = camel_session_add_service (session, "imapx-idle-test", "imapx", CAMEL_PROVIDER_STORE, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (service != NULL);
+
+	settings = camel_service_ref_settings (service);
+	g_object_set (
+		settings,
+		"host", "127.0.0.1",
+		"port", (guint) test_imap_server_get_port (server),
+		"user", "user",
+		"security-method", CAMEL_NETWORK_SECURITY_METHOD_NONE,
+		"concurrent-connections", 1,
+		"use-idle", TRUE,
+		"use-qresync", FALSE,
+		NULL);
+	g_object_unref (settings);
+
+	camel_service_set_password (service, "password");
+
+	camel_service_connect_sync (service, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	push ("getting and refreshing INBOX");
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), "INBOX", 0, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (folder != NULL);
+
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	summary = camel_folder_get_folder_summary (folder);
+	check_msg (camel_folder_summary_count (summary) == N_MESSAGES,
+		"Expected %d messages, got %d", N_MESSAGES, camel_folder_summary_count (summary));
+	check (camel_folder_summary_get_unread_count (summary) == N_MESSAGES);
+	pull ();
+
+	push ("receiving flag changes in IDLE");
+
+	/* A frozen folder emits "changed" for each camel_folder_changed() call */
+	camel_folder_freeze (folder);
+
+	hook_data[0] = folder;
+	hook_data[1] = &n_changed;
+	hook_id = g_signal_add_emission_hook (
+		g_signal_lookup ("changed", CAMEL_TYPE_FOLDER), 0,
+		folder_changed_hook_cb, hook_data, NULL);
+
+	end_time = g_get_monotonic_time () + 60 * G_USEC_PER_SEC;
+
+	while (camel_folder_summary_get_unread_count (summary) > 0 &&
+	       g_get_monotonic_time () < end_time) {
+		iterate_main_context (100);
+	}
+
+	check_msg (camel_folder_summary_get_unread_count (summary) == 0,
+		"Expected all messages read, %d unread", camel_folder_summary_get_unread_count (summary));
+
+	/* Let the pending save run */
+	iterate_main_context (2000);
+
+	g_signal_remove_emission_hook (g_signal_lookup ("changed", CAMEL_TYPE_FOLDER), hook_id);
+
+	check_msg (n_changed >= 1, "Expected at least one summary save");
+	check_msg (n_changed <= MAX_SAVES, "Expected at most %d summary saves, got %u", MAX_SAVES, n_changed);
+
+	camel_folder_thaw (folder);
+	pull ();
+
+	push ("disconnecting");
+	camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	g_object_unref (folder);
+	g_object_unref (service);
+	check_unref (session, 1);
+
+	test_imap_server_free (server);
+
+	camel_test_end ();
+
+	return 0;
+}
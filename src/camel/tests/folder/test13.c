@@ -0,0 +1,133 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* IMAP offline downsync timing, against a local fake IMAP server */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "imap-server.h"
+#include "session.h"
+
+#define N_MESSAGES (10000)
+#define BODY_SIZE (4096)
+#define N_CONNECTIONS (3)
+
+static const gchar *imapx_drivers[] = { "imapx" };
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolder *folder;
+	CamelMimeMessage *message;
+	TestIMAPServer *server;
+	GTimer *timer;
+	GError *error = NULL;
+
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, imapx_drivers);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("IMAP offline downsync of many messages");
+
+	server = test_imap_server_new (N_MESSAGES, BODY_SIZE);
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	camel_session_set_online (session, TRUE);
+
+	push ("connecting to the fake server");
+	service = camel_session_add_service (session, "imapx-downsync-test", "imapx", CAMEL_PROVIDER_STORE, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (service != NULL);
+
+	settings = camel_service_ref_settings (service);
+	g_object_set (
+		settings,
+		"host", "127.0.0.1",
+		"port", (guint) test_imap_server_get_port (server),
+		"user", "user",
+		"security-method", CAMEL_NETWORK_SECURITY_METHOD_NONE,
+		"concurrent-connections", N_CONNECTIONS,
+		"use-idle", FALSE,
+		"use-qresync", FALSE,
+		NULL);
+	g_object_unref (settings);
+
+	camel_service_set_password (service, "password");
+
+	camel_service_connect_sync (service, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	push ("getting and refreshing INBOX");
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), "INBOX", 0, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (folder != NULL);
+
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (camel_folder_summary_count (camel_folder_get_folder_summary (folder)) == N_MESSAGES);
+	pull ();
+
+	push ("downloading %d messages for offline use", N_MESSAGES);
+	timer = g_timer_new ();
+
+	camel_offline_folder_downsync_sync (CAMEL_OFFLINE_FOLDER (folder), NULL, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	g_timer_stop (timer);
+	printf ("Downloaded %d messages of %d bytes over %d connections in %.3f seconds\n",
+		N_MESSAGES, BODY_SIZE, N_CONNECTIONS, g_timer_elapsed (timer, NULL));
+	g_timer_destroy (timer);
+
+	check_msg (test_imap_server_get_n_bodies_sent (server) == N_MESSAGES,
+		"Expected %d message bodies sent, got %u", N_MESSAGES, test_imap_server_get_n_bodies_sent (server));
+	pull ();
+
+	push ("reading a message from the cache, while offline");
+	camel_offline_store_set_online_sync (CAMEL_OFFLINE_STORE (service), FALSE, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	message = camel_folder_get_message_sync (folder, "5000", NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (message != NULL);
+	check (g_strcmp0 (camel_mime_message_get_subject (message), "Message 5000") == 0);
+	g_object_unref (message);
+
+	check (test_imap_server_get_n_bodies_sent (server) == N_MESSAGES);
+	pull ();
+
+	push ("disconnecting");
+	camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	g_object_unref (folder);
+	g_object_unref (service);
+	check_unref (session, 1);
+
+	test_imap_server_free (server);
+
+	camel_test_end ();
+
+	return 0;
+}
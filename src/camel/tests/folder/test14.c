@@ -0,0 +1,149 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* NNTP summary fetching timing, against a local fake NNTP server */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "nntp-server.h"
+#include "session.h"
+
+#define GROUP_NAME "test.group"
+#define N_ARTICLES (5000)
+#define CHUNK_SIZE (500) /* as NNTP_CHUNK_SIZE in camel-nntp-summary.c */
+
+static const gchar *nntp_drivers[] = { "nntp" };
+
+static void
+test_summary_fetch (TestNNTPServerFlags flags,
+                    const gchar *mode)
+{
+	CamelSession *session;
+	CamelService *service;
+	CamelSettings *settings;
+	CamelFolderInfo *fi;
+	CamelFolder *folder;
+	TestNNTPServer *server;
+	GTimer *timer;
+	GError *error = NULL;
+	guint n_chunks = (N_ARTICLES + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	server = test_nntp_server_new (GROUP_NAME, N_ARTICLES, flags);
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	camel_session_set_online (session, TRUE);
+
+	push ("connecting to the fake server");
+	service = camel_session_add_service (session, "nntp-summary-test", "nntp", CAMEL_PROVIDER_STORE, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (service != NULL);
+
+	settings = camel_service_ref_settings (service);
+	g_object_set (
+		settings,
+		"host", "127.0.0.1",
+		"port", (guint) test_nntp_server_get_port (server),
+		"security-method", CAMEL_NETWORK_SECURITY_METHOD_NONE,
+		NULL);
+	g_object_unref (settings);
+
+	camel_service_connect_sync (service, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	fi = camel_store_get_folder_info_sync (CAMEL_STORE (service), NULL, CAMEL_STORE_FOLDER_INFO_SUBSCRIPTION_LIST, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	camel_folder_info_free (fi);
+	pull ();
+
+	push ("fetching the summary of %d articles with %s", N_ARTICLES, mode);
+	timer = g_timer_new ();
+
+	folder = camel_store_get_folder_sync (CAMEL_STORE (service), GROUP_NAME, 0, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (folder != NULL);
+
+	g_timer_stop (timer);
+	printf ("Fetched the summary of %d articles with %s in %.3f seconds, %u commands pipelined\n",
+		N_ARTICLES, mode, g_timer_elapsed (timer, NULL), test_nntp_server_get_n_pipelined (server));
+	g_timer_destroy (timer);
+
+	check_msg (camel_folder_summary_count (camel_folder_get_folder_summary (folder)) == N_ARTICLES,
+		"Expected %d articles, got %d", N_ARTICLES, camel_folder_summary_count (camel_folder_get_folder_summary (folder)));
+	check (test_nntp_server_get_n_pipelined (server) > 0);
+
+	if ((flags & TEST_NNTP_SERVER_OVER) != 0) {
+		check_msg (test_nntp_server_get_n_over (server) == n_chunks,
+			"Expected %u OVER commands, got %u", n_chunks, test_nntp_server_get_n_over (server));
+		check (test_nntp_server_get_n_head (server) == 0);
+	} else if ((flags & TEST_NNTP_SERVER_HDR) != 0) {
+		check_msg (test_nntp_server_get_n_hdr (server) == 5 * n_chunks,
+			"Expected %u HDR commands, got %u", 5 * n_chunks, test_nntp_server_get_n_hdr (server));
+		check (test_nntp_server_get_n_head (server) == 0);
+	} else {
+		check_msg (test_nntp_server_get_n_head (server) == N_ARTICLES,
+			"Expected %d HEAD commands, got %u", N_ARTICLES, test_nntp_server_get_n_head (server));
+	}
+	pull ();
+
+	push ("refreshing without new articles");
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (camel_folder_summary_count (camel_folder_get_folder_summary (folder)) == N_ARTICLES);
+	pull ();
+
+	push ("disconnecting");
+	camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	g_object_unref (folder);
+	g_object_unref (service);
+	check_unref (session, 1);
+
+	test_nntp_server_free (server);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, nntp_drivers);
+
+	camel_test_start ("NNTP summary fetching of many articles");
+
+	push ("OVER");
+	test_summary_fetch (TEST_NNTP_SERVER_OVER, "OVER");
+	pull ();
+
+	push ("HDR");
+	test_summary_fetch (TEST_NNTP_SERVER_HDR, "HDR");
+	pull ();
+
+	push ("HEAD");
+	test_summary_fetch (0, "HEAD");
+	pull ();
+
+	camel_test_end ();
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
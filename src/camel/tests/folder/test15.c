@@ -0,0 +1,502 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Junk learning of many flagged messages, prefetched from a fake store */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "session.h"
+
+#define N_MESSAGES (300)
+#define MESSAGE_SIZE (4096)
+#define BATCH_SIZE (50) /* as JUNK_LEARN_BATCH_SIZE in camel-folder.c */
+#define LATENCY (2000) /* microseconds of one download */
+
+/* a store, only to be the parent of the folder */
+typedef struct _TestFakeStore {
+	CamelStore parent;
+} TestFakeStore;
+
+typedef struct _TestFakeStoreClass {
+	CamelStoreClass parent_class;
+} TestFakeStoreClass;
+
+G_DEFINE_TYPE (TestFakeStore, test_fake_store, CAMEL_TYPE_STORE)
+
+/* a folder with a slow server and a local cache of the messages */
+typedef struct _TestFakeFolder {
+	CamelFolder parent;
+
+	GMutex lock;
+	GHashTable *cached;
+	guint n_downloads;
+	guint n_batch_downloads;
+	guint n_cache_hits;
+} TestFakeFolder;
+
+typedef struct _TestFakeFolderClass {
+	CamelFolderClass parent_class;
+} TestFakeFolderClass;
+
+G_DEFINE_TYPE (TestFakeFolder, test_fake_folder, CAMEL_TYPE_FOLDER)
+
+/* a junk filter remembering what it learned */
+typedef struct _TestJunkFilter {
+	GObject parent;
+
+	GPtrArray *learned_junk;
+	GPtrArray *learned_not_junk;
+	guint n_batches;
+} TestJunkFilter;
+
+typedef struct _TestJunkFilterClass {
+	GObjectClass parent_class;
+} TestJunkFilterClass;
+
+static void test_junk_filter_interface_init (CamelJunkFilterInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestJunkFilter, test_junk_filter, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (CAMEL_TYPE_JUNK_FILTER, test_junk_filter_interface_init))
+
+static GMutex alive_lock;
+static gint n_alive, peak_alive;
+
+static void
+message_finalized_cb (gpointer user_data,
+                      GObject *message)
+{
+	g_mutex_lock (&alive_lock);
+	n_alive--;
+	g_mutex_unlock (&alive_lock);
+}
+
+static CamelMimeMessage *
+create_message (const gchar *uid)
+{
+	CamelMimeMessage *message;
+
+	message = camel_mime_message_new ();
+	camel_mime_message_set_subject (message, uid);
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "text\n", 5, "text/plain");
+
+	g_mutex_lock (&alive_lock);
+	n_alive++;
+	peak_alive = MAX (peak_alive, n_alive);
+	g_mutex_unlock (&alive_lock);
+
+	g_object_weak_ref (G_OBJECT (message), message_finalized_cb, NULL);
+
+	return message;
+}
+
+static void
+test_fake_store_class_init (TestFakeStoreClass *class)
+{
+}
+
+static void
+test_fake_store_init (TestFakeStore *store)
+{
+}
+
+static CamelMimeMessage *
+test_fake_folder_get_message_sync (CamelFolder *folder,
+                                   const gchar *message_uid,
+                                   GCancellable *cancellable,
+                                   GError **error)
+{
+	TestFakeFolder *fake = (TestFakeFolder *) folder;
+
+	g_mutex_lock (&fake->lock);
+
+	if (g_hash_table_contains (fake->cached, message_uid)) {
+		fake->n_cache_hits++;
+	} else {
+		fake->n_downloads++;
+		g_usleep (LATENCY);
+		g_hash_table_add (fake->cached, g_strdup (message_uid));
+	}
+
+	g_mutex_unlock (&fake->lock);
+
+	return create_message (message_uid);
+}
+
+static CamelMimeMessage *
+test_fake_folder_get_message_cached (CamelFolder *folder,
+                                     const gchar *message_uid,
+                                     GCancellable *cancellable)
+{
+	TestFakeFolder *fake = (TestFakeFolder *) folder;
+	gboolean cached;
+
+	g_mutex_lock (&fake->lock);
+	cached = g_hash_table_contains (fake->cached, message_uid);
+	if (cached)
+		fake->n_cache_hits++;
+	g_mutex_unlock (&fake->lock);
+
+	return cached ? create_message (message_uid) : NULL;
+}
+
+static gboolean
+test_fake_folder_synchronize_messages_sync (CamelFolder *folder,
+                                            GPtrArray *message_uids,
+                                            GCancellable *cancellable,
+                                            GError **error)
+{
+	TestFakeFolder *fake = (TestFakeFolder *) folder;
+	guint ii;
+
+	g_mutex_lock (&fake->lock);
+
+	fake->n_batch_downloads++;
+	g_usleep (LATENCY);
+
+	for (ii = 0; ii < message_uids->len; ii++)
+		g_hash_table_add (fake->cached, g_strdup (message_uids->pdata[ii]));
+
+	g_mutex_unlock (&fake->lock);
+
+	return TRUE;
+}
+
+static void
+test_fake_folder_finalize (GObject *object)
+{
+	TestFakeFolder *fake = (TestFakeFolder *) object;
+
+	g_hash_table_destroy (fake->cached);
+	g_mutex_clear (&fake->lock);
+
+	G_OBJECT_CLASS (test_fake_folder_parent_class)->finalize (object);
+}
+
+static void
+test_fake_folder_class_init (TestFakeFolderClass *class)
+{
+	GObjectClass *object_class;
+	CamelFolderClass *folder_class;
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->finalize = test_fake_folder_finalize;
+
+	folder_class = CAMEL_FOLDER_CLASS (class);
+	folder_class->get_message_sync = test_fake_folder_get_message_sync;
+	folder_class->get_message_cached = test_fake_folder_get_message_cached;
+	folder_class->synchronize_messages_sync = test_fake_folder_synchronize_messages_sync;
+}
+
+static void
+test_fake_folder_init (TestFakeFolder *fake)
+{
+	g_mutex_init (&fake->lock);
+	fake->cached = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static CamelJunkStatus
+test_junk_filter_classify (CamelJunkFilter *junk_filter,
+                           CamelMimeMessage *message,
+                           GCancellable *cancellable,
+                           GError **error)
+{
+	return CAMEL_JUNK_STATUS_INCONCLUSIVE;
+}
+
+static void
+test_junk_filter_learn (GPtrArray *learned,
+                        GPtrArray *messages)
+{
+	guint ii;
+
+	for (ii = 0; ii < messages->len; ii++) {
+		g_ptr_array_add (learned, g_strdup (camel_mime_message_get_subject (messages->pdata[ii])));
+
+		/* some processing time */
+		g_usleep (LATENCY / 4);
+	}
+}
+
+static gboolean
+test_junk_filter_learn_junk_batch (CamelJunkFilter *junk_filter,
+                                   GPtrArray *messages,
+                                   GCancellable *cancellable,
+                                   GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_batches++;
+	test_junk_filter_learn (tjf->learned_junk, messages);
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_learn_not_junk_batch (CamelJunkFilter *junk_filter,
+                                       GPtrArray *messages,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_batches++;
+	test_junk_filter_learn (tjf->learned_not_junk, messages);
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_learn_single (CamelJunkFilter *junk_filter,
+                               CamelMimeMessage *message,
+                               GCancellable *cancellable,
+                               GError **error)
+{
+	/* the batch methods are used */
+	g_return_val_if_reached (FALSE);
+}
+
+static void
+test_junk_filter_interface_init (CamelJunkFilterInterface *iface)
+{
+	iface->classify = test_junk_filter_classify;
+	iface->learn_junk = test_junk_filter_learn_single;
+	iface->learn_not_junk = test_junk_filter_learn_single;
+	iface->learn_junk_batch = test_junk_filter_learn_junk_batch;
+	iface->learn_not_junk_batch = test_junk_filter_learn_not_junk_batch;
+}
+
+static void
+test_junk_filter_class_init (TestJunkFilterClass *class)
+{
+}
+
+static void
+test_junk_filter_init (TestJunkFilter *tjf)
+{
+	tjf->learned_junk = g_ptr_array_new_with_free_func (g_free);
+	tjf->learned_not_junk = g_ptr_array_new_with_free_func (g_free);
+}
+
+static gchar *
+message_uid (gint index)
+{
+	return g_strdup_printf ("%04d", index);
+}
+
+static gboolean
+is_junk (gint index)
+{
+	return (index % 3) == 0;
+}
+
+static void
+job_finished_cb (CamelSession *session,
+                 GCancellable *cancellable,
+                 const GError *error,
+                 GMainLoop *loop)
+{
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	g_main_loop_quit (loop);
+}
+
+static void
+test_learning (CamelSession *session,
+               TestFakeFolder *fake,
+               TestJunkFilter *tjf,
+               guint depth,
+               guint64 memory,
+               gint max_alive)
+{
+	CamelFolder *folder = CAMEL_FOLDER (fake);
+	CamelFolderSummary *summary = camel_folder_get_folder_summary (folder);
+	CamelFolderChangeInfo *changes;
+	GMainLoop *loop;
+	GTimer *timer;
+	gulong handler_id;
+	guint n_junk = 0, n_not_junk = 0, expected_downloads;
+	gint ii;
+
+	camel_session_set_junk_learn_prefetch_depth (session, depth);
+	camel_session_set_junk_learn_prefetch_memory (session, memory);
+
+	/* every fourth message was downloaded already */
+	g_hash_table_remove_all (fake->cached);
+	fake->n_downloads = 0;
+	fake->n_batch_downloads = 0;
+	fake->n_cache_hits = 0;
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		if ((ii % 4) == 0)
+			g_hash_table_add (fake->cached, message_uid (ii));
+	}
+
+	g_ptr_array_set_size (tjf->learned_junk, 0);
+	g_ptr_array_set_size (tjf->learned_not_junk, 0);
+	tjf->n_batches = 0;
+	peak_alive = 0;
+
+	changes = camel_folder_change_info_new ();
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMessageInfo *info;
+		gchar *uid = message_uid (ii);
+
+		info = camel_folder_summary_get (summary, uid);
+		check (info != NULL);
+
+		camel_message_info_set_flags (
+			info, CAMEL_MESSAGE_JUNK | CAMEL_MESSAGE_JUNK_LEARN,
+			(is_junk (ii) ? CAMEL_MESSAGE_JUNK : 0) | CAMEL_MESSAGE_JUNK_LEARN);
+		camel_folder_change_info_change_uid (changes, uid);
+
+		if (is_junk (ii))
+			n_junk++;
+		else
+			n_not_junk++;
+
+		g_object_unref (info);
+		g_free (uid);
+	}
+
+	loop = g_main_loop_new (NULL, FALSE);
+	handler_id = g_signal_connect (session, "job-finished", G_CALLBACK (job_finished_cb), loop);
+
+	timer = g_timer_new ();
+
+	camel_folder_changed (folder, changes);
+	camel_folder_change_info_free (changes);
+
+	g_main_loop_run (loop);
+
+	g_timer_stop (timer);
+	printf ("Learned %d messages in %.3f seconds, at most %d messages in memory\n",
+		N_MESSAGES, g_timer_elapsed (timer, NULL), peak_alive);
+	g_timer_destroy (timer);
+
+	g_signal_handler_disconnect (session, handler_id);
+	g_main_loop_unref (loop);
+
+	check_msg (tjf->learned_junk->len == n_junk, "Learned %u junk messages, expected %u", tjf->learned_junk->len, n_junk);
+	check_msg (tjf->learned_not_junk->len == n_not_junk, "Learned %u not junk messages, expected %u", tjf->learned_not_junk->len, n_not_junk);
+
+	/* learned in the order of the changes */
+	for (ii = 0, n_junk = 0, n_not_junk = 0; ii < N_MESSAGES; ii++) {
+		GPtrArray *learned = is_junk (ii) ? tjf->learned_junk : tjf->learned_not_junk;
+		guint index = is_junk (ii) ? n_junk++ : n_not_junk++;
+		gchar *uid = message_uid (ii);
+
+		check_msg (g_strcmp0 (learned->pdata[index], uid) == 0, "Learned %s instead of %s", (gchar *) learned->pdata[index], uid);
+		g_free (uid);
+	}
+
+	/* full batches, but the last of each kind */
+	check_msg (tjf->n_batches == (n_junk + BATCH_SIZE - 1) / BATCH_SIZE + (n_not_junk + BATCH_SIZE - 1) / BATCH_SIZE,
+		"Learned in %u batches", tjf->n_batches);
+
+	/* the messages not in the cache are downloaded together, per chunk */
+	expected_downloads = (n_junk + BATCH_SIZE - 1) / BATCH_SIZE + (n_not_junk + BATCH_SIZE - 1) / BATCH_SIZE;
+	check_msg (fake->n_batch_downloads == expected_downloads, "%u batch downloads, expected %u", fake->n_batch_downloads, expected_downloads);
+	check_msg (fake->n_downloads == 0, "%u single downloads", fake->n_downloads);
+
+	check_msg (peak_alive <= max_alive, "%d messages in memory at once, expected at most %d", peak_alive, max_alive);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		gchar *uid = message_uid (ii);
+
+		check ((camel_folder_summary_get_info_flags (summary, uid) & CAMEL_MESSAGE_JUNK_LEARN) == 0);
+		g_free (uid);
+	}
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelFolderSummary *summary;
+	CamelStore *store;
+	TestFakeFolder *fake;
+	TestJunkFilter *tjf;
+	GError *error = NULL;
+	gint ii;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("Junk learning prefetch of many flagged messages");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	tjf = g_object_new (test_junk_filter_get_type (), NULL);
+	camel_session_set_junk_filter (session, CAMEL_JUNK_FILTER (tjf));
+
+	push ("creating a fake store");
+	store = g_initable_new (
+		test_fake_store_get_type (), NULL, &error,
+		"session", session,
+		"uid", "fake",
+		"display-name", "Fake",
+		NULL);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (store != NULL);
+
+	fake = g_object_new (
+		test_fake_folder_get_type (),
+		"display-name", "Inbox",
+		"full-name", "INBOX",
+		"parent-store", store,
+		NULL);
+
+	summary = camel_folder_summary_new (CAMEL_FOLDER (fake));
+	camel_folder_take_folder_summary (CAMEL_FOLDER (fake), summary);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMessageInfo *info;
+		gchar *uid = message_uid (ii);
+
+		info = camel_message_info_new (summary);
+		camel_message_info_set_uid (info, uid);
+		camel_message_info_set_size (info, MESSAGE_SIZE);
+		camel_folder_summary_add (summary, info, TRUE);
+
+		g_object_unref (info);
+		g_free (uid);
+	}
+	pull ();
+
+	/* the queue, a chunk being downloaded and a batch being learned */
+	push ("prefetch limited by the count of messages");
+	test_learning (session, fake, tjf, 60, G_MAXUINT64, 60 + 2 * BATCH_SIZE);
+	pull ();
+
+	push ("prefetch limited by the size of messages");
+	test_learning (session, fake, tjf, 1000, 10 * MESSAGE_SIZE, 3 * BATCH_SIZE);
+	pull ();
+
+	g_object_unref (fake);
+	g_object_unref (store);
+	g_object_unref (tjf);
+	g_object_unref (session);
+
+	camel_test_end ();
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
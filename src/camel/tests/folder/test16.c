@@ -0,0 +1,223 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Background content indexing of local folders, searched while it runs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "messages.h"
+#include "folders.h"
+#include "session.h"
+
+#define N_MESSAGES (500)
+#define WAIT_TIMEOUT (120) /* seconds */
+
+static const gchar *local_drivers[] = { "local" };
+
+static const gchar *stores[] = {
+	"mbox:///tmp/camel-test/mbox",
+	"mh:///tmp/camel-test/mh",
+	"maildir:///tmp/camel-test/maildir"
+};
+
+static void
+test_folder_search_count (CamelFolder *folder,
+                          const gchar *expr,
+                          gint expected)
+{
+	GPtrArray *uids;
+	GError *error = NULL;
+
+	uids = camel_folder_search_by_expression (folder, expr, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (uids != NULL);
+	check_msg (uids->len == expected, "search %s expected %d got %d", expr, expected, uids->len);
+	g_clear_error (&error);
+
+	camel_folder_search_free (folder, uids);
+}
+
+static void
+run_searches (CamelFolder *folder)
+{
+	gint ii;
+
+	test_folder_search_count (folder, "(body-contains \"content\")", N_MESSAGES);
+	test_folder_search_count (folder, "(body-contains \"nowhere\")", 0);
+
+	for (ii = 0; ii < N_MESSAGES; ii += N_MESSAGES / 10) {
+		gchar *expr = g_strdup_printf ("(body-contains \"unique%dx\")", ii);
+
+		test_folder_search_count (folder, expr, 1);
+		g_free (expr);
+	}
+}
+
+static guint
+count_index_queue (CamelStore *store,
+                   CamelFolder *folder)
+{
+	GPtrArray *uids;
+	GArray *offsets;
+	guint len;
+	GError *error = NULL;
+
+	uids = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
+	offsets = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	camel_db_read_index_queue (camel_store_get_db (store), camel_folder_get_full_name (folder), 0, uids, offsets, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	len = uids->len;
+
+	g_ptr_array_free (uids, TRUE);
+	g_array_free (offsets, TRUE);
+
+	return len;
+}
+
+typedef struct _WaitData {
+	CamelStore *store;
+	CamelFolder *folder;
+	GMainLoop *loop;
+	GTimer *timer;
+} WaitData;
+
+static gboolean
+check_index_queue_cb (gpointer user_data)
+{
+	WaitData *wd = user_data;
+
+	if (count_index_queue (wd->store, wd->folder) == 0 ||
+	    g_timer_elapsed (wd->timer, NULL) > WAIT_TIMEOUT) {
+		g_main_loop_quit (wd->loop);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelService *service;
+	CamelSession *session;
+	CamelStore *store;
+	CamelFolder *folder;
+	CamelMimeMessage *msg;
+	GError *error = NULL;
+	gint i, j;
+
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, local_drivers);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+
+	for (i = 0; i < G_N_ELEMENTS (stores); i++) {
+		WaitData wd;
+		GTimer *timer;
+		gchar *what, *uid;
+
+		what = g_strdup_printf ("background indexing: %s", stores[i]);
+		camel_test_start (what);
+		test_free (what);
+
+		push ("getting store");
+		uid = g_strdup_printf ("test-uid-%d", i);
+		service = camel_session_add_service (session, uid, stores[i], CAMEL_PROVIDER_STORE, &error);
+		g_free (uid);
+		check_msg (error == NULL, "adding store: %s", error ? error->message : "");
+		check (CAMEL_IS_STORE (service));
+		store = CAMEL_STORE (service);
+		pull ();
+
+		push ("creating indexed folder");
+		folder = camel_store_get_folder_sync (
+			store, "testbox", CAMEL_STORE_FOLDER_CREATE | CAMEL_STORE_FOLDER_BODY_INDEX, NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+		check (folder != NULL);
+		test_folder_counts (folder, 0, 0);
+		pull ();
+
+		push ("appending %d test messages", N_MESSAGES);
+		timer = g_timer_new ();
+
+		for (j = 0; j < N_MESSAGES; j++) {
+			gchar *content, *subject;
+
+			msg = test_message_create_simple ();
+			content = g_strdup_printf ("unique%dx content\n", j);
+			test_message_set_content_simple ((CamelMimePart *) msg, 0, "text/plain", content, strlen (content));
+			test_free (content);
+			subject = g_strdup_printf ("Test%d message", j);
+			camel_mime_message_set_subject (msg, subject);
+			test_free (subject);
+
+			camel_folder_append_message_sync (folder, msg, NULL, NULL, NULL, &error);
+			check_msg (error == NULL, "%s", error ? error->message : "");
+
+			check_unref (msg, 1);
+		}
+
+		g_timer_stop (timer);
+		printf ("Appended %d messages to %s in %.3f seconds\n", N_MESSAGES, stores[i], g_timer_elapsed (timer, NULL));
+		g_timer_destroy (timer);
+		pull ();
+
+		/* whatever is not indexed yet is searched by its content */
+		push ("searching while indexing");
+		run_searches (folder);
+		pull ();
+
+		push ("waiting for the index queue to drain");
+		wd.store = store;
+		wd.folder = folder;
+		wd.loop = g_main_loop_new (NULL, FALSE);
+		wd.timer = g_timer_new ();
+
+		g_timeout_add (10, check_index_queue_cb, &wd);
+		g_main_loop_run (wd.loop);
+
+		printf ("Indexed %d messages of %s in the background in %.3f seconds\n", N_MESSAGES, stores[i], g_timer_elapsed (wd.timer, NULL));
+		g_timer_destroy (wd.timer);
+		g_main_loop_unref (wd.loop);
+
+		check_msg (count_index_queue (store, folder) == 0, "%u messages left in the index queue", count_index_queue (store, folder));
+		pull ();
+
+		push ("searching the complete index");
+		run_searches (folder);
+		pull ();
+
+		/* the index job can hold a reference for a moment longer */
+		g_object_unref (folder);
+		g_object_unref (store);
+
+		camel_test_end ();
+	}
+
+	g_object_unref (session);
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
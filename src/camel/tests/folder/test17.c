@@ -0,0 +1,259 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Refresh of many open maildir folders, changed by another client */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "messages.h"
+#include "folders.h"
+#include "session.h"
+
+#include "providers/local/camel-local-folder.h"
+#include "providers/local/camel-maildir-summary.h"
+
+/* more than the default per-user limit of inotify instances */
+#define N_FOLDERS (150)
+#define N_MESSAGES (3)
+#define CHANGED_FOLDER (75)
+
+static const gchar *local_drivers[] = { "local" };
+
+/* returns -1, when the open descriptors cannot be listed */
+static gint
+count_inotify_instances (void)
+{
+	GDir *dir;
+	const gchar *name;
+	gint count = 0;
+
+	dir = g_dir_open ("/proc/self/fd", 0, NULL);
+	if (!dir)
+		return -1;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *path, *target;
+
+		path = g_build_filename ("/proc/self/fd", name, NULL);
+		target = g_file_read_link (path, NULL);
+
+		if (g_strcmp0 (target, "anon_inode:inotify") == 0)
+			count++;
+
+		g_free (target);
+		g_free (path);
+	}
+
+	g_dir_close (dir);
+
+	return count;
+}
+
+/* the name of a message file in cur/, or NULL */
+static gchar *
+dup_cur_file (const gchar *folder_path,
+              gint index)
+{
+	GDir *dir;
+	GPtrArray *names;
+	const gchar *name;
+	gchar *path, *result = NULL;
+
+	path = g_build_filename (folder_path, "cur", NULL);
+	dir = g_dir_open (path, 0, NULL);
+	g_free (path);
+
+	if (!dir)
+		return NULL;
+
+	names = g_ptr_array_new_with_free_func (g_free);
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		if (*name != '.')
+			g_ptr_array_add (names, g_strdup (name));
+	}
+
+	g_dir_close (dir);
+
+	g_ptr_array_sort (names, (GCompareFunc) g_strcmp0);
+
+	if (index < names->len)
+		result = g_strdup (names->pdata[index]);
+
+	g_ptr_array_free (names, TRUE);
+
+	return result;
+}
+
+static gboolean
+folder_has_uid (CamelFolder *folder,
+                const gchar *uid)
+{
+	CamelMessageInfo *info;
+
+	info = camel_folder_get_message_info (folder, uid);
+	g_clear_object (&info);
+
+	return info != NULL;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelService *service;
+	CamelSession *session;
+	CamelStore *store;
+	CamelFolder *folders[N_FOLDERS], *folder;
+	CamelMimeMessage *msg;
+	const gchar *folder_path;
+	gchar *removed_name, *renamed_name, *removed_uid, *renamed_uid, *path, *new_path, *sep;
+	GError *error = NULL;
+	gint ii, jj, n_instances;
+
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, local_drivers);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+
+	camel_test_start ("Refresh of many open maildir folders");
+
+	push ("getting store");
+	service = camel_session_add_service (session, "test-uid", "maildir:///tmp/camel-test/maildir", CAMEL_PROVIDER_STORE, &error);
+	check_msg (error == NULL, "adding store: %s", error ? error->message : "");
+	check (CAMEL_IS_STORE (service));
+	store = CAMEL_STORE (service);
+	pull ();
+
+	push ("opening %d folders", N_FOLDERS);
+	for (ii = 0; ii < N_FOLDERS; ii++) {
+		gchar *name = g_strdup_printf ("folder%d", ii);
+
+		folders[ii] = camel_store_get_folder_sync (store, name, CAMEL_STORE_FOLDER_CREATE, NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+		check (folders[ii] != NULL);
+		g_free (name);
+
+		for (jj = 0; jj < N_MESSAGES; jj++) {
+			msg = test_message_create_simple ();
+			camel_folder_append_message_sync (folders[ii], msg, NULL, NULL, NULL, &error);
+			check_msg (error == NULL, "%s", error ? error->message : "");
+			check_unref (msg, 1);
+		}
+
+		/* the check starts to watch the folder */
+		camel_folder_refresh_info_sync (folders[ii], NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+		test_folder_counts (folders[ii], N_MESSAGES, N_MESSAGES);
+	}
+	pull ();
+
+	push ("counting inotify instances");
+	n_instances = count_inotify_instances ();
+	if (n_instances != -1)
+		check_msg (n_instances <= 1, "%d inotify instances for %d folders", n_instances, N_FOLDERS);
+	pull ();
+
+	push ("changing a folder by another client");
+	folder = folders[CHANGED_FOLDER];
+	folder_path = CAMEL_LOCAL_FOLDER (folder)->folder_path;
+
+	removed_name = dup_cur_file (folder_path, 0);
+	renamed_name = dup_cur_file (folder_path, 1);
+	check (removed_name != NULL);
+	check (renamed_name != NULL);
+
+	sep = strchr (removed_name, CAMEL_MAILDIR_FLAG_SEP);
+	removed_uid = sep ? g_strndup (removed_name, sep - removed_name) : g_strdup (removed_name);
+	sep = strchr (renamed_name, CAMEL_MAILDIR_FLAG_SEP);
+	renamed_uid = sep ? g_strndup (renamed_name, sep - renamed_name) : g_strdup (renamed_name);
+
+	check (folder_has_uid (folder, removed_uid));
+	check (folder_has_uid (folder, renamed_uid));
+
+	path = g_build_filename (folder_path, "cur", removed_name, NULL);
+	check (g_unlink (path) == 0);
+	g_free (path);
+
+	/* as when another client marks the message seen */
+	path = g_build_filename (folder_path, "cur", renamed_name, NULL);
+	new_path = g_strdup_printf ("%s/cur/%s%c2,S", folder_path, renamed_uid, CAMEL_MAILDIR_FLAG_SEP);
+	check (g_rename (path, new_path) == 0);
+	g_free (new_path);
+	g_free (path);
+
+	path = g_build_filename (folder_path, "new", "1234567890.test17.localhost", NULL);
+	check (g_file_set_contents (path,
+		"From: <sender@example.com>\n"
+		"To: <recipient@example.com>\n"
+		"Subject: Delivered by another client\n"
+		"\n"
+		"Content\n", -1, NULL));
+	g_free (path);
+	pull ();
+
+	push ("refreshing the changed folder");
+	camel_folder_refresh_info_sync (folder, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (camel_folder_get_message_count (folder) == N_MESSAGES);
+	check (!folder_has_uid (folder, removed_uid));
+	check (folder_has_uid (folder, renamed_uid));
+	check (folder_has_uid (folder, "1234567890.test17.localhost"));
+
+	/* found under its new file name */
+	msg = camel_folder_get_message_sync (folder, renamed_uid, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (msg != NULL);
+	check_unref (msg, 1);
+	pull ();
+
+	push ("refreshing the other folders");
+	for (ii = 0; ii < N_FOLDERS; ii++) {
+		if (ii == CHANGED_FOLDER)
+			continue;
+
+		camel_folder_refresh_info_sync (folders[ii], NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+		test_folder_counts (folders[ii], N_MESSAGES, N_MESSAGES);
+	}
+	pull ();
+
+	g_free (removed_name);
+	g_free (renamed_name);
+	g_free (removed_uid);
+	g_free (renamed_uid);
+
+	for (ii = 0; ii < N_FOLDERS; ii++)
+		g_object_unref (folders[ii]);
+
+	g_object_unref (store);
+
+	camel_test_end ();
+
+	g_object_unref (session);
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
@@ -25,7 +25,12 @@ camel_test_provider_init (gint argc,
 
 	for (i = 0; i < argc; i++) {
 		name = g_strdup_printf ("libcamel%s."G_MODULE_SUFFIX, argv[i]);
-		path = g_build_filename (CAMEL_BUILD_DIR, "providers", argv[i], ".libs", name, NULL);
+		path = g_build_filename (CAMEL_BUILD_DIR, "providers", argv[i], name, NULL);
+		/* libtool builds have the module in a subdirectory */
+		if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+			g_free (path);
+			path = g_build_filename (CAMEL_BUILD_DIR, "providers", argv[i], ".libs", name, NULL);
+		}
 		g_free (name);
 		camel_provider_load (path, &error);
 		check_msg (error == NULL, "Cannot load provider for '%s', test aborted", argv[i]);
@@ -0,0 +1,474 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "imap-server.h"
+
+#define CAPABILITIES "IMAP4rev1 IDLE LITERAL+"
+
+struct _TestIMAPServer {
+	GSocketListener *listener;
+	GCancellable *cancellable;
+	GThread *thread;
+	guint16 port;
+
+	guint n_messages;
+	gchar *body;
+	volatile gint *seen; /* indexed by UID */
+
+	volatile gint n_connections;
+	volatile gint n_bodies_sent;
+
+	TestIMAPServerIdleFunc idle_func;
+	gpointer idle_user_data;
+};
+
+gboolean
+test_imap_server_write (GOutputStream *output,
+                        const gchar *format,
+                        ...)
+{
+	va_list ap;
+	gchar *str;
+	gboolean success;
+
+	va_start (ap, format);
+	str = g_strdup_vprintf (format, ap);
+	va_end (ap);
+
+	success = g_output_stream_write_all (output, str, strlen (str), NULL, NULL, NULL);
+
+	g_free (str);
+
+	return success;
+}
+
+/* Reads one command, including its literals */
+static gchar *
+imap_server_read_command (GDataInputStream *input,
+                          GOutputStream *output)
+{
+	GString *command;
+	gchar *line;
+
+	command = g_string_new ("");
+
+	while (line = g_data_input_stream_read_line (input, NULL, NULL, NULL), line) {
+		gsize len = strlen (line);
+		gulong literal_len = 0;
+		gboolean has_literal = FALSE, nonsync = FALSE;
+		gchar *buffer;
+
+		if (len && line[len - 1] == '\r')
+			line[--len] = '\0';
+
+		g_string_append (command, line);
+
+		if (len && line[len - 1] == '}') {
+			const gchar *brace = strrchr (line, '{');
+
+			if (brace) {
+				gchar *end = NULL;
+
+				literal_len = strtoul (brace + 1, &end, 10);
+				nonsync = end && *end == '+';
+				has_literal = TRUE;
+			}
+		}
+
+		g_free (line);
+
+		if (!has_literal)
+			return g_string_free (command, FALSE);
+
+		if (!nonsync)
+			test_imap_server_write (output, "+ go ahead\r\n");
+
+		buffer = g_malloc0 (literal_len + 1);
+
+		if (!g_input_stream_read_all (G_INPUT_STREAM (input), buffer, literal_len, NULL, NULL, NULL)) {
+			g_free (buffer);
+			break;
+		}
+
+		g_string_append_len (command, buffer, literal_len);
+		g_free (buffer);
+	}
+
+	g_string_free (command, TRUE);
+
+	return NULL;
+}
+
+static gboolean
+imap_server_set_contains (TestIMAPServer *server,
+                          const gchar *set,
+                          guint32 value)
+{
+	gchar **ranges;
+	gboolean contains = FALSE;
+	gint ii;
+
+	ranges = g_strsplit (set, ",", -1);
+
+	for (ii = 0; ranges[ii] && !contains; ii++) {
+		gchar **parts = g_strsplit (ranges[ii], ":", 2);
+		guint32 lo, hi;
+
+		lo = g_strcmp0 (parts[0], "*") == 0 ? server->n_messages : strtoul (parts[0], NULL, 10);
+		hi = lo;
+
+		if (parts[1])
+			hi = g_strcmp0 (parts[1], "*") == 0 ? server->n_messages : strtoul (parts[1], NULL, 10);
+
+		if (lo > hi) {
+			guint32 tmp = lo;
+			lo = hi;
+			hi = tmp;
+		}
+
+		contains = lo <= value && value <= hi;
+
+		g_strfreev (parts);
+	}
+
+	g_strfreev (ranges);
+
+	return contains;
+}
+
+static gchar *
+imap_server_dup_header (guint32 uid)
+{
+	return g_strdup_printf (
+		"From: sender@example.com\r\n"
+		"To: user@example.com\r\n"
+		"Subject: Message %u\r\n"
+		"Message-ID: <message-%u@example.com>\r\n"
+		"Date: Mon, 1 Jan 2018 00:00:00 +0000\r\n"
+		"\r\n", uid, uid);
+}
+
+static void
+imap_server_fetch (TestIMAPServer *server,
+                   GOutputStream *output,
+                   const gchar *args)
+{
+	const gchar *space, *full;
+	gchar *set;
+	gboolean with_header, body_peek;
+	gsize part_offset = 0, part_length = G_MAXSIZE;
+	guint32 ii;
+
+	space = strchr (args, ' ');
+	set = space ? g_strndup (args, space - args) : g_strdup (args);
+
+	with_header = strstr (args, "HEADER") != NULL;
+	body_peek = strstr (args, "BODY.PEEK[HEADER]") != NULL;
+
+	full = strstr (args, "BODY.PEEK[]");
+	if (!full)
+		full = strstr (args, "BODY[]");
+	if (full) {
+		full = strstr (full, "[]") + 2;
+
+		if (*full == '<') {
+			gchar *end = NULL;
+
+			part_offset = strtoul (full + 1, &end, 10);
+			if (end && *end == '.')
+				part_length = strtoul (end + 1, NULL, 10);
+		}
+	}
+
+	for (ii = 1; ii <= server->n_messages; ii++) {
+		gboolean seen;
+		gchar *header;
+		gsize size;
+
+		if (!imap_server_set_contains (server, set, ii))
+			continue;
+
+		seen = g_atomic_int_get (&server->seen[ii]) != 0;
+		header = imap_server_dup_header (ii);
+		size = strlen (header) + strlen (server->body);
+
+		if (full) {
+			gchar *message;
+			gsize length;
+
+			message = g_strconcat (header, server->body, NULL);
+
+			if (part_offset > size)
+				part_offset = size;
+			length = MIN (part_length, size - part_offset);
+
+			test_imap_server_write (output, "* %u FETCH (UID %u BODY[]", ii, ii);
+			if (part_length != G_MAXSIZE)
+				test_imap_server_write (output, "<%" G_GSIZE_FORMAT ">", part_offset);
+			test_imap_server_write (output, " {%" G_GSIZE_FORMAT "}\r\n", length);
+			g_output_stream_write_all (output, message + part_offset, length, NULL, NULL, NULL);
+			test_imap_server_write (output, ")\r\n");
+
+			g_atomic_int_inc (&server->n_bodies_sent);
+
+			g_free (message);
+		} else if (with_header) {
+			test_imap_server_write (output,
+				"* %u FETCH (UID %u FLAGS (%s) RFC822.SIZE %" G_GSIZE_FORMAT " %s {%u}\r\n%s)\r\n",
+				ii, ii, seen ? "\\Seen" : "", size,
+				body_peek ? "BODY[HEADER]" : "RFC822.HEADER",
+				(guint) strlen (header), header);
+		} else {
+			test_imap_server_write (output, "* %u FETCH (UID %u FLAGS (%s))\r\n",
+				ii, ii, seen ? "\\Seen" : "");
+		}
+
+		g_free (header);
+	}
+
+	g_free (set);
+}
+
+static gpointer
+imap_server_connection_thread (gpointer user_data)
+{
+	gpointer *data = user_data;
+	TestIMAPServer *server = data[0];
+	GSocketConnection *connection = data[1];
+	GDataInputStream *input;
+	GOutputStream *output;
+	gchar *idle_tag = NULL;
+	gchar *line;
+
+	g_free (data);
+
+	input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	test_imap_server_write (output, "* OK [CAPABILITY " CAPABILITIES "] Fake server ready\r\n");
+
+	while (line = imap_server_read_command (input, output), line) {
+		gchar **words;
+		const gchar *tag, *cmd, *args;
+		gboolean done = FALSE;
+
+		if (idle_tag && g_ascii_strcasecmp (line, "DONE") == 0) {
+			test_imap_server_write (output, "%s OK IDLE terminated\r\n", idle_tag);
+			g_clear_pointer (&idle_tag, g_free);
+			g_free (line);
+			continue;
+		}
+
+		words = g_strsplit (line, " ", 3);
+		tag = words[0];
+		cmd = words[0] ? words[1] : NULL;
+		args = cmd ? words[2] : NULL;
+
+		if (!tag || !cmd) {
+			g_strfreev (words);
+			g_free (line);
+			continue;
+		}
+
+		if (g_ascii_strcasecmp (cmd, "UID") == 0 && args) {
+			gchar **subwords = g_strsplit (args, " ", 2);
+
+			if (g_ascii_strcasecmp (subwords[0], "FETCH") == 0 && subwords[1]) {
+				imap_server_fetch (server, output, subwords[1]);
+			} else if (g_ascii_strcasecmp (subwords[0], "SEARCH") == 0) {
+				GString *response = g_string_new ("* SEARCH");
+				guint32 ii;
+
+				for (ii = 1; ii <= server->n_messages; ii++)
+					g_string_append_printf (response, " %u", ii);
+
+				g_string_append (response, "\r\n");
+				test_imap_server_write (output, "%s", response->str);
+				g_string_free (response, TRUE);
+			}
+
+			g_strfreev (subwords);
+
+			test_imap_server_write (output, "%s OK UID completed\r\n", tag);
+		} else if (g_ascii_strcasecmp (cmd, "FETCH") == 0 && args) {
+			imap_server_fetch (server, output, args);
+			test_imap_server_write (output, "%s OK FETCH completed\r\n", tag);
+		} else if (g_ascii_strcasecmp (cmd, "CAPABILITY") == 0) {
+			test_imap_server_write (output, "* CAPABILITY " CAPABILITIES "\r\n%s OK CAPABILITY completed\r\n", tag);
+		} else if (g_ascii_strcasecmp (cmd, "LIST") == 0 || g_ascii_strcasecmp (cmd, "LSUB") == 0) {
+			test_imap_server_write (output, "* %s () \"/\" INBOX\r\n%s OK %s completed\r\n", cmd, tag, cmd);
+		} else if (g_ascii_strcasecmp (cmd, "STATUS") == 0) {
+			test_imap_server_write (output,
+				"* STATUS INBOX (MESSAGES %u UNSEEN %u UIDNEXT %u UIDVALIDITY 1)\r\n"
+				"%s OK STATUS completed\r\n",
+				server->n_messages, test_imap_server_get_n_unseen (server), server->n_messages + 1, tag);
+		} else if (g_ascii_strcasecmp (cmd, "SELECT") == 0 || g_ascii_strcasecmp (cmd, "EXAMINE") == 0) {
+			test_imap_server_write (output,
+				"* FLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft)\r\n"
+				"* OK [PERMANENTFLAGS (\\Answered \\Flagged \\Deleted \\Seen \\Draft \\*)] Limited\r\n"
+				"* %u EXISTS\r\n"
+				"* 0 RECENT\r\n"
+				"* OK [UIDVALIDITY 1] UIDs valid\r\n"
+				"* OK [UIDNEXT %u] Predicted next UID\r\n"
+				"%s OK [READ-WRITE] %s completed\r\n",
+				server->n_messages, server->n_messages + 1, tag, cmd);
+		} else if (g_ascii_strcasecmp (cmd, "IDLE") == 0) {
+			idle_tag = g_strdup (tag);
+
+			test_imap_server_write (output, "+ idling\r\n");
+
+			if (server->idle_func)
+				server->idle_func (server, output, server->idle_user_data);
+		} else if (g_ascii_strcasecmp (cmd, "LOGOUT") == 0) {
+			test_imap_server_write (output, "* BYE Fake server logging out\r\n%s OK LOGOUT completed\r\n", tag);
+			done = TRUE;
+		} else {
+			test_imap_server_write (output, "%s OK %s completed\r\n", tag, cmd);
+		}
+
+		g_strfreev (words);
+		g_free (line);
+
+		if (done)
+			break;
+	}
+
+	g_free (idle_tag);
+	g_object_unref (input);
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+	g_object_unref (connection);
+
+	g_atomic_int_dec_and_test (&server->n_connections);
+
+	return NULL;
+}
+
+static gpointer
+imap_server_thread (gpointer user_data)
+{
+	TestIMAPServer *server = user_data;
+	GSocketConnection *connection;
+
+	while (connection = g_socket_listener_accept (server->listener, NULL, server->cancellable, NULL), connection) {
+		gpointer *data;
+
+		data = g_new0 (gpointer, 2);
+		data[0] = server;
+		data[1] = connection;
+
+		g_atomic_int_inc (&server->n_connections);
+		g_thread_unref (g_thread_new ("fake-imap-connection", imap_server_connection_thread, data));
+	}
+
+	return NULL;
+}
+
+TestIMAPServer *
+test_imap_server_new (guint n_messages,
+                      gsize body_size)
+{
+	TestIMAPServer *server;
+	GString *body;
+	GError *error = NULL;
+	guint ii;
+
+	server = g_new0 (TestIMAPServer, 1);
+	server->n_messages = n_messages;
+	server->seen = g_new0 (gint, n_messages + 1);
+	server->cancellable = g_cancellable_new ();
+
+	body = g_string_sized_new (body_size + 80);
+	for (ii = 1; body->len < body_size; ii++)
+		g_string_append_printf (body, "This is line %u of the message body.\r\n", ii);
+	server->body = g_string_free (body, FALSE);
+
+	server->listener = g_socket_listener_new ();
+	server->port = g_socket_listener_add_any_inet_port (server->listener, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	server->thread = g_thread_new ("fake-imap", imap_server_thread, server);
+
+	return server;
+}
+
+void
+test_imap_server_free (TestIMAPServer *server)
+{
+	gint64 end_time;
+
+	g_cancellable_cancel (server->cancellable);
+	g_thread_join (server->thread);
+	g_socket_listener_close (server->listener);
+
+	/* Connections end when the client disconnects */
+	end_time = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+	while (g_atomic_int_get (&server->n_connections) > 0 && g_get_monotonic_time () < end_time)
+		g_usleep (10000);
+
+	check_msg (g_atomic_int_get (&server->n_connections) == 0, "Fake server connections still open");
+
+	g_object_unref (server->listener);
+	g_object_unref (server->cancellable);
+	g_free ((gpointer) server->seen);
+	g_free (server->body);
+	g_free (server);
+}
+
+guint16
+test_imap_server_get_port (TestIMAPServer *server)
+{
+	return server->port;
+}
+
+void
+test_imap_server_set_idle_func (TestIMAPServer *server,
+                                TestIMAPServerIdleFunc func,
+                                gpointer user_data)
+{
+	server->idle_func = func;
+	server->idle_user_data = user_data;
+}
+
+void
+test_imap_server_set_seen (TestIMAPServer *server,
+                           guint32 uid,
+                           gboolean seen)
+{
+	g_return_if_fail (uid >= 1 && uid <= server->n_messages);
+
+	g_atomic_int_set (&server->seen[uid], seen ? 1 : 0);
+}
+
+guint
+test_imap_server_get_n_unseen (TestIMAPServer *server)
+{
+	guint ii, n_unseen = 0;
+
+	for (ii = 1; ii <= server->n_messages; ii++) {
+		if (!g_atomic_int_get (&server->seen[ii]))
+			n_unseen++;
+	}
+
+	return n_unseen;
+}
+
+guint
+test_imap_server_get_n_bodies_sent (TestIMAPServer *server)
+{
+	return g_atomic_int_get (&server->n_bodies_sent);
+}
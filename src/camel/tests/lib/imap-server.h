@@ -0,0 +1,34 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* a minimal in-process IMAP server, with one INBOX of generated messages */
+
+#include <camel/camel.h>
+
+typedef struct _TestIMAPServer TestIMAPServer;
+
+/* called when a client enters IDLE; can write untagged responses to @output */
+typedef void (* TestIMAPServerIdleFunc) (TestIMAPServer *server, GOutputStream *output, gpointer user_data);
+
+/* start listening on a local port; each message has @body_size bytes of body */
+TestIMAPServer *test_imap_server_new (guint n_messages, gsize body_size);
+void test_imap_server_free (TestIMAPServer *server);
+guint16 test_imap_server_get_port (TestIMAPServer *server);
+void test_imap_server_set_idle_func (TestIMAPServer *server, TestIMAPServerIdleFunc func, gpointer user_data);
+/* flags of the messages, indexed by UID, which goes from 1 to n_messages */
+void test_imap_server_set_seen (TestIMAPServer *server, guint32 uid, gboolean seen);
+guint test_imap_server_get_n_unseen (TestIMAPServer *server);
+/* how many times full message bodies were sent */
+guint test_imap_server_get_n_bodies_sent (TestIMAPServer *server);
+gboolean test_imap_server_write (GOutputStream *output, const gchar *format, ...) G_GNUC_PRINTF (2, 3);
@@ -0,0 +1,393 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "imap-server.h"
+#include "nntp-server.h"
+
+struct _TestNNTPServer {
+	GSocketListener *listener;
+	GCancellable *cancellable;
+	GThread *thread;
+	guint16 port;
+
+	gchar *group;
+	guint n_articles;
+	TestNNTPServerFlags flags;
+
+	volatile gint n_connections;
+	volatile gint n_over;
+	volatile gint n_hdr;
+	volatile gint n_head;
+	volatile gint n_pipelined;
+};
+
+/* Parses "N", "N-" or "N-M", clamped to the existing articles */
+static gboolean
+nntp_server_parse_range (TestNNTPServer *server,
+                         const gchar *range,
+                         guint *out_low,
+                         guint *out_high)
+{
+	gchar *end = NULL;
+
+	if (!range || !*range)
+		return FALSE;
+
+	*out_low = strtoul (range, &end, 10);
+	*out_high = *out_low;
+
+	if (end && *end == '-')
+		*out_high = end[1] ? strtoul (end + 1, NULL, 10) : server->n_articles;
+
+	*out_low = MAX (*out_low, 1);
+	*out_high = MIN (*out_high, server->n_articles);
+
+	return *out_low <= *out_high;
+}
+
+static gchar *
+nntp_server_dup_header (TestNNTPServer *server,
+                        guint n,
+                        const gchar *name)
+{
+	if (g_ascii_strcasecmp (name, "Subject") == 0)
+		return g_strdup_printf ("Article %u", n);
+	if (g_ascii_strcasecmp (name, "From") == 0)
+		return g_strdup_printf ("Poster %u <poster%u@example.com>", n % 10, n % 10);
+	if (g_ascii_strcasecmp (name, "Date") == 0)
+		return g_strdup ("Mon, 1 Jan 2018 00:00:00 +0000");
+	if (g_ascii_strcasecmp (name, "Message-ID") == 0)
+		return g_strdup_printf ("<article-%u@example.com>", n);
+	if (g_ascii_strcasecmp (name, "References") == 0)
+		return n > 1 && (n % 2) == 0 ? g_strdup_printf ("<article-%u@example.com>", n - 1) : g_strdup ("");
+
+	return g_strdup ("");
+}
+
+static void
+nntp_server_over (TestNNTPServer *server,
+                  GOutputStream *output,
+                  const gchar *range)
+{
+	GString *response;
+	guint ii, low, high;
+
+	if (!nntp_server_parse_range (server, range, &low, &high)) {
+		test_imap_server_write (output, "423 No articles in that range\r\n");
+		return;
+	}
+
+	response = g_string_new ("224 Overview information follows\r\n");
+
+	for (ii = low; ii <= high; ii++) {
+		gchar *subject, *from, *date, *msgid, *references;
+
+		subject = nntp_server_dup_header (server, ii, "Subject");
+		from = nntp_server_dup_header (server, ii, "From");
+		date = nntp_server_dup_header (server, ii, "Date");
+		msgid = nntp_server_dup_header (server, ii, "Message-ID");
+		references = nntp_server_dup_header (server, ii, "References");
+
+		g_string_append_printf (response, "%u\t%s\t%s\t%s\t%s\t%s\t%u\t%u\r\n",
+			ii, subject, from, date, msgid, references, 1000 + ii, 10);
+
+		g_free (subject);
+		g_free (from);
+		g_free (date);
+		g_free (msgid);
+		g_free (references);
+	}
+
+	g_string_append (response, ".\r\n");
+	g_output_stream_write_all (output, response->str, response->len, NULL, NULL, NULL);
+	g_string_free (response, TRUE);
+}
+
+static void
+nntp_server_hdr (TestNNTPServer *server,
+                 GOutputStream *output,
+                 const gchar *args)
+{
+	GString *response;
+	gchar **words;
+	guint ii, low, high;
+
+	words = g_strsplit (args ? args : "", " ", 2);
+
+	if (!words[0] || !nntp_server_parse_range (server, words[1], &low, &high)) {
+		test_imap_server_write (output, "423 No articles in that range\r\n");
+		g_strfreev (words);
+		return;
+	}
+
+	response = g_string_new ("225 Headers follow\r\n");
+
+	for (ii = low; ii <= high; ii++) {
+		gchar *value = nntp_server_dup_header (server, ii, words[0]);
+
+		g_string_append_printf (response, "%u %s\r\n", ii, value);
+		g_free (value);
+	}
+
+	g_string_append (response, ".\r\n");
+	g_output_stream_write_all (output, response->str, response->len, NULL, NULL, NULL);
+	g_string_free (response, TRUE);
+	g_strfreev (words);
+}
+
+static void
+nntp_server_head (TestNNTPServer *server,
+                  GOutputStream *output,
+                  const gchar *args)
+{
+	gchar *subject, *from, *date, *msgid, *references;
+	guint n;
+
+	n = args ? strtoul (args, NULL, 10) : 0;
+	if (n < 1 || n > server->n_articles) {
+		test_imap_server_write (output, "423 No article with that number\r\n");
+		return;
+	}
+
+	subject = nntp_server_dup_header (server, n, "Subject");
+	from = nntp_server_dup_header (server, n, "From");
+	date = nntp_server_dup_header (server, n, "Date");
+	msgid = nntp_server_dup_header (server, n, "Message-ID");
+	references = nntp_server_dup_header (server, n, "References");
+
+	test_imap_server_write (output,
+		"221 %u %s\r\n"
+		"Path: example.com!not-for-mail\r\n"
+		"From: %s\r\n"
+		"Newsgroups: %s\r\n"
+		"Subject: %s\r\n"
+		"Date: %s\r\n"
+		"Message-ID: %s\r\n"
+		"%s%s%s"
+		".\r\n",
+		n, msgid, from, server->group, subject, date, msgid,
+		*references ? "References: " : "", references, *references ? "\r\n" : "");
+
+	g_free (subject);
+	g_free (from);
+	g_free (date);
+	g_free (msgid);
+	g_free (references);
+}
+
+static gpointer
+nntp_server_connection_thread (gpointer user_data)
+{
+	gpointer *data = user_data;
+	TestNNTPServer *server = data[0];
+	GSocketConnection *connection = data[1];
+	GDataInputStream *input;
+	GOutputStream *output;
+	gchar *line;
+
+	g_free (data);
+
+	input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+	test_imap_server_write (output, "201 Fake server ready, posting prohibited\r\n");
+
+	while (line = g_data_input_stream_read_line (input, NULL, NULL, NULL), line) {
+		gchar **words;
+		const gchar *cmd, *args;
+		gsize len = strlen (line);
+		gboolean done = FALSE;
+
+		if (len && line[len - 1] == '\r')
+			line[--len] = '\0';
+
+		/* the client did not wait for the response of this one */
+		if (g_buffered_input_stream_get_available (G_BUFFERED_INPUT_STREAM (input)) > 0)
+			g_atomic_int_inc (&server->n_pipelined);
+
+		words = g_strsplit (line, " ", 2);
+		cmd = words[0];
+		args = cmd ? words[1] : NULL;
+
+		if (!cmd) {
+			g_strfreev (words);
+			g_free (line);
+			continue;
+		}
+
+		if (g_ascii_strcasecmp (cmd, "CAPABILITIES") == 0) {
+			test_imap_server_write (output, "101 Capability list:\r\nVERSION 2\r\nREADER\r\n%s%s.\r\n",
+				(server->flags & TEST_NNTP_SERVER_OVER) != 0 ? "OVER\r\n" : "",
+				(server->flags & TEST_NNTP_SERVER_HDR) != 0 ? "HDR\r\n" : "");
+		} else if (g_ascii_strcasecmp (cmd, "MODE") == 0) {
+			test_imap_server_write (output, "201 Posting prohibited\r\n");
+		} else if (g_ascii_strcasecmp (cmd, "DATE") == 0) {
+			test_imap_server_write (output, "111 20180101000000\r\n");
+		} else if (g_ascii_strcasecmp (cmd, "LIST") == 0 && args && g_ascii_strcasecmp (args, "OVERVIEW.FMT") == 0) {
+			if ((server->flags & TEST_NNTP_SERVER_OVER) != 0)
+				test_imap_server_write (output,
+					"215 Order of fields in overview database\r\n"
+					"Subject:\r\nFrom:\r\nDate:\r\nMessage-ID:\r\nReferences:\r\nBytes:\r\nLines:\r\n.\r\n");
+			else
+				test_imap_server_write (output, "503 Overview not available\r\n");
+		} else if (g_ascii_strcasecmp (cmd, "LIST") == 0) {
+			test_imap_server_write (output, "215 List of newsgroups follows\r\n%s %u 1 y\r\n.\r\n",
+				server->group, server->n_articles);
+		} else if (g_ascii_strcasecmp (cmd, "GROUP") == 0) {
+			test_imap_server_write (output, "211 %u 1 %u %s\r\n",
+				server->n_articles, server->n_articles, server->group);
+		} else if (g_ascii_strcasecmp (cmd, "LISTGROUP") == 0) {
+			GString *response;
+			guint ii;
+
+			response = g_string_new ("");
+			g_string_append_printf (response, "211 %u 1 %u %s\r\n",
+				server->n_articles, server->n_articles, server->group);
+			for (ii = 1; ii <= server->n_articles; ii++)
+				g_string_append_printf (response, "%u\r\n", ii);
+			g_string_append (response, ".\r\n");
+
+			g_output_stream_write_all (output, response->str, response->len, NULL, NULL, NULL);
+			g_string_free (response, TRUE);
+		} else if ((g_ascii_strcasecmp (cmd, "OVER") == 0 && (server->flags & TEST_NNTP_SERVER_OVER) != 0) ||
+			   g_ascii_strcasecmp (cmd, "XOVER") == 0) {
+			g_atomic_int_inc (&server->n_over);
+			nntp_server_over (server, output, args);
+		} else if (g_ascii_strcasecmp (cmd, "HDR") == 0 && (server->flags & TEST_NNTP_SERVER_HDR) != 0) {
+			g_atomic_int_inc (&server->n_hdr);
+			nntp_server_hdr (server, output, args);
+		} else if (g_ascii_strcasecmp (cmd, "HEAD") == 0) {
+			g_atomic_int_inc (&server->n_head);
+			nntp_server_head (server, output, args);
+		} else if (g_ascii_strcasecmp (cmd, "QUIT") == 0) {
+			test_imap_server_write (output, "205 Bye\r\n");
+			done = TRUE;
+		} else {
+			test_imap_server_write (output, "500 Unknown command\r\n");
+		}
+
+		g_strfreev (words);
+		g_free (line);
+
+		if (done)
+			break;
+	}
+
+	g_object_unref (input);
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+	g_object_unref (connection);
+
+	g_atomic_int_dec_and_test (&server->n_connections);
+
+	return NULL;
+}
+
+static gpointer
+nntp_server_thread (gpointer user_data)
+{
+	TestNNTPServer *server = user_data;
+	GSocketConnection *connection;
+
+	while (connection = g_socket_listener_accept (server->listener, NULL, server->cancellable, NULL), connection) {
+		gpointer *data;
+
+		data = g_new0 (gpointer, 2);
+		data[0] = server;
+		data[1] = connection;
+
+		g_atomic_int_inc (&server->n_connections);
+		g_thread_unref (g_thread_new ("fake-nntp-connection", nntp_server_connection_thread, data));
+	}
+
+	return NULL;
+}
+
+TestNNTPServer *
+test_nntp_server_new (const gchar *group,
+                      guint n_articles,
+                      TestNNTPServerFlags flags)
+{
+	TestNNTPServer *server;
+	GError *error = NULL;
+
+	server = g_new0 (TestNNTPServer, 1);
+	server->group = g_strdup (group);
+	server->n_articles = n_articles;
+	server->flags = flags;
+	server->cancellable = g_cancellable_new ();
+
+	server->listener = g_socket_listener_new ();
+	server->port = g_socket_listener_add_any_inet_port (server->listener, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	server->thread = g_thread_new ("fake-nntp", nntp_server_thread, server);
+
+	return server;
+}
+
+void
+test_nntp_server_free (TestNNTPServer *server)
+{
+	gint64 end_time;
+
+	g_cancellable_cancel (server->cancellable);
+	g_thread_join (server->thread);
+	g_socket_listener_close (server->listener);
+
+	/* Connections end when the client disconnects */
+	end_time = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+	while (g_atomic_int_get (&server->n_connections) > 0 && g_get_monotonic_time () < end_time)
+		g_usleep (10000);
+
+	check_msg (g_atomic_int_get (&server->n_connections) == 0, "Fake server connections still open");
+
+	g_object_unref (server->listener);
+	g_object_unref (server->cancellable);
+	g_free (server->group);
+	g_free (server);
+}
+
+guint16
+test_nntp_server_get_port (TestNNTPServer *server)
+{
+	return server->port;
+}
+
+guint
+test_nntp_server_get_n_over (TestNNTPServer *server)
+{
+	return g_atomic_int_get (&server->n_over);
+}
+
+guint
+test_nntp_server_get_n_hdr (TestNNTPServer *server)
+{
+	return g_atomic_int_get (&server->n_hdr);
+}
+
+guint
+test_nntp_server_get_n_head (TestNNTPServer *server)
+{
+	return g_atomic_int_get (&server->n_head);
+}
+
+guint
+test_nntp_server_get_n_pipelined (TestNNTPServer *server)
+{
+	return g_atomic_int_get (&server->n_pipelined);
+}
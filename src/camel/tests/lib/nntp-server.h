@@ -0,0 +1,35 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* a minimal in-process NNTP server, with one group of generated articles */
+
+#include <camel/camel.h>
+
+typedef struct _TestNNTPServer TestNNTPServer;
+
+typedef enum {
+	TEST_NNTP_SERVER_OVER = 1 << 0, /* advertises OVER and lists overview.fmt */
+	TEST_NNTP_SERVER_HDR = 1 << 1   /* advertises HDR */
+} TestNNTPServerFlags;
+
+/* start listening on a local port; articles are numbered from 1 to n_articles */
+TestNNTPServer *test_nntp_server_new (const gchar *group, guint n_articles, TestNNTPServerFlags flags);
+void test_nntp_server_free (TestNNTPServer *server);
+guint16 test_nntp_server_get_port (TestNNTPServer *server);
+/* how many OVER or XOVER, HDR and HEAD commands were received */
+guint test_nntp_server_get_n_over (TestNNTPServer *server);
+guint test_nntp_server_get_n_hdr (TestNNTPServer *server);
+guint test_nntp_server_get_n_head (TestNNTPServer *server);
+/* how many commands arrived while the previous one was not answered yet */
+guint test_nntp_server_get_n_pipelined (TestNNTPServer *server);
@@ -0,0 +1,152 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Text to HTML conversion throughput, of a large plain text log */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camel-test.h"
+
+#define TEXT_SIZE (5 * 1024 * 1024)
+#define URL_EVERY (50) /* lines */
+#define CHUNK_SIZE (4096) /* as a filter stream passes it */
+
+static gchar *
+create_text (gsize *out_len,
+             guint *out_n_urls)
+{
+	GString *text;
+	guint line = 0, n_urls = 0;
+
+	text = g_string_sized_new (TEXT_SIZE + 256);
+
+	while (text->len < TEXT_SIZE) {
+		g_string_append_printf (
+			text, "2018-01-%02u 12:%02u:%02u worker[%u]: processed request %u in %u ms, status=ok",
+			line % 28 + 1, line % 60, line % 59, line % 16, line, line % 1000);
+
+		if (line % URL_EVERY == 0) {
+			g_string_append_printf (text, " see http://example.com/requests/%u for details", line);
+			n_urls++;
+		} else if (line % 7 == 0) {
+			g_string_append (text, " (queue <empty> & \"idle\")");
+		}
+
+		g_string_append_c (text, '\n');
+		line++;
+	}
+
+	*out_len = text->len;
+	*out_n_urls = n_urls;
+
+	return g_string_free (text, FALSE);
+}
+
+static guint
+count_substrings (const gchar *str,
+                  gsize len,
+                  const gchar *needle)
+{
+	const gchar *end = str + len;
+	gsize needle_len = strlen (needle);
+	guint count = 0;
+
+	while (str < end && (str = g_strstr_len (str, end - str, needle)) != NULL) {
+		count++;
+		str += needle_len;
+	}
+
+	return count;
+}
+
+static void
+test_convert (const gchar *text,
+              gsize len,
+              guint n_urls,
+              CamelMimeFilterToHTMLFlags flags,
+              const gchar *what)
+{
+	CamelMimeFilter *filter;
+	GByteArray *output;
+	GTimer *timer;
+	gchar *out;
+	gsize outlen, outpre, ii;
+	gdouble elapsed;
+
+	push ("converting %s", what);
+
+	filter = camel_mime_filter_tohtml_new (flags, 0x737373);
+	output = g_byte_array_sized_new (len * 2);
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < len; ii += CHUNK_SIZE) {
+		camel_mime_filter_filter (filter, text + ii, MIN (CHUNK_SIZE, len - ii), 0, &out, &outlen, &outpre);
+		g_byte_array_append (output, (guint8 *) out, outlen);
+	}
+
+	camel_mime_filter_complete (filter, "", 0, 0, &out, &outlen, &outpre);
+	g_byte_array_append (output, (guint8 *) out, outlen);
+
+	g_timer_stop (timer);
+	elapsed = g_timer_elapsed (timer, NULL);
+	printf ("Converted %.1f MB %s in %.3f seconds, %.1f MB/s\n",
+		len / (1024.0 * 1024.0), what, elapsed, elapsed > 0 ? len / (1024.0 * 1024.0) / elapsed : 0);
+	g_timer_destroy (timer);
+
+	check (output->len > len);
+
+	if ((flags & CAMEL_MIME_FILTER_TOHTML_CONVERT_URLS) != 0) {
+		guint n_links = count_substrings ((const gchar *) output->data, output->len, "<a href=\"http://example.com/requests/");
+
+		check_msg (n_links == n_urls, "Expected %u links, got %u", n_urls, n_links);
+	}
+
+	check (count_substrings ((const gchar *) output->data, output->len, "&lt;empty&gt; &amp; &quot;idle&quot;") > 0);
+
+	g_byte_array_free (output, TRUE);
+	check_unref (filter, 1);
+
+	pull ();
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gchar *text;
+	gsize len;
+	guint n_urls;
+
+	camel_test_init (argc, argv);
+
+	text = create_text (&len, &n_urls);
+
+	camel_test_start ("Text to HTML conversion of a large text");
+
+	test_convert (text, len, n_urls, 0, "without any flags");
+	test_convert (text, len, n_urls, CAMEL_MIME_FILTER_TOHTML_CONVERT_URLS | CAMEL_MIME_FILTER_TOHTML_CONVERT_ADDRESSES, "with links");
+	test_convert (
+		text, len, n_urls,
+		CAMEL_MIME_FILTER_TOHTML_PRE | CAMEL_MIME_FILTER_TOHTML_CONVERT_NL | CAMEL_MIME_FILTER_TOHTML_CONVERT_SPACES |
+		CAMEL_MIME_FILTER_TOHTML_CONVERT_URLS | CAMEL_MIME_FILTER_TOHTML_CONVERT_ADDRESSES | CAMEL_MIME_FILTER_TOHTML_MARK_CITATION,
+		"as a mail body");
+
+	camel_test_end ();
+
+	g_free (text);
+
+	return 0;
+}
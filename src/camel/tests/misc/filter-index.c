@@ -0,0 +1,152 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Indexed header rules, with messages decided from the summary and from headers */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camel-test.h"
+#include "session.h"
+
+static CamelMessageInfo *
+create_info (const gchar *from,
+             gboolean with_headers)
+{
+	CamelMessageInfo *info;
+
+	info = camel_message_info_new (NULL);
+	camel_message_info_set_from (info, from);
+	camel_message_info_set_subject (info, "Test");
+
+	/* as for a message filtered while it is being downloaded */
+	if (with_headers) {
+		CamelNameValueArray *headers;
+
+		headers = camel_name_value_array_new ();
+		camel_name_value_array_append (headers, "From", from);
+		camel_name_value_array_append (headers, "Subject", "Test");
+		camel_message_info_take_headers (info, headers);
+	}
+
+	return info;
+}
+
+static void
+check_score (CamelMessageInfo *info,
+             gint expected)
+{
+	const gchar *score;
+
+	score = camel_message_info_get_user_tag (info, "score");
+
+	if (expected)
+		check_msg (score && atoi (score) == expected, "Expected score %d, got %s", expected, score ? score : "none");
+	else
+		check_msg (score == NULL || atoi (score) == 0, "Expected no score, got %s", score);
+}
+
+static void
+filter_message (CamelFilterDriver *driver,
+                CamelMimeMessage *message,
+                CamelMessageInfo *info)
+{
+	GError *error = NULL;
+
+	camel_filter_driver_filter_message (driver, message, info, NULL, NULL, NULL, NULL, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	g_clear_error (&error);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelFilterDriver *driver;
+	CamelMimeMessage *message;
+	CamelMessageInfo *alice, *bob;
+	FILE *logfile;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("Indexed header rules");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	driver = camel_filter_driver_new (session);
+
+	camel_filter_driver_add_rule (driver, "alice", "(match-all (header-contains \"from\" \"alice@\"))", "(adjust-score 1)");
+	camel_filter_driver_add_rule (driver, "report", "(match-all (header-matches \"subject\" \"Report\"))", "(adjust-score 10)");
+
+	message = camel_mime_message_new ();
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "Hello\n", 6, "text/plain");
+
+	push ("message with headers after a summary-only one");
+	alice = create_info ("Alice <alice@example.com>", FALSE);
+	bob = create_info ("Bob <bob@example.com>", TRUE);
+
+	filter_message (driver, message, alice);
+	filter_message (driver, message, bob);
+
+	check_score (alice, 1);
+	check_score (bob, 0);
+
+	g_object_unref (alice);
+	g_object_unref (bob);
+	pull ();
+
+	push ("logged message after a summary-only one");
+	alice = create_info ("Alice <alice@example.com>", FALSE);
+	bob = create_info ("Bob <bob@example.com>", FALSE);
+
+	filter_message (driver, message, alice);
+
+	logfile = fopen ("/dev/null", "w");
+	camel_filter_driver_set_logfile (driver, logfile);
+	filter_message (driver, message, bob);
+	camel_filter_driver_set_logfile (driver, NULL);
+	fclose (logfile);
+
+	check_score (alice, 1);
+	check_score (bob, 0);
+
+	g_object_unref (alice);
+	g_object_unref (bob);
+	pull ();
+
+	push ("summary-only message after a message with headers");
+	alice = create_info ("Alice <alice@example.com>", TRUE);
+	bob = create_info ("Bob <bob@example.com>", FALSE);
+
+	filter_message (driver, message, alice);
+	filter_message (driver, message, bob);
+
+	check_score (alice, 1);
+	check_score (bob, 0);
+
+	g_object_unref (alice);
+	g_object_unref (bob);
+	pull ();
+
+	g_object_unref (message);
+	g_object_unref (driver);
+	check_unref (session, 1);
+
+	camel_test_end ();
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Filter driver timing, with many header rules over many messages */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camel-test.h"
+#include "session.h"
+
+#define N_FROM_RULES (400)
+#define N_SUBJECT_RULES (50)
+#define N_TO_RULES (50)
+#define N_MESSAGES (10000)
+
+static void
+add_rules (CamelFilterDriver *driver)
+{
+	gint ii;
+
+	for (ii = 0; ii < N_FROM_RULES; ii++) {
+		gchar *name, *match;
+
+		name = g_strdup_printf ("from-%d", ii);
+		match = g_strdup_printf ("(match-all (header-contains \"from\" \"user%d@\"))", ii);
+		camel_filter_driver_add_rule (driver, name, match, "(adjust-score 1)");
+		g_free (match);
+		g_free (name);
+	}
+
+	for (ii = 0; ii < N_SUBJECT_RULES; ii++) {
+		gchar *name, *match;
+
+		name = g_strdup_printf ("subject-%d", ii);
+		match = g_strdup_printf ("(match-all (header-matches \"subject\" \"Report %d\"))", ii);
+		camel_filter_driver_add_rule (driver, name, match, "(adjust-score 1)");
+		g_free (match);
+		g_free (name);
+	}
+
+	for (ii = 0; ii < N_TO_RULES; ii++) {
+		gchar *name, *match;
+
+		name = g_strdup_printf ("to-%d", ii);
+		match = g_strdup_printf ("(match-all (header-contains \"to\" \"list%d@\"))", ii);
+		camel_filter_driver_add_rule (driver, name, match, "(adjust-score 1)");
+		g_free (match);
+		g_free (name);
+	}
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelFilterDriver *driver;
+	CamelMimeMessage *message;
+	CamelMessageInfo **infos;
+	GTimer *timer;
+	GError *error = NULL;
+	gint ii;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("Filter driver with many header rules");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+	driver = camel_filter_driver_new (session);
+
+	push ("adding %d rules", N_FROM_RULES + N_SUBJECT_RULES + N_TO_RULES);
+	add_rules (driver);
+	pull ();
+
+	push ("creating %d messages", N_MESSAGES);
+	message = camel_mime_message_new ();
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "Hello\n", 6, "text/plain");
+
+	infos = g_new0 (CamelMessageInfo *, N_MESSAGES);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		gchar *value;
+
+		infos[ii] = camel_message_info_new (NULL);
+
+		value = g_strdup_printf ("User %d <user%d@example.com>", ii % N_FROM_RULES, ii % N_FROM_RULES);
+		camel_message_info_set_from (infos[ii], value);
+		g_free (value);
+
+		value = g_strdup_printf ("list%d@example.com", ii % N_TO_RULES);
+		camel_message_info_set_to (infos[ii], value);
+		g_free (value);
+
+		value = g_strdup_printf ("Report %d", ii % (2 * N_SUBJECT_RULES));
+		camel_message_info_set_subject (infos[ii], value);
+		g_free (value);
+	}
+	pull ();
+
+	push ("filtering %d messages", N_MESSAGES);
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		camel_filter_driver_filter_message (driver, message, infos[ii], NULL, NULL, NULL, NULL, NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+	}
+
+	g_timer_stop (timer);
+	printf ("Filtered %d messages with %d rules in %.3f seconds\n",
+		N_MESSAGES, N_FROM_RULES + N_SUBJECT_RULES + N_TO_RULES, g_timer_elapsed (timer, NULL));
+	g_timer_destroy (timer);
+	pull ();
+
+	push ("checking scores");
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		const gchar *score;
+		gint expected;
+
+		/* one From rule and one To rule match each message, the Subject rules half of them */
+		expected = 2 + ((ii % (2 * N_SUBJECT_RULES)) < N_SUBJECT_RULES ? 1 : 0);
+		score = camel_message_info_get_user_tag (infos[ii], "score");
+
+		check_msg (score && atoi (score) == expected,
+			"Message %d expected score %d, got %s", ii, expected, score ? score : "none");
+	}
+	pull ();
+
+	for (ii = 0; ii < N_MESSAGES; ii++)
+		g_object_unref (infos[ii]);
+	g_free (infos);
+
+	g_object_unref (message);
+	g_object_unref (driver);
+	check_unref (session, 1);
+
+	camel_test_end ();
+
+	return 0;
+}
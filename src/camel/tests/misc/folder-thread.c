@@ -0,0 +1,329 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Message threading updated with changes, compared with threading from scratch */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "session.h"
+
+#define N_MESSAGES (200)
+#define N_INITIAL (150)
+#define N_STEPS (60)
+
+/* a store, only to be the parent of the folder */
+typedef struct _TestFakeStore {
+	CamelStore parent;
+} TestFakeStore;
+
+typedef struct _TestFakeStoreClass {
+	CamelStoreClass parent_class;
+} TestFakeStoreClass;
+
+G_DEFINE_TYPE (TestFakeStore, test_fake_store, CAMEL_TYPE_STORE)
+
+/* a folder, only to hold the summary */
+typedef struct _TestFakeFolder {
+	CamelFolder parent;
+} TestFakeFolder;
+
+typedef struct _TestFakeFolderClass {
+	CamelFolderClass parent_class;
+} TestFakeFolderClass;
+
+G_DEFINE_TYPE (TestFakeFolder, test_fake_folder, CAMEL_TYPE_FOLDER)
+
+static void
+test_fake_store_class_init (TestFakeStoreClass *class)
+{
+}
+
+static void
+test_fake_store_init (TestFakeStore *store)
+{
+}
+
+static void
+test_fake_folder_class_init (TestFakeFolderClass *class)
+{
+}
+
+static void
+test_fake_folder_init (TestFakeFolder *folder)
+{
+}
+
+static gchar *
+message_uid (gint index)
+{
+	return g_strdup_printf ("%04d", index);
+}
+
+/* some messages have no message-id, some share it with the previous one */
+static guint64
+message_id (gint index)
+{
+	if ((index % 17) == 0)
+		return 0;
+
+	if ((index % 23) == 5)
+		index--;
+
+	return 1000 + index;
+}
+
+/* message-ids of messages, which are never in the folder */
+static guint64
+missing_id (gint index)
+{
+	return 100000 + index;
+}
+
+/* references to earlier and later messages, and to missing
+ * messages, some of them referenced by more messages */
+static GArray *
+message_references (gint index)
+{
+	GArray *references;
+	guint64 id;
+
+	references = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+	switch (index % 6) {
+	case 1:
+		id = message_id (index / 2);
+		g_array_append_val (references, id);
+		break;
+	case 2:
+		id = missing_id (index % 7);
+		g_array_append_val (references, id);
+		id = message_id (index / 3);
+		g_array_append_val (references, id);
+		break;
+	case 3:
+		id = message_id (index + 3);
+		g_array_append_val (references, id);
+		break;
+	case 4:
+		id = missing_id (1000 + index);
+		g_array_append_val (references, id);
+		id = message_id (index / 4);
+		g_array_append_val (references, id);
+		break;
+	case 5:
+		id = missing_id (index % 5);
+		g_array_append_val (references, id);
+		break;
+	}
+
+	return references;
+}
+
+static void
+add_messages (CamelFolderSummary *summary)
+{
+	gint ii;
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMessageInfo *info;
+		gchar *uid, *subject;
+
+		uid = message_uid (ii);
+		/* most subjects are shared, thus grouped, some are not */
+		if ((ii % 7) == 3)
+			subject = g_strdup_printf ("%sunique %d", (ii % 2) ? "Re: " : "", ii);
+		else
+			subject = g_strdup_printf ("%stopic %d", (ii % 3) ? "Re: " : "", ii % 11);
+
+		info = camel_message_info_new (summary);
+		camel_message_info_set_uid (info, uid);
+		camel_message_info_set_subject (info, subject);
+		camel_message_info_set_message_id (info, message_id (ii));
+		camel_message_info_take_references (info, message_references (ii));
+		camel_folder_summary_add (summary, info, TRUE);
+
+		g_object_unref (info);
+		g_free (subject);
+		g_free (uid);
+	}
+}
+
+static void
+check_same_tree (CamelFolderThreadNode *node,
+                 CamelFolderThreadNode *expected)
+{
+	while (node && expected) {
+		const gchar *uid = camel_message_info_get_uid (node->message);
+		const gchar *expected_uid = camel_message_info_get_uid (expected->message);
+
+		check_msg (g_strcmp0 (uid, expected_uid) == 0, "Node %s instead of %s", uid, expected_uid);
+
+		check_same_tree (node->child, expected->child);
+
+		node = node->next;
+		expected = expected->next;
+	}
+
+	check_msg (node == NULL, "Extra node %s", node ? camel_message_info_get_uid (node->message) : "");
+	check_msg (expected == NULL, "Missing node %s", expected ? camel_message_info_get_uid (expected->message) : "");
+}
+
+static void
+check_thread (CamelFolder *folder,
+              CamelFolderThread *thread,
+              GPtrArray *uids,
+              gboolean thread_subject)
+{
+	CamelFolderThread *expected;
+
+	expected = camel_folder_thread_messages_new (folder, uids, thread_subject);
+
+	check_same_tree (thread->tree, expected->tree);
+	check_msg (thread->summary->len == uids->len, "%u messages in the thread summary, expected %u", thread->summary->len, uids->len);
+
+	camel_folder_thread_messages_unref (expected);
+}
+
+static void
+test_thread_changes (CamelFolder *folder,
+                     gboolean thread_subject)
+{
+	CamelFolderThread *thread;
+	GPtrArray *uids, *absent, *removed;
+	GRand *rand;
+	gint ii, step;
+
+	rand = g_rand_new_with_seed (38);
+
+	/* the UID-s move between the arrays, freed at the end */
+	uids = g_ptr_array_new ();
+	absent = g_ptr_array_new ();
+
+	for (ii = 0; ii < N_MESSAGES; ii++)
+		g_ptr_array_add (ii < N_INITIAL ? uids : absent, message_uid (ii));
+
+	thread = camel_folder_thread_messages_new (folder, uids, thread_subject);
+	check_thread (folder, thread, uids, thread_subject);
+
+	for (step = 0; step < N_STEPS; step++) {
+		CamelFolderChangeInfo *changes;
+		gint n_changes;
+
+		/* mostly few changes, updated in place, sometimes many */
+		n_changes = (step % 10) == 9 ? 40 : g_rand_int_range (rand, 1, 4);
+
+		changes = camel_folder_change_info_new ();
+		removed = g_ptr_array_new ();
+
+		for (ii = 0; ii < n_changes; ii++) {
+			gchar *uid;
+
+			if (g_rand_boolean (rand) && uids->len > 1) {
+				uid = g_ptr_array_remove_index (uids, g_rand_int_range (rand, 0, uids->len));
+				camel_folder_change_info_remove_uid (changes, uid);
+				g_ptr_array_add (removed, uid);
+			} else if (absent->len > 0) {
+				uid = g_ptr_array_remove_index (absent, g_rand_int_range (rand, 0, absent->len));
+				camel_folder_change_info_add_uid (changes, uid);
+				g_ptr_array_add (uids, uid);
+			}
+		}
+
+		/* can be added again in the next steps */
+		for (ii = 0; ii < removed->len; ii++)
+			g_ptr_array_add (absent, removed->pdata[ii]);
+		g_ptr_array_free (removed, TRUE);
+
+		if (step % 2)
+			camel_folder_thread_messages_apply_changes (thread, changes);
+		else
+			camel_folder_thread_messages_apply (thread, uids);
+
+		camel_folder_change_info_free (changes);
+
+		check_thread (folder, thread, uids, thread_subject);
+	}
+
+	camel_folder_thread_messages_unref (thread);
+
+	g_ptr_array_foreach (absent, (GFunc) g_free, NULL);
+	g_ptr_array_foreach (uids, (GFunc) g_free, NULL);
+	g_ptr_array_free (absent, TRUE);
+	g_ptr_array_free (uids, TRUE);
+	g_rand_free (rand);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+	CamelFolderSummary *summary;
+	CamelStore *store;
+	CamelFolder *folder;
+	GError *error = NULL;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	camel_test_start ("Message threading updated with changes");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+
+	push ("creating a fake store");
+	store = g_initable_new (
+		test_fake_store_get_type (), NULL, &error,
+		"session", session,
+		"uid", "fake",
+		"display-name", "Fake",
+		NULL);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (store != NULL);
+
+	folder = g_object_new (
+		test_fake_folder_get_type (),
+		"display-name", "Inbox",
+		"full-name", "INBOX",
+		"parent-store", store,
+		NULL);
+
+	summary = camel_folder_summary_new (folder);
+	camel_folder_take_folder_summary (folder, summary);
+
+	add_messages (summary);
+	pull ();
+
+	push ("threading by references");
+	test_thread_changes (folder, FALSE);
+	pull ();
+
+	push ("threading by references and subject");
+	test_thread_changes (folder, TRUE);
+	pull ();
+
+	g_object_unref (folder);
+	g_object_unref (store);
+	g_object_unref (session);
+
+	camel_test_end ();
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
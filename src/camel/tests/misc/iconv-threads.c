@@ -0,0 +1,158 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Charset conversion timing, with many threads decoding headers and bodies */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "camel-test.h"
+
+#define N_THREADS (8)
+#define N_ITERATIONS (20000)
+
+static const struct {
+	const gchar *header;
+	const gchar *decoded;
+} headers[] = {
+	{ "=?iso-8859-1?q?caf=E9?=", "caf\xc3\xa9" },
+	{ "=?iso-8859-2?q?=B1?=", "\xc4\x85" },
+	{ "=?utf-8?b?xI0=?=", "\xc4\x8d" },
+	{ "=?us-ascii?q?plain_text?=", "plain text" },
+	{ "caf\xc3\xa9 in UTF-8", "caf\xc3\xa9 in UTF-8" },
+	{ "=?koi8-r?q?=C1?=", "\xd0\xb0" }
+};
+
+static const struct {
+	const gchar *charset;
+	const gchar *body;
+	const gchar *converted;
+} bodies[] = {
+	{ "iso-8859-1", "Gr\xfc\xdf" "e aus K\xf6ln\n", "Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln\n" },
+	{ "utf-8", "Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln\n", "Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln\n" },
+	{ "us-ascii", "Hello world\n", "Hello world\n" },
+	{ "iso-8859-2", "\xb1\n", "\xc4\x85\n" }
+};
+
+static gint n_failures = 0;
+
+static gboolean
+check_body (gint index)
+{
+	CamelStream *stream;
+	CamelStream *filter_stream;
+	CamelMimeFilter *filter;
+	GByteArray *array;
+	gboolean success;
+
+	array = g_byte_array_new ();
+	stream = camel_stream_mem_new_with_byte_array (array);
+	filter_stream = camel_stream_filter_new (stream);
+
+	filter = camel_mime_filter_charset_new (bodies[index].charset, "UTF-8");
+	camel_stream_filter_add (CAMEL_STREAM_FILTER (filter_stream), filter);
+	g_object_unref (filter);
+
+	camel_stream_write_string (filter_stream, bodies[index].body, NULL, NULL);
+	camel_stream_flush (filter_stream, NULL, NULL);
+
+	success = array->len == strlen (bodies[index].converted) &&
+		memcmp (array->data, bodies[index].converted, array->len) == 0;
+
+	g_object_unref (filter_stream);
+	g_object_unref (stream);
+
+	return success;
+}
+
+static gpointer
+decode_thread (gpointer user_data)
+{
+	gint ii;
+
+	for (ii = 0; ii < N_ITERATIONS; ii++) {
+		gint index = ii % G_N_ELEMENTS (headers);
+		gchar *decoded;
+
+		decoded = camel_header_decode_string (headers[index].header, NULL);
+		if (g_strcmp0 (decoded, headers[index].decoded) != 0)
+			g_atomic_int_inc (&n_failures);
+		g_free (decoded);
+
+		if (!check_body (ii % G_N_ELEMENTS (bodies)))
+			g_atomic_int_inc (&n_failures);
+	}
+
+	return NULL;
+}
+
+static gdouble
+run_threads (gint n_threads)
+{
+	GThread *threads[N_THREADS];
+	GTimer *timer;
+	gdouble elapsed;
+	gint ii;
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < n_threads; ii++)
+		threads[ii] = g_thread_new (NULL, decode_thread, NULL);
+
+	for (ii = 0; ii < n_threads; ii++)
+		g_thread_join (threads[ii]);
+
+	g_timer_stop (timer);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	return elapsed;
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	gdouble elapsed;
+	gint n_threads;
+
+	camel_test_init (argc, argv);
+
+	camel_test_start ("Charset conversion in many threads");
+
+	push ("checking fast paths");
+	check (camel_iconv_get_fast_path ("UTF-8", "iso-8859-1") == CAMEL_ICONV_FAST_PATH_LATIN1);
+	check (camel_iconv_get_fast_path ("UTF-8", "us-ascii") == CAMEL_ICONV_FAST_PATH_ASCII);
+	check (camel_iconv_get_fast_path ("utf-8", "UTF8") == CAMEL_ICONV_FAST_PATH_UTF8);
+	check (camel_iconv_get_fast_path ("UTF-8", "iso-8859-2") == CAMEL_ICONV_FAST_PATH_NONE);
+	check (camel_iconv_get_fast_path ("iso-8859-1", "UTF-8") == CAMEL_ICONV_FAST_PATH_NONE);
+	check (camel_iconv_is_ascii ("0123456789abcdef0123456789abcdef0123456789", 42));
+	check (!camel_iconv_is_ascii ("0123456789abcdef0123456789abcdef012345678\xe9", 42));
+	check (camel_iconv_fast_strndup ("UTF-8", "us-ascii", "caf\xe9", 4) == NULL);
+	check (camel_iconv_fast_strndup ("UTF-8", "utf-8", "caf\xe9", 4) == NULL);
+	pull ();
+
+	for (n_threads = 1; n_threads <= N_THREADS; n_threads *= 2) {
+		push ("decoding in %d threads", n_threads);
+		elapsed = run_threads (n_threads);
+		printf ("Decoded %d headers and bodies in each of %d threads in %.3f seconds\n",
+			N_ITERATIONS, n_threads, elapsed);
+		check_msg (g_atomic_int_get (&n_failures) == 0, "%d conversions failed", g_atomic_int_get (&n_failures));
+		pull ();
+	}
+
+	camel_test_end ();
+
+	return 0;
+}
@@ -0,0 +1,280 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Batch methods of CamelJunkFilter, with junk filters counting their invocations */
+
+#include <string.h>
+
+#include "camel-test.h"
+
+#define N_MESSAGES (120)
+
+typedef struct _TestJunkFilter {
+	GObject parent;
+
+	guint n_classify;
+	guint n_learn_junk;
+	guint n_learn_not_junk;
+	guint n_classify_batch;
+	guint n_learn_junk_batch;
+	guint n_learn_not_junk_batch;
+	guint n_messages;
+} TestJunkFilter;
+
+typedef struct _TestJunkFilterClass {
+	GObjectClass parent_class;
+} TestJunkFilterClass;
+
+static void test_junk_filter_interface_init (CamelJunkFilterInterface *iface);
+static void test_batch_junk_filter_interface_init (CamelJunkFilterInterface *iface);
+
+/* implements only the required methods */
+G_DEFINE_TYPE_WITH_CODE (TestJunkFilter, test_junk_filter, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (CAMEL_TYPE_JUNK_FILTER, test_junk_filter_interface_init))
+
+/* implements also the batch methods, like a filter running an external program */
+typedef TestJunkFilter TestBatchJunkFilter;
+typedef TestJunkFilterClass TestBatchJunkFilterClass;
+
+G_DEFINE_TYPE_WITH_CODE (TestBatchJunkFilter, test_batch_junk_filter, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE (CAMEL_TYPE_JUNK_FILTER, test_batch_junk_filter_interface_init))
+
+static CamelJunkStatus
+test_junk_filter_classify (CamelJunkFilter *junk_filter,
+                           CamelMimeMessage *message,
+                           GCancellable *cancellable,
+                           GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_classify++;
+	tjf->n_messages++;
+
+	return strstr (camel_mime_message_get_subject (message), "spam") ?
+		CAMEL_JUNK_STATUS_MESSAGE_IS_JUNK : CAMEL_JUNK_STATUS_MESSAGE_IS_NOT_JUNK;
+}
+
+static gboolean
+test_junk_filter_learn_junk (CamelJunkFilter *junk_filter,
+                             CamelMimeMessage *message,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_learn_junk++;
+	tjf->n_messages++;
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_learn_not_junk (CamelJunkFilter *junk_filter,
+                                 CamelMimeMessage *message,
+                                 GCancellable *cancellable,
+                                 GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_learn_not_junk++;
+	tjf->n_messages++;
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_classify_batch (CamelJunkFilter *junk_filter,
+                                 GPtrArray *messages,
+                                 CamelJunkStatus *out_statuses,
+                                 GCancellable *cancellable,
+                                 GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+	guint ii;
+
+	tjf->n_classify_batch++;
+	tjf->n_messages += messages->len;
+
+	for (ii = 0; ii < messages->len; ii++) {
+		out_statuses[ii] = strstr (camel_mime_message_get_subject (messages->pdata[ii]), "spam") ?
+			CAMEL_JUNK_STATUS_MESSAGE_IS_JUNK : CAMEL_JUNK_STATUS_MESSAGE_IS_NOT_JUNK;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_learn_junk_batch (CamelJunkFilter *junk_filter,
+                                   GPtrArray *messages,
+                                   GCancellable *cancellable,
+                                   GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_learn_junk_batch++;
+	tjf->n_messages += messages->len;
+
+	return TRUE;
+}
+
+static gboolean
+test_junk_filter_learn_not_junk_batch (CamelJunkFilter *junk_filter,
+                                       GPtrArray *messages,
+                                       GCancellable *cancellable,
+                                       GError **error)
+{
+	TestJunkFilter *tjf = (TestJunkFilter *) junk_filter;
+
+	tjf->n_learn_not_junk_batch++;
+	tjf->n_messages += messages->len;
+
+	return TRUE;
+}
+
+static void
+test_junk_filter_interface_init (CamelJunkFilterInterface *iface)
+{
+	iface->classify = test_junk_filter_classify;
+	iface->learn_junk = test_junk_filter_learn_junk;
+	iface->learn_not_junk = test_junk_filter_learn_not_junk;
+}
+
+static void
+test_batch_junk_filter_interface_init (CamelJunkFilterInterface *iface)
+{
+	test_junk_filter_interface_init (iface);
+
+	iface->classify_batch = test_junk_filter_classify_batch;
+	iface->learn_junk_batch = test_junk_filter_learn_junk_batch;
+	iface->learn_not_junk_batch = test_junk_filter_learn_not_junk_batch;
+}
+
+static void
+test_junk_filter_class_init (TestJunkFilterClass *class)
+{
+}
+
+static void
+test_junk_filter_init (TestJunkFilter *tjf)
+{
+}
+
+static void
+test_batch_junk_filter_class_init (TestBatchJunkFilterClass *class)
+{
+}
+
+static void
+test_batch_junk_filter_init (TestBatchJunkFilter *tjf)
+{
+}
+
+static GPtrArray *
+create_messages (void)
+{
+	GPtrArray *messages;
+	gint ii;
+
+	messages = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		CamelMimeMessage *message;
+		gchar *subject;
+
+		message = camel_mime_message_new ();
+		subject = g_strdup_printf ("%s %d", (ii % 3) == 0 ? "spam" : "ham", ii);
+		camel_mime_message_set_subject (message, subject);
+		camel_mime_part_set_content (CAMEL_MIME_PART (message), "text\n", 5, "text/plain");
+		g_free (subject);
+
+		g_ptr_array_add (messages, message);
+	}
+
+	return messages;
+}
+
+static void
+test_junk_filter_batches (CamelJunkFilter *junk_filter,
+                          GPtrArray *messages)
+{
+	CamelJunkStatus statuses[N_MESSAGES];
+	GPtrArray *empty;
+	GError *error = NULL;
+	gint ii;
+
+	check (camel_junk_filter_learn_junk_batch (junk_filter, messages, NULL, &error));
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	check (camel_junk_filter_learn_not_junk_batch (junk_filter, messages, NULL, &error));
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	memset (statuses, 0, sizeof (statuses));
+	check (camel_junk_filter_classify_batch (junk_filter, messages, statuses, NULL, &error));
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		check_msg (statuses[ii] == ((ii % 3) == 0 ? CAMEL_JUNK_STATUS_MESSAGE_IS_JUNK : CAMEL_JUNK_STATUS_MESSAGE_IS_NOT_JUNK),
+			"Message %d classified as %d", ii, statuses[ii]);
+	}
+
+	/* nothing to do for no messages */
+	empty = g_ptr_array_new ();
+	check (camel_junk_filter_learn_junk_batch (junk_filter, empty, NULL, &error));
+	check (camel_junk_filter_classify_batch (junk_filter, empty, NULL, NULL, &error));
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	g_ptr_array_unref (empty);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	TestJunkFilter *tjf;
+	GPtrArray *messages;
+
+	camel_test_init (argc, argv);
+
+	messages = create_messages ();
+
+	camel_test_start ("Junk filter batch methods");
+
+	push ("default batch implementation calls the single-message methods");
+	tjf = g_object_new (test_junk_filter_get_type (), NULL);
+	test_junk_filter_batches (CAMEL_JUNK_FILTER (tjf), messages);
+	check_msg (tjf->n_learn_junk == N_MESSAGES, "learn_junk called %u times", tjf->n_learn_junk);
+	check_msg (tjf->n_learn_not_junk == N_MESSAGES, "learn_not_junk called %u times", tjf->n_learn_not_junk);
+	check_msg (tjf->n_classify == N_MESSAGES, "classify called %u times", tjf->n_classify);
+	check (tjf->n_messages == 3 * N_MESSAGES);
+	check_unref (tjf, 1);
+	pull ();
+
+	push ("batch implementation is called once per batch");
+	tjf = g_object_new (test_batch_junk_filter_get_type (), NULL);
+	test_junk_filter_batches (CAMEL_JUNK_FILTER (tjf), messages);
+	check (tjf->n_learn_junk == 0);
+	check (tjf->n_learn_not_junk == 0);
+	check (tjf->n_classify == 0);
+	check_msg (tjf->n_learn_junk_batch == 1, "learn_junk_batch called %u times", tjf->n_learn_junk_batch);
+	check_msg (tjf->n_learn_not_junk_batch == 1, "learn_not_junk_batch called %u times", tjf->n_learn_not_junk_batch);
+	check_msg (tjf->n_classify_batch == 1, "classify_batch called %u times", tjf->n_classify_batch);
+	check (tjf->n_messages == 3 * N_MESSAGES);
+	check_unref (tjf, 1);
+	pull ();
+
+	camel_test_end ();
+
+	g_ptr_array_unref (messages);
+
+	return 0;
+}
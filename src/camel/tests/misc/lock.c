@@ -0,0 +1,188 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Folder lock hand-off latency, between two processes */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "camel-test.h"
+
+#define LOCK_PATH "/tmp/camel-test/spool"
+#define N_ROUNDS (5)
+#define HOLD_TIME (100000) /* microseconds */
+/* microseconds; with the fixed retries every hand-off took about 2 seconds,
+ * while the backoff takes milliseconds, but a loaded machine can stall any */
+#define MAX_AVERAGE_LATENCY (1000000)
+
+static gboolean
+read_all (gint fd,
+          gpointer buffer,
+          gsize len)
+{
+	gchar *p = buffer;
+
+	while (len > 0) {
+		gssize n = read (fd, p, len);
+
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+
+		p += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+/* the other process takes the lock, tells it holds it, keeps it for
+ * a while and then tells when exactly it released it */
+static void
+holder_process (gboolean dot_only,
+                gint out_fd)
+{
+	gint64 released;
+	gint fd;
+
+	fd = open (LOCK_PATH, O_RDWR);
+	if (fd == -1)
+		_exit (1);
+
+	if (dot_only ? camel_lock_dot (LOCK_PATH, NULL) : camel_lock_folder (LOCK_PATH, fd, CAMEL_LOCK_WRITE, NULL))
+		_exit (2);
+
+	if (write (out_fd, "L", 1) != 1)
+		_exit (3);
+
+	g_usleep (HOLD_TIME);
+
+	released = g_get_monotonic_time ();
+	if (dot_only)
+		camel_unlock_dot (LOCK_PATH);
+	else
+		camel_unlock_folder (LOCK_PATH, fd);
+
+	if (write (out_fd, &released, sizeof (released)) != sizeof (released))
+		_exit (4);
+
+	close (fd);
+
+	_exit (0);
+}
+
+static gint64
+measure_hand_off (gboolean dot_only)
+{
+	GError *error = NULL;
+	gint64 released = 0, acquired;
+	gint pipe_fds[2], fd, status = 0;
+	gchar c = 0;
+	pid_t pid;
+
+	check (pipe (pipe_fds) == 0);
+
+	pid = fork ();
+	check (pid != -1);
+
+	if (pid == 0) {
+		close (pipe_fds[0]);
+		holder_process (dot_only, pipe_fds[1]);
+	}
+
+	close (pipe_fds[1]);
+
+	fd = open (LOCK_PATH, O_RDWR);
+	check (fd != -1);
+
+	check (read_all (pipe_fds[0], &c, 1) && c == 'L');
+
+	if (dot_only)
+		check_msg (camel_lock_dot (LOCK_PATH, &error) == 0, "%s", error ? error->message : "");
+	else
+		check_msg (camel_lock_folder (LOCK_PATH, fd, CAMEL_LOCK_WRITE, &error) == 0, "%s", error ? error->message : "");
+	acquired = g_get_monotonic_time ();
+
+	check (read_all (pipe_fds[0], &released, sizeof (released)));
+	check (acquired >= released);
+
+	if (dot_only)
+		camel_unlock_dot (LOCK_PATH);
+	else
+		camel_unlock_folder (LOCK_PATH, fd);
+
+	check (waitpid (pid, &status, 0) == pid);
+	check_msg (WIFEXITED (status) && WEXITSTATUS (status) == 0, "holder process failed with status %d", status);
+
+	close (fd);
+	close (pipe_fds[0]);
+
+	return acquired - released;
+}
+
+static void
+test_hand_off (gboolean dot_only)
+{
+	gint64 latency, total = 0, longest = 0;
+	gint ii;
+
+	for (ii = 0; ii < N_ROUNDS; ii++) {
+		latency = measure_hand_off (dot_only);
+		total += latency;
+		longest = MAX (longest, latency);
+	}
+
+	printf ("%s lock hand-off latency: average %.3f ms, longest %.3f ms\n",
+		dot_only ? "Dot" : "Folder", total / N_ROUNDS / 1000.0, longest / 1000.0);
+
+	check_msg (total / N_ROUNDS < MAX_AVERAGE_LATENCY, "lock hand-off took %" G_GINT64_FORMAT " microseconds on average", total / N_ROUNDS);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	FILE *file;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+	g_mkdir_with_parents ("/tmp/camel-test", 0700);
+
+	file = fopen (LOCK_PATH, "w");
+	fputs ("From someone@example.com Mon Jan  1 00:00:00 2018\n\nHello\n\n", file);
+	fclose (file);
+
+	camel_test_start ("Folder lock hand-off between processes");
+
+	push ("folder lock");
+	test_hand_off (FALSE);
+	pull ();
+
+	push ("dot lock");
+	test_hand_off (TRUE);
+	pull ();
+
+	camel_test_end ();
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Partition table timing, indexing many distinct words */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "camel-test.h"
+
+#define N_WORDS (1000000)
+#define BATCH_SIZE (10000)
+
+static gchar **
+create_words (void)
+{
+	gchar **words;
+	gint ii;
+
+	words = g_new0 (gchar *, N_WORDS + 1);
+
+	for (ii = 0; ii < N_WORDS; ii++)
+		words[ii] = g_strdup_printf ("word%dx%x", ii, ii * 7919);
+
+	return words;
+}
+
+static CamelPartitionTable *
+create_table (const gchar *path,
+              CamelBlockFile **out_blocks,
+              camel_block_t *out_root)
+{
+	CamelBlockFile *blocks;
+	CamelPartitionTable *table;
+	CamelBlock *block;
+	camel_block_t root;
+
+	blocks = camel_block_file_new (path, O_RDWR | O_CREAT, "PARTTEST", CAMEL_BLOCK_SIZE);
+	check (blocks != NULL);
+
+	block = camel_block_file_new_block (blocks);
+	check (block != NULL);
+	root = block->id;
+	camel_block_file_unref_block (blocks, block);
+
+	table = camel_partition_table_new (blocks, root);
+	check (table != NULL);
+
+	*out_blocks = blocks;
+	*out_root = root;
+
+	return table;
+}
+
+static void
+check_lookups (CamelPartitionTable *table,
+               gchar **words,
+               const gchar *how)
+{
+	GTimer *timer;
+	gint ii, n_found = 0, n_exact = 0;
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < N_WORDS; ii++) {
+		camel_key_t keyid = camel_partition_table_lookup (table, words[ii]);
+
+		if (keyid != 0)
+			n_found++;
+		if (keyid == (camel_key_t) (ii + 1))
+			n_exact++;
+	}
+
+	g_timer_stop (timer);
+	printf ("Looked up %d words added %s in %.3f seconds, %d hash collisions\n",
+		N_WORDS, how, g_timer_elapsed (timer, NULL), N_WORDS - n_exact);
+	g_timer_destroy (timer);
+
+	/* colliding hashes find the other key, but still find one */
+	check_msg (n_found == N_WORDS, "Only %d of %d words found", n_found, N_WORDS);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelPartitionTable *table;
+	CamelBlockFile *blocks;
+	camel_block_t root;
+	camel_key_t *keyids;
+	GTimer *timer;
+	gchar **words;
+	gint ii;
+
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+	g_mkdir_with_parents ("/tmp/camel-test", 0700);
+
+	words = create_words ();
+	keyids = g_new (camel_key_t, N_WORDS);
+	for (ii = 0; ii < N_WORDS; ii++)
+		keyids[ii] = ii + 1;
+
+	camel_test_start ("Partition table with many distinct words");
+
+	push ("adding %d words one at a time", N_WORDS);
+	table = create_table ("/tmp/camel-test/single.index", &blocks, &root);
+
+	timer = g_timer_new ();
+	for (ii = 0; ii < N_WORDS; ii++)
+		check (camel_partition_table_add (table, words[ii], keyids[ii]) == 0);
+	g_timer_stop (timer);
+	printf ("Added %d words one at a time in %.3f seconds\n", N_WORDS, g_timer_elapsed (timer, NULL));
+	g_timer_destroy (timer);
+
+	check_lookups (table, words, "one at a time");
+	check_unref (table, 1);
+	check_unref (blocks, 1);
+	pull ();
+
+	push ("adding %d words in batches of %d", N_WORDS, BATCH_SIZE);
+	table = create_table ("/tmp/camel-test/batch.index", &blocks, &root);
+
+	timer = g_timer_new ();
+	for (ii = 0; ii < N_WORDS; ii += BATCH_SIZE)
+		check (camel_partition_table_add_many (table, (const gchar * const *) words + ii, keyids + ii, MIN (BATCH_SIZE, N_WORDS - ii)) == 0);
+	g_timer_stop (timer);
+	printf ("Added %d words in batches of %d in %.3f seconds\n", N_WORDS, BATCH_SIZE, g_timer_elapsed (timer, NULL));
+	g_timer_destroy (timer);
+
+	check_lookups (table, words, "in batches");
+	pull ();
+
+	push ("reloading the table");
+	check (camel_partition_table_sync (table) == 0);
+	check_unref (table, 1);
+
+	table = camel_partition_table_new (blocks, root);
+	check (table != NULL);
+	check_lookups (table, words, "before reload");
+	check_unref (table, 1);
+	check_unref (blocks, 1);
+	pull ();
+
+	camel_test_end ();
+
+	g_strfreev (words);
+	g_free (keyids);
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
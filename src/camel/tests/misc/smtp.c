@@ -0,0 +1,486 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* SMTP PIPELINING and CHUNKING, against a local mock SMTP server */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "camel-test.h"
+#include "camel-test-provider.h"
+#include "session.h"
+
+#define N_MESSAGES (3)
+
+static const gchar *smtp_drivers[] = { "smtp" };
+
+typedef struct _MockServer {
+	GSocketListener *listener;
+	GCancellable *cancellable;
+	GThread *thread;
+	guint16 port;
+
+	gboolean pipelining;
+	gboolean chunking;
+
+	/* how many times the server waited for the client, after replying */
+	volatile gint round_trips;
+	volatile gint n_delivered;
+
+	GMutex lock;
+	gchar *last_body;
+} MockServer;
+
+static void
+mock_server_write (GOutputStream *output,
+                   const gchar *str)
+{
+	g_output_stream_write_all (output, str, strlen (str), NULL, NULL, NULL);
+}
+
+static gchar *
+mock_server_read_line (MockServer *server,
+                       GDataInputStream *input,
+                       gboolean *replied)
+{
+	gchar *line;
+	gsize len;
+
+	if (*replied && !g_buffered_input_stream_get_available (G_BUFFERED_INPUT_STREAM (input))) {
+		g_atomic_int_inc (&server->round_trips);
+		*replied = FALSE;
+	}
+
+	line = g_data_input_stream_read_line (input, &len, NULL, NULL);
+
+	if (line && len && line[len - 1] == '\r')
+		line[len - 1] = '\0';
+
+	return line;
+}
+
+static void
+mock_server_deliver (MockServer *server,
+                     GString *body)
+{
+	g_mutex_lock (&server->lock);
+	g_free (server->last_body);
+	server->last_body = g_strdup (body->str);
+	g_mutex_unlock (&server->lock);
+
+	g_atomic_int_inc (&server->n_delivered);
+}
+
+static void
+mock_server_handle_connection (MockServer *server,
+                               GSocketConnection *connection)
+{
+	GDataInputStream *input;
+	GOutputStream *output;
+	GString *body;
+	gboolean replied = TRUE;
+	guint n_rcpts = 0;
+	gchar *line;
+
+	input = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+	body = g_string_new ("");
+
+	mock_server_write (output, "220 mock ESMTP ready\r\n");
+
+	while (line = mock_server_read_line (server, input, &replied), line) {
+		gboolean done = FALSE;
+
+		replied = TRUE;
+
+		if (g_ascii_strncasecmp (line, "EHLO", 4) == 0) {
+			mock_server_write (output, "250-mock\r\n");
+			if (server->pipelining)
+				mock_server_write (output, "250-PIPELINING\r\n");
+			if (server->chunking)
+				mock_server_write (output, "250-CHUNKING\r\n");
+			mock_server_write (output, "250 8BITMIME\r\n");
+		} else if (g_ascii_strncasecmp (line, "MAIL FROM:", 10) == 0) {
+			n_rcpts = 0;
+			g_string_truncate (body, 0);
+			mock_server_write (output, "250 Sender OK\r\n");
+		} else if (g_ascii_strncasecmp (line, "RCPT TO:", 8) == 0) {
+			if (strstr (line, "reject")) {
+				mock_server_write (output, "550 No such user\r\n");
+			} else {
+				n_rcpts++;
+				mock_server_write (output, "250 Recipient OK\r\n");
+			}
+		} else if (g_ascii_strcasecmp (line, "DATA") == 0) {
+			if (!n_rcpts) {
+				mock_server_write (output, "554 No valid recipients\r\n");
+			} else {
+				gboolean finished = FALSE;
+
+				mock_server_write (output, "354 End data with <CR><LF>.<CR><LF>\r\n");
+
+				g_free (line);
+
+				while (line = mock_server_read_line (server, input, &replied), line) {
+					if (g_strcmp0 (line, ".") == 0) {
+						finished = TRUE;
+						break;
+					}
+
+					/* undo the dot-stuffing */
+					g_string_append (body, line[0] == '.' ? line + 1 : line);
+					g_string_append (body, "\r\n");
+
+					g_free (line);
+				}
+
+				/* A transaction without the final dot is not delivered */
+				if (!finished)
+					break;
+
+				mock_server_deliver (server, body);
+				mock_server_write (output, "250 Queued\r\n");
+				n_rcpts = 0;
+			}
+		} else if (g_ascii_strncasecmp (line, "BDAT ", 5) == 0) {
+			gchar *end = NULL, *chunk;
+			gsize size;
+
+			size = strtoul (line + 5, &end, 10);
+			chunk = g_malloc0 (size + 1);
+
+			if (size && !g_input_stream_read_all (G_INPUT_STREAM (input), chunk, size, NULL, NULL, NULL)) {
+				g_free (chunk);
+				break;
+			}
+
+			g_string_append_len (body, chunk, size);
+			g_free (chunk);
+
+			if (end && g_ascii_strcasecmp (g_strstrip (end), "LAST") == 0) {
+				if (n_rcpts) {
+					mock_server_deliver (server, body);
+					mock_server_write (output, "250 Queued\r\n");
+				} else {
+					mock_server_write (output, "554 No valid recipients\r\n");
+				}
+
+				n_rcpts = 0;
+			} else {
+				mock_server_write (output, "250 Chunk received\r\n");
+			}
+		} else if (g_ascii_strcasecmp (line, "RSET") == 0) {
+			n_rcpts = 0;
+			g_string_truncate (body, 0);
+			mock_server_write (output, "250 Reset\r\n");
+		} else if (g_ascii_strcasecmp (line, "QUIT") == 0) {
+			mock_server_write (output, "221 Bye\r\n");
+			done = TRUE;
+		} else {
+			mock_server_write (output, "250 OK\r\n");
+		}
+
+		g_free (line);
+
+		if (done)
+			break;
+	}
+
+	g_string_free (body, TRUE);
+	g_object_unref (input);
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+}
+
+static gpointer
+mock_server_thread (gpointer user_data)
+{
+	MockServer *server = user_data;
+	GSocketConnection *connection;
+
+	while (connection = g_socket_listener_accept (server->listener, NULL, server->cancellable, NULL), connection) {
+		mock_server_handle_connection (server, connection);
+		g_object_unref (connection);
+	}
+
+	return NULL;
+}
+
+static MockServer *
+mock_server_new (gboolean pipelining,
+                 gboolean chunking)
+{
+	MockServer *server;
+	GError *error = NULL;
+
+	server = g_new0 (MockServer, 1);
+	server->pipelining = pipelining;
+	server->chunking = chunking;
+	server->cancellable = g_cancellable_new ();
+	g_mutex_init (&server->lock);
+
+	server->listener = g_socket_listener_new ();
+	server->port = g_socket_listener_add_any_inet_port (server->listener, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	server->thread = g_thread_new ("mock-smtp", mock_server_thread, server);
+
+	return server;
+}
+
+static void
+mock_server_free (MockServer *server)
+{
+	g_cancellable_cancel (server->cancellable);
+	g_thread_join (server->thread);
+	g_socket_listener_close (server->listener);
+	g_object_unref (server->listener);
+	g_object_unref (server->cancellable);
+	g_mutex_clear (&server->lock);
+	g_free (server->last_body);
+	g_free (server);
+}
+
+/* The @n_padding_lines make the message larger than one BDAT chunk */
+static CamelMimeMessage *
+create_message (gint index,
+                guint n_padding_lines)
+{
+	CamelMimeMessage *message;
+	CamelInternetAddress *addr;
+	GString *text;
+	gchar *subject;
+	guint ii;
+
+	message = camel_mime_message_new ();
+
+	subject = g_strdup_printf ("Message %d", index);
+	camel_mime_message_set_subject (message, subject);
+	g_free (subject);
+
+	addr = camel_internet_address_new ();
+	camel_internet_address_add (addr, "Sender", "sender@example.com");
+	camel_mime_message_set_from (message, addr);
+	g_object_unref (addr);
+
+	text = g_string_new (
+		"First line\n"
+		".leading dot\n"
+		"..two leading dots\n"
+		".\n"
+		"Last line\n");
+
+	for (ii = 0; ii < n_padding_lines; ii++) {
+		g_string_append_printf (text, "Padding line %u\n", ii);
+	}
+
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), text->str, text->len, "text/plain");
+
+	g_string_free (text, TRUE);
+
+	return message;
+}
+
+static gboolean
+send_message (CamelService *service,
+              gint index,
+              const gchar *recipient,
+              guint n_padding_lines,
+              GError **error)
+{
+	CamelMimeMessage *message;
+	CamelInternetAddress *from, *recipients;
+	gboolean sent_message_saved = FALSE;
+	gboolean success;
+
+	message = create_message (index, n_padding_lines);
+
+	from = camel_internet_address_new ();
+	camel_internet_address_add (from, "Sender", "sender@example.com");
+
+	recipients = camel_internet_address_new ();
+	camel_internet_address_add (recipients, "User", "user@example.com");
+	if (recipient)
+		camel_internet_address_add (recipients, NULL, recipient);
+
+	success = camel_transport_send_to_sync (
+		CAMEL_TRANSPORT (service), message,
+		CAMEL_ADDRESS (from), CAMEL_ADDRESS (recipients),
+		&sent_message_saved, NULL, error);
+
+	g_object_unref (recipients);
+	g_object_unref (from);
+	g_object_unref (message);
+
+	return success;
+}
+
+static void
+check_last_body (MockServer *server)
+{
+	g_mutex_lock (&server->lock);
+	check_msg (server->last_body != NULL, "No message delivered");
+	check_msg (strstr (server->last_body, "\r\nFirst line\r\n.leading dot\r\n..two leading dots\r\n.\r\nLast line\r\n") != NULL,
+		"Unexpected message body:\n%s", server->last_body);
+	g_mutex_unlock (&server->lock);
+}
+
+static void
+test_transport (CamelSession *session,
+                gboolean pipelining,
+                gboolean chunking,
+                gint max_round_trips_per_message)
+{
+	MockServer *server;
+	CamelService *service;
+	CamelSettings *settings;
+	gchar *uid;
+	gint ii, round_trips, n_delivered;
+	GError *error = NULL;
+
+	server = mock_server_new (pipelining, chunking);
+
+	push ("connecting to the mock server");
+	uid = g_strdup_printf ("smtp-test-%d-%d", pipelining, chunking);
+	service = camel_session_add_service (session, uid, "smtp", CAMEL_PROVIDER_TRANSPORT, &error);
+	g_free (uid);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (service != NULL);
+
+	settings = camel_service_ref_settings (service);
+	g_object_set (
+		settings,
+		"host", "127.0.0.1",
+		"port", (guint) server->port,
+		"security-method", CAMEL_NETWORK_SECURITY_METHOD_NONE,
+		NULL);
+	g_object_unref (settings);
+
+	camel_service_connect_sync (service, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	pull ();
+
+	push ("sending %d messages over one connection", N_MESSAGES);
+	round_trips = g_atomic_int_get (&server->round_trips);
+
+	for (ii = 0; ii < N_MESSAGES; ii++) {
+		send_message (service, ii, NULL, 0, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+		check_last_body (server);
+	}
+
+	check_msg (g_atomic_int_get (&server->n_delivered) == N_MESSAGES,
+		"Expected %d delivered messages, got %d", N_MESSAGES, g_atomic_int_get (&server->n_delivered));
+
+	round_trips = g_atomic_int_get (&server->round_trips) - round_trips;
+	check_msg (round_trips <= max_round_trips_per_message * N_MESSAGES,
+		"Expected at most %d round trips, got %d", max_round_trips_per_message * N_MESSAGES, round_trips);
+	pull ();
+
+	push ("sending to a rejected recipient");
+	n_delivered = g_atomic_int_get (&server->n_delivered);
+
+	check (!send_message (service, N_MESSAGES, "reject@example.com", 0, &error));
+	check_msg (error != NULL, "Expected a failure for a rejected recipient");
+	g_clear_error (&error);
+
+	check_msg (g_atomic_int_get (&server->n_delivered) == n_delivered,
+		"Message delivered to the accepted recipients, despite a rejected one");
+	pull ();
+
+	push ("sending after the failure");
+	if (camel_service_get_connection_status (service) != CAMEL_SERVICE_CONNECTED) {
+		camel_service_connect_sync (service, NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+	}
+
+	send_message (service, N_MESSAGES + 1, NULL, 0, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (g_atomic_int_get (&server->n_delivered) == n_delivered + 1);
+	check_last_body (server);
+	pull ();
+
+	push ("sending a message of several BDAT chunks");
+	send_message (service, N_MESSAGES + 2, NULL, 20000, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+	check (g_atomic_int_get (&server->n_delivered) == n_delivered + 2);
+	check_last_body (server);
+
+	g_mutex_lock (&server->lock);
+	check_msg (strstr (server->last_body, "\r\nPadding line 19999\r\n") != NULL, "The message end is missing");
+	g_mutex_unlock (&server->lock);
+	pull ();
+
+	push ("sending a large message to a rejected recipient");
+	n_delivered = g_atomic_int_get (&server->n_delivered);
+
+	if (camel_service_get_connection_status (service) != CAMEL_SERVICE_CONNECTED) {
+		camel_service_connect_sync (service, NULL, &error);
+		check_msg (error == NULL, "%s", error ? error->message : "");
+	}
+
+	check (!send_message (service, N_MESSAGES + 3, "reject@example.com", 20000, &error));
+	check_msg (error != NULL, "Expected a failure for a rejected recipient");
+	g_clear_error (&error);
+
+	check_msg (g_atomic_int_get (&server->n_delivered) == n_delivered,
+		"Message delivered to the accepted recipients, despite a rejected one");
+	pull ();
+
+	camel_service_disconnect_sync (service, TRUE, NULL, &error);
+	check_msg (error == NULL, "%s", error ? error->message : "");
+
+	camel_session_remove_service (session, service);
+	g_object_unref (service);
+
+	mock_server_free (server);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	CamelSession *session;
+
+	camel_test_init (argc, argv);
+	camel_test_provider_init (1, smtp_drivers);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	session = camel_test_session_new ("/tmp/camel-test");
+
+	camel_test_start ("SMTP without PIPELINING and CHUNKING");
+	/* MAIL FROM, RCPT TO, DATA and the message itself */
+	test_transport (session, FALSE, FALSE, 4);
+	camel_test_end ();
+
+	camel_test_start ("SMTP with PIPELINING");
+	/* the envelope with DATA, then the message */
+	test_transport (session, TRUE, FALSE, 2);
+	camel_test_end ();
+
+	camel_test_start ("SMTP with PIPELINING and CHUNKING");
+	/* the envelope, then the LAST BDAT chunk with the message */
+	test_transport (session, TRUE, TRUE, 2);
+	camel_test_end ();
+
+	camel_test_start ("SMTP with CHUNKING");
+	/* MAIL FROM, RCPT TO, then BDAT with the message */
+	test_transport (session, FALSE, TRUE, 3);
+	camel_test_end ();
+
+	check_unref (session, 1);
+
+	return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* UID cache migration, journal and rewrite */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-test.h"
+
+#define CACHE_PATH "/tmp/camel-test/uid-cache"
+#define N_ROUNDS (200)
+#define ROUND_SIZE (1000)
+#define WINDOW (5) /* rounds of UIDs kept on the server */
+
+static GPtrArray *
+make_uids (const gchar *first,
+           ...)
+{
+	GPtrArray *uids;
+	const gchar *uid;
+	va_list ap;
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+
+	va_start (ap, first);
+	for (uid = first; uid; uid = va_arg (ap, const gchar *))
+		g_ptr_array_add (uids, g_strdup (uid));
+	va_end (ap);
+
+	return uids;
+}
+
+static gboolean
+has_uid (GPtrArray *uids,
+         const gchar *uid)
+{
+	gint ii;
+
+	for (ii = 0; ii < uids->len; ii++) {
+		if (g_strcmp0 (uids->pdata[ii], uid) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gsize
+file_size (void)
+{
+	struct stat st;
+
+	check (g_stat (CACHE_PATH, &st) == 0);
+
+	return st.st_size;
+}
+
+static void
+append_file (const gchar *data,
+             gsize len)
+{
+	FILE *file;
+
+	file = fopen (CACHE_PATH, "ab");
+	check (file != NULL);
+	check (fwrite (data, 1, len, file) == len);
+	fclose (file);
+}
+
+static void
+test_format (void)
+{
+	CamelUIDCache *cache;
+	GPtrArray *uids, *new_uids;
+	gchar *contents = NULL;
+	gsize before;
+
+	push ("migrating the text format");
+	check (g_file_set_contents (CACHE_PATH, "uid1\nuid2\nuid3\n", -1, NULL));
+
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	uids = make_uids ("uid2", "uid3", "uid4", NULL);
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 1 && has_uid (new_uids, "uid4"), "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+	g_ptr_array_unref (uids);
+
+	camel_uid_cache_save_uid (cache, "uid4");
+	check (camel_uid_cache_save (cache));
+	camel_uid_cache_destroy (cache);
+
+	check (g_file_get_contents (CACHE_PATH, &contents, NULL, NULL));
+	check (strncmp (contents, "CAMELUID", 8) == 0);
+	g_free (contents);
+	pull ();
+
+	push ("appending saved UIDs");
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	/* uid1 expired on the previous save */
+	uids = make_uids ("uid1", "uid2", "uid3", "uid4", "uid5", NULL);
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 2 && has_uid (new_uids, "uid1") && has_uid (new_uids, "uid5"), "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+	g_ptr_array_unref (uids);
+
+	before = file_size ();
+	check (camel_uid_cache_save (cache));
+	check_msg (file_size () == before, "unchanged UIDs wrote %d bytes", (gint) (file_size () - before));
+
+	camel_uid_cache_save_uid (cache, "uid5");
+	check (camel_uid_cache_save (cache));
+	check_msg (file_size () == before + strlen ("+uid5") + 1, "one UID wrote %d bytes", (gint) (file_size () - before));
+	camel_uid_cache_destroy (cache);
+	pull ();
+
+	push ("appending removed UIDs");
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	uids = make_uids ("uid2", "uid5", NULL);
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 0, "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+	g_ptr_array_unref (uids);
+
+	check (camel_uid_cache_save (cache));
+	camel_uid_cache_destroy (cache);
+
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	uids = make_uids ("uid2", "uid3", "uid4", "uid5", NULL);
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 2 && has_uid (new_uids, "uid3") && has_uid (new_uids, "uid4"), "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+	g_ptr_array_unref (uids);
+	camel_uid_cache_destroy (cache);
+	pull ();
+
+	push ("ignoring a record cut short");
+	append_file ("+uid9", 5);
+
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	uids = make_uids ("uid2", "uid5", "uid9", NULL);
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 1 && has_uid (new_uids, "uid9"), "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+
+	camel_uid_cache_save_uid (cache, "uid9");
+	check (camel_uid_cache_save (cache));
+	camel_uid_cache_destroy (cache);
+
+	cache = camel_uid_cache_new (CACHE_PATH);
+	check (cache != NULL);
+
+	new_uids = camel_uid_cache_get_new_uids (cache, uids);
+	check_msg (new_uids->len == 0, "%d new UIDs", new_uids->len);
+	camel_uid_cache_free_uids (new_uids);
+	g_ptr_array_unref (uids);
+	camel_uid_cache_destroy (cache);
+	pull ();
+}
+
+static void
+test_rewrite (void)
+{
+	CamelUIDCache *cache;
+	GPtrArray *uids, *new_uids;
+	gsize largest = 0;
+	gint round, ii;
+
+	push ("keeping a window of %d rounds of %d UIDs", WINDOW, ROUND_SIZE);
+	g_unlink (CACHE_PATH);
+
+	for (round = 0; round < N_ROUNDS; round++) {
+		cache = camel_uid_cache_new (CACHE_PATH);
+		check (cache != NULL);
+
+		uids = g_ptr_array_new_with_free_func (g_free);
+		for (ii = MAX (0, round - WINDOW + 1) * ROUND_SIZE; ii < (round + 1) * ROUND_SIZE; ii++)
+			g_ptr_array_add (uids, g_strdup_printf ("%08X.%d", ii, ii * 31));
+
+		new_uids = camel_uid_cache_get_new_uids (cache, uids);
+		check_msg (new_uids->len == ROUND_SIZE, "round %d: %d new UIDs", round, new_uids->len);
+
+		/* saved in small batches, as the filter driver does */
+		for (ii = 0; ii < new_uids->len; ii++) {
+			camel_uid_cache_save_uid (cache, new_uids->pdata[ii]);
+			if (ii % 10 == 9)
+				check (camel_uid_cache_save (cache));
+		}
+
+		check (camel_uid_cache_save (cache));
+		camel_uid_cache_free_uids (new_uids);
+		g_ptr_array_unref (uids);
+		camel_uid_cache_destroy (cache);
+
+		largest = MAX (largest, file_size ());
+	}
+
+	/* about 16 bytes per UID, up to 32 bytes of slots per UID and a
+	 * journal of at most a half of the UIDs; it grew by megabytes
+	 * if the journal never got rewritten */
+	check_msg (largest < 100 * WINDOW * ROUND_SIZE, "the cache grew to %d bytes", (gint) largest);
+	pull ();
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	camel_test_init (argc, argv);
+
+	/* clear out any camel-test data */
+	system ("/bin/rm -rf /tmp/camel-test");
+	g_mkdir_with_parents ("/tmp/camel-test", 0700);
+
+	camel_test_start ("UID cache");
+
+	test_format ();
+	test_rewrite ();
+
+	camel_test_end ();
+
+	system ("/bin/rm -rf /tmp/camel-test");
+
+	return 0;
+}
@@ -22,12 +22,32 @@
 
 #include <libedataserver/libedataserver.h>
 
+#ifndef G_OS_WIN32
+#include <gio/gunixfdlist.h>
+#endif
+
 G_BEGIN_DECLS
 
 void		e_client_set_capabilities	(EClient *client, const gchar *capabilities);
 void		e_client_set_readonly		(EClient *client, gboolean readonly);
 void		e_client_set_online		(EClient *client, gboolean is_online);
 
+#ifndef G_OS_WIN32
+GOutputStream *	e_client_stream_new_writer	(GUnixFDList **out_fd_list,
+						 GError **error);
+GInputStream *	e_client_stream_new_reader	(GUnixFDList *fd_list,
+						 gint handle,
+						 GError **error);
+#endif
+gboolean	e_client_stream_write_record	(GOutputStream *stream,
+						 const gchar *record,
+						 GCancellable *cancellable,
+						 GError **error);
+gboolean	e_client_stream_read_record	(GInputStream *stream,
+						 gchar **out_record,
+						 GCancellable *cancellable,
+						 GError **error);
+
 G_END_DECLS
 
 #endif /* E_CLIENT_PRIVATE_H */
@@ -36,9 +36,20 @@
 
 #include "evolution-data-server-config.h"
 
+#include <string.h>
+
 #include <glib/gi18n-lib.h>
 #include <gio/gio.h>
 
+#ifndef G_OS_WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <gio/gunixfdlist.h>
+#include <gio/gunixinputstream.h>
+#endif
+
 #include <libedataserver/e-data-server-util.h>
 
 #include "e-flag.h"
@@ -2462,3 +2473,222 @@ e_client_set_bus_name (EClient *client,
 
 	client->priv->bus_name = g_strdup (bus_name);
 }
+
+/* Streamed results (GetContactListStream, GetObjectListStream)
+ *
+ * Large result sets are not sent in a single D-Bus reply. Instead the
+ * reply carries one end of a socket pair and the backend writes the
+ * results into the other end from a dedicated thread, each record being
+ * terminated by a NUL byte. An empty record marks a successful end of
+ * the stream, thus a reader can tell a complete result from a stream
+ * which had been cut short by the writer.
+ *
+ * File descriptors cannot be passed over D-Bus on Windows, where
+ * the clients read the whole result in one piece, as before. */
+
+#define E_CLIENT_STREAM_BUFFER_SIZE (64 * 1024)
+
+#ifndef G_OS_WIN32
+
+/**
+ * e_client_stream_new_writer: (skip)
+ * @out_fd_list: (out) (transfer full): return location for a #GUnixFDList
+ * @error: return location for a #GError, or %NULL
+ *
+ * Creates a new socket pair, stores the reading end into a new #GUnixFDList
+ * at index 0, which can be passed over D-Bus, and returns a buffered output
+ * stream for the writing end. Use e_client_stream_write_record() to write
+ * into the stream.
+ *
+ * Returns: (transfer full): a new #GOutputStream, or %NULL on error
+ *
+ * Since: 3.28
+ **/
+GOutputStream *
+e_client_stream_new_writer (GUnixFDList **out_fd_list,
+                            GError **error)
+{
+	GSocket *socket;
+	GSocketConnection *connection;
+	GOutputStream *stream;
+	gint fds[2];
+
+	g_return_val_if_fail (out_fd_list != NULL, NULL);
+
+	if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+		gint errn = errno;
+
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errn),
+			_("Failed to create socket pair: %s"),
+			g_strerror (errn));
+		return NULL;
+	}
+
+	fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+	/* The socket is used rather than a pipe, because writes
+	 * to it do not raise SIGPIPE when the reader goes away. */
+	socket = g_socket_new_from_fd (fds[1], error);
+	if (!socket) {
+		close (fds[0]);
+		close (fds[1]);
+		return NULL;
+	}
+
+	*out_fd_list = g_unix_fd_list_new_from_array (fds, 1);
+
+	connection = g_socket_connection_factory_create_connection (socket);
+	stream = g_buffered_output_stream_new_sized (
+		g_io_stream_get_output_stream (G_IO_STREAM (connection)),
+		E_CLIENT_STREAM_BUFFER_SIZE);
+
+	/* The output stream holds a reference on its connection. */
+	g_object_unref (connection);
+	g_object_unref (socket);
+
+	return stream;
+}
+
+#endif /* G_OS_WIN32 */
+
+/**
+ * e_client_stream_write_record: (skip)
+ * @stream: a #GOutputStream returned by e_client_stream_new_writer()
+ * @record: (nullable): a record to write, or %NULL to finish the stream
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes one @record into the @stream. The @record cannot be an empty
+ * string and it should be valid UTF-8. When the @record is %NULL, then
+ * the end-of-stream marker is written and the @stream is flushed.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_client_stream_write_record (GOutputStream *stream,
+                              const gchar *record,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (record == NULL || *record != '\0', FALSE);
+
+	if (record && !g_output_stream_write_all (stream, record, strlen (record), NULL, cancellable, error))
+		return FALSE;
+
+	if (!g_output_stream_write_all (stream, "", 1, NULL, cancellable, error))
+		return FALSE;
+
+	if (!record)
+		return g_output_stream_flush (stream, cancellable, error);
+
+	return TRUE;
+}
+
+#ifndef G_OS_WIN32
+
+/**
+ * e_client_stream_new_reader: (skip)
+ * @fd_list: a #GUnixFDList received over D-Bus
+ * @handle: an index of the stream file descriptor in the @fd_list
+ * @error: return location for a #GError, or %NULL
+ *
+ * Creates an input stream for the file descriptor at @handle in the @fd_list,
+ * as written by e_client_stream_new_writer(). Use e_client_stream_read_record()
+ * to read from it.
+ *
+ * Returns: (transfer full): a new #GInputStream, or %NULL on error
+ *
+ * Since: 3.28
+ **/
+GInputStream *
+e_client_stream_new_reader (GUnixFDList *fd_list,
+                            gint handle,
+                            GError **error)
+{
+	GInputStream *base_stream, *stream;
+	gint fd;
+
+	g_return_val_if_fail (G_IS_UNIX_FD_LIST (fd_list), NULL);
+
+	fd = g_unix_fd_list_get (fd_list, handle, error);
+	if (fd == -1)
+		return NULL;
+
+	base_stream = g_unix_input_stream_new (fd, TRUE);
+	stream = G_INPUT_STREAM (g_data_input_stream_new (base_stream));
+	g_buffered_input_stream_set_buffer_size (G_BUFFERED_INPUT_STREAM (stream), E_CLIENT_STREAM_BUFFER_SIZE);
+	g_object_unref (base_stream);
+
+	return stream;
+}
+
+#endif /* G_OS_WIN32 */
+
+/**
+ * e_client_stream_read_record: (skip)
+ * @stream: a #GInputStream returned by e_client_stream_new_reader()
+ * @out_record: (out) (transfer full): return location for the read record
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Reads one record from the @stream. The @out_record is set to %NULL
+ * when the end-of-stream marker had been read. Free the @out_record
+ * with g_free(), when no longer needed.
+ *
+ * Returns: whether succeeded; a stream closed by the writer
+ *    before the end-of-stream marker is reported as an error
+ *
+ * Since: 3.28
+ **/
+gboolean
+e_client_stream_read_record (GInputStream *stream,
+                             gchar **out_record,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+	GError *local_error = NULL;
+	gchar *record, terminator = 0;
+	gsize length = 0;
+
+	g_return_val_if_fail (G_IS_DATA_INPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (out_record != NULL, FALSE);
+
+	*out_record = NULL;
+
+	record = g_data_input_stream_read_upto (G_DATA_INPUT_STREAM (stream), "", 1, &length, cancellable, &local_error);
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	/* Consume the NUL terminator; it is missing when the writer
+	 * closed the stream without writing the end-of-stream marker */
+	if (!record || g_input_stream_read (stream, &terminator, 1, cancellable, &local_error) != 1) {
+		g_free (record);
+
+		if (local_error) {
+			g_propagate_error (error, local_error);
+		} else {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+				_("Result stream ended unexpectedly"));
+		}
+
+		return FALSE;
+	}
+
+	if (length == 0) {
+		/* The end-of-stream marker */
+		g_free (record);
+		return TRUE;
+	}
+
+	*out_record = record;
+
+	return TRUE;
+}
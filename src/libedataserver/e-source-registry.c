@@ -68,6 +68,7 @@
 #include "e-source-task-list.h"
 
 #include "e-source-registry.h"
+#include "libedataserver-private.h"
 
 #define E_SOURCE_REGISTRY_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
@@ -116,6 +117,12 @@ struct _ESourceRegistryPrivate {
 	GHashTable *sources;
 	GMutex sources_lock;
 
+	/* Extension name -> GPtrArray of ESource, sorted by display name;
+	 * built on demand, updated as the sources come, go and change.
+	 * Guarded by sources_lock. */
+	GHashTable *sources_index;
+	guint sources_index_stamp;
+
 	GSettings *settings;
 
 	gboolean initialized;
@@ -441,6 +448,118 @@ source_registry_service_restart_table_steal_all (ESourceRegistry *registry)
 	return list;
 }
 
+/* The key for the index of all the sources; extension names are never empty */
+#define SOURCES_INDEX_ALL ""
+
+/* Always called with sources_lock held */
+static void
+source_registry_sources_index_insert_sorted (GPtrArray *array,
+                                             ESource *source)
+{
+	guint lo = 0, hi = array->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (e_source_compare_by_display_name (array->pdata[mid], source) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	g_ptr_array_insert (array, lo, g_object_ref (source));
+}
+
+/* Always called with sources_lock held */
+static void
+source_registry_sources_index_update (ESourceRegistry *registry,
+                                      ESource *source,
+                                      gboolean is_registered)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, registry->priv->sources_index);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *extension_name = key;
+		GPtrArray *array = value;
+
+		/* The display name or the extensions could change,
+		 * thus remove it first and then put it where it belongs. */
+		g_ptr_array_remove (array, source);
+
+		if (is_registered && (
+		    g_strcmp0 (extension_name, SOURCES_INDEX_ALL) == 0 ||
+		    e_source_has_extension (source, extension_name)))
+			source_registry_sources_index_insert_sorted (array, source);
+	}
+}
+
+static gint
+source_registry_compare_sources_ptr (gconstpointer ptr1,
+                                     gconstpointer ptr2)
+{
+	ESource *source1 = *((ESource **) ptr1);
+	ESource *source2 = *((ESource **) ptr2);
+
+	return e_source_compare_by_display_name (source1, source2);
+}
+
+/* Always called with sources_lock held */
+static GPtrArray *
+source_registry_sources_index_get (ESourceRegistry *registry,
+                                   const gchar *extension_name)
+{
+	GPtrArray *array;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint stamp;
+
+	if (!extension_name)
+		extension_name = SOURCES_INDEX_ALL;
+
+	/* e_source_get_extension() adds extensions without emitting
+	 * the "changed" signal, thus drop the per-extension arrays,
+	 * which can miss sources with an extension added locally. */
+	stamp = _e_source_get_extensions_stamp ();
+
+	if (stamp != registry->priv->sources_index_stamp) {
+		g_hash_table_iter_init (&iter, registry->priv->sources_index);
+
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (g_strcmp0 (key, SOURCES_INDEX_ALL) != 0)
+				g_hash_table_iter_remove (&iter);
+		}
+
+		registry->priv->sources_index_stamp = stamp;
+	}
+
+	array = g_hash_table_lookup (registry->priv->sources_index, extension_name);
+
+	if (array)
+		return array;
+
+	array = g_ptr_array_new_with_free_func (g_object_unref);
+
+	g_hash_table_iter_init (&iter, registry->priv->sources);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ESource *source = value;
+
+		if (*extension_name && !e_source_has_extension (source, extension_name))
+			continue;
+
+		g_ptr_array_add (array, g_object_ref (source));
+	}
+
+	g_ptr_array_sort (array, source_registry_compare_sources_ptr);
+
+	g_hash_table_insert (registry->priv->sources_index, g_strdup (extension_name), array);
+
+	return array;
+}
+
 static gboolean
 source_registry_sources_remove (ESourceRegistry *registry,
                                 ESource *source)
@@ -453,6 +572,9 @@ source_registry_sources_remove (ESourceRegistry *registry,
 
 	g_mutex_lock (&registry->priv->sources_lock);
 
+	if (g_hash_table_lookup (registry->priv->sources, uid) == source)
+		source_registry_sources_index_update (registry, source, FALSE);
+
 	removed = g_hash_table_remove (registry->priv->sources, uid);
 
 	g_mutex_unlock (&registry->priv->sources_lock);
@@ -480,22 +602,6 @@ source_registry_sources_lookup (ESourceRegistry *registry,
 	return source;
 }
 
-static GList *
-source_registry_sources_get_values (ESourceRegistry *registry)
-{
-	GList *values;
-
-	g_mutex_lock (&registry->priv->sources_lock);
-
-	values = g_hash_table_get_values (registry->priv->sources);
-
-	g_list_foreach (values, (GFunc) g_object_ref, NULL);
-
-	g_mutex_unlock (&registry->priv->sources_lock);
-
-	return values;
-}
-
 static GNode *
 source_registry_sources_build_tree (ESourceRegistry *registry)
 {
@@ -608,6 +714,18 @@ source_registry_source_changed_cb (ESource *source,
 {
 	GSource *idle_source;
 	SourceClosure *closure;
+	const gchar *uid;
+
+	/* Update the index right away, not in the idle callback,
+	 * for the lists to be correct as soon as possible. */
+	uid = e_source_get_uid (source);
+
+	g_mutex_lock (&registry->priv->sources_lock);
+
+	if (uid && g_hash_table_lookup (registry->priv->sources, uid) == source)
+		source_registry_sources_index_update (registry, source, TRUE);
+
+	g_mutex_unlock (&registry->priv->sources_lock);
 
 	closure = g_slice_new0 (SourceClosure);
 	g_weak_ref_init (&closure->registry, registry);
@@ -786,6 +904,8 @@ source_registry_add_source (ESourceRegistry *registry,
 		registry->priv->sources,
 		g_strdup (uid), g_object_ref (source));
 
+	source_registry_sources_index_update (registry, source, TRUE);
+
 	g_mutex_unlock (&registry->priv->sources_lock);
 }
 
@@ -1313,6 +1433,10 @@ source_registry_dispose (GObject *object)
 
 	g_hash_table_remove_all (priv->object_path_table);
 
+	g_mutex_lock (&priv->sources_lock);
+	g_hash_table_remove_all (priv->sources_index);
+	g_mutex_unlock (&priv->sources_lock);
+
 	g_hash_table_remove_all (priv->sources);
 
 	if (priv->main_context != NULL) {
@@ -1346,6 +1470,7 @@ source_registry_finalize (GObject *object)
 	g_hash_table_destroy (priv->service_restart_table);
 	g_mutex_clear (&priv->service_restart_table_lock);
 
+	g_hash_table_destroy (priv->sources_index);
 	g_hash_table_destroy (priv->sources);
 	g_mutex_clear (&priv->sources_lock);
 
@@ -1728,6 +1853,13 @@ e_source_registry_init (ESourceRegistry *registry)
 		(GDestroyNotify) g_free,
 		(GDestroyNotify) source_registry_unref_source);
 
+	/* Extension name -> GPtrArray of ESource */
+	registry->priv->sources_index = g_hash_table_new_full (
+		(GHashFunc) g_str_hash,
+		(GEqualFunc) g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) g_ptr_array_unref);
+
 	g_mutex_init (&registry->priv->sources_lock);
 
 	registry->priv->settings = g_settings_new (GSETTINGS_SCHEMA);
@@ -2362,30 +2494,22 @@ GList *
 e_source_registry_list_sources (ESourceRegistry *registry,
                                 const gchar *extension_name)
 {
-	GList *list, *link;
-	GQueue trash = G_QUEUE_INIT;
+	GPtrArray *array;
+	GList *list = NULL;
+	guint ii;
 
 	g_return_val_if_fail (E_IS_SOURCE_REGISTRY (registry), NULL);
 
-	list = g_list_sort (
-		source_registry_sources_get_values (registry),
-		(GCompareFunc) e_source_compare_by_display_name);
-
-	if (extension_name == NULL)
-		return list;
+	g_mutex_lock (&registry->priv->sources_lock);
 
-	for (link = list; link != NULL; link = g_list_next (link)) {
-		ESource *source = E_SOURCE (link->data);
+	/* The index is already filtered and sorted. */
+	array = source_registry_sources_index_get (registry, extension_name);
 
-		if (!e_source_has_extension (source, extension_name)) {
-			g_queue_push_tail (&trash, link);
-			g_object_unref (source);
-		}
+	for (ii = array->len; ii > 0; ii--) {
+		list = g_list_prepend (list, g_object_ref (array->pdata[ii - 1]));
 	}
 
-	/* We do want pop_head() here, not pop_head_link(). */
-	while ((link = g_queue_pop_head (&trash)) != NULL)
-		list = g_list_delete_link (list, link);
+	g_mutex_unlock (&registry->priv->sources_lock);
 
 	return list;
 }
@@ -78,6 +78,7 @@
 #include "e-source-enumtypes.h"
 #include "e-source-extension.h"
 #include "e-uid.h"
+#include "libedataserver-private.h"
 
 /* built-in extension types */
 #include "e-source-address-book.h"
@@ -192,6 +193,9 @@ enum {
 
 static guint signals[LAST_SIGNAL];
 
+/* Incremented whenever any ESource gets a new extension */
+static volatile gint extensions_stamp = 0;
+
 /* Forward Declarations */
 static void	e_source_initable_init	(GInitableIface *iface);
 static void	e_source_proxy_resolver_init
@@ -3022,6 +3026,8 @@ e_source_get_extension (ESource *source,
 		g_mutex_lock (&source->priv->changed_lock);
 		source->priv->ignore_changed_signal--;
 		g_mutex_unlock (&source->priv->changed_lock);
+
+		g_atomic_int_inc (&extensions_stamp);
 	} else {
 		/* XXX Tie this into a debug setting for ESources. */
 #ifdef DEBUG
@@ -3039,6 +3045,14 @@ exit:
 	return extension;
 }
 
+/* No ESource::changed is emitted when e_source_get_extension() adds
+ * an extension, thus this lets ESourceRegistry notice such additions. */
+guint
+_e_source_get_extensions_stamp (void)
+{
+	return (guint) g_atomic_int_get (&extensions_stamp);
+}
+
 /**
  * e_source_has_extension:
  * @source: an #ESource
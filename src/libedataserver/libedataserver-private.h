@@ -21,6 +21,8 @@
 #ifndef LIBEDATASERVER_PRIVATE_H
 #define LIBEDATASERVER_PRIVATE_H
 
+guint		_e_source_get_extensions_stamp		(void);
+
 #ifdef G_OS_WIN32
 
 const gchar *	_libedataserver_get_imagesdir		(void) G_GNUC_CONST;
@@ -585,6 +585,132 @@ test_construction_vcard_attribute_with_group (void)
 	e_vcard_attribute_free (attr1);
 }
 
+static void
+test_vcard_get_attribute_index (void)
+{
+	EVCard *vcard;
+	EVCardAttribute *attr, *tel1, *tel2;
+
+	vcard = e_vcard_new_from_string (
+		"BEGIN:VCARD\r\n"
+		"VERSION:3.0\r\n"
+		"FN:Fn\r\n"
+		"tel;TYPE=HOME:111\r\n"
+		"item1.TEL;TYPE=WORK:222\r\n"
+		"X-Ünknown:value\r\n"
+		"END:VCARD\r\n");
+
+	tel1 = e_vcard_get_attribute (vcard, "TEL");
+	g_assert_nonnull (tel1);
+	g_assert_cmpstr (e_vcard_attribute_get_name (tel1), ==, "tel");
+	g_assert_cmpstr (e_vcard_attribute_get_value (tel1), ==, "111");
+	g_assert (e_vcard_get_attribute (vcard, "tel") == tel1);
+	g_assert (e_vcard_get_attribute_if_parsed (vcard, "Tel") == tel1);
+
+	tel2 = g_list_nth_data (e_vcard_get_attributes (vcard), 3);
+	g_assert_nonnull (tel2);
+	g_assert_cmpstr (e_vcard_attribute_get_group (tel2), ==, "item1");
+	g_assert_cmpstr (e_vcard_attribute_get_name (tel2), ==, "TEL");
+
+	g_assert_nonnull (e_vcard_get_attribute (vcard, "X-Ünknown"));
+	g_assert_null (e_vcard_get_attribute (vcard, "EMAIL"));
+
+	/* Prepended attribute is the first one */
+	attr = e_vcard_attribute_new (NULL, EVC_TEL);
+	e_vcard_add_attribute_with_value (vcard, attr, "333");
+	g_assert (e_vcard_get_attribute (vcard, EVC_TEL) == attr);
+
+	/* Appended attribute is not */
+	attr = e_vcard_attribute_new (NULL, EVC_EMAIL);
+	e_vcard_append_attribute_with_value (vcard, e_vcard_attribute_new (NULL, EVC_TEL), "444");
+	e_vcard_append_attribute_with_value (vcard, attr, "a@b.c");
+	g_assert_cmpstr (e_vcard_attribute_get_value (e_vcard_get_attribute (vcard, EVC_TEL)), ==, "333");
+	g_assert (e_vcard_get_attribute (vcard, EVC_EMAIL) == attr);
+
+	e_vcard_remove_attribute (vcard, e_vcard_get_attribute (vcard, EVC_TEL));
+	g_assert (e_vcard_get_attribute (vcard, EVC_TEL) == tel1);
+
+	e_vcard_remove_attributes (vcard, NULL, EVC_TEL);
+	g_assert_null (e_vcard_get_attribute (vcard, EVC_TEL));
+	g_assert (e_vcard_get_attribute (vcard, EVC_EMAIL) == attr);
+
+	g_object_unref (vcard);
+}
+
+#define PERF_N_VCARDS 2000
+#define PERF_N_ROUNDS 5
+
+static void
+test_vcard_perf_parse_lookup (void)
+{
+	const gchar *lookup_names[] = { EVC_UID, EVC_FN, EVC_N, EVC_EMAIL, EVC_TEL, EVC_ADR, EVC_ORG, EVC_NOTE, EVC_X_FILE_AS, "X-NONEXISTENT" };
+	GPtrArray *corpus;
+	GTimer *timer;
+	gdouble parse_secs = 0.0, lookup_secs = 0.0;
+	guint ii, jj, round, n_found = 0;
+
+	if (!g_test_perf ())
+		return;
+
+	corpus = g_ptr_array_new_with_free_func (g_free);
+
+	for (ii = 0; ii < PERF_N_VCARDS; ii++) {
+		g_ptr_array_add (corpus, g_strdup_printf (
+			"BEGIN:VCARD\r\n"
+			"VERSION:3.0\r\n"
+			"UID:perf-%u\r\n"
+			"REV:2017-01-12T11:34:36Z\r\n"
+			"FN:First%u Last%u\r\n"
+			"N:Last%u;First%u;Middle;Mr.;Jr.\r\n"
+			"X-EVOLUTION-FILE-AS:Last%u\\, First%u\r\n"
+			"EMAIL;TYPE=WORK:first%u.last@work.example.com\r\n"
+			"EMAIL;TYPE=HOME:first%u@home.example.com\r\n"
+			"TEL;TYPE=WORK,VOICE;X-EVOLUTION-E164=%u:+1 555 %07u\r\n"
+			"TEL;TYPE=CELL:+1 555 %07u\r\n"
+			"ADR;TYPE=WORK:;;%u Main Street;Springfield;ST;12345;Country\r\n"
+			"ORG:Company %u;Department\r\n"
+			"TITLE:Engineer\r\n"
+			"item1.URL:http://www.example.com/~%u\r\n"
+			"NOTE:A note which is long enough to be folded into the next line by\r\n"
+			"  the writer\\, with an escaped comma\r\n"
+			"END:VCARD\r\n",
+			ii, ii, ii, ii, ii, ii, ii, ii, ii, ii, ii, ii, ii, ii, ii));
+	}
+
+	timer = g_timer_new ();
+
+	for (round = 0; round < PERF_N_ROUNDS; round++) {
+		for (ii = 0; ii < corpus->len; ii++) {
+			EVCard *vcard;
+
+			g_timer_start (timer);
+			vcard = e_vcard_new_from_string (corpus->pdata[ii]);
+			g_assert_cmpint (g_list_length (e_vcard_get_attributes (vcard)), ==, 15);
+			g_timer_stop (timer);
+			parse_secs += g_timer_elapsed (timer, NULL);
+
+			g_timer_start (timer);
+			for (jj = 0; jj < G_N_ELEMENTS (lookup_names); jj++) {
+				if (e_vcard_get_attribute (vcard, lookup_names[jj]))
+					n_found++;
+			}
+			g_timer_stop (timer);
+			lookup_secs += g_timer_elapsed (timer, NULL);
+
+			g_object_unref (vcard);
+		}
+	}
+
+	g_assert_cmpuint (n_found, ==, PERF_N_ROUNDS * PERF_N_VCARDS * (G_N_ELEMENTS (lookup_names) - 1));
+
+	g_test_minimized_result (parse_secs, "Parsed %d vCards in %.3f seconds", PERF_N_ROUNDS * PERF_N_VCARDS, parse_secs);
+	g_test_minimized_result (lookup_secs, "Did %d attribute lookups in %.3f seconds",
+		(gint) (PERF_N_ROUNDS * PERF_N_VCARDS * G_N_ELEMENTS (lookup_names)), lookup_secs);
+
+	g_timer_destroy (timer);
+	g_ptr_array_unref (corpus);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -600,6 +726,8 @@ main (gint argc,
 	g_test_add_func ("/Parsing/Contact/EmptyValue", test_contact_empty_value);
 	g_test_add_func ("/Construction/VCardAttribute/WithGroup",
 	                 test_construction_vcard_attribute_with_group);
+	g_test_add_func ("/Parsing/VCard/GetAttributeIndex", test_vcard_get_attribute_index);
+	g_test_add_func ("/Performance/VCard/ParseLookup", test_vcard_perf_parse_lookup);
 
 	return g_test_run ();
 }
@@ -0,0 +1,214 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <libebook/libebook.h>
+
+#include "client-test-utils.h"
+#include "e-test-server-utils.h"
+
+#define N_CONTACTS 10
+#define CHUNK_SIZE 3
+
+static ETestServerClosure book_closure_sync = { E_TEST_SERVER_ADDRESS_BOOK, NULL, 0, FALSE, NULL, FALSE };
+static ETestServerClosure book_closure_async = { E_TEST_SERVER_ADDRESS_BOOK, NULL, 0, FALSE, NULL, TRUE };
+static ETestServerClosure book_closure_direct_sync = { E_TEST_SERVER_DIRECT_ADDRESS_BOOK, NULL, 0, FALSE, NULL, FALSE };
+static ETestServerClosure book_closure_direct_async = { E_TEST_SERVER_DIRECT_ADDRESS_BOOK, NULL, 0, FALSE, NULL, TRUE };
+
+typedef struct {
+	GMainLoop *loop;
+	EBookClientContactIter *iter;
+	guint n_read;
+} IterData;
+
+static gchar *
+setup_book (EBookClient *book_client)
+{
+	EBookQuery *query;
+	gchar *sexp;
+	gint ii;
+
+	for (ii = 1; ii <= N_CONTACTS; ii++) {
+		EContact *contact = NULL;
+		gchar *case_name;
+
+		case_name = g_strdup_printf ("custom-%d", ii);
+
+		if (!add_contact_from_test_case_verify (book_client, case_name, &contact))
+			g_error ("Failed to add contact '%s'", case_name);
+
+		g_object_unref (contact);
+		g_free (case_name);
+	}
+
+	query = e_book_query_any_field_contains ("");
+	sexp = e_book_query_to_string (query);
+	e_book_query_unref (query);
+
+	return sexp;
+}
+
+static void
+test_get_contacts_iter_sync (ETestServerFixture *fixture,
+                             gconstpointer user_data)
+{
+	EBookClient *book_client;
+	EBookClientContactIter *iter = NULL;
+	GHashTable *uids;
+	GSList *contacts, *link;
+	guint n_read = 0;
+	gchar *sexp;
+	GError *error = NULL;
+
+	book_client = E_TEST_SERVER_UTILS_SERVICE (fixture, EBookClient);
+
+	sexp = setup_book (book_client);
+	uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (!e_book_client_get_contacts_iter_sync (book_client, sexp, &iter, NULL, &error))
+		g_error ("get contacts iter: %s", error->message);
+
+	g_assert (iter != NULL);
+
+	do {
+		contacts = NULL;
+
+		if (!e_book_client_contact_iter_next_sync (iter, CHUNK_SIZE, &contacts, NULL, &error))
+			g_error ("contact iter next: %s", error->message);
+
+		g_assert_cmpint (g_slist_length (contacts), <=, CHUNK_SIZE);
+		n_read += g_slist_length (contacts);
+
+		/* each contact is read exactly once */
+		for (link = contacts; link; link = g_slist_next (link)) {
+			const gchar *uid = e_contact_get_const (link->data, E_CONTACT_UID);
+
+			g_assert (uid != NULL);
+			g_assert (!g_hash_table_contains (uids, uid));
+			g_hash_table_add (uids, g_strdup (uid));
+		}
+
+		e_client_util_free_object_slist (contacts);
+	} while (contacts);
+
+	g_assert_cmpint (n_read, ==, N_CONTACTS);
+
+	e_book_client_contact_iter_free (iter);
+	g_hash_table_destroy (uids);
+	g_free (sexp);
+}
+
+static void
+contacts_iter_next_cb (GObject *source_object,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+	IterData *data = user_data;
+	GSList *contacts = NULL;
+	GError *error = NULL;
+
+	if (!e_book_client_contact_iter_next_finish (data->iter, result, &contacts, &error))
+		g_error ("contact iter next finish: %s", error->message);
+
+	if (!contacts) {
+		g_main_loop_quit (data->loop);
+		return;
+	}
+
+	g_assert_cmpint (g_slist_length (contacts), <=, CHUNK_SIZE);
+	data->n_read += g_slist_length (contacts);
+
+	e_client_util_free_object_slist (contacts);
+
+	e_book_client_contact_iter_next (data->iter, CHUNK_SIZE, NULL, contacts_iter_next_cb, data);
+}
+
+static void
+contacts_iter_ready_cb (GObject *source_object,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+	IterData *data = user_data;
+	GError *error = NULL;
+
+	if (!e_book_client_get_contacts_iter_finish (E_BOOK_CLIENT (source_object), result, &data->iter, &error))
+		g_error ("get contacts iter finish: %s", error->message);
+
+	e_book_client_contact_iter_next (data->iter, CHUNK_SIZE, NULL, contacts_iter_next_cb, data);
+}
+
+static void
+test_get_contacts_iter_async (ETestServerFixture *fixture,
+                              gconstpointer user_data)
+{
+	EBookClient *book_client;
+	IterData data = { NULL, NULL, 0 };
+	gchar *sexp;
+
+	book_client = E_TEST_SERVER_UTILS_SERVICE (fixture, EBookClient);
+
+	sexp = setup_book (book_client);
+
+	data.loop = fixture->loop;
+
+	e_book_client_get_contacts_iter (book_client, sexp, NULL, contacts_iter_ready_cb, &data);
+
+	g_main_loop_run (fixture->loop);
+
+	g_assert_cmpint (data.n_read, ==, N_CONTACTS);
+
+	e_book_client_contact_iter_free (data.iter);
+	g_free (sexp);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("http://bugzilla.gnome.org/");
+
+	g_test_add (
+		"/EBookClient/GetContactsIter/Sync",
+		ETestServerFixture,
+		&book_closure_sync,
+		e_test_server_utils_setup,
+		test_get_contacts_iter_sync,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/EBookClient/GetContactsIter/Async",
+		ETestServerFixture,
+		&book_closure_async,
+		e_test_server_utils_setup,
+		test_get_contacts_iter_async,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/EBookClient/DirectAccess/GetContactsIter/Sync",
+		ETestServerFixture,
+		&book_closure_direct_sync,
+		e_test_server_utils_setup,
+		test_get_contacts_iter_sync,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/EBookClient/DirectAccess/GetContactsIter/Async",
+		ETestServerFixture,
+		&book_closure_direct_async,
+		e_test_server_utils_setup,
+		test_get_contacts_iter_async,
+		e_test_server_utils_teardown);
+
+	return e_test_server_utils_run ();
+}
@@ -0,0 +1,271 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <libecal/libecal.h>
+#include <libical/ical.h>
+
+#include "e-test-server-utils.h"
+
+/* The tests run in order, each on the files left by the previous one */
+#define CALENDAR_UID "changelog-calendar"
+
+static ETestServerClosure cal_closure =
+	{ E_TEST_SERVER_CALENDAR, NULL, E_CAL_CLIENT_SOURCE_TYPE_EVENTS, TRUE, NULL, FALSE };
+
+static gchar *
+dup_calendar_path (const gchar *basename)
+{
+	return g_build_filename (e_get_user_data_dir (), "calendar", CALENDAR_UID, basename, NULL);
+}
+
+static gboolean
+file_contains (const gchar *filename,
+               const gchar *text)
+{
+	gchar *contents = NULL;
+	gboolean found;
+
+	if (!g_file_get_contents (filename, &contents, NULL, NULL))
+		return FALSE;
+
+	found = strstr (contents, text) != NULL;
+
+	g_free (contents);
+
+	return found;
+}
+
+/* The backend saves in an idle callback and writes in its own thread */
+static void
+wait_for_text (const gchar *filename,
+               const gchar *text)
+{
+	gint64 deadline;
+
+	deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+
+	while (!file_contains (filename, text) && g_get_monotonic_time () < deadline)
+		g_usleep (G_USEC_PER_SEC / 20);
+
+	g_assert (file_contains (filename, text));
+}
+
+static void
+create_event (ECalClient *cal_client,
+              const gchar *uid,
+              const gchar *summary)
+{
+	struct icaltimetype now;
+	icalcomponent *icalcomp;
+	GError *error = NULL;
+
+	now = icaltime_current_time_with_zone (icaltimezone_get_utc_timezone ());
+	icalcomp = icalcomponent_new (ICAL_VEVENT_COMPONENT);
+	icalcomponent_set_uid (icalcomp, uid);
+	icalcomponent_set_summary (icalcomp, summary);
+	icalcomponent_set_dtstart (icalcomp, now);
+	icalcomponent_set_dtend (icalcomp, icaltime_from_timet_with_zone (icaltime_as_timet (now) + 60 * 60, 0, NULL));
+
+	if (!e_cal_client_create_object_sync (cal_client, icalcomp, NULL, NULL, &error))
+		g_error ("create object sync: %s", error->message);
+
+	icalcomponent_free (icalcomp);
+}
+
+static void
+modify_event (ECalClient *cal_client,
+              const gchar *uid,
+              const gchar *summary)
+{
+	icalcomponent *icalcomp = NULL;
+	GError *error = NULL;
+
+	if (!e_cal_client_get_object_sync (cal_client, uid, NULL, &icalcomp, NULL, &error))
+		g_error ("get object sync: %s", error->message);
+
+	icalcomponent_set_summary (icalcomp, summary);
+
+	if (!e_cal_client_modify_object_sync (cal_client, icalcomp, E_CAL_OBJ_MOD_ALL, NULL, &error))
+		g_error ("modify object sync: %s", error->message);
+
+	icalcomponent_free (icalcomp);
+}
+
+static void
+check_events (ECalClient *cal_client)
+{
+	GSList *icalcomps = NULL, *link;
+	gboolean found_a = FALSE, found_b = FALSE;
+	GError *error = NULL;
+
+	if (!e_cal_client_get_object_list_sync (cal_client, "#t", &icalcomps, NULL, &error))
+		g_error ("get object list sync: %s", error->message);
+
+	g_assert_cmpint (g_slist_length (icalcomps), ==, 2);
+
+	for (link = icalcomps; link; link = g_slist_next (link)) {
+		const gchar *uid = icalcomponent_get_uid (link->data);
+
+		if (g_strcmp0 (uid, "changelog-a") == 0) {
+			g_assert_cmpstr (icalcomponent_get_summary (link->data), ==, "Modified");
+			found_a = TRUE;
+		} else if (g_strcmp0 (uid, "changelog-b") == 0) {
+			g_assert_cmpstr (icalcomponent_get_summary (link->data), ==, "Final");
+			found_b = TRUE;
+		}
+	}
+
+	g_assert (found_a);
+	g_assert (found_b);
+
+	e_cal_client_free_icalcomp_slist (icalcomps);
+}
+
+static void
+changelog_setup (ETestServerFixture *fixture,
+                 gconstpointer user_data)
+{
+	fixture->source_name = g_strdup (CALENDAR_UID);
+	e_test_server_utils_setup (fixture, user_data);
+}
+
+static void
+test_changelog_append (ETestServerFixture *fixture,
+                       gconstpointer user_data)
+{
+	ECalClient *cal_client;
+	gchar *calendar_path, *changelog_path;
+	GError *error = NULL;
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+	calendar_path = dup_calendar_path ("calendar.ics");
+	changelog_path = dup_calendar_path ("calendar.ics.changes");
+
+	/* a new calendar is saved as a whole first... */
+	wait_for_text (calendar_path, "X-EVOLUTION-DATA-REVISION");
+
+	create_event (cal_client, "changelog-a", "First");
+	create_event (cal_client, "changelog-b", "Second");
+	create_event (cal_client, "changelog-c", "Third");
+
+	modify_event (cal_client, "changelog-a", "Modified");
+
+	if (!e_cal_client_remove_object_sync (cal_client, "changelog-c", NULL, E_CAL_OBJ_MOD_ALL, NULL, &error))
+		g_error ("remove object sync: %s", error->message);
+
+	modify_event (cal_client, "changelog-b", "Final");
+
+	/* ...then the changes are appended, in order */
+	wait_for_text (changelog_path, "SUMMARY:Final");
+	g_assert (!file_contains (calendar_path, "UID:changelog-a"));
+
+	check_events (cal_client);
+
+	g_free (calendar_path);
+	g_free (changelog_path);
+}
+
+static void
+test_changelog_reopen (ETestServerFixture *fixture,
+                       gconstpointer user_data)
+{
+	ECalClient *cal_client;
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+
+	/* the change log is replayed onto the calendar file */
+	check_events (cal_client);
+}
+
+static void
+torn_tail_setup (ETestServerFixture *fixture,
+                 gconstpointer user_data)
+{
+	const gchar *torn_record = "9999 0123456789abcdef0123456789abcdef\nBEGIN:VCALENDAR\r\n";
+	gchar *changelog_path, *contents = NULL, *torn;
+	gsize length = 0;
+
+	/* as left by a crash in the middle of a write */
+	changelog_path = dup_calendar_path ("calendar.ics.changes");
+
+	if (!g_file_get_contents (changelog_path, &contents, &length, NULL))
+		g_error ("Failed to read '%s'", changelog_path);
+
+	g_assert (length > 0);
+
+	torn = g_strconcat (contents, torn_record, NULL);
+
+	if (!g_file_set_contents (changelog_path, torn, -1, NULL))
+		g_error ("Failed to write '%s'", changelog_path);
+
+	g_free (torn);
+	g_free (contents);
+	g_free (changelog_path);
+
+	changelog_setup (fixture, user_data);
+}
+
+static void
+test_changelog_torn_tail (ETestServerFixture *fixture,
+                          gconstpointer user_data)
+{
+	ECalClient *cal_client;
+	gchar *changelog_path;
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+	changelog_path = dup_calendar_path ("calendar.ics.changes");
+
+	/* the complete records are kept, the torn one is cut off */
+	check_events (cal_client);
+	g_assert (!file_contains (changelog_path, "9999 0123456789abcdef"));
+	g_assert (file_contains (changelog_path, "SUMMARY:Final"));
+
+	g_free (changelog_path);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("http://bugzilla.gnome.org/");
+
+	g_test_add (
+		"/ECalClient/ChangeLog/Append",
+		ETestServerFixture,
+		&cal_closure,
+		changelog_setup,
+		test_changelog_append,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/ECalClient/ChangeLog/Reopen",
+		ETestServerFixture,
+		&cal_closure,
+		changelog_setup,
+		test_changelog_reopen,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/ECalClient/ChangeLog/TornTail",
+		ETestServerFixture,
+		&cal_closure,
+		torn_tail_setup,
+		test_changelog_torn_tail,
+		e_test_server_utils_teardown);
+
+	return e_test_server_utils_run ();
+}
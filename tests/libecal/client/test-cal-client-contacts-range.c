@@ -0,0 +1,222 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <libecal/libecal.h>
+#include <libical/ical.h>
+
+#include "e-test-server-utils.h"
+
+#define ALL_QUERY "#t"
+#define RANGE_QUERY \
+	"(occur-in-time-range? " \
+	"(make-time \"20300310T000000Z\") " \
+	"(make-time \"20300320T000000Z\"))"
+
+static void
+include_me_customize (ESource *scratch,
+                      ETestServerClosure *closure)
+{
+	ESourceContacts *extension;
+
+	extension = e_source_get_extension (scratch, E_SOURCE_EXTENSION_CONTACTS_BACKEND);
+	e_source_contacts_set_include_me (extension, TRUE);
+}
+
+static ETestServerClosure book_closure =
+	{ E_TEST_SERVER_ADDRESS_BOOK, include_me_customize, 0, FALSE, NULL, FALSE };
+
+static void
+add_contact_with_birthday (EBookClient *book_client,
+                           const gchar *uid,
+                           const gchar *name,
+                           guint month,
+                           guint day)
+{
+	EContact *contact;
+	EContactDate *date;
+	GError *error = NULL;
+
+	contact = e_contact_new ();
+	e_contact_set (contact, E_CONTACT_UID, uid);
+	e_contact_set (contact, E_CONTACT_FULL_NAME, name);
+
+	date = e_contact_date_new ();
+	date->year = 1980;
+	date->month = month;
+	date->day = day;
+	e_contact_set (contact, E_CONTACT_BIRTH_DATE, date);
+	e_contact_date_free (date);
+
+	if (!e_book_client_add_contact_sync (book_client, contact, NULL, NULL, &error))
+		g_error ("add contact sync: %s", error->message);
+
+	g_object_unref (contact);
+}
+
+static ECalClient *
+open_contacts_calendar (ETestServerFixture *fixture)
+{
+	ESource *scratch, *source = NULL;
+	ESourceBackend *backend;
+	EClient *client;
+	gint64 deadline;
+	GError *error = NULL;
+
+	scratch = e_source_new (NULL, NULL, &error);
+	if (!scratch)
+		g_error ("new source: %s", error->message);
+
+	backend = e_source_get_extension (scratch, E_SOURCE_EXTENSION_CALENDAR);
+	e_source_backend_set_backend_name (backend, "contacts");
+
+	if (!e_source_registry_commit_source_sync (fixture->registry, scratch, NULL, &error))
+		g_error ("commit source sync: %s", error->message);
+
+	deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+	while (!source && g_get_monotonic_time () < deadline) {
+		g_main_context_iteration (NULL, FALSE);
+		source = e_source_registry_ref_source (fixture->registry, e_source_get_uid (scratch));
+	}
+
+	g_assert (source != NULL);
+	g_object_unref (scratch);
+
+	client = e_cal_client_connect_sync (source, E_CAL_CLIENT_SOURCE_TYPE_EVENTS, 30, NULL, &error);
+	if (!client)
+		g_error ("connect sync: %s", error->message);
+
+	g_object_unref (source);
+
+	return E_CAL_CLIENT (client);
+}
+
+/* The contacts are picked up from a book view, asynchronously */
+static void
+wait_for_objects (ECalClient *cal_client,
+                  guint expected)
+{
+	gint64 deadline;
+	guint count = 0;
+
+	deadline = g_get_monotonic_time () + 20 * G_USEC_PER_SEC;
+
+	while (count != expected && g_get_monotonic_time () < deadline) {
+		GSList *icalcomps = NULL;
+		GError *error = NULL;
+
+		g_usleep (G_USEC_PER_SEC / 10);
+
+		if (!e_cal_client_get_object_list_sync (cal_client, ALL_QUERY, &icalcomps, NULL, &error))
+			g_error ("get object list sync: %s", error->message);
+
+		count = g_slist_length (icalcomps);
+		e_cal_client_free_icalcomp_slist (icalcomps);
+	}
+
+	g_assert_cmpint (count, ==, expected);
+}
+
+static void
+test_result (GSList *icalcomps)
+{
+	g_assert_cmpint (g_slist_length (icalcomps), ==, 1);
+	g_assert_cmpstr (icalcomponent_get_uid (icalcomps->data), ==, "alice-birthday");
+}
+
+static void
+objects_added_cb (ECalClientView *view,
+                  const GSList *objects,
+                  gpointer user_data)
+{
+	GSList **picomps = user_data;
+	const GSList *link;
+
+	for (link = objects; link; link = g_slist_next (link))
+		*picomps = g_slist_prepend (*picomps, icalcomponent_new_clone (link->data));
+}
+
+static void
+complete_cb (ECalClientView *view,
+             const GError *error,
+             gpointer user_data)
+{
+	g_main_loop_quit (user_data);
+}
+
+static void
+test_contacts_range (ETestServerFixture *fixture,
+                     gconstpointer user_data)
+{
+	EBookClient *book_client;
+	ECalClient *cal_client;
+	ECalClientView *view = NULL;
+	GSList *icalcomps = NULL;
+	GError *error = NULL;
+
+	book_client = E_TEST_SERVER_UTILS_SERVICE (fixture, EBookClient);
+
+	add_contact_with_birthday (book_client, "alice", "Alice", 3, 15);
+	add_contact_with_birthday (book_client, "bob", "Bob", 9, 20);
+
+	cal_client = open_contacts_calendar (fixture);
+	wait_for_objects (cal_client, 2);
+
+	/* get_object_list with a time range skips the other days */
+	if (!e_cal_client_get_object_list_sync (cal_client, RANGE_QUERY, &icalcomps, NULL, &error))
+		g_error ("get object list sync: %s", error->message);
+
+	test_result (icalcomps);
+	e_cal_client_free_icalcomp_slist (icalcomps);
+	icalcomps = NULL;
+
+	/* the same for the initial notifications of a view */
+	if (!e_cal_client_get_view_sync (cal_client, RANGE_QUERY, &view, NULL, &error))
+		g_error ("get view sync: %s", error->message);
+
+	g_signal_connect (view, "objects-added", G_CALLBACK (objects_added_cb), &icalcomps);
+	g_signal_connect (view, "complete", G_CALLBACK (complete_cb), fixture->loop);
+
+	e_cal_client_view_start (view, &error);
+	if (error)
+		g_error ("view start: %s", error->message);
+
+	g_main_loop_run (fixture->loop);
+
+	test_result (icalcomps);
+	g_slist_free_full (icalcomps, (GDestroyNotify) icalcomponent_free);
+
+	g_object_unref (view);
+	g_object_unref (cal_client);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("http://bugzilla.gnome.org/");
+
+	g_test_add (
+		"/ECalClient/ContactsRange",
+		ETestServerFixture,
+		&book_closure,
+		e_test_server_utils_setup,
+		test_contacts_range,
+		e_test_server_utils_teardown);
+
+	return e_test_server_utils_run ();
+}
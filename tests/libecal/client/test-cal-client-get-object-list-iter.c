@@ -0,0 +1,295 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <libecal/libecal.h>
+#include <libical/ical.h>
+
+#include "e-test-server-utils.h"
+
+/* Enough data to not fit into the socket buffers, thus the backend
+ * writes the result while the client is reading it already */
+#define N_EVENTS 200
+#define DESCRIPTION_LENGTH 4096
+#define CHUNK_SIZE 7
+
+#define EVENT_SUMMARY "Iterated event"
+#define EVENT_QUERY "(contains? \"summary\" \"" EVENT_SUMMARY "\")"
+
+static ETestServerClosure cal_closure_sync =
+	{ E_TEST_SERVER_CALENDAR, NULL, E_CAL_CLIENT_SOURCE_TYPE_EVENTS, FALSE, NULL, FALSE };
+static ETestServerClosure cal_closure_async =
+	{ E_TEST_SERVER_CALENDAR, NULL, E_CAL_CLIENT_SOURCE_TYPE_EVENTS, FALSE, NULL, TRUE };
+
+typedef struct {
+	GMainLoop *loop;
+	ECalClientObjectIter *iter;
+	GHashTable *uids;
+} IterData;
+
+static void
+setup_cal (ECalClient *cal_client)
+{
+	struct icaltimetype now;
+	GSList *icalcomps = NULL, *uids = NULL;
+	gchar *description;
+	gint ii;
+	GError *error = NULL;
+
+	now = icaltime_current_time_with_zone (icaltimezone_get_utc_timezone ());
+	description = g_strnfill (DESCRIPTION_LENGTH, 'x');
+
+	for (ii = 0; ii < N_EVENTS; ii++) {
+		icalcomponent *icalcomp;
+		gchar *uid;
+
+		uid = g_strdup_printf ("iter-event-%d", ii);
+
+		icalcomp = icalcomponent_new (ICAL_VEVENT_COMPONENT);
+		icalcomponent_set_uid (icalcomp, uid);
+		icalcomponent_set_summary (icalcomp, EVENT_SUMMARY);
+		icalcomponent_set_description (icalcomp, description);
+		icalcomponent_set_dtstart (icalcomp, now);
+		icalcomponent_set_dtend (icalcomp, icaltime_from_timet_with_zone (icaltime_as_timet (now) + 60 * 60, 0, NULL));
+
+		icalcomps = g_slist_prepend (icalcomps, icalcomp);
+
+		g_free (uid);
+	}
+
+	/* one more, which does not match the query */
+	icalcomps = g_slist_prepend (icalcomps, icalcomponent_new_clone (icalcomps->data));
+	icalcomponent_set_uid (icalcomps->data, "iter-other-event");
+	icalcomponent_set_summary (icalcomps->data, "Other event");
+
+	if (!e_cal_client_create_objects_sync (cal_client, icalcomps, &uids, NULL, &error))
+		g_error ("create objects sync: %s", error->message);
+
+	g_slist_free_full (icalcomps, (GDestroyNotify) icalcomponent_free);
+	g_slist_free_full (uids, g_free);
+	g_free (description);
+}
+
+static void
+add_icalcomps (GHashTable *uids,
+               GSList *icalcomps)
+{
+	GSList *link;
+
+	g_assert_cmpint (g_slist_length (icalcomps), <=, CHUNK_SIZE);
+
+	for (link = icalcomps; link; link = g_slist_next (link)) {
+		icalcomponent *icalcomp = link->data;
+		const gchar *description;
+
+		g_assert_cmpstr (icalcomponent_get_summary (icalcomp), ==, EVENT_SUMMARY);
+
+		description = icalcomponent_get_description (icalcomp);
+		g_assert (description != NULL);
+		g_assert_cmpint (strlen (description), ==, DESCRIPTION_LENGTH);
+
+		/* each object is read exactly once */
+		g_assert (!g_hash_table_contains (uids, icalcomponent_get_uid (icalcomp)));
+		g_hash_table_add (uids, g_strdup (icalcomponent_get_uid (icalcomp)));
+	}
+}
+
+static void
+test_result (GHashTable *uids)
+{
+	gint ii;
+
+	g_assert_cmpint (g_hash_table_size (uids), ==, N_EVENTS);
+
+	for (ii = 0; ii < N_EVENTS; ii++) {
+		gchar *uid;
+
+		uid = g_strdup_printf ("iter-event-%d", ii);
+		g_assert (g_hash_table_contains (uids, uid));
+		g_free (uid);
+	}
+}
+
+static void
+test_get_object_list_iter_sync (ETestServerFixture *fixture,
+                                gconstpointer user_data)
+{
+	ECalClient *cal_client;
+	ECalClientObjectIter *iter = NULL;
+	GHashTable *uids;
+	GSList *icalcomps;
+	GError *error = NULL;
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+	setup_cal (cal_client);
+
+	uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (!e_cal_client_get_object_list_iter_sync (cal_client, EVENT_QUERY, &iter, NULL, &error))
+		g_error ("get object list iter sync: %s", error->message);
+
+	g_assert (iter != NULL);
+
+	do {
+		icalcomps = NULL;
+
+		if (!e_cal_client_object_iter_next_sync (iter, CHUNK_SIZE, &icalcomps, NULL, &error))
+			g_error ("object iter next sync: %s", error->message);
+
+		add_icalcomps (uids, icalcomps);
+
+		e_cal_client_free_icalcomp_slist (icalcomps);
+	} while (icalcomps);
+
+	test_result (uids);
+
+	/* the end of the result is sticky */
+	icalcomps = NULL;
+	if (!e_cal_client_object_iter_next_sync (iter, CHUNK_SIZE, &icalcomps, NULL, &error))
+		g_error ("object iter next sync: %s", error->message);
+
+	g_assert (icalcomps == NULL);
+
+	e_cal_client_object_iter_free (iter);
+	g_hash_table_destroy (uids);
+}
+
+static void
+object_iter_next_cb (GObject *source_object,
+                     GAsyncResult *result,
+                     gpointer user_data)
+{
+	IterData *data = user_data;
+	GSList *icalcomps = NULL;
+	GError *error = NULL;
+
+	if (!e_cal_client_object_iter_next_finish (data->iter, result, &icalcomps, &error))
+		g_error ("object iter next finish: %s", error->message);
+
+	if (!icalcomps) {
+		g_main_loop_quit (data->loop);
+		return;
+	}
+
+	add_icalcomps (data->uids, icalcomps);
+
+	e_cal_client_free_icalcomp_slist (icalcomps);
+
+	e_cal_client_object_iter_next (data->iter, CHUNK_SIZE, NULL, object_iter_next_cb, data);
+}
+
+static void
+object_list_iter_ready_cb (GObject *source_object,
+                           GAsyncResult *result,
+                           gpointer user_data)
+{
+	IterData *data = user_data;
+	GError *error = NULL;
+
+	if (!e_cal_client_get_object_list_iter_finish (E_CAL_CLIENT (source_object), result, &data->iter, &error))
+		g_error ("get object list iter finish: %s", error->message);
+
+	e_cal_client_object_iter_next (data->iter, CHUNK_SIZE, NULL, object_iter_next_cb, data);
+}
+
+static void
+test_get_object_list_iter_async (ETestServerFixture *fixture,
+                                 gconstpointer user_data)
+{
+	ECalClient *cal_client;
+	IterData data = { NULL, NULL, NULL };
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+	setup_cal (cal_client);
+
+	data.loop = fixture->loop;
+	data.uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	e_cal_client_get_object_list_iter (cal_client, EVENT_QUERY, NULL, object_list_iter_ready_cb, &data);
+
+	g_main_loop_run (fixture->loop);
+
+	test_result (data.uids);
+
+	e_cal_client_object_iter_free (data.iter);
+	g_hash_table_destroy (data.uids);
+}
+
+static void
+test_get_object_list_iter_free_early (ETestServerFixture *fixture,
+                                      gconstpointer user_data)
+{
+	ECalClient *cal_client;
+	ECalClientObjectIter *iter = NULL;
+	GSList *icalcomps = NULL;
+	GError *error = NULL;
+
+	cal_client = E_TEST_SERVER_UTILS_SERVICE (fixture, ECalClient);
+	setup_cal (cal_client);
+
+	if (!e_cal_client_get_object_list_iter_sync (cal_client, EVENT_QUERY, &iter, NULL, &error))
+		g_error ("get object list iter sync: %s", error->message);
+
+	if (!e_cal_client_object_iter_next_sync (iter, CHUNK_SIZE, &icalcomps, NULL, &error))
+		g_error ("object iter next sync: %s", error->message);
+
+	g_assert_cmpint (g_slist_length (icalcomps), ==, CHUNK_SIZE);
+	e_cal_client_free_icalcomp_slist (icalcomps);
+
+	/* the backend stops writing the rest of the result */
+	e_cal_client_object_iter_free (iter);
+
+	/* and the calendar stays usable */
+	icalcomps = NULL;
+	if (!e_cal_client_get_object_list_sync (cal_client, EVENT_QUERY, &icalcomps, NULL, &error))
+		g_error ("get object list sync: %s", error->message);
+
+	g_assert_cmpint (g_slist_length (icalcomps), ==, N_EVENTS);
+	e_cal_client_free_icalcomp_slist (icalcomps);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+	g_test_bug_base ("http://bugzilla.gnome.org/");
+
+	g_test_add (
+		"/ECalClient/GetObjectListIter/Sync",
+		ETestServerFixture,
+		&cal_closure_sync,
+		e_test_server_utils_setup,
+		test_get_object_list_iter_sync,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/ECalClient/GetObjectListIter/Async",
+		ETestServerFixture,
+		&cal_closure_async,
+		e_test_server_utils_setup,
+		test_get_object_list_iter_async,
+		e_test_server_utils_teardown);
+	g_test_add (
+		"/ECalClient/GetObjectListIter/FreeEarly",
+		ETestServerFixture,
+		&cal_closure_sync,
+		e_test_server_utils_setup,
+		test_get_object_list_iter_free_early,
+		e_test_server_utils_teardown);
+
+	return e_test_server_utils_run ();
+}
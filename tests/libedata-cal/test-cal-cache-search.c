@@ -394,6 +394,88 @@ test_search_percent_complete (TCUFixture *fixture,
 	test_search (fixture, "(< (percent-complete?) 30)", "!task-7");
 }
 
+static gboolean
+test_search_has_uid (ECalCache *cal_cache,
+		     const gchar *expr,
+		     const gchar *uid)
+{
+	GSList *items = NULL, *link;
+	gboolean found = FALSE;
+	gboolean success;
+	GError *error = NULL;
+
+	success = e_cal_cache_search_ids (cal_cache, expr, &items, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	for (link = items; link && !found; link = g_slist_next (link)) {
+		ECalComponentId *id = link->data;
+
+		found = g_strcmp0 (id->uid, uid) == 0;
+	}
+
+	g_slist_free_full (items, (GDestroyNotify) e_cal_component_free_id);
+
+	return found;
+}
+
+static void
+test_search_parsed_cache (TCUFixture *fixture,
+			  gconstpointer user_data)
+{
+	const gchar *expr = "(occur-in-time-range? (make-time \"20170209T000000Z\") (make-time \"20170210T000000Z\"))";
+	ECalComponent *comp;
+	ECalComponentDateTime dt;
+	struct icaltimetype itt;
+	guint n_components = 0;
+	guint64 hits = 0, misses = 0;
+	gboolean success;
+	GError *error = NULL;
+
+	g_assert (test_search_has_uid (fixture->cal_cache, expr, "event-1"));
+
+	e_cal_cache_get_parsed_cache_stats (fixture->cal_cache, &n_components, &hits, &misses);
+	g_assert_cmpuint (n_components, >, 0);
+	g_assert_cmpuint (hits, ==, 0);
+	g_assert_cmpuint (misses, ==, n_components);
+
+	/* The same rows are checked again, all of them already parsed */
+	g_assert (test_search_has_uid (fixture->cal_cache, expr, "event-1"));
+
+	e_cal_cache_get_parsed_cache_stats (fixture->cal_cache, NULL, &hits, &misses);
+	g_assert_cmpuint (hits, ==, n_components);
+	g_assert_cmpuint (misses, ==, n_components);
+
+	/* Move the event out of the range without changing its revision;
+	   the put itself drops the parsed component */
+	comp = tcu_new_component_from_test_case ("event-1");
+
+	itt = icaltime_from_string ("20010101T013000Z");
+	dt.value = &itt;
+	dt.tzid = NULL;
+	e_cal_component_set_dtstart (comp, &dt);
+
+	itt = icaltime_from_string ("20010101T030000Z");
+	e_cal_component_set_dtend (comp, &dt);
+
+	success = e_cal_cache_put_component (fixture->cal_cache, comp, NULL, E_CACHE_IS_ONLINE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	g_object_unref (comp);
+
+	g_assert (!test_search_has_uid (fixture->cal_cache, expr, "event-1"));
+
+	e_cal_cache_get_parsed_cache_stats (fixture->cal_cache, &n_components, NULL, NULL);
+	g_assert_cmpuint (n_components, >, 0);
+
+	success = e_cal_cache_remove_component (fixture->cal_cache, "event-1", NULL, E_CACHE_IS_ONLINE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (success);
+
+	g_assert (!test_search_has_uid (fixture->cal_cache, expr, "event-1"));
+}
+
 static void
 test_search_occurrences_count (TCUFixture *fixture,
 			       gconstpointer user_data)
@@ -464,6 +546,8 @@ main (gint argc,
 		tcu_fixture_setup, test_search_has_attachments, tcu_fixture_teardown);
 	g_test_add ("/ECalCache/Search/PercentComplete", TCUFixture, &closure_tasks,
 		tcu_fixture_setup, test_search_percent_complete, tcu_fixture_teardown);
+	g_test_add ("/ECalCache/Search/ParsedCache", TCUFixture, &closure_events,
+		tcu_fixture_setup, test_search_parsed_cache, tcu_fixture_teardown);
 	g_test_add ("/ECalCache/Search/OccurrencesCount", TCUFixture, &closure_events,
 		tcu_fixture_setup, test_search_occurrences_count, tcu_fixture_teardown);
 	g_test_add ("/ECalCache/Search/Complex", TCUFixture, &closure_events,
@@ -0,0 +1,220 @@
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-data-server-config.h"
+
+#include <libedata-cal/libedata-cal.h>
+
+#include "libedata-cal/e-data-cal-view-private.h"
+#include "e-test-server-utils.h"
+
+#define EVENT_STRING \
+	"BEGIN:VEVENT\r\n" \
+	"UID:view-strings\r\n" \
+	"DTSTAMP:20170130T000000Z\r\n" \
+	"DTSTART:20170130T100000Z\r\n" \
+	"DTEND:20170130T110000Z\r\n" \
+	"SUMMARY:%s\r\n" \
+	"DESCRIPTION:Not one of the fields of interest\r\n" \
+	"END:VEVENT\r\n"
+
+/* Only to have the views, it implements nothing */
+#define E_TYPE_CAL_BACKEND_STRINGS_TEST (e_cal_backend_strings_test_get_type ())
+
+typedef struct _ECalBackendStringsTest {
+	ECalBackend parent;
+} ECalBackendStringsTest;
+
+typedef struct _ECalBackendStringsTestClass {
+	ECalBackendClass parent_class;
+} ECalBackendStringsTestClass;
+
+GType e_cal_backend_strings_test_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (ECalBackendStringsTest, e_cal_backend_strings_test, E_TYPE_CAL_BACKEND)
+
+static void
+e_cal_backend_strings_test_class_init (ECalBackendStringsTestClass *klass)
+{
+}
+
+static void
+e_cal_backend_strings_test_init (ECalBackendStringsTest *backend)
+{
+}
+
+static ESourceRegistry *glob_registry = NULL;
+
+static EDataCalView *
+add_view (ECalBackend *backend,
+          GDBusConnection *connection,
+          gint index,
+          const gchar * const *fields_of_interest)
+{
+	ECalBackendSExp *sexp;
+	EDataCalView *view;
+	gchar *object_path;
+	GError *error = NULL;
+
+	sexp = e_cal_backend_sexp_new ("#t");
+	g_assert_nonnull (sexp);
+
+	object_path = g_strdup_printf ("/org/gnome/evolution/dataserver/CalendarView/StringsTest/%d", index);
+
+	view = e_data_cal_view_new (backend, sexp, connection, object_path, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (view);
+
+	if (fields_of_interest)
+		_e_data_cal_view_set_fields_of_interest (view, fields_of_interest);
+
+	e_cal_backend_add_view (backend, view);
+
+	g_object_unref (sexp);
+	g_free (object_path);
+
+	return view;
+}
+
+static ECalComponent *
+new_component (const gchar *summary)
+{
+	ECalComponent *comp;
+	gchar *str;
+
+	str = g_strdup_printf (EVENT_STRING, summary);
+	comp = e_cal_component_new_from_string (str);
+	g_assert_nonnull (comp);
+	g_free (str);
+
+	return comp;
+}
+
+static void
+check_stats (guint *hits,
+             guint *misses,
+             guint expected_hits,
+             guint expected_misses)
+{
+	guint new_hits = 0, new_misses = 0;
+
+	e_data_cal_view_get_shared_strings_stats (&new_hits, &new_misses);
+
+	g_assert_cmpuint (new_hits - *hits, ==, expected_hits);
+	g_assert_cmpuint (new_misses - *misses, ==, expected_misses);
+
+	*hits = new_hits;
+	*misses = new_misses;
+}
+
+static void
+test_shared_strings (void)
+{
+	const gchar *summary_dtstart[] = { "summary", "dtstart", NULL };
+	const gchar *dtstart_summary[] = { "DTSTART", "Summary", NULL };
+	const gchar *summary[] = { "summary", NULL };
+	const gchar *empty[] = { "", NULL };
+	GDBusConnection *connection;
+	ECalBackend *backend;
+	ECalComponent *comp, *modified;
+	ESource *scratch;
+	GSList *views = NULL;
+	guint hits = 0, misses = 0;
+	GError *error = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (connection);
+
+	scratch = e_source_new_with_uid ("test-view-strings", NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (scratch);
+
+	backend = g_object_new (E_TYPE_CAL_BACKEND_STRINGS_TEST,
+		"source", scratch,
+		"registry", glob_registry,
+		"kind", ICAL_VEVENT_COMPONENT,
+		NULL);
+	g_assert_nonnull (backend);
+
+	/* three sets of fields-of-interest: the full component, twice without
+	 * fields and once with only empty ones, then the same two fields in
+	 * a different order and case, then only one of them */
+	views = g_slist_prepend (views, add_view (backend, connection, 0, NULL));
+	views = g_slist_prepend (views, add_view (backend, connection, 1, NULL));
+	views = g_slist_prepend (views, add_view (backend, connection, 2, empty));
+	views = g_slist_prepend (views, add_view (backend, connection, 3, summary_dtstart));
+	views = g_slist_prepend (views, add_view (backend, connection, 4, dtstart_summary));
+	views = g_slist_prepend (views, add_view (backend, connection, 5, summary));
+
+	comp = new_component ("Created");
+	modified = new_component ("Modified");
+
+	check_stats (&hits, &misses, 0, 0);
+
+	e_cal_backend_notify_component_created (backend, comp);
+	check_stats (&hits, &misses, 3, 3);
+
+	e_cal_backend_notify_component_modified (backend, comp, modified);
+	check_stats (&hits, &misses, 3, 3);
+
+	/* each notification serializes its component again */
+	e_cal_backend_notify_component_modified (backend, modified, comp);
+	check_stats (&hits, &misses, 3, 3);
+
+	while (views) {
+		EDataCalView *view = views->data;
+
+		e_cal_backend_remove_view (backend, view);
+		g_object_unref (view);
+
+		views = g_slist_delete_link (views, views);
+	}
+
+	g_object_unref (modified);
+	g_object_unref (comp);
+	g_object_unref (backend);
+	g_object_unref (scratch);
+	g_object_unref (connection);
+}
+
+gint
+main (gint argc,
+      gchar **argv)
+{
+	ETestServerClosure tsclosure = {
+		E_TEST_SERVER_NONE,
+		NULL, /* Source customization function */
+		0,    /* Calendar Type */
+		FALSE, /* Keep the working sandbox after the test, don't remove it */
+		NULL, /* Destroy Notify function */
+	};
+	ETestServerFixture tsfixture = { 0 };
+	gint res;
+
+	g_test_init (&argc, &argv, NULL);
+
+	e_test_server_utils_setup (&tsfixture, &tsclosure);
+
+	glob_registry = tsfixture.registry;
+	g_assert_nonnull (glob_registry);
+
+	g_test_add_func ("/EDataCalView/SharedStrings", test_shared_strings);
+
+	res = g_test_run ();
+
+	e_test_server_utils_teardown (&tsfixture, &tsclosure);
+
+	return res;
+}
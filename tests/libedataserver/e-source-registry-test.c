@@ -131,6 +131,189 @@ test_remove_source (ETestServerFixture *fixture,
 	g_main_loop_run (fixture->loop);
 }
 
+/* Compares the indexed list against a list filtered and sorted here */
+static void
+check_list_sources (ESourceRegistry *registry,
+                    const gchar *extension_name)
+{
+	GList *list, *all, *expected = NULL, *link, *elink;
+
+	list = e_source_registry_list_sources (registry, extension_name);
+	all = e_source_registry_list_sources (registry, NULL);
+
+	for (link = all; link; link = g_list_next (link)) {
+		if (e_source_has_extension (link->data, extension_name))
+			expected = g_list_prepend (expected, link->data);
+
+		if (link->next)
+			g_assert_cmpint (e_source_compare_by_display_name (link->data, link->next->data), <, 0);
+	}
+
+	expected = g_list_sort (expected, (GCompareFunc) e_source_compare_by_display_name);
+
+	g_assert_cmpint (g_list_length (list), ==, g_list_length (expected));
+
+	for (link = list, elink = expected; link && elink; link = g_list_next (link), elink = g_list_next (elink)) {
+		g_assert (link->data == elink->data);
+	}
+
+	g_list_free (expected);
+	g_list_free_full (all, g_object_unref);
+	g_list_free_full (list, g_object_unref);
+}
+
+static void
+iterate_main_context (void)
+{
+	while (g_main_context_iteration (NULL, FALSE)) {
+		/* Empty */
+	}
+}
+
+static gboolean
+test_list_sources_idle_cb (gpointer user_data)
+{
+	ETestServerFixture *fixture = user_data;
+	const gchar *display_names[] = { "Charlie", "Alpha", "Bravo" };
+	GList *scratch_sources = NULL;
+	GPtrArray *uids;
+	ESource *source;
+	guint ii;
+	GError *local_error = NULL;
+
+	/* Build the index before the sources are added */
+	check_list_sources (fixture->registry, E_SOURCE_EXTENSION_MEMO_LIST);
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+
+	for (ii = 0; ii < G_N_ELEMENTS (display_names); ii++) {
+		ESource *scratch_source;
+
+		scratch_source = e_source_new (NULL, NULL, &local_error);
+		g_assert_no_error (local_error);
+		e_source_set_parent (scratch_source, "local-stub");
+		e_source_set_display_name (scratch_source, display_names[ii]);
+		e_source_get_extension (scratch_source, E_SOURCE_EXTENSION_MEMO_LIST);
+
+		g_ptr_array_add (uids, e_source_dup_uid (scratch_source));
+		scratch_sources = g_list_prepend (scratch_sources, scratch_source);
+	}
+
+	e_source_registry_create_sources_sync (fixture->registry, scratch_sources, NULL, &local_error);
+	g_assert_no_error (local_error);
+	g_list_free_full (scratch_sources, g_object_unref);
+
+	check_list_sources (fixture->registry, E_SOURCE_EXTENSION_MEMO_LIST);
+	check_list_sources (fixture->registry, E_SOURCE_EXTENSION_TASK_LIST);
+
+	/* Renaming moves the source in the list */
+	source = e_source_registry_ref_source (fixture->registry, uids->pdata[1]);
+	g_assert (source != NULL);
+	e_source_set_display_name (source, "Zulu");
+	iterate_main_context ();
+	check_list_sources (fixture->registry, E_SOURCE_EXTENSION_MEMO_LIST);
+
+	/* A new extension adds the source to the list */
+	e_source_get_extension (source, E_SOURCE_EXTENSION_TASK_LIST);
+	iterate_main_context ();
+	check_list_sources (fixture->registry, E_SOURCE_EXTENSION_TASK_LIST);
+	g_clear_object (&source);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		source = e_source_registry_ref_source (fixture->registry, uids->pdata[ii]);
+
+		if (!remove_source (fixture->registry, source))
+			g_test_fail ();
+
+		g_clear_object (&source);
+
+		check_list_sources (fixture->registry, E_SOURCE_EXTENSION_MEMO_LIST);
+		check_list_sources (fixture->registry, E_SOURCE_EXTENSION_TASK_LIST);
+	}
+
+	g_ptr_array_unref (uids);
+
+	g_main_loop_quit (fixture->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+test_list_sources (ETestServerFixture *fixture,
+                   gconstpointer user_data)
+{
+	g_idle_add (test_list_sources_idle_cb, fixture);
+	g_main_loop_run (fixture->loop);
+}
+
+#define PERF_N_SOURCES 5000
+#define PERF_N_CALLS 1000
+
+static gboolean
+test_list_sources_perf_idle_cb (gpointer user_data)
+{
+	ETestServerFixture *fixture = user_data;
+	GList *scratch_sources = NULL, *list;
+	GTimer *timer;
+	guint ii, n_listed = 0;
+	GError *local_error = NULL;
+
+	for (ii = 0; ii < PERF_N_SOURCES; ii++) {
+		ESource *scratch_source;
+		gchar *display_name;
+
+		scratch_source = e_source_new (NULL, NULL, &local_error);
+		g_assert_no_error (local_error);
+		e_source_set_parent (scratch_source, "local-stub");
+
+		/* Not in the sorted order */
+		display_name = g_strdup_printf ("Source %05u", (ii * 7919) % PERF_N_SOURCES);
+		e_source_set_display_name (scratch_source, display_name);
+		g_free (display_name);
+
+		e_source_get_extension (scratch_source, (ii % 2) ? E_SOURCE_EXTENSION_ADDRESS_BOOK : E_SOURCE_EXTENSION_CALENDAR);
+
+		scratch_sources = g_list_prepend (scratch_sources, scratch_source);
+	}
+
+	e_source_registry_create_sources_sync (fixture->registry, scratch_sources, NULL, &local_error);
+	g_assert_no_error (local_error);
+	g_list_free_full (scratch_sources, g_object_unref);
+
+	timer = g_timer_new ();
+
+	for (ii = 0; ii < PERF_N_CALLS; ii++) {
+		list = e_source_registry_list_sources (fixture->registry, E_SOURCE_EXTENSION_ADDRESS_BOOK);
+		n_listed += g_list_length (list);
+		g_list_free_full (list, g_object_unref);
+	}
+
+	g_timer_stop (timer);
+
+	g_assert_cmpuint (n_listed, >=, PERF_N_CALLS * PERF_N_SOURCES / 2);
+
+	g_test_minimized_result (g_timer_elapsed (timer, NULL),
+		"Listed address books of %d sources %d times in %.3f seconds",
+		PERF_N_SOURCES, PERF_N_CALLS, g_timer_elapsed (timer, NULL));
+
+	g_timer_destroy (timer);
+
+	g_main_loop_quit (fixture->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+test_list_sources_perf (ETestServerFixture *fixture,
+                        gconstpointer user_data)
+{
+	if (!g_test_perf ())
+		return;
+
+	g_idle_add (test_list_sources_perf_idle_cb, fixture);
+	g_main_loop_run (fixture->loop);
+}
+
 gint
 main (gint argc,
       gchar **argv)
@@ -154,6 +337,20 @@ main (gint argc,
 		test_remove_source,
 		e_test_server_utils_teardown);
 
+	g_test_add (
+		"/e-source-registry-test/ListSources",
+		ETestServerFixture, &test_closure,
+		e_test_server_utils_setup,
+		test_list_sources,
+		e_test_server_utils_teardown);
+
+	g_test_add (
+		"/e-source-registry-test/ListSourcesPerf",
+		ETestServerFixture, &test_closure,
+		e_test_server_utils_setup,
+		test_list_sources_perf,
+		e_test_server_utils_teardown);
+
 	retval = e_test_server_utils_run ();
 
 	/* XXX Something is leaking a GDBusConnection reference.